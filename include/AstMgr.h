@@ -76,6 +76,12 @@ public:
   scan(YYSTYPE& lval,
        FileRegion& lloc);
 
+  /// @brief 構文エラーが起きたことを記録する．
+  ///
+  /// エラー回復した場合も read_source() は false を返すようになる．
+  void
+  set_error();
+
 
 public:
   //////////////////////////////////////////////////////////////////////
@@ -453,6 +459,9 @@ private:
   // トップレベルの AST
   AstToplevel* mToplevel;
 
+  // 構文エラーが起きたら true にするフラグ
+  bool mError;
+
   // デバッグフラグ
   bool mDebug;
 
@@ -51,6 +51,13 @@ public:
   void
   add_node(IrNode* node);
 
+  /// @brief ノードのリストを置き換える．
+  /// @param[in] node_list 新しいノードのリスト
+  ///
+  /// IrOptimizer が書き換えた結果を戻すのに用いる．
+  void
+  set_node_list(const vector<IrNode*>& node_list);
+
   /// @brief ローカル変数のリストを得る．
   const vector<IrHandle*>&
   var_list() const;
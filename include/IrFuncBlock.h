@@ -45,6 +45,10 @@ public:
   IrHandle*
   func_handle();
 
+  /// @brief 引数のリストを返す．
+  const vector<IrHandle*>&
+  arg_list() const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
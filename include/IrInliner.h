@@ -0,0 +1,218 @@
+#ifndef IRINLINER_H
+#define IRINLINER_H
+
+/// @file IrInliner.h
+/// @brief IrInliner のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class IrInliner IrInliner.h "IrInliner.h"
+/// @brief 関数呼び出しのインライン展開を行うクラス
+///
+/// 同じモジュールの関数のうち，本体が十分に小さいものか，
+/// 呼び出し箇所が一つだけでそれなりに小さいものの呼び出しを，
+/// 呼び出し側のコードブロックに本体をコピーして置き換える．
+///
+/// 引数と関数内のローカル変数は呼び出し側の新しいローカル変数に
+/// 付け替え，return は返り値用の変数への代入と末尾へのジャンプに
+/// 置き換える．展開した本体は呼び出しを含む文の直前に置くので，
+/// 文の中でそれより前に評価される部分が関数の実行で変わりうる
+/// 場合(グローバル変数の読み出しや他の関数呼び出しの後など)や，
+/// 条件付きで評価される位置の呼び出しは展開しない．
+///
+/// 呼ばれる側を先に展開しておくために呼び出しグラフを深さ優先で
+/// たどる．再帰呼び出しは展開しない．
+/// return の値になる呼び出しは，呼ばれる側が末尾呼び出しを含む場合は
+/// 展開しない．展開すると末尾呼び出しが普通の呼び出しになるため．
+//////////////////////////////////////////////////////////////////////
+class IrInliner
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] mgr ノードを生成するオブジェクト
+  IrInliner(IrMgr& mgr);
+
+  /// @brief デストラクタ
+  ~IrInliner();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief モジュール内の関数呼び出しを展開する．
+  /// @param[in] toplevel 対象のトップレベルブロック
+  void
+  expand(IrToplevel* toplevel);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  // 関数ごとの情報
+  struct FuncInfo
+  {
+    // 関数
+    IrFuncBlock* mFunc;
+
+    // 処理の状態
+    // 0: 未処理，1: 処理中，2: 処理済み
+    ymuint mState;
+
+    // 呼び出し箇所の数
+    ymuint mCallNum;
+  };
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 関数の中の呼び出しを展開する．
+  /// @param[in] func_id 関数番号
+  ///
+  /// 呼ばれる関数を先に処理する．
+  void
+  expand_func(ymuint func_id);
+
+  /// @brief コードブロックの中の呼び出しを展開する．
+  /// @param[in] code_block 対象のコードブロック
+  void
+  expand_block(IrCodeBlock* code_block);
+
+  /// @brief 文の中の呼び出しを展開する．
+  /// @param[in] node 対象の文
+  /// @param[out] pre_list 展開した本体を追加するリスト
+  /// @return 書き換えた文を返す．
+  ///
+  /// 文が要らなくなった場合には NULL を返す．
+  IrNode*
+  expand_stmt(IrNode* node,
+	      vector<IrNode*>& pre_list);
+
+  /// @brief 式の中の呼び出しを展開する．
+  /// @param[in] node 対象の式
+  /// @param[in] cond 条件付きで評価される位置の時 true
+  /// @param[inout] barrier これより後の呼び出しを展開できない時 true
+  /// @param[out] pre_list 展開した本体を追加するリスト
+  /// @return 書き換えた式を返す．
+  IrNode*
+  expand_expr(IrNode* node,
+	      bool cond,
+	      bool& barrier,
+	      vector<IrNode*>& pre_list);
+
+  /// @brief 関数呼び出しを展開する．
+  /// @param[in] node 関数呼び出しノード
+  /// @param[in] cond 条件付きで評価される位置の時 true
+  /// @param[in] tail return の値になる位置の時 true
+  /// @param[inout] barrier これより後の呼び出しを展開できない時 true
+  /// @param[out] pre_list 展開した本体を追加するリスト
+  /// @return 書き換えた式を返す．
+  IrNode*
+  expand_call(IrNode* node,
+	      bool cond,
+	      bool tail,
+	      bool& barrier,
+	      vector<IrNode*>& pre_list);
+
+  /// @brief 展開できる呼び出し先を返す．
+  /// @param[in] node 関数呼び出しノード
+  /// @param[in] tail return の値になる位置の時 true
+  ///
+  /// 展開できない場合には NULL を返す．
+  IrFuncBlock*
+  find_callee(IrNode* node,
+	      bool tail);
+
+  /// @brief 関数の本体をコピーできる時 true を返す．
+  /// @param[in] func 関数
+  bool
+  check_func(IrFuncBlock* func);
+
+  /// @brief 関数の本体を展開する．
+  /// @param[in] node 関数呼び出しノード(引数は展開済み)
+  /// @param[in] func 呼び出される関数
+  /// @param[out] pre_list 展開した本体を追加するリスト
+  /// @return 返り値を読むノードを返す．
+  ///
+  /// 返り値のない関数の場合には NULL を返す．
+  IrNode*
+  splice(IrNode* node,
+	 IrFuncBlock* func,
+	 vector<IrNode*>& pre_list);
+
+  /// @brief ノードをコピーする．
+  /// @param[in] node 対象のノード
+  ///
+  /// ローカル変数とラベルは mVarMap と mLabelMap で付け替える．
+  IrNode*
+  copy_node(IrNode* node);
+
+  /// @brief ハンドルをコピーする．
+  /// @param[in] handle 対象のハンドル
+  IrHandle*
+  copy_handle(IrHandle* handle);
+
+  /// @brief 末尾呼び出しを含む時 true を返す．
+  /// @param[in] func 関数
+  static
+  bool
+  has_tail_call(IrFuncBlock* func);
+
+  /// @brief ノード数を数える．
+  /// @param[in] node 対象のノード
+  static
+  ymuint
+  node_size(IrNode* node);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // ノードを生成するオブジェクト
+  IrMgr& mMgr;
+
+  // 関数の情報のリスト
+  vector<FuncInfo> mFuncList;
+
+  // 関数のローカルインデックスをキーにして関数番号を保持する配列
+  vector<ymuint> mFuncMap;
+
+  // 展開先のコードブロック
+  IrCodeBlock* mCodeBlock;
+
+  // 展開先のコードブロックのノード数
+  ymuint mBlockSize;
+
+  // 呼び出される関数のローカル変数の番号をキーにして
+  // 付け替え先の変数を保持する配列
+  vector<IrHandle*> mVarMap;
+
+  // 呼び出される関数のラベルのリスト
+  vector<IrNode*> mLabelList;
+
+  // ラベルの番号(IrNode::id())をキーにして付け替え先のラベルを保持する配列
+  vector<IrNode*> mLabelMap;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // IRINLINER_H
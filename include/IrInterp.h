@@ -17,6 +17,10 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 /// @class IrInterp IrInterp.h "IrInterp.h"
 /// @brief IrNode のインタープリタ
+///
+/// 定数式の評価に用いる．
+/// オペランドの型が演算の型と異なる場合には VsmGen と同じ規則で
+/// 変換してから演算を行う．
 //////////////////////////////////////////////////////////////////////
 class IrInterp
 {
@@ -49,6 +53,23 @@ public:
   Ymsl_FLOAT
   eval_float(IrNode* node);
 
+  /// @brief 式を評価して boolean 型に変換する．
+  /// @param[in] node 式を表すノード
+  ///
+  /// node の型は boolean, int, float のいずれかでなければならない．
+  bool
+  eval_as_boolean(IrNode* node);
+
+  /// @brief 式を評価して int 型に変換する．
+  /// @param[in] node 式を表すノード
+  Ymsl_INT
+  eval_as_int(IrNode* node);
+
+  /// @brief 式を評価して float 型に変換する．
+  /// @param[in] node 式を表すノード
+  Ymsl_FLOAT
+  eval_as_float(IrNode* node);
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 #include "ymsl_int.h"
 #include "VsmValue.h"
 #include "TypeMgr.h"
+#include "VsmModule.h"
 #include "YmUtils/ShString.h"
 #include "YmUtils/HashMap.h"
 #include "YmUtils/SimpleAlloc.h"
@@ -25,11 +26,24 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 class IrMgr
 {
+  friend class IrInliner;
+  friend class IrOptimizer;
+
 public:
 
   /// @brief コンストラクタ
+  ///
+  /// 型は自前の TypeMgr で管理する．
   IrMgr();
 
+  /// @brief 型を管理するオブジェクトを指定したコンストラクタ
+  /// @param[in] type_mgr 型を管理するオブジェクト
+  ///
+  /// 生成したモジュールが参照する型を IrMgr より長く
+  /// 生かしておきたい場合に用いる．
+  /// type_mgr は clear() でもクリアしない．
+  IrMgr(TypeMgr& type_mgr);
+
   /// @brief デストラクタ
   ~IrMgr();
 
@@ -55,6 +69,14 @@ public:
 	    ShString name,
 	    YmslCompiler& compiler);
 
+  /// @brief 中間表現の最適化を行う．
+  /// @param[in] toplevel elaborate() で生成したトップレベルのコード
+  ///
+  /// IrInliner で小さな関数の呼び出しを展開してから，
+  /// トップレベルと各関数のコードブロックを IrOptimizer で書き換える．
+  void
+  optimize(IrToplevel* toplevel);
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -159,6 +181,17 @@ private:
   elab_primary(const AstExpr* ast_expr,
 	       Scope* scope);
 
+  /// @brief 定数式を畳み込む．
+  /// @param[in] node 演算式のノード
+  /// @return 畳み込んだ結果のノードを返す．
+  ///
+  /// オペランドが全て boolean, int, float の定数なら IrInterp で
+  /// 評価して定数のロードに置き換える．条件が定数の ITE は
+  /// 選ばれる方のオペランドに置き換える．
+  /// 畳み込めない場合には node をそのまま返す．
+  IrNode*
+  fold_const(IrNode* node);
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -252,6 +285,15 @@ private:
   new_BranchFalse(IrNode* label,
 		  IrNode* cond);
 
+  /// @brief 多方向分岐ノードを生成する．
+  /// @param[in] cond 条件
+  /// @param[in] case_list case の値と飛び先のリスト
+  /// @param[in] default_label どれにも当てはまらない時の飛び先
+  IrNode*
+  new_Switch(IrNode* cond,
+	     const vector<pair<Ymsl_INT, IrNode*> >& case_list,
+	     IrNode* default_label);
+
   /// @brief ラベルノードを生成する．
   IrNode*
   new_Label();
@@ -392,8 +434,12 @@ private:
   // メモリアロケータ
   SimpleAlloc mAlloc;
 
+  // 自前で確保した型を管理するオブジェクト
+  // 外から与えられた場合は NULL
+  TypeMgr* mOwnTypeMgr;
+
   // 型を管理するオブジェクト
-  TypeMgr mTypeMgr;
+  TypeMgr& mTypeMgr;
 
   // mFuncCallList の要素の構造体
   struct FuncCallStub {
@@ -436,22 +482,4 @@ private:
 
 END_NAMESPACE_YM_YMSL
 
-BEGIN_NAMESPACE_YM
-
-//////////////////////////////////////////////////////////////////////
-// HashFunc<VsmModule*> の特殊化
-//////////////////////////////////////////////////////////////////////
-template<>
-struct
-HashFunc<nsYmsl::VsmModule*>
-{
-  ymuint
-  operator()(nsYmsl::VsmModule* key) const
-  {
-    return reinterpret_cast<ympuint>(key) / sizeof(void*);
-  }
-};
-
-END_NAMESPACE_YM
-
 #endif // IRMGR_H
@@ -48,6 +48,8 @@ public:
     kJump,
     kBranchTrue,
     kBranchFalse,
+    // 多方向分岐
+    kSwitch,
     // 特殊
     kLabel,
     // 停止
@@ -167,18 +169,43 @@ public:
 
   /// @brief ジャンプ先のノードを得る．
   ///
-  /// kJump, kBranchXXX のみ有効
+  /// kJump, kBranchXXX, kSwitch のみ有効
+  /// kSwitch の場合はどの case にも当てはまらない時の飛び先
   virtual
   IrNode*
   jump_addr() const;
 
   /// @brief 分岐条件
   ///
-  /// kBranchXXX のみ有効
+  /// kBranchXXX, kSwitch のみ有効
+  /// kSwitch の場合は case の値と比べる式
   virtual
   IrNode*
   branch_cond() const;
 
+  /// @brief case の数を返す．
+  ///
+  /// kSwitch のみ有効
+  virtual
+  ymuint
+  case_num() const;
+
+  /// @brief case の値を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < case_num() )
+  ///
+  /// kSwitch のみ有効
+  virtual
+  Ymsl_INT
+  case_val(ymuint pos) const;
+
+  /// @brief case の飛び先を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < case_num() )
+  ///
+  /// kSwitch のみ有効
+  virtual
+  IrNode*
+  case_label(ymuint pos) const;
+
   /// @brief 返り値
   ///
   /// kReturn のみ有効
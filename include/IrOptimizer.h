@@ -0,0 +1,376 @@
+#ifndef IROPTIMIZER_H
+#define IROPTIMIZER_H
+
+/// @file IrOptimizer.h
+/// @brief IrOptimizer のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "OpCode.h"
+#include "YmUtils/HashMap.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class IrOptimizer IrOptimizer.h "IrOptimizer.h"
+/// @brief IrCodeBlock の最適化を行うクラス
+///
+/// IrSsa で求めた SSA 形式の上で以下の変形を行い，結果を元の
+/// 変数を使ったノードリストに戻して IrCodeBlock に書き戻す．
+///
+///  - コピー伝播: コピーされた変数のロードを，コピー元の変数か
+///    定数のロードに置き換える．置き換えた式は定数畳み込みし直す．
+///  - 大域値番号付け(GVN)による共通部分式の削除:
+///    同じ値番号を持つ式が支配するブロックで計算済みならば，
+///    最初の計算結果を一時変数に入れておいてそれを読む．
+///  - ループ不変式の移動: ループの中で値の変わらない式を
+///    ループの直前で一時変数に入れておき，ループの中ではそれを読む．
+///  - 帰納変数の強さの低減: ループごとに一定量ずつ増減する変数と
+///    ループ不変な値の積を一時変数に入れておき，変数の増減に合わせて
+///    加減算で更新する．
+///  - 不要な代入の削除: 読まれることのない値を定義している
+///    ローカル変数への代入を取り除く．
+///
+/// 新しいノードやハンドルは IrMgr のメモリアロケータで作る．
+//////////////////////////////////////////////////////////////////////
+class IrOptimizer
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] mgr ノードを生成するオブジェクト
+  IrOptimizer(IrMgr& mgr);
+
+  /// @brief デストラクタ
+  ~IrOptimizer();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief コードブロックの最適化を行う．
+  /// @param[in] code_block 対象のコードブロック
+  void
+  optimize(IrCodeBlock* code_block);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  // 値番号のハッシュ表のキー
+  struct VnKey
+  {
+    // ハッシュ値を返す．
+    ymuint
+    hash() const;
+
+    // 等価比較演算子
+    bool
+    operator==(const VnKey& right) const;
+
+    // ノードの種類とオペコード(定数の場合はハンドルの種類)
+    ymuint mKind;
+
+    // 値の型
+    const Type* mType;
+
+    // オペランドの値番号(定数の場合は値のビットパタン)
+    ymuint mOpr[3];
+  };
+
+  // ループ
+  struct Loop
+  {
+    // ヘッダのブロック番号
+    ymuint mHeader;
+
+    // ブロック番号をキーにしてループに含まれる時 true となる配列
+    vector<bool> mBodyMark;
+
+    // ループに含まれるブロック数
+    ymuint mSize;
+
+    // ヘッダのラベルの直前に置いた文がループに入る時だけ
+    // 実行される時 true
+    bool mHasPreheader;
+
+    // ヘッダのラベルの直前に置く文のリスト
+    vector<IrNode*> mPreList;
+
+    // 変数番号をキーにして帰納変数かどうかを保持する配列
+    // 0: 未判定，1: 帰納変数でない，2: 帰納変数
+    vector<ymuint> mIvState;
+  };
+
+  // 強さの低減を行った積
+  struct SrInfo
+  {
+    // ループ番号
+    ymuint mLoop;
+
+    // 帰納変数の変数番号
+    ymuint mVar;
+
+    // 掛ける値(定数かループ不変なローカル変数)
+    IrHandle* mStride;
+
+    // 積を保持する一時変数
+    IrHandle* mTemp;
+  };
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief コピー伝播と共通部分式の削除を行う．
+  /// @param[in] ssa SSA 形式
+  /// @param[in] code_block 対象のコードブロック
+  void
+  prop_and_cse(const IrSsa& ssa,
+	       IrCodeBlock* code_block);
+
+  /// @brief 不要な代入を削除する．
+  /// @param[in] ssa SSA 形式
+  /// @param[in] code_block 対象のコードブロック
+  void
+  elim_dead_store(const IrSsa& ssa,
+		  IrCodeBlock* code_block);
+
+  /// @brief ループ不変式の移動と強さの低減を行う．
+  /// @param[in] ssa SSA 形式
+  /// @param[in] code_block 対象のコードブロック
+  /// @return 変形を行った時 true を返す．
+  bool
+  opt_loop(const IrSsa& ssa,
+	   IrCodeBlock* code_block);
+
+  /// @brief 支配木の順にブロックをたどって共通部分式を探す．
+  /// @param[in] block_id ブロック番号
+  void
+  cse_block(ymuint block_id);
+
+  /// @brief 式の値番号を求める．
+  /// @param[in] node 対象のノード
+  void
+  calc_vn(IrNode* node);
+
+  /// @brief 式の中から共通部分式を探す．
+  /// @param[in] node 対象のノード
+  /// @param[in] cond 条件付きで評価される位置の時 true
+  /// @param[in] has_call 文の中に関数呼び出しを含む時 true
+  void
+  find_cse(IrNode* node,
+	   bool cond,
+	   bool has_call);
+
+  /// @brief ローカル変数の値の値番号を返す．
+  /// @param[in] val_id SSA 形式の値の番号
+  ymuint
+  value_vn(ymuint val_id);
+
+  /// @brief 定数の値番号を返す．
+  /// @param[in] handle 定数のハンドル
+  ymuint
+  const_vn(IrHandle* handle);
+
+  /// @brief キーに対応する値番号を返す．
+  /// @param[in] key キー
+  ///
+  /// 未登録なら新しい番号を割り当てる．
+  ymuint
+  find_vn(const VnKey& key);
+
+  /// @brief 自然ループを求める．
+  ///
+  /// 結果は mLoopList に入る．
+  void
+  find_loops();
+
+  /// @brief 式がどのループまで不変かを求める．
+  /// @param[in] node 対象のノード
+  /// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+  /// @return 不変となる最も外側のループの loop_list 上の位置を返す．
+  ///
+  /// どのループでも不変でない場合には loop_list.size() を返す．
+  /// 部分式の結果は mNodeLevel に入る．
+  ymuint
+  calc_level(IrNode* node,
+	     const vector<ymuint>& loop_list);
+
+  /// @brief 式の中からループ不変式と強さの低減を行える積を探す．
+  /// @param[in] node 対象のノード
+  /// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+  void
+  find_inv(IrNode* node,
+	   const vector<ymuint>& loop_list);
+
+  /// @brief 帰納変数と不変式の積の強さの低減を行う．
+  /// @param[in] node 対象の積のノード
+  /// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+  /// @return 強さの低減を行った時 true を返す．
+  bool
+  reduce(IrNode* node,
+	 const vector<ymuint>& loop_list);
+
+  /// @brief 帰納変数の時 true を返す．
+  /// @param[in] loop_id ループ番号
+  /// @param[in] var 変数番号
+  ///
+  /// ループの中での全ての代入がループ不変な int 値の加減算の
+  /// 時に帰納変数とみなす．
+  bool
+  is_iv(ymuint loop_id,
+	ymuint var);
+
+  /// @brief 帰納変数の更新の増分を得る．
+  /// @param[in] node 代入文
+  /// @param[in] loop_id ループ番号
+  /// @param[in] var 変数番号
+  /// @param[out] opcode kOpAdd か kOpSub
+  /// @param[out] step 増分のロード(kOpInc, kOpDec の時は NULL)
+  /// @return 帰納変数の更新になっていない場合には false を返す．
+  bool
+  get_iv_step(IrNode* node,
+	      ymuint loop_id,
+	      ymuint var,
+	      OpCode& opcode,
+	      IrNode*& step);
+
+  /// @brief ループ不変な int 値のロードの時 true を返す．
+  /// @param[in] node 対象のノード
+  /// @param[in] loop_id ループ番号
+  bool
+  is_inv_load(IrNode* node,
+	      ymuint loop_id);
+
+  /// @brief 式をループの直前に移動する．
+  /// @param[in] node 対象の式
+  /// @param[in] loop_id ループ番号
+  /// @return 式の値を入れた一時変数を返す．
+  IrHandle*
+  hoist(IrNode* node,
+	ymuint loop_id);
+
+  /// @brief 一時変数を作る．
+  /// @param[in] prefix 名前の接頭辞
+  /// @param[in] type 型
+  IrHandle*
+  new_temp(const char* prefix,
+	   const Type* type);
+
+  /// @brief 文を書き換える．
+  /// @param[in] node 対象の文
+  /// @param[out] node_list 結果の文を追加するリスト
+  void
+  rewrite_stmt(IrNode* node,
+	       vector<IrNode*>& node_list);
+
+  /// @brief 式を書き換える．
+  /// @param[in] node 対象の式
+  /// @param[out] pre_list 一時変数への代入を追加するリスト
+  /// @return 書き換えた式を返す．
+  ///
+  /// 書き換える必要がなければ node をそのまま返す．
+  IrNode*
+  rewrite_expr(IrNode* node,
+	       vector<IrNode*>& pre_list);
+
+  /// @brief ロードをコピー元のロードに書き換える．
+  /// @param[in] node 対象のロード
+  IrNode*
+  rewrite_load(IrNode* node);
+
+  /// @brief 文の中の式の根を得る．
+  /// @param[in] node 対象の文
+  /// @param[out] expr_list 式の根を入れるリスト
+  ///
+  /// 代入先のハンドルの中の式は含めない．
+  static
+  void
+  get_expr_list(IrNode* node,
+		vector<IrNode*>& expr_list);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // ノードを生成するオブジェクト
+  IrMgr& mMgr;
+
+  // 対象の SSA 形式
+  // prop_and_cse() の中でのみ有効
+  const IrSsa* mSsa;
+
+  // 対象のコードブロック
+  // prop_and_cse() の中でのみ有効
+  IrCodeBlock* mCodeBlock;
+
+  // 値番号の数
+  ymuint mVnNum;
+
+  // 値番号のハッシュ表
+  HashMap<VnKey, ymuint> mVnDict;
+
+  // SSA 形式の値をキーにして値番号を保持する配列
+  vector<ymuint> mValueVn;
+
+  // ノード番号をキーにして値番号を保持する配列
+  vector<ymuint> mNodeVn;
+
+  // ノード番号をキーにして部分木のノード数を保持する配列
+  vector<ymuint> mNodeSize;
+
+  // 値番号をキーにして現在のブロックで使える計算済みの式を保持する配列
+  vector<IrNode*> mLeader;
+
+  // mLeader に登録した値番号のスタック
+  vector<ymuint> mLeaderStack;
+
+  // ノード番号をキーにして代わりに読む計算済みの式を保持する配列
+  vector<IrNode*> mReuse;
+
+  // ノード番号をキーにして計算結果が再利用される回数を保持する配列
+  vector<ymuint> mReuseCount;
+
+  // ノード番号をキーにして計算結果を入れる一時変数を保持する配列
+  vector<IrHandle*> mTemp;
+
+  // ノード番号をキーにして代わりに読む一時変数を保持する配列
+  vector<IrHandle*> mReplace;
+
+  // 作った一時変数の数
+  ymuint mTempNum;
+
+  // ループのリスト
+  vector<Loop> mLoopList;
+
+  // ブロック番号をキーにしてそのブロックを含むループのリストを保持する配列
+  vector<vector<ymuint> > mBlockLoopList;
+
+  // ノード番号をキーにして不変となるループの位置を保持する配列
+  vector<ymuint> mNodeLevel;
+
+  // 文の位置をキーにしてその直後に置く文のリストを保持する配列
+  vector<vector<IrNode*> > mPostList;
+
+  // 強さの低減を行った積のリスト
+  vector<SrInfo> mSrList;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // IROPTIMIZER_H
@@ -0,0 +1,545 @@
+#ifndef IRSSA_H
+#define IRSSA_H
+
+/// @file IrSsa.h
+/// @brief IrSsa のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class IrSsa IrSsa.h "IrSsa.h"
+/// @brief IrCodeBlock のローカル変数を SSA 形式で表したもの
+///
+/// ノードリストをラベルとジャンプで基本ブロックに分け，
+/// ローカル変数への代入(kStore, kInplaceUniOp, kInplaceBinOp)ごとに
+/// 新しい値を割り当てる．複数の経路が合流するラベルには
+/// 支配辺境(dominance frontier)に従って phi を置く．
+///
+/// ノードリスト自体は書き換えずに，各ノードがどの値を読み書き
+/// するかを記録するだけなので，同じ変数の異なる値が同時に生きる
+/// ような変形をしない限り，そのまま元の変数に戻して使える．
+///
+/// ノードの番号(IrNode::id())は作り直すので，他の用途に使っている
+/// 番号は壊れる．また，一つのノードは一つの文からしか参照されて
+/// いないものとする．
+///
+/// 変数名を付け替える時にコピーをたどっておき，ロードごとに
+/// その位置で値の変わっていないコピー元の値を求めておく．
+/// これをコピー伝播に用いる．
+//////////////////////////////////////////////////////////////////////
+class IrSsa
+{
+public:
+
+  /// @brief 値がないことを表す番号
+  static
+  const ymuint kNoValue = static_cast<ymuint>(-1);
+
+  /// @brief 値の種類
+  enum ValueKind {
+    /// @brief 入り口での値
+    ///
+    /// 引数の値か VsmGen が初期化した値
+    kEntry,
+    /// @brief 合流点の phi
+    kPhi,
+    /// @brief 代入による値
+    kDef
+  };
+
+
+public:
+
+  /// @brief コンストラクタ
+  IrSsa();
+
+  /// @brief デストラクタ
+  ~IrSsa();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief コードブロックを SSA 形式にする．
+  /// @param[in] code_block 対象のコードブロック
+  /// @return ジャンプ先のラベルが見つからない場合には false を返す．
+  bool
+  build(const IrCodeBlock* code_block);
+
+  /// @brief ノード数を返す．
+  ymuint
+  node_num() const;
+
+  /// @brief ブロック数を返す．
+  ///
+  /// 0 番目は文を含まない入り口のブロック
+  ymuint
+  block_num() const;
+
+  /// @brief ブロックの先頭の文の位置を返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  ymuint
+  block_begin(ymuint block_id) const;
+
+  /// @brief ブロックの末尾の次の文の位置を返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  ymuint
+  block_end(ymuint block_id) const;
+
+  /// @brief 入り口から到達可能な時 true を返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  bool
+  block_reachable(ymuint block_id) const;
+
+  /// @brief 到達可能な前のブロックのリストを返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  const vector<ymuint>&
+  block_pred_list(ymuint block_id) const;
+
+  /// @brief 後のブロックのリストを返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  const vector<ymuint>&
+  block_succ_list(ymuint block_id) const;
+
+  /// @brief 直接支配するブロックを返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  ///
+  /// 入り口のブロックは自分自身を返す．
+  /// 到達不能なブロックでは kNoValue を返す．
+  ymuint
+  block_idom(ymuint block_id) const;
+
+  /// @brief 支配木の子供のブロックのリストを返す．
+  /// @param[in] block_id ブロック番号 ( 0 <= block_id < block_num() )
+  const vector<ymuint>&
+  block_child_list(ymuint block_id) const;
+
+  /// @brief ブロックが別のブロックを支配している時 true を返す．
+  /// @param[in] block_id1 支配する側のブロック番号
+  /// @param[in] block_id2 支配される側のブロック番号
+  ///
+  /// 自分自身は支配しているとみなす．
+  /// block_id2 は到達可能でなければならない．
+  bool
+  dominates(ymuint block_id1,
+	    ymuint block_id2) const;
+
+  /// @brief 値の数を返す．
+  ymuint
+  value_num() const;
+
+  /// @brief 値の種類を返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ValueKind
+  value_kind(ymuint val_id) const;
+
+  /// @brief 値の変数番号(ローカルインデックス)を返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ymuint
+  value_var(ymuint val_id) const;
+
+  /// @brief 値を定義しているノードを返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ///
+  /// kDef 以外では NULL を返す．
+  IrNode*
+  value_def(ymuint val_id) const;
+
+  /// @brief 値を定義しているブロックを返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ///
+  /// kEntry の場合は入り口のブロック(0)を返す．
+  ymuint
+  value_block(ymuint val_id) const;
+
+  /// @brief phi の入力のリストを返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ///
+  /// kPhi のみ意味を持つ．
+  const vector<ymuint>&
+  phi_input_list(ymuint val_id) const;
+
+  /// @brief コピー元の値を返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ///
+  /// 同じ型のローカル変数をそのまま代入したものでなければ
+  /// kNoValue を返す．
+  ymuint
+  copy_src(ymuint val_id) const;
+
+  /// @brief コピー元の定数のロードノードを返す．
+  /// @param[in] val_id 値の番号 ( 0 <= val_id < value_num() )
+  ///
+  /// 同じ型の定数をそのまま代入したものでなければ NULL を返す．
+  IrNode*
+  copy_const(ymuint val_id) const;
+
+  /// @brief ノードが読む値を返す．
+  /// @param[in] node 対象のノード
+  ///
+  /// ローカル変数の kLoad, kInplaceUniOp, kInplaceBinOp 以外と
+  /// 到達不能な文の中のノードでは kNoValue を返す．
+  ymuint
+  read_value(IrNode* node) const;
+
+  /// @brief ノードが定義する値を返す．
+  /// @param[in] node 対象のノード
+  ///
+  /// ローカル変数の kStore, kInplaceUniOp, kInplaceBinOp 以外と
+  /// 到達不能な文の中のノードでは kNoValue を返す．
+  ymuint
+  def_value(IrNode* node) const;
+
+  /// @brief ロードの位置で読み替えられるコピー元の値を返す．
+  /// @param[in] node 対象のノード
+  ///
+  /// read_value() からコピーをたどり，その位置で変数の値が
+  /// 変わっていないもののうち最も元のものを返す．
+  /// 見つからなければ read_value() と同じ値を返す．
+  ymuint
+  prop_value(IrNode* node) const;
+
+  /// @brief 子供のノードのリストを得る．
+  /// @param[in] node 対象のノード
+  /// @param[out] child_list 子供のノードを入れるリスト
+  ///
+  /// 配列参照などのハンドルの中の式も含める．
+  static
+  void
+  get_child_list(IrNode* node,
+		 vector<IrNode*>& child_list);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  // 基本ブロック
+  struct Block
+  {
+    // 先頭の文の位置
+    ymuint mBegin;
+
+    // 末尾の次の文の位置
+    ymuint mEnd;
+
+    // 到達可能な前のブロックのリスト
+    vector<ymuint> mPredList;
+
+    // 後のブロックのリスト
+    vector<ymuint> mSuccList;
+
+    // 逆後順での位置
+    // 到達不能な場合は kNoValue
+    ymuint mRpo;
+
+    // 直接支配するブロック
+    ymuint mIdom;
+
+    // 支配木の子供のリスト
+    vector<ymuint> mChildList;
+
+    // 支配辺境
+    vector<ymuint> mFrontier;
+
+    // phi のリスト
+    vector<ymuint> mPhiList;
+  };
+
+  // 値
+  struct Value
+  {
+    // 種類
+    ValueKind mKind;
+
+    // 変数番号
+    ymuint mVar;
+
+    // 定義しているノード
+    IrNode* mDef;
+
+    // 定義しているブロック
+    ymuint mBlock;
+
+    // phi の入力のリスト
+    vector<ymuint> mInputList;
+
+    // コピー元の値
+    ymuint mCopySrc;
+
+    // コピー元の定数
+    IrNode* mCopyConst;
+  };
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ノードに番号をつける．
+  /// @param[in] node ノード
+  void
+  reg_node(IrNode* node);
+
+  /// @brief 基本ブロックを作る．
+  /// @return ジャンプ先が見つからない場合には false を返す．
+  bool
+  make_blocks();
+
+  /// @brief 到達可能なブロックを逆後順に並べる．
+  /// @param[in] block_id ブロック番号
+  /// @param[out] post_list 後順のリスト
+  void
+  dfs_block(ymuint block_id,
+	    vector<ymuint>& post_list);
+
+  /// @brief 支配木と支配辺境を求める．
+  void
+  calc_dom();
+
+  /// @brief phi を置く．
+  void
+  place_phi();
+
+  /// @brief 変数名の付け替えを行う．
+  /// @param[in] block_id ブロック番号
+  void
+  rename_block(ymuint block_id);
+
+  /// @brief 式の中の読み出しを記録する．
+  /// @param[in] node ノード
+  void
+  rename_read(IrNode* node);
+
+  /// @brief 変数の定義を記録する．
+  /// @param[in] node 定義しているノード
+  /// @param[in] var 変数番号
+  /// @param[in] block_id 定義しているブロック番号
+  /// @param[out] push_list 値を積んだ変数のリスト
+  void
+  rename_def(IrNode* node,
+	     ymuint var,
+	     ymuint block_id,
+	     vector<ymuint>& push_list);
+
+  /// @brief 値を作る．
+  /// @param[in] kind 種類
+  /// @param[in] var 変数番号
+  /// @param[in] block_id 定義しているブロック番号
+  /// @param[in] def 定義しているノード
+  ymuint
+  new_value(ValueKind kind,
+	    ymuint var,
+	    ymuint block_id,
+	    IrNode* def = NULL);
+
+  /// @brief ローカル変数の読み書きの対象の変数番号を返す．
+  /// @param[in] node ノード
+  ///
+  /// ローカル変数でない場合には kNoValue を返す．
+  ymuint
+  local_var(IrNode* node) const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 対象のコードブロック
+  const IrCodeBlock* mCodeBlock;
+
+  // ノード番号をキーにしてノードを保持する配列
+  vector<IrNode*> mNodeList;
+
+  // ノード番号をキーにして読む値を保持する配列
+  vector<ymuint> mReadValue;
+
+  // ノード番号をキーにして定義する値を保持する配列
+  vector<ymuint> mDefValue;
+
+  // ノード番号をキーにしてコピー伝播後の値を保持する配列
+  vector<ymuint> mPropValue;
+
+  // ブロックのリスト
+  vector<Block> mBlockList;
+
+  // 値のリスト
+  vector<Value> mValueList;
+
+  // 変数ごとの現在の値のスタック
+  // rename_block() の中でのみ用いる．
+  vector<vector<ymuint> > mStackArray;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// インライン関数の定義
+//////////////////////////////////////////////////////////////////////
+
+// @brief ノード数を返す．
+inline
+ymuint
+IrSsa::node_num() const
+{
+  return mNodeList.size();
+}
+
+// @brief ブロック数を返す．
+inline
+ymuint
+IrSsa::block_num() const
+{
+  return mBlockList.size();
+}
+
+// @brief ブロックの先頭の文の位置を返す．
+inline
+ymuint
+IrSsa::block_begin(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mBegin;
+}
+
+// @brief ブロックの末尾の次の文の位置を返す．
+inline
+ymuint
+IrSsa::block_end(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mEnd;
+}
+
+// @brief 入り口から到達可能な時 true を返す．
+inline
+bool
+IrSsa::block_reachable(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mRpo != kNoValue;
+}
+
+// @brief 到達可能な前のブロックのリストを返す．
+inline
+const vector<ymuint>&
+IrSsa::block_pred_list(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mPredList;
+}
+
+// @brief 後のブロックのリストを返す．
+inline
+const vector<ymuint>&
+IrSsa::block_succ_list(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mSuccList;
+}
+
+// @brief 直接支配するブロックを返す．
+inline
+ymuint
+IrSsa::block_idom(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mIdom;
+}
+
+// @brief 支配木の子供のブロックのリストを返す．
+inline
+const vector<ymuint>&
+IrSsa::block_child_list(ymuint block_id) const
+{
+  ASSERT_COND( block_id < block_num() );
+  return mBlockList[block_id].mChildList;
+}
+
+// @brief 値の数を返す．
+inline
+ymuint
+IrSsa::value_num() const
+{
+  return mValueList.size();
+}
+
+// @brief 値の種類を返す．
+inline
+IrSsa::ValueKind
+IrSsa::value_kind(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mKind;
+}
+
+// @brief 値の変数番号(ローカルインデックス)を返す．
+inline
+ymuint
+IrSsa::value_var(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mVar;
+}
+
+// @brief 値を定義しているノードを返す．
+inline
+IrNode*
+IrSsa::value_def(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mDef;
+}
+
+// @brief 値を定義しているブロックを返す．
+inline
+ymuint
+IrSsa::value_block(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mBlock;
+}
+
+// @brief phi の入力のリストを返す．
+inline
+const vector<ymuint>&
+IrSsa::phi_input_list(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mInputList;
+}
+
+// @brief コピー元の値を返す．
+inline
+ymuint
+IrSsa::copy_src(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mCopySrc;
+}
+
+// @brief コピー元の定数のロードノードを返す．
+inline
+IrNode*
+IrSsa::copy_const(ymuint val_id) const
+{
+  ASSERT_COND( val_id < value_num() );
+  return mValueList[val_id].mCopyConst;
+}
+
+END_NAMESPACE_YM_YMSL
+
+#endif // IRSSA_H
@@ -0,0 +1,231 @@
+#ifndef MODULEREGISTRY_H
+#define MODULEREGISTRY_H
+
+/// @file ModuleRegistry.h
+/// @brief ModuleRegistry のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "TypeMgr.h"
+#include "VsmModule.h"
+#include "YmslMutex.h"
+#include "YmUtils/ShString.h"
+#include "YmUtils/HashMap.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class ModuleRegistry ModuleRegistry.h "ModuleRegistry.h"
+/// @brief コンパイル済みのモジュールをプロセス全体で共有するクラス
+///
+/// モジュールはソースファイルの正規化したパスと内容のハッシュ値を
+/// キーにして登録する．同じパスに内容の異なるモジュールが登録されたら
+/// 古い方は無効にする．
+/// 無効にしたモジュールを import していたモジュールも無効にする．
+///
+/// モジュールの型は共通の TypeMgr に登録されていなければならないので，
+/// YmslCompiler は全て type_mgr() を用いる．
+/// 登録されたモジュールはこのクラスが所有する．
+/// import しているモジュールの違いはキーに含まれないので，
+/// 引いた側で同じモジュールを import しているか確かめること．
+///
+/// モジュールごとに参照の数を数える．登録されている間はこのクラスが，
+/// find() と reg() が返したモジュールは呼び出し側が，import されている
+/// モジュールは import している側のモジュールがそれぞれ一つずつ参照を
+/// 持つ．無効にしたモジュールや登録できなかったモジュールは参照が
+/// なくなった時点で削除する．
+///
+/// 全ての関数は複数のスレッドから同時に呼び出してもよい．
+//////////////////////////////////////////////////////////////////////
+class ModuleRegistry
+{
+public:
+
+  /// @brief コンストラクタ
+  ModuleRegistry();
+
+  /// @brief デストラクタ
+  ///
+  /// 参照が残っているものも含めてモジュールを全て削除する．
+  ~ModuleRegistry();
+
+  /// @brief プロセス全体で共有するインスタンスを返す．
+  static
+  ModuleRegistry&
+  the_registry();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 型を管理するオブジェクトを返す．
+  TypeMgr&
+  type_mgr();
+
+  /// @brief モジュールを探す．
+  /// @param[in] path ソースファイルの正規化したパス
+  /// @param[in] hash ソースファイルの内容のハッシュ値
+  /// @return モジュールを返す．
+  ///
+  /// 登録されていないかハッシュ値が異なる場合は NULL を返す．
+  /// 見つかった場合は参照を一つ増やして返すので，
+  /// 使い終わったら release() を呼ぶこと．
+  VsmModule*
+  find(const string& path,
+       ymuint64 hash);
+
+  /// @brief モジュールを登録する．
+  /// @param[in] path ソースファイルの正規化したパス
+  /// @param[in] hash ソースファイルの内容のハッシュ値
+  /// @param[in] module モジュール
+  /// @return 登録されたモジュールを返す．
+  ///
+  /// 同じパスとハッシュ値のモジュールがすでに登録されていた場合は
+  /// module を削除してそちらを返す．
+  /// 別のスレッドが同じモジュールを同時にコンパイルした場合に起こる．
+  /// ただし import しているモジュールが異なる場合は登録せずに
+  /// module をそのまま返す．
+  /// どの場合も返したモジュールの参照を一つ呼び出し側に渡すので，
+  /// 使い終わったら release() を呼ぶこと．
+  VsmModule*
+  reg(const string& path,
+      ymuint64 hash,
+      VsmModule* module);
+
+  /// @brief モジュールを無効にする．
+  /// @param[in] path ソースファイルのパス
+  /// @return 無効にしたモジュールがあれば true を返す．
+  ///
+  /// path は正規化していなくてもよい．
+  /// path のモジュールを import しているモジュールも無効にする．
+  /// すでにそのモジュールを import した YmslCompiler には影響しない．
+  bool
+  invalidate(const string& path);
+
+  /// @brief 全てのモジュールを無効にする．
+  void
+  invalidate_all();
+
+  /// @brief モジュールの参照を一つ減らす．
+  /// @param[in] module モジュール
+  ///
+  /// 無効にしたモジュールや登録できなかったモジュールは
+  /// 参照がなくなった時点で削除する．
+  /// このクラスが扱っていないモジュールの場合は何もしない．
+  void
+  release(VsmModule* module);
+
+  /// @brief 削除されずに残っているモジュールの数を返す．
+  ///
+  /// 無効にしたものも参照が残っていれば数える．
+  ymuint
+  module_num();
+
+  /// @brief パスを正規化する．
+  /// @param[in] path パス
+  /// @param[out] canon_path 正規化したパス
+  /// @return ファイルが存在しない場合は false を返す．
+  static
+  bool
+  canonical_path(const string& path,
+		 string& canon_path);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 登録されたモジュールを表す構造体
+  struct Entry
+  {
+    // 正規化したパス
+    ShString mPath;
+
+    // ハッシュ値
+    ymuint64 mHash;
+
+    // モジュール
+    VsmModule* mModule;
+
+    // 参照の数
+    ymuint mRefCount;
+
+    // 登録されていて引ける時 true
+    bool mValid;
+  };
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 二つのモジュールが同じモジュールを import しているか調べる．
+  /// @param[in] module1, module2 対象のモジュール
+  static
+  bool
+  same_imports(const VsmModule* module1,
+	       const VsmModule* module2);
+
+  /// @brief エントリを追加する．
+  /// @param[in] path 正規化したパス
+  /// @param[in] hash ハッシュ値
+  /// @param[in] module モジュール
+  /// @param[in] valid 登録して引けるようにする時 true
+  ///
+  /// 呼び出し側の参照を一つ持たせる．
+  /// mMutex をロックした状態で呼ぶこと．
+  void
+  add_entry(ShString path,
+	    ymuint64 hash,
+	    VsmModule* module,
+	    bool valid);
+
+  /// @brief 登録を外す．
+  /// @param[in] entry 対象のエントリ
+  ///
+  /// entry のモジュールを import しているエントリも外す．
+  /// mMutex をロックした状態で呼ぶこと．
+  void
+  remove(Entry* entry);
+
+  /// @brief 参照のなくなったエントリを削除する．
+  ///
+  /// mMutex をロックした状態で呼ぶこと．
+  void
+  sweep();
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 型を管理するオブジェクト
+  TypeMgr mTypeMgr;
+
+  // 正規化したパスをキーにして登録されているエントリを保持するハッシュ表
+  HashMap<ShString, Entry*> mEntryDict;
+
+  // モジュールをキーにして全てのエントリを保持するハッシュ表
+  HashMap<VsmModule*, Entry*> mModuleDict;
+
+  // 無効にしたものも含めて削除されていないエントリのリスト
+  vector<Entry*> mEntryList;
+
+  // ロック
+  YmslMutex mMutex;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // MODULEREGISTRY_H
@@ -11,6 +11,7 @@
 
 #include "ymsl_int.h"
 #include "OpCode.h"
+#include "YmslMutex.h"
 #include "YmUtils/ShString.h"
 #include "YmUtils/HashMap.h"
 
@@ -24,6 +25,9 @@ BEGIN_NAMESPACE_YM_YMSL
 /// ここでは組み込み型と派生型の正規化を行う．
 /// 名前付きの型(enum と class)は名前空間で管理される．
 /// TypeMgr による正規化は行われない．
+///
+/// 型を作る関数は複数のスレッドから同時に呼び出してもよい．
+/// 一度作った型は変更しないので読み出しにロックは要らない．
 //////////////////////////////////////////////////////////////////////
 class TypeMgr
 {
@@ -211,6 +215,9 @@ private:
   // ハッシュ表に登録されている要素数
   ymuint mHashNum;
 
+  // 型の登録用のロック
+  YmslMutex mMutex;
+
 };
 
 END_NAMESPACE_YM_YMSL
@@ -19,6 +19,11 @@ BEGIN_NAMESPACE_YM_YMSL
 /// @brief Vsm の命令コード
 ///
 /// スタックマシンを模倣している．
+///
+/// VSM_LOCAL_INT_INC 以降は複数の命令を融合したもの(superinstruction)
+/// で VsmPeephole が生成する．VsmGen が直接生成することはない．
+/// 融合する命令列は Vsm_profile で数えた命令の組の実行回数をもとに
+/// 選んでいる．
 //////////////////////////////////////////////////////////////////////
 enum VsmOpcode {
   VSM_NOP,
@@ -28,6 +33,9 @@ enum VsmOpcode {
   VSM_PUSH_FLOAT_ZERO,
   VSM_PUSH_FLOAT_ONE,
   VSM_PUSH_OBJ_NULL,
+  VSM_PUSH_CONST,
+
+  VSM_POP,
 
   VSM_LOAD_GLOBAL_INT,
   VSM_LOAD_GLOBAL_FLOAT,
@@ -45,6 +53,16 @@ enum VsmOpcode {
   VSM_STORE_LOCAL_FLOAT,
   VSM_STORE_LOCAL_OBJ,
 
+  // LOAD_EXT_GLOBAL_XXX module index / STORE_EXT_GLOBAL_XXX module index
+  // import したモジュールのグローバル変数を読み書きする．
+  // module は import した順に 1 から振った番号
+  VSM_LOAD_EXT_GLOBAL_INT,
+  VSM_LOAD_EXT_GLOBAL_FLOAT,
+  VSM_LOAD_EXT_GLOBAL_OBJ,
+  VSM_STORE_EXT_GLOBAL_INT,
+  VSM_STORE_EXT_GLOBAL_FLOAT,
+  VSM_STORE_EXT_GLOBAL_OBJ,
+
   VSM_INT_MINUS,
   VSM_INT_INC,
   VSM_INT_DEC,
@@ -112,25 +130,218 @@ enum VsmOpcode {
   VSM_JUMP_R,
   VSM_BRANCH_TRUE,
   VSM_BRANCH_FALSE,
+  // JUMP_TABLE min table default
+  // 積まれた INT から min を引いた値で表を引いて飛ぶ．
+  // 表の範囲外なら default に飛ぶ．
+  VSM_JUMP_TABLE,
 
   VSM_CALL,
   VSM_CALL_R,
+  // CALL_EXT module index
+  // import したモジュールの関数を呼び出す．
+  VSM_CALL_EXT,
+  // CALL f; RETURN をフレームを再利用して行う．
+  VSM_TAIL_CALL,
   VSM_RETURN,
+  VSM_RETURN_VOID,
+
+  // LOAD_LOCAL_INT a; INT_INC; STORE_LOCAL_INT a
+  VSM_LOCAL_INT_INC,
+  // LOAD_LOCAL_INT a; INT_DEC; STORE_LOCAL_INT a
+  VSM_LOCAL_INT_DEC,
+  // PUSH_INT_IMM k; LOAD_LOCAL_INT a; INT_ADD; STORE_LOCAL_INT a
+  VSM_LOCAL_INT_ADD_IMM,
+  // PUSH_INT_IMM k; LOAD_LOCAL_INT a
+  VSM_PUSH_INT_IMM_LOAD_LOCAL_INT,
+  // INT_EQ; BRANCH_FALSE L など
+  VSM_INT_EQ_BRANCH_FALSE,
+  VSM_INT_NE_BRANCH_FALSE,
+  VSM_INT_LT_BRANCH_FALSE,
+  VSM_INT_LE_BRANCH_FALSE,
+  // LOAD_LOCAL_INT b; LOAD_LOCAL_INT a; INT_LT; BRANCH_FALSE L
+  VSM_LOCAL_INT_LT_BRANCH_FALSE,
+  // PUSH_INT_IMM k; LOAD_LOCAL_INT a; INT_LT; BRANCH_FALSE L
+  VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE,
 
   VSM_HALT
 };
 
 
+//////////////////////////////////////////////////////////////////////
+/// @brief レジスタ型の Vsm の命令コード
+///
+/// オペランドはフレーム内のスロット番号(ベースレジスタからの
+/// オフセット)で表す．命令語の後にオペランドが以下の順で続く．
+/// - VSM_REG_ENTER frame_size arg_num
+///   フレームを確保し，引数以外のスロットを 0 で初期化する．
+/// - VSM_REG_MOVE dst src
+/// - VSM_REG_INT_IMM dst val / VSM_REG_FLOAT_IMM dst val / VSM_REG_OBJ_NULL dst
+/// - VSM_REG_CONST dst index
+///   モジュールの定数表(VsmConstPool)の index 番目の値を dst に置く．
+/// - VSM_REG_LOAD_GLOBAL dst index / VSM_REG_STORE_GLOBAL index src
+/// - VSM_REG_LOAD_EXT_GLOBAL dst module index /
+///   VSM_REG_STORE_EXT_GLOBAL module index src
+///   module は import した順に 1 から振ったモジュールの番号
+/// - 単項演算 dst src
+/// - 二項演算 dst src1 src2 (dst = src1 op src2)
+/// - VSM_REG_ITE dst cond src1 src2
+/// - VSM_REG_JUMP addr
+/// - VSM_REG_BRANCH_TRUE cond addr / VSM_REG_BRANCH_FALSE cond addr
+/// - VSM_REG_JUMP_TABLE src min table default
+///   src - min で表(VsmCodeList::jump_table())を引いて飛ぶ．
+///   表の範囲外なら default に飛ぶ．
+/// - VSM_REG_CALL index arg_base
+///   arg_base から始まるスロットに引数を置いて呼び出す．
+///   返り値は arg_base に置かれる．
+/// - VSM_REG_CALL_EXT module index arg_base
+/// - VSM_REG_TAIL_CALL index arg_base
+///   引数をフレームの先頭に移して呼び出し，呼び出し元に戻る．
+///   レジスタ型の関数の場合はフレームを再利用する．
+/// - VSM_REG_RETURN src
+//////////////////////////////////////////////////////////////////////
+enum VsmRegOpcode {
+  VSM_REG_NOP,
+
+  VSM_REG_ENTER,
+
+  VSM_REG_MOVE,
+  VSM_REG_INT_IMM,
+  VSM_REG_FLOAT_IMM,
+  VSM_REG_OBJ_NULL,
+  VSM_REG_CONST,
+
+  VSM_REG_LOAD_GLOBAL,
+  VSM_REG_STORE_GLOBAL,
+  VSM_REG_LOAD_EXT_GLOBAL,
+  VSM_REG_STORE_EXT_GLOBAL,
+
+  VSM_REG_INT_MINUS,
+  VSM_REG_INT_INC,
+  VSM_REG_INT_DEC,
+  VSM_REG_INT_NOT,
+  VSM_REG_INT_LNOT,
+  VSM_REG_INT_TO_BOOL,
+  VSM_REG_INT_TO_FLOAT,
+
+  VSM_REG_INT_ADD,
+  VSM_REG_INT_SUB,
+  VSM_REG_INT_MUL,
+  VSM_REG_INT_DIV,
+  VSM_REG_INT_MOD,
+  VSM_REG_INT_LSHIFT,
+  VSM_REG_INT_RSHIFT,
+  VSM_REG_INT_EQ,
+  VSM_REG_INT_NE,
+  VSM_REG_INT_LT,
+  VSM_REG_INT_LE,
+  VSM_REG_INT_AND,
+  VSM_REG_INT_OR,
+  VSM_REG_INT_XOR,
+
+  VSM_REG_FLOAT_MINUS,
+  VSM_REG_FLOAT_TO_BOOL,
+  VSM_REG_FLOAT_TO_INT,
+
+  VSM_REG_FLOAT_ADD,
+  VSM_REG_FLOAT_SUB,
+  VSM_REG_FLOAT_MUL,
+  VSM_REG_FLOAT_DIV,
+  VSM_REG_FLOAT_EQ,
+  VSM_REG_FLOAT_NE,
+  VSM_REG_FLOAT_LT,
+  VSM_REG_FLOAT_LE,
+
+  VSM_REG_OBJ_MINUS,
+  VSM_REG_OBJ_INC,
+  VSM_REG_OBJ_DEC,
+  VSM_REG_OBJ_NOT,
+  VSM_REG_OBJ_TO_INT,
+  VSM_REG_OBJ_TO_FLOAT,
+
+  VSM_REG_OBJ_ADD,
+  VSM_REG_OBJ_SUB,
+  VSM_REG_OBJ_MUL,
+  VSM_REG_OBJ_DIV,
+  VSM_REG_OBJ_MOD,
+  VSM_REG_OBJ_LSHIFT,
+  VSM_REG_OBJ_RSHIFT,
+  VSM_REG_OBJ_EQ,
+  VSM_REG_OBJ_NE,
+  VSM_REG_OBJ_LT,
+  VSM_REG_OBJ_LE,
+  VSM_REG_OBJ_AND,
+  VSM_REG_OBJ_OR,
+  VSM_REG_OBJ_XOR,
+
+  VSM_REG_ITE,
+
+  VSM_REG_JUMP,
+  VSM_REG_BRANCH_TRUE,
+  VSM_REG_BRANCH_FALSE,
+  VSM_REG_JUMP_TABLE,
+
+  VSM_REG_CALL,
+  VSM_REG_CALL_EXT,
+  VSM_REG_TAIL_CALL,
+  VSM_REG_RETURN,
+  VSM_REG_RETURN_VOID,
+
+  VSM_REG_HALT
+};
+
+
+class VsmStack;
+
 //////////////////////////////////////////////////////////////////////
 /// @class Vsm Vsm.h "Vsm.h"
 /// @brief YMSL の VSM(Virtual Stack Machine)
+///
+/// ローカルスタックの容量は push のたびには調べない．
+/// 関数の呼び出し時に VsmGen が求めたフレームの大きさで
+/// 一度だけ調べる．それでもあふれた場合は VsmStack の
+/// ガードページで検出する．どちらの場合も execute_module() が
+/// false を返す．
+///
+/// 実行時のオブジェクトは VsmHeap が持ち，オブジェクトを作る命令の
+/// 直前(安全点)でごみ集めを行う．VsmValue は型の印を持たないので，
+/// 根は VsmGen がコードに付けたスタックマップとグローバル変数の型から
+/// 正確に求める．組み込み関数や JIT コンパイルした関数を呼んでいる
+/// 間も呼び出し元のフレームを呼び出しフレームのスタックに積んでおく．
+/// レジスタ型のコードも同じ命令と後ろ向きの VSM_REG_JUMP を安全点にし，
+/// VsmGen がスロットごとの格納クラスから求めたスタックマップを付ける．
+///
+/// VsmHeap は若い世代のオブジェクトを動かすので，根のスロットを
+/// 書き換える．グローバル変数はカードに分けて OBJ の値を書き込んだ
+/// カードに印をつけておき(書き込みバリア)，若い世代のごみ集めでは
+/// 印のあるカードの変数だけを根にする．ローカル変数はフレームごと
+/// 毎回スタックマップで調べるのでこのバリアは要らない．
+///
+/// 古い世代のごみ集めは VsmHeap::set_time_slice() を設定すると
+/// 少しずつ行う．後ろ向きの VSM_JUMP も安全点にして，ループの中でも
+/// 印つけと解放を進める．印つけの途中では変数に書き込む OBJ の値に
+/// 印をつけておき(書き込みバリア)，最後に根を調べ直す時の手間を減らす．
+///
+/// 関数テーブルとグローバル変数領域はモジュールごとに持つ．
+/// execute_module() で import しているモジュールを全てたどって
+/// それぞれの領域とモジュール番号からそれを引く表(リンク表)を作り，
+/// import されている側から順にトップレベルのコードを一度ずつ実行する．
+/// 同じモジュールを複数のモジュールが import している場合も領域は
+/// 一つだけ作る．他のモジュールの関数を呼ぶ時には実行中のモジュールを
+/// 切り替えて，戻る時に呼び出しフレームに保存したものに戻す．
 //////////////////////////////////////////////////////////////////////
 class Vsm
 {
+  friend class VsmJit;
+
 public:
 
   /// @brief コンストラクタ
-  Vsm();
+  /// @param[in] local_stack_size ローカルスタックのサイズ
+  /// @param[in] max_stack_size ローカルスタックを伸長する場合の最大サイズ
+  ///
+  /// max_stack_size が local_stack_size 以下の場合は伸長しない．
+  Vsm(Ymsl_INT local_stack_size = 64 * 1024,
+      Ymsl_INT max_stack_size = 0);
 
   /// @brief デストラクタ
   ~Vsm();
@@ -148,6 +359,66 @@ public:
   execute(const VsmCodeList& code_list,
 	  Ymsl_INT base);
 
+  /// @brief レジスタ型のバイトコードを実行する．
+  /// @param[in] code_list コードの配列
+  /// @param[in] base ベースレジスタ
+  ///
+  /// レジスタ型の関数の呼び出しは呼び出しフレームを積んで
+  /// 同じ命令ループの中で実行する．
+  void
+  execute_reg(const VsmRegCodeList& code_list,
+	      Ymsl_INT base);
+
+  /// @brief モジュールを実行する．
+  /// @param[in] module 対象のモジュール
+  ///
+  /// @return スタックオーバーフローが起きたら false を返す．
+  ///
+  /// モジュールの関数テーブルとグローバル変数領域を設定して
+  /// トップレベルのコードを実行する．
+  bool
+  execute_module(const VsmModule& module);
+
+  /// @brief JIT コンパイルを行う呼び出し回数のしきい値を設定する．
+  /// @param[in] threshold しきい値
+  ///
+  /// 0 の場合には JIT コンパイルを行わない．
+  void
+  set_jit_threshold(ymuint threshold);
+
+  /// @brief JIT コンパイルを行う呼び出し回数のしきい値を返す．
+  ymuint
+  jit_threshold() const;
+
+  /// @brief フレームの領域を確保する．
+  /// @param[in] base ベースレジスタ
+  /// @param[in] size フレームの大きさ
+  ///
+  /// 足りない場合はスタックを伸長する．伸長できない場合は
+  /// スタックオーバーフローとして execute_module() から抜ける．
+  void
+  reserve_frame(Ymsl_INT base,
+		Ymsl_INT size);
+
+  /// @brief C++ のスタックの残りが少ない時 true を返す．
+  ///
+  /// execute_module() の呼び出し時点から決まった量を使ったら
+  /// true になる．この間は JIT コンパイルしたコードを呼ばずに
+  /// 命令ループの中で実行する．
+  bool
+  native_stack_low() const;
+
+  /// @brief 実行時のオブジェクトを管理するオブジェクトを返す．
+  ///
+  /// 呼び出し側で引数などに用いるオブジェクトを作る時にも用いる．
+  VsmHeap&
+  heap();
+
+  /// @brief グローバル変数の内容を読む．
+  /// @param[in] index インデックス
+  VsmValue
+  read_global(Ymsl_INT index);
+
   /// @brief スタックの内容を読む
   /// @param[in] index インデックス
   VsmValue
@@ -160,12 +431,296 @@ public:
   write_stack(Ymsl_INT index,
 	      VsmValue val);
 
+  /// @brief 命令のオペランドの形式を返す．
+  /// @param[in] op 命令
+  ///
+  /// 'i' が INT，'a' がジャンプ先のアドレス，'f' が FLOAT，
+  /// 't' がジャンプテーブルの番号を表す文字をオペランドの順に
+  /// 並べた文字列を返す．
+  /// VsmCodeList がコードを詰める時に用いる．
+  static
+  const char*
+  operand_format(Ymsl_CODE op);
+
+  /// @brief レジスタ型の命令のオペランドの形式を返す．
+  /// @param[in] op 命令
+  ///
+  /// 形式は operand_format() と同じ
+  static
+  const char*
+  reg_operand_format(Ymsl_CODE op);
+
+  /// @brief 命令のオペランドの語数を返す．
+  /// @param[in] op 命令
+  ///
+  /// VsmCodeList::Builder 上での語数を返す．
+  /// 命令自身の1語は含まない．
+  static
+  ymuint
+  operand_size(Ymsl_CODE op);
+
+  /// @brief レジスタ型の命令のオペランドの語数を返す．
+  /// @param[in] op 命令
+  ///
+  /// VsmCodeList::Builder 上での語数を返す．
+  /// 命令自身の1語は含まない．
+  static
+  ymuint
+  reg_operand_size(Ymsl_CODE op);
+
+  /// @brief 命令の名前を返す．
+  /// @param[in] op 命令
+  static
+  const char*
+  opcode_name(Ymsl_CODE op);
+
+  /// @brief 連続して実行された命令の組の回数を出力する．
+  /// @param[in] s 出力先のストリーム
+  /// @param[in] num 出力する組の数
+  ///
+  /// 回数の多い順に出力する．
+  /// YMSL_VSM_PROFILE を定義してコンパイルした時のみ意味を持つ．
+  static
+  void
+  print_profile(ostream& s,
+		ymuint num);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  // モジュールごとの実行時の状態
+  struct ModuleState
+  {
+    // モジュール
+    const VsmModule* mModule;
+
+    // 関数テーブルのサイズ
+    Ymsl_INT mFuncTableSize;
+
+    // 関数テーブル
+    VsmFunction** mFuncTable;
+
+    // グローバル変数領域のサイズ
+    Ymsl_INT mGlobalHeapSize;
+
+    // グローバル変数領域
+    VsmValue* mGlobalHeap;
+
+    // グローバル変数領域のうち OBJ の値を持つものの番号のリスト
+    vector<Ymsl_INT> mGlobalObjList;
+
+    // グローバル変数のカードの印
+    // 番号を kGlobalCardShift だけ右にずらしたものがカードの番号
+    // 前回の若い世代のごみ集めの後に書き込んだカードが 1 になる．
+    vector<ymuint8> mGlobalCard;
+
+    // 定数表の値の配列
+    const VsmValue* mConstTable;
+
+    // リンク表
+    // モジュール番号をインデックスにしてモジュールの状態を引く．
+    // 0 番目は自分自身
+    vector<ModuleState*> mLinkTable;
+  };
+
+  // 呼び出しフレーム
+  // 呼び出し元の状態を保存する．
+  struct Frame
+  {
+    // コード
+    const VsmCodeList* mCodeList;
+
+    // 戻り先の命令位置
+    // 呼び出し命令の直後なのでスタックマップもこれで引ける．
+    Ymsl_INT mPC;
+
+    // ベースレジスタ
+    Ymsl_INT mBase;
+
+    // 関数
+    // トップレベルの場合は NULL
+    const VsmFunction* mFunc;
+
+    // 呼び出し元のモジュールの状態
+    ModuleState* mModule;
+
+    // 呼び出し元の SP
+    // レジスタ型のフレームの場合のみ用いる．
+    Ymsl_INT mSP;
+  };
+
 
 private:
   //////////////////////////////////////////////////////////////////////
   // 内部で用いられる関数
   //////////////////////////////////////////////////////////////////////
 
+  /// @brief 関数を呼び出す．
+  /// @param[in] index 関数番号
+  ///
+  /// 呼ばれた関数は別の execute() で実行される．
+  void
+  call_func(Ymsl_INT index);
+
+  /// @brief スタックを伸長する．
+  /// @param[in] size 必要な要素数
+  ///
+  /// 伸長できない場合は execute_module() から抜ける．
+  void
+  grow_stack(Ymsl_INT size);
+
+  /// @brief モジュールの状態を作る．
+  /// @param[in] module モジュール
+  /// @return モジュールの状態を返す．
+  ///
+  /// import しているモジュールの状態も作ってリンク表に設定する．
+  /// すでに作ってある場合はそれを返す．
+  ModuleState*
+  link_module(const VsmModule* module);
+
+  /// @brief モジュールの状態を全て削除する．
+  void
+  clear_modules();
+
+  /// @brief 実行中のモジュールを切り替える．
+  /// @param[in] module モジュールの状態
+  void
+  set_module(ModuleState* module);
+
+  /// @brief 全てのモジュールのトップレベルのコードを実行する．
+  /// @param[in] arg Vsm へのポインタ
+  ///
+  /// VsmStack::run() に渡す．
+  static
+  void
+  execute_toplevel(void* arg);
+
+  /// @brief 安全点でごみ集めが必要なら行う．
+  /// @param[in] code 実行中のコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base ベースレジスタ
+  ///
+  /// オペランドを取り除く前に呼ぶ．
+  void
+  safepoint(const VsmCodeList* code,
+	    Ymsl_INT pc,
+	    Ymsl_INT base);
+
+  /// @brief ごみ集めを行う．
+  /// @param[in] code 実行中のコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base ベースレジスタ
+  void
+  collect(const VsmCodeList* code,
+	  Ymsl_INT pc,
+	  Ymsl_INT base);
+
+  /// @brief 若い世代のごみ集めを行う．
+  /// @param[in] code 実行中のコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base ベースレジスタ
+  void
+  minor_collect(const VsmCodeList* code,
+		Ymsl_INT pc,
+		Ymsl_INT base);
+
+  /// @brief 根のスロットが指すオブジェクトに印をつける．
+  /// @param[in] code 実行中のコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base ベースレジスタ
+  void
+  mark_roots(const VsmCodeList* code,
+	     Ymsl_INT pc,
+	     Ymsl_INT base);
+
+  /// @brief フレームのスタックマップが示すスロットを VsmHeap::forward() に渡す．
+  /// @param[in] code フレームのコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base フレームのベースレジスタ
+  void
+  forward_frame(const VsmCodeList* code,
+		Ymsl_INT pc,
+		Ymsl_INT base);
+
+  /// @brief フレームのスタックマップが示すオブジェクトに印をつける．
+  /// @param[in] code フレームのコード
+  /// @param[in] pc 安全点の命令の直後のアドレス
+  /// @param[in] base フレームのベースレジスタ
+  void
+  mark_frame(const VsmCodeList* code,
+	     Ymsl_INT pc,
+	     Ymsl_INT base);
+
+  /// @brief オブジェクトの加算を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 文字列と配列は連結，集合は和集合，連想配列は併合する．
+  /// 演算できない場合は NULL を返す．以下の obj_XXX() も同様
+  Ymsl_OBJPTR
+  obj_add(Ymsl_OBJPTR val1,
+	  Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの減算を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 集合は差集合，連想配列は val2 のキーを取り除いたものを作る．
+  Ymsl_OBJPTR
+  obj_sub(Ymsl_OBJPTR val1,
+	  Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの論理積を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 集合は共通部分，連想配列は val2 にもあるキーを残したものを作る．
+  Ymsl_OBJPTR
+  obj_and(Ymsl_OBJPTR val1,
+	  Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの論理和を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 集合は和集合，連想配列は併合したものを作る．
+  Ymsl_OBJPTR
+  obj_or(Ymsl_OBJPTR val1,
+	 Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの排他的論理和を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 集合の対称差を作る．
+  Ymsl_OBJPTR
+  obj_xor(Ymsl_OBJPTR val1,
+	  Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの小なり比較を行う．
+  /// @param[in] val1, val2 オペランド
+  ///
+  /// 文字列と数値の配列は辞書順，集合は真部分集合かどうかで比べる．
+  Ymsl_INT
+  obj_lt(Ymsl_OBJPTR val1,
+	 Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトの小なりイコール比較を行う．
+  /// @param[in] val1, val2 オペランド
+  Ymsl_INT
+  obj_le(Ymsl_OBJPTR val1,
+	 Ymsl_OBJPTR val2);
+
+  /// @brief オブジェクトを INT に変換する．
+  /// @param[in] val オペランド
+  ///
+  /// 文字列は数値として読んだ値，それ以外は要素数を返す．
+  Ymsl_INT
+  obj_to_int(Ymsl_OBJPTR val);
+
+  /// @brief オブジェクトを FLOAT に変換する．
+  /// @param[in] val オペランド
+  Ymsl_FLOAT
+  obj_to_float(Ymsl_OBJPTR val);
+
   /// @brief INT をプッシュする．
   void
   push_INT(Ymsl_INT val);
@@ -268,6 +823,15 @@ private:
   // データメンバ
   //////////////////////////////////////////////////////////////////////
 
+  // 実行中のモジュールとそれが直接，間接に import している
+  // モジュールの状態のリスト
+  // import されている側が先になるように並べる．末尾が実行中のモジュール
+  vector<ModuleState*> mModuleList;
+
+  // 実行中の関数のモジュールの状態
+  // 以下の mFuncTableSize から mConstTable まではこの内容の写し
+  ModuleState* mCurModule;
+
   // 関数テーブルのサイズ
   Ymsl_INT mFuncTableSize;
 
@@ -280,15 +844,45 @@ private:
   // グローバル変数領域
   VsmValue* mGlobalHeap;
 
-  // ローカルスタックのサイズ
-  Ymsl_INT mLocalStackSize;
+  // グローバル変数のカードの印
+  ymuint8* mGlobalCard;
+
+  // グローバル変数のカードの大きさ(2 の対数)
+  static
+  const Ymsl_INT kGlobalCardShift = 4;
+
+  // 定数表の値の配列
+  // VSM_PUSH_CONST/VSM_REG_CONST が参照する．
+  const VsmValue* mConstTable;
+
+  // ローカルスタックの領域
+  VsmStack* mStack;
 
   // ローカルスタック
+  // mStack->body() と同じ
   VsmValue* mLocalStack;
 
+  // 最後に調べた時のローカルスタックの要素数
+  // ガードページで伸長した分は含まれないことがある．
+  Ymsl_INT mLocalStackSize;
+
+  // C++ のスタックポインタがこれを下回ったら
+  // JIT コンパイルしたコードを呼ばない．
+  // 0 の時は調べない．
+  ympuint mNativeStackLimit;
+
   // スタックポインタ
   Ymsl_INT mSP;
 
+  // 呼び出しフレームのスタック
+  vector<Frame> mFrameStack;
+
+  // 実行時のオブジェクトを管理するオブジェクト
+  VsmHeap* mHeap;
+
+  // JIT コンパイルを行う呼び出し回数のしきい値
+  ymuint mJitThreshold;
+
 };
 
 
@@ -296,6 +890,77 @@ private:
 // インライン関数の定義
 //////////////////////////////////////////////////////////////////////
 
+// @brief JIT コンパイルを行う呼び出し回数のしきい値を設定する．
+// @param[in] threshold しきい値
+inline
+void
+Vsm::set_jit_threshold(ymuint threshold)
+{
+  mJitThreshold = threshold;
+}
+
+// @brief JIT コンパイルを行う呼び出し回数のしきい値を返す．
+inline
+ymuint
+Vsm::jit_threshold() const
+{
+  return mJitThreshold;
+}
+
+// @brief フレームの領域を確保する．
+// @param[in] base ベースレジスタ
+// @param[in] size フレームの大きさ
+inline
+void
+Vsm::reserve_frame(Ymsl_INT base,
+		   Ymsl_INT size)
+{
+  if ( base + size > mLocalStackSize ) {
+    grow_stack(base + size);
+  }
+}
+
+// @brief 実行中のモジュールを切り替える．
+// @param[in] module モジュールの状態
+inline
+void
+Vsm::set_module(ModuleState* module)
+{
+  mCurModule = module;
+  mFuncTableSize = module->mFuncTableSize;
+  mFuncTable = module->mFuncTable;
+  mGlobalHeapSize = module->mGlobalHeapSize;
+  mGlobalHeap = module->mGlobalHeap;
+  mGlobalCard = &module->mGlobalCard[0];
+  mConstTable = module->mConstTable;
+}
+
+// @brief C++ のスタックの残りが少ない時 true を返す．
+inline
+bool
+Vsm::native_stack_low() const
+{
+  char mark;
+  return reinterpret_cast<ympuint>(&mark) < mNativeStackLimit;
+}
+
+// @brief 実行時のオブジェクトを管理するオブジェクトを返す．
+inline
+VsmHeap&
+Vsm::heap()
+{
+  return *mHeap;
+}
+
+// @brief グローバル変数の内容を読む．
+// @param[in] index インデックス
+inline
+VsmValue
+Vsm::read_global(Ymsl_INT index)
+{
+  return mGlobalHeap[index];
+}
+
 // @brief スタックの内容を読む
 // @param[in] index インデックス
 inline
@@ -428,6 +1093,7 @@ Vsm::store_global_OBJPTR(Ymsl_INT index,
 			 Ymsl_OBJPTR val)
 {
   mGlobalHeap[index].obj_value = val;
+  mGlobalCard[index >> kGlobalCardShift] = 1;
 }
 
 // @brief ローカル変数の INT の値を取り出す．
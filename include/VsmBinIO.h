@@ -0,0 +1,181 @@
+#ifndef VSMBINIO_H
+#define VSMBINIO_H
+
+/// @file VsmBinIO.h
+/// @brief VsmBinWriter, VsmBinReader のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "YmUtils/ShString.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmBinWriter VsmBinIO.h "VsmBinIO.h"
+/// @brief コンパイル済みのモジュールをバイナリ形式で書き出すクラス
+///
+/// 内容はメモリ上のバッファに溜めておき，VsmModuleFile が
+/// ヘッダをつけてファイルに書く．
+/// 数値はホストのバイト順のまま書く．
+//////////////////////////////////////////////////////////////////////
+class VsmBinWriter
+{
+public:
+
+  /// @brief コンストラクタ
+  VsmBinWriter();
+
+  /// @brief デストラクタ
+  ~VsmBinWriter();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 8ビットの値を書く．
+  /// @param[in] val 値
+  void
+  write_8(ymuint8 val);
+
+  /// @brief 32ビットの値を書く．
+  /// @param[in] val 値
+  void
+  write_32(ymuint32 val);
+
+  /// @brief 64ビットの値を書く．
+  /// @param[in] val 値
+  void
+  write_64(ymuint64 val);
+
+  /// @brief FLOAT の値を書く．
+  /// @param[in] val 値
+  void
+  write_float(Ymsl_FLOAT val);
+
+  /// @brief 文字列を書く．
+  /// @param[in] str 文字列
+  ///
+  /// 長さ(32ビット)に続けて末尾の '\0' を除いた文字を書く．
+  /// ShString を作らずに済むように const char* で受け取る．
+  void
+  write_str(const char* str);
+
+  /// @brief バイト列を書く．
+  /// @param[in] data 先頭のアドレス
+  /// @param[in] size バイト数
+  void
+  write_block(const void* data,
+	      ymuint64 size);
+
+  /// @brief 書き込んだ内容を返す．
+  const vector<ymuint8>&
+  data() const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 書き込んだ内容
+  vector<ymuint8> mData;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmBinReader VsmBinIO.h "VsmBinIO.h"
+/// @brief VsmBinWriter で書き出した内容を読むクラス
+///
+/// mmap() したファイルの領域をそのまま読む．
+/// 領域の末尾を越えて読もうとした場合には 0 を返して error() を
+/// true にするので，呼び出し側は最後に一度だけ調べればよい．
+//////////////////////////////////////////////////////////////////////
+class VsmBinReader
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] data 先頭のアドレス
+  /// @param[in] size バイト数
+  VsmBinReader(const ymuint8* data,
+	       ymuint64 size);
+
+  /// @brief デストラクタ
+  ~VsmBinReader();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 8ビットの値を読む．
+  ymuint8
+  read_8();
+
+  /// @brief 32ビットの値を読む．
+  ymuint32
+  read_32();
+
+  /// @brief 64ビットの値を読む．
+  ymuint64
+  read_64();
+
+  /// @brief FLOAT の値を読む．
+  Ymsl_FLOAT
+  read_float();
+
+  /// @brief 文字列を読む．
+  ShString
+  read_str();
+
+  /// @brief バイト列を読む．
+  /// @param[in] size バイト数
+  /// @return 先頭のアドレスを返す．
+  ///
+  /// 足りない場合は NULL を返す．
+  const ymuint8*
+  read_block(ymuint64 size);
+
+  /// @brief 読み残したバイト数を返す．
+  ymuint64
+  remain() const;
+
+  /// @brief 末尾を越えて読もうとした時 true を返す．
+  bool
+  error() const;
+
+  /// @brief エラーフラグを立てる．
+  ///
+  /// 読み込んだ値が不正だった場合に呼び出し側で用いる．
+  void
+  set_error();
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 次に読む位置
+  const ymuint8* mCur;
+
+  // 末尾の次の位置
+  const ymuint8* mEnd;
+
+  // エラーフラグ
+  bool mError;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMBINIO_H
@@ -25,6 +25,41 @@ BEGIN_NAMESPACE_YM_YMSL
 /// VsmCodeList のコンストラクタの引数として渡す．
 /// なので VsmCodeList は const の読み出し専用関数
 /// しか持たない．
+///
+/// VsmCodeList が持つのは実行用の形だけで，命令もオペランドも
+/// 1語(Ymsl_CODE)ずつ並べたもの．read_opcode()，read_int() などは
+/// これを読む．アドレスもこの形の上の語単位のアドレスである．
+/// Builder との違いは FLOAT のオペランドが定数表の番号の1語に
+/// なることだけ．
+///
+/// 保存用の形は dump() がその都度作って書き出すバイト列で，
+/// - 命令は1バイト
+/// - INT のオペランドは -126 〜 127 なら符号付きの1バイト．
+///   それ以外は kInt16 か kInt32 の1バイトに続けて
+///   16ビットか32ビットの値(リトルエンディアン)
+/// - ジャンプ先のアドレスは詰めた後のバイト単位のアドレスに
+///   置き換えてから INT と同様に書く．
+/// - FLOAT のオペランドは定数表の番号を INT と同様に書く．
+/// - ジャンプテーブルの番号は INT と同様に書く．
+/// という形に詰めたもの．ジャンプテーブルとスタックマップの
+/// アドレスもバイト単位のアドレスで書く．
+/// 読み込む時のコンストラクタはこの形から実行用の形を作り，
+/// バイト列は持ち続けない．実行中に可変長のオペランドを解釈する
+/// ことはない．
+///
+/// ジャンプテーブルはコードの外に表として持ち，命令にはその番号を書く．
+/// スタックマップもコードの外に表として持ち，アドレスの順に並べて
+/// 二分探索で引く．
+///
+/// スタックマップはごみ集めの安全点になる命令ごとに，その命令を
+/// 実行する直前にフレーム上で OBJ の値を持つスロットの番号(ベース
+/// レジスタからの位置)を並べたもの．安全点の命令の直後のアドレスで
+/// 引く．実行中の命令位置も呼び出しフレームに保存した戻り先も
+/// そのアドレスになっているので，そのまま引ける．
+/// オペランドの種類は命令ごとのオペランドの形式を表す文字列
+/// (Vsm::operand_format() を参照)で決まる．
+/// FLOAT の語数が変わるので実行用の形のアドレスも Builder の
+/// アドレスとは異なる．
 //////////////////////////////////////////////////////////////////////
 class VsmCodeList
 {
@@ -62,10 +97,31 @@ public:
     void
     write_float(Ymsl_FLOAT val);
 
-    /// @brief OBJPTR を追加する．
+    /// @brief 書き込み済みの INT を書き換える．
+    /// @param[in] addr アドレス
     /// @param[in] val 値
+    ///
+    /// ジャンプ先アドレスのバックパッチ用
+    void
+    rewrite_int(Ymsl_INT addr,
+		Ymsl_INT val);
+
+    /// @brief ジャンプテーブルを追加する．
+    /// @param[in] size 要素数
+    /// @return ジャンプテーブルの番号を返す．
+    ///
+    /// 中身は rewrite_jump_table() で設定する．
+    Ymsl_INT
+    add_jump_table(ymuint size);
+
+    /// @brief ジャンプテーブルの要素を書き換える．
+    /// @param[in] index ジャンプテーブルの番号
+    /// @param[in] pos 位置
+    /// @param[in] addr ジャンプ先のアドレス
     void
-    write_objptr(Ymsl_OBJPTR val);
+    rewrite_jump_table(Ymsl_INT index,
+		       ymuint pos,
+		       Ymsl_INT addr);
 
     /// @brief サイズを得る．
     Ymsl_INT
@@ -77,6 +133,50 @@ public:
     Ymsl_CODE
     read_opcode(Ymsl_INT addr) const;
 
+    /// @brief INT を読みだす．
+    /// @param[in] addr アドレス
+    /// @return 読みだした値を返す．
+    Ymsl_INT
+    read_int(Ymsl_INT addr) const;
+
+    /// @brief FLOAT を読みだす．
+    /// @param[in] addr アドレス
+    /// @return 読みだした値を返す．
+    Ymsl_FLOAT
+    read_float(Ymsl_INT addr) const;
+
+    /// @brief ジャンプテーブルの数を得る．
+    ymuint
+    jump_table_num() const;
+
+    /// @brief ジャンプテーブルを得る．
+    /// @param[in] index ジャンプテーブルの番号
+    const vector<Ymsl_INT>&
+    jump_table(Ymsl_INT index) const;
+
+    /// @brief スタックマップを追加する．
+    /// @param[in] addr 安全点の命令の直後のアドレス
+    /// @param[in] slot_list OBJ の値を持つスロットの番号のリスト
+    ///
+    /// addr の昇順に追加しなければならない．
+    void
+    add_stack_map(Ymsl_INT addr,
+		  const vector<Ymsl_INT>& slot_list);
+
+    /// @brief スタックマップの数を得る．
+    ymuint
+    stack_map_num() const;
+
+    /// @brief スタックマップのアドレスを得る．
+    /// @param[in] pos 位置 ( 0 <= pos < stack_map_num() )
+    Ymsl_INT
+    stack_map_addr(ymuint pos) const;
+
+    /// @brief スタックマップのスロットの番号のリストを得る．
+    /// @param[in] pos 位置 ( 0 <= pos < stack_map_num() )
+    const vector<Ymsl_INT>&
+    stack_map_slot_list(ymuint pos) const;
+
 
   private:
     //////////////////////////////////////////////////////////////////////
@@ -86,28 +186,83 @@ public:
     // コード
     vector<Ymsl_CODE> mBody;
 
+    // ジャンプテーブルのリスト
+    // 要素は Builder 上のアドレス
+    vector<vector<Ymsl_INT> > mJumpTableList;
+
+    // スタックマップのリスト
+    // (Builder 上のアドレス, スロットの番号のリスト) のペア
+    vector<pair<Ymsl_INT, vector<Ymsl_INT> > > mStackMapList;
+
   };
 
 
+  /// @brief 16ビットの INT が続くことを表す値
+  static
+  const ymint8 kInt16 = -128;
+
+  /// @brief 32ビットの INT が続くことを表す値
+  static
+  const ymint8 kInt32 = -127;
+
+  /// @brief 命令のオペランドの形式を返す関数の型
+  ///
+  /// 'i' が INT，'a' がジャンプ先のアドレス，'f' が FLOAT，
+  /// 't' がジャンプテーブルの番号を表す文字をオペランドの順に
+  /// 並べた文字列を返す．
+  typedef const char* (*FormatFunc)(Ymsl_CODE op);
+
+
 public:
 
   /// @brief コンストラクタ
   /// @param[in] builder 初期化用オブジェクト
+  ///
+  /// オペランドの形式は Vsm::operand_format() で決める．
   VsmCodeList(const Builder& builder);
 
+  /// @brief dump() で書き出した内容を読み込むコンストラクタ
+  /// @param[in] reader 読み込み用のオブジェクト
+  ///
+  /// オペランドの形式は Vsm::operand_format() で決める．
+  /// 読み込みに失敗した場合は reader.error() が true になる．
+  /// その場合でも空のオブジェクトとして破棄できる．
+  VsmCodeList(VsmBinReader& reader);
+
   /// @brief デストラクタ
   ~VsmCodeList();
 
 
+protected:
+
+  /// @brief オペランドの形式を指定したコンストラクタ
+  /// @param[in] builder 初期化用オブジェクト
+  /// @param[in] format_func オペランドの形式を返す関数
+  VsmCodeList(const Builder& builder,
+	      FormatFunc format_func);
+
+
 public:
   //////////////////////////////////////////////////////////////////////
   // 外部インターフェイス
   //////////////////////////////////////////////////////////////////////
 
   /// @brief サイズを得る．
+  ///
+  /// 実行用の形の語数を返す．
   Ymsl_INT
   size() const;
 
+  /// @brief 保存用の形のバイト数を得る．
+  ///
+  /// dump() で書き出すバイト列の大きさを返す．
+  Ymsl_INT
+  byte_size() const;
+
+  /// @brief 定数表の FLOAT の数を得る．
+  Ymsl_INT
+  float_num() const;
+
   /// @brief 命令を読みだす．
   /// @param[inout] addr アドレス
   /// @return 読みだした値を返す．
@@ -132,13 +287,97 @@ public:
   Ymsl_FLOAT
   read_float(Ymsl_INT& addr) const;
 
-  /// @brief OBJPTR を読みだす．
-  /// @param[inout] addr アドレス
-  /// @return 読みだした値を返す．
+  /// @brief ジャンプテーブルを得る．
+  /// @param[in] index ジャンプテーブルの番号
+  /// @return 先頭の要素を指すポインタを返す．
   ///
-  /// addr は読み込んだ分進む
-  Ymsl_OBJPTR
-  read_objptr(Ymsl_INT& addr) const;
+  /// 要素はジャンプ先のアドレス
+  const Ymsl_INT*
+  jump_table(Ymsl_INT index) const;
+
+  /// @brief ジャンプテーブルの要素数を得る．
+  /// @param[in] index ジャンプテーブルの番号
+  Ymsl_INT
+  jump_table_size(Ymsl_INT index) const;
+
+  /// @brief スタックマップを探す．
+  /// @param[in] addr 安全点の命令の直後のアドレス
+  /// @return スタックマップの番号を返す．
+  ///
+  /// 見つからない場合は -1 を返す．
+  Ymsl_INT
+  find_stack_map(Ymsl_INT addr) const;
+
+  /// @brief スタックマップを得る．
+  /// @param[in] index スタックマップの番号
+  /// @return 先頭の要素を指すポインタを返す．
+  ///
+  /// 要素は OBJ の値を持つスロットの番号
+  const Ymsl_INT*
+  stack_map(Ymsl_INT index) const;
+
+  /// @brief スタックマップの要素数を得る．
+  /// @param[in] index スタックマップの番号
+  Ymsl_INT
+  stack_map_size(Ymsl_INT index) const;
+
+  /// @brief 命令のオペランドを読み飛ばす．
+  /// @param[in] op 命令
+  /// @param[inout] addr オペランドの先頭のアドレス
+  ///
+  /// addr は読み飛ばした分進む
+  void
+  skip_operands(Ymsl_CODE op,
+		Ymsl_INT& addr) const;
+
+  /// @brief 内容をバイナリ形式で書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  ///
+  /// 実行用の形を詰めた保存用の形のバイト列と定数表，ジャンプテーブル，
+  /// スタックマップを書く．
+  void
+  dump(VsmBinWriter& writer) const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief builder の内容から実行用の形を作る．
+  /// @param[in] builder 初期化用オブジェクト
+  ///
+  /// FLOAT は定数表に移し，アドレスは語単位のアドレスに置き換える．
+  void
+  build(const Builder& builder);
+
+  /// @brief 保存用の形から実行用の形を作る．
+  /// @param[in] body 保存用の形
+  /// @param[in] byte_size body のバイト数
+  /// @return 保存用の形が壊れていたら false を返す．
+  ///
+  /// ジャンプテーブルとスタックマップのアドレスも
+  /// 語単位のアドレスに置き換える．
+  bool
+  decode(const ymuint8* body,
+	 ymuint byte_size);
+
+  /// @brief 保存用の形の配置を求める．
+  /// @param[out] addr_map 実行用の形のアドレスから保存用の形の
+  /// アドレスへの対応表(末尾(size())も含む)
+  /// @param[out] size_list 語ごとの保存用の形のバイト数
+  /// @return 保存用の形のバイト数を返す．
+  ymuint
+  layout(vector<Ymsl_INT>& addr_map,
+	 vector<ymuint>& size_list) const;
+
+  /// @brief 実行用の形を保存用の形に詰める．
+  /// @param[out] body 保存用の形
+  /// @param[out] addr_map 実行用の形のアドレスから保存用の形の
+  /// アドレスへの対応表(末尾(size())も含む)
+  void
+  encode(vector<ymuint8>& body,
+	 vector<Ymsl_INT>& addr_map) const;
 
 
 private:
@@ -146,11 +385,48 @@ private:
   // データメンバ
   //////////////////////////////////////////////////////////////////////
 
-  // サイズ
+  // オペランドの形式を返す関数
+  FormatFunc mFormatFunc;
+
+  // 実行用の形の語数
   ymuint mSize;
 
-  // 実体
-  Ymsl_CODE* mBody;
+  // 実行用の形
+  Ymsl_CODE* mCode;
+
+  // 保存用の形のバイト数
+  ymuint mByteSize;
+
+  // FLOAT の定数表の要素数
+  ymuint mFloatNum;
+
+  // FLOAT の定数表
+  Ymsl_FLOAT* mFloatPool;
+
+  // ジャンプテーブルの数
+  ymuint mJumpTableNum;
+
+  // ジャンプテーブルごとの mJumpTableBody 上の開始位置
+  // 以下のアドレスは全て実行用の形のアドレス
+  // 末尾の要素は全体の大きさ
+  ymuint* mJumpTableStart;
+
+  // 全てのジャンプテーブルの要素を並べた配列
+  Ymsl_INT* mJumpTableBody;
+
+  // スタックマップの数
+  ymuint mStackMapNum;
+
+  // スタックマップごとの安全点の命令の直後のアドレス
+  // 昇順に並んでいる．
+  Ymsl_INT* mStackMapAddr;
+
+  // スタックマップごとの mStackMapBody 上の開始位置
+  // 末尾の要素は全体の大きさ
+  ymuint* mStackMapStart;
+
+  // 全てのスタックマップの要素を並べた配列
+  Ymsl_INT* mStackMapBody;
 
 };
 
@@ -167,6 +443,22 @@ VsmCodeList::size() const
   return mSize;
 }
 
+// @brief 保存用の形のバイト数を得る．
+inline
+Ymsl_INT
+VsmCodeList::byte_size() const
+{
+  return mByteSize;
+}
+
+// @brief 定数表の FLOAT の数を得る．
+inline
+Ymsl_INT
+VsmCodeList::float_num() const
+{
+  return mFloatNum;
+}
+
 // @brief 命令を読みだす．
 // @param[inout] addr アドレス
 // @return 読みだした値を返す．
@@ -174,7 +466,7 @@ inline
 Ymsl_CODE
 VsmCodeList::read_opcode(Ymsl_INT& addr) const
 {
-  Ymsl_CODE op = mBody[addr];
+  Ymsl_CODE op = mCode[addr];
   ++ addr;
   return op;
 }
@@ -186,8 +478,7 @@ inline
 Ymsl_INT
 VsmCodeList::read_int(Ymsl_INT& addr) const
 {
-  ASSERT_COND( sizeof(Ymsl_INT) == sizeof(Ymsl_CODE) );
-  Ymsl_INT val = mBody[addr];
+  Ymsl_INT val = static_cast<Ymsl_INT>(mCode[addr]);
   ++ addr;
   return val;
 }
@@ -199,25 +490,47 @@ inline
 Ymsl_FLOAT
 VsmCodeList::read_float(Ymsl_INT& addr) const
 {
-  Ymsl_CODE* c_ptr = mBody + addr;
-  Ymsl_FLOAT* f_ptr = reinterpret_cast<Ymsl_FLOAT*>(c_ptr);
-  Ymsl_FLOAT val = *f_ptr;
-  addr += sizeof(Ymsl_FLOAT) / sizeof(Ymsl_CODE);
-  return val;
+  Ymsl_CODE index = mCode[addr];
+  ++ addr;
+  return mFloatPool[index];
 }
 
-// @brief OBJPTR を読みだす．
-// @param[inout] addr アドレス
-// @return 読みだした値を返す．
+// @brief ジャンプテーブルを得る．
+// @param[in] index ジャンプテーブルの番号
+// @return 先頭の要素を指すポインタを返す．
 inline
-Ymsl_OBJPTR
-VsmCodeList::read_objptr(Ymsl_INT& addr) const
+const Ymsl_INT*
+VsmCodeList::jump_table(Ymsl_INT index) const
 {
-  Ymsl_CODE* c_ptr = mBody + addr;
-  Ymsl_OBJPTR* o_ptr = reinterpret_cast<Ymsl_OBJPTR*>(c_ptr);
-  Ymsl_OBJPTR val = *o_ptr;
-  addr += sizeof(Ymsl_OBJPTR) / sizeof(Ymsl_CODE);
-  return val;
+  return mJumpTableBody + mJumpTableStart[index];
+}
+
+// @brief ジャンプテーブルの要素数を得る．
+// @param[in] index ジャンプテーブルの番号
+inline
+Ymsl_INT
+VsmCodeList::jump_table_size(Ymsl_INT index) const
+{
+  return mJumpTableStart[index + 1] - mJumpTableStart[index];
+}
+
+// @brief スタックマップを得る．
+// @param[in] index スタックマップの番号
+// @return 先頭の要素を指すポインタを返す．
+inline
+const Ymsl_INT*
+VsmCodeList::stack_map(Ymsl_INT index) const
+{
+  return mStackMapBody + mStackMapStart[index];
+}
+
+// @brief スタックマップの要素数を得る．
+// @param[in] index スタックマップの番号
+inline
+Ymsl_INT
+VsmCodeList::stack_map_size(Ymsl_INT index) const
+{
+  return mStackMapStart[index + 1] - mStackMapStart[index];
 }
 
 END_NAMESPACE_YM_YMSL
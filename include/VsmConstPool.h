@@ -0,0 +1,281 @@
+#ifndef VSMCONSTPOOL_H
+#define VSMCONSTPOOL_H
+
+/// @file VsmConstPool.h
+/// @brief VsmConstPool のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "VsmValue.h"
+#include "YmUtils/ShString.h"
+#include "YmUtils/HashMap.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @brief FLOAT の定数をハッシュ表で引くためのキー
+///
+/// 0.0 と -0.0 や NaN を区別するためにビットパタンで比べる．
+//////////////////////////////////////////////////////////////////////
+struct VsmFloatKey
+{
+  // ビットパタン
+  ymuint64 mBits;
+};
+
+/// @brief 等価比較演算子
+inline
+bool
+operator==(const VsmFloatKey& left,
+	   const VsmFloatKey& right)
+{
+  return left.mBits == right.mBits;
+}
+
+END_NAMESPACE_YM_YMSL
+
+BEGIN_NAMESPACE_YM
+
+//////////////////////////////////////////////////////////////////////
+// HashFunc<VsmFloatKey> の特殊化
+//////////////////////////////////////////////////////////////////////
+template<>
+struct
+HashFunc<nsYmsl::VsmFloatKey>
+{
+  ymuint
+  operator()(const nsYmsl::VsmFloatKey& key) const
+  {
+    return static_cast<ymuint>(key.mBits ^ (key.mBits >> 32));
+  }
+};
+
+END_NAMESPACE_YM
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmConstPool VsmConstPool.h "VsmConstPool.h"
+/// @brief モジュールごとの定数表を表すクラス
+///
+/// INT, FLOAT, STRING の定数を番号で引けるように並べたもの．
+/// VSM_PUSH_CONST/VSM_REG_CONST のオペランドはこの番号になる．
+/// 同じ値の定数はモジュール内で一つにまとめる．
+///
+/// Builder 上の STRING の値は ShString の文字列を指すポインタ
+/// (VsmValue::str_value)で，文字列の実体は複製しない．
+/// VsmConstPool を作る時に YmslString に変換して VsmValue::obj_value
+/// に置く．Vsm は文字列をオブジェクトとして扱うので定数もそれに合わせる．
+/// この YmslString は static フラグを立てて VsmConstPool が所有する．
+/// 複数の Vsm から共有されるので作った後は変更しない．
+/// YmslString::hash() が後から書き込まないように，ハッシュ値も
+/// 作る時に求めておく．
+///
+/// VsmCodeList と同様に Builder で定数を追加してから
+/// VsmConstPool を作る．
+//////////////////////////////////////////////////////////////////////
+class VsmConstPool
+{
+public:
+  //////////////////////////////////////////////////////////////////////
+  // ビルダークラス
+  //////////////////////////////////////////////////////////////////////
+
+  class Builder
+  {
+  public:
+
+    /// @brief コンストラクタ
+    Builder();
+
+    /// @brief デストラクタ
+    ~Builder();
+
+
+  public:
+    //////////////////////////////////////////////////////////////////////
+    // 外部インターフェイス
+    //////////////////////////////////////////////////////////////////////
+
+    /// @brief INT の定数を追加する．
+    /// @param[in] val 値
+    /// @return 定数番号を返す．
+    ///
+    /// 同じ値が登録済みの場合はその番号を返す．
+    Ymsl_INT
+    add_int(Ymsl_INT val);
+
+    /// @brief FLOAT の定数を追加する．
+    /// @param[in] val 値
+    /// @return 定数番号を返す．
+    ///
+    /// 同じ値が登録済みの場合はその番号を返す．
+    /// 0.0 と -0.0 は区別する．
+    Ymsl_INT
+    add_float(Ymsl_FLOAT val);
+
+    /// @brief STRING の定数を追加する．
+    /// @param[in] val 値
+    /// @return 定数番号を返す．
+    ///
+    /// 同じ値が登録済みの場合はその番号を返す．
+    Ymsl_INT
+    add_string(ShString val);
+
+    /// @brief 定数の数を返す．
+    Ymsl_INT
+    size() const;
+
+    /// @brief 定数の型を返す．
+    /// @param[in] index 定数番号 ( 0 <= index < size() )
+    ///
+    /// kIntType, kFloatType, kStringType のいずれか
+    TypeId
+    type(Ymsl_INT index) const;
+
+    /// @brief 定数の値を返す．
+    /// @param[in] index 定数番号 ( 0 <= index < size() )
+    VsmValue
+    value(Ymsl_INT index) const;
+
+
+  private:
+    //////////////////////////////////////////////////////////////////////
+    // 内部で用いられる関数
+    //////////////////////////////////////////////////////////////////////
+
+    /// @brief 定数を追加する．
+    /// @param[in] type 型
+    /// @param[in] val 値
+    /// @return 定数番号を返す．
+    Ymsl_INT
+    add(TypeId type,
+	VsmValue val);
+
+
+  private:
+    //////////////////////////////////////////////////////////////////////
+    // データメンバ
+    //////////////////////////////////////////////////////////////////////
+
+    // 型のリスト
+    vector<TypeId> mTypeList;
+
+    // 値のリスト
+    vector<VsmValue> mValueList;
+
+    // INT の値をキーにして定数番号を保持するハッシュ表
+    HashMap<Ymsl_INT, Ymsl_INT> mIntDict;
+
+    // FLOAT の値をキーにして定数番号を保持するハッシュ表
+    HashMap<VsmFloatKey, Ymsl_INT> mFloatDict;
+
+    // STRING の値をキーにして定数番号を保持するハッシュ表
+    HashMap<ShString, Ymsl_INT> mStringDict;
+
+  };
+
+
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] builder 初期化用オブジェクト
+  VsmConstPool(const Builder& builder);
+
+  /// @brief デストラクタ
+  ~VsmConstPool();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 定数の数を返す．
+  Ymsl_INT
+  size() const;
+
+  /// @brief 定数の型を返す．
+  /// @param[in] index 定数番号 ( 0 <= index < size() )
+  ///
+  /// kIntType, kFloatType, kStringType のいずれか
+  TypeId
+  type(Ymsl_INT index) const;
+
+  /// @brief 定数の値を返す．
+  /// @param[in] index 定数番号 ( 0 <= index < size() )
+  VsmValue
+  value(Ymsl_INT index) const;
+
+  /// @brief 値の配列の先頭を返す．
+  ///
+  /// Vsm が定数番号で直接引くために用いる．
+  const VsmValue*
+  value_table() const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 定数の数
+  ymuint mSize;
+
+  // 型の配列
+  TypeId* mTypeTable;
+
+  // 値の配列
+  VsmValue* mValueTable;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// インライン関数の定義
+//////////////////////////////////////////////////////////////////////
+
+// @brief 定数の数を返す．
+inline
+Ymsl_INT
+VsmConstPool::size() const
+{
+  return mSize;
+}
+
+// @brief 定数の型を返す．
+// @param[in] index 定数番号 ( 0 <= index < size() )
+inline
+TypeId
+VsmConstPool::type(Ymsl_INT index) const
+{
+  ASSERT_COND( index >= 0 && index < size() );
+  return mTypeTable[index];
+}
+
+// @brief 定数の値を返す．
+// @param[in] index 定数番号 ( 0 <= index < size() )
+inline
+VsmValue
+VsmConstPool::value(Ymsl_INT index) const
+{
+  ASSERT_COND( index >= 0 && index < size() );
+  return mValueTable[index];
+}
+
+// @brief 値の配列の先頭を返す．
+inline
+const VsmValue*
+VsmConstPool::value_table() const
+{
+  return mValueTable;
+}
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMCONSTPOOL_H
@@ -47,6 +47,16 @@ public:
   const Type*
   type() const;
 
+  /// @brief 引数の数を返す．
+  ///
+  /// 型はコンパイル時にしか存在しないので実行時にはこちらを用いる．
+  ymuint
+  arg_num() const;
+
+  /// @brief 返り値を持つ時 true を返す．
+  bool
+  has_return_value() const;
+
   /// @brief 組み込み関数の時 true を返す．
   virtual
   bool
@@ -60,6 +70,44 @@ public:
   execute(Vsm& vsm,
 	  Ymsl_INT base) const = 0;
 
+  /// @brief Vsm の命令ループの中で実行するコードを返す．
+  /// @param[in] vsm 仮想マシン
+  ///
+  /// 呼び出しのたびに Vsm から呼ばれる．
+  /// NULL を返した場合には execute() が呼ばれる．
+  /// デフォルトの実装は NULL を返す．
+  virtual
+  const VsmCodeList*
+  frame_code(Vsm& vsm) const;
+
+  /// @brief レジスタ型のコードを返す．
+  ///
+  /// NULL でない場合は Vsm::execute_reg() の命令ループの中で
+  /// 実行される．NULL を返した場合には execute() が呼ばれる．
+  /// デフォルトの実装は NULL を返す．
+  virtual
+  const VsmRegCodeList*
+  reg_code() const;
+
+  /// @brief 呼び出し時に必要なフレームの大きさを返す．
+  ///
+  /// 引数を含む．Vsm は呼び出しのたびにこの大きさの領域が
+  /// あるかを一度だけ調べる．
+  /// デフォルトの実装は 0 を返す．
+  virtual
+  Ymsl_INT
+  frame_size() const;
+
+  /// @brief 実行用の情報をバイナリ形式で書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  /// @return 書き出せなかった場合は false を返す．
+  ///
+  /// 名前と型は VsmModuleFile が書くのでここでは書かない．
+  /// デフォルトの実装は何もせずに false を返す．
+  virtual
+  bool
+  dump(VsmBinWriter& writer) const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -72,6 +120,12 @@ private:
   // 型
   const Type* mType;
 
+  // 引数の数
+  ymuint mArgNum;
+
+  // 返り値を持つ時 true にするフラグ
+  bool mHasReturnValue;
+
 };
 
 END_NAMESPACE_YM_YMSL
@@ -11,6 +11,8 @@
 
 #include "ymsl_int.h"
 #include "VsmCodeList.h"
+#include "VsmRegCodeList.h"
+#include "VsmConstPool.h"
 #include "YmUtils/ShString.h"
 
 
@@ -19,13 +21,49 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 /// @class VsmGen VsmGen.h "VsmGen.h"
 /// @brief VSM 用のバイトコードを生成するクラス
+///
+/// 生成するコードの約束事は以下のとおり
+/// - 二項演算，三項演算のオペランドは最後のものから順に積む．
+///   つまり第1オペランドがスタックトップになる．
+/// - ブール値は INT の 0/1 で表す．
+/// - 関数呼び出しでは第1引数から順に積んで VSM_CALL を実行する．
+///   引数はそのまま呼ばれた側のローカル変数 #0 〜 になる．
+/// - 返り値はスタックトップに積んで VSM_RETURN を実行する．
+///   返り値のない関数は VSM_RETURN_VOID を実行する．
+/// - return 文の値が関数呼び出しの場合には VSM_TAIL_CALL を用いる．
+/// - 生成したコードには VsmPeephole で覗き穴最適化を行う．
+/// - 関数ごとにスタックの深さの最大値を求めて VsmNativeFunc に記録する．
+///   Vsm は呼び出し時にこの大きさで一度だけ容量を調べる．
+/// - 0.0 と 1.0 以外の FLOAT，STRING，16ビットに収まらない INT の定数は
+///   モジュールの定数表に置いて VSM_PUSH_CONST で積む．
+///   それ以外の INT の定数は VSM_PUSH_INT_IMM で積む．
+/// - 値の型は IR で静的にわかっているので INT，FLOAT の値は箱に
+///   入れずにそのままフレームに置き，型に応じた命令で読み書きする．
+///   OBJ の命令はオブジェクト型の値にしか用いない．
+/// - ローカル変数のスロットは引数の後に INT，FLOAT，OBJ の格納
+///   クラスの順に並べて割り当てる(mSlotMap)．
+/// - switch 文はケースの値が密な範囲を VSM_JUMP_TABLE で分岐し，
+///   それ以外は値の大小比較による二分探索で分岐する．
+///   選択値を何度も読むのでローカル変数でない場合には
+///   INT のローカル変数の末尾に置いた作業用の変数に格納しておく．
+///
+/// reg_mode を指定した場合にはレジスタ型のコード(VsmRegOpcode)を
+/// 生成する．その場合の約束事は以下のとおり
+/// - フレームの先頭から引数，ローカル変数，一時変数の順に置く．
+///   ローカル変数の並び順はスタック型と同じ．
+/// - 一時変数はスタックと同様に後に確保したものから解放する．
+/// - 関数呼び出しでは連続した一時変数に引数を置いて VSM_REG_CALL を
+///   実行する．返り値は最初の引数の位置に置かれる．
+///   return の値になる呼び出しは VSM_REG_TAIL_CALL にする．
+/// - 定数表に置く定数はスタック型と同じで，VSM_REG_CONST で読み込む．
 //////////////////////////////////////////////////////////////////////
 class VsmGen
 {
 public:
 
   /// @brief コンストラクタ
-  VsmGen();
+  /// @param[in] reg_mode レジスタ型のコードを生成する時 true にする．
+  VsmGen(bool reg_mode = false);
 
   /// @brief デストラクタ
   ~VsmGen();
@@ -49,19 +87,468 @@ private:
   // 内部で用いられる関数
   //////////////////////////////////////////////////////////////////////
 
-  /// @brief コードブロックに対するコード生成を行う．
+  /// @brief ラベルに番号をつける．
   /// @param[in] code_block コードブロック
+  void
+  init_labels(const IrCodeBlock* code_block);
+
+  /// @brief ジャンプ先のアドレスを埋める．
   /// @param[in] builder CodeList ビルダー
   void
+  fix_labels(VsmCodeList::Builder& builder);
+
+  /// @brief コードブロックに対するコード生成を行う．
+  /// @param[in] code_block コードブロック
+  /// @param[in] arg_num 引数の数
+  /// @param[in] output_type 返り値の型
+  /// @param[in] end_op 末尾に置く命令
+  /// @param[in] builder CodeList ビルダー
+  /// @return 生成したコードに誤りがあれば false を返す．
+  ///
+  /// ローカル変数の数を mVarNum に，ローカル変数の上に積まれる
+  /// 値の数の最大値を mMaxStack に設定する．
+  bool
   gen_block(const IrCodeBlock* code_block,
+	    ymuint arg_num,
+	    TypeId output_type,
+	    Ymsl_CODE end_op,
 	    VsmCodeList::Builder& builder);
 
+  /// @brief 生成したコードの誤りを出力する．
+  /// @param[in] name 関数名
+  void
+  put_gen_error(ShString name);
+
+  /// @brief ローカル変数にフレーム上のスロットを割り当てる．
+  /// @param[in] code_block コードブロック
+  /// @param[in] arg_num 引数の数
+  /// @param[in] need_switch_var switch 文の作業用の変数を確保する時 true
+  ///
+  /// 結果は mSlotMap と mSlotType に設定する．
+  void
+  assign_slots(const IrCodeBlock* code_block,
+	       ymuint arg_num,
+	       bool need_switch_var);
+
+  /// @brief ローカル変数のスロット番号を返す．
+  /// @param[in] var 変数
+  Ymsl_INT
+  local_slot(IrHandle* var) const;
+
+  /// @brief スタックの深さの最大値を求める．
+  /// @param[in] builder CodeList ビルダー
+  /// @param[in] arg_num 引数の数
+  /// @return フレームの先頭からの深さの最大値を返す．
+  ///
+  /// 覗き穴最適化の前のコードに対して行う．融合した命令は
+  /// 元の命令列より深くなることはないので最適化後も成り立つ．
+  /// 関数呼び出しによる増減は mCallList を用いる．
+  Ymsl_INT
+  calc_max_depth(const VsmCodeList::Builder& builder,
+		 ymuint arg_num);
+
+  /// @brief ごみ集め用のスタックマップを作る．
+  /// @param[in] builder CodeList ビルダー
+  /// @param[in] arg_num 引数の数
+  /// @param[in] output_type 返り値の型
+  /// @return 命令の扱う値の格納クラスが合っていなければ false を返す．
+  ///
+  /// 各命令位置で積まれている値の格納クラスを求め，
+  /// 安全点の命令ごとに OBJ の値を持つスロットを builder に記録する．
+  /// 同時に各命令が取り出す値や読み書きする変数の格納クラスが
+  /// 命令に合っているか，合流する位置で積まれている値が一致するかを調べる．
+  /// 覗き穴最適化の前のコードに対して行う．
+  /// 関数呼び出しの引数と返り値の型は mCallList を用いる．
+  bool
+  gen_stack_map(VsmCodeList::Builder& builder,
+		ymuint arg_num,
+		TypeId output_type);
+
+  /// @brief 文に対するコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_stmt(IrNode* node,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief 式に対するコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  ///
+  /// 結果はスタックに積まれる．
+  void
+  gen_expr(IrNode* node,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief 式に対するコード生成を行い，指定された型に変換する．
+  /// @param[in] node 対象のノード
+  /// @param[in] type_id 要求される型
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_expr(IrNode* node,
+	   TypeId type_id,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief 論理演算(AND/OR)のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  ///
+  /// 短絡評価を行う．
+  void
+  gen_logop(IrNode* node,
+	    VsmCodeList::Builder& builder);
+
+  /// @brief 関数呼び出しのコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  /// @param[in] call_op 呼び出し命令(VSM_CALL か VSM_TAIL_CALL)
+  void
+  gen_funccall(IrNode* node,
+	       VsmCodeList::Builder& builder,
+	       Ymsl_CODE call_op);
+
+  /// @brief ロードのコード生成を行う．
+  /// @param[in] addr アドレス
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_load(IrHandle* addr,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief ストアのコード生成を行う．
+  /// @param[in] addr アドレス
+  /// @param[in] builder CodeList ビルダー
+  ///
+  /// 値はスタックトップに積まれている．
+  void
+  gen_store(IrHandle* addr,
+	    VsmCodeList::Builder& builder);
+
+  /// @brief 型変換のコード生成を行う．
+  /// @param[in] src_id 元の型
+  /// @param[in] dst_id 変換後の型
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_cast(TypeId src_id,
+	   TypeId dst_id,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief INT の定数を積むコード生成を行う．
+  /// @param[in] val 値
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_int_const(Ymsl_INT val,
+		VsmCodeList::Builder& builder);
+
+  /// @brief switch 文のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_switch(IrNode* node,
+	     VsmCodeList::Builder& builder);
+
+  /// @brief switch 文のケースの範囲に対する分岐のコード生成を行う．
+  /// @param[in] node switch 文のノード
+  /// @param[in] begin 範囲の先頭のケース番号
+  /// @param[in] end 範囲の末尾の次のケース番号
+  /// @param[in] var 選択値を格納しているローカル変数の番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_case_tree(IrNode* node,
+		ymuint begin,
+		ymuint end,
+		Ymsl_INT var,
+		VsmCodeList::Builder& builder);
+
+  /// @brief ジャンプ命令のコード生成を行う．
+  /// @param[in] op 命令
+  /// @param[in] label_id ジャンプ先のラベル番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_jump(Ymsl_CODE op,
+	   ymuint label_id,
+	   VsmCodeList::Builder& builder);
+
+  /// @brief ジャンプテーブルを作る．
+  /// @param[in] node switch 文のノード
+  /// @param[in] begin 範囲の先頭のケース番号
+  /// @param[in] end 範囲の末尾の次のケース番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return テーブル番号を返す．
+  ///
+  /// 中身はラベル番号で埋めておき，fix_labels() でアドレスに置き換える．
+  Ymsl_INT
+  new_jump_table(IrNode* node,
+		 ymuint begin,
+		 ymuint end,
+		 VsmCodeList::Builder& builder);
+
+  /// @brief INT の定数を定数表に置くか調べる．
+  /// @param[in] val 値
+  ///
+  /// 16ビットに収まらないものは命令に埋め込むより短くなるので
+  /// 定数表に置く．
+  static
+  bool
+  use_const_pool(Ymsl_INT val);
+
+  /// @brief 新しいラベル番号を得る．
+  ymuint
+  new_label();
+
+  /// @brief ラベルの位置を確定する．
+  /// @param[in] label_id ラベル番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  put_label(ymuint label_id,
+	    VsmCodeList::Builder& builder);
+
+  /// @brief コードブロックに対するレジスタ型のコード生成を行う．
+  /// @param[in] code_block コードブロック
+  /// @param[in] arg_num 引数の数
+  /// @param[in] end_op 末尾に置く命令
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_block(const IrCodeBlock* code_block,
+		ymuint arg_num,
+		Ymsl_CODE end_op,
+		VsmRegCodeList::Builder& builder);
+
+  /// @brief レジスタ型のコードのごみ集め用のスタックマップを作る．
+  /// @param[in] builder CodeList ビルダー
+  ///
+  /// 各命令位置でのスロットの格納クラスを求め，安全点の命令ごとに
+  /// OBJ の値を持つスロットを builder に記録する．
+  /// 関数呼び出しの返り値の型は mCallList を，他のモジュールの
+  /// グローバル変数の型は mExtLoadList を用いる．
+  void
+  gen_reg_stack_map(VsmRegCodeList::Builder& builder);
+
+  /// @brief 文に対するレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_stmt(IrNode* node,
+	       VsmRegCodeList::Builder& builder);
+
+  /// @brief 式に対するレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return 結果を格納したスロット番号を返す．
+  ///
+  /// dst が -1 の場合には結果の位置はこちらで決める．
+  Ymsl_INT
+  gen_reg_expr(IrNode* node,
+	       Ymsl_INT dst,
+	       VsmRegCodeList::Builder& builder);
+
+  /// @brief 式に対するレジスタ型のコード生成を行い，指定された型に変換する．
+  /// @param[in] node 対象のノード
+  /// @param[in] type_id 要求される型
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return 結果を格納したスロット番号を返す．
+  Ymsl_INT
+  gen_reg_expr(IrNode* node,
+	       TypeId type_id,
+	       Ymsl_INT dst,
+	       VsmRegCodeList::Builder& builder);
+
+  /// @brief 論理演算(AND/OR)のレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return 結果を格納したスロット番号を返す．
+  Ymsl_INT
+  gen_reg_logop(IrNode* node,
+		Ymsl_INT dst,
+		VsmRegCodeList::Builder& builder);
+
+  /// @brief ITE 演算のレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return 結果を格納したスロット番号を返す．
+  Ymsl_INT
+  gen_reg_ite(IrNode* node,
+	      Ymsl_INT dst,
+	      VsmRegCodeList::Builder& builder);
+
+  /// @brief 関数呼び出しのレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @param[in] call_op 呼び出し命令(VSM_REG_CALL か VSM_REG_TAIL_CALL)
+  /// @return 結果を格納したスロット番号を返す．
+  Ymsl_INT
+  gen_reg_funccall(IrNode* node,
+		   Ymsl_INT dst,
+		   VsmRegCodeList::Builder& builder,
+		   Ymsl_CODE call_op);
+
+  /// @brief ロードのレジスタ型のコード生成を行う．
+  /// @param[in] addr アドレス
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  /// @return 結果を格納したスロット番号を返す．
+  ///
+  /// ローカル変数の場合には dst が -1 ならそのスロット番号を返す．
+  Ymsl_INT
+  gen_reg_load(IrHandle* addr,
+	       Ymsl_INT dst,
+	       VsmRegCodeList::Builder& builder);
+
+  /// @brief ストアのレジスタ型のコード生成を行う．
+  /// @param[in] addr アドレス
+  /// @param[in] src 値を格納しているスロット番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_store(IrHandle* addr,
+		Ymsl_INT src,
+		VsmRegCodeList::Builder& builder);
+
+  /// @brief INT の定数を読み込むレジスタ型のコード生成を行う．
+  /// @param[in] val 値
+  /// @param[in] dst 結果を格納するスロット番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_int_const(Ymsl_INT val,
+		    Ymsl_INT dst,
+		    VsmRegCodeList::Builder& builder);
+
+  /// @brief switch 文のレジスタ型のコード生成を行う．
+  /// @param[in] node 対象のノード
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_switch(IrNode* node,
+		 VsmRegCodeList::Builder& builder);
+
+  /// @brief switch 文のケースの範囲に対する分岐のレジスタ型のコード生成を行う．
+  /// @param[in] node switch 文のノード
+  /// @param[in] begin 範囲の先頭のケース番号
+  /// @param[in] end 範囲の末尾の次のケース番号
+  /// @param[in] src 選択値を格納しているスロット番号
+  /// @param[in] builder CodeList ビルダー
+  void
+  gen_reg_case_tree(IrNode* node,
+		    ymuint begin,
+		    ymuint end,
+		    Ymsl_INT src,
+		    VsmRegCodeList::Builder& builder);
+
+  /// @brief レジスタ型の分岐命令のコード生成を行う．
+  /// @param[in] op 命令
+  /// @param[in] cond 条件を格納しているスロット番号
+  /// @param[in] label_id ジャンプ先のラベル番号
+  /// @param[in] builder CodeList ビルダー
+  ///
+  /// op が VSM_REG_JUMP の場合には cond は用いない．
+  void
+  gen_reg_jump(Ymsl_CODE op,
+	       Ymsl_INT cond,
+	       ymuint label_id,
+	       VsmRegCodeList::Builder& builder);
+
+  /// @brief 一時変数を確保する．
+  /// @return スロット番号を返す．
+  Ymsl_INT
+  new_temp();
+
+  /// @brief 一時変数を解放する．
+  /// @param[in] slot スロット番号
+  ///
+  /// 一時変数でない場合には何もしない．
+  void
+  free_temp(Ymsl_INT slot);
+
+  /// @brief 結果を格納するスロット番号を決める．
+  /// @param[in] dst 指定されたスロット番号
+  ///
+  /// dst が -1 の場合には一時変数を確保する．
+  Ymsl_INT
+  target_slot(Ymsl_INT dst);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  // 関数呼び出し命令の情報
+  struct CallInfo
+  {
+    // 命令の位置
+    Ymsl_INT mPos;
+
+    // 引数の数
+    Ymsl_INT mArgNum;
+
+    // 引数の型のリスト
+    vector<TypeId> mInputType;
+
+    // 返り値の型
+    TypeId mOutputType;
+  };
+
 
 private:
   //////////////////////////////////////////////////////////////////////
   // データメンバ
   //////////////////////////////////////////////////////////////////////
 
+  // ラベル番号をキーにしてアドレスを保持する配列
+  // 未確定の場合は -1
+  vector<Ymsl_INT> mLabelAddr;
+
+  // バックパッチ用のリスト
+  // (書き換える位置, ラベル番号) のペア
+  vector<pair<Ymsl_INT, ymuint> > mFixupList;
+
+  // 中身をラベル番号で埋めてあるジャンプテーブルの番号のリスト
+  vector<Ymsl_INT> mTableList;
+
+  // 関数呼び出し命令のリスト
+  vector<CallInfo> mCallList;
+
+  // 他のモジュールのグローバル変数を読む命令のリスト
+  // (命令の位置, 変数の型) のペア
+  // レジスタ型のコードの場合のみ用いる．
+  vector<pair<Ymsl_INT, TypeId> > mExtLoadList;
+
+  // レジスタ型のコードを生成する時 true にするフラグ
+  bool mRegMode;
+
+  // 引数とローカル変数の数
+  // これ以降のスロットが一時変数となる．
+  Ymsl_INT mVarNum;
+
+  // 次に確保する一時変数のスロット番号
+  Ymsl_INT mTempTop;
+
+  // ローカル変数の番号をキーにしてフレーム上のスロット番号を保持する配列
+  vector<Ymsl_INT> mSlotMap;
+
+  // スロット番号をキーにして変数の型を保持する配列
+  // 一時変数の分は含まない．
+  vector<TypeId> mSlotType;
+
+  // グローバル変数の番号をキーにして変数の型を保持する配列
+  vector<TypeId> mGlobalType;
+
+  // switch 文の選択値を格納する作業用の変数のスロット番号
+  // スタック型のコードの場合のみ用いる．
+  Ymsl_INT mSwitchVar;
+
+  // ローカル変数の上に積まれる値の数の最大値
+  // スタック型のコードの場合のみ用いる．
+  Ymsl_INT mMaxStack;
+
+  // フレームのサイズ
+  Ymsl_INT mFrameSize;
+
+  // 定数表のビルダー
+  // code_gen() の実行中のみ有効
+  VsmConstPool::Builder* mConstPool;
 
 };
 
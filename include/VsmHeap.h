@@ -0,0 +1,496 @@
+#ifndef VSMHEAP_H
+#define VSMHEAP_H
+
+/// @file VsmHeap.h
+/// @brief VsmHeap のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmHeap VsmHeap.h "VsmHeap.h"
+/// @brief Vsm が実行時に作るオブジェクトを管理するクラス
+///
+/// 作ったオブジェクトは全てこのクラスが所有し，
+/// デストラクタでまとめて解放する．
+///
+/// オブジェクトは世代別に管理する．小さな文字列と配列は
+/// 若い世代の領域(ナーサリ)にポインタを進めるだけで作る．
+/// ナーサリが埋まってきたら need_collect() が true になるので，
+/// Vsm は根のスロットを一つずつ forward() に渡してから
+/// minor_collect() を呼ぶ．生き残ったオブジェクトは個別に確保した
+/// 古い世代の領域に写してスロットを書き換え，ナーサリは丸ごと空にする．
+/// ナーサリに置けない大きなオブジェクトと集合，連想配列，
+/// 長い文字列の連結を表すノード(YmslRope)は初めから古い世代に作る．
+/// 連結を表すノードが中身をまとめて別に確保した領域のバイト数は
+/// flat_size() で数えておく．
+///
+/// 命令がオブジェクトの中身を書き換えることはないので
+/// (連結を表すノードが中身をまとめて子供を手放すのは除く)，
+/// 古い世代から若い世代を指すのは前回の minor_collect() の後に
+/// 古い世代に作ったオブジェクトとグローバル変数だけである．
+/// 前者はこのクラスが覚えておき，後者は Vsm がカードで覚えておく．
+///
+/// 古い世代で使われなくなったオブジェクトは三色のマークアンドスイープの
+/// ごみ集めで解放する．need_full_collect() が true になったら，
+/// Vsm は minor_collect() の後で根のスロットが指すオブジェクトを
+/// mark() に渡して(灰色にして) start_mark() を呼ぶ．
+/// 以降は安全点ごとに mark_step() で灰色のオブジェクトの要素を辿り，
+/// 灰色がなくなったら根を調べ直して finish_mark() を呼ぶ．
+/// 最後に sweep_step() で印のないものを解放する．
+///
+/// set_time_slice() で一回の停止の時間の上限を与えると，
+/// mark_step() と sweep_step() はその時間で打ち切って次の安全点に続きを回す．
+/// 上限が 0 の時(既定値)は一回の停止で全て行う．
+/// 印つけの途中で古い世代に作ったオブジェクトは灰色にする．
+/// オブジェクトの中身は書き換わらないので，黒いオブジェクトが白い
+/// オブジェクトを指すようになるのは根からだけである．Vsm は
+/// オブジェクトを変数に書き込む命令で値を mark() に渡し(書き込みバリア)，
+/// finish_mark() の前に根を全て調べ直す．
+/// static フラグの立ったオブジェクトは辿らず，印もつけず，動かさない．
+///
+/// ごみ集めで止まった時間は begin_pause() と end_pause() で計り，
+/// 2 のべき乗のマイクロ秒ごとのヒストグラムにしておく．
+///
+/// Vsm ごとに一つずつ持つので，ナーサリはスレッドごとに独立している．
+//////////////////////////////////////////////////////////////////////
+class VsmHeap
+{
+  friend class YmslString;
+
+public:
+
+  /// @brief 古い世代のごみ集めの状態
+  enum State {
+    /// @brief 行っていない．
+    kIdle,
+    /// @brief 印をつけている．
+    kMarking,
+    /// @brief 印のないオブジェクトを解放している．
+    kSweeping
+  };
+
+  /// @brief 停止時間のヒストグラムの区間の数
+  ///
+  /// 区間 0 は 1 マイクロ秒未満，区間 i は 2^(i-1) 以上 2^i 未満，
+  /// 最後の区間はそれ以上の停止を数える．
+  static
+  const ymuint kPauseBucketNum = 16;
+
+  /// @brief コンストラクタ
+  VsmHeap();
+
+  /// @brief デストラクタ
+  ///
+  /// 作ったオブジェクトを全て解放する．
+  ~VsmHeap();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 文字列を作る．
+  /// @param[in] str 文字列
+  /// @param[in] len 文字数
+  YmslString*
+  new_string(const char* str,
+	     ymuint len);
+
+  /// @brief 二つの文字列をつないだ文字列を作る．
+  /// @param[in] str1, str2 文字列
+  ///
+  /// 長い文字列の場合は中身を写さずに連結を表すノードを作る．
+  YmslString*
+  new_string(const YmslString* str1,
+	     const YmslString* str2);
+
+  /// @brief 配列を作る．
+  /// @param[in] type 配列の型
+  /// @param[in] size 要素数
+  YmslArray*
+  new_array(const Type* type,
+	    ymuint size);
+
+  /// @brief 二つの配列をつないだ配列を作る．
+  /// @param[in] array1, array2 配列
+  YmslArray*
+  new_array(const YmslArray* array1,
+	    const YmslArray* array2);
+
+  /// @brief 空の集合か連想配列を作る．
+  /// @param[in] type 集合か連想配列の型
+  YmslSet*
+  new_set(const Type* type);
+
+  /// @brief 管理しているオブジェクトの数を返す．
+  ymuint
+  obj_num() const;
+
+  /// @brief ごみ集めを行うべき時 true を返す．
+  ///
+  /// ナーサリの残りが少なくなったか，古い世代のごみ集めを
+  /// 始めるべきか，その途中の時に true になる．
+  bool
+  need_collect() const;
+
+  /// @brief 若い世代のごみ集めを行うべき時 true を返す．
+  bool
+  need_minor_collect() const;
+
+  /// @brief 古い世代のごみ集めを行うべき時 true を返す．
+  ///
+  /// 前回のごみ集めの後に生き残った数に比例したしきい値を
+  /// 古い世代のオブジェクトの数が超えたら true になる．
+  /// 連結を表すノードがまとめた中身のバイト数が，同じく
+  /// 生き残った分に比例したしきい値を超えた場合も true になる．
+  bool
+  need_full_collect() const;
+
+  /// @brief 連結を表すノードがまとめた中身のバイト数の合計を返す．
+  ///
+  /// 解放されていないノードの分だけを数える．
+  ymuint64
+  flat_size() const;
+
+  /// @brief ごみ集めのしきい値の下限を設定する．
+  /// @param[in] num オブジェクトの数
+  void
+  set_collect_threshold(ymuint num);
+
+  /// @brief ナーサリの大きさを設定する．
+  /// @param[in] size バイト数
+  ///
+  /// ナーサリが空の時(minor_collect() の直後か作った直後)にのみ呼べる．
+  void
+  set_nursery_size(ymuint size);
+
+  /// @brief 一回の停止でごみ集めを行う時間の上限を設定する．
+  /// @param[in] usec マイクロ秒
+  ///
+  /// 0 の場合は古い世代のごみ集めを一回の停止で全て行う．
+  void
+  set_time_slice(ymuint usec);
+
+  /// @brief 古い世代のごみ集めの途中で次の停止までに空ける時間を設定する．
+  /// @param[in] usec マイクロ秒
+  void
+  set_slice_interval(ymuint usec);
+
+  /// @brief 古い世代のごみ集めの状態を返す．
+  State
+  state() const;
+
+  /// @brief 印をつけている途中の時 true を返す．
+  ///
+  /// 書き込みバリアで用いる．
+  bool
+  is_marking() const;
+
+  /// @brief 古い世代のごみ集めの途中で次の停止を行う時 true を返す．
+  ///
+  /// 前の停止から set_slice_interval() の時間が経ったか，
+  /// 古い世代のオブジェクトがしきい値の 2 倍を超えたら true になる．
+  bool
+  slice_due() const;
+
+  /// @brief 古い世代のごみ集めを最後まで行った回数を返す．
+  ymuint
+  collect_num() const;
+
+  /// @brief 若い世代のごみ集めを行った回数を返す．
+  ymuint
+  minor_collect_num() const;
+
+  /// @brief 根のスロットが指す若いオブジェクトを古い世代に写す．
+  /// @param[in] obj 根のスロット
+  ///
+  /// 写した先を obj に書き込む．すでに写したものは写した先に
+  /// 書き換えるだけ．若い世代のオブジェクトでなければ何もしない．
+  void
+  forward(Ymsl_OBJPTR& obj);
+
+  /// @brief 若い世代のごみ集めを終える．
+  ///
+  /// forward() で写したオブジェクトと，前回の後に古い世代に
+  /// 作ったオブジェクトの要素を forward() してからナーサリを空にする．
+  void
+  minor_collect();
+
+  /// @brief オブジェクトに印をつけて灰色にする．
+  /// @param[in] obj オブジェクト
+  ///
+  /// NULL や static なオブジェクト，若い世代のオブジェクト，
+  /// 印のついたオブジェクトの場合は何もしない．
+  void
+  mark(Ymsl_OBJPTR obj);
+
+  /// @brief 印つけを始める．
+  ///
+  /// minor_collect() の後で根に mark() してから呼ぶ．
+  void
+  start_mark();
+
+  /// @brief 灰色のオブジェクトの要素に印をつける．
+  /// @return 灰色のオブジェクトがなくなったら true を返す．
+  ///
+  /// 時間の上限を超えたら途中でやめる．
+  bool
+  mark_step();
+
+  /// @brief 印つけを終える．
+  ///
+  /// minor_collect() の後で根に mark() し直してから呼ぶ．
+  /// 残った灰色のオブジェクトを全て辿ってから解放に移る．
+  void
+  finish_mark();
+
+  /// @brief 印のないオブジェクトを解放する．
+  /// @return 最後まで解放したら true を返す．
+  ///
+  /// 生き残ったオブジェクトの印は消しておく．
+  /// 時間の上限を超えたら途中でやめる．
+  bool
+  sweep_step();
+
+  /// @brief ごみ集めの停止の始まりを記録する．
+  void
+  begin_pause();
+
+  /// @brief ごみ集めの停止の終わりを記録する．
+  void
+  end_pause();
+
+  /// @brief 停止時間のヒストグラムの区間の停止の回数を返す．
+  /// @param[in] bucket 区間 ( 0 <= bucket < kPauseBucketNum )
+  ymuint
+  pause_count(ymuint bucket) const;
+
+  /// @brief 最も長い停止時間(ナノ秒)を返す．
+  ymuint64
+  max_pause() const;
+
+  /// @brief 停止時間の合計(ナノ秒)を返す．
+  ymuint64
+  total_pause() const;
+
+  /// @brief 停止時間の記録を消す．
+  void
+  clear_pause_histogram();
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ナーサリから領域を確保する．
+  /// @param[in] size バイト数
+  /// @return 確保した領域を返す．
+  ///
+  /// 大きすぎるか残りが足りない場合は NULL を返す．
+  void*
+  alloc_young(ymuint64 size);
+
+  /// @brief 若い世代のオブジェクトの時 true を返す．
+  /// @param[in] obj オブジェクト
+  bool
+  is_young(const YmslObj* obj) const;
+
+  /// @brief 連結を表すノードがまとめた中身のバイト数を加える．
+  /// @param[in] size バイト数
+  ///
+  /// YmslString::flat_str() から呼ばれる．
+  void
+  add_flat_size(ymuint64 size);
+
+  /// @brief オブジェクトを古い世代に登録する．
+  /// @param[in] obj オブジェクト
+  void
+  reg_obj(YmslObj* obj);
+
+  /// @brief オブジェクトの要素を forward() する．
+  /// @param[in] obj オブジェクト
+  void
+  forward_children(YmslObj* obj);
+
+  /// @brief 灰色のオブジェクトの要素に印をつける．
+  /// @param[in] obj オブジェクト
+  void
+  mark_children(YmslObj* obj);
+
+  /// @brief 時間の上限を超えた時 true を返す．
+  bool
+  time_over() const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // ナーサリの先頭
+  ymuint8* mNurseryStart;
+
+  // ナーサリの次に確保する位置
+  ymuint8* mNurseryTop;
+
+  // ナーサリの末尾
+  ymuint8* mNurseryEnd;
+
+  // ナーサリの残りがこれより少なくなったらごみ集めを行う位置
+  ymuint8* mNurseryLimit;
+
+  // ナーサリに作ったオブジェクトの数
+  ymuint mYoungNum;
+
+  // 古い世代のオブジェクトのリスト
+  vector<YmslObj*> mObjList;
+
+  // 前回の minor_collect() の後に古い世代に作ったオブジェクトのうち
+  // 他のオブジェクトを指しうるもののリスト
+  vector<YmslObj*> mRememberList;
+
+  // 古い世代に写して要素をまだ forward() していないオブジェクトのリスト
+  vector<YmslObj*> mPromoteList;
+
+  // 印をつけて要素をまだ辿っていないオブジェクト(灰色)のリスト
+  vector<YmslObj*> mMarkStack;
+
+  // 古い世代のごみ集めの状態
+  State mState;
+
+  // mObjList のうち解放するかどうか調べる範囲の末尾
+  // 解放している間に作ったオブジェクトはこれより後ろに加わる．
+  ymuint mSweepEnd;
+
+  // mObjList の次に調べる位置
+  ymuint mSweepPos;
+
+  // mObjList の生き残ったオブジェクトを次に書き込む位置
+  ymuint mSweepWPos;
+
+  // 一回の停止の時間の上限(ナノ秒)
+  ymuint64 mTimeSlice;
+
+  // 次の停止までに空ける時間(ナノ秒)
+  ymuint64 mSliceInterval;
+
+  // 今の停止の始まりの時刻(ナノ秒)
+  ymuint64 mPauseStart;
+
+  // 次の停止を行う時刻(ナノ秒)
+  ymuint64 mNextSlice;
+
+  // 停止時間のヒストグラム
+  ymuint mPauseCount[kPauseBucketNum];
+
+  // 最も長い停止時間(ナノ秒)
+  ymuint64 mMaxPause;
+
+  // 停止時間の合計(ナノ秒)
+  ymuint64 mTotalPause;
+
+  // ごみ集めのしきい値の下限
+  ymuint mMinThreshold;
+
+  // ごみ集めのしきい値
+  ymuint mThreshold;
+
+  // 連結を表すノードがまとめた中身のバイト数の合計
+  ymuint64 mFlatSize;
+
+  // mFlatSize に対するごみ集めのしきい値
+  ymuint64 mFlatThreshold;
+
+  // 古い世代のごみ集めを行った回数
+  ymuint mCollectNum;
+
+  // 若い世代のごみ集めを行った回数
+  ymuint mMinorCollectNum;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// インライン関数の定義
+//////////////////////////////////////////////////////////////////////
+
+// @brief ごみ集めを行うべき時 true を返す．
+inline
+bool
+VsmHeap::need_collect() const
+{
+  return need_minor_collect() || mState != kIdle || need_full_collect();
+}
+
+// @brief 若い世代のごみ集めを行うべき時 true を返す．
+inline
+bool
+VsmHeap::need_minor_collect() const
+{
+  return mNurseryTop > mNurseryLimit;
+}
+
+// @brief 古い世代のごみ集めを行うべき時 true を返す．
+inline
+bool
+VsmHeap::need_full_collect() const
+{
+  return mObjList.size() >= mThreshold || mFlatSize >= mFlatThreshold;
+}
+
+// @brief 連結を表すノードがまとめた中身のバイト数の合計を返す．
+inline
+ymuint64
+VsmHeap::flat_size() const
+{
+  return mFlatSize;
+}
+
+// @brief 古い世代のごみ集めの状態を返す．
+inline
+VsmHeap::State
+VsmHeap::state() const
+{
+  return mState;
+}
+
+// @brief 印をつけている途中の時 true を返す．
+inline
+bool
+VsmHeap::is_marking() const
+{
+  return mState == kMarking;
+}
+
+// @brief 若い世代のオブジェクトの時 true を返す．
+// @param[in] obj オブジェクト
+inline
+bool
+VsmHeap::is_young(const YmslObj* obj) const
+{
+  const ymuint8* p = reinterpret_cast<const ymuint8*>(obj);
+  return p >= mNurseryStart && p < mNurseryTop;
+}
+
+// @brief 連結を表すノードがまとめた中身のバイト数を加える．
+// @param[in] size バイト数
+inline
+void
+VsmHeap::add_flat_size(ymuint64 size)
+{
+  mFlatSize += size;
+}
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMHEAP_H
@@ -10,7 +10,9 @@
 
 
 #include "ymsl_int.h"
+#include "VsmConstPool.h"
 #include "YmUtils/ShString.h"
+#include "YmUtils/HashFunc.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -61,6 +63,12 @@ public:
     ymuint
     add_exported_var(VsmVar* var);
 
+    /// @brief 定数表のビルダーを返す．
+    ///
+    /// コード生成中に定数を追加するために用いる．
+    VsmConstPool::Builder&
+    const_pool();
+
     /// @brief 名前を返す．
     ShString
     name() const;
@@ -77,6 +85,10 @@ public:
     const vector<VsmVar*>&
     exported_var_list() const;
 
+    /// @brief 定数表のビルダーを返す．
+    const VsmConstPool::Builder&
+    const_pool() const;
+
 
   private:
     //////////////////////////////////////////////////////////////////////
@@ -95,6 +107,9 @@ public:
     // export している変数のリスト
     vector<VsmVar*> mVarList;
 
+    // 定数表のビルダー
+    VsmConstPool::Builder mConstPool;
+
   };
 
 
@@ -145,12 +160,25 @@ public:
   VsmVar*
   exported_variable(ymuint pos) const;
 
+  /// @brief 定数表を返す．
+  const VsmConstPool&
+  const_pool() const;
+
   /// @brief トップレベルの実行を行う．
   /// @param[in] vsm 仮想マシン
   virtual
   void
   execute_toplevel(Vsm& vsm) const = 0;
 
+  /// @brief トップレベルのコードをバイナリ形式で書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  /// @return 書き出せなかった場合は false を返す．
+  ///
+  /// デフォルトの実装は何もせずに false を返す．
+  virtual
+  bool
+  dump_toplevel(VsmBinWriter& writer) const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -183,8 +211,29 @@ private:
   // export している変数の配列
   VsmVar** mExportedVarList;
 
+  // 定数表
+  VsmConstPool mConstPool;
+
 };
 
 END_NAMESPACE_YM_YMSL
 
+BEGIN_NAMESPACE_YM
+
+//////////////////////////////////////////////////////////////////////
+// HashFunc<VsmModule*> の特殊化
+//////////////////////////////////////////////////////////////////////
+template<>
+struct
+HashFunc<nsYmsl::VsmModule*>
+{
+  ymuint
+  operator()(nsYmsl::VsmModule* key) const
+  {
+    return reinterpret_cast<ympuint>(key) / sizeof(void*);
+  }
+};
+
+END_NAMESPACE_YM
+
 #endif // VSMMODULE_H
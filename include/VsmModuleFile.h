@@ -0,0 +1,192 @@
+#ifndef VSMMODULEFILE_H
+#define VSMMODULEFILE_H
+
+/// @file VsmModuleFile.h
+/// @brief VsmModuleFile のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "YmUtils/ShString.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmModuleFile VsmModuleFile.h "VsmModuleFile.h"
+/// @brief コンパイル済みのモジュールを .ymc ファイルに読み書きするクラス
+///
+/// ファイルは固定長のヘッダと本体からなる．
+/// ヘッダにはマジックナンバー，版数，バイト順の印，本体の大きさと
+/// チェックサム，元のソースファイルの大きさ，更新時刻，ハッシュ値を書く．
+/// 本体にはモジュール名，import しているモジュールの名前と
+/// インターフェイスのハッシュ値，定数表，変数と関数の名前と型，
+/// 関数とトップレベルのコードを書く．
+/// import しているモジュールは読み込み時に YmslCompiler::import() で
+/// 改めて読み込み，インターフェイスが変わっていたら読み込みに失敗する．
+///
+/// 書き出せるのはスタック型のモジュール(VsmNativeModule)だけで，
+/// 名前つきの型やクラス型を含むモジュールも書き出さない．
+/// どちらの場合も write() が false を返すので，呼び出し側は
+/// 毎回コンパイルすればよい．
+//////////////////////////////////////////////////////////////////////
+class VsmModuleFile
+{
+public:
+
+  /// @brief 元のソースファイルの情報
+  struct SourceInfo
+  {
+    /// @brief ファイルの大きさ
+    ymuint64 mSize;
+
+    /// @brief 更新時刻
+    ymint64 mMtime;
+
+    /// @brief 内容のハッシュ値
+    ///
+    /// stat_source() では設定しない．
+    ymuint64 mHash;
+
+    /// @brief stat_source() を呼んだ時刻
+    ymint64 mCheckTime;
+  };
+
+
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] compiler import に用いるコンパイラ
+  /// @param[in] type_mgr 型を管理するオブジェクト
+  ///
+  /// 読み込んだモジュールの型は type_mgr に登録するので，
+  /// type_mgr はモジュールよりも長く生きていなければならない．
+  VsmModuleFile(YmslCompiler& compiler,
+		TypeMgr& type_mgr);
+
+  /// @brief デストラクタ
+  ~VsmModuleFile();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ソースファイルの大きさと更新時刻を得る．
+  /// @param[in] path ソースファイルのパス
+  /// @param[out] info 結果を格納する変数
+  /// @return ファイルが存在しない場合は false を返す．
+  static
+  bool
+  stat_source(const string& path,
+	      SourceInfo& info);
+
+  /// @brief ソースファイルの内容のハッシュ値を得る．
+  /// @param[in] path ソースファイルのパス
+  /// @param[out] hash 結果を格納する変数
+  /// @return ファイルが読めない場合は false を返す．
+  static
+  bool
+  hash_source(const string& path,
+	      ymuint64& hash);
+
+  /// @brief ソースファイルが変更されたか調べる．
+  /// @param[in] path ソースファイルのパス
+  /// @param[in] info 前回調べた時の情報
+  /// @return 変更されているか，ファイルが読めない場合は true を返す．
+  ///
+  /// 大きさと更新時刻が同じなら内容は読まない．
+  /// ただし前回調べた時に更新されたばかりだった場合は
+  /// 内容のハッシュ値を比べる．
+  static
+  bool
+  source_changed(const string& path,
+		 const SourceInfo& info);
+
+  /// @brief モジュールをファイルに書き出す．
+  /// @param[in] path ファイルのパス
+  /// @param[in] module 対象のモジュール
+  /// @param[in] src_info 元のソースファイルの情報
+  /// @return 書き出せなかった場合は false を返す．
+  ///
+  /// 一時ファイルに書いてから rename() するので，
+  /// 書きかけのファイルを読み込むことはない．
+  bool
+  write(const string& path,
+	const VsmModule& module,
+	const SourceInfo& src_info);
+
+  /// @brief ファイルからモジュールを読み込む．
+  /// @param[in] path ファイルのパス
+  /// @param[in] src_path 元のソースファイルのパス
+  /// @return 読み込んだモジュールを返す．
+  ///
+  /// src_path が空でない場合はソースファイルと照合し，
+  /// 大きさと更新時刻が一致するか，内容のハッシュ値が一致する時だけ
+  /// 読み込む．
+  /// ファイルが存在しない，古い，壊れている，import している
+  /// モジュールのインターフェイスが変わっている場合は NULL を返す．
+  VsmModule*
+  read(const string& path,
+       const string& src_path);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 本体を読み込む．
+  /// @param[in] reader 読み込み用のオブジェクト
+  /// @return 読み込んだモジュールを返す．
+  ///
+  /// 失敗したら NULL を返す．
+  VsmModule*
+  read_body(VsmBinReader& reader);
+
+  /// @brief 型を書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  /// @param[in] type 型
+  /// @return 書き出せない型の場合は false を返す．
+  static
+  bool
+  write_type(VsmBinWriter& writer,
+	     const Type* type);
+
+  /// @brief 型を読み込む．
+  /// @param[in] reader 読み込み用のオブジェクト
+  /// @return 読み込んだ型を返す．
+  ///
+  /// 失敗したら NULL を返す．
+  const Type*
+  read_type(VsmBinReader& reader);
+
+  /// @brief モジュールのインターフェイスのハッシュ値を求める．
+  /// @param[in] module 対象のモジュール
+  ///
+  /// export している関数と変数の名前と型から求める．
+  static
+  ymuint64
+  interface_hash(const VsmModule& module);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // import に用いるコンパイラ
+  YmslCompiler& mCompiler;
+
+  // 型を管理するオブジェクト
+  TypeMgr& mTypeMgr;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMMODULEFILE_H
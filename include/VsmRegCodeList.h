@@ -0,0 +1,59 @@
+#ifndef VSMREGCODELIST_H
+#define VSMREGCODELIST_H
+
+/// @file VsmRegCodeList.h
+/// @brief VsmRegCodeList のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmCodeList.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmRegCodeList VsmRegCodeList.h "VsmRegCodeList.h"
+/// @brief レジスタ型の Vsm 用のコードを表すクラス
+///
+/// 命令語とオペランドの並べ方は VsmCodeList と同じだが，
+/// 命令コードは VsmRegOpcode を用いる．
+/// Vsm::execute_reg() で実行する．
+//////////////////////////////////////////////////////////////////////
+class VsmRegCodeList :
+  public VsmCodeList
+{
+public:
+
+  /// @brief 初期化用の builder クラス
+  class Builder :
+    public VsmCodeList::Builder
+  {
+  public:
+
+    /// @brief コンストラクタ
+    Builder();
+
+    /// @brief デストラクタ
+    ~Builder();
+
+  };
+
+
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] builder 初期化用オブジェクト
+  VsmRegCodeList(const Builder& builder);
+
+  /// @brief デストラクタ
+  ~VsmRegCodeList();
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+
+#endif // VSMREGCODELIST_H
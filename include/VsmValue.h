@@ -22,6 +22,7 @@ BEGIN_NAMESPACE_YM_YMSL
 union VsmValue {
   Ymsl_INT    int_value;
   Ymsl_FLOAT  float_value;
+  Ymsl_STRING str_value;
   Ymsl_OBJPTR obj_value;
 };
 
@@ -10,9 +10,13 @@
 
 
 #include "ymsl_int.h"
+#include "TypeMgr.h"
+#include "YmslMutex.h"
+#include "VsmModuleFile.h"
 #include "YmUtils/File.h"
 #include "YmUtils/IDO.h"
 #include "YmUtils/ShString.h"
+#include "YmUtils/HashMap.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -20,9 +24,22 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 /// @class YmslCompiler YmslCompiler.h "YmslCompiler.h"
 /// @brief YMSL 用のコンパイラ
+///
+/// import しているモジュールは ModuleBuilder で依存関係をたどって
+/// まとめて用意する．互いに依存しないモジュールは並列にコンパイルする．
+/// 出来上がったモジュールは名前で登録しておき，二度目以降の import
+/// ではそれを返す．
+/// ソースファイルから作ったモジュールは ModuleRegistry にも登録して，
+/// 他の YmslCompiler が同じソースファイルを import した時にも使う．
+///
+/// ソースファイルの情報と import の関係も覚えておき，update() で
+/// 変更されたモジュールとそれを import しているモジュールだけを
+/// 作り直す．
 //////////////////////////////////////////////////////////////////////
 class YmslCompiler
 {
+  friend class ModuleBuilder;
+
 public:
 
   /// @brief コンストラクタ
@@ -43,6 +60,8 @@ public:
   /// @return コンパイルしたモジュールを返す．
   ///
   /// エラーが起きたら NULL を返す．
+  /// 返したモジュールは呼び出し側で削除する．それが import している
+  /// モジュールはこのオブジェクトを削除するか update() を呼ぶまで有効．
   VsmModule*
   compile(IDO& ido,
 	  ShString name);
@@ -51,10 +70,30 @@ public:
   /// @param[in] name モジュール名
   /// @return モジュールを返す．
   ///
+  /// すでに用意されたモジュールがあればそれを返す．
+  /// <name>.ym が見つかった場合は同じディレクトリの <name>.ymc を
+  /// 照合して，使えればそれを読み込む．使えなければコンパイルして
+  /// <name>.ymc に書き出す．
+  /// <name>.ym が見つからない場合は <name>.ymc を照合せずに読み込む．
   /// エラーが起きたら NULL を返す．
   VsmModule*
   import(ShString name);
 
+  /// @brief ソースファイルが変更されたモジュールを作り直す．
+  /// @param[out] name_list 作り直したモジュール名のリスト
+  /// @return 全て作り直せたら true を返す．
+  ///
+  /// import したモジュールのソースファイルを調べて，変更されたものと
+  /// それを直接，間接に import しているものだけを作り直す．
+  /// 他のモジュールはそのまま使う．
+  /// 作り直せなかったモジュールは次の import() で再び試す．
+  /// compile() に渡したモジュール自身は対象外なので，
+  /// name_list が空でなければ呼び出し側でコンパイルし直すこと．
+  /// 作り直す前のモジュールは他から参照されていなければ削除される．
+  /// import() や compile() と同時に呼んではいけない．
+  bool
+  update(vector<ShString>& name_list);
+
   /// @brief サーチパスの先頭に path を追加する．
   /// @param[in] path 追加するパス
   /// @note path は ':' を含んでいても良い
@@ -67,6 +106,86 @@ public:
   void
   add_searchpath_end(const string& path);
 
+  /// @brief import したモジュールをコンパイルするスレッド数を設定する．
+  /// @param[in] num スレッド数
+  ///
+  /// 0 の場合は CPU の数を用いる．1 の場合は逐次的にコンパイルする．
+  /// デフォルトは 0
+  void
+  set_thread_num(ymuint num);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 抽象構文木からモジュールを作る．
+  /// @param[in] ast_root 抽象構文木の根のノード
+  /// @param[in] name モジュール名
+  /// @return 作ったモジュールを返す．
+  ///
+  /// import しているモジュールは用意されていなければならない．
+  /// 複数のスレッドから同時に呼ばれる．
+  /// エラーが起きたら NULL を返す．
+  VsmModule*
+  compile_ast(const AstStatement* ast_root,
+	      ShString name);
+
+  /// @brief 用意されたモジュールを探す．
+  /// @param[in] name モジュール名
+  /// @return モジュールを返す．
+  ///
+  /// 見つからなければ NULL を返す．
+  VsmModule*
+  find_module(ShString name);
+
+  /// @brief 用意されたモジュールを登録する．
+  /// @param[in] name モジュール名
+  /// @param[in] module モジュール
+  ///
+  /// ソースファイルのないモジュールに用いる．
+  void
+  reg_module(ShString name,
+	     VsmModule* module);
+
+  /// @brief ソースファイルから用意されたモジュールを登録する．
+  /// @param[in] name モジュール名
+  /// @param[in] module モジュール
+  /// @param[in] src_path ソースファイルのパス
+  /// @param[in] src_info ソースファイルの情報
+  ///
+  /// ModuleRegistry のモジュールの場合は参照を一つ引き取る．
+  void
+  reg_module(ShString name,
+	     VsmModule* module,
+	     const string& src_path,
+	     const VsmModuleFile::SourceInfo& src_info);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 用意されたモジュールの情報
+  struct ModuleInfo
+  {
+    // モジュール名
+    ShString mName;
+
+    // モジュール
+    // update() で作り直すことになったら NULL にする．
+    VsmModule* mModule;
+
+    // ソースファイルのパス
+    // 空ならソースファイルを調べない．
+    string mSrcPath;
+
+    // ソースファイルの情報
+    VsmModuleFile::SourceInfo mSrcInfo;
+  };
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -76,6 +195,26 @@ private:
   // モジュールのサーチパスリスト
   SearchPathList mPathList;
 
+  // 型を管理するオブジェクト
+  // モジュールを他の YmslCompiler と共有するので ModuleRegistry のものを使う．
+  TypeMgr& mTypeMgr;
+
+  // import したモジュールをコンパイルするスレッド数
+  ymuint mThreadNum;
+
+  // 用意されたモジュールの情報を名前で保持するハッシュ表
+  HashMap<ShString, ModuleInfo*> mModuleDict;
+
+  // 用意されたモジュールの情報のリスト
+  vector<ModuleInfo*> mModuleList;
+
+  // mModuleDict と mModuleList 用のロック
+  YmslMutex mMutex;
+
+  // 依存関係をたどっている最中のモジュール名のリスト
+  // 循環した import の検出に用いる．
+  vector<ShString> mVisitingList;
+
 };
 
 END_NAMESPACE_YM_YMSL
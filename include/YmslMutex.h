@@ -0,0 +1,185 @@
+#ifndef YMSLMUTEX_H
+#define YMSLMUTEX_H
+
+/// @file YmslMutex.h
+/// @brief YmslMutex, YmslLock, YmslCond のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "YmUtils/ShString.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslMutex YmslMutex.h "YmslMutex.h"
+/// @brief 排他制御用のクラス
+///
+/// YMSL_USE_THREADS が定義されていない時は何もしない．
+/// 定義の有無でクラスの大きさが変わらないように実体は別に確保する．
+//////////////////////////////////////////////////////////////////////
+class YmslMutex
+{
+public:
+
+  /// @brief コンストラクタ
+  YmslMutex();
+
+  /// @brief デストラクタ
+  ~YmslMutex();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ロックする．
+  void
+  lock();
+
+  /// @brief ロックを外す．
+  void
+  unlock();
+
+
+private:
+
+  friend class YmslCond;
+
+  // コピーは禁止
+  YmslMutex(const YmslMutex& src);
+
+  // 代入は禁止
+  const YmslMutex&
+  operator=(const YmslMutex& src);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 実体
+  void* mImpl;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslLock YmslMutex.h "YmslMutex.h"
+/// @brief スコープの間 YmslMutex をロックするクラス
+//////////////////////////////////////////////////////////////////////
+class YmslLock
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] mutex ロックする対象
+  explicit
+  YmslLock(YmslMutex& mutex) :
+    mMutex(mutex)
+  {
+    mMutex.lock();
+  }
+
+  /// @brief デストラクタ
+  ~YmslLock()
+  {
+    mMutex.unlock();
+  }
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // ロックしている対象
+  YmslMutex& mMutex;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslCond YmslMutex.h "YmslMutex.h"
+/// @brief 条件変数を表すクラス
+///
+/// YMSL_USE_THREADS が定義されていない時は何もしない．
+/// その場合 wait() はすぐに戻るので，呼び出し側は待たずに済む
+/// 場合にしか呼ばないようにすること．
+//////////////////////////////////////////////////////////////////////
+class YmslCond
+{
+public:
+
+  /// @brief コンストラクタ
+  YmslCond();
+
+  /// @brief デストラクタ
+  ~YmslCond();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 通知を待つ．
+  /// @param[in] mutex ロックしている YmslMutex
+  ///
+  /// 待っている間は mutex のロックを外す．
+  void
+  wait(YmslMutex& mutex);
+
+  /// @brief 待っている全てのスレッドに通知する．
+  void
+  broadcast();
+
+
+private:
+
+  // コピーは禁止
+  YmslCond(const YmslCond& src);
+
+  // 代入は禁止
+  const YmslCond&
+  operator=(const YmslCond& src);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 実体
+  void* mImpl;
+
+};
+
+
+/// @brief ShString の登録表を守るロックを返す．
+///
+/// 構文解析のように ShString を直接たくさん作る処理は，
+/// これをロックした中で行う．
+/// intern_ShString() もこれをロックするので，ロックした中で
+/// intern_ShString() を呼んではいけない．
+YmslMutex&
+shstring_mutex();
+
+/// @brief 文字列を ShString に登録する．
+/// @param[in] str 文字列
+///
+/// ShString の登録表は複数のスレッドから同時に触れないので，
+/// コンパイル中(構文解析の後)に ShString を作る時は
+/// 必ずこの関数を用いる．
+ShString
+intern_ShString(const char* str);
+
+END_NAMESPACE_YM_YMSL
+
+#endif // YMSLMUTEX_H
@@ -0,0 +1,1004 @@
+#ifndef YMSLOBJ_H
+#define YMSLOBJ_H
+
+/// @file YmslObj.h
+/// @brief YmslObj とその派生クラスのヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "VsmValue.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslObj YmslObj.h "YmslObj.h"
+/// @brief 実行時のオブジェクトの基底クラス
+///
+/// ヘッダは型へのポインタ，種類とフラグを詰めた 32 ビット，
+/// 大きさ(要素数または文字数)の 32 ビットの計 16 バイトしかない．
+/// 仮想関数は持たずに種類で振り分ける．
+///
+/// 文字列と配列は中身をヘッダの直後に置く．
+/// 配列の要素は INT，FLOAT の場合 VsmValue ではなく
+/// Ymsl_INT，Ymsl_FLOAT のまま隙間なく並べる．
+///
+/// オブジェクトは VsmHeap か VsmConstPool が作って解放する．
+/// 定数表の文字列のように実行中に解放しないものには
+/// static フラグを立てておく．
+/// 文字列と配列は VsmHeap が用意した領域の上にも作れる．
+/// その場合は alloc_size() の大きさの領域を new_obj() に渡す．
+//////////////////////////////////////////////////////////////////////
+class YmslObj
+{
+  friend class VsmHeap;
+
+public:
+
+  /// @brief オブジェクトの種類
+  enum Kind {
+    /// @brief 文字列
+    kString,
+    /// @brief 要素が INT の格納クラスの配列
+    kIntArray,
+    /// @brief 要素が FLOAT の配列
+    kFloatArray,
+    /// @brief 要素がオブジェクトの配列
+    kObjArray,
+    /// @brief 集合
+    kSet,
+    /// @brief 連想配列
+    kMap
+  };
+
+  /// @brief 値の格納クラス
+  ///
+  /// 集合と連想配列のキーと値の比較に用いる．
+  enum ValClass {
+    /// @brief INT (boolean, int, enum)
+    kClassInt,
+    /// @brief FLOAT
+    kClassFloat,
+    /// @brief オブジェクト
+    kClassObj
+  };
+
+
+protected:
+
+  /// @brief コンストラクタ
+  /// @param[in] kind 種類
+  /// @param[in] type 型
+  /// @param[in] size 大きさ
+  YmslObj(Kind kind,
+	  const Type* type,
+	  ymuint size);
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 種類を返す．
+  Kind
+  kind() const;
+
+  /// @brief 型を返す．
+  ///
+  /// 文字列の場合は NULL を返す．
+  const Type*
+  type() const;
+
+  /// @brief 大きさを返す．
+  ///
+  /// 文字列は文字数(末尾の '\0' を含まない)，それ以外は要素数
+  ymuint
+  size() const;
+
+  /// @brief 解放しないオブジェクトの時 true を返す．
+  bool
+  is_static() const;
+
+  /// @brief 解放しないオブジェクトにする．
+  void
+  set_static();
+
+  /// @brief ヘッダを含めたオブジェクトの大きさ(バイト数)を返す．
+  ///
+  /// 文字列と配列のみ意味を持つ．
+  ymuint64
+  alloc_size() const;
+
+  /// @brief オブジェクトを解放する．
+  /// @param[in] obj 対象のオブジェクト
+  static
+  void
+  destroy(YmslObj* obj);
+
+  /// @brief 型から値の格納クラスを求める．
+  /// @param[in] type 型
+  static
+  ValClass
+  val_class(const Type* type);
+
+  /// @brief 値のハッシュ値を求める．
+  /// @param[in] val_class 格納クラス
+  /// @param[in] val 値
+  ///
+  /// オブジェクトは hash(const YmslObj*) で内容から求める．
+  static
+  ymuint
+  hash(ValClass val_class,
+       VsmValue val);
+
+  /// @brief 二つの値が等しい時 true を返す．
+  /// @param[in] val_class 格納クラス
+  /// @param[in] val1, val2 値
+  ///
+  /// オブジェクトは equal(const YmslObj*, const YmslObj*) で内容で比べる．
+  static
+  bool
+  equal(ValClass val_class,
+	VsmValue val1,
+	VsmValue val2);
+
+  /// @brief 二つのオブジェクトが等しい時 true を返す．
+  /// @param[in] obj1, obj2 オブジェクト
+  ///
+  /// 文字列，配列，集合，連想配列は内容で比べる．
+  /// どちらかが NULL の場合は両方 NULL の時だけ true を返す．
+  static
+  bool
+  equal(const YmslObj* obj1,
+	const YmslObj* obj2);
+
+  /// @brief オブジェクトのハッシュ値を内容から求める．
+  /// @param[in] obj オブジェクト
+  ///
+  /// equal() が true になるオブジェクトは同じ値になる．
+  /// 集合と連想配列は要素の順序によらない値にする．
+  /// NULL の場合は 0 を返す．
+  static
+  ymuint
+  hash(const YmslObj* obj);
+
+
+protected:
+
+  /// @brief フラグ用のビットの割り当て
+  ///
+  /// 13 ビット目から上はごみ集め用にとっておく．
+  enum Bit {
+    /// @brief 種類を表すビット(0 - 3 ビット目)
+    kKindMask = 15U,
+    /// @brief static フラグ
+    kStaticBit = 1U << 4,
+    /// @brief 集合と連想配列のキーの格納クラスの位置(5 - 6 ビット目)
+    kKeyClassShift = 5,
+    /// @brief 連想配列の値の格納クラスの位置(7 - 8 ビット目)
+    kValueClassShift = 7,
+    /// @brief 格納クラスを表すビット
+    kClassMask = 3U,
+    /// @brief ごみ集めの印
+    kMarkBit = 1U << 9,
+    /// @brief 古い世代に移した後の抜け殻の印
+    kForwardBit = 1U << 10,
+    /// @brief 文字列が連結のノード(ロープ)であることを表す．
+    kRopeBit = 1U << 11,
+    /// @brief 文字列がハッシュ値を覚えていることを表す．
+    kHashBit = 1U << 12
+  };
+
+
+protected:
+  //////////////////////////////////////////////////////////////////////
+  // 継承クラスから用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief フラグ用のビットを返す．
+  ymuint32
+  bits() const;
+
+  /// @brief フラグ用のビットを立てる．
+  /// @param[in] bits 立てるビット
+  void
+  set_bits(ymuint32 bits);
+
+  /// @brief 大きさを設定する．
+  /// @param[in] size 大きさ
+  void
+  set_size(ymuint size);
+
+  /// @brief ヘッダの直後の領域を返す．
+  void*
+  body();
+
+  /// @brief ヘッダの直後の領域を返す．
+  const void*
+  body() const;
+
+  /// @brief ヘッダの直後に size バイトを置いたオブジェクトの領域を確保する．
+  /// @param[in] obj_size オブジェクトの大きさ
+  /// @param[in] size 直後に置くバイト数
+  static
+  void*
+  alloc(ymuint obj_size,
+	ymuint64 size);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // VsmHeap から用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ごみ集めの印がついている時 true を返す．
+  bool
+  is_marked() const;
+
+  /// @brief ごみ集めの印をつける．
+  void
+  set_mark();
+
+  /// @brief ごみ集めの印を消す．
+  void
+  clear_mark();
+
+  /// @brief 古い世代に移した後の抜け殻の時 true を返す．
+  bool
+  is_forwarded() const;
+
+  /// @brief 移した先のオブジェクトを返す．
+  ///
+  /// is_forwarded() が true の時のみ意味を持つ．
+  YmslObj*
+  forward_addr() const;
+
+  /// @brief 移した先のオブジェクトを記録する．
+  /// @param[in] obj 移した先のオブジェクト
+  ///
+  /// 型の代わりに obj を覚えておくので，以降は抜け殻になる．
+  void
+  set_forward(YmslObj* obj);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 型
+  // 抜け殻の場合は移した先のオブジェクト
+  const Type* mType;
+
+  // 種類とフラグ
+  // ビットの割り当ては Bit を参照
+  ymuint32 mBits;
+
+  // 大きさ
+  ymuint32 mSize;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslString YmslObj.h "YmslObj.h"
+/// @brief 文字列を表すクラス
+///
+/// 文字列の実体はヘッダの直後に '\0' で終わる形で置く．
+/// 作った後は変更しない．
+///
+/// 長い文字列の連結は中身を写さずに二つの文字列を指すノード
+/// (YmslRope)を作る．中身は str() で初めて読む時に一つにまとめて
+/// ノードに覚えておく．
+/// 文字数はヘッダに，ハッシュ値は初めて求めた時に覚えておく．
+//////////////////////////////////////////////////////////////////////
+class YmslString :
+  public YmslObj
+{
+  friend class YmslRope;
+
+private:
+
+  /// @brief コンストラクタ
+  /// @param[in] len 文字数
+  YmslString(ymuint len);
+
+
+public:
+
+  /// @brief 文字列を作る．
+  /// @param[in] str 文字列
+  /// @param[in] len 文字数
+  ///
+  /// str は '\0' で終わっていなくてもよい．
+  static
+  YmslString*
+  new_obj(const char* str,
+	  ymuint len);
+
+  /// @brief 二つの文字列をつないだ文字列を作る．
+  /// @param[in] str1, str2 文字列
+  static
+  YmslString*
+  new_obj(const YmslString* str1,
+	  const YmslString* str2);
+
+  /// @brief 確保した領域の上に文字列を作る．
+  /// @param[in] p 領域の先頭
+  /// @param[in] str 文字列
+  /// @param[in] len 文字数
+  ///
+  /// p は alloc_size(len) バイト以上なければならない．
+  static
+  YmslString*
+  new_obj(void* p,
+	  const char* str,
+	  ymuint len);
+
+  /// @brief 確保した領域の上に二つの文字列をつないだ文字列を作る．
+  /// @param[in] p 領域の先頭
+  /// @param[in] str1, str2 文字列
+  ///
+  /// p は alloc_size(str1->size() + str2->size()) バイト以上
+  /// なければならない．
+  static
+  YmslString*
+  new_obj(void* p,
+	  const YmslString* str1,
+	  const YmslString* str2);
+
+  /// @brief 文字列に必要な領域の大きさ(バイト数)を返す．
+  /// @param[in] len 文字数
+  static
+  ymuint64
+  alloc_size(ymuint len);
+
+  /// @brief 二つの文字列の連結を表すノードを作る．
+  /// @param[in] heap ノードを管理するオブジェクト
+  /// @param[in] str1, str2 文字列
+  ///
+  /// 中身は写さずに str1 と str2 を指しておく．
+  /// 中身をまとめた時にそのバイト数を heap に加える．
+  static
+  YmslString*
+  new_rope(VsmHeap* heap,
+	   const YmslString* str1,
+	   const YmslString* str2);
+
+  /// @brief 連結を表すノードの時 true を返す．
+  bool
+  is_rope() const;
+
+  /// @brief 文字列を返す．
+  ///
+  /// 連結を表すノードの場合は初めて呼ばれた時に中身を一つにまとめる．
+  const char*
+  str() const;
+
+  /// @brief ハッシュ値を返す．
+  ///
+  /// 初めて呼ばれた時に求めて覚えておく．
+  /// ただし static な文字列には書き込まない．
+  ymuint
+  hash() const;
+
+  /// @brief 二つの文字列の中身が等しい時 true を返す．
+  /// @param[in] str1, str2 文字列
+  static
+  bool
+  is_equal(const YmslString* str1,
+	   const YmslString* str2);
+
+  /// @brief 辞書順で比較する．
+  /// @param[in] str1, str2 文字列
+  /// @return str1 < str2 なら負，str1 == str2 なら 0，str1 > str2 なら正の数を返す．
+  static
+  int
+  compare(const YmslString* str1,
+	  const YmslString* str2);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief ヘッダの直後の文字列の領域を返す．
+  char*
+  buf();
+
+  /// @brief ヘッダの直後の文字列の領域を返す．
+  const char*
+  buf() const;
+
+  /// @brief 連結を表すノードの中身をまとめた文字列を返す．
+  const char*
+  flat_str() const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // ハッシュ値
+  // 12 ビット目が立っている時のみ意味を持つ．
+  ymuint32 mHash;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslRope YmslObj.h "YmslObj.h"
+/// @brief 二つの文字列の連結を表すノード
+///
+/// 種類は kString で，YmslString として扱う．
+/// 中身をまとめたら mFlat に覚えておき，二つの文字列はもう指さない．
+/// 中身を別に確保するので VsmHeap はナーサリに置かない．
+/// まとめた中身のバイト数は VsmHeap に加えてごみ集めの契機にする．
+//////////////////////////////////////////////////////////////////////
+class YmslRope :
+  public YmslString
+{
+  friend class YmslString;
+  friend class YmslObj;
+  friend class VsmHeap;
+
+private:
+
+  /// @brief コンストラクタ
+  /// @param[in] heap ノードを管理するオブジェクト
+  /// @param[in] str1, str2 文字列
+  YmslRope(VsmHeap* heap,
+	   const YmslString* str1,
+	   const YmslString* str2);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 前半の文字列
+  // 中身をまとめた後は NULL
+  Ymsl_OBJPTR mLeft;
+
+  // 後半の文字列
+  // 中身をまとめた後は NULL
+  Ymsl_OBJPTR mRight;
+
+  // まとめた中身
+  // まとめる前は NULL
+  char* mFlat;
+
+  // ノードを管理するオブジェクト
+  VsmHeap* mHeap;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslArray YmslObj.h "YmslObj.h"
+/// @brief 配列を表すクラス
+///
+/// 要素はヘッダの直後に隙間なく並べる．
+/// 要素の格納クラスによって kIntArray，kFloatArray，kObjArray の
+/// いずれかになり，対応する *_body() だけが使える．
+/// 要素数は作った時に決まる．要素は 0，0.0，NULL で初期化する．
+//////////////////////////////////////////////////////////////////////
+class YmslArray :
+  public YmslObj
+{
+private:
+
+  /// @brief コンストラクタ
+  /// @param[in] kind 種類
+  /// @param[in] type 型
+  /// @param[in] size 要素数
+  YmslArray(Kind kind,
+	    const Type* type,
+	    ymuint size);
+
+
+public:
+
+  /// @brief 配列を作る．
+  /// @param[in] type 配列の型
+  /// @param[in] size 要素数
+  static
+  YmslArray*
+  new_obj(const Type* type,
+	  ymuint size);
+
+  /// @brief 二つの配列をつないだ配列を作る．
+  /// @param[in] array1, array2 配列
+  ///
+  /// 二つは同じ種類でなければならない．
+  static
+  YmslArray*
+  new_obj(const YmslArray* array1,
+	  const YmslArray* array2);
+
+  /// @brief 確保した領域の上に配列を作る．
+  /// @param[in] p 領域の先頭
+  /// @param[in] type 配列の型
+  /// @param[in] size 要素数
+  ///
+  /// p は alloc_size(type, size) バイト以上なければならない．
+  static
+  YmslArray*
+  new_obj(void* p,
+	  const Type* type,
+	  ymuint size);
+
+  /// @brief 確保した領域の上に二つの配列をつないだ配列を作る．
+  /// @param[in] p 領域の先頭
+  /// @param[in] array1, array2 配列
+  ///
+  /// p は alloc_size(array1->type(), array1->size() + array2->size())
+  /// バイト以上なければならない．
+  static
+  YmslArray*
+  new_obj(void* p,
+	  const YmslArray* array1,
+	  const YmslArray* array2);
+
+  /// @brief 配列に必要な領域の大きさ(バイト数)を返す．
+  /// @param[in] type 配列の型
+  /// @param[in] size 要素数
+  static
+  ymuint64
+  alloc_size(const Type* type,
+	     ymuint size);
+
+  /// @brief INT の要素の配列の先頭を返す．
+  Ymsl_INT*
+  int_body();
+
+  /// @brief INT の要素の配列の先頭を返す．
+  const Ymsl_INT*
+  int_body() const;
+
+  /// @brief FLOAT の要素の配列の先頭を返す．
+  Ymsl_FLOAT*
+  float_body();
+
+  /// @brief FLOAT の要素の配列の先頭を返す．
+  const Ymsl_FLOAT*
+  float_body() const;
+
+  /// @brief オブジェクトの要素の配列の先頭を返す．
+  Ymsl_OBJPTR*
+  obj_body();
+
+  /// @brief オブジェクトの要素の配列の先頭を返す．
+  const Ymsl_OBJPTR*
+  obj_body() const;
+
+  /// @brief 要素一つのバイト数を返す．
+  ymuint
+  elem_size() const;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class YmslSet YmslObj.h "YmslObj.h"
+/// @brief 集合と連想配列を表すクラス
+///
+/// オープンアドレス法のハッシュ表で，キー(連想配列の場合は値も)を
+/// VsmValue のまま持つ．表の大きさは 2 のべき乗で，
+/// 要素数が半分を越えたら倍にする．
+/// 要素の削除はできない．演算の結果は新しいオブジェクトとして作る．
+/// キーのハッシュ値と比較はどちらも内容で行うので，
+/// ごみ集めでキーが動いても表を作り直す必要はない．
+//////////////////////////////////////////////////////////////////////
+class YmslSet :
+  public YmslObj
+{
+  friend class VsmHeap;
+
+private:
+
+  /// @brief コンストラクタ
+  /// @param[in] kind 種類 ( kSet か kMap )
+  /// @param[in] type 型
+  YmslSet(Kind kind,
+	  const Type* type);
+
+
+public:
+
+  /// @brief 空の集合か連想配列を作る．
+  /// @param[in] type 型
+  ///
+  /// type が map 型なら連想配列，set 型なら集合を作る．
+  static
+  YmslSet*
+  new_obj(const Type* type);
+
+  /// @brief 領域を解放する．
+  ///
+  /// YmslObj::destroy() から呼ばれる．
+  void
+  free_table();
+
+  /// @brief キーの格納クラスを返す．
+  ValClass
+  key_class() const;
+
+  /// @brief 値の格納クラスを返す．
+  ///
+  /// 連想配列のみ意味を持つ．
+  ValClass
+  value_class() const;
+
+  /// @brief キーを探す．
+  /// @param[in] key キー
+  /// @return 見つかったら表の位置を，見つからなければ -1 を返す．
+  int
+  find(VsmValue key) const;
+
+  /// @brief キーを加える．
+  /// @param[in] key キー
+  /// @return 表の位置を返す．
+  ///
+  /// 連想配列の場合，新たに加えたキーの値は 0 になる．
+  ymuint
+  insert(VsmValue key);
+
+  /// @brief キーと値を加える．
+  /// @param[in] key キー
+  /// @param[in] value 値
+  ///
+  /// 連想配列のみ有効．すでにキーがある場合は値を置き換える．
+  void
+  insert(VsmValue key,
+	 VsmValue value);
+
+  /// @brief 表の大きさを返す．
+  ymuint
+  table_size() const;
+
+  /// @brief 表の位置が使われている時 true を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < table_size() )
+  bool
+  is_used(ymuint pos) const;
+
+  /// @brief キーを返す．
+  /// @param[in] pos 位置 ( 0 <= pos < table_size() )
+  VsmValue
+  key(ymuint pos) const;
+
+  /// @brief 値を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < table_size() )
+  ///
+  /// 連想配列のみ有効
+  VsmValue
+  value(ymuint pos) const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 表を確保する．
+  /// @param[in] size 表の大きさ
+  void
+  alloc_table(ymuint size);
+
+  /// @brief 表を確保し直して要素を入れ直す．
+  /// @param[in] size 新しい表の大きさ
+  void
+  resize_table(ymuint size);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 表の大きさ
+  ymuint32 mTableSize;
+
+  // 使われているかどうかを表す配列
+  ymuint8* mUsedTable;
+
+  // キーの配列
+  VsmValue* mKeyTable;
+
+  // 値の配列
+  // 集合の場合は NULL
+  VsmValue* mValueTable;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// インライン関数の定義
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] kind 種類
+// @param[in] type 型
+// @param[in] size 大きさ
+inline
+YmslObj::YmslObj(Kind kind,
+		 const Type* type,
+		 ymuint size) :
+  mType(type),
+  mBits(static_cast<ymuint32>(kind)),
+  mSize(size)
+{
+}
+
+// @brief 種類を返す．
+inline
+YmslObj::Kind
+YmslObj::kind() const
+{
+  return static_cast<Kind>(mBits & kKindMask);
+}
+
+// @brief 型を返す．
+inline
+const Type*
+YmslObj::type() const
+{
+  return mType;
+}
+
+// @brief 大きさを返す．
+inline
+ymuint
+YmslObj::size() const
+{
+  return mSize;
+}
+
+// @brief 解放しないオブジェクトの時 true を返す．
+inline
+bool
+YmslObj::is_static() const
+{
+  return (mBits & kStaticBit) != 0U;
+}
+
+// @brief 解放しないオブジェクトにする．
+inline
+void
+YmslObj::set_static()
+{
+  mBits |= kStaticBit;
+}
+
+// @brief ごみ集めの印がついている時 true を返す．
+inline
+bool
+YmslObj::is_marked() const
+{
+  return (mBits & kMarkBit) != 0U;
+}
+
+// @brief ごみ集めの印をつける．
+inline
+void
+YmslObj::set_mark()
+{
+  mBits |= kMarkBit;
+}
+
+// @brief ごみ集めの印を消す．
+inline
+void
+YmslObj::clear_mark()
+{
+  mBits &= ~static_cast<ymuint32>(kMarkBit);
+}
+
+// @brief 古い世代に移した後の抜け殻の時 true を返す．
+inline
+bool
+YmslObj::is_forwarded() const
+{
+  return (mBits & kForwardBit) != 0U;
+}
+
+// @brief 移した先のオブジェクトを返す．
+inline
+YmslObj*
+YmslObj::forward_addr() const
+{
+  return reinterpret_cast<YmslObj*>(const_cast<Type*>(mType));
+}
+
+// @brief 移した先のオブジェクトを記録する．
+// @param[in] obj 移した先のオブジェクト
+inline
+void
+YmslObj::set_forward(YmslObj* obj)
+{
+  mType = reinterpret_cast<const Type*>(obj);
+  mBits |= kForwardBit;
+}
+
+// @brief フラグ用のビットを返す．
+inline
+ymuint32
+YmslObj::bits() const
+{
+  return mBits;
+}
+
+// @brief フラグ用のビットを立てる．
+inline
+void
+YmslObj::set_bits(ymuint32 bits)
+{
+  mBits |= bits;
+}
+
+// @brief 大きさを設定する．
+inline
+void
+YmslObj::set_size(ymuint size)
+{
+  mSize = size;
+}
+
+// @brief ヘッダの直後の領域を返す．
+inline
+void*
+YmslObj::body()
+{
+  return reinterpret_cast<ymuint8*>(this) + sizeof(YmslObj);
+}
+
+// @brief ヘッダの直後の領域を返す．
+inline
+const void*
+YmslObj::body() const
+{
+  return reinterpret_cast<const ymuint8*>(this) + sizeof(YmslObj);
+}
+
+// @brief 連結を表すノードの時 true を返す．
+inline
+bool
+YmslString::is_rope() const
+{
+  return (bits() & kRopeBit) != 0U;
+}
+
+// @brief 文字列を返す．
+inline
+const char*
+YmslString::str() const
+{
+  if ( is_rope() ) {
+    return flat_str();
+  }
+  return buf();
+}
+
+// @brief ヘッダの直後の文字列の領域を返す．
+inline
+char*
+YmslString::buf()
+{
+  return reinterpret_cast<char*>(this) + sizeof(YmslString);
+}
+
+// @brief ヘッダの直後の文字列の領域を返す．
+inline
+const char*
+YmslString::buf() const
+{
+  return reinterpret_cast<const char*>(this) + sizeof(YmslString);
+}
+
+// @brief INT の要素の配列の先頭を返す．
+inline
+Ymsl_INT*
+YmslArray::int_body()
+{
+  return static_cast<Ymsl_INT*>(body());
+}
+
+// @brief INT の要素の配列の先頭を返す．
+inline
+const Ymsl_INT*
+YmslArray::int_body() const
+{
+  return static_cast<const Ymsl_INT*>(body());
+}
+
+// @brief FLOAT の要素の配列の先頭を返す．
+inline
+Ymsl_FLOAT*
+YmslArray::float_body()
+{
+  return static_cast<Ymsl_FLOAT*>(body());
+}
+
+// @brief FLOAT の要素の配列の先頭を返す．
+inline
+const Ymsl_FLOAT*
+YmslArray::float_body() const
+{
+  return static_cast<const Ymsl_FLOAT*>(body());
+}
+
+// @brief オブジェクトの要素の配列の先頭を返す．
+inline
+Ymsl_OBJPTR*
+YmslArray::obj_body()
+{
+  return static_cast<Ymsl_OBJPTR*>(body());
+}
+
+// @brief オブジェクトの要素の配列の先頭を返す．
+inline
+const Ymsl_OBJPTR*
+YmslArray::obj_body() const
+{
+  return static_cast<const Ymsl_OBJPTR*>(body());
+}
+
+// @brief キーの格納クラスを返す．
+inline
+YmslObj::ValClass
+YmslSet::key_class() const
+{
+  return static_cast<ValClass>((bits() >> kKeyClassShift) & kClassMask);
+}
+
+// @brief 値の格納クラスを返す．
+inline
+YmslObj::ValClass
+YmslSet::value_class() const
+{
+  return static_cast<ValClass>((bits() >> kValueClassShift) & kClassMask);
+}
+
+// @brief 表の大きさを返す．
+inline
+ymuint
+YmslSet::table_size() const
+{
+  return mTableSize;
+}
+
+// @brief 表の位置が使われている時 true を返す．
+inline
+bool
+YmslSet::is_used(ymuint pos) const
+{
+  return mUsedTable[pos] != 0;
+}
+
+// @brief キーを返す．
+inline
+VsmValue
+YmslSet::key(ymuint pos) const
+{
+  return mKeyTable[pos];
+}
+
+// @brief 値を返す．
+inline
+VsmValue
+YmslSet::value(ymuint pos) const
+{
+  return mValueTable[pos];
+}
+
+END_NAMESPACE_YM_YMSL
+
+#endif // YMSLOBJ_H
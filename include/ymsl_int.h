@@ -30,18 +30,28 @@ END_NAMESPACE_YM
 BEGIN_NAMESPACE_YM_YMSL
 
 class YmslObj;
+class YmslString;
+class YmslRope;
+class YmslArray;
+class YmslSet;
 class YmslCompiler;
 
 class Vsm;
+class VsmBinReader;
+class VsmBinWriter;
 class VsmCodeList;
+class VsmRegCodeList;
 class VsmFunction;
+class VsmHeap;
 class VsmModule;
 class VsmVar;
 
 class IrCodeBlock;
 class IrFuncBlock;
 class IrHandle;
+class IrMgr;
 class IrNode;
+class IrSsa;
 class IrToplevel;
 
 class Scope;
@@ -12,6 +12,7 @@
 #include "YmslScanner.h"
 #include "AstList.h"
 #include "AstSymbol.h"
+#include "YmslMutex.h"
 
 #include "expr/AstArrayRef.h"
 #include "expr/AstBinOp.h"
@@ -73,6 +74,7 @@ BEGIN_NAMESPACE_YM_YMSL
 AstMgr::AstMgr(bool debug)
 {
   mScanner = NULL;
+  mError = false;
   mDebug = debug;
 }
 
@@ -89,15 +91,21 @@ AstMgr::read_source(IDO& ido)
 {
   int yyparser(AstMgr&);
 
+  // 構文解析で作る ShString は intern_ShString() を通さないので，
+  // 他のスレッドのコンパイルと同時に登録表を触らないようにする．
+  YmslLock lock(shstring_mutex());
+
   mScanner = new YmslScanner(ido);
   mToplevel = NULL;
+  mError = false;
 
   int stat = yyparse(*this);
 
   delete mScanner;
   mScanner = NULL;
 
-  return (stat == 0);
+  // エラー回復した部分は NULL になっているので使えない．
+  return (stat == 0) && !mError;
 }
 
 // @brief トップレベルのASTを返す．
@@ -185,6 +193,13 @@ AstMgr::scan(YYSTYPE& lval,
   return id;
 }
 
+// @brief 構文エラーが起きたことを記録する．
+void
+AstMgr::set_error()
+{
+  mError = true;
+}
+
 // @brief import 文を作る．
 // @param[in] module モジュール名
 // @param[in] alias エイリアス
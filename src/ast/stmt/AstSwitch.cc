@@ -44,6 +44,17 @@ AstSwitch::stmt_type() const
   return kSwitch;
 }
 
+// @brief 式を返す．
+//
+// kAssignment,
+// kDoWhile, kFor, kIf, kWhile, kSwitch
+// kExprStmt, kReturn, kVarDecl のみ有効
+const AstExpr*
+AstSwitch::expr() const
+{
+  return mExpr;
+}
+
 // @brief switch 文の case 数を返す．
 //
 // kSwitch のみ有効
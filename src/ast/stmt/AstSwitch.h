@@ -48,6 +48,15 @@ public:
   Type
   stmt_type() const;
 
+  /// @brief 式を返す．
+  ///
+  /// kAssignment,
+  /// kDoWhile, kFor, kIf, kWhile, kSwitch
+  /// kExprStmt, kReturn, kVarDecl のみ有効
+  virtual
+  const AstExpr*
+  expr() const;
+
   /// @brief switch 文の case 数を返す．
   ///
   /// kSwitch のみ有効
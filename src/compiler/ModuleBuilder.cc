@@ -0,0 +1,382 @@
+
+/// @file ModuleBuilder.cc
+/// @brief ModuleBuilder の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ModuleBuilder.h"
+#include "YmslCompiler.h"
+#include "ModuleRegistry.h"
+#include "VsmModule.h"
+#include "AstMgr.h"
+#include "AstStatement.h"
+#include "AstSymbol.h"
+
+#include "YmUtils/FileIDO.h"
+
+#if defined(YMSL_USE_THREADS)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス ModuleBuilder::Job
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+ModuleBuilder::Job::Job(ShString name) :
+  mName(name),
+  mAstMgr(NULL),
+  mWaitNum(0),
+  mFailed(false),
+  mVisiting(false)
+{
+}
+
+// @brief デストラクタ
+ModuleBuilder::Job::~Job()
+{
+  delete mAstMgr;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス ModuleBuilder
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] compiler コンパイラ
+ModuleBuilder::ModuleBuilder(YmslCompiler& compiler) :
+  mCompiler(compiler),
+  mRestNum(0)
+{
+}
+
+// @brief デストラクタ
+ModuleBuilder::~ModuleBuilder()
+{
+  for (vector<Job*>::iterator p = mJobList.begin();
+       p != mJobList.end(); ++ p) {
+    delete *p;
+  }
+}
+
+// @brief モジュールを用意する．
+// @param[in] name_list モジュール名のリスト
+// @param[in] thread_num スレッド数
+// @return 全て用意できたら true を返す．
+bool
+ModuleBuilder::build(const vector<ShString>& name_list,
+		     ymuint thread_num)
+{
+  bool ok = true;
+  for (vector<ShString>::const_iterator p = name_list.begin();
+       p != name_list.end(); ++ p) {
+    Job* job = discover(*p);
+    if ( job != NULL && job->mFailed ) {
+      ok = false;
+    }
+  }
+
+  // import しているモジュールがないものから始める．
+  // 失敗したジョブも取り出されて，import している側に失敗を伝える．
+  mRestNum = mJobList.size();
+  for (vector<Job*>::iterator p = mJobList.begin();
+       p != mJobList.end(); ++ p) {
+    Job* job = *p;
+    if ( job->mWaitNum == 0 ) {
+      mReadyList.push_back(job);
+    }
+  }
+
+#if defined(YMSL_USE_THREADS)
+  if ( thread_num == 0 ) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_num = n > 0 ? n : 1;
+  }
+  if ( thread_num > mJobList.size() ) {
+    thread_num = mJobList.size();
+  }
+  // 呼び出したスレッドも一緒に働く．
+  vector<pthread_t> thread_list;
+  for (ymuint i = 1; i < thread_num; ++ i) {
+    pthread_t thread;
+    if ( pthread_create(&thread, NULL, thread_main, this) != 0 ) {
+      // 作れなかった分は残りのスレッドでこなす．
+      break;
+    }
+    thread_list.push_back(thread);
+  }
+  run();
+  for (vector<pthread_t>::iterator p = thread_list.begin();
+       p != thread_list.end(); ++ p) {
+    pthread_join(*p, NULL);
+  }
+#else
+  run();
+#endif
+
+  for (vector<ShString>::const_iterator p = name_list.begin();
+       p != name_list.end(); ++ p) {
+    if ( mCompiler.find_module(*p) == NULL ) {
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// @brief import しているモジュール名のリストを得る．
+// @param[in] ast_root 抽象構文木の根のノード
+// @param[out] name_list モジュール名を格納するリスト
+void
+ModuleBuilder::get_import_list(const AstStatement* ast_root,
+			       vector<ShString>& name_list)
+{
+  ymuint head_num = ast_root->headlist_num();
+  for (ymuint i = 0; i < head_num; ++ i) {
+    const AstStatement* stmt = ast_root->headlist_elem(i);
+    if ( stmt->stmt_type() == AstStatement::kImport ) {
+      name_list.push_back(stmt->import_module()->str_val());
+    }
+  }
+}
+
+// @brief 依存関係をたどってジョブを作る．
+// @param[in] name モジュール名
+// @return ジョブを返す．
+ModuleBuilder::Job*
+ModuleBuilder::discover(ShString name)
+{
+  if ( mCompiler.find_module(name) != NULL ) {
+    return NULL;
+  }
+
+  Job* job;
+  if ( mJobDict.find(name, job) ) {
+    if ( job->mVisiting ) {
+      cout << "circular import of " << name << endl;
+      job->mFailed = true;
+    }
+    return job;
+  }
+
+  job = new Job(name);
+  mJobList.push_back(job);
+  mJobDict.add(name, job);
+
+  // .ymc の読み込みから入れ子で呼ばれた場合の循環も検出する．
+  vector<ShString>& visiting_list = mCompiler.mVisitingList;
+  for (vector<ShString>::iterator p = visiting_list.begin();
+       p != visiting_list.end(); ++ p) {
+    if ( *p == name ) {
+      cout << "circular import of " << name << endl;
+      job->mFailed = true;
+      return job;
+    }
+  }
+
+  job->mVisiting = true;
+  visiting_list.push_back(name);
+
+  VsmModuleFile module_file(mCompiler, mCompiler.mTypeMgr);
+  ModuleRegistry& registry = ModuleRegistry::the_registry();
+  string body = static_cast<const char*>(name);
+  for ( ; ; ) {
+    // 実はループじゃないけど break を使いたいので
+    PathName path = body + ".ym";
+    // サーチパスを考慮してファイルを探す．
+    PathName fullpath = mCompiler.mPathList.search(path);
+    if ( !fullpath.is_valid() ) {
+      break;
+    }
+    string src_path = fullpath.str();
+    string cache_path = src_path + "c";
+    bool has_info = VsmModuleFile::stat_source(src_path, job->mSrcInfo) &&
+      VsmModuleFile::hash_source(src_path, job->mSrcInfo.mHash) &&
+      ModuleRegistry::canonical_path(src_path, job->mCanonPath);
+    if ( has_info ) {
+      // 他の YmslCompiler が作ったモジュールを探す．
+      VsmModule* module = registry.find(job->mCanonPath, job->mSrcInfo.mHash);
+      if ( module != NULL ) {
+	if ( check_imports(module) ) {
+	  mCompiler.reg_module(name, module, job->mCanonPath, job->mSrcInfo);
+	  break;
+	}
+	registry.release(module);
+      }
+      module = module_file.read(cache_path, src_path);
+      if ( module != NULL ) {
+	module = registry.reg(job->mCanonPath, job->mSrcInfo.mHash, module);
+	mCompiler.reg_module(name, module, job->mCanonPath, job->mSrcInfo);
+	break;
+      }
+      job->mSrcPath = cache_path;
+    }
+    else {
+      job->mCanonPath = string();
+    }
+
+    FileIDO ido;
+    bool stat = ido.open(src_path);
+    ASSERT_COND( stat );
+    job->mAstMgr = new AstMgr;
+    if ( !job->mAstMgr->read_source(ido) ) {
+      job->mFailed = true;
+      break;
+    }
+
+    vector<ShString> import_list;
+    get_import_list(job->mAstMgr->toplevel(), import_list);
+    for (vector<ShString>::iterator p = import_list.begin();
+	 p != import_list.end(); ++ p) {
+      Job* sub_job = discover(*p);
+      if ( sub_job == NULL ) {
+	continue;
+      }
+      if ( sub_job->mFailed ) {
+	job->mFailed = true;
+	break;
+      }
+      sub_job->mFanoutList.push_back(job);
+      ++ job->mWaitNum;
+    }
+    break;
+  }
+
+  if ( job->mAstMgr == NULL && mCompiler.find_module(name) == NULL ) {
+    // ソースがない場合は .ymc をそのまま使う．
+    PathName path = body + ".ymc";
+    PathName fullpath = mCompiler.mPathList.search(path);
+    VsmModule* module = NULL;
+    if ( fullpath.is_valid() ) {
+      module = module_file.read(fullpath.str(), string());
+    }
+    else {
+      cout << body << ".ym not found" << endl;
+    }
+    if ( module != NULL ) {
+      mCompiler.reg_module(name, module);
+    }
+    else {
+      job->mFailed = true;
+    }
+  }
+
+  visiting_list.pop_back();
+  job->mVisiting = false;
+  return job;
+}
+
+// @brief 登録されていたモジュールが今の import と合っているか調べる．
+// @param[in] module 対象のモジュール
+// @return 合っていたら true を返す．
+bool
+ModuleBuilder::check_imports(VsmModule* module)
+{
+  for (ymuint i = 0; i < module->imported_module_num(); ++ i) {
+    VsmModule* sub_module = module->imported_module(i);
+    ShString sub_name = sub_module->name();
+    // コンパイルし直す必要がある場合は find_module() が NULL を返す．
+    discover(sub_name);
+    if ( mCompiler.find_module(sub_name) != sub_module ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @brief 実行可能なジョブを取り出す．
+ModuleBuilder::Job*
+ModuleBuilder::get_job()
+{
+  YmslLock lock(mMutex);
+  // import の関係は DAG なので，終わっていないジョブがあれば
+  // いずれ mReadyList に入る．
+  while ( mReadyList.empty() && mRestNum > 0 ) {
+    mCond.wait(mMutex);
+  }
+  if ( mReadyList.empty() ) {
+    return NULL;
+  }
+  Job* job = mReadyList.back();
+  mReadyList.pop_back();
+  return job;
+}
+
+// @brief ジョブの終了を記録する．
+// @param[in] job 終わったジョブ
+void
+ModuleBuilder::finish_job(Job* job)
+{
+  YmslLock lock(mMutex);
+  for (vector<Job*>::iterator p = job->mFanoutList.begin();
+       p != job->mFanoutList.end(); ++ p) {
+    Job* job1 = *p;
+    if ( job->mFailed ) {
+      job1->mFailed = true;
+    }
+    -- job1->mWaitNum;
+    if ( job1->mWaitNum == 0 ) {
+      mReadyList.push_back(job1);
+    }
+  }
+  -- mRestNum;
+  mCond.broadcast();
+}
+
+// @brief ジョブがなくなるまで実行する．
+void
+ModuleBuilder::run()
+{
+  for ( ; ; ) {
+    Job* job = get_job();
+    if ( job == NULL ) {
+      break;
+    }
+    if ( !job->mFailed && job->mAstMgr != NULL ) {
+      VsmModule* module = mCompiler.compile_ast(job->mAstMgr->toplevel(),
+						job->mName);
+      if ( module != NULL ) {
+	if ( job->mSrcPath != string() ) {
+	  // 書き出せなくてもエラーにはしない．
+	  VsmModuleFile module_file(mCompiler, mCompiler.mTypeMgr);
+	  module_file.write(job->mSrcPath, *module, job->mSrcInfo);
+	}
+	if ( job->mCanonPath != string() ) {
+	  // 同時に同じモジュールを作った YmslCompiler があれば
+	  // そちらに置き換わる．
+	  module = ModuleRegistry::the_registry().reg(job->mCanonPath,
+						      job->mSrcInfo.mHash,
+						      module);
+	}
+	mCompiler.reg_module(job->mName, module, job->mCanonPath,
+			     job->mSrcInfo);
+      }
+      else {
+	job->mFailed = true;
+      }
+      // 構文木はもう要らない．
+      delete job->mAstMgr;
+      job->mAstMgr = NULL;
+    }
+    finish_job(job);
+  }
+}
+
+// @brief スレッドの本体
+// @param[in] arg ModuleBuilder へのポインタ
+void*
+ModuleBuilder::thread_main(void* arg)
+{
+  ModuleBuilder* builder = static_cast<ModuleBuilder*>(arg);
+  builder->run();
+  return NULL;
+}
+
+END_NAMESPACE_YM_YMSL
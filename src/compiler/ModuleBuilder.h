@@ -0,0 +1,193 @@
+#ifndef MODULEBUILDER_H
+#define MODULEBUILDER_H
+
+/// @file ModuleBuilder.h
+/// @brief ModuleBuilder のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "YmslMutex.h"
+#include "VsmModuleFile.h"
+#include "YmUtils/ShString.h"
+#include "YmUtils/HashMap.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class ModuleBuilder ModuleBuilder.h "ModuleBuilder.h"
+/// @brief import しているモジュールをまとめて用意するクラス
+///
+/// まず指定されたモジュールから import 文をたどって依存関係の DAG を
+/// 作る．この間の構文解析と .ymc の読み込みは呼び出したスレッドで
+/// 順に行う．
+/// 次に import しているモジュールが全て揃ったものから順に
+/// 中間表現の生成，最適化，コード生成を行う．
+/// 互いに依存しないモジュールは複数のスレッドで並列に処理する．
+/// 出来上がったモジュールは YmslCompiler に名前で登録するので，
+/// elaborate 中の import はそれを引くだけで済む．
+/// ソースファイルの内容が同じモジュールが ModuleRegistry にあれば
+/// .ymc の読み込みやコンパイルをせずにそれを使う．
+//////////////////////////////////////////////////////////////////////
+class ModuleBuilder
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] compiler コンパイラ
+  ModuleBuilder(YmslCompiler& compiler);
+
+  /// @brief デストラクタ
+  ~ModuleBuilder();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief モジュールを用意する．
+  /// @param[in] name_list モジュール名のリスト
+  /// @param[in] thread_num スレッド数
+  /// @return 全て用意できたら true を返す．
+  ///
+  /// 用意したモジュールは YmslCompiler に登録される．
+  /// thread_num が 0 の場合は CPU の数を用いる．
+  bool
+  build(const vector<ShString>& name_list,
+	ymuint thread_num);
+
+  /// @brief import しているモジュール名のリストを得る．
+  /// @param[in] ast_root 抽象構文木の根のノード
+  /// @param[out] name_list モジュール名を格納するリスト
+  static
+  void
+  get_import_list(const AstStatement* ast_root,
+		  vector<ShString>& name_list);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられるデータ構造
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 一つのモジュールのコンパイルを表す構造体
+  struct Job
+  {
+    /// @brief コンストラクタ
+    Job(ShString name);
+
+    /// @brief デストラクタ
+    ~Job();
+
+    // モジュール名
+    ShString mName;
+
+    // 構文解析の結果
+    AstMgr* mAstMgr;
+
+    // .ymc に書き出す時の元のソースファイルのパス
+    // 空なら書き出さない．
+    string mSrcPath;
+
+    // 元のソースファイルの情報
+    VsmModuleFile::SourceInfo mSrcInfo;
+
+    // ModuleRegistry に登録する時の正規化したパス
+    // 空なら登録しない．
+    string mCanonPath;
+
+    // このモジュールを import しているジョブのリスト
+    vector<Job*> mFanoutList;
+
+    // 終わっていない import の数
+    ymuint mWaitNum;
+
+    // 失敗した時 true にするフラグ
+    bool mFailed;
+
+    // 依存関係をたどっている最中に true にするフラグ
+    bool mVisiting;
+  };
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 依存関係をたどってジョブを作る．
+  /// @param[in] name モジュール名
+  /// @return ジョブを返す．
+  ///
+  /// すでにモジュールが用意されている場合は NULL を返す．
+  /// エラーが起きた場合は mFailed が true のジョブを返す．
+  Job*
+  discover(ShString name);
+
+  /// @brief 登録されていたモジュールが今の import と合っているか調べる．
+  /// @param[in] module 対象のモジュール
+  /// @return 合っていたら true を返す．
+  ///
+  /// ModuleRegistry から引いたモジュールが import しているモジュールを
+  /// このコンパイラのサーチパスでたどり直して，同じものになるか調べる．
+  bool
+  check_imports(VsmModule* module);
+
+  /// @brief 実行可能なジョブを取り出す．
+  ///
+  /// 全てのジョブが終わっていたら NULL を返す．
+  Job*
+  get_job();
+
+  /// @brief ジョブの終了を記録する．
+  /// @param[in] job 終わったジョブ
+  void
+  finish_job(Job* job);
+
+  /// @brief ジョブがなくなるまで実行する．
+  void
+  run();
+
+  /// @brief スレッドの本体
+  /// @param[in] arg ModuleBuilder へのポインタ
+  static
+  void*
+  thread_main(void* arg);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // コンパイラ
+  YmslCompiler& mCompiler;
+
+  // ジョブのリスト
+  vector<Job*> mJobList;
+
+  // モジュール名をキーにしてジョブを保持するハッシュ表
+  HashMap<ShString, Job*> mJobDict;
+
+  // 実行可能なジョブのリスト
+  vector<Job*> mReadyList;
+
+  // 終わっていないジョブの数
+  ymuint mRestNum;
+
+  // mReadyList と mRestNum 用のロック
+  YmslMutex mMutex;
+
+  // mReadyList に追加されたことを通知する条件変数
+  YmslCond mCond;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // MODULEBUILDER_H
@@ -0,0 +1,343 @@
+
+/// @file ModuleRegistry.cc
+/// @brief ModuleRegistry の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ModuleRegistry.h"
+#include "VsmModule.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス ModuleRegistry
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+ModuleRegistry::ModuleRegistry()
+{
+}
+
+// @brief デストラクタ
+//
+// 参照が残っているものも含めてモジュールを全て削除する．
+ModuleRegistry::~ModuleRegistry()
+{
+  for (vector<Entry*>::iterator p = mEntryList.begin();
+       p != mEntryList.end(); ++ p) {
+    Entry* entry = *p;
+    delete entry->mModule;
+    delete entry;
+  }
+}
+
+// @brief プロセス全体で共有するインスタンスを返す．
+ModuleRegistry&
+ModuleRegistry::the_registry()
+{
+  static ModuleRegistry the_registry;
+  return the_registry;
+}
+
+// @brief 型を管理するオブジェクトを返す．
+TypeMgr&
+ModuleRegistry::type_mgr()
+{
+  return mTypeMgr;
+}
+
+// @brief モジュールを探す．
+// @param[in] path ソースファイルの正規化したパス
+// @param[in] hash ソースファイルの内容のハッシュ値
+// @return モジュールを返す．
+VsmModule*
+ModuleRegistry::find(const string& path,
+		     ymuint64 hash)
+{
+  ShString key = intern_ShString(path.c_str());
+  YmslLock lock(mMutex);
+  Entry* entry;
+  if ( mEntryDict.find(key, entry) && entry->mHash == hash ) {
+    ++ entry->mRefCount;
+    return entry->mModule;
+  }
+  return NULL;
+}
+
+// @brief モジュールを登録する．
+// @param[in] path ソースファイルの正規化したパス
+// @param[in] hash ソースファイルの内容のハッシュ値
+// @param[in] module モジュール
+// @return 登録されたモジュールを返す．
+VsmModule*
+ModuleRegistry::reg(const string& path,
+		    ymuint64 hash,
+		    VsmModule* module)
+{
+  ShString key = intern_ShString(path.c_str());
+  YmslLock lock(mMutex);
+  Entry* entry;
+  if ( mEntryDict.find(key, entry) ) {
+    if ( entry->mHash == hash ) {
+      if ( same_imports(entry->mModule, module) ) {
+	// 先に登録された方を使う．
+	// module はまだ誰も参照していないので削除してよい．
+	delete module;
+	++ entry->mRefCount;
+	return entry->mModule;
+      }
+      // サーチパスの違いで別のモジュールを import している．
+      // 先に登録された方を残し，module は引けないようにしておく．
+      add_entry(key, hash, module, false);
+      return module;
+    }
+    // ソースファイルが変更されている．
+    remove(entry);
+  }
+
+  add_entry(key, hash, module, true);
+  return module;
+}
+
+// @brief モジュールを無効にする．
+// @param[in] path ソースファイルのパス
+// @return 無効にしたモジュールがあれば true を返す．
+bool
+ModuleRegistry::invalidate(const string& path)
+{
+  // ファイルが削除されている場合は正規化できないのでそのまま使う．
+  string canon_path;
+  if ( !canonical_path(path, canon_path) ) {
+    canon_path = path;
+  }
+  ShString key = intern_ShString(canon_path.c_str());
+  YmslLock lock(mMutex);
+  Entry* entry;
+  if ( !mEntryDict.find(key, entry) ) {
+    return false;
+  }
+  remove(entry);
+  return true;
+}
+
+// @brief 全てのモジュールを無効にする．
+void
+ModuleRegistry::invalidate_all()
+{
+  YmslLock lock(mMutex);
+  for (vector<Entry*>::iterator p = mEntryList.begin();
+       p != mEntryList.end(); ++ p) {
+    Entry* entry = *p;
+    if ( entry->mValid ) {
+      entry->mValid = false;
+      -- entry->mRefCount;
+    }
+  }
+  mEntryDict.clear();
+  sweep();
+}
+
+// @brief モジュールの参照を一つ減らす．
+// @param[in] module モジュール
+void
+ModuleRegistry::release(VsmModule* module)
+{
+  YmslLock lock(mMutex);
+  Entry* entry;
+  if ( !mModuleDict.find(module, entry) ) {
+    return;
+  }
+  ASSERT_COND( entry->mRefCount > 0 );
+  -- entry->mRefCount;
+  if ( entry->mRefCount == 0 ) {
+    sweep();
+  }
+}
+
+// @brief 削除されずに残っているモジュールの数を返す．
+ymuint
+ModuleRegistry::module_num()
+{
+  YmslLock lock(mMutex);
+  return mEntryList.size();
+}
+
+// @brief パスを正規化する．
+// @param[in] path パス
+// @param[out] canon_path 正規化したパス
+// @return ファイルが存在しない場合は false を返す．
+bool
+ModuleRegistry::canonical_path(const string& path,
+			       string& canon_path)
+{
+  char buf[PATH_MAX];
+  if ( realpath(path.c_str(), buf) == NULL ) {
+    return false;
+  }
+  canon_path = buf;
+  return true;
+}
+
+// @brief 二つのモジュールが同じモジュールを import しているか調べる．
+// @param[in] module1, module2 対象のモジュール
+bool
+ModuleRegistry::same_imports(const VsmModule* module1,
+			     const VsmModule* module2)
+{
+  ymuint n = module1->imported_module_num();
+  if ( module2->imported_module_num() != n ) {
+    return false;
+  }
+  for (ymuint i = 0; i < n; ++ i) {
+    if ( module1->imported_module(i) != module2->imported_module(i) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @brief エントリを追加する．
+// @param[in] path 正規化したパス
+// @param[in] hash ハッシュ値
+// @param[in] module モジュール
+// @param[in] valid 登録して引けるようにする時 true
+void
+ModuleRegistry::add_entry(ShString path,
+			  ymuint64 hash,
+			  VsmModule* module,
+			  bool valid)
+{
+  Entry* entry = new Entry;
+  entry->mPath = path;
+  entry->mHash = hash;
+  entry->mModule = module;
+  // 呼び出し側の分と登録している分
+  entry->mRefCount = valid ? 2 : 1;
+  entry->mValid = valid;
+
+  // import しているモジュールがこのクラスの扱うものなら参照を持つ．
+  for (ymuint i = 0; i < module->imported_module_num(); ++ i) {
+    Entry* sub_entry;
+    if ( mModuleDict.find(module->imported_module(i), sub_entry) ) {
+      ++ sub_entry->mRefCount;
+    }
+  }
+
+  mEntryList.push_back(entry);
+  mModuleDict.add(module, entry);
+  if ( valid ) {
+    mEntryDict.add(path, entry);
+  }
+}
+
+// @brief 登録を外す．
+// @param[in] entry 対象のエントリ
+//
+// entry のモジュールを import しているエントリも外す．
+void
+ModuleRegistry::remove(Entry* entry)
+{
+  // 外したモジュールを import しているものを順に外していく．
+  // import の関係は DAG なのでエントリのリストを一度なめるごとに
+  // 外すものがなくなるまで繰り返す．
+  vector<VsmModule*> removed_list(1, entry->mModule);
+  entry->mValid = false;
+  -- entry->mRefCount;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (vector<Entry*>::iterator p = mEntryList.begin();
+	 p != mEntryList.end(); ++ p) {
+      Entry* entry1 = *p;
+      if ( !entry1->mValid ) {
+	continue;
+      }
+      VsmModule* module = entry1->mModule;
+      bool stale = false;
+      for (ymuint i = 0; i < module->imported_module_num() && !stale; ++ i) {
+	VsmModule* sub_module = module->imported_module(i);
+	for (vector<VsmModule*>::iterator q = removed_list.begin();
+	     q != removed_list.end(); ++ q) {
+	  if ( *q == sub_module ) {
+	    stale = true;
+	    break;
+	  }
+	}
+      }
+      if ( stale ) {
+	removed_list.push_back(module);
+	entry1->mValid = false;
+	-- entry1->mRefCount;
+	changed = true;
+      }
+    }
+  }
+
+  // HashMap から一つずつ外す手段はないので作り直す．
+  mEntryDict.clear();
+  for (vector<Entry*>::iterator p = mEntryList.begin();
+       p != mEntryList.end(); ++ p) {
+    Entry* entry1 = *p;
+    if ( entry1->mValid ) {
+      mEntryDict.add(entry1->mPath, entry1);
+    }
+  }
+
+  sweep();
+}
+
+// @brief 参照のなくなったエントリを削除する．
+//
+// 削除したモジュールが import していたものの参照も減らすので，
+// 削除するものがなくなるまで繰り返す．
+// import されているモジュールは import している側が削除されるまで
+// 参照が残るので，削除したエントリを引くことはない．
+void
+ModuleRegistry::sweep()
+{
+  bool deleted = false;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    vector<Entry*> rest_list;
+    rest_list.reserve(mEntryList.size());
+    for (vector<Entry*>::iterator p = mEntryList.begin();
+	 p != mEntryList.end(); ++ p) {
+      Entry* entry = *p;
+      if ( entry->mRefCount > 0 ) {
+	rest_list.push_back(entry);
+	continue;
+      }
+      VsmModule* module = entry->mModule;
+      for (ymuint i = 0; i < module->imported_module_num(); ++ i) {
+	Entry* sub_entry;
+	if ( mModuleDict.find(module->imported_module(i), sub_entry) ) {
+	  ASSERT_COND( sub_entry->mRefCount > 0 );
+	  -- sub_entry->mRefCount;
+	}
+      }
+      delete module;
+      delete entry;
+      changed = true;
+      deleted = true;
+    }
+    mEntryList.swap(rest_list);
+  }
+
+  if ( deleted ) {
+    // 削除したモジュールのアドレスが使い回されることがあるので作り直す．
+    mModuleDict.clear();
+    for (vector<Entry*>::iterator p = mEntryList.begin();
+	 p != mEntryList.end(); ++ p) {
+      Entry* entry = *p;
+      mModuleDict.add(entry->mModule, entry);
+    }
+  }
+}
+
+END_NAMESPACE_YM_YMSL
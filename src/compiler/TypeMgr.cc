@@ -159,6 +159,7 @@ TypeMgr::string_type()
 const Type*
 TypeMgr::array_type(const Type* elem_type)
 {
+  YmslLock lock(mMutex);
   ymuint h = hash_array(elem_type) % mHashSize;
   for (Type* type = mHashTable[h]; type != NULL; type = type->mLink) {
     if ( type->type_id() == kArrayType && type->elem_type() == elem_type ) {
@@ -177,6 +178,7 @@ TypeMgr::array_type(const Type* elem_type)
 const Type*
 TypeMgr::set_type(const Type* elem_type)
 {
+  YmslLock lock(mMutex);
   ymuint h = hash_set(elem_type) % mHashSize;
   for (Type* type = mHashTable[h]; type != NULL; type = type->mLink) {
     if ( type->type_id() == kSetType && type->elem_type() == elem_type ) {
@@ -197,6 +199,7 @@ const Type*
 TypeMgr::map_type(const Type* key_type,
 		  const Type* elem_type)
 {
+  YmslLock lock(mMutex);
   ymuint h = hash_map(key_type, elem_type) % mHashSize;
   for (Type* type = mHashTable[h]; type != NULL; type = type->mLink) {
     if ( type->type_id() == kMapType &&
@@ -219,6 +222,7 @@ const Type*
 TypeMgr::function_type(const Type* output_type,
 		       const vector<const Type*>& input_type_list)
 {
+  YmslLock lock(mMutex);
   ymuint h = hash_func(output_type, input_type_list) % mHashSize;
   for (Type* type = mHashTable[h]; type != NULL; type = type->mLink) {
     if ( type->type_id() == kFuncType &&
@@ -252,6 +256,7 @@ const Type*
 TypeMgr::enum_type(ShString name,
 		   const vector<pair<ShString, Ymsl_INT> >& elem_list)
 {
+  YmslLock lock(mMutex);
   Type* type = new EnumType(name, elem_list);
   reg_type(type);
   return type;
@@ -333,9 +338,18 @@ TypeMgr::calc_type2(OpCode opcode,
   case kOpBitOr:
   case kOpBitXor:
     // (int, int) -> int
+    // (set, set) -> set (共通部分，和集合，対称差)
+    // (map, map) -> map (BitXor は除く)
     if ( op1_type == int_type() && op2_type == int_type() ) {
       return int_type();
     }
+    if ( op1_type == op2_type && op1_type->type_id() == kSetType ) {
+      return op1_type;
+    }
+    if ( op1_type == op2_type && op1_type->type_id() == kMapType &&
+	 opcode != kOpBitXor ) {
+      return op1_type;
+    }
     break;
 
   case kOpLogAnd:
@@ -364,6 +378,30 @@ TypeMgr::calc_type2(OpCode opcode,
       op2_reqtype = float_type();
       return float_type();
     }
+    // (string, string) -> string (Add のみ: 連結)
+    // (array, array) -> array (Add のみ: 連結)
+    // (set, set) -> set (Add は和集合，Sub は差集合)
+    // (map, map) -> map (Add は併合，Sub はキーの削除)
+    if ( op1_type == op2_type ) {
+      switch ( op1_type->type_id() ) {
+      case kStringType:
+      case kArrayType:
+	if ( opcode == kOpAdd ) {
+	  return op1_type;
+	}
+	break;
+
+      case kSetType:
+      case kMapType:
+	if ( opcode == kOpAdd || opcode == kOpSub ) {
+	  return op1_type;
+	}
+	break;
+
+      default:
+	break;
+      }
+    }
     break;
 
   case kOpMod:
@@ -405,6 +443,13 @@ TypeMgr::calc_type2(OpCode opcode,
     if ( (op1_type == op2_type) && op1_type->type_id() == kEnumType ) {
       return boolean_type();
     }
+    // array/set/map は同じ型同士で中身を比べる．
+    if ( (op1_type == op2_type) &&
+	 (op1_type->type_id() == kArrayType ||
+	  op1_type->type_id() == kSetType ||
+	  op1_type->type_id() == kMapType) ) {
+      return boolean_type();
+    }
     break;
 
   case kOpLt:
@@ -428,6 +473,18 @@ TypeMgr::calc_type2(OpCode opcode,
       return boolean_type();
     }
     // enum 型の大小比較はない．
+    // (set, set) -> boolean (部分集合)
+    // 要素が int/float の array は辞書順で比べる．
+    if ( op1_type == op2_type ) {
+      if ( op1_type->type_id() == kSetType ) {
+	return boolean_type();
+      }
+      if ( op1_type->type_id() == kArrayType &&
+	   (op1_type->elem_type() == int_type() ||
+	    op1_type->elem_type() == float_type()) ) {
+	return boolean_type();
+      }
+    }
     break;
 
   default:
@@ -15,8 +15,9 @@
 #include "IrMgr.h"
 #include "IrToplevel.h"
 #include "VsmGen.h"
-
-#include "YmUtils/FileIDO.h"
+#include "VsmModule.h"
+#include "ModuleBuilder.h"
+#include "ModuleRegistry.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -26,13 +27,26 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 
 // @brief コンストラクタ
-YmslCompiler::YmslCompiler()
+YmslCompiler::YmslCompiler() :
+  mTypeMgr(ModuleRegistry::the_registry().type_mgr()),
+  mThreadNum(0)
 {
 }
 
 // @brief デストラクタ
 YmslCompiler::~YmslCompiler()
 {
+  // モジュールは他の YmslCompiler と共有しているので参照を返すだけにする．
+  // どこからも参照されなくなったものは ModuleRegistry が削除する．
+  ModuleRegistry& registry = ModuleRegistry::the_registry();
+  for (vector<ModuleInfo*>::iterator p = mModuleList.begin();
+       p != mModuleList.end(); ++ p) {
+    ModuleInfo* info = *p;
+    if ( info->mModule != NULL ) {
+      registry.release(info->mModule);
+    }
+    delete info;
+  }
 }
 
 // @brief コンパイルする．
@@ -52,21 +66,16 @@ YmslCompiler::compile(IDO& ido,
     return NULL;
   }
 
-  IrMgr ir_mgr;
-
-  // 中間表現を作る．
+  // import しているモジュールを先にまとめて用意する．
   AstStatement* ast_toplevel = ast_mgr.toplevel();
-  IrToplevel* ir_toplevel = ir_mgr.elaborate(ast_toplevel, name, *this);
-  if ( ir_toplevel == NULL ) {
+  vector<ShString> import_list;
+  ModuleBuilder::get_import_list(ast_toplevel, import_list);
+  ModuleBuilder builder(*this);
+  if ( !builder.build(import_list, mThreadNum) ) {
     return NULL;
   }
 
-  // コード生成を行う．
-  VsmGen vsmgen;
-
-  VsmModule* module = vsmgen.code_gen(ir_toplevel, name);
-
-  return module;
+  return compile_ast(ast_toplevel, name);
 }
 
 // @brief モジュールを import する．
@@ -77,41 +86,90 @@ YmslCompiler::compile(IDO& ido,
 VsmModule*
 YmslCompiler::import(ShString name)
 {
-  // 実際に import する．
-  string body = static_cast<const char*>(name);
-  for ( ; ; ) {
-    // 実はループじゃないけど break を使いたいので
-    PathName path = body + ".ym";
-    // サーチパスを考慮してファイルを探す．
-    PathName fullpath = mPathList.search(path);
-    if ( !fullpath.is_valid() ) {
-      cout << path.str() << " not found" << endl;
-      break;
-    }
-    FileIDO ido;
-    bool stat = ido.open(fullpath.str());
-    ASSERT_COND( stat );
-    VsmModule* module = compile(ido, name);
+  VsmModule* module = find_module(name);
+  if ( module != NULL ) {
     return module;
   }
 
-  for ( ; ; ) {
-    // 実はループじゃないけど break を使いたいので
-    PathName path = body + ".ymc";
-    // サーチパスを考慮してファイルを探す．
-    PathName fullpath = mPathList.search(path);
-    if ( !fullpath.is_valid() ) {
-      break;
+  ModuleBuilder builder(*this);
+  if ( !builder.build(vector<ShString>(1, name), mThreadNum) ) {
+    return NULL;
+  }
+  return find_module(name);
+}
+
+// @brief ソースファイルが変更されたモジュールを作り直す．
+// @param[out] name_list 作り直したモジュール名のリスト
+// @return 全て作り直せたら true を返す．
+bool
+YmslCompiler::update(vector<ShString>& name_list)
+{
+  name_list.clear();
+
+  // 作り直すモジュールのリスト
+  vector<VsmModule*> stale_list;
+  {
+    YmslLock lock(mMutex);
+
+    // 大きさと更新時刻を比べるだけなので，変更がなければすぐに終わる．
+    for (vector<ModuleInfo*>::iterator p = mModuleList.begin();
+	 p != mModuleList.end(); ++ p) {
+      ModuleInfo* info = *p;
+      if ( info->mModule == NULL || info->mSrcPath == string() ) {
+	continue;
+      }
+      if ( VsmModuleFile::source_changed(info->mSrcPath, info->mSrcInfo) ) {
+	stale_list.push_back(info->mModule);
+	name_list.push_back(info->mName);
+	info->mModule = NULL;
+      }
+    }
+
+    // 作り直すモジュールを import しているものも作り直す．
+    for (bool changed = !stale_list.empty(); changed; ) {
+      changed = false;
+      for (vector<ModuleInfo*>::iterator p = mModuleList.begin();
+	   p != mModuleList.end(); ++ p) {
+	ModuleInfo* info = *p;
+	VsmModule* module = info->mModule;
+	if ( module == NULL ) {
+	  continue;
+	}
+	bool stale = false;
+	for (ymuint i = 0; i < module->imported_module_num() && !stale; ++ i) {
+	  VsmModule* sub_module = module->imported_module(i);
+	  for (vector<VsmModule*>::iterator q = stale_list.begin();
+	       q != stale_list.end(); ++ q) {
+	    if ( *q == sub_module ) {
+	      stale = true;
+	      break;
+	    }
+	  }
+	}
+	if ( stale ) {
+	  stale_list.push_back(module);
+	  name_list.push_back(info->mName);
+	  info->mModule = NULL;
+	  changed = true;
+	}
+      }
     }
-    FileIDO ido;
-    bool stat = ido.open(fullpath.str());
-    ASSERT_COND( stat );
-    //VsmModule* module = load(ido);
-    VsmModule* module = NULL;
-    return module;
   }
 
-  return NULL;
+  if ( name_list.empty() ) {
+    return true;
+  }
+
+  // 古いモジュールの参照を返す．
+  // 他から参照されていなければ ModuleRegistry が削除する．
+  ModuleRegistry& registry = ModuleRegistry::the_registry();
+  for (vector<VsmModule*>::iterator p = stale_list.begin();
+       p != stale_list.end(); ++ p) {
+    registry.release(*p);
+  }
+
+  ModuleBuilder builder(*this);
+  return builder.build(name_list, mThreadNum);
 }
 
 // @brief サーチパスの先頭に path を追加する．
@@ -132,4 +190,91 @@ YmslCompiler::add_searchpath_end(const string& path)
   mPathList.add_end(path);
 }
 
+// @brief import したモジュールをコンパイルするスレッド数を設定する．
+// @param[in] num スレッド数
+void
+YmslCompiler::set_thread_num(ymuint num)
+{
+  mThreadNum = num;
+}
+
+// @brief 抽象構文木からモジュールを作る．
+// @param[in] ast_root 抽象構文木の根のノード
+// @param[in] name モジュール名
+// @return 作ったモジュールを返す．
+VsmModule*
+YmslCompiler::compile_ast(const AstStatement* ast_root,
+			  ShString name)
+{
+  IrMgr ir_mgr(mTypeMgr);
+
+  // 中間表現を作る．
+  IrToplevel* ir_toplevel = ir_mgr.elaborate(ast_root, name, *this);
+  if ( ir_toplevel == NULL ) {
+    return NULL;
+  }
+
+  // 中間表現の最適化を行う．
+  ir_mgr.optimize(ir_toplevel);
+
+  // コード生成を行う．
+  VsmGen vsmgen;
+
+  VsmModule* module = vsmgen.code_gen(ir_toplevel, name);
+
+  return module;
+}
+
+// @brief 用意されたモジュールを探す．
+// @param[in] name モジュール名
+// @return モジュールを返す．
+VsmModule*
+YmslCompiler::find_module(ShString name)
+{
+  YmslLock lock(mMutex);
+  ModuleInfo* info;
+  if ( mModuleDict.find(name, info) ) {
+    return info->mModule;
+  }
+  return NULL;
+}
+
+// @brief 用意されたモジュールを登録する．
+// @param[in] name モジュール名
+// @param[in] module モジュール
+void
+YmslCompiler::reg_module(ShString name,
+			 VsmModule* module)
+{
+  reg_module(name, module, string(), VsmModuleFile::SourceInfo());
+}
+
+// @brief ソースファイルから用意されたモジュールを登録する．
+// @param[in] name モジュール名
+// @param[in] module モジュール
+// @param[in] src_path ソースファイルのパス
+// @param[in] src_info ソースファイルの情報
+void
+YmslCompiler::reg_module(ShString name,
+			 VsmModule* module,
+			 const string& src_path,
+			 const VsmModuleFile::SourceInfo& src_info)
+{
+  YmslLock lock(mMutex);
+  ModuleInfo* info;
+  if ( !mModuleDict.find(name, info) ) {
+    // update() で作り直した場合は前の情報を使い回す．
+    info = new ModuleInfo;
+    info->mName = name;
+    mModuleList.push_back(info);
+    mModuleDict.add(name, info);
+  }
+  else if ( info->mModule != NULL ) {
+    ModuleRegistry::the_registry().release(info->mModule);
+  }
+  info->mModule = module;
+  info->mSrcPath = src_path;
+  info->mSrcInfo = src_info;
+}
+
 END_NAMESPACE_YM_YMSL
@@ -0,0 +1,130 @@
+
+/// @file YmslMutex.cc
+/// @brief YmslMutex, YmslCond の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "YmslMutex.h"
+
+#if defined(YMSL_USE_THREADS)
+#include <pthread.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslMutex
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+YmslMutex::YmslMutex()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_mutex_t* mutex = new pthread_mutex_t;
+  pthread_mutex_init(mutex, NULL);
+  mImpl = mutex;
+#else
+  mImpl = NULL;
+#endif
+}
+
+// @brief デストラクタ
+YmslMutex::~YmslMutex()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_mutex_t* mutex = static_cast<pthread_mutex_t*>(mImpl);
+  pthread_mutex_destroy(mutex);
+  delete mutex;
+#endif
+}
+
+// @brief ロックする．
+void
+YmslMutex::lock()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_mutex_lock(static_cast<pthread_mutex_t*>(mImpl));
+#endif
+}
+
+// @brief ロックを外す．
+void
+YmslMutex::unlock()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_mutex_unlock(static_cast<pthread_mutex_t*>(mImpl));
+#endif
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslCond
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+YmslCond::YmslCond()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_cond_t* cond = new pthread_cond_t;
+  pthread_cond_init(cond, NULL);
+  mImpl = cond;
+#else
+  mImpl = NULL;
+#endif
+}
+
+// @brief デストラクタ
+YmslCond::~YmslCond()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_cond_t* cond = static_cast<pthread_cond_t*>(mImpl);
+  pthread_cond_destroy(cond);
+  delete cond;
+#endif
+}
+
+// @brief 通知を待つ．
+// @param[in] mutex ロックしている YmslMutex
+void
+YmslCond::wait(YmslMutex& mutex)
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_cond_wait(static_cast<pthread_cond_t*>(mImpl),
+		    static_cast<pthread_mutex_t*>(mutex.mImpl));
+#endif
+}
+
+// @brief 待っている全てのスレッドに通知する．
+void
+YmslCond::broadcast()
+{
+#if defined(YMSL_USE_THREADS)
+  pthread_cond_broadcast(static_cast<pthread_cond_t*>(mImpl));
+#endif
+}
+
+
+// @brief ShString の登録表を守るロックを返す．
+//
+// 静的初期化の順序に依存しないように関数内で作る．
+YmslMutex&
+shstring_mutex()
+{
+  static YmslMutex* mutex = new YmslMutex;
+  return *mutex;
+}
+
+// @brief 文字列を ShString に登録する．
+// @param[in] str 文字列
+ShString
+intern_ShString(const char* str)
+{
+  YmslLock lock(shstring_mutex());
+  return ShString(str);
+}
+
+END_NAMESPACE_YM_YMSL
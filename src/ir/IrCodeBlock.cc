@@ -49,6 +49,14 @@ IrCodeBlock::add_node(IrNode* node)
   mNodeList.push_back(node);
 }
 
+// @brief ノードのリストを置き換える．
+// @param[in] node_list 新しいノードのリスト
+void
+IrCodeBlock::set_node_list(const vector<IrNode*>& node_list)
+{
+  mNodeList = node_list;
+}
+
 // @brief 変数のリストを得る．
 const vector<IrHandle*>&
 IrCodeBlock::var_list() const
@@ -27,6 +27,11 @@ IrFuncBlock::IrFuncBlock(const vector<IrHandle*>& arg_list,
   mArgInitList(arg_init_list),
   mFuncHandle(func_handle)
 {
+  // 引数はローカル変数の先頭に置かれる．
+  for (vector<IrHandle*>::const_iterator p = arg_list.begin();
+       p != arg_list.end(); ++ p) {
+    add_local_var(*p);
+  }
 }
 
 // @brief デストラクタ
@@ -41,4 +46,11 @@ IrFuncBlock::func_handle()
   return mFuncHandle;
 }
 
+// @brief 引数のリストを返す．
+const vector<IrHandle*>&
+IrFuncBlock::arg_list() const
+{
+  return mArgList;
+}
+
 END_NAMESPACE_YM_YMSL
@@ -0,0 +1,813 @@
+
+/// @file IrInliner.cc
+/// @brief IrInliner の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrInliner.h"
+#include "IrMgr.h"
+#include "IrSsa.h"
+#include "IrToplevel.h"
+#include "IrFuncBlock.h"
+#include "IrHandle.h"
+#include "IrNode.h"
+#include "Type.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 常に展開する関数の本体のノード数の上限
+const ymuint kSmallSize = 40;
+
+// 呼び出し箇所が一つの時に展開する関数の本体のノード数の上限
+const ymuint kSingleCallSize = 200;
+
+// 展開先のコードブロックのノード数の上限
+const ymuint kMaxBlockSize = 4000;
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrInliner
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] mgr ノードを生成するオブジェクト
+IrInliner::IrInliner(IrMgr& mgr) :
+  mMgr(mgr)
+{
+  mCodeBlock = NULL;
+  mBlockSize = 0;
+}
+
+// @brief デストラクタ
+IrInliner::~IrInliner()
+{
+}
+
+// @brief モジュール内の関数呼び出しを展開する．
+// @param[in] toplevel 対象のトップレベルブロック
+void
+IrInliner::expand(IrToplevel* toplevel)
+{
+  const vector<IrFuncBlock*>& func_list = toplevel->func_list();
+  ymuint nf = func_list.size();
+  mFuncList.clear();
+  mFuncList.resize(nf);
+  mFuncMap.clear();
+  for (ymuint i = 0; i < nf; ++ i) {
+    IrFuncBlock* func = func_list[i];
+    FuncInfo& info = mFuncList[i];
+    info.mFunc = func;
+    info.mState = 0;
+    info.mCallNum = 0;
+
+    ymuint index = func->func_handle()->local_index();
+    if ( mFuncMap.size() <= index ) {
+      mFuncMap.resize(index + 1, nf);
+    }
+    mFuncMap[index] = i;
+  }
+
+  // 呼び出し箇所を数える．
+  vector<IrCodeBlock*> block_list(func_list.begin(), func_list.end());
+  block_list.push_back(toplevel);
+  for (vector<IrCodeBlock*>::iterator p = block_list.begin();
+       p != block_list.end(); ++ p) {
+    const vector<IrNode*>& node_list = (*p)->node_list();
+    vector<IrNode*> queue(node_list.begin(), node_list.end());
+    while ( !queue.empty() ) {
+      IrNode* node = queue.back();
+      queue.pop_back();
+      if ( node->node_type() == IrNode::kFuncCall ) {
+	IrHandle* func_handle = node->function_address();
+	if ( func_handle->handle_type() == IrHandle::kFunction &&
+	     func_handle->module_index() == 0 &&
+	     func_handle->local_index() < mFuncMap.size() &&
+	     mFuncMap[func_handle->local_index()] < nf ) {
+	  ++ mFuncList[mFuncMap[func_handle->local_index()]].mCallNum;
+	}
+      }
+      vector<IrNode*> child_list;
+      IrSsa::get_child_list(node, child_list);
+      queue.insert(queue.end(), child_list.begin(), child_list.end());
+    }
+  }
+
+  for (ymuint i = 0; i < nf; ++ i) {
+    expand_func(i);
+  }
+  expand_block(toplevel);
+}
+
+// @brief 関数の中の呼び出しを展開する．
+// @param[in] func_id 関数番号
+//
+// 呼ばれる関数を先に処理する．
+void
+IrInliner::expand_func(ymuint func_id)
+{
+  FuncInfo& info = mFuncList[func_id];
+  if ( info.mState != 0 ) {
+    return;
+  }
+  info.mState = 1;
+
+  // 呼ばれる関数を先に処理する．
+  const vector<IrNode*>& node_list = info.mFunc->node_list();
+  vector<IrNode*> queue(node_list.begin(), node_list.end());
+  while ( !queue.empty() ) {
+    IrNode* node = queue.back();
+    queue.pop_back();
+    if ( node->node_type() == IrNode::kFuncCall ) {
+      IrHandle* func_handle = node->function_address();
+      if ( func_handle->handle_type() == IrHandle::kFunction &&
+	   func_handle->module_index() == 0 &&
+	   func_handle->local_index() < mFuncMap.size() &&
+	   mFuncMap[func_handle->local_index()] < mFuncList.size() ) {
+	expand_func(mFuncMap[func_handle->local_index()]);
+      }
+    }
+    vector<IrNode*> child_list;
+    IrSsa::get_child_list(node, child_list);
+    queue.insert(queue.end(), child_list.begin(), child_list.end());
+  }
+
+  expand_block(info.mFunc);
+
+  // expand_func() の再帰呼び出しで mFuncList は変わらないので
+  // info はまだ有効
+  info.mState = 2;
+}
+
+// @brief コードブロックの中の呼び出しを展開する．
+// @param[in] code_block 対象のコードブロック
+void
+IrInliner::expand_block(IrCodeBlock* code_block)
+{
+  mCodeBlock = code_block;
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  mBlockSize = 0;
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    mBlockSize += node_size(*p);
+  }
+
+  vector<IrNode*> new_node_list;
+  new_node_list.reserve(node_list.size());
+  bool changed = false;
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    vector<IrNode*> pre_list;
+    IrNode* new_node = expand_stmt(node, pre_list);
+    if ( new_node != node ) {
+      changed = true;
+    }
+    new_node_list.insert(new_node_list.end(), pre_list.begin(), pre_list.end());
+    if ( new_node != NULL ) {
+      new_node_list.push_back(new_node);
+    }
+  }
+  if ( changed ) {
+    code_block->set_node_list(new_node_list);
+  }
+
+  mCodeBlock = NULL;
+}
+
+// @brief 文の中の呼び出しを展開する．
+// @param[in] node 対象の文
+// @param[out] pre_list 展開した本体を追加するリスト
+// @return 書き換えた文を返す．
+//
+// 文が要らなくなった場合には NULL を返す．
+IrNode*
+IrInliner::expand_stmt(IrNode* node,
+		       vector<IrNode*>& pre_list)
+{
+  bool barrier = false;
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+  case IrNode::kFuncCall:
+    {
+      IrNode* new_node = expand_expr(node, false, barrier, pre_list);
+      if ( new_node == NULL ||
+	   (new_node != node && new_node->node_type() == IrNode::kLoad) ) {
+	// 返り値を捨てるだけの式文は要らない．
+	return NULL;
+      }
+      return new_node;
+    }
+
+  case IrNode::kStore:
+    {
+      // 配列要素などへの代入では添字の式が先に評価される．
+      IrHandle* addr = node->address();
+      if ( addr->handle_type() != IrHandle::kLocalVar &&
+	   addr->handle_type() != IrHandle::kGlobalVar ) {
+	break;
+      }
+      IrNode* val = expand_expr(node->store_val(), false, barrier, pre_list);
+      if ( val != node->store_val() ) {
+	return mMgr.new_Store(addr, val);
+      }
+    }
+    break;
+
+  case IrNode::kInplaceBinOp:
+    {
+      // 右辺より先に読まれる左辺の値が関数の中で変わっては
+      // いけないのでローカル変数の場合だけ展開する．
+      IrHandle* addr = node->address();
+      if ( addr->handle_type() != IrHandle::kLocalVar ) {
+	break;
+      }
+      IrNode* opr = expand_expr(node->operand(0), false, barrier, pre_list);
+      if ( opr != node->operand(0) ) {
+	return mMgr.new_InplaceBinOp(node->opcode(), addr, opr);
+      }
+    }
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      IrNode* val = node->return_val();
+      if ( val->node_type() == IrNode::kFuncCall ) {
+	// 末尾呼び出し
+	val = expand_call(val, false, true, barrier, pre_list);
+      }
+      else {
+	val = expand_expr(val, false, barrier, pre_list);
+      }
+      if ( val != node->return_val() ) {
+	return mMgr.new_Return(val);
+      }
+    }
+    break;
+
+  case IrNode::kBranchTrue:
+    {
+      IrNode* cond = expand_expr(node->branch_cond(), false, barrier, pre_list);
+      if ( cond != node->branch_cond() ) {
+	return mMgr.new_BranchTrue(node->jump_addr(), cond);
+      }
+    }
+    break;
+
+  case IrNode::kBranchFalse:
+    {
+      IrNode* cond = expand_expr(node->branch_cond(), false, barrier, pre_list);
+      if ( cond != node->branch_cond() ) {
+	return mMgr.new_BranchFalse(node->jump_addr(), cond);
+      }
+    }
+    break;
+
+  case IrNode::kSwitch:
+    {
+      IrNode* cond = expand_expr(node->branch_cond(), false, barrier, pre_list);
+      if ( cond != node->branch_cond() ) {
+	ymuint nc = node->case_num();
+	vector<pair<Ymsl_INT, IrNode*> > case_list(nc);
+	for (ymuint i = 0; i < nc; ++ i) {
+	  case_list[i] = make_pair(node->case_val(i), node->case_label(i));
+	}
+	return mMgr.new_Switch(cond, case_list, node->jump_addr());
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return node;
+}
+
+// @brief 式の中の呼び出しを展開する．
+// @param[in] node 対象の式
+// @param[in] cond 条件付きで評価される位置の時 true
+// @param[inout] barrier これより後の呼び出しを展開できない時 true
+// @param[out] pre_list 展開した本体を追加するリスト
+// @return 書き換えた式を返す．
+//
+// 返り値のない関数の呼び出しを展開した場合には NULL を返す．
+IrNode*
+IrInliner::expand_expr(IrNode* node,
+		       bool cond,
+		       bool& barrier,
+		       vector<IrNode*>& pre_list)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kLoad:
+    switch ( node->address()->handle_type() ) {
+    case IrHandle::kLocalVar:
+    case IrHandle::kBooleanConst:
+    case IrHandle::kIntConst:
+    case IrHandle::kFloatConst:
+    case IrHandle::kStringConst:
+      // 呼び出される関数の中では変わらない．
+      break;
+
+    default:
+      barrier = true;
+      break;
+    }
+    return node;
+
+  case IrNode::kUniOp:
+    {
+      IrNode* opr1 = expand_expr(node->operand(0), cond, barrier, pre_list);
+      if ( opr1 != node->operand(0) ) {
+	return mMgr.new_UniOp(node->opcode(), node->value_type(), opr1);
+      }
+    }
+    return node;
+
+  case IrNode::kBinOp:
+    {
+      // 論理演算の右辺は左辺の値によっては評価されない．
+      bool cond1 = cond ||
+	node->opcode() == kOpLogAnd || node->opcode() == kOpLogOr;
+      IrNode* opr1 = expand_expr(node->operand(0), cond, barrier, pre_list);
+      IrNode* opr2 = expand_expr(node->operand(1), cond1, barrier, pre_list);
+      if ( node->value_type()->type_id() == kIntType &&
+	   (node->opcode() == kOpDiv || node->opcode() == kOpMod) ) {
+	// 0 除算で止まる前に関数の本体が実行されてはいけない．
+	barrier = true;
+      }
+      if ( opr1 != node->operand(0) || opr2 != node->operand(1) ) {
+	return mMgr.new_BinOp(node->opcode(), node->value_type(), opr1, opr2);
+      }
+    }
+    return node;
+
+  case IrNode::kTriOp:
+    {
+      IrNode* opr1 = expand_expr(node->operand(0), cond, barrier, pre_list);
+      IrNode* opr2 = expand_expr(node->operand(1), true, barrier, pre_list);
+      IrNode* opr3 = expand_expr(node->operand(2), true, barrier, pre_list);
+      if ( opr1 != node->operand(0) || opr2 != node->operand(1) ||
+	   opr3 != node->operand(2) ) {
+	return mMgr.new_TriOp(node->opcode(), node->value_type(),
+			      opr1, opr2, opr3);
+      }
+    }
+    return node;
+
+  case IrNode::kFuncCall:
+    return expand_call(node, cond, false, barrier, pre_list);
+
+  default:
+    break;
+  }
+
+  barrier = true;
+  return node;
+}
+
+// @brief 関数呼び出しを展開する．
+// @param[in] node 関数呼び出しノード
+// @param[in] cond 条件付きで評価される位置の時 true
+// @param[in] tail return の値になる位置の時 true
+// @param[inout] barrier これより後の呼び出しを展開できない時 true
+// @param[out] pre_list 展開した本体を追加するリスト
+// @return 書き換えた式を返す．
+//
+// 返り値のない関数の呼び出しを展開した場合には NULL を返す．
+IrNode*
+IrInliner::expand_call(IrNode* node,
+		       bool cond,
+		       bool tail,
+		       bool& barrier,
+		       vector<IrNode*>& pre_list)
+{
+  ymuint n = node->arglist_num();
+  vector<IrNode*> arglist(n);
+  bool changed = false;
+  for (ymuint i = 0; i < n; ++ i) {
+    IrNode* arg = node->arglist_elem(i);
+    arglist[i] = expand_expr(arg, cond, barrier, pre_list);
+    if ( arglist[i] != arg ) {
+      changed = true;
+    }
+  }
+  IrNode* new_node = node;
+  if ( changed ) {
+    new_node = mMgr.new_FuncCall(arglist);
+    new_node->set_function_address(node->function_address());
+  }
+
+  IrFuncBlock* func = NULL;
+  if ( !cond && !barrier ) {
+    func = find_callee(new_node, tail);
+  }
+  if ( func == NULL ) {
+    // 展開しない呼び出しはその場で実行されるので
+    // これより後の呼び出しを前に移すことはできない．
+    barrier = true;
+    return new_node;
+  }
+  return splice(new_node, func, pre_list);
+}
+
+// @brief 展開できる呼び出し先を返す．
+// @param[in] node 関数呼び出しノード
+// @param[in] tail return の値になる位置の時 true
+//
+// 展開できない場合には NULL を返す．
+IrFuncBlock*
+IrInliner::find_callee(IrNode* node,
+		       bool tail)
+{
+  IrHandle* func_handle = node->function_address();
+  if ( func_handle->handle_type() != IrHandle::kFunction ||
+       func_handle->module_index() != 0 ||
+       func_handle->local_index() >= mFuncMap.size() ) {
+    // 他のモジュールの関数
+    return NULL;
+  }
+  ymuint func_id = mFuncMap[func_handle->local_index()];
+  if ( func_id >= mFuncList.size() ) {
+    return NULL;
+  }
+
+  const FuncInfo& info = mFuncList[func_id];
+  if ( info.mState != 2 ) {
+    // 自分自身か呼び出し元の関数(再帰呼び出し)
+    return NULL;
+  }
+
+  IrFuncBlock* func = info.mFunc;
+  if ( node->arglist_num() != func->arg_list().size() ) {
+    // デフォルト値を用いる呼び出し
+    return NULL;
+  }
+
+  if ( tail && has_tail_call(func) ) {
+    // 展開すると呼ばれる側の末尾呼び出しが普通の呼び出しになり，
+    // 相互再帰でフレームが積み上がる．
+    return NULL;
+  }
+
+  ymuint size = 0;
+  const vector<IrNode*>& node_list = func->node_list();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    size += node_size(*p);
+  }
+  if ( size > kSmallSize &&
+       (info.mCallNum > 1 || size > kSingleCallSize) ) {
+    return NULL;
+  }
+  if ( mBlockSize + size > kMaxBlockSize ) {
+    return NULL;
+  }
+
+  if ( !check_func(func) ) {
+    return NULL;
+  }
+
+  mBlockSize += size;
+  return func;
+}
+
+// @brief 関数の本体をコピーできる時 true を返す．
+// @param[in] func 関数
+bool
+IrInliner::check_func(IrFuncBlock* func)
+{
+  // 引数以外のローカル変数は入り口で 0 に初期化する必要がある．
+  // 定数で初期化できない型の変数を持つ関数は展開しない．
+  const vector<IrHandle*>& var_list = func->var_list();
+  for (ymuint i = func->arg_list().size(); i < var_list.size(); ++ i) {
+    switch ( var_list[i]->value_type()->type_id() ) {
+    case kBooleanType:
+    case kIntType:
+    case kFloatType:
+      break;
+
+    default:
+      return false;
+    }
+  }
+
+  const vector<IrNode*>& node_list = func->node_list();
+  vector<IrNode*> label_list;
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    if ( (*p)->node_type() == IrNode::kLabel ) {
+      label_list.push_back(*p);
+    }
+  }
+
+  vector<IrNode*> queue(node_list.begin(), node_list.end());
+  while ( !queue.empty() ) {
+    IrNode* node = queue.back();
+    queue.pop_back();
+    switch ( node->node_type() ) {
+    case IrNode::kHalt:
+      return false;
+
+    case IrNode::kJump:
+    case IrNode::kBranchTrue:
+    case IrNode::kBranchFalse:
+    case IrNode::kSwitch:
+      {
+	// ジャンプ先は関数の中のラベルでなければならない．
+	vector<IrNode*> target_list(1, node->jump_addr());
+	if ( node->node_type() == IrNode::kSwitch ) {
+	  for (ymuint i = 0; i < node->case_num(); ++ i) {
+	    target_list.push_back(node->case_label(i));
+	  }
+	}
+	for (vector<IrNode*>::iterator q = target_list.begin();
+	     q != target_list.end(); ++ q) {
+	  bool found = false;
+	  for (vector<IrNode*>::iterator p = label_list.begin();
+	       p != label_list.end(); ++ p) {
+	    if ( *p == *q ) {
+	      found = true;
+	      break;
+	    }
+	  }
+	  if ( !found ) {
+	    return false;
+	  }
+	}
+      }
+      break;
+
+    case IrNode::kLoad:
+    case IrNode::kStore:
+    case IrNode::kInplaceUniOp:
+    case IrNode::kInplaceBinOp:
+      switch ( node->address()->handle_type() ) {
+      case IrHandle::kArrayRef:
+      case IrHandle::kMemberRef:
+      case IrHandle::kMethodRef:
+	// 中に式を持つハンドルはコピーしない．
+	return false;
+
+      default:
+	break;
+      }
+      break;
+
+    default:
+      break;
+    }
+    vector<IrNode*> child_list;
+    IrSsa::get_child_list(node, child_list);
+    queue.insert(queue.end(), child_list.begin(), child_list.end());
+  }
+
+  return true;
+}
+
+// @brief 関数の本体を展開する．
+// @param[in] node 関数呼び出しノード(引数は展開済み)
+// @param[in] func 呼び出される関数
+// @param[out] pre_list 展開した本体を追加するリスト
+// @return 返り値を読むノードを返す．
+//
+// 返り値のない関数の場合には NULL を返す．
+IrNode*
+IrInliner::splice(IrNode* node,
+		  IrFuncBlock* func,
+		  vector<IrNode*>& pre_list)
+{
+  // 引数とローカル変数を呼び出し側の新しい変数に付け替える．
+  const vector<IrHandle*>& var_list = func->var_list();
+  ymuint nv = var_list.size();
+  ymuint na = func->arg_list().size();
+  mVarMap.clear();
+  mVarMap.resize(nv, NULL);
+  for (ymuint i = 0; i < nv; ++ i) {
+    IrHandle* var = var_list[i];
+    IrHandle* new_var = mMgr.new_LocalVarHandle(var->name(), var->value_type(), 0,
+						mCodeBlock->next_local_index());
+    mCodeBlock->add_local_var(new_var);
+    mVarMap[i] = new_var;
+
+    IrNode* init;
+    if ( i < na ) {
+      init = node->arglist_elem(i);
+    }
+    else {
+      // VsmGen が関数の入り口で行う初期化と同じ値
+      IrHandle* zero = NULL;
+      switch ( var->value_type()->type_id() ) {
+      case kBooleanType:
+	zero = mMgr.new_BooleanConst(ShString(), false);
+	break;
+
+      case kIntType:
+	zero = mMgr.new_IntConst(ShString(), 0);
+	break;
+
+      case kFloatType:
+	zero = mMgr.new_FloatConst(ShString(), 0.0);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+      init = mMgr.new_Load(zero);
+    }
+    pre_list.push_back(mMgr.new_Store(new_var, init));
+  }
+
+  // ラベルを付け替える．
+  const vector<IrNode*>& node_list = func->node_list();
+  mLabelList.clear();
+  mLabelMap.clear();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* label = *p;
+    if ( label->node_type() == IrNode::kLabel ) {
+      label->set_id(mLabelList.size());
+      mLabelList.push_back(label);
+      mLabelMap.push_back(mMgr.new_Label());
+    }
+  }
+
+  // return は返り値の変数への代入と末尾へのジャンプにする．
+  IrHandle* func_handle = func->func_handle();
+  const Type* output_type = func_handle->value_type()->function_output_type();
+  IrHandle* ret_var = NULL;
+  if ( output_type->type_id() != kVoidType ) {
+    ret_var = mMgr.new_LocalVarHandle(func_handle->name(), output_type, 0,
+				      mCodeBlock->next_local_index());
+    mCodeBlock->add_local_var(ret_var);
+  }
+  IrNode* end_label = NULL;
+  ymuint n = node_list.size();
+  for (ymuint i = 0; i < n; ++ i) {
+    IrNode* stmt = node_list[i];
+    if ( stmt->node_type() != IrNode::kReturn ) {
+      pre_list.push_back(copy_node(stmt));
+      continue;
+    }
+    if ( stmt->return_val() != NULL && ret_var != NULL ) {
+      pre_list.push_back(mMgr.new_Store(ret_var, copy_node(stmt->return_val())));
+    }
+    if ( i + 1 < n ) {
+      if ( end_label == NULL ) {
+	end_label = mMgr.new_Label();
+      }
+      pre_list.push_back(mMgr.new_Jump(end_label));
+    }
+  }
+  if ( end_label != NULL ) {
+    pre_list.push_back(end_label);
+  }
+
+  if ( ret_var == NULL ) {
+    return NULL;
+  }
+  return mMgr.new_Load(ret_var);
+}
+
+// @brief ノードをコピーする．
+// @param[in] node 対象のノード
+//
+// ローカル変数とラベルは mVarMap と mLabelMap で付け替える．
+IrNode*
+IrInliner::copy_node(IrNode* node)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    return mMgr.new_UniOp(node->opcode(), node->value_type(),
+			  copy_node(node->operand(0)));
+
+  case IrNode::kBinOp:
+    return mMgr.new_BinOp(node->opcode(), node->value_type(),
+			  copy_node(node->operand(0)),
+			  copy_node(node->operand(1)));
+
+  case IrNode::kTriOp:
+    return mMgr.new_TriOp(node->opcode(), node->value_type(),
+			  copy_node(node->operand(0)),
+			  copy_node(node->operand(1)),
+			  copy_node(node->operand(2)));
+
+  case IrNode::kLoad:
+    return mMgr.new_Load(copy_handle(node->address()));
+
+  case IrNode::kStore:
+    return mMgr.new_Store(copy_handle(node->address()),
+			  copy_node(node->store_val()));
+
+  case IrNode::kInplaceUniOp:
+    return mMgr.new_InplaceUniOp(node->opcode(), copy_handle(node->address()));
+
+  case IrNode::kInplaceBinOp:
+    return mMgr.new_InplaceBinOp(node->opcode(), copy_handle(node->address()),
+				 copy_node(node->operand(0)));
+
+  case IrNode::kFuncCall:
+    {
+      ymuint n = node->arglist_num();
+      vector<IrNode*> arglist(n);
+      for (ymuint i = 0; i < n; ++ i) {
+	arglist[i] = copy_node(node->arglist_elem(i));
+      }
+      IrNode* new_node = mMgr.new_FuncCall(arglist);
+      new_node->set_function_address(node->function_address());
+      return new_node;
+    }
+
+  case IrNode::kJump:
+    return mMgr.new_Jump(mLabelMap[node->jump_addr()->id()]);
+
+  case IrNode::kBranchTrue:
+    return mMgr.new_BranchTrue(mLabelMap[node->jump_addr()->id()],
+			       copy_node(node->branch_cond()));
+
+  case IrNode::kBranchFalse:
+    return mMgr.new_BranchFalse(mLabelMap[node->jump_addr()->id()],
+				copy_node(node->branch_cond()));
+
+  case IrNode::kSwitch:
+    {
+      ymuint nc = node->case_num();
+      vector<pair<Ymsl_INT, IrNode*> > case_list(nc);
+      for (ymuint i = 0; i < nc; ++ i) {
+	case_list[i] = make_pair(node->case_val(i),
+				 mLabelMap[node->case_label(i)->id()]);
+      }
+      return mMgr.new_Switch(copy_node(node->branch_cond()), case_list,
+			     mLabelMap[node->jump_addr()->id()]);
+    }
+
+  case IrNode::kLabel:
+    return mLabelMap[node->id()];
+
+  case IrNode::kReturn:
+  case IrNode::kHalt:
+    // splice() と check_func() で除いている．
+    ASSERT_NOT_REACHED;
+    break;
+  }
+
+  return NULL;
+}
+
+// @brief ハンドルをコピーする．
+// @param[in] handle 対象のハンドル
+IrHandle*
+IrInliner::copy_handle(IrHandle* handle)
+{
+  if ( handle->handle_type() == IrHandle::kLocalVar ) {
+    return mVarMap[handle->local_index()];
+  }
+  // 定数やグローバル変数，関数はそのまま使える．
+  return handle;
+}
+
+// @brief 末尾呼び出しを含む時 true を返す．
+// @param[in] func 関数
+bool
+IrInliner::has_tail_call(IrFuncBlock* func)
+{
+  const vector<IrNode*>& node_list = func->node_list();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    if ( node->node_type() == IrNode::kReturn &&
+	 node->return_val() != NULL &&
+	 node->return_val()->node_type() == IrNode::kFuncCall ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// @brief ノード数を数える．
+// @param[in] node 対象のノード
+ymuint
+IrInliner::node_size(IrNode* node)
+{
+  ymuint size = 1;
+  vector<IrNode*> child_list;
+  IrSsa::get_child_list(node, child_list);
+  for (vector<IrNode*>::iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    size += node_size(*p);
+  }
+  return size;
+}
+
+END_NAMESPACE_YM_YMSL
@@ -15,6 +15,35 @@
 
 BEGIN_NAMESPACE_YM_YMSL
 
+BEGIN_NONAMESPACE
+
+// 符号なしで計算した結果を INT に戻す．
+// 符号付き整数の桁あふれは未定義なので，加減乗算と左シフトは
+// 符号なしで計算して Vsm と同じ 2 の補数の折り返しにする．
+inline
+Ymsl_INT
+wrap_int(ymuint32 val)
+{
+  return static_cast<Ymsl_INT>(val);
+}
+
+// 比較演算のオペランドの型を求める．
+// VsmGen と同じく，どちらかが FLOAT なら FLOAT で，
+// それ以外は INT で比較する．
+TypeId
+cmp_type_id(IrNode* node)
+{
+  TypeId id0 = node->operand(0)->value_type()->type_id();
+  TypeId id1 = node->operand(1)->value_type()->type_id();
+  if ( id0 == kFloatType || id1 == kFloatType ) {
+    return kFloatType;
+  }
+  return kIntType;
+}
+
+END_NONAMESPACE
+
+
 //////////////////////////////////////////////////////////////////////
 // クラス IrInterp
 //////////////////////////////////////////////////////////////////////
@@ -54,7 +83,7 @@ IrInterp::eval_boolean(IrNode* node)
       break;
 
     case kOpLogNot:
-      return !eval_boolean(node->operand(0));
+      return !eval_as_boolean(node->operand(0));
 
     case kOpCastInt:
     case kOpCastFloat:
@@ -68,68 +97,34 @@ IrInterp::eval_boolean(IrNode* node)
   case IrNode::kBinOp:
     switch ( node->opcode() ) {
     case kOpLogAnd:
-      return eval_boolean(node->operand(0)) && eval_boolean(node->operand(1));
+      return eval_as_boolean(node->operand(0)) && eval_as_boolean(node->operand(1));
 
     case kOpLogOr:
-      return eval_boolean(node->operand(0)) || eval_boolean(node->operand(1));
+      return eval_as_boolean(node->operand(0)) || eval_as_boolean(node->operand(1));
 
     case kOpEqual:
-      switch ( node->operand(0)->value_type()->type_id() ) {
-      case kBooleanType:
-	return eval_boolean(node->operand(0)) == eval_boolean(node->operand(1));
-
-      case kIntType:
-	return eval_int(node->operand(0)) == eval_int(node->operand(1));
-
-      case kFloatType:
-	return eval_float(node->operand(0)) == eval_float(node->operand(1));
-
-      default:
-	ASSERT_NOT_REACHED;
+      if ( cmp_type_id(node) == kFloatType ) {
+	return eval_as_float(node->operand(0)) == eval_as_float(node->operand(1));
       }
-      break;
+      return eval_as_int(node->operand(0)) == eval_as_int(node->operand(1));
 
     case kOpNotEq:
-      switch ( node->operand(0)->value_type()->type_id() ) {
-      case kBooleanType:
-	return eval_boolean(node->operand(0)) != eval_boolean(node->operand(1));
-
-      case kIntType:
-	return eval_int(node->operand(0)) != eval_int(node->operand(1));
-
-      case kFloatType:
-	return eval_float(node->operand(0)) != eval_float(node->operand(1));
-
-      default:
-	ASSERT_NOT_REACHED;
+      if ( cmp_type_id(node) == kFloatType ) {
+	return eval_as_float(node->operand(0)) != eval_as_float(node->operand(1));
       }
-      break;
+      return eval_as_int(node->operand(0)) != eval_as_int(node->operand(1));
 
     case kOpLt:
-      switch ( node->operand(0)->value_type()->type_id() ) {
-      case kIntType:
-	return eval_int(node->operand(0)) < eval_int(node->operand(1));
-
-      case kFloatType:
-	return eval_float(node->operand(0)) < eval_float(node->operand(1));
-
-      default:
-	ASSERT_NOT_REACHED;
+      if ( cmp_type_id(node) == kFloatType ) {
+	return eval_as_float(node->operand(0)) < eval_as_float(node->operand(1));
       }
-      break;
+      return eval_as_int(node->operand(0)) < eval_as_int(node->operand(1));
 
     case kOpLe:
-      switch ( node->operand(0)->value_type()->type_id() ) {
-      case kIntType:
-	return eval_int(node->operand(0)) <= eval_int(node->operand(1));
-
-      case kFloatType:
-	return eval_float(node->operand(0)) <= eval_float(node->operand(1));
-
-      default:
-	ASSERT_NOT_REACHED;
+      if ( cmp_type_id(node) == kFloatType ) {
+	return eval_as_float(node->operand(0)) <= eval_as_float(node->operand(1));
       }
-      break;
+      return eval_as_int(node->operand(0)) <= eval_as_int(node->operand(1));
 
     case kOpBitAnd:
     case kOpBitOr:
@@ -149,7 +144,7 @@ IrInterp::eval_boolean(IrNode* node)
   case IrNode::kTriOp:
     switch( node->opcode() ) {
     case kOpIte:
-      return eval_boolean(node->operand(0)) ? eval_boolean(node->operand(1)) : eval_boolean(node->operand(2));
+      return eval_as_boolean(node->operand(0)) ? eval_as_boolean(node->operand(1)) : eval_as_boolean(node->operand(2));
 
     default:
       ASSERT_NOT_REACHED;
@@ -188,6 +183,7 @@ IrInterp::eval_boolean(IrNode* node)
   case IrNode::kJump:
   case IrNode::kBranchTrue:
   case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
   case IrNode::kLabel:
   case IrNode::kHalt:
     ASSERT_NOT_REACHED;
@@ -213,17 +209,19 @@ IrInterp::eval_int(IrNode* node)
       case kIntType:
 	return eval_int(node->operand(0));
 
+      case kFloatType:
+	return static_cast<Ymsl_INT>(eval_float(node->operand(0)));
+
       default:
 	ASSERT_NOT_REACHED;
       }
       break;
 
-
     case kOpBitNeg:
-      return ~eval_int(node->operand(0));
+      return ~eval_as_int(node->operand(0));
 
     case kOpUniMinus:
-      return -eval_int(node->operand(0));
+      return wrap_int(0U - static_cast<ymuint32>(eval_as_int(node->operand(0))));
 
     case kOpCastBoolean:
     case kOpCastFloat:
@@ -236,34 +234,38 @@ IrInterp::eval_int(IrNode* node)
   case IrNode::kBinOp:
     switch ( node->opcode() ) {
     case kOpBitAnd:
-      return eval_int(node->operand(0)) & eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) & eval_as_int(node->operand(1));
 
     case kOpBitOr:
-      return eval_int(node->operand(0)) | eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) | eval_as_int(node->operand(1));
 
     case kOpBitXor:
-      return eval_int(node->operand(0)) ^ eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) ^ eval_as_int(node->operand(1));
 
     case kOpAdd:
-      return eval_int(node->operand(0)) + eval_int(node->operand(1));
+      return wrap_int(static_cast<ymuint32>(eval_as_int(node->operand(0))) +
+		      static_cast<ymuint32>(eval_as_int(node->operand(1))));
 
     case kOpSub:
-      return eval_int(node->operand(0)) - eval_int(node->operand(1));
+      return wrap_int(static_cast<ymuint32>(eval_as_int(node->operand(0))) -
+		      static_cast<ymuint32>(eval_as_int(node->operand(1))));
 
     case kOpMul:
-      return eval_int(node->operand(0)) * eval_int(node->operand(1));
+      return wrap_int(static_cast<ymuint32>(eval_as_int(node->operand(0))) *
+		      static_cast<ymuint32>(eval_as_int(node->operand(1))));
 
     case kOpDiv:
-      return eval_int(node->operand(0)) / eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) / eval_as_int(node->operand(1));
 
     case kOpMod:
-      return eval_int(node->operand(0)) % eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) % eval_as_int(node->operand(1));
 
     case kOpLshift:
-      return eval_int(node->operand(0)) << eval_int(node->operand(1));
+      return wrap_int(static_cast<ymuint32>(eval_as_int(node->operand(0))) <<
+		      eval_as_int(node->operand(1)));
 
     case kOpRshift:
-      return eval_int(node->operand(0)) >> eval_int(node->operand(1));
+      return eval_as_int(node->operand(0)) >> eval_as_int(node->operand(1));
 
     case kOpLogAnd:
     case kOpLogOr:
@@ -279,7 +281,7 @@ IrInterp::eval_int(IrNode* node)
   case IrNode::kTriOp:
     switch( node->opcode() ) {
     case kOpIte:
-      return eval_boolean(node->operand(0)) ? eval_int(node->operand(1)) : eval_int(node->operand(2));
+      return eval_as_boolean(node->operand(0)) ? eval_as_int(node->operand(1)) : eval_as_int(node->operand(2));
 
     default:
       ASSERT_NOT_REACHED;
@@ -318,6 +320,7 @@ IrInterp::eval_int(IrNode* node)
   case IrNode::kJump:
   case IrNode::kBranchTrue:
   case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
   case IrNode::kLabel:
   case IrNode::kHalt:
     ASSERT_NOT_REACHED;
@@ -352,7 +355,7 @@ IrInterp::eval_float(IrNode* node)
       break;
 
     case kOpUniMinus:
-      return - eval_float(node->operand(0));
+      return - eval_as_float(node->operand(0));
 
     case kOpCastBoolean:
     case kOpCastInt:
@@ -366,16 +369,16 @@ IrInterp::eval_float(IrNode* node)
   case IrNode::kBinOp:
     switch ( node->opcode() ) {
     case kOpAdd:
-      return eval_float(node->operand(0)) + eval_float(node->operand(1));
+      return eval_as_float(node->operand(0)) + eval_as_float(node->operand(1));
 
     case kOpSub:
-      return eval_float(node->operand(0)) - eval_float(node->operand(1));
+      return eval_as_float(node->operand(0)) - eval_as_float(node->operand(1));
 
     case kOpMul:
-      return eval_float(node->operand(0)) * eval_float(node->operand(1));
+      return eval_as_float(node->operand(0)) * eval_as_float(node->operand(1));
 
     case kOpDiv:
-      return eval_float(node->operand(0)) / eval_float(node->operand(1));
+      return eval_as_float(node->operand(0)) / eval_as_float(node->operand(1));
 
     case kOpBitAnd:
     case kOpBitOr:
@@ -397,7 +400,7 @@ IrInterp::eval_float(IrNode* node)
   case IrNode::kTriOp:
     switch( node->opcode() ) {
     case kOpIte:
-      return eval_boolean(node->operand(0)) ? eval_float(node->operand(1)) : eval_float(node->operand(2));
+      return eval_as_boolean(node->operand(0)) ? eval_as_float(node->operand(1)) : eval_as_float(node->operand(2));
 
     default:
       ASSERT_NOT_REACHED;
@@ -436,6 +439,7 @@ IrInterp::eval_float(IrNode* node)
   case IrNode::kJump:
   case IrNode::kBranchTrue:
   case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
   case IrNode::kLabel:
   case IrNode::kHalt:
     ASSERT_NOT_REACHED;
@@ -445,4 +449,67 @@ IrInterp::eval_float(IrNode* node)
   return 0.0;
 }
 
+// @brief 式を評価して boolean 型に変換する．
+// @param[in] node 式を表すノード
+bool
+IrInterp::eval_as_boolean(IrNode* node)
+{
+  switch ( node->value_type()->type_id() ) {
+  case kBooleanType:
+    return eval_boolean(node);
+
+  case kIntType:
+    return eval_int(node) != 0;
+
+  case kFloatType:
+    return eval_float(node) != 0.0;
+
+  default:
+    ASSERT_NOT_REACHED;
+  }
+  return false;
+}
+
+// @brief 式を評価して int 型に変換する．
+// @param[in] node 式を表すノード
+Ymsl_INT
+IrInterp::eval_as_int(IrNode* node)
+{
+  switch ( node->value_type()->type_id() ) {
+  case kBooleanType:
+    return eval_boolean(node) ? 1 : 0;
+
+  case kIntType:
+    return eval_int(node);
+
+  case kFloatType:
+    return static_cast<Ymsl_INT>(eval_float(node));
+
+  default:
+    ASSERT_NOT_REACHED;
+  }
+  return 0;
+}
+
+// @brief 式を評価して float 型に変換する．
+// @param[in] node 式を表すノード
+Ymsl_FLOAT
+IrInterp::eval_as_float(IrNode* node)
+{
+  switch ( node->value_type()->type_id() ) {
+  case kBooleanType:
+    return eval_boolean(node) ? 1.0 : 0.0;
+
+  case kIntType:
+    return static_cast<Ymsl_FLOAT>(eval_int(node));
+
+  case kFloatType:
+    return eval_float(node);
+
+  default:
+    ASSERT_NOT_REACHED;
+  }
+  return 0.0;
+}
+
 END_NAMESPACE_YM_YMSL
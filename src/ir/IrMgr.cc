@@ -21,6 +21,8 @@
 #include "IrFuncBlock.h"
 #include "IrNode.h"
 #include "IrHandle.h"
+#include "IrInliner.h"
+#include "IrOptimizer.h"
 
 #include "VsmModule.h"
 #include "VsmFunction.h"
@@ -34,7 +36,17 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 
 // @brief コンストラクタ
-IrMgr::IrMgr()
+IrMgr::IrMgr() :
+  mOwnTypeMgr(new TypeMgr),
+  mTypeMgr(*mOwnTypeMgr)
+{
+}
+
+// @brief 型を管理するオブジェクトを指定したコンストラクタ
+// @param[in] type_mgr 型を管理するオブジェクト
+IrMgr::IrMgr(TypeMgr& type_mgr) :
+  mOwnTypeMgr(NULL),
+  mTypeMgr(type_mgr)
 {
 }
 
@@ -42,6 +54,7 @@ IrMgr::IrMgr()
 IrMgr::~IrMgr()
 {
   clear();
+  delete mOwnTypeMgr;
 }
 
 // @brief クリアする．
@@ -58,7 +71,9 @@ IrMgr::clear()
 
   mUndefList.clear();
 
-  mTypeMgr.clear();
+  if ( mOwnTypeMgr != NULL ) {
+    mTypeMgr.clear();
+  }
 
   mAlloc.destroy();
 }
@@ -99,7 +114,7 @@ IrMgr::elaborate(const AstStatement* ast_root,
 	VsmModule* module = NULL;
 	Scope* scope = NULL;
 	// すでに import されていないか調べる．
-	if ( mModuleDict.find(name, module) ) {
+	if ( mModuleDict.find(module_name, module) ) {
 	  // この場合，対応するスコープも登録されているはず．
 	  bool stat = mScopeDict.find(module, scope);
 	  ASSERT_COND( stat );
@@ -115,7 +130,7 @@ IrMgr::elaborate(const AstStatement* ast_root,
 	  scope = module2scope(module, name, module_index);
 
 	  // 辞書に登録する．
-	  mModuleDict.add(name, module);
+	  mModuleDict.add(module_name, module);
 	  mScopeDict.add(module, scope);
 	}
 
@@ -168,6 +183,25 @@ IrMgr::elaborate(const AstStatement* ast_root,
   return toplevel_block;
 }
 
+// @brief 中間表現の最適化を行う．
+// @param[in] toplevel elaborate() で生成したトップレベルのコード
+void
+IrMgr::optimize(IrToplevel* toplevel)
+{
+  IrInliner inliner(*this);
+  inliner.expand(toplevel);
+
+  IrOptimizer optimizer(*this);
+
+  optimizer.optimize(toplevel);
+
+  const vector<IrFuncBlock*>& func_list = toplevel->func_list();
+  for (vector<IrFuncBlock*>::const_iterator p = func_list.begin();
+       p != func_list.end(); ++ p) {
+    optimizer.optimize(*p);
+  }
+}
+
 // @brief モジュールに対応するスコープを作る．
 // @param[in] module モジュール
 // @param[in] parent_scope 親のスコープ
@@ -181,11 +215,14 @@ IrMgr::module2scope(VsmModule* module,
   for (ymuint i = 0; i < module->imported_module_num(); ++ i) {
     VsmModule* sub_module = module->imported_module(i);
     // Scope* sub_scope を mModuleScopeDict から取ってくる．
+    // このモジュール自身が import していないものは関数番号が
+    // 振れないので参照できないようにしておく．
     Scope* sub_scope;
-    bool stat = mScopeDict.find(sub_module, sub_scope);
-    ASSERT_COND( stat );
+    if ( !mScopeDict.find(sub_module, sub_scope) ) {
+      continue;
+    }
 
-    IrHandle* h = new_ScopeHandle(name, sub_scope);
+    IrHandle* h = new_ScopeHandle(sub_module->name(), sub_scope);
     scope->add(h);
   }
   for (ymuint local_index = 0;
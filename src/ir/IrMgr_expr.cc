@@ -16,10 +16,76 @@
 #include "Type.h"
 #include "IrHandle.h"
 #include "IrNode.h"
+#include "IrInterp.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
 
+BEGIN_NONAMESPACE
+
+// boolean, int, float の定数のロードの時 true を返す．
+bool
+is_const_load(IrNode* node)
+{
+  if ( node->node_type() != IrNode::kLoad ) {
+    return false;
+  }
+  switch ( node->address()->handle_type() ) {
+  case IrHandle::kBooleanConst:
+  case IrHandle::kIntConst:
+  case IrHandle::kFloatConst:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// 実行時に評価を任せるべき演算の時 true を返す．
+// 0 による除算や範囲外のシフトはここでは評価しない．
+bool
+is_unsafe_op(IrNode* node,
+	     IrInterp& interp)
+{
+  if ( node->node_type() != IrNode::kBinOp ||
+       node->value_type()->type_id() != kIntType ) {
+    return false;
+  }
+  switch ( node->opcode() ) {
+  case kOpDiv:
+  case kOpMod:
+    {
+      Ymsl_INT val0 = interp.eval_as_int(node->operand(0));
+      Ymsl_INT val1 = interp.eval_as_int(node->operand(1));
+      if ( val1 == 0 ) {
+	return true;
+      }
+      if ( val1 == -1 && val0 == -2147483647 - 1 ) {
+	return true;
+      }
+    }
+    break;
+
+  case kOpLshift:
+  case kOpRshift:
+    {
+      Ymsl_INT val1 = interp.eval_as_int(node->operand(1));
+      if ( val1 < 0 || val1 >= 32 ) {
+	return true;
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+END_NONAMESPACE
+
+
 //////////////////////////////////////////////////////////////////////
 // クラス IrMgr
 //////////////////////////////////////////////////////////////////////
@@ -115,7 +181,7 @@ IrMgr::elab_expr(const AstExpr* ast_expr,
 	// 結果を op0 に代入
       }
 
-      return new_UniOp(opcode, type, op0);
+      return fold_const(new_UniOp(opcode, type, op0));
     }
 
   case AstExpr::kBinOp:
@@ -148,7 +214,7 @@ IrMgr::elab_expr(const AstExpr* ast_expr,
 	// キャストノードの挿入
       }
 
-      return new_BinOp(opcode, type, op0, op1);
+      return fold_const(new_BinOp(opcode, type, op0, op1));
     }
 
   case AstExpr::kTriOp:
@@ -190,7 +256,7 @@ IrMgr::elab_expr(const AstExpr* ast_expr,
 	// キャストノードの挿入
       }
 
-      return new_TriOp(opcode, type, op0, op1, op2);
+      return fold_const(new_TriOp(opcode, type, op0, op1, op2));
     }
   }
 
@@ -295,4 +361,61 @@ IrMgr::elab_primary(const AstExpr* ast_expr,
   return NULL;
 }
 
+// @brief 定数式を畳み込む．
+// @param[in] node 演算式のノード
+// @return 畳み込んだ結果のノードを返す．
+//
+// オペランドが全て boolean, int, float の定数なら IrInterp で
+// 評価して定数のロードに置き換える．条件が定数の ITE は
+// 選ばれる方のオペランドに置き換える．
+// 畳み込めない場合には node をそのまま返す．
+IrNode*
+IrMgr::fold_const(IrNode* node)
+{
+  IrInterp interp;
+
+  if ( node->node_type() == IrNode::kTriOp &&
+       node->opcode() == kOpIte &&
+       is_const_load(node->operand(0)) ) {
+    // 型が同じなら条件で選ばれる方をそのまま使う．
+    IrNode* sel = interp.eval_as_boolean(node->operand(0)) ?
+      node->operand(1) : node->operand(2);
+    if ( sel->value_type() == node->value_type() ) {
+      return sel;
+    }
+  }
+
+  if ( !node->is_static() ) {
+    return node;
+  }
+
+  // オペランドは先に畳み込まれているので，畳み込めたものは
+  // 定数のロードになっているはず．
+  ymuint n = node->operand_num();
+  for (ymuint i = 0; i < n; ++ i) {
+    if ( !is_const_load(node->operand(i)) ) {
+      return node;
+    }
+  }
+
+  if ( is_unsafe_op(node, interp) ) {
+    return node;
+  }
+
+  switch ( node->value_type()->type_id() ) {
+  case kBooleanType:
+    return new_Load(new_BooleanConst(ShString(), interp.eval_boolean(node)));
+
+  case kIntType:
+    return new_Load(new_IntConst(ShString(), interp.eval_int(node)));
+
+  case kFloatType:
+    return new_Load(new_FloatConst(ShString(), interp.eval_float(node)));
+
+  default:
+    break;
+  }
+  return node;
+}
+
 END_NAMESPACE_YM_YMSL
@@ -22,6 +22,7 @@
 #include "node/IrFuncCall.h"
 #include "node/IrReturn.h"
 #include "node/IrJump.h"
+#include "node/IrSwitch.h"
 #include "node/IrLabel.h"
 
 
@@ -229,6 +230,28 @@ IrMgr::new_BranchFalse(IrNode* label,
   return new (p) IrJump(IrNode::kBranchFalse, label, cond);
 }
 
+// @brief 多方向分岐ノードを生成する．
+// @param[in] cond 条件
+// @param[in] case_list case の値と飛び先のリスト
+// @param[in] default_label どれにも当てはまらない時の飛び先
+//
+// case_list は値の昇順に並べ替えて持つ．値は重複してはいけない．
+IrNode*
+IrMgr::new_Switch(IrNode* cond,
+		  const vector<pair<Ymsl_INT, IrNode*> >& case_list,
+		  IrNode* default_label)
+{
+  ASSERT_COND( cond != NULL );
+  ASSERT_COND( default_label != NULL );
+  vector<pair<Ymsl_INT, IrNode*> > sorted_list(case_list);
+  sort(sorted_list.begin(), sorted_list.end());
+  for (ymuint i = 1; i < sorted_list.size(); ++ i) {
+    ASSERT_COND( sorted_list[i - 1].first < sorted_list[i].first );
+  }
+  void* p = mAlloc.get_memory(sizeof(IrSwitch));
+  return new (p) IrSwitch(cond, sorted_list, default_label);
+}
+
 // @brief ラベルノードを生成する．
 IrNode*
 IrMgr::new_Label()
@@ -28,6 +28,24 @@
 
 BEGIN_NAMESPACE_YM_YMSL
 
+BEGIN_NONAMESPACE
+
+bool
+check(const vector<Ymsl_INT>& used_val,
+      Ymsl_INT val)
+{
+  for (vector<Ymsl_INT>::const_iterator p = used_val.begin();
+       p != used_val.end(); ++ p) {
+    if ( *p == val ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+END_NONAMESPACE
+
+
 //////////////////////////////////////////////////////////////////////
 // クラス IrMgr
 //////////////////////////////////////////////////////////////////////
@@ -221,7 +239,9 @@ IrMgr::elab_stmt(const AstStatement* stmt,
       IrNode* node2 = new_Jump(label2);
       code_block->add_node(node2);
       code_block->add_node(label1);
-      elab_stmt(stmt->else_stmt(), scope, start_label, end_label, toplevel, code_block);
+      if ( stmt->else_stmt() != NULL ) {
+	elab_stmt(stmt->else_stmt(), scope, start_label, end_label, toplevel, code_block);
+      }
       code_block->add_node(label2);
     }
     break;
@@ -286,11 +306,66 @@ IrMgr::elab_stmt(const AstStatement* stmt,
   case AstStatement::kSwitch:
     {
       IrNode* cond = elab_expr(stmt->expr(), scope);
+      if ( cond == NULL ) {
+	// エラー
+	return;
+      }
+      TypeId cond_type = cond->value_type()->type_id();
+      if ( cond_type != kIntType && cond_type != kEnumType ) {
+	// 整数型ではない．
+	cout << "switch expression is not an integer" << endl;
+	return;
+      }
+
+      // case の値は定数式でなければならない．
+      IrInterp interp;
       ymuint n = stmt->switch_num();
+      vector<IrNode*> label_list(n);
+      vector<pair<Ymsl_INT, IrNode*> > case_list;
+      vector<Ymsl_INT> used_val;
+      IrNode* end1 = new_Label();
+      IrNode* default_label = end1;
       for (ymuint i = 0; i < n; ++ i) {
-	vector<IrNode*> node_list1;
-	elab_stmt(stmt->case_stmt(i), scope, start_label, end_label, toplevel, code_block);
+	IrNode* label1 = new_Label();
+	label_list[i] = label1;
+	const AstExpr* ast_label = stmt->case_label(i);
+	if ( ast_label == NULL ) {
+	  // default
+	  default_label = label1;
+	  continue;
+	}
+	IrNode* node = elab_expr(ast_label, scope);
+	if ( node == NULL ) {
+	  // エラー
+	  return;
+	}
+	TypeId label_type = node->value_type()->type_id();
+	if ( !node->is_static() ||
+	     (label_type != kIntType && label_type != kEnumType) ) {
+	  // 整数の定数式ではない．
+	  cout << "case label is not an integer constant" << endl;
+	  return;
+	}
+	Ymsl_INT v = interp.eval_as_int(node);
+	if ( check(used_val, v) ) {
+	  cout << "duplicated case label" << endl;
+	  return;
+	}
+	used_val.push_back(v);
+	case_list.push_back(make_pair(v, label1));
+      }
+
+      // case 同士のフォールスルーはない．
+      // break は switch 文を抜ける．continue は外側のループに効く．
+      code_block->add_node(new_Switch(cond, case_list, default_label));
+      for (ymuint i = 0; i < n; ++ i) {
+	code_block->add_node(label_list[i]);
+	elab_stmt(stmt->case_stmt(i), scope, start_label, end1, toplevel, code_block);
+	if ( i < n - 1 ) {
+	  code_block->add_node(new_Jump(end1));
+	}
       }
+      code_block->add_node(end1);
     }
     break;
 
@@ -380,23 +455,6 @@ IrMgr::check_name(const AstSymbol* ast_name,
   return true;
 }
 
-BEGIN_NONAMESPACE
-
-bool
-check(const vector<Ymsl_INT>& used_val,
-      Ymsl_INT val)
-{
-  for (vector<Ymsl_INT>::const_iterator p = used_val.begin();
-       p != used_val.end(); ++ p) {
-    if ( *p == val ) {
-      return true;
-    }
-  }
-  return false;
-}
-
-END_NONAMESPACE
-
 // @brief enum 型の定義を行う．
 // @param[in] stmt 文
 //
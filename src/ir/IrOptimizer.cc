@@ -0,0 +1,947 @@
+
+/// @file IrOptimizer.cc
+/// @brief IrOptimizer の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrOptimizer.h"
+#include "IrMgr.h"
+#include "IrSsa.h"
+#include "IrCodeBlock.h"
+#include "IrHandle.h"
+#include "IrNode.h"
+#include "Type.h"
+#include "YmslMutex.h"
+
+#include <cstring>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 関数呼び出しを含む時 true を返す．
+bool
+has_call(IrNode* node)
+{
+  if ( node->node_type() == IrNode::kFuncCall ) {
+    return true;
+  }
+  vector<IrNode*> child_list;
+  IrSsa::get_child_list(node, child_list);
+  for (vector<IrNode*>::iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    if ( has_call(*p) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 0 による除算で止まる可能性のある時 true を返す．
+bool
+may_trap(IrNode* node)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kBinOp:
+    if ( node->value_type()->type_id() == kIntType &&
+	 (node->opcode() == kOpDiv || node->opcode() == kOpMod) ) {
+      return true;
+    }
+    return may_trap(node->operand(0)) || may_trap(node->operand(1));
+
+  case IrNode::kUniOp:
+    return may_trap(node->operand(0));
+
+  case IrNode::kTriOp:
+    return may_trap(node->operand(0)) || may_trap(node->operand(1)) ||
+      may_trap(node->operand(2));
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// オペランドを入れ替えても値の変わらない演算の時 true を返す．
+bool
+is_commutative(IrNode* node)
+{
+  switch ( node->value_type()->type_id() ) {
+  case kBooleanType:
+  case kIntType:
+  case kFloatType:
+    break;
+
+  default:
+    // 文字列の連結など
+    return false;
+  }
+
+  switch ( node->opcode() ) {
+  case kOpBitAnd:
+  case kOpBitOr:
+  case kOpBitXor:
+  case kOpAdd:
+  case kOpMul:
+  case kOpEqual:
+  case kOpNotEq:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// 式の中で読んでいるローカル変数の値を集める．
+void
+get_read_list(const IrSsa& ssa,
+	      IrNode* node,
+	      vector<ymuint>& read_list)
+{
+  ymuint val_id = ssa.read_value(node);
+  if ( val_id != IrSsa::kNoValue ) {
+    read_list.push_back(val_id);
+  }
+  vector<IrNode*> child_list;
+  IrSsa::get_child_list(node, child_list);
+  for (vector<IrNode*>::iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    get_read_list(ssa, *p, read_list);
+  }
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrOptimizer::VnKey
+//////////////////////////////////////////////////////////////////////
+
+// @brief ハッシュ値を返す．
+ymuint
+IrOptimizer::VnKey::hash() const
+{
+  ymuint h = mKind;
+  h = h * 1021 + reinterpret_cast<ympuint>(mType) / sizeof(void*);
+  h = h * 1021 + mOpr[0];
+  h = h * 1021 + mOpr[1];
+  h = h * 1021 + mOpr[2];
+  return h;
+}
+
+// @brief 等価比較演算子
+bool
+IrOptimizer::VnKey::operator==(const VnKey& right) const
+{
+  return mKind == right.mKind && mType == right.mType &&
+    mOpr[0] == right.mOpr[0] && mOpr[1] == right.mOpr[1] &&
+    mOpr[2] == right.mOpr[2];
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrOptimizer
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] mgr ノードを生成するオブジェクト
+IrOptimizer::IrOptimizer(IrMgr& mgr) :
+  mMgr(mgr)
+{
+  mSsa = NULL;
+  mCodeBlock = NULL;
+  mVnNum = 0;
+  mTempNum = 0;
+}
+
+// @brief デストラクタ
+IrOptimizer::~IrOptimizer()
+{
+}
+
+// @brief コードブロックの最適化を行う．
+// @param[in] code_block 対象のコードブロック
+void
+IrOptimizer::optimize(IrCodeBlock* code_block)
+{
+  mTempNum = 0;
+
+  {
+    IrSsa ssa;
+    if ( !ssa.build(code_block) ) {
+      return;
+    }
+    prop_and_cse(ssa, code_block);
+  }
+
+  bool changed;
+  {
+    IrSsa ssa;
+    if ( !ssa.build(code_block) ) {
+      return;
+    }
+    changed = opt_loop(ssa, code_block);
+  }
+
+  if ( changed ) {
+    // ループの中に残った一時変数のコピーを伝播させる．
+    IrSsa ssa;
+    if ( !ssa.build(code_block) ) {
+      return;
+    }
+    prop_and_cse(ssa, code_block);
+  }
+
+  // コピー伝播と共通部分式の削除で読まれなくなった代入を
+  // 取り除くために SSA 形式を作り直す．
+  {
+    IrSsa ssa;
+    if ( !ssa.build(code_block) ) {
+      return;
+    }
+    elim_dead_store(ssa, code_block);
+  }
+}
+
+// @brief コピー伝播と共通部分式の削除を行う．
+// @param[in] ssa SSA 形式
+// @param[in] code_block 対象のコードブロック
+void
+IrOptimizer::prop_and_cse(const IrSsa& ssa,
+			  IrCodeBlock* code_block)
+{
+  mSsa = &ssa;
+  mCodeBlock = code_block;
+
+  ymuint nn = ssa.node_num();
+  mVnNum = 0;
+  mVnDict.clear();
+  mValueVn.clear();
+  mValueVn.resize(ssa.value_num(), IrSsa::kNoValue);
+  mNodeVn.clear();
+  mNodeVn.resize(nn, IrSsa::kNoValue);
+  mNodeSize.clear();
+  mNodeSize.resize(nn, 0);
+  mLeader.clear();
+  mLeaderStack.clear();
+  mReuse.clear();
+  mReuse.resize(nn, NULL);
+  mReuseCount.clear();
+  mReuseCount.resize(nn, 0);
+  mTemp.clear();
+  mTemp.resize(nn, NULL);
+  mReplace.clear();
+  mReplace.resize(nn, NULL);
+
+  cse_block(0);
+
+  // 一時変数への代入とロードで増える2命令よりも
+  // 再計算を省ける命令数が多い場合だけ一時変数を作る．
+  for (ymuint id = 0; id < nn; ++ id) {
+    IrNode* leader = mReuse[id];
+    if ( leader == NULL ) {
+      continue;
+    }
+    ymuint leader_id = leader->id();
+    if ( mTemp[leader_id] != NULL ) {
+      continue;
+    }
+    if ( (mNodeSize[leader_id] - 1) * mReuseCount[leader_id] <= 2 ) {
+      continue;
+    }
+    mTemp[leader_id] = new_temp("__cse", leader->value_type());
+  }
+
+  // SSA 形式から元の変数を使った形に戻す．
+  // 変数の値を置き換えるのはその位置で値の変わっていないものだけ
+  // なので phi は取り除くだけでよい．
+  const vector<IrNode*>& node_list = code_block->node_list();
+  vector<IrNode*> new_node_list;
+  new_node_list.reserve(node_list.size());
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    rewrite_stmt(*p, new_node_list);
+  }
+  code_block->set_node_list(new_node_list);
+
+  mSsa = NULL;
+  mCodeBlock = NULL;
+}
+
+// @brief 不要な代入を削除する．
+// @param[in] ssa SSA 形式
+// @param[in] code_block 対象のコードブロック
+void
+IrOptimizer::elim_dead_store(const IrSsa& ssa,
+			     IrCodeBlock* code_block)
+{
+  ymuint nv = ssa.value_num();
+
+  // 値ごとに，その値が必要な時に必要になる値のリスト
+  vector<vector<ymuint> > dep_list_array(nv);
+
+  // 必ず必要な値のリスト
+  vector<ymuint> root_list;
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  ymuint nb = ssa.block_num();
+  for (ymuint b = 0; b < nb; ++ b) {
+    if ( !ssa.block_reachable(b) ) {
+      continue;
+    }
+    for (ymuint i = ssa.block_begin(b); i < ssa.block_end(b); ++ i) {
+      IrNode* node = node_list[i];
+      ymuint def_id = ssa.def_value(node);
+      if ( def_id == IrSsa::kNoValue ) {
+	get_read_list(ssa, node, root_list);
+      }
+      else if ( !has_call(node) ) {
+	// 代入を取り除けば右辺の読み出しもなくなる．
+	get_read_list(ssa, node, dep_list_array[def_id]);
+      }
+      else {
+	// 右辺は式文として残す．
+	ymuint val_id = ssa.read_value(node);
+	if ( val_id != IrSsa::kNoValue ) {
+	  dep_list_array[def_id].push_back(val_id);
+	}
+	vector<IrNode*> child_list;
+	IrSsa::get_child_list(node, child_list);
+	for (vector<IrNode*>::iterator p = child_list.begin();
+	     p != child_list.end(); ++ p) {
+	  get_read_list(ssa, *p, root_list);
+	}
+      }
+    }
+  }
+  for (ymuint val_id = 0; val_id < nv; ++ val_id) {
+    if ( ssa.value_kind(val_id) == IrSsa::kPhi ) {
+      const vector<ymuint>& input_list = ssa.phi_input_list(val_id);
+      for (vector<ymuint>::const_iterator p = input_list.begin();
+	   p != input_list.end(); ++ p) {
+	if ( *p != IrSsa::kNoValue ) {
+	  dep_list_array[val_id].push_back(*p);
+	}
+      }
+    }
+  }
+
+  // 必ず必要な値から依存関係をたどって印をつける．
+  // phi を介した循環があっても印のつかない値は読まれない．
+  vector<bool> live(nv, false);
+  while ( !root_list.empty() ) {
+    ymuint val_id = root_list.back();
+    root_list.pop_back();
+    if ( live[val_id] ) {
+      continue;
+    }
+    live[val_id] = true;
+    const vector<ymuint>& dep_list = dep_list_array[val_id];
+    root_list.insert(root_list.end(), dep_list.begin(), dep_list.end());
+  }
+
+  vector<IrNode*> new_node_list;
+  new_node_list.reserve(node_list.size());
+  bool changed = false;
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    ymuint def_id = ssa.def_value(node);
+    if ( def_id == IrSsa::kNoValue || live[def_id] ) {
+      new_node_list.push_back(node);
+      continue;
+    }
+    changed = true;
+    if ( has_call(node) ) {
+      // 関数呼び出しを含む右辺は式文として残す．
+      if ( node->node_type() == IrNode::kStore ) {
+	new_node_list.push_back(node->store_val());
+      }
+      else {
+	ASSERT_COND( node->node_type() == IrNode::kInplaceBinOp );
+	new_node_list.push_back(node->operand(0));
+      }
+    }
+  }
+  if ( changed ) {
+    code_block->set_node_list(new_node_list);
+  }
+}
+
+// @brief 支配木の順にブロックをたどって共通部分式を探す．
+// @param[in] block_id ブロック番号
+void
+IrOptimizer::cse_block(ymuint block_id)
+{
+  // このブロックより前に登録された計算済みの式の数
+  ymuint mark = mLeaderStack.size();
+
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint end = mSsa->block_end(block_id);
+  for (ymuint i = mSsa->block_begin(block_id); i < end; ++ i) {
+    IrNode* node = node_list[i];
+    vector<IrNode*> expr_list;
+    get_expr_list(node, expr_list);
+    bool call = false;
+    for (vector<IrNode*>::iterator p = expr_list.begin();
+	 p != expr_list.end(); ++ p) {
+      calc_vn(*p);
+      if ( has_call(*p) ) {
+	call = true;
+      }
+    }
+    mLeader.resize(mVnNum, NULL);
+    for (vector<IrNode*>::iterator p = expr_list.begin();
+	 p != expr_list.end(); ++ p) {
+      find_cse(*p, false, call);
+    }
+  }
+
+  const vector<ymuint>& child_list = mSsa->block_child_list(block_id);
+  for (vector<ymuint>::const_iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    cse_block(*p);
+  }
+
+  // 支配木の兄弟には計算済みの式を見せない．
+  while ( mLeaderStack.size() > mark ) {
+    mLeader[mLeaderStack.back()] = NULL;
+    mLeaderStack.pop_back();
+  }
+}
+
+// @brief 式の値番号を求める．
+// @param[in] node 対象のノード
+void
+IrOptimizer::calc_vn(IrNode* node)
+{
+  ymuint id = node->id();
+  ymuint vn;
+  ymuint size = 1;
+  switch ( node->node_type() ) {
+  case IrNode::kLoad:
+    {
+      IrHandle* addr = node->address();
+      switch ( addr->handle_type() ) {
+      case IrHandle::kLocalVar:
+	{
+	  ymuint val_id = mSsa->read_value(node);
+	  if ( val_id != IrSsa::kNoValue ) {
+	    vn = value_vn(val_id);
+	  }
+	  else {
+	    vn = mVnNum;
+	    ++ mVnNum;
+	  }
+	}
+	break;
+
+      case IrHandle::kBooleanConst:
+      case IrHandle::kIntConst:
+      case IrHandle::kFloatConst:
+	vn = const_vn(addr);
+	break;
+
+      default:
+	// グローバル変数は関数呼び出しで変わりうるので毎回別の値とする．
+	vn = mVnNum;
+	++ mVnNum;
+	break;
+      }
+    }
+    break;
+
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+    {
+      VnKey key;
+      key.mKind = (static_cast<ymuint>(node->node_type()) << 8) |
+	static_cast<ymuint>(node->opcode());
+      key.mType = node->value_type();
+      key.mOpr[0] = 0;
+      key.mOpr[1] = 0;
+      key.mOpr[2] = 0;
+      ymuint n = node->operand_num();
+      for (ymuint i = 0; i < n; ++ i) {
+	IrNode* opr = node->operand(i);
+	calc_vn(opr);
+	key.mOpr[i] = mNodeVn[opr->id()];
+	size += mNodeSize[opr->id()];
+      }
+      if ( node->node_type() == IrNode::kBinOp && is_commutative(node) &&
+	   key.mOpr[0] > key.mOpr[1] ) {
+	ymuint tmp = key.mOpr[0];
+	key.mOpr[0] = key.mOpr[1];
+	key.mOpr[1] = tmp;
+      }
+      vn = find_vn(key);
+    }
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint n = node->arglist_num();
+      for (ymuint i = 0; i < n; ++ i) {
+	IrNode* arg = node->arglist_elem(i);
+	calc_vn(arg);
+	size += mNodeSize[arg->id()];
+      }
+      vn = mVnNum;
+      ++ mVnNum;
+    }
+    break;
+
+  default:
+    vn = mVnNum;
+    ++ mVnNum;
+    break;
+  }
+
+  mNodeVn[id] = vn;
+  mNodeSize[id] = size;
+}
+
+// @brief 式の中から共通部分式を探す．
+// @param[in] node 対象のノード
+// @param[in] cond 条件付きで評価される位置の時 true
+// @param[in] has_call 文の中に関数呼び出しを含む時 true
+void
+IrOptimizer::find_cse(IrNode* node,
+		      bool cond,
+		      bool has_call)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint n = node->arglist_num();
+      for (ymuint i = 0; i < n; ++ i) {
+	find_cse(node->arglist_elem(i), cond, has_call);
+      }
+    }
+    return;
+
+  default:
+    return;
+  }
+
+  ymuint id = node->id();
+  ymuint vn = mNodeVn[id];
+  IrNode* leader = mLeader[vn];
+  if ( leader != NULL ) {
+    // 計算済みの値を使う．
+    mReuse[id] = leader;
+    ++ mReuseCount[leader->id()];
+    return;
+  }
+
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    find_cse(node->operand(0), cond, has_call);
+    break;
+
+  case IrNode::kBinOp:
+    {
+      // 論理演算の右辺は左辺の値によっては評価されない．
+      bool cond1 = cond ||
+	node->opcode() == kOpLogAnd || node->opcode() == kOpLogOr;
+      find_cse(node->operand(0), cond, has_call);
+      find_cse(node->operand(1), cond1, has_call);
+    }
+    break;
+
+  case IrNode::kTriOp:
+    find_cse(node->operand(0), cond, has_call);
+    find_cse(node->operand(1), true, has_call);
+    find_cse(node->operand(2), true, has_call);
+    break;
+
+  default:
+    ASSERT_NOT_REACHED;
+    break;
+  }
+
+  // 計算結果は文の前で一時変数に入れるので，
+  // 必ず評価される式だけを登録する．
+  // 関数呼び出しより前に 0 除算で止まるようになってはいけないので，
+  // その場合も登録しない．
+  if ( !cond && !(has_call && may_trap(node)) ) {
+    mLeader[vn] = node;
+    mLeaderStack.push_back(vn);
+  }
+}
+
+// @brief ローカル変数の値の値番号を返す．
+// @param[in] val_id SSA 形式の値の番号
+ymuint
+IrOptimizer::value_vn(ymuint val_id)
+{
+  ymuint vn = mValueVn[val_id];
+  if ( vn != IrSsa::kNoValue ) {
+    return vn;
+  }
+
+  // コピーはコピー元と同じ値番号にする．
+  IrNode* const_node = mSsa->copy_const(val_id);
+  ymuint src_id = mSsa->copy_src(val_id);
+  if ( const_node != NULL ) {
+    vn = const_vn(const_node->address());
+  }
+  else if ( src_id != IrSsa::kNoValue ) {
+    vn = value_vn(src_id);
+  }
+  else {
+    vn = mVnNum;
+    ++ mVnNum;
+  }
+  mValueVn[val_id] = vn;
+  return vn;
+}
+
+// @brief 定数の値番号を返す．
+// @param[in] handle 定数のハンドル
+ymuint
+IrOptimizer::const_vn(IrHandle* handle)
+{
+  VnKey key;
+  key.mKind = (static_cast<ymuint>(IrNode::kLoad) << 8) |
+    static_cast<ymuint>(handle->handle_type());
+  key.mType = NULL;
+  key.mOpr[0] = 0;
+  key.mOpr[1] = 0;
+  key.mOpr[2] = 0;
+  switch ( handle->handle_type() ) {
+  case IrHandle::kBooleanConst:
+    key.mOpr[0] = handle->boolean_val() ? 1 : 0;
+    break;
+
+  case IrHandle::kIntConst:
+    key.mOpr[0] = static_cast<ymuint>(handle->int_val());
+    break;
+
+  case IrHandle::kFloatConst:
+    {
+      // 0.0 と -0.0 を区別するためにビットパタンで比べる．
+      Ymsl_FLOAT val = handle->float_val();
+      ymuint64 bits;
+      memcpy(&bits, &val, sizeof(Ymsl_FLOAT));
+      key.mOpr[0] = static_cast<ymuint>(bits);
+      key.mOpr[1] = static_cast<ymuint>(bits >> 32);
+    }
+    break;
+
+  default:
+    {
+      // 文字列などは同じものとみなさない．
+      ymuint vn = mVnNum;
+      ++ mVnNum;
+      return vn;
+    }
+  }
+  return find_vn(key);
+}
+
+// @brief キーに対応する値番号を返す．
+// @param[in] key キー
+//
+// 未登録なら新しい番号を割り当てる．
+ymuint
+IrOptimizer::find_vn(const VnKey& key)
+{
+  ymuint vn;
+  if ( mVnDict.find(key, vn) ) {
+    return vn;
+  }
+  vn = mVnNum;
+  ++ mVnNum;
+  mVnDict.add(key, vn);
+  return vn;
+}
+
+// @brief 一時変数を作る．
+// @param[in] prefix 名前の接頭辞
+// @param[in] type 型
+IrHandle*
+IrOptimizer::new_temp(const char* prefix,
+		      const Type* type)
+{
+  ostringstream buf;
+  buf << prefix << mTempNum;
+  ++ mTempNum;
+  ShString name = intern_ShString(buf.str().c_str());
+  IrHandle* var = mMgr.new_LocalVarHandle(name, type, 0,
+					  mCodeBlock->next_local_index());
+  mCodeBlock->add_local_var(var);
+  return var;
+}
+
+// @brief 文を書き換える．
+// @param[in] node 対象の文
+// @param[out] node_list 結果の文を追加するリスト
+void
+IrOptimizer::rewrite_stmt(IrNode* node,
+			  vector<IrNode*>& node_list)
+{
+  vector<IrNode*> pre_list;
+  IrNode* new_node = node;
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+  case IrNode::kLoad:
+  case IrNode::kFuncCall:
+    new_node = rewrite_expr(node, pre_list);
+    if ( new_node->node_type() == IrNode::kLoad && !pre_list.empty() &&
+	 pre_list.back()->address() == new_node->address() ) {
+      // 一時変数に入れた値を捨てるだけの式文は要らない．
+      new_node = NULL;
+    }
+    break;
+
+  case IrNode::kStore:
+    {
+      IrNode* val = rewrite_expr(node->store_val(), pre_list);
+      if ( val != node->store_val() ) {
+	new_node = mMgr.new_Store(node->address(), val);
+      }
+    }
+    break;
+
+  case IrNode::kInplaceBinOp:
+    {
+      IrNode* opr = rewrite_expr(node->operand(0), pre_list);
+      if ( opr != node->operand(0) ) {
+	new_node = mMgr.new_InplaceBinOp(node->opcode(), node->address(), opr);
+      }
+    }
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      IrNode* val = rewrite_expr(node->return_val(), pre_list);
+      if ( val != node->return_val() ) {
+	new_node = mMgr.new_Return(val);
+      }
+    }
+    break;
+
+  case IrNode::kBranchTrue:
+    {
+      IrNode* cond = rewrite_expr(node->branch_cond(), pre_list);
+      if ( cond != node->branch_cond() ) {
+	new_node = mMgr.new_BranchTrue(node->jump_addr(), cond);
+      }
+    }
+    break;
+
+  case IrNode::kBranchFalse:
+    {
+      IrNode* cond = rewrite_expr(node->branch_cond(), pre_list);
+      if ( cond != node->branch_cond() ) {
+	new_node = mMgr.new_BranchFalse(node->jump_addr(), cond);
+      }
+    }
+    break;
+
+  case IrNode::kSwitch:
+    {
+      IrNode* cond = rewrite_expr(node->branch_cond(), pre_list);
+      if ( cond != node->branch_cond() ) {
+	ymuint nc = node->case_num();
+	vector<pair<Ymsl_INT, IrNode*> > case_list(nc);
+	for (ymuint i = 0; i < nc; ++ i) {
+	  case_list[i] = make_pair(node->case_val(i), node->case_label(i));
+	}
+	new_node = mMgr.new_Switch(cond, case_list, node->jump_addr());
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  node_list.insert(node_list.end(), pre_list.begin(), pre_list.end());
+  if ( new_node != NULL ) {
+    node_list.push_back(new_node);
+  }
+}
+
+// @brief 式を書き換える．
+// @param[in] node 対象の式
+// @param[out] pre_list 一時変数への代入を追加するリスト
+// @return 書き換えた式を返す．
+//
+// 書き換える必要がなければ node をそのまま返す．
+IrNode*
+IrOptimizer::rewrite_expr(IrNode* node,
+			  vector<IrNode*>& pre_list)
+{
+  ymuint id = node->id();
+  if ( mReplace[id] != NULL ) {
+    return mMgr.new_Load(mReplace[id]);
+  }
+
+  IrNode* leader = mReuse[id];
+  if ( leader != NULL && mTemp[leader->id()] != NULL ) {
+    return mMgr.new_Load(mTemp[leader->id()]);
+  }
+
+  IrNode* new_node = node;
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    {
+      IrNode* opr1 = rewrite_expr(node->operand(0), pre_list);
+      if ( opr1 != node->operand(0) ) {
+	new_node = mMgr.new_UniOp(node->opcode(), node->value_type(), opr1);
+	new_node = mMgr.fold_const(new_node);
+      }
+    }
+    break;
+
+  case IrNode::kBinOp:
+    {
+      IrNode* opr1 = rewrite_expr(node->operand(0), pre_list);
+      IrNode* opr2 = rewrite_expr(node->operand(1), pre_list);
+      if ( opr1 != node->operand(0) || opr2 != node->operand(1) ) {
+	new_node = mMgr.new_BinOp(node->opcode(), node->value_type(), opr1, opr2);
+	new_node = mMgr.fold_const(new_node);
+      }
+    }
+    break;
+
+  case IrNode::kTriOp:
+    {
+      IrNode* opr1 = rewrite_expr(node->operand(0), pre_list);
+      IrNode* opr2 = rewrite_expr(node->operand(1), pre_list);
+      IrNode* opr3 = rewrite_expr(node->operand(2), pre_list);
+      if ( opr1 != node->operand(0) || opr2 != node->operand(1) ||
+	   opr3 != node->operand(2) ) {
+	new_node = mMgr.new_TriOp(node->opcode(), node->value_type(),
+				  opr1, opr2, opr3);
+	new_node = mMgr.fold_const(new_node);
+      }
+    }
+    break;
+
+  case IrNode::kLoad:
+    new_node = rewrite_load(node);
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint n = node->arglist_num();
+      vector<IrNode*> arglist(n);
+      bool changed = false;
+      for (ymuint i = 0; i < n; ++ i) {
+	IrNode* arg = node->arglist_elem(i);
+	arglist[i] = rewrite_expr(arg, pre_list);
+	if ( arglist[i] != arg ) {
+	  changed = true;
+	}
+      }
+      if ( changed ) {
+	new_node = mMgr.new_FuncCall(arglist);
+	new_node->set_function_address(node->function_address());
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  IrHandle* temp = mTemp[id];
+  if ( temp != NULL ) {
+    // 再利用される値は一時変数に入れておく．
+    pre_list.push_back(mMgr.new_Store(temp, new_node));
+    new_node = mMgr.new_Load(temp);
+  }
+
+  return new_node;
+}
+
+// @brief ロードをコピー元のロードに書き換える．
+// @param[in] node 対象のロード
+IrNode*
+IrOptimizer::rewrite_load(IrNode* node)
+{
+  ymuint val_id = mSsa->read_value(node);
+  if ( val_id == IrSsa::kNoValue ) {
+    return node;
+  }
+
+  // 定数のコピーなら定数を読む．
+  for (ymuint src_id = val_id; src_id != IrSsa::kNoValue;
+       src_id = mSsa->copy_src(src_id)) {
+    IrNode* const_node = mSsa->copy_const(src_id);
+    if ( const_node != NULL ) {
+      return mMgr.new_Load(const_node->address());
+    }
+  }
+
+  ymuint prop_id = mSsa->prop_value(node);
+  if ( prop_id != val_id ) {
+    ymuint var = mSsa->value_var(prop_id);
+    return mMgr.new_Load(mCodeBlock->var_list()[var]);
+  }
+
+  return node;
+}
+
+// @brief 文の中の式の根を得る．
+// @param[in] node 対象の文
+// @param[out] expr_list 式の根を入れるリスト
+//
+// 代入先のハンドルの中の式は含めない．
+void
+IrOptimizer::get_expr_list(IrNode* node,
+			   vector<IrNode*>& expr_list)
+{
+  expr_list.clear();
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+  case IrNode::kLoad:
+  case IrNode::kFuncCall:
+    expr_list.push_back(node);
+    break;
+
+  case IrNode::kStore:
+    expr_list.push_back(node->store_val());
+    break;
+
+  case IrNode::kInplaceBinOp:
+    expr_list.push_back(node->operand(0));
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      expr_list.push_back(node->return_val());
+    }
+    break;
+
+  case IrNode::kBranchTrue:
+  case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
+    expr_list.push_back(node->branch_cond());
+    break;
+
+  default:
+    break;
+  }
+}
+
+END_NAMESPACE_YM_YMSL
+
@@ -0,0 +1,666 @@
+
+/// @file IrOptimizer_loop.cc
+/// @brief IrOptimizer の実装ファイル(ループの最適化)
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrOptimizer.h"
+#include "IrMgr.h"
+#include "IrSsa.h"
+#include "IrCodeBlock.h"
+#include "IrHandle.h"
+#include "IrNode.h"
+#include "Type.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// int 型の定数のロードの時 true を返す．
+bool
+is_int_const(IrNode* node)
+{
+  return node->node_type() == IrNode::kLoad &&
+    node->address()->handle_type() == IrHandle::kIntConst;
+}
+
+// ローカル変数 var のロードの時 true を返す．
+bool
+is_var_load(IrNode* node,
+	    ymuint var)
+{
+  return node->node_type() == IrNode::kLoad &&
+    node->address()->handle_type() == IrHandle::kLocalVar &&
+    node->address()->local_index() == var;
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrOptimizer
+//////////////////////////////////////////////////////////////////////
+
+// @brief ループ不変式の移動と強さの低減を行う．
+// @param[in] ssa SSA 形式
+// @param[in] code_block 対象のコードブロック
+// @return 変形を行った時 true を返す．
+bool
+IrOptimizer::opt_loop(const IrSsa& ssa,
+		      IrCodeBlock* code_block)
+{
+  mSsa = &ssa;
+  mCodeBlock = code_block;
+
+  find_loops();
+  if ( mLoopList.empty() ) {
+    mSsa = NULL;
+    mCodeBlock = NULL;
+    return false;
+  }
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  ymuint n = node_list.size();
+  ymuint nn = ssa.node_num();
+  mNodeLevel.clear();
+  mNodeLevel.resize(nn, 0);
+  mReplace.clear();
+  mReplace.resize(nn, NULL);
+  mPostList.clear();
+  mPostList.resize(n);
+  mSrList.clear();
+
+  ymuint nb = ssa.block_num();
+  for (ymuint b = 0; b < nb; ++ b) {
+    const vector<ymuint>& loop_list = mBlockLoopList[b];
+    if ( loop_list.empty() ) {
+      continue;
+    }
+    for (ymuint i = ssa.block_begin(b); i < ssa.block_end(b); ++ i) {
+      vector<IrNode*> expr_list;
+      get_expr_list(node_list[i], expr_list);
+      for (vector<IrNode*>::iterator p = expr_list.begin();
+	   p != expr_list.end(); ++ p) {
+	calc_level(*p, loop_list);
+	find_inv(*p, loop_list);
+      }
+    }
+  }
+
+  // ヘッダの位置をキーにしてループ番号を保持する配列
+  vector<ymuint> header_loop(n, IrSsa::kNoValue);
+  bool changed = false;
+  for (ymuint i = 0; i < mLoopList.size(); ++ i) {
+    const Loop& loop = mLoopList[i];
+    if ( !loop.mPreList.empty() ) {
+      header_loop[ssa.block_begin(loop.mHeader)] = i;
+      changed = true;
+    }
+  }
+
+  if ( changed ) {
+    // rewrite_expr() で使う配列
+    mReuse.clear();
+    mReuse.resize(nn, NULL);
+    mTemp.clear();
+    mTemp.resize(nn, NULL);
+
+    vector<IrNode*> new_node_list;
+    new_node_list.reserve(n);
+    for (ymuint i = 0; i < n; ++ i) {
+      if ( header_loop[i] != IrSsa::kNoValue ) {
+	const vector<IrNode*>& pre_list = mLoopList[header_loop[i]].mPreList;
+	new_node_list.insert(new_node_list.end(), pre_list.begin(), pre_list.end());
+      }
+      rewrite_stmt(node_list[i], new_node_list);
+      const vector<IrNode*>& post_list = mPostList[i];
+      new_node_list.insert(new_node_list.end(), post_list.begin(), post_list.end());
+    }
+    code_block->set_node_list(new_node_list);
+  }
+
+  mSsa = NULL;
+  mCodeBlock = NULL;
+  return changed;
+}
+
+// @brief 自然ループを求める．
+//
+// ヘッダがループの末尾を支配しているような枝を逆辺とし，
+// 同じヘッダを持つ逆辺のループはまとめる．
+void
+IrOptimizer::find_loops()
+{
+  const IrSsa& ssa = *mSsa;
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint nb = ssa.block_num();
+  ymuint nv = mCodeBlock->var_list().size();
+
+  mLoopList.clear();
+  vector<ymuint> header_loop(nb, IrSsa::kNoValue);
+  for (ymuint b = 0; b < nb; ++ b) {
+    if ( !ssa.block_reachable(b) ) {
+      continue;
+    }
+    const vector<ymuint>& succ_list = ssa.block_succ_list(b);
+    for (vector<ymuint>::const_iterator p = succ_list.begin();
+	 p != succ_list.end(); ++ p) {
+      ymuint h = *p;
+      if ( !ssa.dominates(h, b) ) {
+	continue;
+      }
+      if ( header_loop[h] == IrSsa::kNoValue ) {
+	header_loop[h] = mLoopList.size();
+	mLoopList.push_back(Loop());
+	Loop& loop = mLoopList.back();
+	loop.mHeader = h;
+	loop.mBodyMark.resize(nb, false);
+	loop.mBodyMark[h] = true;
+	loop.mSize = 1;
+	loop.mIvState.resize(nv, 0);
+      }
+      Loop& loop = mLoopList[header_loop[h]];
+
+      // ヘッダを通らずに b に到達できるブロックを集める．
+      vector<ymuint> queue;
+      queue.push_back(b);
+      while ( !queue.empty() ) {
+	ymuint b1 = queue.back();
+	queue.pop_back();
+	if ( loop.mBodyMark[b1] ) {
+	  continue;
+	}
+	loop.mBodyMark[b1] = true;
+	++ loop.mSize;
+	const vector<ymuint>& pred_list = ssa.block_pred_list(b1);
+	queue.insert(queue.end(), pred_list.begin(), pred_list.end());
+      }
+    }
+  }
+
+  mBlockLoopList.clear();
+  mBlockLoopList.resize(nb);
+  for (ymuint i = 0; i < mLoopList.size(); ++ i) {
+    Loop& loop = mLoopList[i];
+    ymuint h = loop.mHeader;
+
+    // ループの外からヘッダに入るのが直前のブロックからの
+    // fall through だけならラベルの直前に文を置ける．
+    loop.mHasPreheader = false;
+    const vector<ymuint>& pred_list = ssa.block_pred_list(h);
+    ymuint outer_pred = IrSsa::kNoValue;
+    ymuint outer_num = 0;
+    for (vector<ymuint>::const_iterator p = pred_list.begin();
+	 p != pred_list.end(); ++ p) {
+      if ( !loop.mBodyMark[*p] ) {
+	outer_pred = *p;
+	++ outer_num;
+      }
+    }
+    ymuint begin = ssa.block_begin(h);
+    if ( outer_num == 1 && outer_pred + 1 == h &&
+	 begin < ssa.block_end(h) &&
+	 node_list[begin]->node_type() == IrNode::kLabel ) {
+      bool jump = false;
+      if ( ssa.block_end(outer_pred) > ssa.block_begin(outer_pred) ) {
+	IrNode* last = node_list[ssa.block_end(outer_pred) - 1];
+	switch ( last->node_type() ) {
+	case IrNode::kJump:
+	case IrNode::kBranchTrue:
+	case IrNode::kBranchFalse:
+	  jump = (last->jump_addr() == node_list[begin]);
+	  break;
+
+	case IrNode::kSwitch:
+	  // 直前に置いたコードには到達しない．
+	  jump = true;
+	  break;
+
+	default:
+	  break;
+	}
+      }
+      loop.mHasPreheader = !jump;
+    }
+
+    for (ymuint b = 0; b < nb; ++ b) {
+      if ( loop.mBodyMark[b] ) {
+	mBlockLoopList[b].push_back(i);
+      }
+    }
+  }
+
+  // 外側のループほど大きいのでブロック数の降順に並べる．
+  for (ymuint b = 0; b < nb; ++ b) {
+    vector<ymuint>& loop_list = mBlockLoopList[b];
+    for (ymuint i = 1; i < loop_list.size(); ++ i) {
+      ymuint tmp = loop_list[i];
+      ymuint j = i;
+      for ( ; j > 0 && mLoopList[loop_list[j - 1]].mSize < mLoopList[tmp].mSize; -- j) {
+	loop_list[j] = loop_list[j - 1];
+      }
+      loop_list[j] = tmp;
+    }
+  }
+}
+
+// @brief 式がどのループまで不変かを求める．
+// @param[in] node 対象のノード
+// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+// @return 不変となる最も外側のループの loop_list 上の位置を返す．
+//
+// どのループでも不変でない場合には loop_list.size() を返す．
+// 部分式の結果は mNodeLevel に入る．
+ymuint
+IrOptimizer::calc_level(IrNode* node,
+			const vector<ymuint>& loop_list)
+{
+  ymuint n = loop_list.size();
+  ymuint level = n;
+  switch ( node->node_type() ) {
+  case IrNode::kLoad:
+    switch ( node->address()->handle_type() ) {
+    case IrHandle::kBooleanConst:
+    case IrHandle::kIntConst:
+    case IrHandle::kFloatConst:
+    case IrHandle::kStringConst:
+      level = 0;
+      break;
+
+    case IrHandle::kLocalVar:
+      {
+	ymuint val_id = mSsa->read_value(node);
+	if ( val_id != IrSsa::kNoValue ) {
+	  // 値を定義しているブロックを含まないループでは不変
+	  ymuint def_block = mSsa->value_block(val_id);
+	  for (level = 0; level < n; ++ level) {
+	    if ( !mLoopList[loop_list[level]].mBodyMark[def_block] ) {
+	      break;
+	    }
+	  }
+	}
+      }
+      break;
+
+    default:
+      // グローバル変数は関数呼び出しで変わりうる．
+      break;
+    }
+    break;
+
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+    {
+      level = 0;
+      ymuint no = node->operand_num();
+      for (ymuint i = 0; i < no; ++ i) {
+	ymuint level1 = calc_level(node->operand(i), loop_list);
+	if ( level < level1 ) {
+	  level = level1;
+	}
+      }
+      if ( node->node_type() == IrNode::kBinOp &&
+	   node->value_type()->type_id() == kIntType &&
+	   (node->opcode() == kOpDiv || node->opcode() == kOpMod) ) {
+	// ループの前に移すと実行されないはずの 0 除算で止まりうる．
+	// 0 と -1 以外の定数で割る場合だけは移してもよい．
+	IrNode* opr2 = node->operand(1);
+	if ( !is_int_const(opr2) || opr2->address()->int_val() == 0 ||
+	     opr2->address()->int_val() == -1 ) {
+	  level = n;
+	}
+      }
+    }
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint na = node->arglist_num();
+      for (ymuint i = 0; i < na; ++ i) {
+	calc_level(node->arglist_elem(i), loop_list);
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  mNodeLevel[node->id()] = level;
+  return level;
+}
+
+// @brief 式の中からループ不変式と強さの低減を行える積を探す．
+// @param[in] node 対象のノード
+// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+void
+IrOptimizer::find_inv(IrNode* node,
+		      const vector<ymuint>& loop_list)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint na = node->arglist_num();
+      for (ymuint i = 0; i < na; ++ i) {
+	find_inv(node->arglist_elem(i), loop_list);
+      }
+    }
+    return;
+
+  default:
+    // 変数や定数のロードは移しても速くならない．
+    return;
+  }
+
+  // 不変となるループのうち直前に文を置けるもので最も外側のものに移す．
+  ymuint n = loop_list.size();
+  for (ymuint level = mNodeLevel[node->id()]; level < n; ++ level) {
+    ymuint loop_id = loop_list[level];
+    if ( mLoopList[loop_id].mHasPreheader ) {
+      mReplace[node->id()] = hoist(node, loop_id);
+      return;
+    }
+  }
+
+  if ( reduce(node, loop_list) ) {
+    return;
+  }
+
+  ymuint no = node->operand_num();
+  for (ymuint i = 0; i < no; ++ i) {
+    find_inv(node->operand(i), loop_list);
+  }
+}
+
+// @brief 帰納変数と不変式の積の強さの低減を行う．
+// @param[in] node 対象の積のノード
+// @param[in] loop_list 文を含むループのリスト(外側から順に並ぶ)
+// @return 強さの低減を行った時 true を返す．
+//
+// 帰納変数 i が i += c で更新される時に i * s を一時変数 t に置き換え，
+// ループの直前に t = i * s を，i の更新の直後に t += c * s を置く．
+// ループの中ではどこでも t == i * s が成り立つ．
+bool
+IrOptimizer::reduce(IrNode* node,
+		    const vector<ymuint>& loop_list)
+{
+  if ( node->node_type() != IrNode::kBinOp || node->opcode() != kOpMul ||
+       node->value_type()->type_id() != kIntType ) {
+    return false;
+  }
+
+  // 一番内側のループで帰納変数になっているものだけを扱う．
+  ymuint n = loop_list.size();
+  ymuint loop_id = loop_list[n - 1];
+  if ( !mLoopList[loop_id].mHasPreheader ) {
+    return false;
+  }
+
+  IrNode* iv_node = NULL;
+  IrNode* stride_node = NULL;
+  for (ymuint i = 0; i < 2; ++ i) {
+    IrNode* opr = node->operand(i);
+    IrNode* opr2 = node->operand(1 - i);
+    if ( opr->node_type() == IrNode::kLoad &&
+	 opr->address()->handle_type() == IrHandle::kLocalVar &&
+	 opr2->value_type()->type_id() == kIntType &&
+	 mNodeLevel[opr2->id()] < n &&
+	 is_iv(loop_id, opr->address()->local_index()) ) {
+      iv_node = opr;
+      stride_node = opr2;
+      break;
+    }
+  }
+  if ( iv_node == NULL ) {
+    return false;
+  }
+
+  // 掛ける値は定数かループ不変な変数にする．
+  IrHandle* stride;
+  if ( stride_node->node_type() == IrNode::kLoad ) {
+    stride = stride_node->address();
+  }
+  else {
+    ymuint level = mNodeLevel[stride_node->id()];
+    while ( !mLoopList[loop_list[level]].mHasPreheader ) {
+      ++ level;
+    }
+    stride = hoist(stride_node, loop_list[level]);
+    mReplace[stride_node->id()] = stride;
+  }
+
+  ymuint var = iv_node->address()->local_index();
+  for (vector<SrInfo>::iterator p = mSrList.begin();
+       p != mSrList.end(); ++ p) {
+    const SrInfo& sr = *p;
+    if ( sr.mLoop != loop_id || sr.mVar != var ) {
+      continue;
+    }
+    if ( sr.mStride == stride ||
+	 (sr.mStride->handle_type() == IrHandle::kIntConst &&
+	  stride->handle_type() == IrHandle::kIntConst &&
+	  sr.mStride->int_val() == stride->int_val()) ) {
+      mReplace[node->id()] = sr.mTemp;
+      return true;
+    }
+  }
+
+  const Type* int_type = node->value_type();
+  IrHandle* temp = new_temp("__sr", int_type);
+  Loop& loop = mLoopList[loop_id];
+  IrNode* init = mMgr.new_BinOp(kOpMul, int_type,
+				mMgr.new_Load(iv_node->address()),
+				mMgr.new_Load(stride));
+  loop.mPreList.push_back(mMgr.new_Store(temp, mMgr.fold_const(init)));
+
+  // ループの中の全ての更新の直後で一時変数も更新する．
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint nb = mSsa->block_num();
+  for (ymuint b = 0; b < nb; ++ b) {
+    if ( !loop.mBodyMark[b] ) {
+      continue;
+    }
+    for (ymuint i = mSsa->block_begin(b); i < mSsa->block_end(b); ++ i) {
+      IrNode* def = node_list[i];
+      ymuint val_id = mSsa->def_value(def);
+      if ( val_id == IrSsa::kNoValue || mSsa->value_var(val_id) != var ) {
+	continue;
+      }
+      OpCode opcode;
+      IrNode* step;
+      bool stat = get_iv_step(def, loop_id, var, opcode, step);
+      ASSERT_COND( stat );
+      IrNode* step1;
+      if ( step == NULL ) {
+	step1 = mMgr.new_Load(stride);
+      }
+      else if ( is_int_const(step) && step->address()->int_val() == 1 ) {
+	step1 = mMgr.new_Load(stride);
+      }
+      else {
+	IrNode* mul = mMgr.new_BinOp(kOpMul, int_type,
+				     mMgr.new_Load(step->address()),
+				     mMgr.new_Load(stride));
+	step1 = mMgr.fold_const(mul);
+	if ( step1 == mul ) {
+	  // 毎回掛け算をしないようにループの前で計算しておく．
+	  IrHandle* step_temp = new_temp("__sr", int_type);
+	  loop.mPreList.push_back(mMgr.new_Store(step_temp, mul));
+	  step1 = mMgr.new_Load(step_temp);
+	}
+      }
+      mPostList[i].push_back(mMgr.new_InplaceBinOp(opcode, temp, step1));
+    }
+  }
+
+  SrInfo sr;
+  sr.mLoop = loop_id;
+  sr.mVar = var;
+  sr.mStride = stride;
+  sr.mTemp = temp;
+  mSrList.push_back(sr);
+
+  mReplace[node->id()] = temp;
+  return true;
+}
+
+// @brief 帰納変数の時 true を返す．
+// @param[in] loop_id ループ番号
+// @param[in] var 変数番号
+//
+// ループの中での全ての代入がループ不変な int 値の加減算の
+// 時に帰納変数とみなす．
+bool
+IrOptimizer::is_iv(ymuint loop_id,
+		   ymuint var)
+{
+  Loop& loop = mLoopList[loop_id];
+  if ( loop.mIvState[var] != 0 ) {
+    return loop.mIvState[var] == 2;
+  }
+
+  bool ok = mCodeBlock->var_list()[var]->value_type()->type_id() == kIntType;
+  ymuint def_num = 0;
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint nb = mSsa->block_num();
+  for (ymuint b = 0; b < nb && ok; ++ b) {
+    if ( !loop.mBodyMark[b] ) {
+      continue;
+    }
+    for (ymuint i = mSsa->block_begin(b); i < mSsa->block_end(b); ++ i) {
+      IrNode* def = node_list[i];
+      ymuint val_id = mSsa->def_value(def);
+      if ( val_id == IrSsa::kNoValue || mSsa->value_var(val_id) != var ) {
+	continue;
+      }
+      OpCode opcode;
+      IrNode* step;
+      if ( !get_iv_step(def, loop_id, var, opcode, step) ) {
+	ok = false;
+	break;
+      }
+      ++ def_num;
+    }
+  }
+  if ( def_num == 0 ) {
+    // ループの中で変わらない変数は不変式として扱う．
+    ok = false;
+  }
+
+  loop.mIvState[var] = ok ? 2 : 1;
+  return ok;
+}
+
+// @brief 帰納変数の更新の増分を得る．
+// @param[in] node 代入文
+// @param[in] loop_id ループ番号
+// @param[in] var 変数番号
+// @param[out] opcode kOpAdd か kOpSub
+// @param[out] step 増分のロード(kOpInc, kOpDec の時は NULL)
+// @return 帰納変数の更新になっていない場合には false を返す．
+bool
+IrOptimizer::get_iv_step(IrNode* node,
+			 ymuint loop_id,
+			 ymuint var,
+			 OpCode& opcode,
+			 IrNode*& step)
+{
+  step = NULL;
+  switch ( node->node_type() ) {
+  case IrNode::kInplaceUniOp:
+    if ( node->opcode() == kOpInc ) {
+      opcode = kOpAdd;
+      return true;
+    }
+    if ( node->opcode() == kOpDec ) {
+      opcode = kOpSub;
+      return true;
+    }
+    break;
+
+  case IrNode::kInplaceBinOp:
+    if ( node->opcode() == kOpAdd || node->opcode() == kOpSub ) {
+      opcode = node->opcode();
+      step = node->operand(0);
+    }
+    break;
+
+  case IrNode::kStore:
+    {
+      // i = i + c, i = c + i, i = i - c の形
+      IrNode* val = node->store_val();
+      if ( val->node_type() != IrNode::kBinOp ||
+	   val->value_type()->type_id() != kIntType ) {
+	break;
+      }
+      if ( val->opcode() == kOpAdd || val->opcode() == kOpSub ) {
+	opcode = val->opcode();
+	if ( is_var_load(val->operand(0), var) ) {
+	  step = val->operand(1);
+	}
+	else if ( val->opcode() == kOpAdd && is_var_load(val->operand(1), var) ) {
+	  step = val->operand(0);
+	}
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return step != NULL && !is_var_load(step, var) && is_inv_load(step, loop_id);
+}
+
+// @brief ループ不変な int 値のロードの時 true を返す．
+// @param[in] node 対象のノード
+// @param[in] loop_id ループ番号
+bool
+IrOptimizer::is_inv_load(IrNode* node,
+			 ymuint loop_id)
+{
+  if ( node->node_type() != IrNode::kLoad ||
+       node->value_type()->type_id() != kIntType ) {
+    return false;
+  }
+  switch ( node->address()->handle_type() ) {
+  case IrHandle::kIntConst:
+    return true;
+
+  case IrHandle::kLocalVar:
+    {
+      ymuint val_id = mSsa->read_value(node);
+      return val_id != IrSsa::kNoValue &&
+	!mLoopList[loop_id].mBodyMark[mSsa->value_block(val_id)];
+    }
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// @brief 式をループの直前に移動する．
+// @param[in] node 対象の式
+// @param[in] loop_id ループ番号
+// @return 式の値を入れた一時変数を返す．
+IrHandle*
+IrOptimizer::hoist(IrNode* node,
+		   ymuint loop_id)
+{
+  IrHandle* temp = new_temp("__licm", node->value_type());
+  mLoopList[loop_id].mPreList.push_back(mMgr.new_Store(temp, node));
+  return temp;
+}
+
+END_NAMESPACE_YM_YMSL
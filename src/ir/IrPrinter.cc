@@ -152,6 +152,7 @@ IrPrinter::dfs_node(IrNode* node,
 
   case IrNode::kBranchTrue:
   case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
     dfs_node(node->branch_cond(), node_list);
     break;
 
@@ -425,6 +426,14 @@ IrPrinter::print_node(IrNode* node)
        << " %" << node->branch_cond()->id();
     break;
 
+  case IrNode::kSwitch:
+    mS << "switch %" << node->branch_cond()->id();
+    for (ymuint i = 0; i < node->case_num(); ++ i) {
+      mS << " " << node->case_val(i) << ":%" << node->case_label(i)->id();
+    }
+    mS << " default:%" << node->jump_addr()->id();
+    break;
+
   case IrNode::kLabel:
     mS << "label";
     break;
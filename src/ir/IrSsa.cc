@@ -0,0 +1,762 @@
+
+/// @file IrSsa.cc
+/// @brief IrSsa の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrSsa.h"
+#include "IrCodeBlock.h"
+#include "IrHandle.h"
+#include "IrNode.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// ブロックの末尾になる文の時 true を返す．
+bool
+is_terminal(IrNode* node)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kJump:
+  case IrNode::kBranchTrue:
+  case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
+  case IrNode::kReturn:
+  case IrNode::kHalt:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// ハンドルの中の式を子供のリストに加える．
+void
+add_handle_child(IrHandle* handle,
+		 vector<IrNode*>& child_list)
+{
+  switch ( handle->handle_type() ) {
+  case IrHandle::kArrayRef:
+    child_list.push_back(handle->array_expr());
+    child_list.push_back(handle->array_index());
+    break;
+
+  case IrHandle::kMemberRef:
+  case IrHandle::kMethodRef:
+    child_list.push_back(handle->obj_expr());
+    break;
+
+  default:
+    break;
+  }
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrSsa
+//////////////////////////////////////////////////////////////////////
+
+// 値がないことを表す番号
+const ymuint IrSsa::kNoValue;
+
+// @brief コンストラクタ
+IrSsa::IrSsa()
+{
+  mCodeBlock = NULL;
+}
+
+// @brief デストラクタ
+IrSsa::~IrSsa()
+{
+}
+
+// @brief コードブロックを SSA 形式にする．
+// @param[in] code_block 対象のコードブロック
+// @return ジャンプ先のラベルが見つからない場合には false を返す．
+bool
+IrSsa::build(const IrCodeBlock* code_block)
+{
+  mCodeBlock = code_block;
+  mNodeList.clear();
+  mBlockList.clear();
+  mValueList.clear();
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    reg_node(*p);
+  }
+  ymuint nn = mNodeList.size();
+  mReadValue.clear();
+  mReadValue.resize(nn, kNoValue);
+  mDefValue.clear();
+  mDefValue.resize(nn, kNoValue);
+  mPropValue.clear();
+  mPropValue.resize(nn, kNoValue);
+
+  if ( !make_blocks() ) {
+    return false;
+  }
+
+  calc_dom();
+
+  place_phi();
+
+  // 入り口のブロックで全ての変数の最初の値を定義する．
+  ymuint nv = code_block->var_list().size();
+  mStackArray.clear();
+  mStackArray.resize(nv);
+  for (ymuint var = 0; var < nv; ++ var) {
+    ymuint val_id = new_value(kEntry, var, 0);
+    mStackArray[var].push_back(val_id);
+  }
+  rename_block(0);
+  mStackArray.clear();
+
+  return true;
+}
+
+// @brief ノードが読む値を返す．
+// @param[in] node 対象のノード
+ymuint
+IrSsa::read_value(IrNode* node) const
+{
+  ymuint id = node->id();
+  if ( id >= mNodeList.size() || mNodeList[id] != node ) {
+    // build() の後で作られたノード
+    return kNoValue;
+  }
+  return mReadValue[id];
+}
+
+// @brief ノードが定義する値を返す．
+// @param[in] node 対象のノード
+ymuint
+IrSsa::def_value(IrNode* node) const
+{
+  ymuint id = node->id();
+  if ( id >= mNodeList.size() || mNodeList[id] != node ) {
+    return kNoValue;
+  }
+  return mDefValue[id];
+}
+
+// @brief ロードの位置で読み替えられるコピー元の値を返す．
+// @param[in] node 対象のノード
+ymuint
+IrSsa::prop_value(IrNode* node) const
+{
+  ymuint id = node->id();
+  if ( id >= mNodeList.size() || mNodeList[id] != node ) {
+    return kNoValue;
+  }
+  return mPropValue[id];
+}
+
+// @brief ブロックが別のブロックを支配している時 true を返す．
+// @param[in] block_id1 支配する側のブロック番号
+// @param[in] block_id2 支配される側のブロック番号
+//
+// 自分自身は支配しているとみなす．
+// block_id2 は到達可能でなければならない．
+bool
+IrSsa::dominates(ymuint block_id1,
+		 ymuint block_id2) const
+{
+  ASSERT_COND( block_reachable(block_id2) );
+  for (ymuint b = block_id2; ; b = mBlockList[b].mIdom) {
+    if ( b == block_id1 ) {
+      return true;
+    }
+    if ( b == 0 ) {
+      return false;
+    }
+  }
+}
+
+// @brief 子供のノードのリストを得る．
+// @param[in] node 対象のノード
+// @param[out] child_list 子供のノードを入れるリスト
+void
+IrSsa::get_child_list(IrNode* node,
+		      vector<IrNode*>& child_list)
+{
+  child_list.clear();
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    child_list.push_back(node->operand(0));
+    break;
+
+  case IrNode::kBinOp:
+    child_list.push_back(node->operand(0));
+    child_list.push_back(node->operand(1));
+    break;
+
+  case IrNode::kTriOp:
+    child_list.push_back(node->operand(0));
+    child_list.push_back(node->operand(1));
+    child_list.push_back(node->operand(2));
+    break;
+
+  case IrNode::kLoad:
+  case IrNode::kInplaceUniOp:
+    add_handle_child(node->address(), child_list);
+    break;
+
+  case IrNode::kStore:
+    add_handle_child(node->address(), child_list);
+    child_list.push_back(node->store_val());
+    break;
+
+  case IrNode::kInplaceBinOp:
+    add_handle_child(node->address(), child_list);
+    child_list.push_back(node->operand(0));
+    break;
+
+  case IrNode::kFuncCall:
+    {
+      ymuint n = node->arglist_num();
+      for (ymuint i = 0; i < n; ++ i) {
+	child_list.push_back(node->arglist_elem(i));
+      }
+    }
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      child_list.push_back(node->return_val());
+    }
+    break;
+
+  case IrNode::kBranchTrue:
+  case IrNode::kBranchFalse:
+  case IrNode::kSwitch:
+    child_list.push_back(node->branch_cond());
+    break;
+
+  default:
+    break;
+  }
+}
+
+// @brief ノードに番号をつける．
+// @param[in] node ノード
+void
+IrSsa::reg_node(IrNode* node)
+{
+  node->set_id(mNodeList.size());
+  mNodeList.push_back(node);
+
+  vector<IrNode*> child_list;
+  get_child_list(node, child_list);
+  for (vector<IrNode*>::iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    reg_node(*p);
+  }
+}
+
+// @brief 基本ブロックを作る．
+// @return ジャンプ先が見つからない場合には false を返す．
+bool
+IrSsa::make_blocks()
+{
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint n = node_list.size();
+
+  // ラベルのノード番号をキーにしてブロック番号を保持する配列
+  vector<ymuint> label_block(mNodeList.size(), kNoValue);
+
+  // 0 番目は入り口のブロック
+  vector<pair<ymuint, ymuint> > range_list;
+  range_list.push_back(make_pair(0U, 0U));
+  ymuint start = 0;
+  for (ymuint i = 0; i < n; ++ i) {
+    IrNode* node = node_list[i];
+    if ( node->node_type() == IrNode::kLabel ) {
+      if ( i > start ) {
+	range_list.push_back(make_pair(start, i));
+	start = i;
+      }
+      label_block[node->id()] = range_list.size();
+    }
+    if ( is_terminal(node) ) {
+      range_list.push_back(make_pair(start, i + 1));
+      start = i + 1;
+    }
+  }
+  if ( start < n ) {
+    range_list.push_back(make_pair(start, n));
+  }
+
+  ymuint nb = range_list.size();
+  mBlockList.resize(nb);
+  for (ymuint b = 0; b < nb; ++ b) {
+    Block& block = mBlockList[b];
+    block.mBegin = range_list[b].first;
+    block.mEnd = range_list[b].second;
+    block.mRpo = kNoValue;
+    block.mIdom = kNoValue;
+
+    IrNode* last = NULL;
+    if ( block.mEnd > block.mBegin ) {
+      last = node_list[block.mEnd - 1];
+    }
+    bool fall_through = true;
+    if ( last != NULL ) {
+      switch ( last->node_type() ) {
+      case IrNode::kJump:
+      case IrNode::kBranchTrue:
+      case IrNode::kBranchFalse:
+	{
+	  IrNode* label = last->jump_addr();
+	  ymuint id = label->id();
+	  if ( id >= mNodeList.size() || mNodeList[id] != label ||
+	       label_block[id] == kNoValue ) {
+	    // このブロックの中にないラベル
+	    return false;
+	  }
+	  block.mSuccList.push_back(label_block[id]);
+	  fall_through = (last->node_type() != IrNode::kJump);
+	}
+	break;
+
+      case IrNode::kSwitch:
+	{
+	  ymuint nc = last->case_num();
+	  for (ymuint i = 0; i <= nc; ++ i) {
+	    IrNode* label = (i < nc) ? last->case_label(i) : last->jump_addr();
+	    ymuint id = label->id();
+	    if ( id >= mNodeList.size() || mNodeList[id] != label ||
+		 label_block[id] == kNoValue ) {
+	      // このブロックの中にないラベル
+	      return false;
+	    }
+	    // 同じ飛び先は一つにまとめる．
+	    ymuint succ = label_block[id];
+	    bool found = false;
+	    for (vector<ymuint>::iterator p = block.mSuccList.begin();
+		 p != block.mSuccList.end(); ++ p) {
+	      if ( *p == succ ) {
+		found = true;
+		break;
+	      }
+	    }
+	    if ( !found ) {
+	      block.mSuccList.push_back(succ);
+	    }
+	  }
+	  fall_through = false;
+	}
+	break;
+
+      case IrNode::kReturn:
+      case IrNode::kHalt:
+	fall_through = false;
+	break;
+
+      default:
+	break;
+      }
+    }
+    if ( fall_through && b + 1 < nb ) {
+      block.mSuccList.push_back(b + 1);
+    }
+  }
+
+  // 到達可能なブロックを逆後順に並べる．
+  vector<ymuint> post_list;
+  post_list.reserve(nb);
+  dfs_block(0, post_list);
+  ymuint nr = post_list.size();
+  for (ymuint i = 0; i < nr; ++ i) {
+    mBlockList[post_list[nr - i - 1]].mRpo = i;
+  }
+
+  // 到達可能な前のブロックを記録する．
+  for (ymuint b = 0; b < nb; ++ b) {
+    Block& block = mBlockList[b];
+    if ( block.mRpo == kNoValue ) {
+      continue;
+    }
+    for (vector<ymuint>::iterator p = block.mSuccList.begin();
+	 p != block.mSuccList.end(); ++ p) {
+      mBlockList[*p].mPredList.push_back(b);
+    }
+  }
+
+  return true;
+}
+
+// @brief 到達可能なブロックを逆後順に並べる．
+// @param[in] block_id ブロック番号
+// @param[out] post_list 後順のリスト
+void
+IrSsa::dfs_block(ymuint block_id,
+		 vector<ymuint>& post_list)
+{
+  Block& block = mBlockList[block_id];
+  // 訪問済みの印
+  block.mRpo = 0;
+  for (vector<ymuint>::iterator p = block.mSuccList.begin();
+       p != block.mSuccList.end(); ++ p) {
+    if ( mBlockList[*p].mRpo == kNoValue ) {
+      dfs_block(*p, post_list);
+    }
+  }
+  post_list.push_back(block_id);
+}
+
+// @brief 支配木と支配辺境を求める．
+//
+// Cooper, Harvey, Kennedy の反復アルゴリズムを用いる．
+void
+IrSsa::calc_dom()
+{
+  ymuint nb = mBlockList.size();
+  vector<ymuint> rpo_list;
+  for (ymuint b = 0; b < nb; ++ b) {
+    if ( mBlockList[b].mRpo != kNoValue ) {
+      rpo_list.push_back(b);
+    }
+  }
+  ymuint nr = rpo_list.size();
+  for (ymuint b = 0; b < nb; ++ b) {
+    if ( mBlockList[b].mRpo != kNoValue ) {
+      rpo_list[mBlockList[b].mRpo] = b;
+    }
+  }
+
+  mBlockList[0].mIdom = 0;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (ymuint i = 1; i < nr; ++ i) {
+      ymuint b = rpo_list[i];
+      Block& block = mBlockList[b];
+      ymuint new_idom = kNoValue;
+      for (vector<ymuint>::iterator p = block.mPredList.begin();
+	   p != block.mPredList.end(); ++ p) {
+	ymuint pred = *p;
+	if ( mBlockList[pred].mIdom == kNoValue ) {
+	  // まだ処理していない．
+	  continue;
+	}
+	if ( new_idom == kNoValue ) {
+	  new_idom = pred;
+	  continue;
+	}
+	// 支配木の上で共通の祖先を求める．
+	ymuint f1 = pred;
+	ymuint f2 = new_idom;
+	while ( f1 != f2 ) {
+	  while ( mBlockList[f1].mRpo > mBlockList[f2].mRpo ) {
+	    f1 = mBlockList[f1].mIdom;
+	  }
+	  while ( mBlockList[f2].mRpo > mBlockList[f1].mRpo ) {
+	    f2 = mBlockList[f2].mIdom;
+	  }
+	}
+	new_idom = f1;
+      }
+      if ( block.mIdom != new_idom ) {
+	block.mIdom = new_idom;
+	changed = true;
+      }
+    }
+  }
+
+  for (ymuint i = 1; i < nr; ++ i) {
+    ymuint b = rpo_list[i];
+    mBlockList[mBlockList[b].mIdom].mChildList.push_back(b);
+  }
+
+  // 合流するブロックから前のブロックをたどって支配辺境を求める．
+  for (ymuint i = 1; i < nr; ++ i) {
+    ymuint b = rpo_list[i];
+    const Block& block = mBlockList[b];
+    if ( block.mPredList.size() < 2 ) {
+      continue;
+    }
+    for (vector<ymuint>::const_iterator p = block.mPredList.begin();
+	 p != block.mPredList.end(); ++ p) {
+      ymuint runner = *p;
+      while ( runner != block.mIdom ) {
+	vector<ymuint>& frontier = mBlockList[runner].mFrontier;
+	if ( frontier.empty() || frontier.back() != b ) {
+	  frontier.push_back(b);
+	}
+	runner = mBlockList[runner].mIdom;
+      }
+    }
+  }
+}
+
+// @brief phi を置く．
+void
+IrSsa::place_phi()
+{
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  ymuint nv = mCodeBlock->var_list().size();
+  ymuint nb = mBlockList.size();
+
+  // 変数ごとに定義を含むブロックのリストを作る．
+  vector<vector<ymuint> > def_block_list(nv);
+  for (ymuint b = 0; b < nb; ++ b) {
+    const Block& block = mBlockList[b];
+    if ( block.mRpo == kNoValue ) {
+      continue;
+    }
+    for (ymuint i = block.mBegin; i < block.mEnd; ++ i) {
+      IrNode* node = node_list[i];
+      switch ( node->node_type() ) {
+      case IrNode::kStore:
+      case IrNode::kInplaceUniOp:
+      case IrNode::kInplaceBinOp:
+	{
+	  ymuint var = local_var(node);
+	  if ( var == kNoValue ) {
+	    break;
+	  }
+	  vector<ymuint>& block_list = def_block_list[var];
+	  if ( block_list.empty() || block_list.back() != b ) {
+	    block_list.push_back(b);
+	  }
+	}
+	break;
+
+      default:
+	break;
+      }
+    }
+  }
+
+  // 定義を含むブロックの支配辺境に phi を置く．
+  // phi 自身も定義なのでその支配辺境にも置く．
+  vector<ymuint> phi_mark(nb, kNoValue);
+  vector<ymuint> work_mark(nb, kNoValue);
+  for (ymuint var = 0; var < nv; ++ var) {
+    vector<ymuint> work_list = def_block_list[var];
+    for (vector<ymuint>::iterator p = work_list.begin();
+	 p != work_list.end(); ++ p) {
+      work_mark[*p] = var;
+    }
+    while ( !work_list.empty() ) {
+      ymuint b = work_list.back();
+      work_list.pop_back();
+      const vector<ymuint>& frontier = mBlockList[b].mFrontier;
+      for (vector<ymuint>::const_iterator p = frontier.begin();
+	   p != frontier.end(); ++ p) {
+	ymuint f = *p;
+	if ( phi_mark[f] != var ) {
+	  phi_mark[f] = var;
+	  ymuint val_id = new_value(kPhi, var, f);
+	  mValueList[val_id].mInputList.resize(mBlockList[f].mPredList.size(), kNoValue);
+	  mBlockList[f].mPhiList.push_back(val_id);
+	}
+	if ( work_mark[f] != var ) {
+	  work_mark[f] = var;
+	  work_list.push_back(f);
+	}
+      }
+    }
+  }
+}
+
+// @brief 変数名の付け替えを行う．
+// @param[in] block_id ブロック番号
+void
+IrSsa::rename_block(ymuint block_id)
+{
+  const vector<IrNode*>& node_list = mCodeBlock->node_list();
+  const Block& block = mBlockList[block_id];
+
+  // このブロックで値を積んだ変数のリスト
+  vector<ymuint> push_list;
+
+  for (vector<ymuint>::const_iterator p = block.mPhiList.begin();
+       p != block.mPhiList.end(); ++ p) {
+    ymuint val_id = *p;
+    ymuint var = mValueList[val_id].mVar;
+    mStackArray[var].push_back(val_id);
+    push_list.push_back(var);
+  }
+
+  for (ymuint i = block.mBegin; i < block.mEnd; ++ i) {
+    IrNode* node = node_list[i];
+    rename_read(node);
+    switch ( node->node_type() ) {
+    case IrNode::kStore:
+      {
+	ymuint var = local_var(node);
+	if ( var != kNoValue ) {
+	  rename_def(node, var, block_id, push_list);
+	}
+      }
+      break;
+
+    case IrNode::kInplaceUniOp:
+    case IrNode::kInplaceBinOp:
+      {
+	ymuint var = local_var(node);
+	if ( var != kNoValue ) {
+	  mReadValue[node->id()] = mStackArray[var].back();
+	  rename_def(node, var, block_id, push_list);
+	}
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  // 後のブロックの phi の入力を埋める．
+  for (vector<ymuint>::const_iterator p = block.mSuccList.begin();
+       p != block.mSuccList.end(); ++ p) {
+    const Block& succ = mBlockList[*p];
+    const vector<ymuint>& pred_list = succ.mPredList;
+    ymuint pos = 0;
+    while ( pred_list[pos] != block_id ) {
+      ++ pos;
+    }
+    for (vector<ymuint>::const_iterator q = succ.mPhiList.begin();
+	 q != succ.mPhiList.end(); ++ q) {
+      Value& phi = mValueList[*q];
+      phi.mInputList[pos] = mStackArray[phi.mVar].back();
+    }
+  }
+
+  for (vector<ymuint>::const_iterator p = block.mChildList.begin();
+       p != block.mChildList.end(); ++ p) {
+    rename_block(*p);
+  }
+
+  for (vector<ymuint>::iterator p = push_list.begin();
+       p != push_list.end(); ++ p) {
+    mStackArray[*p].pop_back();
+  }
+}
+
+// @brief 式の中の読み出しを記録する．
+// @param[in] node ノード
+void
+IrSsa::rename_read(IrNode* node)
+{
+  if ( node->node_type() == IrNode::kLoad ) {
+    ymuint var = local_var(node);
+    if ( var != kNoValue ) {
+      ymuint val_id = mStackArray[var].back();
+      mReadValue[node->id()] = val_id;
+
+      // コピー元のうちこの位置で変数の値が変わっていないものを探す．
+      ymuint prop_id = val_id;
+      for (ymuint src_id = mValueList[val_id].mCopySrc;
+	   src_id != kNoValue; src_id = mValueList[src_id].mCopySrc) {
+	if ( mStackArray[mValueList[src_id].mVar].back() == src_id ) {
+	  prop_id = src_id;
+	}
+      }
+      mPropValue[node->id()] = prop_id;
+    }
+  }
+
+  vector<IrNode*> child_list;
+  get_child_list(node, child_list);
+  for (vector<IrNode*>::iterator p = child_list.begin();
+       p != child_list.end(); ++ p) {
+    rename_read(*p);
+  }
+}
+
+// @brief 変数の定義を記録する．
+// @param[in] node 定義しているノード
+// @param[in] var 変数番号
+// @param[in] block_id 定義しているブロック番号
+// @param[out] push_list 値を積んだ変数のリスト
+void
+IrSsa::rename_def(IrNode* node,
+		  ymuint var,
+		  ymuint block_id,
+		  vector<ymuint>& push_list)
+{
+  ymuint val_id = new_value(kDef, var, block_id, node);
+  Value& value = mValueList[val_id];
+
+  if ( node->node_type() == IrNode::kStore ) {
+    // 同じ型のままの代入ならコピーとして記録しておく．
+    const vector<IrHandle*>& var_list = mCodeBlock->var_list();
+    const Type* type = var_list[var]->value_type();
+    IrNode* src = node->store_val();
+    if ( src->node_type() == IrNode::kLoad && src->value_type() == type ) {
+      ymuint src_var = local_var(src);
+      if ( src_var != kNoValue ) {
+	value.mCopySrc = mReadValue[src->id()];
+      }
+      else {
+	switch ( src->address()->handle_type() ) {
+	case IrHandle::kBooleanConst:
+	case IrHandle::kIntConst:
+	case IrHandle::kFloatConst:
+	case IrHandle::kStringConst:
+	  value.mCopyConst = src;
+	  break;
+
+	default:
+	  break;
+	}
+      }
+    }
+  }
+
+  mDefValue[node->id()] = val_id;
+  mStackArray[var].push_back(val_id);
+  push_list.push_back(var);
+}
+
+// @brief 値を作る．
+// @param[in] kind 種類
+// @param[in] var 変数番号
+// @param[in] block_id 定義しているブロック番号
+// @param[in] def 定義しているノード
+ymuint
+IrSsa::new_value(ValueKind kind,
+		 ymuint var,
+		 ymuint block_id,
+		 IrNode* def)
+{
+  ymuint val_id = mValueList.size();
+  mValueList.push_back(Value());
+  Value& value = mValueList.back();
+  value.mKind = kind;
+  value.mVar = var;
+  value.mDef = def;
+  value.mBlock = block_id;
+  value.mCopySrc = kNoValue;
+  value.mCopyConst = NULL;
+  return val_id;
+}
+
+// @brief ローカル変数の読み書きの対象の変数番号を返す．
+// @param[in] node ノード
+//
+// ローカル変数でない場合には kNoValue を返す．
+ymuint
+IrSsa::local_var(IrNode* node) const
+{
+  IrHandle* addr = node->address();
+  if ( addr->handle_type() != IrHandle::kLocalVar ) {
+    return kNoValue;
+  }
+  ymuint var = addr->local_index();
+  ASSERT_COND( var < mCodeBlock->var_list().size() );
+  return var;
+}
+
+END_NAMESPACE_YM_YMSL
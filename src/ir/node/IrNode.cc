@@ -153,7 +153,7 @@ IrNode::arglist_elem(ymuint pos) const
 
 // @brief ジャンプ先のノードを得る．
 //
-// kJump, kBranchXXX のみ有効
+// kJump, kBranchXXX, kSwitch のみ有効
 IrNode*
 IrNode::jump_addr() const
 {
@@ -169,6 +169,38 @@ IrNode::branch_cond() const
   return NULL;
 }
 
+// @brief case の数を返す．
+//
+// kSwitch のみ有効
+ymuint
+IrNode::case_num() const
+{
+  ASSERT_NOT_REACHED;
+  return 0;
+}
+
+// @brief case の値を返す．
+// @param[in] pos 位置 ( 0 <= pos < case_num() )
+//
+// kSwitch のみ有効
+Ymsl_INT
+IrNode::case_val(ymuint pos) const
+{
+  ASSERT_NOT_REACHED;
+  return 0;
+}
+
+// @brief case の飛び先を返す．
+// @param[in] pos 位置 ( 0 <= pos < case_num() )
+//
+// kSwitch のみ有効
+IrNode*
+IrNode::case_label(ymuint pos) const
+{
+  ASSERT_NOT_REACHED;
+  return NULL;
+}
+
 // @brief 返り値
 IrNode*
 IrNode::return_val() const
@@ -219,6 +251,7 @@ operator<<(ostream& s,
   case IrNode::kJump:          s << "Jump"; break;
   case IrNode::kBranchTrue:    s << "BranchTrue"; break;
   case IrNode::kBranchFalse:   s << "BranchFalse"; break;
+  case IrNode::kSwitch:        s << "Switch"; break;
   case IrNode::kLabel:         s << "Label"; break;
   case IrNode::kHalt:          s << "Halt"; break;
   default: ASSERT_NOT_REACHED; break;
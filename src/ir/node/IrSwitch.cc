@@ -0,0 +1,96 @@
+
+/// @file IrSwitch.cc
+/// @brief IrSwitch の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrSwitch.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス IrSwitch
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] cond 条件
+// @param[in] case_list case の値と飛び先のリスト(値の昇順)
+// @param[in] default_label どれにも当てはまらない時の飛び先
+IrSwitch::IrSwitch(IrNode* cond,
+		   const vector<pair<Ymsl_INT, IrNode*> >& case_list,
+		   IrNode* default_label) :
+  IrNode(kSwitch, NULL),
+  mCond(cond),
+  mDefaultLabel(default_label)
+{
+  mCaseNum = case_list.size();
+  mValList = new Ymsl_INT[mCaseNum];
+  mLabelList = new IrNode*[mCaseNum];
+  for (ymuint i = 0; i < mCaseNum; ++ i) {
+    mValList[i] = case_list[i].first;
+    mLabelList[i] = case_list[i].second;
+  }
+}
+
+// @brief デストラクタ
+IrSwitch::~IrSwitch()
+{
+  delete [] mValList;
+  delete [] mLabelList;
+}
+
+// @brief 静的評価可能か調べる．
+//
+// 要するに定数式かどうかということ
+bool
+IrSwitch::is_static() const
+{
+  return true;
+}
+
+// @brief ジャンプ先のノードを得る．
+//
+// どの case にも当てはまらない時の飛び先
+IrNode*
+IrSwitch::jump_addr() const
+{
+  return mDefaultLabel;
+}
+
+// @brief 分岐条件
+IrNode*
+IrSwitch::branch_cond() const
+{
+  return mCond;
+}
+
+// @brief case の数を返す．
+ymuint
+IrSwitch::case_num() const
+{
+  return mCaseNum;
+}
+
+// @brief case の値を返す．
+// @param[in] pos 位置 ( 0 <= pos < case_num() )
+Ymsl_INT
+IrSwitch::case_val(ymuint pos) const
+{
+  ASSERT_COND( pos < case_num() );
+  return mValList[pos];
+}
+
+// @brief case の飛び先を返す．
+// @param[in] pos 位置 ( 0 <= pos < case_num() )
+IrNode*
+IrSwitch::case_label(ymuint pos) const
+{
+  ASSERT_COND( pos < case_num() );
+  return mLabelList[pos];
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,109 @@
+#ifndef IRSWITCH_H
+#define IRSWITCH_H
+
+/// @file IrSwitch.h
+/// @brief IrSwitch のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "IrNode.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class IrSwitch IrSwitch.h "IrSwitch.h"
+/// @brief switch 文の多方向分岐を表すクラス
+///
+/// 条件式の値と等しい case の飛び先にジャンプする．
+/// どれにも当てはまらない場合は jump_addr() にジャンプする．
+/// case の値は昇順に並べて持つ．
+//////////////////////////////////////////////////////////////////////
+class IrSwitch :
+  public IrNode
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] cond 条件
+  /// @param[in] case_list case の値と飛び先のリスト(値の昇順)
+  /// @param[in] default_label どれにも当てはまらない時の飛び先
+  IrSwitch(IrNode* cond,
+	   const vector<pair<Ymsl_INT, IrNode*> >& case_list,
+	   IrNode* default_label);
+
+  /// @brief デストラクタ
+  virtual
+  ~IrSwitch();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 静的評価可能か調べる．
+  ///
+  /// 要するに定数式かどうかということ
+  virtual
+  bool
+  is_static() const;
+
+  /// @brief ジャンプ先のノードを得る．
+  ///
+  /// どの case にも当てはまらない時の飛び先
+  virtual
+  IrNode*
+  jump_addr() const;
+
+  /// @brief 分岐条件
+  virtual
+  IrNode*
+  branch_cond() const;
+
+  /// @brief case の数を返す．
+  virtual
+  ymuint
+  case_num() const;
+
+  /// @brief case の値を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < case_num() )
+  virtual
+  Ymsl_INT
+  case_val(ymuint pos) const;
+
+  /// @brief case の飛び先を返す．
+  /// @param[in] pos 位置 ( 0 <= pos < case_num() )
+  virtual
+  IrNode*
+  case_label(ymuint pos) const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 条件
+  IrNode* mCond;
+
+  // case の数
+  ymuint mCaseNum;
+
+  // case の値の配列
+  Ymsl_INT* mValList;
+
+  // case の飛び先の配列
+  IrNode** mLabelList;
+
+  // どれにも当てはまらない時の飛び先
+  IrNode* mDefaultLabel;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // IRSWITCH_H
@@ -778,6 +778,8 @@ yyerror(YYLTYPE* llocp,
 		  "PARS",
 		  s2);
 
+  mgr.set_error();
+
   return 1;
 }
 
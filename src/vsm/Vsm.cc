@@ -9,346 +9,796 @@
 
 #include "Vsm.h"
 #include "VsmCodeList.h"
+#include "VsmRegCodeList.h"
 #include "VsmFunction.h"
+#include "VsmModule.h"
+#include "VsmVar.h"
+#include "VsmStack.h"
+#include "VsmHeap.h"
+#include "YmslObj.h"
+#include "YmUtils/MsgMgr.h"
+
+#if defined(YMSL_HAVE_PTHREAD_GETATTR_NP)
+#include <pthread.h>
+#elif defined(YMSL_HAVE_GETRLIMIT)
+#include <sys/resource.h>
+#endif
+
+
+// 命令のディスパッチ方法
+//
+// YMSL_USE_COMPUTED_GOTO が定義されている場合には GCC 拡張の
+// ラベルのアドレス(&&label)を命令コードで引く token threading を行う．
+// 命令の位置ごとに飛び先を持つ表は作らないので，VsmCodeList を
+// 複数のスレッドで共有しても実行時に書き換えるものはない．
+// そうでない場合には switch 文を用いる．
+//
+// YMSL_VSM_PROFILE が定義されている場合には連続して実行された
+// 命令の組を数える．この場合は常に switch 文を用いる．
+//
+// VSM_SET_CODE(c) は実行中のコードを c に切り替える．
+#if defined(YMSL_VSM_PROFILE)
+#undef YMSL_USE_COMPUTED_GOTO
+#endif
+
+#if defined(YMSL_USE_COMPUTED_GOTO)
+#define VSM_OP(op) L_##op:
+#define VSM_NEXT   goto *label_table[code->read_opcode(pc)]
+#define VSM_SET_CODE(c) code = (c)
+#else
+#define VSM_OP(op) case op:
+#define VSM_NEXT   break
+#define VSM_SET_CODE(c) code = (c)
+#endif
 
 
 BEGIN_NAMESPACE_YM_YMSL
 
+BEGIN_NONAMESPACE
+
+// スタックの大きさが分からない時に JIT コンパイルしたコードの
+// 呼び出しに使ってよい C++ のスタックのバイト数
+// 機械語のフレームは 1 段あたり 64 バイトほどなので 1 万段以上になる．
+const ympuint kDefaultNativeStackSize = 1024 * 1024;
+
+// JIT コンパイルしたコードに使わせずに残しておく C++ のスタックのバイト数
+// native_stack_low() になった後の命令ループやライブラリ関数の呼び出し，
+// シグナルハンドラなどが使う．
+const ympuint kNativeStackReserve = 256 * 1024;
+
+// 現在のスレッドの C++ のスタックのうち，sp より先で JIT コンパイル
+// したコードの呼び出しに使ってよいバイト数を返す．
+// YMSL_NATIVE_STACK_SIZE が定義されていればその値を用いる．
+// そうでなければスレッドのスタックの範囲から求め，分からない場合は
+// kDefaultNativeStackSize を用いる．
+ympuint
+native_stack_size(ympuint sp)
+{
+#if defined(YMSL_NATIVE_STACK_SIZE)
+  return YMSL_NATIVE_STACK_SIZE;
+#else
+  ympuint size = kDefaultNativeStackSize;
+#if defined(YMSL_HAVE_PTHREAD_GETATTR_NP)
+  // メインスレッドの場合も RLIMIT_STACK を反映した範囲が得られる．
+  pthread_attr_t attr;
+  if ( pthread_getattr_np(pthread_self(), &attr) == 0 ) {
+    void* addr;
+    size_t stack_size;
+    if ( pthread_attr_getstack(&attr, &addr, &stack_size) == 0 ) {
+      ympuint low = reinterpret_cast<ympuint>(addr);
+      ympuint rest = (sp > low) ? sp - low : 0;
+      size = (rest > kNativeStackReserve) ? rest - kNativeStackReserve : 0;
+    }
+    pthread_attr_destroy(&attr);
+  }
+#elif defined(YMSL_HAVE_GETRLIMIT)
+  // スタックの位置は分からないので，既に使っている分を考えて
+  // 上限の半分だけ使う．
+  struct rlimit rl;
+  if ( getrlimit(RLIMIT_STACK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY ) {
+    ympuint half = static_cast<ympuint>(rl.rlim_cur) / 2;
+    size = (half > kNativeStackReserve) ? half - kNativeStackReserve : 0;
+  }
+#endif
+  return size;
+#endif
+}
+
+// 命令の名前
+const char* opcode_name_table[] = {
+  "NOP",
+  "PUSH_INT_IMM",
+  "PUSH_FLOAT_IMM",
+  "PUSH_FLOAT_ZERO",
+  "PUSH_FLOAT_ONE",
+  "PUSH_OBJ_NULL",
+  "PUSH_CONST",
+  "POP",
+  "LOAD_GLOBAL_INT",
+  "LOAD_GLOBAL_FLOAT",
+  "LOAD_GLOBAL_OBJ",
+  "LOAD_LOCAL_INT",
+  "LOAD_LOCAL_FLOAT",
+  "LOAD_LOCAL_OBJ",
+  "STORE_GLOBAL_INT",
+  "STORE_GLOBAL_FLOAT",
+  "STORE_GLOBAL_OBJ",
+  "STORE_LOCAL_INT",
+  "STORE_LOCAL_FLOAT",
+  "STORE_LOCAL_OBJ",
+  "LOAD_EXT_GLOBAL_INT",
+  "LOAD_EXT_GLOBAL_FLOAT",
+  "LOAD_EXT_GLOBAL_OBJ",
+  "STORE_EXT_GLOBAL_INT",
+  "STORE_EXT_GLOBAL_FLOAT",
+  "STORE_EXT_GLOBAL_OBJ",
+  "INT_MINUS",
+  "INT_INC",
+  "INT_DEC",
+  "INT_NOT",
+  "INT_TO_BOOL",
+  "INT_TO_FLOAT",
+  "INT_ADD",
+  "INT_SUB",
+  "INT_MUL",
+  "INT_DIV",
+  "INT_MOD",
+  "INT_LSHIFT",
+  "INT_RSHIFT",
+  "INT_EQ",
+  "INT_NE",
+  "INT_LT",
+  "INT_LE",
+  "INT_AND",
+  "INT_OR",
+  "INT_XOR",
+  "INT_ITE",
+  "FLOAT_MINUS",
+  "FLOAT_TO_BOOL",
+  "FLOAT_TO_INT",
+  "FLOAT_ADD",
+  "FLOAT_SUB",
+  "FLOAT_MUL",
+  "FLOAT_DIV",
+  "FLOAT_EQ",
+  "FLOAT_NE",
+  "FLOAT_LT",
+  "FLOAT_LE",
+  "FLOAT_ITE",
+  "OBJ_MINUS",
+  "OBJ_INC",
+  "OBJ_DEC",
+  "OBJ_NOT",
+  "OBJ_TO_INT",
+  "OBJ_TO_FLOAT",
+  "OBJ_ADD",
+  "OBJ_SUB",
+  "OBJ_MUL",
+  "OBJ_DIV",
+  "OBJ_MOD",
+  "OBJ_LSHIFT",
+  "OBJ_RSHIFT",
+  "OBJ_EQ",
+  "OBJ_NE",
+  "OBJ_LT",
+  "OBJ_LE",
+  "OBJ_AND",
+  "OBJ_OR",
+  "OBJ_XOR",
+  "OBJ_ITE",
+  "JUMP",
+  "JUMP_R",
+  "BRANCH_TRUE",
+  "BRANCH_FALSE",
+  "JUMP_TABLE",
+  "CALL",
+  "CALL_R",
+  "CALL_EXT",
+  "TAIL_CALL",
+  "RETURN",
+  "RETURN_VOID",
+  "LOCAL_INT_INC",
+  "LOCAL_INT_DEC",
+  "LOCAL_INT_ADD_IMM",
+  "PUSH_INT_IMM_LOAD_LOCAL_INT",
+  "INT_EQ_BRANCH_FALSE",
+  "INT_NE_BRANCH_FALSE",
+  "INT_LT_BRANCH_FALSE",
+  "INT_LE_BRANCH_FALSE",
+  "LOCAL_INT_LT_BRANCH_FALSE",
+  "LOCAL_INT_LT_IMM_BRANCH_FALSE",
+  "HALT"
+};
+
+#if defined(YMSL_VSM_PROFILE)
+// 命令の数
+const ymuint kOpNum = VSM_HALT + 1;
+
+// 命令の組の実行回数
+// pair_count[前の命令][次の命令]
+ymuint64 pair_count[kOpNum][kOpNum];
+#endif
+
+// オペランドの形式から Builder 上の語数を求める．
+ymuint
+format_size(const char* format)
+{
+  ymuint n = 0;
+  for (const char* p = format; *p; ++ p) {
+    if ( *p == 'f' ) {
+      n += sizeof(Ymsl_FLOAT) / sizeof(Ymsl_CODE);
+    }
+    else {
+      ++ n;
+    }
+  }
+  return n;
+}
+
+END_NONAMESPACE
+
+
 //////////////////////////////////////////////////////////////////////
 // クラス Vsm
 //////////////////////////////////////////////////////////////////////
 
 // @brief コンストラクタ
-Vsm::Vsm()
+// @param[in] local_stack_size ローカルスタックのサイズ
+// @param[in] max_stack_size ローカルスタックを伸長する場合の最大サイズ
+Vsm::Vsm(Ymsl_INT local_stack_size,
+	 Ymsl_INT max_stack_size)
 {
+  mCurModule = NULL;
   mFuncTableSize = 0;
   mFuncTable = NULL;
 
   mGlobalHeapSize = 0;
   mGlobalHeap = NULL;
+  mGlobalCard = NULL;
 
-  mLocalStackSize = 0;
-  mLocalStack = NULL;
+  mConstTable = NULL;
+
+  mStack = new VsmStack(local_stack_size, max_stack_size);
+  mLocalStack = mStack->body();
+  mLocalStackSize = mStack->size();
+  mNativeStackLimit = 0;
 
   mSP = 0;
+
+  mHeap = new VsmHeap;
+
+  mJitThreshold = 1000;
 }
 
 // @brief デストラクタ
 Vsm::~Vsm()
 {
-  delete [] mFuncTable;
-  delete [] mGlobalHeap;
-  delete [] mLocalStack;
+  clear_modules();
+  delete mStack;
+  delete mHeap;
+}
+
+// @brief 安全点でごみ集めが必要なら行う．
+// @param[in] code 実行中のコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base ベースレジスタ
+inline
+void
+Vsm::safepoint(const VsmCodeList* code,
+	       Ymsl_INT pc,
+	       Ymsl_INT base)
+{
+  if ( mHeap->need_collect() ) {
+    collect(code, pc, base);
+  }
 }
 
 // @brief バイトコードを実行する．
 // @param[in] code_list コードの配列
 // @param[in] base ベースレジスタ
+//
+// 関数呼び出しは呼び出しフレームを積んでこのループの中で実行する．
+// 入った時のフレームの段数まで戻ったら終わる．
 void
 Vsm::execute(const VsmCodeList& code_list,
 	     Ymsl_INT base)
 {
-  for (Ymsl_INT pc = 0; pc < code_list.size(); ) {
-    Ymsl_CODE code = code_list.read_opcode(pc);
-
-    switch ( code ) {
-    case VSM_PUSH_INT_IMM:
-      {
-	Ymsl_INT val = code_list.read_int(pc);
+  // 実行中のコード
+  const VsmCodeList* code = NULL;
+  // 実行中の関数
+  const VsmFunction* cur_func = NULL;
+  // 呼び出す関数
+  Ymsl_INT call_index = 0;
+  // 呼び出す関数のモジュールの状態
+  ModuleState* call_module = NULL;
+  // 終了する時のフレームの段数
+  ymuint frame_top = mFrameStack.size();
+
+#if defined(YMSL_USE_COMPUTED_GOTO)
+  // 命令コードの順に並べた飛び先のテーブル
+  static void* label_table[] = {
+    &&L_VSM_NOP,
+    &&L_VSM_PUSH_INT_IMM,
+    &&L_VSM_PUSH_FLOAT_IMM,
+    &&L_VSM_PUSH_FLOAT_ZERO,
+    &&L_VSM_PUSH_FLOAT_ONE,
+    &&L_VSM_PUSH_OBJ_NULL,
+    &&L_VSM_PUSH_CONST,
+    &&L_VSM_POP,
+    &&L_VSM_LOAD_GLOBAL_INT,
+    &&L_VSM_LOAD_GLOBAL_FLOAT,
+    &&L_VSM_LOAD_GLOBAL_OBJ,
+    &&L_VSM_LOAD_LOCAL_INT,
+    &&L_VSM_LOAD_LOCAL_FLOAT,
+    &&L_VSM_LOAD_LOCAL_OBJ,
+    &&L_VSM_STORE_GLOBAL_INT,
+    &&L_VSM_STORE_GLOBAL_FLOAT,
+    &&L_VSM_STORE_GLOBAL_OBJ,
+    &&L_VSM_STORE_LOCAL_INT,
+    &&L_VSM_STORE_LOCAL_FLOAT,
+    &&L_VSM_STORE_LOCAL_OBJ,
+    &&L_VSM_LOAD_EXT_GLOBAL_INT,
+    &&L_VSM_LOAD_EXT_GLOBAL_FLOAT,
+    &&L_VSM_LOAD_EXT_GLOBAL_OBJ,
+    &&L_VSM_STORE_EXT_GLOBAL_INT,
+    &&L_VSM_STORE_EXT_GLOBAL_FLOAT,
+    &&L_VSM_STORE_EXT_GLOBAL_OBJ,
+    &&L_VSM_INT_MINUS,
+    &&L_VSM_INT_INC,
+    &&L_VSM_INT_DEC,
+    &&L_VSM_INT_NOT,
+    &&L_VSM_INT_TO_BOOL,
+    &&L_VSM_INT_TO_FLOAT,
+    &&L_VSM_INT_ADD,
+    &&L_VSM_INT_SUB,
+    &&L_VSM_INT_MUL,
+    &&L_VSM_INT_DIV,
+    &&L_VSM_INT_MOD,
+    &&L_VSM_INT_LSHIFT,
+    &&L_VSM_INT_RSHIFT,
+    &&L_VSM_INT_EQ,
+    &&L_VSM_INT_NE,
+    &&L_VSM_INT_LT,
+    &&L_VSM_INT_LE,
+    &&L_VSM_INT_AND,
+    &&L_VSM_INT_OR,
+    &&L_VSM_INT_XOR,
+    &&L_VSM_INT_ITE,
+    &&L_VSM_FLOAT_MINUS,
+    &&L_VSM_FLOAT_TO_BOOL,
+    &&L_VSM_FLOAT_TO_INT,
+    &&L_VSM_FLOAT_ADD,
+    &&L_VSM_FLOAT_SUB,
+    &&L_VSM_FLOAT_MUL,
+    &&L_VSM_FLOAT_DIV,
+    &&L_VSM_FLOAT_EQ,
+    &&L_VSM_FLOAT_NE,
+    &&L_VSM_FLOAT_LT,
+    &&L_VSM_FLOAT_LE,
+    &&L_VSM_FLOAT_ITE,
+    &&L_VSM_OBJ_MINUS,
+    &&L_VSM_OBJ_INC,
+    &&L_VSM_OBJ_DEC,
+    &&L_VSM_OBJ_NOT,
+    &&L_VSM_OBJ_TO_INT,
+    &&L_VSM_OBJ_TO_FLOAT,
+    &&L_VSM_OBJ_ADD,
+    &&L_VSM_OBJ_SUB,
+    &&L_VSM_OBJ_MUL,
+    &&L_VSM_OBJ_DIV,
+    &&L_VSM_OBJ_MOD,
+    &&L_VSM_OBJ_LSHIFT,
+    &&L_VSM_OBJ_RSHIFT,
+    &&L_VSM_OBJ_EQ,
+    &&L_VSM_OBJ_NE,
+    &&L_VSM_OBJ_LT,
+    &&L_VSM_OBJ_LE,
+    &&L_VSM_OBJ_AND,
+    &&L_VSM_OBJ_OR,
+    &&L_VSM_OBJ_XOR,
+    &&L_VSM_OBJ_ITE,
+    &&L_VSM_JUMP,
+    &&L_VSM_JUMP_R,
+    &&L_VSM_BRANCH_TRUE,
+    &&L_VSM_BRANCH_FALSE,
+    &&L_VSM_JUMP_TABLE,
+    &&L_VSM_CALL,
+    &&L_VSM_CALL_R,
+    &&L_VSM_CALL_EXT,
+    &&L_VSM_TAIL_CALL,
+    &&L_VSM_RETURN,
+    &&L_VSM_RETURN_VOID,
+    &&L_VSM_LOCAL_INT_INC,
+    &&L_VSM_LOCAL_INT_DEC,
+    &&L_VSM_LOCAL_INT_ADD_IMM,
+    &&L_VSM_PUSH_INT_IMM_LOAD_LOCAL_INT,
+    &&L_VSM_INT_EQ_BRANCH_FALSE,
+    &&L_VSM_INT_NE_BRANCH_FALSE,
+    &&L_VSM_INT_LT_BRANCH_FALSE,
+    &&L_VSM_INT_LE_BRANCH_FALSE,
+    &&L_VSM_LOCAL_INT_LT_BRANCH_FALSE,
+    &&L_VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE,
+    &&L_VSM_HALT
+  };
+
+  ASSERT_COND( sizeof(label_table) / sizeof(void*) == VSM_HALT + 1 );
+  VSM_SET_CODE(&code_list);
+
+  Ymsl_INT pc = 0;
+  VSM_NEXT;
+#elif defined(YMSL_VSM_PROFILE)
+  VSM_SET_CODE(&code_list);
+  Ymsl_CODE prev_op = VSM_NOP;
+  Ymsl_INT pc = 0;
+  for ( ; ; ) {
+    Ymsl_CODE op = code->read_opcode(pc);
+    ++ pair_count[prev_op][op];
+    prev_op = op;
+    switch ( op ) {
+#else
+  // 末尾は必ず VSM_HALT か VSM_RETURN_VOID なので範囲のチェックは行わない．
+  VSM_SET_CODE(&code_list);
+  Ymsl_INT pc = 0;
+  for ( ; ; ) {
+    switch ( code->read_opcode(pc) ) {
+#endif
+
+    VSM_OP(VSM_NOP)
+      VSM_NEXT;
+
+    VSM_OP(VSM_PUSH_INT_IMM)
+      {
+	Ymsl_INT val = code->read_int(pc);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_PUSH_FLOAT_IMM:
+    VSM_OP(VSM_PUSH_FLOAT_IMM)
       {
-	Ymsl_FLOAT val = code_list.read_float(pc);
+	Ymsl_FLOAT val = code->read_float(pc);
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_PUSH_FLOAT_ZERO:
+    VSM_OP(VSM_PUSH_FLOAT_ZERO)
       push_FLOAT(0.0);
-      break;
+      VSM_NEXT;
 
-    case VSM_PUSH_FLOAT_ONE:
+    VSM_OP(VSM_PUSH_FLOAT_ONE)
       push_FLOAT(1.0);
-      break;
+      VSM_NEXT;
 
-    case VSM_PUSH_OBJ_NULL:
+    VSM_OP(VSM_PUSH_OBJ_NULL)
       push_OBJPTR(NULL);
-      break;
+      VSM_NEXT;
+
+    VSM_OP(VSM_PUSH_CONST)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	mLocalStack[mSP] = mConstTable[index];
+	++ mSP;
+      }
+      VSM_NEXT;
 
-    case VSM_LOAD_GLOBAL_INT:
+    VSM_OP(VSM_POP)
+      -- mSP;
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOAD_GLOBAL_INT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_INT val = load_global_INT(index);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_LOAD_GLOBAL_FLOAT:
+    VSM_OP(VSM_LOAD_GLOBAL_FLOAT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_FLOAT val = load_global_FLOAT(index);
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_LOAD_GLOBAL_OBJ:
+    VSM_OP(VSM_LOAD_GLOBAL_OBJ)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_OBJPTR val = load_global_OBJPTR(index);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_LOAD_LOCAL_INT:
+    VSM_OP(VSM_LOAD_LOCAL_INT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_INT val = load_local_INT(base + index);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_LOAD_LOCAL_FLOAT:
+    VSM_OP(VSM_LOAD_LOCAL_FLOAT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_FLOAT val = load_local_FLOAT(base + index);
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_LOAD_LOCAL_OBJ:
+    VSM_OP(VSM_LOAD_LOCAL_OBJ)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_OBJPTR val = load_local_OBJPTR(base + index);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_GLOBAL_INT:
+    VSM_OP(VSM_STORE_GLOBAL_INT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_INT val = pop_INT();
 	store_global_INT(index, val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_GLOBAL_FLOAT:
+    VSM_OP(VSM_STORE_GLOBAL_FLOAT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_FLOAT val = pop_FLOAT();
 	store_global_FLOAT(index, val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_GLOBAL_OBJ:
+    VSM_OP(VSM_STORE_GLOBAL_OBJ)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_OBJPTR val = pop_OBJPTR();
 	store_global_OBJPTR(index, val);
+	if ( mHeap->is_marking() ) {
+	  mHeap->mark(val);
+	}
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_LOCAL_INT:
+    VSM_OP(VSM_STORE_LOCAL_INT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_INT val = pop_INT();
 	store_local_INT(base + index, val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_LOCAL_FLOAT:
+    VSM_OP(VSM_STORE_LOCAL_FLOAT)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_FLOAT val = pop_FLOAT();
 	store_local_FLOAT(base + index, val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_STORE_LOCAL_OBJ:
+    VSM_OP(VSM_STORE_LOCAL_OBJ)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
 	Ymsl_OBJPTR val = pop_OBJPTR();
 	store_local_OBJPTR(base + index, val);
+	if ( mHeap->is_marking() ) {
+	  mHeap->mark(val);
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOAD_EXT_GLOBAL_INT)
+    VSM_OP(VSM_LOAD_EXT_GLOBAL_FLOAT)
+    VSM_OP(VSM_LOAD_EXT_GLOBAL_OBJ)
+      {
+	// 格納クラスによらず値をそのまま写す．
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	const ModuleState* module = mCurModule->mLinkTable[module_index];
+	mLocalStack[mSP] = module->mGlobalHeap[index];
+	++ mSP;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_STORE_EXT_GLOBAL_INT)
+    VSM_OP(VSM_STORE_EXT_GLOBAL_FLOAT)
+      {
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	ModuleState* module = mCurModule->mLinkTable[module_index];
+	-- mSP;
+	module->mGlobalHeap[index] = mLocalStack[mSP];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_STORE_EXT_GLOBAL_OBJ)
+      {
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	ModuleState* module = mCurModule->mLinkTable[module_index];
+	Ymsl_OBJPTR val = pop_OBJPTR();
+	module->mGlobalHeap[index].obj_value = val;
+	module->mGlobalCard[index >> kGlobalCardShift] = 1;
+	if ( mHeap->is_marking() ) {
+	  mHeap->mark(val);
+	}
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_MINUS:
+    VSM_OP(VSM_INT_MINUS)
       {
 	Ymsl_INT val = pop_INT();
 	val = - val;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_INC:
+    VSM_OP(VSM_INT_INC)
       {
 	Ymsl_INT val = pop_INT();
 	++ val;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_DEC:
+    VSM_OP(VSM_INT_DEC)
       {
 	Ymsl_INT val = pop_INT();
 	-- val;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_NOT:
+    VSM_OP(VSM_INT_NOT)
       {
 	Ymsl_INT val = pop_INT();
 	val = ~val;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_TO_BOOL:
+    VSM_OP(VSM_INT_TO_BOOL)
       {
 	Ymsl_INT val = pop_INT();
 	Ymsl_INT val1 = (val != 0);
-	push_FLOAT(val1);
+	push_INT(val1);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_TO_FLOAT:
+    VSM_OP(VSM_INT_TO_FLOAT)
       {
 	Ymsl_INT val = pop_INT();
 	Ymsl_FLOAT fval = val;
 	push_FLOAT(fval);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_ADD:
+    VSM_OP(VSM_INT_ADD)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 + val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_SUB:
+    VSM_OP(VSM_INT_SUB)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 - val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_MUL:
+    VSM_OP(VSM_INT_MUL)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 * val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_DIV:
+    VSM_OP(VSM_INT_DIV)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 / val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_MOD:
+    VSM_OP(VSM_INT_MOD)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 % val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_LSHIFT:
+    VSM_OP(VSM_INT_LSHIFT)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 << val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_RSHIFT:
+    VSM_OP(VSM_INT_RSHIFT)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 >> val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_EQ:
+    VSM_OP(VSM_INT_EQ)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = (val1 == val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_NE:
+    VSM_OP(VSM_INT_NE)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = (val1 != val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_LT:
+    VSM_OP(VSM_INT_LT)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = (val1 < val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_LE:
+    VSM_OP(VSM_INT_LE)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = (val1 <= val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_AND:
+    VSM_OP(VSM_INT_AND)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 & val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_OR:
+    VSM_OP(VSM_INT_OR)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 | val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_XOR:
+    VSM_OP(VSM_INT_XOR)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
 	Ymsl_INT val = val1 ^ val2;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_INT_ITE:
+    VSM_OP(VSM_INT_ITE)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_INT val2 = pop_INT();
@@ -356,105 +806,105 @@ Vsm::execute(const VsmCodeList& code_list,
 	Ymsl_INT val = val1 ? val2 : val3;
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_MINUS:
+    VSM_OP(VSM_FLOAT_MINUS)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val = -val1;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_TO_BOOL:
+    VSM_OP(VSM_FLOAT_TO_BOOL)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_INT val = (val1 != 0.0);
-	push_FLOAT(val);
+	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_TO_INT:
+    VSM_OP(VSM_FLOAT_TO_INT)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_INT val = val1;
-	push_FLOAT(val);
+	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_ADD:
+    VSM_OP(VSM_FLOAT_ADD)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_FLOAT val = val1 + val2;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_SUB:
+    VSM_OP(VSM_FLOAT_SUB)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_FLOAT val = val1 - val2;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_MUL:
+    VSM_OP(VSM_FLOAT_MUL)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_FLOAT val = val1 * val2;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_DIV:
+    VSM_OP(VSM_FLOAT_DIV)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_FLOAT val = val1 / val2;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_EQ:
+    VSM_OP(VSM_FLOAT_EQ)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_INT val = (val1 == val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_NE:
+    VSM_OP(VSM_FLOAT_NE)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_INT val = (val1 != val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_LT:
+    VSM_OP(VSM_FLOAT_LT)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_INT val = (val1 < val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_LE:
+    VSM_OP(VSM_FLOAT_LE)
       {
 	Ymsl_FLOAT val1 = pop_FLOAT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
 	Ymsl_INT val = (val1 <= val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_FLOAT_ITE:
+    VSM_OP(VSM_FLOAT_ITE)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_FLOAT val2 = pop_FLOAT();
@@ -462,278 +912,1889 @@ Vsm::execute(const VsmCodeList& code_list,
 	Ymsl_FLOAT val = val1 ? val2 : val3;
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_MINUS:
+    VSM_OP(VSM_OBJ_MINUS)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_INC:
+    VSM_OP(VSM_OBJ_INC)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_DEC:
+    VSM_OP(VSM_OBJ_DEC)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_NOT:
+    VSM_OP(VSM_OBJ_NOT)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_TO_INT:
+    VSM_OP(VSM_OBJ_TO_INT)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_INT val;
+	Ymsl_INT val = obj_to_int(val1);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_TO_FLOAT:
+    VSM_OP(VSM_OBJ_TO_FLOAT)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	//
-	Ymsl_FLOAT val;
+	Ymsl_FLOAT val = obj_to_float(val1);
 	push_FLOAT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_ADD:
+    VSM_OP(VSM_OBJ_ADD)
+      safepoint(code, pc, base);
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = obj_add(val1, val2);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_SUB:
+    VSM_OP(VSM_OBJ_SUB)
+      safepoint(code, pc, base);
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = obj_sub(val1, val2);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_MUL:
+    VSM_OP(VSM_OBJ_MUL)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_DIV:
+    VSM_OP(VSM_OBJ_DIV)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_MOD:
+    VSM_OP(VSM_OBJ_MOD)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	pop_OBJPTR();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_LSHIFT:
+    VSM_OP(VSM_OBJ_LSHIFT)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	Ymsl_INT val2 = pop_INT();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	pop_INT();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_RSHIFT:
+    VSM_OP(VSM_OBJ_RSHIFT)
       {
-	Ymsl_OBJPTR val1 = pop_OBJPTR();
-	Ymsl_INT val2 = pop_INT();
-	//
-	Ymsl_OBJPTR val;
-	push_OBJPTR(val);
+	// オブジェクトに対しては意味を持たない．
+	pop_OBJPTR();
+	pop_INT();
+	push_OBJPTR(NULL);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_EQ:
+    VSM_OP(VSM_OBJ_EQ)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_INT val;
+	Ymsl_INT val = YmslObj::equal(val1, val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_NE:
+    VSM_OP(VSM_OBJ_NE)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_INT val;
+	Ymsl_INT val = !YmslObj::equal(val1, val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_LT:
+    VSM_OP(VSM_OBJ_LT)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_INT val;
+	Ymsl_INT val = obj_lt(val1, val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_LE:
+    VSM_OP(VSM_OBJ_LE)
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_INT val;
+	Ymsl_INT val = obj_le(val1, val2);
 	push_INT(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_AND:
+    VSM_OP(VSM_OBJ_AND)
+      safepoint(code, pc, base);
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = obj_and(val1, val2);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_OR:
+    VSM_OP(VSM_OBJ_OR)
+      safepoint(code, pc, base);
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = obj_or(val1, val2);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_XOR:
+    VSM_OP(VSM_OBJ_XOR)
+      safepoint(code, pc, base);
       {
 	Ymsl_OBJPTR val1 = pop_OBJPTR();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = obj_xor(val1, val2);
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_OBJ_ITE:
+    VSM_OP(VSM_OBJ_ITE)
       {
 	Ymsl_INT val1 = pop_INT();
 	Ymsl_OBJPTR val2 = pop_OBJPTR();
 	Ymsl_OBJPTR val3 = pop_OBJPTR();
-	//
-	Ymsl_OBJPTR val;
+	Ymsl_OBJPTR val = val1 ? val2 : val3;
 	push_OBJPTR(val);
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_JUMP:
+    VSM_OP(VSM_JUMP)
       {
-	Ymsl_INT addr = code_list.read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	if ( addr < pc ) {
+	  // ループの後ろ向きの分岐も安全点にする．
+	  safepoint(code, pc, base);
+	}
 	pc = addr;
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_JUMP_R:
+    VSM_OP(VSM_JUMP_R)
       {
 	Ymsl_INT addr = pop_INT();
 	pc = addr;
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_BRANCH_TRUE:
+    VSM_OP(VSM_BRANCH_TRUE)
       {
-	Ymsl_INT addr = code_list.read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
 	Ymsl_INT cond = pop_INT();
-	if ( code ) {
+	if ( cond ) {
 	  pc = addr;
 	}
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_BRANCH_FALSE:
+    VSM_OP(VSM_BRANCH_FALSE)
       {
-	Ymsl_INT addr = code_list.read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
 	Ymsl_INT cond = pop_INT();
-	if ( !code ) {
+	if ( !cond ) {
 	  pc = addr;
 	}
       }
-      break;
+      VSM_NEXT;
+
+    VSM_OP(VSM_JUMP_TABLE)
+      {
+	Ymsl_INT min = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val = pop_INT();
+	// 符号なしで比べれば下限と上限を一度に調べられる．
+	ymuint32 offset = static_cast<ymuint32>(val) - static_cast<ymuint32>(min);
+	if ( offset < static_cast<ymuint32>(code->jump_table_size(index)) ) {
+	  addr = code->jump_table(index)[offset];
+	}
+	pc = addr;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_CALL)
+      call_index = code->read_int(pc);
+      call_module = mCurModule;
+      goto do_call;
+
+    VSM_OP(VSM_CALL_R)
+      call_index = pop_INT();
+      call_module = mCurModule;
+      goto do_call;
+
+    VSM_OP(VSM_CALL_EXT)
+      {
+	Ymsl_INT module_index = code->read_int(pc);
+	call_index = code->read_int(pc);
+	call_module = mCurModule->mLinkTable[module_index];
+      }
+      goto do_call;
+
+    do_call:
+      {
+	// 呼び出し元の状態を積む．
+	Frame frame;
+	frame.mCodeList = code;
+	frame.mPC = pc;
+	frame.mBase = base;
+	frame.mFunc = cur_func;
+	frame.mModule = mCurModule;
+	mFrameStack.push_back(frame);
+
+	if ( call_module != mCurModule ) {
+	  set_module(call_module);
+	}
+	ASSERT_COND( call_index >= 0 && call_index < mFuncTableSize );
+	const VsmFunction* func = mFuncTable[call_index];
+	const VsmCodeList* func_code = func->frame_code(*this);
+
+	if ( func_code == NULL ) {
+	  // 組み込み関数や JIT コンパイルした関数
+	  // その中の入れ子の execute() でごみ集めが起きても
+	  // このフレームを辿れるように積んだまま呼び出す．
+	  call_func(call_index);
+	  mFrameStack.pop_back();
+	  if ( frame.mModule != mCurModule ) {
+	    set_module(frame.mModule);
+	  }
+	  VSM_NEXT;
+	}
+
+	// 呼ばれた関数のコードに切り替える．
+	base = mSP - func->arg_num();
+	reserve_frame(base, func->frame_size());
+	cur_func = func;
+	VSM_SET_CODE(func_code);
+	pc = 0;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_TAIL_CALL)
+      {
+	call_index = code->read_int(pc);
+	ASSERT_COND( call_index >= 0 && call_index < mFuncTableSize );
+	const VsmFunction* func = mFuncTable[call_index];
+	const VsmCodeList* func_code = func->frame_code(*this);
+	if ( func_code == NULL ) {
+	  // 普通に呼び出してから戻る．
+	  // VSM_CALL と同様に呼び出し中はこのフレームを積んでおく．
+	  Frame frame;
+	  frame.mCodeList = code;
+	  frame.mPC = pc;
+	  frame.mBase = base;
+	  frame.mFunc = cur_func;
+	  frame.mModule = mCurModule;
+	  mFrameStack.push_back(frame);
+	  call_func(call_index);
+	  mFrameStack.pop_back();
+	  if ( func->has_return_value() ) {
+	    mLocalStack[base] = mLocalStack[mSP - 1];
+	    mSP = base + 1;
+	  }
+	  else {
+	    mSP = base;
+	  }
+	  goto do_return;
+	}
+
+	// 引数を現在のフレームの先頭に移して呼ばれた関数のコードに切り替える．
+	Ymsl_INT n = func->arg_num();
+	Ymsl_INT src = mSP - n;
+	for (Ymsl_INT i = 0; i < n; ++ i) {
+	  mLocalStack[base + i] = mLocalStack[src + i];
+	}
+	mSP = base + n;
+	reserve_frame(base, func->frame_size());
+	cur_func = func;
+	VSM_SET_CODE(func_code);
+	pc = 0;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_RETURN)
+      // 返り値はフレームの先頭に置く．
+      mLocalStack[base] = mLocalStack[mSP - 1];
+      mSP = base + 1;
+      goto do_return;
+
+    VSM_OP(VSM_RETURN_VOID)
+      mSP = base;
+      goto do_return;
+
+    do_return:
+      if ( mFrameStack.size() == frame_top ) {
+	return;
+      }
+      {
+	// 呼び出し元の状態に戻す．
+	const Frame& frame = mFrameStack.back();
+	VSM_SET_CODE(frame.mCodeList);
+	pc = frame.mPC;
+	base = frame.mBase;
+	cur_func = frame.mFunc;
+	if ( frame.mModule != mCurModule ) {
+	  set_module(frame.mModule);
+	}
+	mFrameStack.pop_back();
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOCAL_INT_INC)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT val = load_local_INT(base + index);
+	store_local_INT(base + index, val + 1);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOCAL_INT_DEC)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT val = load_local_INT(base + index);
+	store_local_INT(base + index, val - 1);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOCAL_INT_ADD_IMM)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT imm = code->read_int(pc);
+	Ymsl_INT val = load_local_INT(base + index);
+	store_local_INT(base + index, val + imm);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_PUSH_INT_IMM_LOAD_LOCAL_INT)
+      {
+	Ymsl_INT imm = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	push_INT(imm);
+	push_INT(load_local_INT(base + index));
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_INT_EQ_BRANCH_FALSE)
+      {
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val1 = pop_INT();
+	Ymsl_INT val2 = pop_INT();
+	if ( !(val1 == val2) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_INT_NE_BRANCH_FALSE)
+      {
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val1 = pop_INT();
+	Ymsl_INT val2 = pop_INT();
+	if ( !(val1 != val2) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_INT_LT_BRANCH_FALSE)
+      {
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val1 = pop_INT();
+	Ymsl_INT val2 = pop_INT();
+	if ( !(val1 < val2) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_INT_LE_BRANCH_FALSE)
+      {
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val1 = pop_INT();
+	Ymsl_INT val2 = pop_INT();
+	if ( !(val1 <= val2) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOCAL_INT_LT_BRANCH_FALSE)
+      {
+	Ymsl_INT index1 = code->read_int(pc);
+	Ymsl_INT index2 = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val1 = load_local_INT(base + index1);
+	Ymsl_INT val2 = load_local_INT(base + index2);
+	if ( !(val1 < val2) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT imm = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	Ymsl_INT val = load_local_INT(base + index);
+	if ( !(val < imm) ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_HALT)
+      return;
+
+#if !defined(YMSL_USE_COMPUTED_GOTO)
+    default:
+      ASSERT_NOT_REACHED;
+      return;
+    }
+  }
+#endif
+}
+
+// @brief レジスタ型のバイトコードを実行する．
+// @param[in] code_list コードの配列
+// @param[in] base ベースレジスタ
+void
+Vsm::execute_reg(const VsmRegCodeList& code_list,
+		 Ymsl_INT base)
+{
+  // レジスタ型の関数どうしの呼び出しは入れ子にしないが，
+  // 組み込み関数やスタック型の関数を経由すると入れ子になる．
+  if ( native_stack_low() ) {
+    mStack->overflow();
+  }
+
+  // 実行中のコード
+  const VsmCodeList* code = &code_list;
+  // 実行中のフレーム
+  VsmValue* frame = mLocalStack + base;
+  // 呼び出す関数
+  const VsmFunction* callee = NULL;
+  // 呼び出す関数の引数の位置
+  Ymsl_INT call_arg_base = 0;
+  // 呼び出す関数のモジュールの状態
+  ModuleState* call_module = NULL;
+  // 終了する時のフレームの段数
+  ymuint frame_top = mFrameStack.size();
+
+#if defined(YMSL_USE_COMPUTED_GOTO)
+  // 命令コードの順に並べた飛び先のテーブル
+  static void* label_table[] = {
+    &&L_VSM_REG_NOP,
+    &&L_VSM_REG_ENTER,
+    &&L_VSM_REG_MOVE,
+    &&L_VSM_REG_INT_IMM,
+    &&L_VSM_REG_FLOAT_IMM,
+    &&L_VSM_REG_OBJ_NULL,
+    &&L_VSM_REG_CONST,
+    &&L_VSM_REG_LOAD_GLOBAL,
+    &&L_VSM_REG_STORE_GLOBAL,
+    &&L_VSM_REG_LOAD_EXT_GLOBAL,
+    &&L_VSM_REG_STORE_EXT_GLOBAL,
+    &&L_VSM_REG_INT_MINUS,
+    &&L_VSM_REG_INT_INC,
+    &&L_VSM_REG_INT_DEC,
+    &&L_VSM_REG_INT_NOT,
+    &&L_VSM_REG_INT_LNOT,
+    &&L_VSM_REG_INT_TO_BOOL,
+    &&L_VSM_REG_INT_TO_FLOAT,
+    &&L_VSM_REG_INT_ADD,
+    &&L_VSM_REG_INT_SUB,
+    &&L_VSM_REG_INT_MUL,
+    &&L_VSM_REG_INT_DIV,
+    &&L_VSM_REG_INT_MOD,
+    &&L_VSM_REG_INT_LSHIFT,
+    &&L_VSM_REG_INT_RSHIFT,
+    &&L_VSM_REG_INT_EQ,
+    &&L_VSM_REG_INT_NE,
+    &&L_VSM_REG_INT_LT,
+    &&L_VSM_REG_INT_LE,
+    &&L_VSM_REG_INT_AND,
+    &&L_VSM_REG_INT_OR,
+    &&L_VSM_REG_INT_XOR,
+    &&L_VSM_REG_FLOAT_MINUS,
+    &&L_VSM_REG_FLOAT_TO_BOOL,
+    &&L_VSM_REG_FLOAT_TO_INT,
+    &&L_VSM_REG_FLOAT_ADD,
+    &&L_VSM_REG_FLOAT_SUB,
+    &&L_VSM_REG_FLOAT_MUL,
+    &&L_VSM_REG_FLOAT_DIV,
+    &&L_VSM_REG_FLOAT_EQ,
+    &&L_VSM_REG_FLOAT_NE,
+    &&L_VSM_REG_FLOAT_LT,
+    &&L_VSM_REG_FLOAT_LE,
+    &&L_VSM_REG_OBJ_MINUS,
+    &&L_VSM_REG_OBJ_INC,
+    &&L_VSM_REG_OBJ_DEC,
+    &&L_VSM_REG_OBJ_NOT,
+    &&L_VSM_REG_OBJ_TO_INT,
+    &&L_VSM_REG_OBJ_TO_FLOAT,
+    &&L_VSM_REG_OBJ_ADD,
+    &&L_VSM_REG_OBJ_SUB,
+    &&L_VSM_REG_OBJ_MUL,
+    &&L_VSM_REG_OBJ_DIV,
+    &&L_VSM_REG_OBJ_MOD,
+    &&L_VSM_REG_OBJ_LSHIFT,
+    &&L_VSM_REG_OBJ_RSHIFT,
+    &&L_VSM_REG_OBJ_EQ,
+    &&L_VSM_REG_OBJ_NE,
+    &&L_VSM_REG_OBJ_LT,
+    &&L_VSM_REG_OBJ_LE,
+    &&L_VSM_REG_OBJ_AND,
+    &&L_VSM_REG_OBJ_OR,
+    &&L_VSM_REG_OBJ_XOR,
+    &&L_VSM_REG_ITE,
+    &&L_VSM_REG_JUMP,
+    &&L_VSM_REG_BRANCH_TRUE,
+    &&L_VSM_REG_BRANCH_FALSE,
+    &&L_VSM_REG_JUMP_TABLE,
+    &&L_VSM_REG_CALL,
+    &&L_VSM_REG_CALL_EXT,
+    &&L_VSM_REG_TAIL_CALL,
+    &&L_VSM_REG_RETURN,
+    &&L_VSM_REG_RETURN_VOID,
+    &&L_VSM_REG_HALT
+  };
+
+  ASSERT_COND( sizeof(label_table) / sizeof(void*) == VSM_REG_HALT + 1 );
+
+  Ymsl_INT pc = 0;
+  VSM_NEXT;
+#else
+  Ymsl_INT pc = 0;
+  for ( ; ; ) {
+    switch ( code->read_opcode(pc) ) {
+#endif
+
+    VSM_OP(VSM_REG_NOP)
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_ENTER)
+      {
+	Ymsl_INT frame_size = code->read_int(pc);
+	Ymsl_INT arg_num = code->read_int(pc);
+	reserve_frame(base, frame_size);
+	for (Ymsl_INT i = arg_num; i < frame_size; ++ i) {
+	  // obj_value が最も大きいのでこれで INT/FLOAT も 0 になる．
+	  frame[i].obj_value = NULL;
+	}
+	mSP = base + frame_size;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_MOVE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst] = frame[src];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_IMM)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	frame[dst].int_value = code->read_int(pc);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_IMM)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	frame[dst].float_value = code->read_float(pc);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_NULL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_CONST)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	frame[dst] = mConstTable[index];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_LOAD_GLOBAL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	frame[dst] = mGlobalHeap[index];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_STORE_GLOBAL)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	mGlobalHeap[index] = frame[src];
+	mGlobalCard[index >> kGlobalCardShift] = 1;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_LOAD_EXT_GLOBAL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	const ModuleState* module = mCurModule->mLinkTable[module_index];
+	frame[dst] = module->mGlobalHeap[index];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_STORE_EXT_GLOBAL)
+      {
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	ModuleState* module = mCurModule->mLinkTable[module_index];
+	module->mGlobalHeap[index] = frame[src];
+	module->mGlobalCard[index >> kGlobalCardShift] = 1;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_MINUS)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = - frame[src].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_INC)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = frame[src].int_value + 1;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_DEC)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = frame[src].int_value - 1;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_NOT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = ~frame[src].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_LNOT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = (frame[src].int_value == 0);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_TO_BOOL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = (frame[src].int_value != 0);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_TO_FLOAT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].float_value = frame[src].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_MINUS)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].float_value = - frame[src].float_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_TO_BOOL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = (frame[src].float_value != 0.0);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_TO_INT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = static_cast<Ymsl_INT>(frame[src].float_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_ADD)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value + frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_SUB)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value - frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_MUL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value * frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_DIV)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value / frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_MOD)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value % frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_LSHIFT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value << frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_RSHIFT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value >> frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_EQ)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].int_value == frame[src2].int_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_NE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].int_value != frame[src2].int_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_LT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].int_value < frame[src2].int_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_LE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].int_value <= frame[src2].int_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_AND)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value & frame[src2].int_value;
+      }
+      VSM_NEXT;
 
-    case VSM_CALL:
+    VSM_OP(VSM_REG_INT_OR)
       {
-	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value | frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_INT_XOR)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = frame[src1].int_value ^ frame[src2].int_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_ADD)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].float_value = frame[src1].float_value + frame[src2].float_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_SUB)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].float_value = frame[src1].float_value - frame[src2].float_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_MUL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].float_value = frame[src1].float_value * frame[src2].float_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_DIV)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].float_value = frame[src1].float_value / frame[src2].float_value;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_EQ)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].float_value == frame[src2].float_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_NE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].float_value != frame[src2].float_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_LT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].float_value < frame[src2].float_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_FLOAT_LE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = (frame[src1].float_value <= frame[src2].float_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_MINUS)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_INC)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_DEC)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_NOT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_TO_INT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].int_value = obj_to_int(frame[src].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_TO_FLOAT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src = code->read_int(pc);
+	frame[dst].float_value = obj_to_float(frame[src].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_ADD)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	safepoint(code, pc, base);
+	frame[dst].obj_value = obj_add(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_SUB)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	safepoint(code, pc, base);
+	frame[dst].obj_value = obj_sub(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_MUL)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_DIV)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_MOD)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_LSHIFT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_RSHIFT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	code->read_int(pc);
+	code->read_int(pc);
+	// オブジェクトに対しては意味を持たない．
+	frame[dst].obj_value = NULL;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_EQ)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = YmslObj::equal(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_NE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = !YmslObj::equal(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_LT)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = obj_lt(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_LE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst].int_value = obj_le(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_AND)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	safepoint(code, pc, base);
+	frame[dst].obj_value = obj_and(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_OR)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	safepoint(code, pc, base);
+	frame[dst].obj_value = obj_or(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_OBJ_XOR)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	safepoint(code, pc, base);
+	frame[dst].obj_value = obj_xor(frame[src1].obj_value, frame[src2].obj_value);
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_ITE)
+      {
+	Ymsl_INT dst = code->read_int(pc);
+	Ymsl_INT cond = code->read_int(pc);
+	Ymsl_INT src1 = code->read_int(pc);
+	Ymsl_INT src2 = code->read_int(pc);
+	frame[dst] = frame[cond].int_value ? frame[src1] : frame[src2];
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_JUMP)
+      {
+	Ymsl_INT addr = code->read_int(pc);
+	if ( addr < pc ) {
+	  // ループの後ろ向きの分岐も安全点にする．
+	  safepoint(code, pc, base);
+	}
+	pc = addr;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_BRANCH_TRUE)
+      {
+	Ymsl_INT cond = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	if ( frame[cond].int_value ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_BRANCH_FALSE)
+      {
+	Ymsl_INT cond = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	if ( !frame[cond].int_value ) {
+	  pc = addr;
+	}
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_JUMP_TABLE)
+      {
+	Ymsl_INT src = code->read_int(pc);
+	Ymsl_INT min = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT addr = code->read_int(pc);
+	ymuint32 offset = static_cast<ymuint32>(frame[src].int_value) - static_cast<ymuint32>(min);
+	if ( offset < static_cast<ymuint32>(code->jump_table_size(index)) ) {
+	  addr = code->jump_table(index)[offset];
+	}
+	pc = addr;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_CALL)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	call_arg_base = code->read_int(pc);
 	ASSERT_COND( index >= 0 && index < mFuncTableSize );
-	const VsmFunction* func = mFuncTable[index];
-	Ymsl_INT base = mSP;
-	func->execute(*this, base);
+	callee = mFuncTable[index];
+	call_module = mCurModule;
+      }
+      goto do_call;
+
+    VSM_OP(VSM_REG_CALL_EXT)
+      {
+	Ymsl_INT module_index = code->read_int(pc);
+	Ymsl_INT index = code->read_int(pc);
+	call_arg_base = code->read_int(pc);
+	call_module = mCurModule->mLinkTable[module_index];
+	ASSERT_COND( index >= 0 && index < call_module->mFuncTableSize );
+	callee = call_module->mFuncTable[index];
       }
-      break;
+      goto do_call;
 
-    case VSM_CALL_R:
+    do_call:
       {
-	Ymsl_INT index = pop_INT();
+	// 呼び出し元の状態を積む．
+	// 呼ばれた側はフレームを自由に使うので SP も保存しておく．
+	Frame caller;
+	caller.mCodeList = code;
+	caller.mPC = pc;
+	caller.mBase = base;
+	caller.mFunc = NULL;
+	caller.mModule = mCurModule;
+	caller.mSP = mSP;
+	mFrameStack.push_back(caller);
+
+	if ( call_module != mCurModule ) {
+	  set_module(call_module);
+	}
+	const VsmRegCodeList* func_code = callee->reg_code();
+	if ( func_code == NULL ) {
+	  // 組み込み関数やスタック型の関数
+	  callee->execute(*this, base + call_arg_base);
+	  goto do_return;
+	}
+
+	// 呼ばれた関数のコードに切り替える．
+	// C++ の再帰呼び出しにはしないので深い再帰でもスタックの
+	// 伸長の限界で止まる．
+	base += call_arg_base;
+	frame = mLocalStack + base;
+	code = func_code;
+	pc = 0;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_TAIL_CALL)
+      {
+	Ymsl_INT index = code->read_int(pc);
+	Ymsl_INT arg_base = code->read_int(pc);
 	ASSERT_COND( index >= 0 && index < mFuncTableSize );
 	const VsmFunction* func = mFuncTable[index];
-	Ymsl_INT base = mSP;
-	func->execute(*this, base);
+	const VsmRegCodeList* func_code = func->reg_code();
+	if ( func_code == NULL ) {
+	  // 普通に呼び出してから戻る．
+	  // 呼ばれた側でごみ集めが起きてもこのフレームを辿れるように
+	  // 積んだまま呼び出す．
+	  Frame caller;
+	  caller.mCodeList = code;
+	  caller.mPC = pc;
+	  caller.mBase = base;
+	  caller.mFunc = NULL;
+	  caller.mModule = mCurModule;
+	  caller.mSP = mSP;
+	  mFrameStack.push_back(caller);
+	  func->execute(*this, base + arg_base);
+	  mFrameStack.pop_back();
+	  mSP = caller.mSP;
+	  frame = mLocalStack + base;
+	  frame[0] = frame[arg_base];
+	  goto do_return;
+	}
+
+	// 引数を現在のフレームの先頭に移して呼ばれた関数のコードに切り替える．
+	Ymsl_INT n = func->arg_num();
+	for (Ymsl_INT i = 0; i < n; ++ i) {
+	  frame[i] = frame[arg_base + i];
+	}
+	code = func_code;
+	pc = 0;
       }
-      break;
+      VSM_NEXT;
 
-    case VSM_RETURN:
+    VSM_OP(VSM_REG_RETURN)
       {
+	// 返り値はフレームの先頭に置く．
+	Ymsl_INT src = code->read_int(pc);
+	frame[0] = frame[src];
       }
-      break;
+      goto do_return;
+
+    VSM_OP(VSM_REG_RETURN_VOID)
+      goto do_return;
 
-    case VSM_HALT:
+    do_return:
+      if ( mFrameStack.size() == frame_top ) {
+	return;
+      }
       {
+	// 呼び出し元の状態に戻す．
+	const Frame& caller = mFrameStack.back();
+	code = caller.mCodeList;
+	pc = caller.mPC;
+	base = caller.mBase;
+	mSP = caller.mSP;
+	if ( caller.mModule != mCurModule ) {
+	  set_module(caller.mModule);
+	}
+	mFrameStack.pop_back();
+	frame = mLocalStack + base;
+      }
+      VSM_NEXT;
+
+    VSM_OP(VSM_REG_HALT)
+      return;
+
+#if !defined(YMSL_USE_COMPUTED_GOTO)
+    default:
+      ASSERT_NOT_REACHED;
+      return;
+    }
+  }
+#endif
+}
+
+// @brief モジュールを実行する．
+// @param[in] module 対象のモジュール
+// @return スタックオーバーフローが起きたら false を返す．
+bool
+Vsm::execute_module(const VsmModule& module)
+{
+  // import しているモジュールも含めて状態を作り直す．
+  clear_modules();
+  ModuleState* main_module = link_module(&module);
+
+  // JIT コンパイルしたコードどうしの呼び出しに使う C++ のスタックの
+  // 上限を決めておく．
+  char mark;
+  ympuint sp = reinterpret_cast<ympuint>(&mark);
+  ympuint size = native_stack_size(sp);
+  mNativeStackLimit = (sp > size) ? sp - size : 0;
+
+  mSP = 0;
+  mFrameStack.clear();
+  if ( !mStack->run(execute_toplevel, this) ) {
+    // 途中で打ち切られたので状態を初期化しておく．
+    mSP = 0;
+    mFrameStack.clear();
+    set_module(main_module);
+    MsgMgr::put_msg(__FILE__, __LINE__,
+		    FileRegion(),
+		    kMsgError,
+		    "VSM",
+		    "stack overflow");
+    return false;
+  }
+  return true;
+}
+
+// @brief モジュールの状態を作る．
+// @param[in] module モジュール
+// @return モジュールの状態を返す．
+//
+// import の関係は DAG なので再帰でたどる．
+// 作った状態は import されている側が先になるように mModuleList に並ぶ．
+Vsm::ModuleState*
+Vsm::link_module(const VsmModule* module)
+{
+  for (vector<ModuleState*>::iterator p = mModuleList.begin();
+       p != mModuleList.end(); ++ p) {
+    if ( (*p)->mModule == module ) {
+      return *p;
+    }
+  }
+
+  ModuleState* state = new ModuleState;
+  state->mModule = module;
+
+  Ymsl_INT nf = module->exported_function_num();
+  state->mFuncTableSize = nf;
+  state->mFuncTable = new VsmFunction*[nf];
+  for (Ymsl_INT i = 0; i < nf; ++ i) {
+    state->mFuncTable[i] = module->exported_function(i);
+  }
+
+  Ymsl_INT nv = module->exported_variable_num();
+  state->mGlobalHeapSize = nv;
+  state->mGlobalHeap = new VsmValue[nv];
+  state->mGlobalCard.assign((nv >> kGlobalCardShift) + 1, 0);
+  for (Ymsl_INT i = 0; i < nv; ++ i) {
+    state->mGlobalHeap[i].obj_value = NULL;
+    const VsmVar* var = module->exported_variable(i);
+    if ( YmslObj::val_class(var->type()) == YmslObj::kClassObj ) {
+      state->mGlobalObjList.push_back(i);
+    }
+  }
+
+  state->mConstTable = module->const_pool().value_table();
+
+  ymuint nm = module->imported_module_num();
+  state->mLinkTable.resize(nm + 1);
+  state->mLinkTable[0] = state;
+  for (ymuint i = 0; i < nm; ++ i) {
+    state->mLinkTable[i + 1] = link_module(module->imported_module(i));
+  }
+
+  mModuleList.push_back(state);
+  return state;
+}
+
+// @brief モジュールの状態を全て削除する．
+void
+Vsm::clear_modules()
+{
+  for (vector<ModuleState*>::iterator p = mModuleList.begin();
+       p != mModuleList.end(); ++ p) {
+    ModuleState* state = *p;
+    delete [] state->mFuncTable;
+    delete [] state->mGlobalHeap;
+    delete state;
+  }
+  mModuleList.clear();
+  mCurModule = NULL;
+  mFuncTableSize = 0;
+  mFuncTable = NULL;
+  mGlobalHeapSize = 0;
+  mGlobalHeap = NULL;
+  mGlobalCard = NULL;
+  mConstTable = NULL;
+}
+
+// @brief 全てのモジュールのトップレベルのコードを実行する．
+// @param[in] arg Vsm へのポインタ
+//
+// import されている側から順に実行するので，最後に実行するのが
+// execute_module() に渡したモジュールになり，終わった後もそれが
+// 実行中のモジュールとして残る．
+void
+Vsm::execute_toplevel(void* arg)
+{
+  Vsm* vsm = reinterpret_cast<Vsm*>(arg);
+  for (vector<ModuleState*>::iterator p = vsm->mModuleList.begin();
+       p != vsm->mModuleList.end(); ++ p) {
+    ModuleState* state = *p;
+    vsm->set_module(state);
+    vsm->mSP = 0;
+    state->mModule->execute_toplevel(*vsm);
+  }
+}
+
+// @brief 関数を呼び出す．
+// @param[in] index 関数番号
+//
+// 引数はスタックに積まれている．
+// 呼び出し後は引数を取り除き，返り値がある場合にはそれを積む．
+void
+Vsm::call_func(Ymsl_INT index)
+{
+  ASSERT_COND( index >= 0 && index < mFuncTableSize );
+  const VsmFunction* func = mFuncTable[index];
+  Ymsl_INT base = mSP - func->arg_num();
+  reserve_frame(base, func->frame_size());
+  func->execute(*this, base);
+
+  // 返り値は base に置かれている．
+  mSP = base;
+  if ( func->has_return_value() ) {
+    ++ mSP;
+  }
+}
+
+// @brief ごみ集めを行う．
+// @param[in] code 実行中のコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base ベースレジスタ
+//
+// 根はグローバル変数のうち OBJ のものと，実行中のフレームおよび
+// 呼び出しフレームのスタックに積まれたフレームのスタックマップが
+// 示すスロット．スタックマップのないフレームがある場合は
+// 根を正確に求められないので何もしない．
+//
+// 若い世代は一度に集める．古い世代は始める時と印つけを終える時に
+// 若い世代を空にしてから根に印をつけ，後は VsmHeap の時間の上限まで
+// 印つけか解放を進める．一回の呼び出しが一回の停止になる．
+void
+Vsm::collect(const VsmCodeList* code,
+	     Ymsl_INT pc,
+	     Ymsl_INT base)
+{
+  if ( !mHeap->need_minor_collect() &&
+       mHeap->state() != VsmHeap::kIdle &&
+       !mHeap->slice_due() ) {
+    // 古い世代のごみ集めの途中だが，まだ次の停止の時刻ではない．
+    return;
+  }
+
+  // 先に全てのフレームにスタックマップがあるか調べる．
+  if ( code->find_stack_map(pc) < 0 ) {
+    return;
+  }
+  for (vector<Frame>::const_iterator p = mFrameStack.begin();
+       p != mFrameStack.end(); ++ p) {
+    if ( p->mCodeList->find_stack_map(p->mPC) < 0 ) {
+      return;
+    }
+  }
+
+  mHeap->begin_pause();
+
+  if ( mHeap->state() == VsmHeap::kIdle && mHeap->need_full_collect() ) {
+    minor_collect(code, pc, base);
+    mark_roots(code, pc, base);
+    mHeap->start_mark();
+  }
+  else if ( mHeap->need_minor_collect() ) {
+    minor_collect(code, pc, base);
+  }
+
+  if ( mHeap->state() == VsmHeap::kMarking && mHeap->mark_step() ) {
+    // 灰色がなくなったので根を調べ直して印つけを終える．
+    minor_collect(code, pc, base);
+    mark_roots(code, pc, base);
+    mHeap->finish_mark();
+  }
+
+  if ( mHeap->state() == VsmHeap::kSweeping ) {
+    mHeap->sweep_step();
+  }
+
+  mHeap->end_pause();
+}
+
+// @brief 若い世代のごみ集めを行う．
+// @param[in] code 実行中のコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base ベースレジスタ
+//
+// 根にするグローバル変数は印のあるカードのものだけでよい．
+void
+Vsm::minor_collect(const VsmCodeList* code,
+		   Ymsl_INT pc,
+		   Ymsl_INT base)
+{
+  for (vector<ModuleState*>::iterator q = mModuleList.begin();
+       q != mModuleList.end(); ++ q) {
+    ModuleState* state = *q;
+    for (vector<Ymsl_INT>::const_iterator p = state->mGlobalObjList.begin();
+	 p != state->mGlobalObjList.end(); ++ p) {
+      if ( state->mGlobalCard[*p >> kGlobalCardShift] ) {
+	mHeap->forward(state->mGlobalHeap[*p].obj_value);
       }
-      break;
     }
   }
+  forward_frame(code, pc, base);
+  for (vector<Frame>::const_iterator p = mFrameStack.begin();
+       p != mFrameStack.end(); ++ p) {
+    forward_frame(p->mCodeList, p->mPC, p->mBase);
+  }
+  mHeap->minor_collect();
+  for (vector<ModuleState*>::iterator q = mModuleList.begin();
+       q != mModuleList.end(); ++ q) {
+    ModuleState* state = *q;
+    state->mGlobalCard.assign(state->mGlobalCard.size(), 0);
+  }
+}
+
+// @brief 根のスロットが指すオブジェクトに印をつける．
+// @param[in] code 実行中のコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base ベースレジスタ
+void
+Vsm::mark_roots(const VsmCodeList* code,
+		Ymsl_INT pc,
+		Ymsl_INT base)
+{
+  for (vector<ModuleState*>::iterator q = mModuleList.begin();
+       q != mModuleList.end(); ++ q) {
+    ModuleState* state = *q;
+    for (vector<Ymsl_INT>::const_iterator p = state->mGlobalObjList.begin();
+	 p != state->mGlobalObjList.end(); ++ p) {
+      mHeap->mark(state->mGlobalHeap[*p].obj_value);
+    }
+  }
+  mark_frame(code, pc, base);
+  for (vector<Frame>::const_iterator p = mFrameStack.begin();
+       p != mFrameStack.end(); ++ p) {
+    mark_frame(p->mCodeList, p->mPC, p->mBase);
+  }
+}
+
+// @brief フレームのスタックマップが示すスロットを VsmHeap::forward() に渡す．
+// @param[in] code フレームのコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base フレームのベースレジスタ
+void
+Vsm::forward_frame(const VsmCodeList* code,
+		   Ymsl_INT pc,
+		   Ymsl_INT base)
+{
+  Ymsl_INT index = code->find_stack_map(pc);
+  ASSERT_COND( index >= 0 );
+  const Ymsl_INT* slot_list = code->stack_map(index);
+  Ymsl_INT n = code->stack_map_size(index);
+  for (Ymsl_INT i = 0; i < n; ++ i) {
+    mHeap->forward(mLocalStack[base + slot_list[i]].obj_value);
+  }
+}
+
+// @brief フレームのスタックマップが示すオブジェクトに印をつける．
+// @param[in] code フレームのコード
+// @param[in] pc 安全点の命令の直後のアドレス
+// @param[in] base フレームのベースレジスタ
+void
+Vsm::mark_frame(const VsmCodeList* code,
+		Ymsl_INT pc,
+		Ymsl_INT base)
+{
+  Ymsl_INT index = code->find_stack_map(pc);
+  ASSERT_COND( index >= 0 );
+  const Ymsl_INT* slot_list = code->stack_map(index);
+  Ymsl_INT n = code->stack_map_size(index);
+  for (Ymsl_INT i = 0; i < n; ++ i) {
+    mHeap->mark(mLocalStack[base + slot_list[i]].obj_value);
+  }
+}
+
+// @brief スタックを伸長する．
+// @param[in] size 必要な要素数
+void
+Vsm::grow_stack(Ymsl_INT size)
+{
+  if ( !mStack->ensure(size) ) {
+    mStack->overflow();
+  }
+  mLocalStackSize = mStack->size();
+}
+
+// @brief 命令のオペランドの形式を返す．
+// @param[in] op 命令
+const char*
+Vsm::operand_format(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_PUSH_INT_IMM:
+  case VSM_PUSH_CONST:
+  case VSM_LOAD_GLOBAL_INT:
+  case VSM_LOAD_GLOBAL_FLOAT:
+  case VSM_LOAD_GLOBAL_OBJ:
+  case VSM_LOAD_LOCAL_INT:
+  case VSM_LOAD_LOCAL_FLOAT:
+  case VSM_LOAD_LOCAL_OBJ:
+  case VSM_STORE_GLOBAL_INT:
+  case VSM_STORE_GLOBAL_FLOAT:
+  case VSM_STORE_GLOBAL_OBJ:
+  case VSM_STORE_LOCAL_INT:
+  case VSM_STORE_LOCAL_FLOAT:
+  case VSM_STORE_LOCAL_OBJ:
+  case VSM_CALL:
+  case VSM_TAIL_CALL:
+  case VSM_LOCAL_INT_INC:
+  case VSM_LOCAL_INT_DEC:
+    return "i";
+
+  case VSM_JUMP:
+  case VSM_BRANCH_TRUE:
+  case VSM_BRANCH_FALSE:
+  case VSM_INT_EQ_BRANCH_FALSE:
+  case VSM_INT_NE_BRANCH_FALSE:
+  case VSM_INT_LT_BRANCH_FALSE:
+  case VSM_INT_LE_BRANCH_FALSE:
+    return "a";
+
+  case VSM_LOAD_EXT_GLOBAL_INT:
+  case VSM_LOAD_EXT_GLOBAL_FLOAT:
+  case VSM_LOAD_EXT_GLOBAL_OBJ:
+  case VSM_STORE_EXT_GLOBAL_INT:
+  case VSM_STORE_EXT_GLOBAL_FLOAT:
+  case VSM_STORE_EXT_GLOBAL_OBJ:
+  case VSM_CALL_EXT:
+  case VSM_LOCAL_INT_ADD_IMM:
+  case VSM_PUSH_INT_IMM_LOAD_LOCAL_INT:
+    return "ii";
+
+  case VSM_LOCAL_INT_LT_BRANCH_FALSE:
+  case VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE:
+    return "iia";
+
+  case VSM_JUMP_TABLE:
+    return "ita";
+
+  case VSM_PUSH_FLOAT_IMM:
+    return "f";
+
+  default:
+    break;
+  }
+  return "";
+}
+
+// @brief レジスタ型の命令のオペランドの形式を返す．
+// @param[in] op 命令
+const char*
+Vsm::reg_operand_format(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_REG_OBJ_NULL:
+  case VSM_REG_RETURN:
+    return "i";
+
+  case VSM_REG_JUMP:
+    return "a";
+
+  case VSM_REG_BRANCH_TRUE:
+  case VSM_REG_BRANCH_FALSE:
+    return "ia";
+
+  case VSM_REG_JUMP_TABLE:
+    return "iita";
+
+  case VSM_REG_ENTER:
+  case VSM_REG_MOVE:
+  case VSM_REG_INT_IMM:
+  case VSM_REG_CONST:
+  case VSM_REG_LOAD_GLOBAL:
+  case VSM_REG_STORE_GLOBAL:
+  case VSM_REG_CALL:
+  case VSM_REG_TAIL_CALL:
+  case VSM_REG_INT_MINUS:
+  case VSM_REG_INT_INC:
+  case VSM_REG_INT_DEC:
+  case VSM_REG_INT_NOT:
+  case VSM_REG_INT_LNOT:
+  case VSM_REG_INT_TO_BOOL:
+  case VSM_REG_INT_TO_FLOAT:
+  case VSM_REG_FLOAT_MINUS:
+  case VSM_REG_FLOAT_TO_BOOL:
+  case VSM_REG_FLOAT_TO_INT:
+  case VSM_REG_OBJ_MINUS:
+  case VSM_REG_OBJ_INC:
+  case VSM_REG_OBJ_DEC:
+  case VSM_REG_OBJ_NOT:
+  case VSM_REG_OBJ_TO_INT:
+  case VSM_REG_OBJ_TO_FLOAT:
+    return "ii";
+
+  case VSM_REG_INT_ADD:
+  case VSM_REG_INT_SUB:
+  case VSM_REG_INT_MUL:
+  case VSM_REG_INT_DIV:
+  case VSM_REG_INT_MOD:
+  case VSM_REG_INT_LSHIFT:
+  case VSM_REG_INT_RSHIFT:
+  case VSM_REG_INT_EQ:
+  case VSM_REG_INT_NE:
+  case VSM_REG_INT_LT:
+  case VSM_REG_INT_LE:
+  case VSM_REG_INT_AND:
+  case VSM_REG_INT_OR:
+  case VSM_REG_INT_XOR:
+  case VSM_REG_FLOAT_ADD:
+  case VSM_REG_FLOAT_SUB:
+  case VSM_REG_FLOAT_MUL:
+  case VSM_REG_FLOAT_DIV:
+  case VSM_REG_FLOAT_EQ:
+  case VSM_REG_FLOAT_NE:
+  case VSM_REG_FLOAT_LT:
+  case VSM_REG_FLOAT_LE:
+  case VSM_REG_OBJ_ADD:
+  case VSM_REG_OBJ_SUB:
+  case VSM_REG_OBJ_MUL:
+  case VSM_REG_OBJ_DIV:
+  case VSM_REG_OBJ_MOD:
+  case VSM_REG_OBJ_LSHIFT:
+  case VSM_REG_OBJ_RSHIFT:
+  case VSM_REG_OBJ_EQ:
+  case VSM_REG_OBJ_NE:
+  case VSM_REG_OBJ_LT:
+  case VSM_REG_OBJ_LE:
+  case VSM_REG_OBJ_AND:
+  case VSM_REG_OBJ_OR:
+  case VSM_REG_OBJ_XOR:
+    return "iii";
+
+  case VSM_REG_LOAD_EXT_GLOBAL:
+  case VSM_REG_STORE_EXT_GLOBAL:
+  case VSM_REG_CALL_EXT:
+    return "iii";
+
+  case VSM_REG_ITE:
+    return "iiii";
+
+  case VSM_REG_FLOAT_IMM:
+    return "if";
+
+  default:
+    break;
+  }
+  return "";
+}
+
+// @brief 命令のオペランドの語数を返す．
+// @param[in] op 命令
+ymuint
+Vsm::operand_size(Ymsl_CODE op)
+{
+  return format_size(operand_format(op));
+}
+
+// @brief レジスタ型の命令のオペランドの語数を返す．
+// @param[in] op 命令
+ymuint
+Vsm::reg_operand_size(Ymsl_CODE op)
+{
+  return format_size(reg_operand_format(op));
+}
+
+// @brief 命令の名前を返す．
+// @param[in] op 命令
+const char*
+Vsm::opcode_name(Ymsl_CODE op)
+{
+  ASSERT_COND( op <= VSM_HALT );
+  return opcode_name_table[op];
+}
+
+// @brief 連続して実行された命令の組の回数を出力する．
+// @param[in] s 出力先のストリーム
+// @param[in] num 出力する組の数
+void
+Vsm::print_profile(ostream& s,
+		   ymuint num)
+{
+#if defined(YMSL_VSM_PROFILE)
+  vector<pair<ymuint64, ymuint> > count_list;
+  ymuint64 total = 0;
+  for (ymuint i = 0; i < kOpNum; ++ i) {
+    for (ymuint j = 0; j < kOpNum; ++ j) {
+      ymuint64 c = pair_count[i][j];
+      if ( c > 0 ) {
+	count_list.push_back(make_pair(c, i * kOpNum + j));
+	total += c;
+      }
+    }
+  }
+  // 回数の多い順に並べる．
+  sort(count_list.begin(), count_list.end());
+  reverse(count_list.begin(), count_list.end());
+  s << "total: " << total << endl;
+  if ( num > count_list.size() ) {
+    num = count_list.size();
+  }
+  for (ymuint i = 0; i < num; ++ i) {
+    ymuint64 c = count_list[i].first;
+    ymuint op1 = count_list[i].second / kOpNum;
+    ymuint op2 = count_list[i].second % kOpNum;
+    s << c << "\t"
+      << (c * 100.0 / total) << "%\t"
+      << opcode_name(op1) << " " << opcode_name(op2) << endl;
+  }
+#else
+  s << "not compiled with YMSL_VSM_PROFILE" << endl;
+#endif
 }
 
 END_NAMESPACE_YM_YMSL
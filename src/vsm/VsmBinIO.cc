@@ -0,0 +1,205 @@
+
+/// @file VsmBinIO.cc
+/// @brief VsmBinWriter, VsmBinReader の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmBinIO.h"
+#include "YmslMutex.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmBinWriter
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+VsmBinWriter::VsmBinWriter()
+{
+}
+
+// @brief デストラクタ
+VsmBinWriter::~VsmBinWriter()
+{
+}
+
+// @brief 8ビットの値を書く．
+// @param[in] val 値
+void
+VsmBinWriter::write_8(ymuint8 val)
+{
+  mData.push_back(val);
+}
+
+// @brief 32ビットの値を書く．
+// @param[in] val 値
+void
+VsmBinWriter::write_32(ymuint32 val)
+{
+  write_block(&val, sizeof(ymuint32));
+}
+
+// @brief 64ビットの値を書く．
+// @param[in] val 値
+void
+VsmBinWriter::write_64(ymuint64 val)
+{
+  write_block(&val, sizeof(ymuint64));
+}
+
+// @brief FLOAT の値を書く．
+// @param[in] val 値
+void
+VsmBinWriter::write_float(Ymsl_FLOAT val)
+{
+  write_block(&val, sizeof(Ymsl_FLOAT));
+}
+
+// @brief 文字列を書く．
+// @param[in] str 文字列
+void
+VsmBinWriter::write_str(const char* str)
+{
+  ymuint32 len = (str != NULL) ? strlen(str) : 0;
+  write_32(len);
+  write_block(str, len);
+}
+
+// @brief バイト列を書く．
+// @param[in] data 先頭のアドレス
+// @param[in] size バイト数
+void
+VsmBinWriter::write_block(const void* data,
+			  ymuint64 size)
+{
+  const ymuint8* p = static_cast<const ymuint8*>(data);
+  mData.insert(mData.end(), p, p + size);
+}
+
+// @brief 書き込んだ内容を返す．
+const vector<ymuint8>&
+VsmBinWriter::data() const
+{
+  return mData;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmBinReader
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] data 先頭のアドレス
+// @param[in] size バイト数
+VsmBinReader::VsmBinReader(const ymuint8* data,
+			   ymuint64 size) :
+  mCur(data),
+  mEnd(data + size),
+  mError(false)
+{
+}
+
+// @brief デストラクタ
+VsmBinReader::~VsmBinReader()
+{
+}
+
+// @brief 8ビットの値を読む．
+ymuint8
+VsmBinReader::read_8()
+{
+  const ymuint8* p = read_block(1);
+  return (p != NULL) ? *p : 0;
+}
+
+// @brief 32ビットの値を読む．
+ymuint32
+VsmBinReader::read_32()
+{
+  ymuint32 val = 0;
+  const ymuint8* p = read_block(sizeof(ymuint32));
+  if ( p != NULL ) {
+    // 境界に揃っているとは限らないので memcpy() で取り出す．
+    memcpy(&val, p, sizeof(ymuint32));
+  }
+  return val;
+}
+
+// @brief 64ビットの値を読む．
+ymuint64
+VsmBinReader::read_64()
+{
+  ymuint64 val = 0;
+  const ymuint8* p = read_block(sizeof(ymuint64));
+  if ( p != NULL ) {
+    memcpy(&val, p, sizeof(ymuint64));
+  }
+  return val;
+}
+
+// @brief FLOAT の値を読む．
+Ymsl_FLOAT
+VsmBinReader::read_float()
+{
+  Ymsl_FLOAT val = 0.0;
+  const ymuint8* p = read_block(sizeof(Ymsl_FLOAT));
+  if ( p != NULL ) {
+    memcpy(&val, p, sizeof(Ymsl_FLOAT));
+  }
+  return val;
+}
+
+// @brief 文字列を読む．
+ShString
+VsmBinReader::read_str()
+{
+  ymuint32 len = read_32();
+  const ymuint8* p = read_block(len);
+  if ( p == NULL ) {
+    return ShString();
+  }
+  string str(reinterpret_cast<const char*>(p), len);
+  return intern_ShString(str.c_str());
+}
+
+// @brief バイト列を読む．
+// @param[in] size バイト数
+// @return 先頭のアドレスを返す．
+const ymuint8*
+VsmBinReader::read_block(ymuint64 size)
+{
+  if ( mError || size > remain() ) {
+    mError = true;
+    return NULL;
+  }
+  const ymuint8* p = mCur;
+  mCur += size;
+  return p;
+}
+
+// @brief 読み残したバイト数を返す．
+ymuint64
+VsmBinReader::remain() const
+{
+  return mEnd - mCur;
+}
+
+// @brief 末尾を越えて読もうとした時 true を返す．
+bool
+VsmBinReader::error() const
+{
+  return mError;
+}
+
+// @brief エラーフラグを立てる．
+void
+VsmBinReader::set_error()
+{
+  mError = true;
+}
+
+END_NAMESPACE_YM_YMSL
@@ -8,6 +8,10 @@
 
 
 #include "VsmCodeList.h"
+#include "Vsm.h"
+#include "VsmBinIO.h"
+
+#include <cstring>
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -61,22 +65,39 @@ VsmCodeList::Builder::write_float(Ymsl_FLOAT val)
   }
 }
 
-// @brief OBJPTR を追加する．
+// @brief 書き込み済みの INT を書き換える．
+// @param[in] addr アドレス
 // @param[in] val 値
 void
-VsmCodeList::Builder::write_objptr(Ymsl_OBJPTR val)
+VsmCodeList::Builder::rewrite_int(Ymsl_INT addr,
+				  Ymsl_INT val)
 {
-  // ちょっとキタナイコード
-  const ymuint n = sizeof(Ymsl_OBJPTR) / sizeof(Ymsl_CODE);
-  union buf_type {
-    Ymsl_CODE codes[n];
-    Ymsl_OBJPTR pval;
-  } buf;
+  ASSERT_COND( 0 <= addr && addr < size() );
+  mBody[addr] = static_cast<Ymsl_CODE>(val);
+}
 
-  buf.pval = val;
-  for (ymuint i = 0; i < n; ++ i) {
-    mBody.push_back(buf.codes[i]);
-  }
+// @brief ジャンプテーブルを追加する．
+// @param[in] size 要素数
+// @return ジャンプテーブルの番号を返す．
+Ymsl_INT
+VsmCodeList::Builder::add_jump_table(ymuint size)
+{
+  mJumpTableList.push_back(vector<Ymsl_INT>(size, 0));
+  return mJumpTableList.size() - 1;
+}
+
+// @brief ジャンプテーブルの要素を書き換える．
+// @param[in] index ジャンプテーブルの番号
+// @param[in] pos 位置
+// @param[in] addr ジャンプ先のアドレス
+void
+VsmCodeList::Builder::rewrite_jump_table(Ymsl_INT index,
+					 ymuint pos,
+					 Ymsl_INT addr)
+{
+  ASSERT_COND( 0 <= index && index < static_cast<Ymsl_INT>(jump_table_num()) );
+  ASSERT_COND( pos < mJumpTableList[index].size() );
+  mJumpTableList[index][pos] = addr;
 }
 
 // @brief サイズを得る．
@@ -96,6 +117,201 @@ VsmCodeList::Builder::read_opcode(Ymsl_INT addr) const
   return mBody[addr];
 }
 
+// @brief INT を読みだす．
+// @param[in] addr アドレス
+// @return 読みだした値を返す．
+Ymsl_INT
+VsmCodeList::Builder::read_int(Ymsl_INT addr) const
+{
+  ASSERT_COND( 0 <= addr && addr < size() );
+  return static_cast<Ymsl_INT>(mBody[addr]);
+}
+
+// @brief FLOAT を読みだす．
+// @param[in] addr アドレス
+// @return 読みだした値を返す．
+Ymsl_FLOAT
+VsmCodeList::Builder::read_float(Ymsl_INT addr) const
+{
+  const ymuint n = sizeof(Ymsl_FLOAT) / sizeof(Ymsl_CODE);
+  ASSERT_COND( 0 <= addr && addr + static_cast<Ymsl_INT>(n) <= size() );
+  union buf_type {
+    Ymsl_CODE codes[n];
+    Ymsl_FLOAT fval;
+  } buf;
+
+  for (ymuint i = 0; i < n; ++ i) {
+    buf.codes[i] = mBody[addr + i];
+  }
+  return buf.fval;
+}
+
+// @brief ジャンプテーブルの数を得る．
+ymuint
+VsmCodeList::Builder::jump_table_num() const
+{
+  return mJumpTableList.size();
+}
+
+// @brief ジャンプテーブルを得る．
+// @param[in] index ジャンプテーブルの番号
+const vector<Ymsl_INT>&
+VsmCodeList::Builder::jump_table(Ymsl_INT index) const
+{
+  ASSERT_COND( 0 <= index && index < static_cast<Ymsl_INT>(jump_table_num()) );
+  return mJumpTableList[index];
+}
+
+// @brief スタックマップを追加する．
+// @param[in] addr 安全点の命令の直後のアドレス
+// @param[in] slot_list OBJ の値を持つスロットの番号のリスト
+void
+VsmCodeList::Builder::add_stack_map(Ymsl_INT addr,
+				    const vector<Ymsl_INT>& slot_list)
+{
+  ASSERT_COND( 0 <= addr && addr <= size() );
+  ASSERT_COND( mStackMapList.empty() || mStackMapList.back().first < addr );
+  mStackMapList.push_back(make_pair(addr, slot_list));
+}
+
+// @brief スタックマップの数を得る．
+ymuint
+VsmCodeList::Builder::stack_map_num() const
+{
+  return mStackMapList.size();
+}
+
+// @brief スタックマップのアドレスを得る．
+// @param[in] pos 位置 ( 0 <= pos < stack_map_num() )
+Ymsl_INT
+VsmCodeList::Builder::stack_map_addr(ymuint pos) const
+{
+  ASSERT_COND( pos < stack_map_num() );
+  return mStackMapList[pos].first;
+}
+
+// @brief スタックマップのスロットの番号のリストを得る．
+// @param[in] pos 位置 ( 0 <= pos < stack_map_num() )
+const vector<Ymsl_INT>&
+VsmCodeList::Builder::stack_map_slot_list(ymuint pos) const
+{
+  ASSERT_COND( pos < stack_map_num() );
+  return mStackMapList[pos].second;
+}
+
+
+BEGIN_NONAMESPACE
+
+// val を書き込むのに必要なバイト数を返す．
+ymuint
+int_size(Ymsl_INT val)
+{
+  if ( val > VsmCodeList::kInt32 && val <= 127 ) {
+    return 1;
+  }
+  if ( val >= -32768 && val <= 32767 ) {
+    return 1 + sizeof(ymint16);
+  }
+  return 1 + sizeof(ymint32);
+}
+
+// val を size バイトで書き込む．
+// size は int_size(val) 以上でなければならない．
+void
+put_int(ymuint8* buf,
+	Ymsl_INT val,
+	ymuint size)
+{
+  if ( size == 1 ) {
+    buf[0] = static_cast<ymuint8>(val);
+  }
+  else if ( size == 1 + sizeof(ymint16) ) {
+    ymint16 val16 = static_cast<ymint16>(val);
+    buf[0] = static_cast<ymuint8>(VsmCodeList::kInt16);
+    memcpy(buf + 1, &val16, sizeof(ymint16));
+  }
+  else {
+    ymint32 val32 = static_cast<ymint32>(val);
+    buf[0] = static_cast<ymuint8>(VsmCodeList::kInt32);
+    memcpy(buf + 1, &val32, sizeof(ymint32));
+  }
+}
+
+// buf[pos] から始まる INT のバイト数を返す．
+ymuint
+int_len(const ymuint8* buf,
+	ymuint pos)
+{
+  ymint8 b = static_cast<ymint8>(buf[pos]);
+  if ( b == VsmCodeList::kInt16 ) {
+    return 1 + sizeof(ymint16);
+  }
+  if ( b == VsmCodeList::kInt32 ) {
+    return 1 + sizeof(ymint32);
+  }
+  return 1;
+}
+
+// buf[pos] から始まる INT を読む．
+// 読めたら pos を進めて true を返す．
+// size を越える場合は false を返す．
+bool
+get_int(const ymuint8* buf,
+	ymuint size,
+	ymuint& pos,
+	Ymsl_INT& val)
+{
+  if ( pos >= size ) {
+    return false;
+  }
+  ymuint n = int_len(buf, pos);
+  if ( n > size - pos ) {
+    return false;
+  }
+  if ( n == 1 ) {
+    val = static_cast<ymint8>(buf[pos]);
+  }
+  else if ( n == 1 + sizeof(ymint16) ) {
+    ymint16 val16;
+    memcpy(&val16, buf + pos + 1, sizeof(ymint16));
+    val = val16;
+  }
+  else {
+    ymint32 val32;
+    memcpy(&val32, buf + pos + 1, sizeof(ymint32));
+    val = val32;
+  }
+  pos += n;
+  return true;
+}
+
+// FLOAT の定数表を作るためのクラス
+// 同じ値は一つにまとめる．
+class FloatPool
+{
+public:
+
+  // val の番号を返す．
+  Ymsl_INT
+  index(Ymsl_FLOAT val)
+  {
+    // -0.0 と 0.0 や NaN を区別するためにビットパタンで比べる．
+    for (ymuint i = 0; i < mList.size(); ++ i) {
+      if ( memcmp(&mList[i], &val, sizeof(Ymsl_FLOAT)) == 0 ) {
+	return i;
+      }
+    }
+    mList.push_back(val);
+    return mList.size() - 1;
+  }
+
+  // 要素のリスト
+  vector<Ymsl_FLOAT> mList;
+
+};
+
+END_NONAMESPACE
+
 
 //////////////////////////////////////////////////////////////////////
 // クラス VsmCodeList
@@ -103,20 +319,521 @@ VsmCodeList::Builder::read_opcode(Ymsl_INT addr) const
 
 // @brief コンストラクタ
 // @param[in] builder 初期化用オブジェクト
-VsmCodeList::VsmCodeList(const Builder& builder)
+VsmCodeList::VsmCodeList(const Builder& builder) :
+  mFormatFunc(Vsm::operand_format)
 {
-  mSize = builder.size();
-  mBody = new Ymsl_CODE[mSize];
-  for (ymuint i = 0; i < mSize; ++ i) {
-    mBody[i] = builder.read_opcode(i);
+  build(builder);
+}
+
+// @brief オペランドの形式を指定したコンストラクタ
+// @param[in] builder 初期化用オブジェクト
+// @param[in] format_func オペランドの形式を返す関数
+VsmCodeList::VsmCodeList(const Builder& builder,
+			 FormatFunc format_func) :
+  mFormatFunc(format_func)
+{
+  build(builder);
+}
+
+// @brief dump() で書き出した内容を読み込むコンストラクタ
+// @param[in] reader 読み込み用のオブジェクト
+VsmCodeList::VsmCodeList(VsmBinReader& reader) :
+  mFormatFunc(Vsm::operand_format),
+  mByteSize(0),
+  mFloatNum(0),
+  mJumpTableNum(0),
+  mStackMapNum(0)
+{
+  // 保存用の形は reader のバッファを指したまま実行用の形に直す．
+  // 途中で失敗してもデストラクタで破棄できるように
+  // 配列は常に確保しておく．
+  ymuint byte_size = reader.read_32();
+  const ymuint8* body = reader.read_block(byte_size);
+  if ( body == NULL ) {
+    byte_size = 0;
+  }
+
+  ymuint float_num = reader.read_32();
+  if ( float_num > reader.remain() / sizeof(Ymsl_FLOAT) ) {
+    // 壊れている．
+    reader.set_error();
+    float_num = 0;
+  }
+  mFloatNum = float_num;
+  mFloatPool = new Ymsl_FLOAT[mFloatNum];
+  for (ymuint i = 0; i < mFloatNum; ++ i) {
+    mFloatPool[i] = reader.read_float();
+  }
+
+  ymuint table_num = reader.read_32();
+  if ( table_num > reader.remain() / sizeof(ymuint32) ) {
+    reader.set_error();
+    table_num = 0;
+  }
+  mJumpTableNum = table_num;
+  mJumpTableStart = new ymuint[mJumpTableNum + 1];
+  ymuint table_size = 0;
+  for (ymuint i = 0; i < mJumpTableNum; ++ i) {
+    mJumpTableStart[i] = table_size;
+    table_size += reader.read_32();
+  }
+  if ( table_size > reader.remain() / sizeof(ymint32) ) {
+    reader.set_error();
+    for (ymuint i = 0; i < mJumpTableNum; ++ i) {
+      mJumpTableStart[i] = 0;
+    }
+    table_size = 0;
+  }
+  mJumpTableStart[mJumpTableNum] = table_size;
+  mJumpTableBody = new Ymsl_INT[table_size];
+  for (ymuint i = 0; i < table_size; ++ i) {
+    Ymsl_INT addr = static_cast<ymint32>(reader.read_32());
+    if ( addr < 0 || addr > static_cast<Ymsl_INT>(byte_size) ) {
+      // 範囲外への飛び先は読み込みエラーとして扱う．
+      reader.set_error();
+      addr = 0;
+    }
+    mJumpTableBody[i] = addr;
+  }
+
+  ymuint map_num = reader.read_32();
+  if ( map_num > reader.remain() / (sizeof(ymuint32) * 2) ) {
+    reader.set_error();
+    map_num = 0;
+  }
+  mStackMapNum = map_num;
+  mStackMapAddr = new Ymsl_INT[mStackMapNum];
+  mStackMapStart = new ymuint[mStackMapNum + 1];
+  ymuint map_size = 0;
+  for (ymuint i = 0; i < mStackMapNum; ++ i) {
+    Ymsl_INT addr = static_cast<ymint32>(reader.read_32());
+    if ( addr < 0 || addr > static_cast<Ymsl_INT>(byte_size) ||
+	 (i > 0 && addr <= mStackMapAddr[i - 1]) ) {
+      // 範囲外のアドレスや昇順でないものは読み込みエラーとして扱う．
+      reader.set_error();
+      addr = 0;
+    }
+    mStackMapAddr[i] = addr;
+    mStackMapStart[i] = map_size;
+    map_size += reader.read_32();
+  }
+  if ( map_size > reader.remain() / sizeof(ymint32) ) {
+    reader.set_error();
+    for (ymuint i = 0; i < mStackMapNum; ++ i) {
+      mStackMapStart[i] = 0;
+    }
+    map_size = 0;
+  }
+  mStackMapStart[mStackMapNum] = map_size;
+  mStackMapBody = new Ymsl_INT[map_size];
+  for (ymuint i = 0; i < map_size; ++ i) {
+    Ymsl_INT slot = static_cast<ymint32>(reader.read_32());
+    if ( slot < 0 ) {
+      reader.set_error();
+      slot = 0;
+    }
+    mStackMapBody[i] = slot;
+  }
+
+  if ( decode(body, byte_size) ) {
+    // 書き出す時の大きさを求めておく．
+    vector<Ymsl_INT> addr_map;
+    vector<ymuint> size_list;
+    mByteSize = layout(addr_map, size_list);
+  }
+  else {
+    reader.set_error();
   }
 }
 
 // @brief デストラクタ
 VsmCodeList::~VsmCodeList()
 {
-  delete [] mBody;
+  delete [] mCode;
+  delete [] mFloatPool;
+  delete [] mJumpTableStart;
+  delete [] mJumpTableBody;
+  delete [] mStackMapAddr;
+  delete [] mStackMapStart;
+  delete [] mStackMapBody;
+}
+
+// @brief builder の内容から実行用の形を作る．
+// @param[in] builder 初期化用オブジェクト
+void
+VsmCodeList::build(const Builder& builder)
+{
+  Ymsl_INT wsize = builder.size();
+
+  // Builder 上のアドレスから実行用の形のアドレスへの対応表
+  // 命令の先頭以外は -1 のまま
+  // 末尾(wsize)への飛び先もありうる．
+  vector<Ymsl_INT> addr_map(wsize + 1, -1);
+  vector<Ymsl_CODE> code;
+  code.reserve(wsize);
+  FloatPool float_pool;
+  // ジャンプ先のアドレスのオペランドの code 上の位置
+  vector<ymuint> addr_pos_list;
+  for (Ymsl_INT wpc = 0; wpc < wsize; ) {
+    addr_map[wpc] = code.size();
+    Ymsl_CODE op = builder.read_opcode(wpc);
+    ASSERT_COND( op < 256 );
+    ++ wpc;
+    code.push_back(op);
+    for (const char* p = mFormatFunc(op); *p; ++ p) {
+      switch ( *p ) {
+      case 'i':
+      case 't':
+	code.push_back(static_cast<Ymsl_CODE>(builder.read_int(wpc)));
+	++ wpc;
+	break;
+
+      case 'a':
+	addr_pos_list.push_back(code.size());
+	code.push_back(static_cast<Ymsl_CODE>(builder.read_int(wpc)));
+	++ wpc;
+	break;
+
+      case 'f':
+	code.push_back(static_cast<Ymsl_CODE>(float_pool.index(builder.read_float(wpc))));
+	wpc += sizeof(Ymsl_FLOAT) / sizeof(Ymsl_CODE);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+      }
+    }
+  }
+  addr_map[wsize] = code.size();
+
+  for (ymuint i = 0; i < addr_pos_list.size(); ++ i) {
+    Ymsl_INT target = static_cast<Ymsl_INT>(code[addr_pos_list[i]]);
+    ASSERT_COND( 0 <= target && target <= wsize );
+    ASSERT_COND( addr_map[target] != -1 );
+    code[addr_pos_list[i]] = static_cast<Ymsl_CODE>(addr_map[target]);
+  }
+
+  mSize = code.size();
+  mCode = new Ymsl_CODE[mSize];
+  for (ymuint i = 0; i < mSize; ++ i) {
+    mCode[i] = code[i];
+  }
+
+  mFloatNum = float_pool.mList.size();
+  mFloatPool = new Ymsl_FLOAT[mFloatNum];
+  for (ymuint i = 0; i < mFloatNum; ++ i) {
+    mFloatPool[i] = float_pool.mList[i];
+  }
+
+  mJumpTableNum = builder.jump_table_num();
+  mJumpTableStart = new ymuint[mJumpTableNum + 1];
+  ymuint table_size = 0;
+  for (ymuint i = 0; i < mJumpTableNum; ++ i) {
+    mJumpTableStart[i] = table_size;
+    table_size += builder.jump_table(i).size();
+  }
+  mJumpTableStart[mJumpTableNum] = table_size;
+  mJumpTableBody = new Ymsl_INT[table_size];
+  for (ymuint i = 0; i < mJumpTableNum; ++ i) {
+    const vector<Ymsl_INT>& table = builder.jump_table(i);
+    for (ymuint j = 0; j < table.size(); ++ j) {
+      Ymsl_INT target = table[j];
+      ASSERT_COND( 0 <= target && target <= wsize );
+      ASSERT_COND( addr_map[target] != -1 );
+      mJumpTableBody[mJumpTableStart[i] + j] = addr_map[target];
+    }
+  }
+
+  // addr_map は単調増加なので並び順は変わらない．
+  mStackMapNum = builder.stack_map_num();
+  mStackMapAddr = new Ymsl_INT[mStackMapNum];
+  mStackMapStart = new ymuint[mStackMapNum + 1];
+  ymuint map_size = 0;
+  for (ymuint i = 0; i < mStackMapNum; ++ i) {
+    Ymsl_INT addr = builder.stack_map_addr(i);
+    ASSERT_COND( 0 <= addr && addr <= wsize );
+    ASSERT_COND( addr_map[addr] != -1 );
+    mStackMapAddr[i] = addr_map[addr];
+    mStackMapStart[i] = map_size;
+    map_size += builder.stack_map_slot_list(i).size();
+  }
+  mStackMapStart[mStackMapNum] = map_size;
+  mStackMapBody = new Ymsl_INT[map_size];
+  for (ymuint i = 0; i < mStackMapNum; ++ i) {
+    const vector<Ymsl_INT>& slot_list = builder.stack_map_slot_list(i);
+    for (ymuint j = 0; j < slot_list.size(); ++ j) {
+      mStackMapBody[mStackMapStart[i] + j] = slot_list[j];
+    }
+  }
+
+  vector<Ymsl_INT> byte_addr_map;
+  vector<ymuint> size_list;
+  mByteSize = layout(byte_addr_map, size_list);
+}
+
+// @brief 保存用の形から実行用の形を作る．
+// @param[in] body 保存用の形
+// @param[in] byte_size body のバイト数
+// @return 保存用の形が壊れていたら false を返す．
+//
+// 壊れていた場合も破棄できるように全ての配列を確保する．
+bool
+VsmCodeList::decode(const ymuint8* body,
+		    ymuint byte_size)
+{
+  bool ok = true;
+
+  // 保存用の形のアドレスから実行用の形のアドレスへの対応表
+  // 命令の先頭以外は -1 のまま
+  // 末尾(byte_size)への飛び先もありうる．
+  vector<Ymsl_INT> addr_map(byte_size + 1, -1);
+  vector<Ymsl_CODE> code;
+  code.reserve(byte_size);
+  // ジャンプ先のアドレスのオペランドの code 上の位置
+  vector<ymuint> addr_pos_list;
+  for (ymuint pos = 0; pos < byte_size && ok; ) {
+    addr_map[pos] = code.size();
+    Ymsl_CODE op = body[pos];
+    ++ pos;
+    code.push_back(op);
+    for (const char* p = mFormatFunc(op); *p; ++ p) {
+      Ymsl_INT val;
+      if ( !get_int(body, byte_size, pos, val) ) {
+	// オペランドの途中で終わっている．
+	ok = false;
+	break;
+      }
+      switch ( *p ) {
+      case 'a':
+	addr_pos_list.push_back(code.size());
+	break;
+
+      case 'f':
+	if ( val < 0 || val >= static_cast<Ymsl_INT>(mFloatNum) ) {
+	  ok = false;
+	}
+	break;
+
+      case 't':
+	if ( val < 0 || val >= static_cast<Ymsl_INT>(mJumpTableNum) ) {
+	  ok = false;
+	}
+	break;
+
+      default:
+	break;
+      }
+      code.push_back(static_cast<Ymsl_CODE>(val));
+    }
+  }
+  if ( ok ) {
+    addr_map[byte_size] = code.size();
+  }
+
+  // ジャンプ先のアドレスを置き換える．
+  // 命令の先頭以外への飛び先は壊れているとみなす．
+  for (ymuint i = 0; i < addr_pos_list.size(); ++ i) {
+    Ymsl_INT addr = static_cast<Ymsl_INT>(code[addr_pos_list[i]]);
+    Ymsl_INT new_addr = -1;
+    if ( addr >= 0 && addr <= static_cast<Ymsl_INT>(byte_size) ) {
+      new_addr = addr_map[addr];
+    }
+    if ( new_addr == -1 ) {
+      ok = false;
+      new_addr = 0;
+    }
+    code[addr_pos_list[i]] = static_cast<Ymsl_CODE>(new_addr);
+  }
+
+  ymuint table_size = mJumpTableStart[mJumpTableNum];
+  for (ymuint i = 0; i < table_size; ++ i) {
+    Ymsl_INT new_addr = addr_map[mJumpTableBody[i]];
+    if ( new_addr == -1 ) {
+      ok = false;
+      new_addr = 0;
+    }
+    mJumpTableBody[i] = new_addr;
+  }
+
+  // addr_map は単調増加なので並び順は変わらない．
+  for (ymuint i = 0; i < mStackMapNum; ++ i) {
+    Ymsl_INT new_addr = addr_map[mStackMapAddr[i]];
+    if ( new_addr == -1 ) {
+      ok = false;
+      new_addr = 0;
+    }
+    mStackMapAddr[i] = new_addr;
+  }
+
+  mSize = code.size();
+  mCode = new Ymsl_CODE[mSize];
+  for (ymuint i = 0; i < mSize; ++ i) {
+    mCode[i] = code[i];
+  }
+
+  return ok;
+}
+
+// @brief 保存用の形の配置を求める．
+// @param[out] addr_map 実行用の形のアドレスから保存用の形のアドレスへの対応表
+// @param[out] size_list 語ごとの保存用の形のバイト数
+// @return 保存用の形のバイト数を返す．
+//
+// ジャンプ先のアドレスのバイト数は飛び先の位置で決まり，
+// 飛び先の位置はその前の命令のバイト数で決まるので，
+// アドレスを1バイトと仮定して配置してから，足りないものを
+// 広げて配置し直すことを変化がなくなるまで繰り返す．
+// バイト数は増える方向にしか変わらないので必ず止まる．
+ymuint
+VsmCodeList::layout(vector<Ymsl_INT>& addr_map,
+		    vector<ymuint>& size_list) const
+{
+  // 命令は1バイト．ジャンプ先のアドレス以外のオペランドの
+  // バイト数は値だけで決まる．
+  size_list.clear();
+  size_list.resize(mSize, 1);
+  // ジャンプ先のアドレスのオペランドの位置
+  vector<ymuint> addr_pos_list;
+  for (ymuint addr = 0; addr < mSize; ) {
+    Ymsl_CODE op = mCode[addr];
+    ++ addr;
+    for (const char* p = mFormatFunc(op); *p; ++ p) {
+      if ( *p == 'a' ) {
+	addr_pos_list.push_back(addr);
+      }
+      else {
+	size_list[addr] = int_size(static_cast<Ymsl_INT>(mCode[addr]));
+      }
+      ++ addr;
+    }
+  }
+
+  addr_map.clear();
+  addr_map.resize(mSize + 1, 0);
+  for ( ; ; ) {
+    ymuint pos = 0;
+    for (ymuint addr = 0; addr < mSize; ++ addr) {
+      addr_map[addr] = pos;
+      pos += size_list[addr];
+    }
+    addr_map[mSize] = pos;
+
+    bool changed = false;
+    for (ymuint i = 0; i < addr_pos_list.size(); ++ i) {
+      ymuint addr = addr_pos_list[i];
+      ymuint n = int_size(addr_map[mCode[addr]]);
+      if ( n > size_list[addr] ) {
+	size_list[addr] = n;
+	changed = true;
+      }
+    }
+    if ( !changed ) {
+      return pos;
+    }
+  }
+}
+
+// @brief 実行用の形を保存用の形に詰める．
+// @param[out] body 保存用の形
+// @param[out] addr_map 実行用の形のアドレスから保存用の形のアドレスへの対応表
+void
+VsmCodeList::encode(vector<ymuint8>& body,
+		    vector<Ymsl_INT>& addr_map) const
+{
+  vector<ymuint> size_list;
+  ymuint byte_size = layout(addr_map, size_list);
+
+  // アドレスは短く書ける場合でも配置の時に決めたバイト数で書く．
+  body.clear();
+  body.resize(byte_size);
+  for (ymuint addr = 0; addr < mSize; ) {
+    Ymsl_CODE op = mCode[addr];
+    body[addr_map[addr]] = static_cast<ymuint8>(op);
+    ++ addr;
+    for (const char* p = mFormatFunc(op); *p; ++ p) {
+      Ymsl_INT val = static_cast<Ymsl_INT>(mCode[addr]);
+      if ( *p == 'a' ) {
+	val = addr_map[val];
+      }
+      put_int(&body[addr_map[addr]], val, size_list[addr]);
+      ++ addr;
+    }
+  }
+}
+
+// @brief スタックマップを探す．
+// @param[in] addr 安全点の命令の直後のアドレス
+// @return スタックマップの番号を返す．
+Ymsl_INT
+VsmCodeList::find_stack_map(Ymsl_INT addr) const
+{
+  ymuint lo = 0;
+  ymuint hi = mStackMapNum;
+  while ( lo < hi ) {
+    ymuint mid = (lo + hi) / 2;
+    if ( mStackMapAddr[mid] < addr ) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  if ( lo < mStackMapNum && mStackMapAddr[lo] == addr ) {
+    return lo;
+  }
+  return -1;
+}
+
+// @brief 命令のオペランドを読み飛ばす．
+// @param[in] op 命令
+// @param[inout] addr オペランドの先頭のアドレス
+void
+VsmCodeList::skip_operands(Ymsl_CODE op,
+			   Ymsl_INT& addr) const
+{
+  // どの種類のオペランドも1語
+  addr += strlen(mFormatFunc(op));
 }
 
+// @brief 内容をバイナリ形式で書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+void
+VsmCodeList::dump(VsmBinWriter& writer) const
+{
+  // アドレスは保存用の形のものに戻して書く．
+  vector<ymuint8> body;
+  vector<Ymsl_INT> addr_map;
+  encode(body, addr_map);
+  ASSERT_COND( body.size() == mByteSize );
+
+  writer.write_32(mByteSize);
+  if ( mByteSize > 0 ) {
+    writer.write_block(&body[0], mByteSize);
+  }
+
+  writer.write_32(mFloatNum);
+  for (ymuint i = 0; i < mFloatNum; ++ i) {
+    writer.write_float(mFloatPool[i]);
+  }
+
+  writer.write_32(mJumpTableNum);
+  for (ymuint i = 0; i < mJumpTableNum; ++ i) {
+    writer.write_32(mJumpTableStart[i + 1] - mJumpTableStart[i]);
+  }
+  ymuint table_size = mJumpTableStart[mJumpTableNum];
+  for (ymuint i = 0; i < table_size; ++ i) {
+    writer.write_32(static_cast<ymint32>(addr_map[mJumpTableBody[i]]));
+  }
+
+  writer.write_32(mStackMapNum);
+  for (ymuint i = 0; i < mStackMapNum; ++ i) {
+    writer.write_32(static_cast<ymint32>(addr_map[mStackMapAddr[i]]));
+    writer.write_32(mStackMapStart[i + 1] - mStackMapStart[i]);
+  }
+  ymuint map_size = mStackMapStart[mStackMapNum];
+  for (ymuint i = 0; i < map_size; ++ i) {
+    writer.write_32(static_cast<ymint32>(mStackMapBody[i]));
+  }
+}
 
 END_NAMESPACE_YM_YMSL
@@ -0,0 +1,178 @@
+
+/// @file VsmConstPool.cc
+/// @brief VsmConstPool の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmConstPool.h"
+#include "YmslObj.h"
+
+#include <cstring>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmConstPool::Builder
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+VsmConstPool::Builder::Builder()
+{
+}
+
+// @brief デストラクタ
+VsmConstPool::Builder::~Builder()
+{
+}
+
+// @brief INT の定数を追加する．
+// @param[in] val 値
+// @return 定数番号を返す．
+//
+// 同じ値が登録済みの場合はその番号を返す．
+Ymsl_INT
+VsmConstPool::Builder::add_int(Ymsl_INT val)
+{
+  Ymsl_INT index;
+  if ( mIntDict.find(val, index) ) {
+    return index;
+  }
+
+  VsmValue value;
+  value.int_value = val;
+  index = add(kIntType, value);
+  mIntDict.add(val, index);
+  return index;
+}
+
+// @brief FLOAT の定数を追加する．
+// @param[in] val 値
+// @return 定数番号を返す．
+//
+// 同じ値が登録済みの場合はその番号を返す．
+// 0.0 と -0.0 は区別する．
+Ymsl_INT
+VsmConstPool::Builder::add_float(Ymsl_FLOAT val)
+{
+  VsmFloatKey key;
+  ASSERT_COND( sizeof(key.mBits) == sizeof(Ymsl_FLOAT) );
+  memcpy(&key.mBits, &val, sizeof(Ymsl_FLOAT));
+
+  Ymsl_INT index;
+  if ( mFloatDict.find(key, index) ) {
+    return index;
+  }
+
+  VsmValue value;
+  value.float_value = val;
+  index = add(kFloatType, value);
+  mFloatDict.add(key, index);
+  return index;
+}
+
+// @brief STRING の定数を追加する．
+// @param[in] val 値
+// @return 定数番号を返す．
+//
+// 同じ値が登録済みの場合はその番号を返す．
+Ymsl_INT
+VsmConstPool::Builder::add_string(ShString val)
+{
+  Ymsl_INT index;
+  if ( mStringDict.find(val, index) ) {
+    return index;
+  }
+
+  // ShString の実体はプログラムの終了まで残るのでそのまま指す．
+  VsmValue value;
+  value.str_value = val;
+  index = add(kStringType, value);
+  mStringDict.add(val, index);
+  return index;
+}
+
+// @brief 定数の数を返す．
+Ymsl_INT
+VsmConstPool::Builder::size() const
+{
+  return mValueList.size();
+}
+
+// @brief 定数の型を返す．
+// @param[in] index 定数番号 ( 0 <= index < size() )
+TypeId
+VsmConstPool::Builder::type(Ymsl_INT index) const
+{
+  ASSERT_COND( index >= 0 && index < size() );
+  return mTypeList[index];
+}
+
+// @brief 定数の値を返す．
+// @param[in] index 定数番号 ( 0 <= index < size() )
+VsmValue
+VsmConstPool::Builder::value(Ymsl_INT index) const
+{
+  ASSERT_COND( index >= 0 && index < size() );
+  return mValueList[index];
+}
+
+// @brief 定数を追加する．
+// @param[in] type 型
+// @param[in] val 値
+// @return 定数番号を返す．
+Ymsl_INT
+VsmConstPool::Builder::add(TypeId type,
+			   VsmValue val)
+{
+  Ymsl_INT index = mValueList.size();
+  mTypeList.push_back(type);
+  mValueList.push_back(val);
+  return index;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmConstPool
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] builder 初期化用オブジェクト
+VsmConstPool::VsmConstPool(const Builder& builder)
+{
+  mSize = builder.size();
+  mTypeTable = new TypeId[mSize];
+  mValueTable = new VsmValue[mSize];
+  for (ymuint i = 0; i < mSize; ++ i) {
+    TypeId type = builder.type(i);
+    VsmValue val = builder.value(i);
+    if ( type == kStringType ) {
+      // 実行時の文字列は YmslString で表す．
+      YmslString* obj = YmslString::new_obj(val.str_value, strlen(val.str_value));
+      // 作った後は複数の Vsm から共有されて書き換えられないので，
+      // ハッシュ値はここで求めて覚えさせておく．
+      obj->hash();
+      obj->set_static();
+      val.obj_value = obj;
+    }
+    mTypeTable[i] = type;
+    mValueTable[i] = val;
+  }
+}
+
+// @brief デストラクタ
+VsmConstPool::~VsmConstPool()
+{
+  for (ymuint i = 0; i < mSize; ++ i) {
+    if ( mTypeTable[i] == kStringType ) {
+      YmslObj::destroy(mValueTable[i].obj_value);
+    }
+  }
+  delete [] mTypeTable;
+  delete [] mValueTable;
+}
+
+END_NAMESPACE_YM_YMSL
@@ -8,6 +8,7 @@
 
 
 #include "VsmFunction.h"
+#include "Type.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -24,6 +25,8 @@ VsmFunction::VsmFunction(ShString name,
   mName(name),
   mType(type)
 {
+  mArgNum = type->function_input_num();
+  mHasReturnValue = (type->function_output_type()->type_id() != kVoidType);
 }
 
 // @brief デストラクタ
@@ -45,4 +48,49 @@ VsmFunction::type() const
   return mType;
 }
 
+// @brief 引数の数を返す．
+ymuint
+VsmFunction::arg_num() const
+{
+  return mArgNum;
+}
+
+// @brief 返り値を持つ時 true を返す．
+bool
+VsmFunction::has_return_value() const
+{
+  return mHasReturnValue;
+}
+
+// @brief Vsm の命令ループの中で実行するコードを返す．
+// @param[in] vsm 仮想マシン
+const VsmCodeList*
+VsmFunction::frame_code(Vsm& vsm) const
+{
+  return NULL;
+}
+
+// @brief レジスタ型のコードを返す．
+const VsmRegCodeList*
+VsmFunction::reg_code() const
+{
+  return NULL;
+}
+
+// @brief 呼び出し時に必要なフレームの大きさを返す．
+Ymsl_INT
+VsmFunction::frame_size() const
+{
+  return 0;
+}
+
+// @brief 実行用の情報をバイナリ形式で書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+// @return 書き出せなかった場合は false を返す．
+bool
+VsmFunction::dump(VsmBinWriter& writer) const
+{
+  return false;
+}
+
 END_NAMESPACE_YM_YMSL
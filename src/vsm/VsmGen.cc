@@ -14,17 +14,556 @@
 #include "IrNode.h"
 #include "VsmNativeFunc.h"
 #include "VsmNativeModule.h"
+#include "VsmPeephole.h"
+#include "VsmRegFunc.h"
+#include "VsmRegModule.h"
 #include "VsmVar.h"
+#include "Vsm.h"
+#include "Type.h"
+#include "YmslMutex.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <cmath>
 
 
 BEGIN_NAMESPACE_YM_YMSL
 
+BEGIN_NONAMESPACE
+
+// 値の格納クラス
+enum ValClass {
+  kClassVoid,
+  kClassInt,
+  kClassFloat,
+  kClassObj
+};
+
+// 型から値の格納クラスを求める．
+ValClass
+val_class(TypeId type_id)
+{
+  switch ( type_id ) {
+  case kVoidType:
+    return kClassVoid;
+
+  case kBooleanType:
+  case kIntType:
+  case kEnumType:
+    return kClassInt;
+
+  case kFloatType:
+    return kClassFloat;
+
+  default:
+    break;
+  }
+  return kClassObj;
+}
+
+// ごみ集めの安全点になる命令の時 true を返す．
+//
+// オブジェクトを作る命令ではその直前でごみ集めを行うことがある．
+// 関数呼び出し命令では呼ばれた側の実行中に呼び出し元のフレームを
+// 調べるのに用いる．
+bool
+is_safepoint(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_OBJ_ADD:
+  case VSM_OBJ_SUB:
+  case VSM_OBJ_AND:
+  case VSM_OBJ_OR:
+  case VSM_OBJ_XOR:
+  case VSM_CALL:
+  case VSM_CALL_EXT:
+  case VSM_TAIL_CALL:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// レジスタ型のコードでごみ集めの安全点になる命令の時 true を返す．
+//
+// 後ろ向きの VSM_REG_JUMP は飛び先で判断する．
+bool
+is_reg_safepoint(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_REG_OBJ_ADD:
+  case VSM_REG_OBJ_SUB:
+  case VSM_REG_OBJ_AND:
+  case VSM_REG_OBJ_OR:
+  case VSM_REG_OBJ_XOR:
+  case VSM_REG_CALL:
+  case VSM_REG_CALL_EXT:
+  case VSM_REG_TAIL_CALL:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// 命令がスタックから取り出す値と積む値の格納クラスを表す文字列を返す．
+//
+// ':' の前がスタックの上から順に取り出す値，後ろが積む値で，
+// 'i' が INT，'f' が FLOAT，'o' が OBJ，'*' が任意の格納クラスを表す．
+// オペランドによって変わる命令の場合は NULL を返す．
+const char*
+stack_signature(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_NOP:
+  case VSM_JUMP:
+  case VSM_RETURN_VOID:
+  case VSM_HALT:
+    return ":";
+
+  case VSM_PUSH_INT_IMM:
+  case VSM_LOAD_GLOBAL_INT:
+  case VSM_LOAD_EXT_GLOBAL_INT:
+  case VSM_LOAD_LOCAL_INT:
+    return ":i";
+
+  case VSM_PUSH_FLOAT_IMM:
+  case VSM_PUSH_FLOAT_ZERO:
+  case VSM_PUSH_FLOAT_ONE:
+  case VSM_LOAD_GLOBAL_FLOAT:
+  case VSM_LOAD_EXT_GLOBAL_FLOAT:
+  case VSM_LOAD_LOCAL_FLOAT:
+    return ":f";
+
+  case VSM_PUSH_OBJ_NULL:
+  case VSM_LOAD_GLOBAL_OBJ:
+  case VSM_LOAD_EXT_GLOBAL_OBJ:
+  case VSM_LOAD_LOCAL_OBJ:
+    return ":o";
+
+  case VSM_POP:
+    return "*:";
+
+  case VSM_STORE_GLOBAL_INT:
+  case VSM_STORE_EXT_GLOBAL_INT:
+  case VSM_STORE_LOCAL_INT:
+  case VSM_BRANCH_TRUE:
+  case VSM_BRANCH_FALSE:
+  case VSM_JUMP_TABLE:
+    return "i:";
+
+  case VSM_STORE_GLOBAL_FLOAT:
+  case VSM_STORE_EXT_GLOBAL_FLOAT:
+  case VSM_STORE_LOCAL_FLOAT:
+    return "f:";
+
+  case VSM_STORE_GLOBAL_OBJ:
+  case VSM_STORE_EXT_GLOBAL_OBJ:
+  case VSM_STORE_LOCAL_OBJ:
+    return "o:";
+
+  case VSM_INT_MINUS:
+  case VSM_INT_INC:
+  case VSM_INT_DEC:
+  case VSM_INT_NOT:
+  case VSM_INT_TO_BOOL:
+    return "i:i";
+
+  case VSM_INT_TO_FLOAT:
+    return "i:f";
+
+  case VSM_INT_ADD:
+  case VSM_INT_SUB:
+  case VSM_INT_MUL:
+  case VSM_INT_DIV:
+  case VSM_INT_MOD:
+  case VSM_INT_LSHIFT:
+  case VSM_INT_RSHIFT:
+  case VSM_INT_EQ:
+  case VSM_INT_NE:
+  case VSM_INT_LT:
+  case VSM_INT_LE:
+  case VSM_INT_AND:
+  case VSM_INT_OR:
+  case VSM_INT_XOR:
+    return "ii:i";
+
+  case VSM_INT_ITE:
+    return "iii:i";
+
+  case VSM_FLOAT_MINUS:
+    return "f:f";
+
+  case VSM_FLOAT_TO_BOOL:
+  case VSM_FLOAT_TO_INT:
+    return "f:i";
+
+  case VSM_FLOAT_ADD:
+  case VSM_FLOAT_SUB:
+  case VSM_FLOAT_MUL:
+  case VSM_FLOAT_DIV:
+    return "ff:f";
+
+  case VSM_FLOAT_EQ:
+  case VSM_FLOAT_NE:
+  case VSM_FLOAT_LT:
+  case VSM_FLOAT_LE:
+    return "ff:i";
+
+  case VSM_FLOAT_ITE:
+    return "iff:f";
+
+  case VSM_OBJ_MINUS:
+  case VSM_OBJ_INC:
+  case VSM_OBJ_DEC:
+  case VSM_OBJ_NOT:
+    return "o:o";
+
+  case VSM_OBJ_TO_INT:
+    return "o:i";
+
+  case VSM_OBJ_TO_FLOAT:
+    return "o:f";
+
+  case VSM_OBJ_ADD:
+  case VSM_OBJ_SUB:
+  case VSM_OBJ_MUL:
+  case VSM_OBJ_DIV:
+  case VSM_OBJ_MOD:
+  case VSM_OBJ_AND:
+  case VSM_OBJ_OR:
+  case VSM_OBJ_XOR:
+    return "oo:o";
+
+  case VSM_OBJ_LSHIFT:
+  case VSM_OBJ_RSHIFT:
+    // シフト量は INT
+    return "oi:o";
+
+  case VSM_OBJ_EQ:
+  case VSM_OBJ_NE:
+  case VSM_OBJ_LT:
+  case VSM_OBJ_LE:
+    return "oo:i";
+
+  case VSM_OBJ_ITE:
+    return "ioo:o";
+
+  default:
+    break;
+  }
+  return NULL;
+}
+
+// stack_signature() の文字を格納クラスに変換する．
+// 任意の格納クラスは kClassVoid で表す．
+ValClass
+sig_class(char c)
+{
+  switch ( c ) {
+  case 'i': return kClassInt;
+  case 'f': return kClassFloat;
+  case 'o': return kClassObj;
+  default: break;
+  }
+  return kClassVoid;
+}
+
+// 型に応じた命令を選ぶ．
+// 該当する命令がない場合には VSM_NOP を返す．
+Ymsl_CODE
+select_op(TypeId type_id,
+	  Ymsl_CODE int_op,
+	  Ymsl_CODE float_op,
+	  Ymsl_CODE obj_op)
+{
+  switch ( val_class(type_id) ) {
+  case kClassInt:   return int_op;
+  case kClassFloat: return float_op;
+  case kClassObj:   return obj_op;
+  default: break;
+  }
+  return VSM_NOP;
+}
+
+// 式の型を返す．
+TypeId
+expr_type_id(IrNode* node)
+{
+  if ( node->node_type() == IrNode::kFuncCall ) {
+    // IrFuncCall は型を持たないので関数の型から求める．
+    const Type* ftype = node->function_address()->value_type();
+    return ftype->function_output_type()->type_id();
+  }
+  return node->value_type()->type_id();
+}
+
+// 比較演算のオペランドの型を求める．
+TypeId
+cmp_type_id(IrNode* node)
+{
+  TypeId id0 = expr_type_id(node->operand(0));
+  TypeId id1 = expr_type_id(node->operand(1));
+  ValClass c0 = val_class(id0);
+  ValClass c1 = val_class(id1);
+  if ( c0 == kClassObj || c1 == kClassObj ) {
+    return id0;
+  }
+  if ( c0 == kClassFloat || c1 == kClassFloat ) {
+    return kFloatType;
+  }
+  return kIntType;
+}
+
+// 副作用がなく，実行が止まることもない式の時 true を返す．
+//
+// ITE の両方の値を先に求めてから選んでよいかの判定に用いる．
+// 関数呼び出しとオブジェクトを作る演算(ごみ集めの安全点)，
+// 0 や -1 で割る可能性のある INT の除算は含まない．
+bool
+is_safe_expr(IrNode* node)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kLoad:
+    switch ( node->address()->handle_type() ) {
+    case IrHandle::kBooleanConst:
+    case IrHandle::kIntConst:
+    case IrHandle::kFloatConst:
+    case IrHandle::kStringConst:
+    case IrHandle::kLocalVar:
+    case IrHandle::kGlobalVar:
+      return true;
+
+    default:
+      break;
+    }
+    return false;
+
+  case IrNode::kUniOp:
+    if ( val_class(node->value_type()->type_id()) == kClassObj ) {
+      return false;
+    }
+    return is_safe_expr(node->operand(0));
+
+  case IrNode::kBinOp:
+    if ( val_class(node->value_type()->type_id()) == kClassObj ) {
+      return false;
+    }
+    if ( (node->opcode() == kOpDiv || node->opcode() == kOpMod) &&
+	 node->value_type()->type_id() != kFloatType ) {
+      IrNode* divisor = node->operand(1);
+      if ( divisor->node_type() != IrNode::kLoad ||
+	   divisor->address()->handle_type() != IrHandle::kIntConst ) {
+	return false;
+      }
+      Ymsl_INT val = divisor->address()->int_val();
+      if ( val == 0 || val == -1 ) {
+	return false;
+      }
+    }
+    return is_safe_expr(node->operand(0)) && is_safe_expr(node->operand(1));
+
+  case IrNode::kTriOp:
+    return is_safe_expr(node->operand(0)) && is_safe_expr(node->operand(1)) &&
+      is_safe_expr(node->operand(2));
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// 二項演算の命令を求める．
+Ymsl_CODE
+binop_code(OpCode opcode,
+	   TypeId type_id)
+{
+  switch ( opcode ) {
+  case kOpBitAnd: return select_op(type_id, VSM_INT_AND,    VSM_NOP,       VSM_OBJ_AND);
+  case kOpBitOr:  return select_op(type_id, VSM_INT_OR,     VSM_NOP,       VSM_OBJ_OR);
+  case kOpBitXor: return select_op(type_id, VSM_INT_XOR,    VSM_NOP,       VSM_OBJ_XOR);
+  case kOpAdd:    return select_op(type_id, VSM_INT_ADD,    VSM_FLOAT_ADD, VSM_OBJ_ADD);
+  case kOpSub:    return select_op(type_id, VSM_INT_SUB,    VSM_FLOAT_SUB, VSM_OBJ_SUB);
+  case kOpMul:    return select_op(type_id, VSM_INT_MUL,    VSM_FLOAT_MUL, VSM_OBJ_MUL);
+  case kOpDiv:    return select_op(type_id, VSM_INT_DIV,    VSM_FLOAT_DIV, VSM_OBJ_DIV);
+  case kOpMod:    return select_op(type_id, VSM_INT_MOD,    VSM_NOP,       VSM_OBJ_MOD);
+  case kOpLshift: return select_op(type_id, VSM_INT_LSHIFT, VSM_NOP,       VSM_OBJ_LSHIFT);
+  case kOpRshift: return select_op(type_id, VSM_INT_RSHIFT, VSM_NOP,       VSM_OBJ_RSHIFT);
+  case kOpEqual:  return select_op(type_id, VSM_INT_EQ,     VSM_FLOAT_EQ,  VSM_OBJ_EQ);
+  case kOpNotEq:  return select_op(type_id, VSM_INT_NE,     VSM_FLOAT_NE,  VSM_OBJ_NE);
+  case kOpLt:     return select_op(type_id, VSM_INT_LT,     VSM_FLOAT_LT,  VSM_OBJ_LT);
+  case kOpLe:     return select_op(type_id, VSM_INT_LE,     VSM_FLOAT_LE,  VSM_OBJ_LE);
+  default: break;
+  }
+  return VSM_NOP;
+}
+
+// 二項演算のレジスタ型の命令を求める．
+Ymsl_CODE
+reg_binop_code(OpCode opcode,
+	       TypeId type_id)
+{
+  switch ( opcode ) {
+  case kOpBitAnd: return select_op(type_id, VSM_REG_INT_AND,    VSM_REG_NOP,       VSM_REG_OBJ_AND);
+  case kOpBitOr:  return select_op(type_id, VSM_REG_INT_OR,     VSM_REG_NOP,       VSM_REG_OBJ_OR);
+  case kOpBitXor: return select_op(type_id, VSM_REG_INT_XOR,    VSM_REG_NOP,       VSM_REG_OBJ_XOR);
+  case kOpAdd:    return select_op(type_id, VSM_REG_INT_ADD,    VSM_REG_FLOAT_ADD, VSM_REG_OBJ_ADD);
+  case kOpSub:    return select_op(type_id, VSM_REG_INT_SUB,    VSM_REG_FLOAT_SUB, VSM_REG_OBJ_SUB);
+  case kOpMul:    return select_op(type_id, VSM_REG_INT_MUL,    VSM_REG_FLOAT_MUL, VSM_REG_OBJ_MUL);
+  case kOpDiv:    return select_op(type_id, VSM_REG_INT_DIV,    VSM_REG_FLOAT_DIV, VSM_REG_OBJ_DIV);
+  case kOpMod:    return select_op(type_id, VSM_REG_INT_MOD,    VSM_REG_NOP,       VSM_REG_OBJ_MOD);
+  case kOpLshift: return select_op(type_id, VSM_REG_INT_LSHIFT, VSM_REG_NOP,       VSM_REG_OBJ_LSHIFT);
+  case kOpRshift: return select_op(type_id, VSM_REG_INT_RSHIFT, VSM_REG_NOP,       VSM_REG_OBJ_RSHIFT);
+  case kOpEqual:  return select_op(type_id, VSM_REG_INT_EQ,     VSM_REG_FLOAT_EQ,  VSM_REG_OBJ_EQ);
+  case kOpNotEq:  return select_op(type_id, VSM_REG_INT_NE,     VSM_REG_FLOAT_NE,  VSM_REG_OBJ_NE);
+  case kOpLt:     return select_op(type_id, VSM_REG_INT_LT,     VSM_REG_FLOAT_LT,  VSM_REG_OBJ_LT);
+  case kOpLe:     return select_op(type_id, VSM_REG_INT_LE,     VSM_REG_FLOAT_LE,  VSM_REG_OBJ_LE);
+  default: break;
+  }
+  return VSM_REG_NOP;
+}
+
+// 型変換のレジスタ型の命令を求める．
+// 最大2つの命令が必要となる．不要な場合には VSM_REG_NOP を返す．
+void
+reg_cast_code(TypeId src_id,
+	      TypeId dst_id,
+	      Ymsl_CODE& op1,
+	      Ymsl_CODE& op2)
+{
+  op1 = VSM_REG_NOP;
+  op2 = VSM_REG_NOP;
+  if ( src_id == dst_id ) {
+    return;
+  }
+
+  ValClass src_class = val_class(src_id);
+  switch ( val_class(dst_id) ) {
+  case kClassInt:
+    if ( dst_id == kBooleanType ) {
+      switch ( src_class ) {
+      case kClassInt:   op1 = VSM_REG_INT_TO_BOOL; break;
+      case kClassFloat: op1 = VSM_REG_FLOAT_TO_BOOL; break;
+      case kClassObj:   op1 = VSM_REG_OBJ_TO_INT; op2 = VSM_REG_INT_TO_BOOL; break;
+      default: ASSERT_NOT_REACHED; break;
+      }
+    }
+    else {
+      switch ( src_class ) {
+      case kClassInt:   break;
+      case kClassFloat: op1 = VSM_REG_FLOAT_TO_INT; break;
+      case kClassObj:   op1 = VSM_REG_OBJ_TO_INT; break;
+      default: ASSERT_NOT_REACHED; break;
+      }
+    }
+    break;
+
+  case kClassFloat:
+    switch ( src_class ) {
+    case kClassInt:   op1 = VSM_REG_INT_TO_FLOAT; break;
+    case kClassFloat: break;
+    case kClassObj:   op1 = VSM_REG_OBJ_TO_FLOAT; break;
+    default: ASSERT_NOT_REACHED; break;
+    }
+    break;
+
+  case kClassObj:
+    // プリミティブ型からオブジェクトへの変換はない．
+    ASSERT_COND( src_class == kClassObj );
+    break;
+
+  case kClassVoid:
+    break;
+  }
+}
+
+// ジャンプテーブルを使う最小のケース数
+const ymuint kMinTableCase = 4;
+
+// 一つずつ比較する最大のケース数
+const ymuint kMaxLinearCase = 3;
+
+// switch 文のケースの範囲 [begin, end) をジャンプテーブルにする時 true を返す．
+// テーブルの半分以上が埋まる場合に用いる．
+bool
+use_jump_table(IrNode* node,
+	       ymuint begin,
+	       ymuint end)
+{
+  ymuint n = end - begin;
+  if ( n < kMinTableCase ) {
+    return false;
+  }
+  // 値は昇順に並んでいる．
+  // 差は符号なしで計算してオーバーフローを避ける．
+  ymuint32 span = static_cast<ymuint32>(node->case_val(end - 1))
+    - static_cast<ymuint32>(node->case_val(begin));
+  return span < n * 2;
+}
+
+// switch 文のケースの範囲 [begin, end) を二つに分ける位置を求める．
+// 真ん中付近で値の間隔が最も大きいところで分けて，
+// 密な部分がジャンプテーブルにまとまるようにする．
+ymuint
+split_pos(IrNode* node,
+	  ymuint begin,
+	  ymuint end)
+{
+  ymuint n = end - begin;
+  ymuint mid = begin + n / 2;
+  ymuint lo = begin + n / 4;
+  ymuint hi = end - n / 4;
+  if ( lo == begin ) {
+    lo = begin + 1;
+  }
+  ymuint best = mid;
+  ymuint32 best_gap = 0;
+  ymuint best_dist = n;
+  for (ymuint pos = lo; pos < hi; ++ pos) {
+    ymuint32 gap = static_cast<ymuint32>(node->case_val(pos))
+      - static_cast<ymuint32>(node->case_val(pos - 1));
+    ymuint dist = (pos < mid) ? mid - pos : pos - mid;
+    if ( gap > best_gap || (gap == best_gap && dist < best_dist) ) {
+      best = pos;
+      best_gap = gap;
+      best_dist = dist;
+    }
+  }
+  return best;
+}
+
+// switch 文が選択値を格納する作業用の変数を必要とする時 true を返す．
+bool
+need_switch_var(IrNode* node)
+{
+  ymuint n = node->case_num();
+  if ( n == 0 || use_jump_table(node, 0, n) ) {
+    // 選択値は一度しか読まない．
+    return false;
+  }
+  IrNode* cond = node->branch_cond();
+  if ( cond->node_type() == IrNode::kLoad &&
+       cond->address()->handle_type() == IrHandle::kLocalVar ) {
+    // ローカル変数をそのまま読む．
+    return false;
+  }
+  return true;
+}
+
+END_NONAMESPACE
+
 //////////////////////////////////////////////////////////////////////
 // クラス VsmGen
 //////////////////////////////////////////////////////////////////////
 
 // @brief コンストラクタ
-VsmGen::VsmGen()
+// @param[in] reg_mode レジスタ型のコードを生成する時 true にする．
+VsmGen::VsmGen(bool reg_mode) :
+  mRegMode(reg_mode),
+  mSwitchVar(-1),
+  mConstPool(NULL)
 {
 }
 
@@ -40,12 +579,35 @@ VsmModule*
 VsmGen::code_gen(const IrToplevel* toplevel,
 		 ShString name)
 {
+  VsmModule::Builder module_builder(name);
+  mConstPool = &module_builder.const_pool();
+
   VsmCodeList::Builder toplevel_builder;
+  VsmRegCodeList::Builder toplevel_reg_builder;
+  ymuint toplevel_frame_size = 0;
+  bool error = false;
 
-  // トップレベルのコードを作る．
-  gen_block(toplevel, toplevel_builder);
+  // グローバル変数の型を記録しておく．
+  const vector<IrHandle*>& gvar_list = toplevel->global_var_list();
+  mGlobalType.clear();
+  for (vector<IrHandle*>::const_iterator p = gvar_list.begin();
+       p != gvar_list.end(); ++ p) {
+    IrHandle* vh = *p;
+    ASSERT_COND( vh->local_index() == mGlobalType.size() );
+    mGlobalType.push_back(vh->value_type()->type_id());
+  }
 
-  VsmModule::Builder module_builder(name);
+  // トップレベルのコードを作る．
+  if ( mRegMode ) {
+    gen_reg_block(toplevel, 0, VSM_REG_HALT, toplevel_reg_builder);
+  }
+  else {
+    if ( !gen_block(toplevel, 0, kVoidType, VSM_HALT, toplevel_builder) ) {
+      put_gen_error("toplevel");
+      error = true;
+    }
+    toplevel_frame_size = mVarNum + mMaxStack;
+  }
 
   // import しているモジュール
   const vector<VsmModule*>& module_list = toplevel->imported_module_list();
@@ -56,7 +618,6 @@ VsmGen::code_gen(const IrToplevel* toplevel,
   }
 
   // グローバル変数を追加する．
-  const vector<IrHandle*>& gvar_list = toplevel->global_var_list();
   ymint nv = gvar_list.size();
   for (ymuint i = 0; i < nv; ++ i) {
     IrHandle* vh = gvar_list[i];
@@ -68,49 +629,2375 @@ VsmGen::code_gen(const IrToplevel* toplevel,
   const vector<IrFuncBlock*>& func_list = toplevel->func_list();
   ymuint nf = func_list.size();
   for (ymuint i = 0; i < nf; ++ i) {
-    VsmCodeList::Builder code_builder;
     IrFuncBlock* func_block = func_list[i];
-    gen_block(func_block, code_builder);
+    ymuint arg_num = func_block->arg_list().size();
     IrHandle* func_handle = func_block->func_handle();
     ShString name = func_handle->name();
     const Type* type = func_handle->value_type();
-    VsmFunction* func = new VsmNativeFunc(name, type, code_builder);
+    VsmFunction* func;
+    if ( mRegMode ) {
+      VsmRegCodeList::Builder code_builder;
+      gen_reg_block(func_block, arg_num, VSM_REG_RETURN_VOID, code_builder);
+      func = new VsmRegFunc(name, type, code_builder);
+    }
+    else {
+      VsmCodeList::Builder code_builder;
+      TypeId output_type = type->function_output_type()->type_id();
+      if ( !gen_block(func_block, arg_num, output_type, VSM_RETURN_VOID, code_builder) ) {
+	put_gen_error(name);
+	error = true;
+      }
+      func = new VsmNativeFunc(name, type, code_builder, mVarNum, mMaxStack);
+    }
     module_builder.add_function(func);
   }
 
-  VsmModule* module = new VsmNativeModule(module_builder, toplevel_builder);
+  VsmModule* module;
+  if ( mRegMode ) {
+    module = new VsmRegModule(module_builder, toplevel_reg_builder);
+  }
+  else {
+    module = new VsmNativeModule(module_builder, toplevel_builder,
+				 toplevel_frame_size);
+  }
+  mConstPool = NULL;
+
+  if ( error ) {
+    // 関数と変数はモジュールと一緒に削除される．
+    delete module;
+    return NULL;
+  }
   return module;
 }
 
-// @brief コードブロックに対するコード生成を行う．
+// @brief 生成したコードの誤りを出力する．
+// @param[in] name 関数名
+void
+VsmGen::put_gen_error(ShString name)
+{
+  ostringstream buf;
+  buf << name << ": operand class mismatch in generated code";
+  MsgMgr::put_msg(__FILE__, __LINE__,
+		  FileRegion(),
+		  kMsgError,
+		  "VSM",
+		  buf.str());
+}
+
+// @brief ラベルに番号をつける．
 // @param[in] code_block コードブロック
+void
+VsmGen::init_labels(const IrCodeBlock* code_block)
+{
+  mLabelAddr.clear();
+  mFixupList.clear();
+  mTableList.clear();
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    if ( node->node_type() == IrNode::kLabel ) {
+      node->set_id(new_label());
+    }
+  }
+}
+
+// @brief ジャンプ先のアドレスを埋める．
 // @param[in] builder CodeList ビルダー
 void
+VsmGen::fix_labels(VsmCodeList::Builder& builder)
+{
+  for (vector<pair<Ymsl_INT, ymuint> >::iterator p = mFixupList.begin();
+       p != mFixupList.end(); ++ p) {
+    Ymsl_INT pos = p->first;
+    Ymsl_INT addr = mLabelAddr[p->second];
+    ASSERT_COND( addr >= 0 );
+    builder.rewrite_int(pos, addr);
+  }
+
+  for (vector<Ymsl_INT>::iterator p = mTableList.begin();
+       p != mTableList.end(); ++ p) {
+    Ymsl_INT index = *p;
+    const vector<Ymsl_INT>& table = builder.jump_table(index);
+    for (ymuint i = 0; i < table.size(); ++ i) {
+      Ymsl_INT addr = mLabelAddr[table[i]];
+      ASSERT_COND( addr >= 0 );
+      builder.rewrite_jump_table(index, i, addr);
+    }
+  }
+}
+
+// @brief コードブロックに対するコード生成を行う．
+// @param[in] code_block コードブロック
+// @param[in] arg_num 引数の数
+// @param[in] output_type 返り値の型
+// @param[in] end_op 末尾に置く命令
+// @param[in] builder CodeList ビルダー
+// @return 生成したコードに誤りがあれば false を返す．
+bool
 VsmGen::gen_block(const IrCodeBlock* code_block,
+		  ymuint arg_num,
+		  TypeId output_type,
+		  Ymsl_CODE end_op,
 		  VsmCodeList::Builder& builder)
 {
+  init_labels(code_block);
+  mCallList.clear();
+
+  // switch 文の選択値を置く作業用の変数が要るか調べる．
   const vector<IrNode*>& node_list = code_block->node_list();
+  bool need_var = false;
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    if ( node->node_type() == IrNode::kSwitch && need_switch_var(node) ) {
+      need_var = true;
+      break;
+    }
+  }
+  assign_slots(code_block, arg_num, need_var);
+
+  // 引数以外のローカル変数の領域を確保して初期化する．
+  ymuint nv = mSlotType.size();
+  for (ymuint i = arg_num; i < nv; ++ i) {
+    switch ( val_class(mSlotType[i]) ) {
+    case kClassInt:
+      builder.write_opcode(VSM_PUSH_INT_IMM);
+      builder.write_int(0);
+      break;
+
+    case kClassFloat:
+      builder.write_opcode(VSM_PUSH_FLOAT_ZERO);
+      break;
+
+    default:
+      builder.write_opcode(VSM_PUSH_OBJ_NULL);
+      break;
+    }
+  }
+
   for (vector<IrNode*>::const_iterator p = node_list.begin();
        p != node_list.end(); ++ p) {
     IrNode* node = *p;
-    switch ( node->node_type() ) {
-    case IrNode::kUniOp:
-    case IrNode::kBinOp:
-    case IrNode::kTriOp:
-    case IrNode::kLoad:
-    case IrNode::kStore:
-    case IrNode::kInplaceUniOp:
-    case IrNode::kInplaceBinOp:
-    case IrNode::kFuncCall:
-    case IrNode::kReturn:
-    case IrNode::kJump:
-    case IrNode::kBranchTrue:
-    case IrNode::kBranchFalse:
-    case IrNode::kLabel:
-    case IrNode::kHalt:
+    gen_stmt(node, builder);
+  }
+  builder.write_opcode(end_op);
+
+  fix_labels(builder);
+
+  mVarNum = nv;
+  mMaxStack = calc_max_depth(builder, arg_num) - nv;
+  if ( mMaxStack < 0 ) {
+    mMaxStack = 0;
+  }
+
+  // ごみ集めの安全点ごとのスタックマップを作る．
+  // 同時に各命令の扱う値が格納クラスに合っているか確かめる．
+  if ( !gen_stack_map(builder, arg_num, output_type) ) {
+    return false;
+  }
+
+  // よく現れる命令列を融合した命令に置き換える．
+  VsmPeephole peephole;
+  peephole.optimize(builder);
+
+  return true;
+}
+
+// @brief ローカル変数にフレーム上のスロットを割り当てる．
+// @param[in] code_block コードブロック
+// @param[in] arg_num 引数の数
+// @param[in] need_switch_var switch 文の作業用の変数を確保する時 true
+//
+// 引数は呼び出し側が積んだ位置のまま用いる．それ以外の変数は
+// INT，FLOAT，OBJ の格納クラスの順に並べてプリミティブ型の値を
+// フレーム上で連続させる．switch 文の作業用の変数は INT の末尾に置く．
+void
+VsmGen::assign_slots(const IrCodeBlock* code_block,
+		     ymuint arg_num,
+		     bool need_switch_var)
+{
+  const vector<IrHandle*>& var_list = code_block->var_list();
+  ymuint nv = var_list.size();
+  mSlotMap.clear();
+  mSlotMap.resize(nv, -1);
+  mSlotType.clear();
+  mSwitchVar = -1;
+
+  for (ymuint i = 0; i < arg_num; ++ i) {
+    IrHandle* var = var_list[i];
+    ASSERT_COND( var->local_index() == i );
+    mSlotMap[i] = i;
+    mSlotType.push_back(var->value_type()->type_id());
+  }
+
+  const ValClass class_list[] = { kClassInt, kClassFloat, kClassObj };
+  for (ymuint c = 0; c < 3; ++ c) {
+    for (ymuint i = arg_num; i < nv; ++ i) {
+      IrHandle* var = var_list[i];
+      ASSERT_COND( var->local_index() == i );
+      TypeId type_id = var->value_type()->type_id();
+      if ( val_class(type_id) == class_list[c] ) {
+	mSlotMap[i] = mSlotType.size();
+	mSlotType.push_back(type_id);
+      }
+    }
+    if ( class_list[c] == kClassInt && need_switch_var ) {
+      mSwitchVar = mSlotType.size();
+      mSlotType.push_back(kIntType);
+    }
+  }
+}
+
+// @brief ローカル変数のスロット番号を返す．
+// @param[in] var 変数
+Ymsl_INT
+VsmGen::local_slot(IrHandle* var) const
+{
+  ymuint index = var->local_index();
+  ASSERT_COND( index < mSlotMap.size() );
+  return mSlotMap[index];
+}
+
+// @brief スタックの深さの最大値を求める．
+// @param[in] builder CodeList ビルダー
+// @param[in] arg_num 引数の数
+// @return フレームの先頭からの深さの最大値を返す．
+Ymsl_INT
+VsmGen::calc_max_depth(const VsmCodeList::Builder& builder,
+		       ymuint arg_num)
+{
+  Ymsl_INT size = builder.size();
+
+  // 関数呼び出し命令の位置をキーにした増減
+  vector<Ymsl_INT> call_delta(size, 0);
+  for (vector<CallInfo>::iterator p = mCallList.begin();
+       p != mCallList.end(); ++ p) {
+    Ymsl_INT delta = - p->mArgNum;
+    if ( p->mOutputType != kVoidType ) {
+      ++ delta;
+    }
+    call_delta[p->mPos] = delta;
+  }
+
+  // 各命令位置でのスタックの深さ
+  // 未到達の場合は -1
+  vector<Ymsl_INT> depth_array(size, -1);
+  vector<Ymsl_INT> queue;
+  depth_array[0] = arg_num;
+  queue.push_back(0);
+  Ymsl_INT max_depth = arg_num;
+  while ( !queue.empty() ) {
+    Ymsl_INT pc = queue.back();
+    queue.pop_back();
+
+    Ymsl_INT depth = depth_array[pc];
+    Ymsl_CODE op = builder.read_opcode(pc);
+    Ymsl_INT delta = 0;
+    Ymsl_INT target = -1;
+    Ymsl_INT table = -1;
+    bool fall_through = true;
+    switch ( op ) {
+    case VSM_PUSH_INT_IMM:
+    case VSM_PUSH_FLOAT_IMM:
+    case VSM_PUSH_FLOAT_ZERO:
+    case VSM_PUSH_FLOAT_ONE:
+    case VSM_PUSH_OBJ_NULL:
+    case VSM_PUSH_CONST:
+    case VSM_LOAD_GLOBAL_INT:
+    case VSM_LOAD_GLOBAL_FLOAT:
+    case VSM_LOAD_GLOBAL_OBJ:
+    case VSM_LOAD_EXT_GLOBAL_INT:
+    case VSM_LOAD_EXT_GLOBAL_FLOAT:
+    case VSM_LOAD_EXT_GLOBAL_OBJ:
+    case VSM_LOAD_LOCAL_INT:
+    case VSM_LOAD_LOCAL_FLOAT:
+    case VSM_LOAD_LOCAL_OBJ:
+      delta = 1;
+      break;
+
+    case VSM_POP:
+    case VSM_STORE_GLOBAL_INT:
+    case VSM_STORE_GLOBAL_FLOAT:
+    case VSM_STORE_GLOBAL_OBJ:
+    case VSM_STORE_EXT_GLOBAL_INT:
+    case VSM_STORE_EXT_GLOBAL_FLOAT:
+    case VSM_STORE_EXT_GLOBAL_OBJ:
+    case VSM_STORE_LOCAL_INT:
+    case VSM_STORE_LOCAL_FLOAT:
+    case VSM_STORE_LOCAL_OBJ:
+    case VSM_INT_ADD:
+    case VSM_INT_SUB:
+    case VSM_INT_MUL:
+    case VSM_INT_DIV:
+    case VSM_INT_MOD:
+    case VSM_INT_LSHIFT:
+    case VSM_INT_RSHIFT:
+    case VSM_INT_EQ:
+    case VSM_INT_NE:
+    case VSM_INT_LT:
+    case VSM_INT_LE:
+    case VSM_INT_AND:
+    case VSM_INT_OR:
+    case VSM_INT_XOR:
+    case VSM_FLOAT_ADD:
+    case VSM_FLOAT_SUB:
+    case VSM_FLOAT_MUL:
+    case VSM_FLOAT_DIV:
+    case VSM_FLOAT_EQ:
+    case VSM_FLOAT_NE:
+    case VSM_FLOAT_LT:
+    case VSM_FLOAT_LE:
+    case VSM_OBJ_ADD:
+    case VSM_OBJ_SUB:
+    case VSM_OBJ_MUL:
+    case VSM_OBJ_DIV:
+    case VSM_OBJ_MOD:
+    case VSM_OBJ_LSHIFT:
+    case VSM_OBJ_RSHIFT:
+    case VSM_OBJ_EQ:
+    case VSM_OBJ_NE:
+    case VSM_OBJ_LT:
+    case VSM_OBJ_LE:
+    case VSM_OBJ_AND:
+    case VSM_OBJ_OR:
+    case VSM_OBJ_XOR:
+      delta = -1;
+      break;
+
+    case VSM_INT_ITE:
+    case VSM_FLOAT_ITE:
+    case VSM_OBJ_ITE:
+      delta = -2;
+      break;
+
+    case VSM_JUMP:
+      target = builder.read_int(pc + 1);
+      fall_through = false;
+      break;
+
+    case VSM_BRANCH_TRUE:
+    case VSM_BRANCH_FALSE:
+      target = builder.read_int(pc + 1);
+      delta = -1;
+      break;
+
+    case VSM_JUMP_TABLE:
+      table = builder.read_int(pc + 2);
+      target = builder.read_int(pc + 3);
+      delta = -1;
+      fall_through = false;
+      break;
+
+    case VSM_CALL:
+    case VSM_CALL_EXT:
+      delta = call_delta[pc];
+      break;
+
+    case VSM_TAIL_CALL:
+    case VSM_RETURN:
+    case VSM_RETURN_VOID:
+    case VSM_HALT:
+      fall_through = false;
+      break;
+
+    case VSM_JUMP_R:
+    case VSM_CALL_R:
+      // 生成しない命令
+      ASSERT_NOT_REACHED;
       break;
+
+    default:
+      // 単項演算は深さが変わらない．
+      break;
+    }
+
+    Ymsl_INT depth1 = depth + delta;
+    if ( max_depth < depth1 ) {
+      max_depth = depth1;
+    }
+    if ( target >= 0 && depth_array[target] == -1 ) {
+      depth_array[target] = depth1;
+      queue.push_back(target);
+    }
+    if ( table >= 0 ) {
+      const vector<Ymsl_INT>& target_list = builder.jump_table(table);
+      for (vector<Ymsl_INT>::const_iterator p = target_list.begin();
+	   p != target_list.end(); ++ p) {
+	Ymsl_INT target1 = *p;
+	if ( depth_array[target1] == -1 ) {
+	  depth_array[target1] = depth1;
+	  queue.push_back(target1);
+	}
+      }
+    }
+    Ymsl_INT next = pc + Vsm::operand_size(op) + 1;
+    if ( fall_through && depth_array[next] == -1 ) {
+      depth_array[next] = depth1;
+      queue.push_back(next);
+    }
+  }
+
+  return max_depth;
+}
+
+// @brief ごみ集め用のスタックマップを作る．
+// @param[in] builder CodeList ビルダー
+// @param[in] arg_num 引数の数
+// @param[in] output_type 返り値の型
+// @return 命令の扱う値の格納クラスが合っていなければ false を返す．
+//
+// スタックマップには安全点の命令を実行する直前の値を記録する．
+// なので二項演算のオペランドや関数呼び出しの引数も含まれる．
+// 引数は呼ばれた関数のフレームにそのまま移るが，呼ばれた関数が
+// 組み込み関数や JIT コンパイルした関数の場合にはスタックマップを
+// 持たないので呼び出し元で面倒を見る．
+// 定数表の文字列は static なので OBJ として記録しても辿られない．
+bool
+VsmGen::gen_stack_map(VsmCodeList::Builder& builder,
+		      ymuint arg_num,
+		      TypeId output_type)
+{
+  Ymsl_INT size = builder.size();
+
+  // 関数呼び出し命令の位置をキーにした情報
+  vector<const CallInfo*> call_info(size, NULL);
+  for (vector<CallInfo>::iterator p = mCallList.begin();
+       p != mCallList.end(); ++ p) {
+    call_info[p->mPos] = &(*p);
+  }
+
+  // 各命令位置で積まれている値の格納クラスを表す配列
+  // フレームの先頭から並べる．
+  vector<vector<ValClass> > state_array(size);
+  // 到達済みの時 true
+  vector<bool> reached(size, false);
+  vector<Ymsl_INT> queue;
+  for (ymuint i = 0; i < arg_num; ++ i) {
+    state_array[0].push_back(val_class(mSlotType[i]));
+  }
+  reached[0] = true;
+  queue.push_back(0);
+  while ( !queue.empty() ) {
+    Ymsl_INT pc = queue.back();
+    queue.pop_back();
+
+    vector<ValClass> state1(state_array[pc]);
+    Ymsl_CODE op = builder.read_opcode(pc);
+    // スタックの上から順に取り出す値の格納クラス
+    // kClassVoid はどの格納クラスでもよいことを表す．
+    vector<ValClass> pop_list;
+    // 積む値の格納クラス
+    // 積まない時は kClassVoid
+    ValClass push_class = kClassVoid;
+    Ymsl_INT target = -1;
+    Ymsl_INT table = -1;
+    bool fall_through = true;
+    const char* sig = stack_signature(op);
+    if ( sig != NULL ) {
+      for ( ; *sig != ':'; ++ sig) {
+	pop_list.push_back(sig_class(*sig));
+      }
+      push_class = sig_class(*(sig + 1));
     }
+    switch ( op ) {
+    case VSM_LOAD_LOCAL_INT:
+    case VSM_LOAD_LOCAL_FLOAT:
+    case VSM_LOAD_LOCAL_OBJ:
+    case VSM_STORE_LOCAL_INT:
+    case VSM_STORE_LOCAL_FLOAT:
+    case VSM_STORE_LOCAL_OBJ:
+      {
+	// 変数の格納クラスも命令に合っていなければならない．
+	ValClass var_class = pop_list.empty() ? push_class : pop_list[0];
+	Ymsl_INT index = builder.read_int(pc + 1);
+	if ( index < 0 || index >= mVarNum ||
+	     index >= static_cast<Ymsl_INT>(state1.size()) ||
+	     state1[index] != var_class ) {
+	  return false;
+	}
+      }
+      break;
+
+    case VSM_LOAD_GLOBAL_INT:
+    case VSM_LOAD_GLOBAL_FLOAT:
+    case VSM_LOAD_GLOBAL_OBJ:
+    case VSM_STORE_GLOBAL_INT:
+    case VSM_STORE_GLOBAL_FLOAT:
+    case VSM_STORE_GLOBAL_OBJ:
+      {
+	ValClass var_class = pop_list.empty() ? push_class : pop_list[0];
+	ymuint index = builder.read_int(pc + 1);
+	// 他のモジュールの変数は VSM_XXX_EXT_GLOBAL_XXX で参照する．
+	if ( index >= mGlobalType.size() ||
+	     val_class(mGlobalType[index]) != var_class ) {
+	  return false;
+	}
+      }
+      break;
+
+    case VSM_PUSH_CONST:
+      push_class = val_class(mConstPool->type(builder.read_int(pc + 1)));
+      break;
+
+    case VSM_JUMP:
+      target = builder.read_int(pc + 1);
+      fall_through = false;
+      break;
+
+    case VSM_BRANCH_TRUE:
+    case VSM_BRANCH_FALSE:
+      target = builder.read_int(pc + 1);
+      break;
+
+    case VSM_JUMP_TABLE:
+      table = builder.read_int(pc + 2);
+      target = builder.read_int(pc + 3);
+      fall_through = false;
+      break;
+
+    case VSM_CALL:
+    case VSM_CALL_EXT:
+    case VSM_TAIL_CALL:
+      {
+	const CallInfo* info = call_info[pc];
+	ASSERT_COND( info != NULL );
+	// 最後の引数がスタックの一番上にある．
+	for (Ymsl_INT i = info->mArgNum; i > 0; -- i) {
+	  pop_list.push_back(val_class(info->mInputType[i - 1]));
+	}
+	push_class = val_class(info->mOutputType);
+	if ( op == VSM_TAIL_CALL ) {
+	  // 返り値はそのまま呼び出し元に返る．
+	  if ( push_class != val_class(output_type) ) {
+	    return false;
+	  }
+	  push_class = kClassVoid;
+	  fall_through = false;
+	}
+      }
+      break;
+
+    case VSM_RETURN:
+      pop_list.push_back(val_class(output_type));
+      fall_through = false;
+      break;
+
+    case VSM_RETURN_VOID:
+    case VSM_HALT:
+      fall_through = false;
+      break;
+
+    case VSM_JUMP_R:
+    case VSM_CALL_R:
+      // 生成しない命令
+      ASSERT_NOT_REACHED;
+      break;
+
+    default:
+      break;
+    }
+
+    for (vector<ValClass>::iterator p = pop_list.begin();
+	 p != pop_list.end(); ++ p) {
+      if ( state1.empty() ) {
+	return false;
+      }
+      if ( *p != kClassVoid && state1.back() != *p ) {
+	return false;
+      }
+      state1.pop_back();
+    }
+    if ( push_class != kClassVoid ) {
+      state1.push_back(push_class);
+    }
+
+    // 合流する位置では積まれている値が一致していなければならない．
+    vector<Ymsl_INT> next_list;
+    if ( target >= 0 ) {
+      next_list.push_back(target);
+    }
+    if ( table >= 0 ) {
+      const vector<Ymsl_INT>& target_list = builder.jump_table(table);
+      next_list.insert(next_list.end(), target_list.begin(), target_list.end());
+    }
+    if ( fall_through ) {
+      next_list.push_back(pc + Vsm::operand_size(op) + 1);
+    }
+    for (vector<Ymsl_INT>::iterator p = next_list.begin();
+	 p != next_list.end(); ++ p) {
+      Ymsl_INT next = *p;
+      if ( next < 0 || next >= size ) {
+	return false;
+      }
+      if ( reached[next] ) {
+	if ( state_array[next] != state1 ) {
+	  return false;
+	}
+	continue;
+      }
+      reached[next] = true;
+      state_array[next] = state1;
+      queue.push_back(next);
+    }
+  }
+
+  // 安全点の命令の直後のアドレスの順に記録する．
+  for (Ymsl_INT pc = 0; pc < size; ) {
+    Ymsl_CODE op = builder.read_opcode(pc);
+    Ymsl_INT next = pc + Vsm::operand_size(op) + 1;
+    // 後ろ向きの VSM_JUMP も安全点になる．
+    bool back_jump = (op == VSM_JUMP && builder.read_int(pc + 1) < next);
+    if ( reached[pc] && (is_safepoint(op) || back_jump) ) {
+      const vector<ValClass>& state = state_array[pc];
+      vector<Ymsl_INT> slot_list;
+      for (ymuint i = 0; i < state.size(); ++ i) {
+	if ( state[i] == kClassObj ) {
+	  slot_list.push_back(i);
+	}
+      }
+      builder.add_stack_map(next, slot_list);
+    }
+    pc = next;
+  }
+
+  return true;
+}
+
+// @brief 文に対するコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_stmt(IrNode* node,
+		 VsmCodeList::Builder& builder)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+  case IrNode::kLoad:
+    // 式文の値は捨てる．
+    gen_expr(node, builder);
+    builder.write_opcode(VSM_POP);
+    break;
+
+  case IrNode::kStore:
+    {
+      IrHandle* addr = node->address();
+      gen_expr(node->store_val(), addr->value_type()->type_id(), builder);
+      gen_store(addr, builder);
+    }
+    break;
+
+  case IrNode::kInplaceUniOp:
+    {
+      IrHandle* addr = node->address();
+      bool inc = (node->opcode() == kOpInc);
+      switch ( val_class(addr->value_type()->type_id()) ) {
+      case kClassInt:
+	gen_load(addr, builder);
+	builder.write_opcode(inc ? VSM_INT_INC : VSM_INT_DEC);
+	break;
+
+      case kClassFloat:
+	builder.write_opcode(VSM_PUSH_FLOAT_ONE);
+	gen_load(addr, builder);
+	builder.write_opcode(inc ? VSM_FLOAT_ADD : VSM_FLOAT_SUB);
+	break;
+
+      case kClassObj:
+	gen_load(addr, builder);
+	builder.write_opcode(inc ? VSM_OBJ_INC : VSM_OBJ_DEC);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+      gen_store(addr, builder);
+    }
+    break;
+
+  case IrNode::kInplaceBinOp:
+    {
+      IrHandle* addr = node->address();
+      OpCode opcode = node->opcode();
+      TypeId type_id = addr->value_type()->type_id();
+      Ymsl_CODE op = binop_code(opcode, type_id);
+      ASSERT_COND( op != VSM_NOP );
+      if ( opcode == kOpLshift || opcode == kOpRshift ) {
+	gen_expr(node->operand(0), kIntType, builder);
+      }
+      else {
+	gen_expr(node->operand(0), type_id, builder);
+      }
+      gen_load(addr, builder);
+      builder.write_opcode(op);
+      gen_store(addr, builder);
+    }
+    break;
+
+  case IrNode::kFuncCall:
+    gen_funccall(node, builder, VSM_CALL);
+    if ( expr_type_id(node) != kVoidType ) {
+      // 返り値は捨てる．
+      builder.write_opcode(VSM_POP);
+    }
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      IrNode* ret_val = node->return_val();
+      if ( ret_val->node_type() == IrNode::kFuncCall ) {
+	// 末尾呼び出しはフレームを再利用する．
+	gen_funccall(ret_val, builder, VSM_TAIL_CALL);
+	break;
+      }
+      gen_expr(ret_val, builder);
+      builder.write_opcode(VSM_RETURN);
+    }
+    else {
+      builder.write_opcode(VSM_RETURN_VOID);
+    }
+    break;
+
+  case IrNode::kJump:
+    gen_jump(VSM_JUMP, node->jump_addr()->id(), builder);
+    break;
+
+  case IrNode::kBranchTrue:
+    gen_expr(node->branch_cond(), kBooleanType, builder);
+    gen_jump(VSM_BRANCH_TRUE, node->jump_addr()->id(), builder);
+    break;
+
+  case IrNode::kBranchFalse:
+    gen_expr(node->branch_cond(), kBooleanType, builder);
+    gen_jump(VSM_BRANCH_FALSE, node->jump_addr()->id(), builder);
+    break;
+
+  case IrNode::kSwitch:
+    gen_switch(node, builder);
+    break;
+
+  case IrNode::kLabel:
+    put_label(node->id(), builder);
+    break;
+
+  case IrNode::kHalt:
+    builder.write_opcode(VSM_HALT);
+    break;
+  }
+}
+
+// @brief 式に対するコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+//
+// 結果はスタックに積まれる．
+void
+VsmGen::gen_expr(IrNode* node,
+		 VsmCodeList::Builder& builder)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    {
+      IrNode* opr = node->operand(0);
+      TypeId type_id = node->value_type()->type_id();
+      switch ( node->opcode() ) {
+      case kOpCastBoolean:
+      case kOpCastInt:
+      case kOpCastFloat:
+	gen_expr(opr, type_id, builder);
+	break;
+
+      case kOpBitNeg:
+	gen_expr(opr, builder);
+	builder.write_opcode(select_op(type_id, VSM_INT_NOT, VSM_NOP, VSM_OBJ_NOT));
+	break;
+
+      case kOpLogNot:
+	// x ^ 1 で否定を作る．
+	gen_expr(opr, kBooleanType, builder);
+	builder.write_opcode(VSM_PUSH_INT_IMM);
+	builder.write_int(1);
+	builder.write_opcode(VSM_INT_XOR);
+	break;
+
+      case kOpUniMinus:
+	gen_expr(opr, builder);
+	builder.write_opcode(select_op(type_id, VSM_INT_MINUS, VSM_FLOAT_MINUS, VSM_OBJ_MINUS));
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+    }
+    break;
+
+  case IrNode::kBinOp:
+    {
+      OpCode opcode = node->opcode();
+      if ( opcode == kOpLogAnd || opcode == kOpLogOr ) {
+	gen_logop(node, builder);
+	break;
+      }
+
+      TypeId type_id;
+      switch ( opcode ) {
+      case kOpEqual:
+      case kOpNotEq:
+      case kOpLt:
+      case kOpLe:
+	type_id = cmp_type_id(node);
+	break;
+
+      default:
+	type_id = node->value_type()->type_id();
+	break;
+      }
+      Ymsl_CODE op = binop_code(opcode, type_id);
+      ASSERT_COND( op != VSM_NOP );
+
+      // 第1オペランドがスタックトップになるように積む．
+      if ( opcode == kOpLshift || opcode == kOpRshift ) {
+	gen_expr(node->operand(1), kIntType, builder);
+      }
+      else {
+	gen_expr(node->operand(1), type_id, builder);
+      }
+      gen_expr(node->operand(0), type_id, builder);
+      builder.write_opcode(op);
+    }
+    break;
+
+  case IrNode::kTriOp:
+    {
+      ASSERT_COND( node->opcode() == kOpIte );
+      TypeId type_id = node->value_type()->type_id();
+      if ( is_safe_expr(node->operand(1)) && is_safe_expr(node->operand(2)) ) {
+	// 両方を求めても結果は変わらないので分岐せずに選ぶ．
+	gen_expr(node->operand(2), type_id, builder);
+	gen_expr(node->operand(1), type_id, builder);
+	gen_expr(node->operand(0), kBooleanType, builder);
+	builder.write_opcode(select_op(type_id, VSM_INT_ITE, VSM_FLOAT_ITE, VSM_OBJ_ITE));
+	break;
+      }
+
+      // 選ばれなかった方は評価しない．
+      ymuint label1 = new_label();
+      ymuint label2 = new_label();
+      gen_expr(node->operand(0), kBooleanType, builder);
+      gen_jump(VSM_BRANCH_FALSE, label1, builder);
+      gen_expr(node->operand(1), type_id, builder);
+      gen_jump(VSM_JUMP, label2, builder);
+      put_label(label1, builder);
+      gen_expr(node->operand(2), type_id, builder);
+      put_label(label2, builder);
+    }
+    break;
+
+  case IrNode::kLoad:
+    gen_load(node->address(), builder);
+    break;
+
+  case IrNode::kFuncCall:
+    gen_funccall(node, builder, VSM_CALL);
+    break;
+
+  default:
+    ASSERT_NOT_REACHED;
+    break;
+  }
+}
+
+// @brief 式に対するコード生成を行い，指定された型に変換する．
+// @param[in] node 対象のノード
+// @param[in] type_id 要求される型
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_expr(IrNode* node,
+		 TypeId type_id,
+		 VsmCodeList::Builder& builder)
+{
+  gen_expr(node, builder);
+  gen_cast(expr_type_id(node), type_id, builder);
+}
+
+// @brief 論理演算(AND/OR)のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+//
+// 短絡評価を行う．
+void
+VsmGen::gen_logop(IrNode* node,
+		  VsmCodeList::Builder& builder)
+{
+  bool is_and = (node->opcode() == kOpLogAnd);
+  ymuint label1 = new_label();
+  ymuint label2 = new_label();
+
+  gen_expr(node->operand(0), kBooleanType, builder);
+  gen_jump(is_and ? VSM_BRANCH_FALSE : VSM_BRANCH_TRUE, label1, builder);
+  gen_expr(node->operand(1), kBooleanType, builder);
+  gen_jump(VSM_JUMP, label2, builder);
+  put_label(label1, builder);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(is_and ? 0 : 1);
+  put_label(label2, builder);
+}
+
+// @brief 関数呼び出しのコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+// @param[in] call_op 呼び出し命令(VSM_CALL か VSM_TAIL_CALL)
+void
+VsmGen::gen_funccall(IrNode* node,
+		     VsmCodeList::Builder& builder,
+		     Ymsl_CODE call_op)
+{
+  IrHandle* func_handle = node->function_address();
+  ASSERT_COND( func_handle != NULL );
+  ASSERT_COND( func_handle->handle_type() == IrHandle::kFunction );
+
+  const Type* ftype = func_handle->value_type();
+  ymuint n = node->arglist_num();
+  ASSERT_COND( n <= ftype->function_input_num() );
+  for (ymuint i = 0; i < n; ++ i) {
+    TypeId type_id = ftype->function_input_type(i)->type_id();
+    gen_expr(node->arglist_elem(i), type_id, builder);
+  }
+
+  // 呼び出しによるスタックの増減を求めるために記録しておく．
+  CallInfo info;
+  info.mPos = builder.size();
+  info.mArgNum = n;
+  for (ymuint i = 0; i < n; ++ i) {
+    info.mInputType.push_back(ftype->function_input_type(i)->type_id());
+  }
+  info.mOutputType = ftype->function_output_type()->type_id();
+  mCallList.push_back(info);
+
+  ymuint module_index = func_handle->module_index();
+  if ( module_index == 0 ) {
+    builder.write_opcode(call_op);
+    builder.write_int(func_handle->local_index());
+    return;
+  }
+
+  // 他のモジュールの関数はモジュール番号をつけて呼び出す．
+  // 末尾呼び出しでも普通に呼び出してから戻る．
+  builder.write_opcode(VSM_CALL_EXT);
+  builder.write_int(module_index);
+  builder.write_int(func_handle->local_index());
+  if ( call_op == VSM_TAIL_CALL ) {
+    if ( info.mOutputType != kVoidType ) {
+      builder.write_opcode(VSM_RETURN);
+    }
+    else {
+      builder.write_opcode(VSM_RETURN_VOID);
+    }
+  }
+}
+
+// @brief ロードのコード生成を行う．
+// @param[in] addr アドレス
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_load(IrHandle* addr,
+		 VsmCodeList::Builder& builder)
+{
+  switch ( addr->handle_type() ) {
+  case IrHandle::kBooleanConst:
+    builder.write_opcode(VSM_PUSH_INT_IMM);
+    builder.write_int(addr->boolean_val() ? 1 : 0);
+    break;
+
+  case IrHandle::kIntConst:
+    gen_int_const(addr->int_val(), builder);
+    break;
+
+  case IrHandle::kFloatConst:
+    {
+      Ymsl_FLOAT val = addr->float_val();
+      if ( val == 0.0 && !std::signbit(val) ) {
+	// -0.0 は符号を保つために定数として積む．
+	builder.write_opcode(VSM_PUSH_FLOAT_ZERO);
+      }
+      else if ( val == 1.0 ) {
+	builder.write_opcode(VSM_PUSH_FLOAT_ONE);
+      }
+      else {
+	builder.write_opcode(VSM_PUSH_CONST);
+	builder.write_int(mConstPool->add_float(val));
+      }
+    }
+    break;
+
+  case IrHandle::kStringConst:
+    builder.write_opcode(VSM_PUSH_CONST);
+    builder.write_int(mConstPool->add_string(intern_ShString(addr->string_val())));
+    break;
+
+  case IrHandle::kLocalVar:
+    {
+      TypeId type_id = addr->value_type()->type_id();
+      builder.write_opcode(select_op(type_id,
+				     VSM_LOAD_LOCAL_INT,
+				     VSM_LOAD_LOCAL_FLOAT,
+				     VSM_LOAD_LOCAL_OBJ));
+      builder.write_int(local_slot(addr));
+    }
+    break;
+
+  case IrHandle::kGlobalVar:
+    {
+      TypeId type_id = addr->value_type()->type_id();
+      if ( addr->module_index() != 0 ) {
+	builder.write_opcode(select_op(type_id,
+				       VSM_LOAD_EXT_GLOBAL_INT,
+				       VSM_LOAD_EXT_GLOBAL_FLOAT,
+				       VSM_LOAD_EXT_GLOBAL_OBJ));
+	builder.write_int(addr->module_index());
+      }
+      else {
+	builder.write_opcode(select_op(type_id,
+				       VSM_LOAD_GLOBAL_INT,
+				       VSM_LOAD_GLOBAL_FLOAT,
+				       VSM_LOAD_GLOBAL_OBJ));
+      }
+      builder.write_int(addr->local_index());
+    }
+    break;
+
+  case IrHandle::kFunction:
+    // VSM_CALL_R 用に関数番号を積む．
+    builder.write_opcode(VSM_PUSH_INT_IMM);
+    builder.write_int(addr->local_index());
+    break;
+
+  default:
+    // 配列やメンバの参照はまだ実装されていない．
+    ASSERT_NOT_REACHED;
+    break;
+  }
+}
+
+// @brief ストアのコード生成を行う．
+// @param[in] addr アドレス
+// @param[in] builder CodeList ビルダー
+//
+// 値はスタックトップに積まれている．
+void
+VsmGen::gen_store(IrHandle* addr,
+		  VsmCodeList::Builder& builder)
+{
+  switch ( addr->handle_type() ) {
+  case IrHandle::kLocalVar:
+    {
+      TypeId type_id = addr->value_type()->type_id();
+      builder.write_opcode(select_op(type_id,
+				     VSM_STORE_LOCAL_INT,
+				     VSM_STORE_LOCAL_FLOAT,
+				     VSM_STORE_LOCAL_OBJ));
+      builder.write_int(local_slot(addr));
+    }
+    break;
+
+  case IrHandle::kGlobalVar:
+    {
+      TypeId type_id = addr->value_type()->type_id();
+      if ( addr->module_index() != 0 ) {
+	builder.write_opcode(select_op(type_id,
+				       VSM_STORE_EXT_GLOBAL_INT,
+				       VSM_STORE_EXT_GLOBAL_FLOAT,
+				       VSM_STORE_EXT_GLOBAL_OBJ));
+	builder.write_int(addr->module_index());
+      }
+      else {
+	builder.write_opcode(select_op(type_id,
+				       VSM_STORE_GLOBAL_INT,
+				       VSM_STORE_GLOBAL_FLOAT,
+				       VSM_STORE_GLOBAL_OBJ));
+      }
+      builder.write_int(addr->local_index());
+    }
+    break;
+
+  default:
+    // 配列やメンバの参照はまだ実装されていない．
+    ASSERT_NOT_REACHED;
+    break;
+  }
+}
+
+// @brief 型変換のコード生成を行う．
+// @param[in] src_id 元の型
+// @param[in] dst_id 変換後の型
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_cast(TypeId src_id,
+		 TypeId dst_id,
+		 VsmCodeList::Builder& builder)
+{
+  if ( src_id == dst_id ) {
+    return;
+  }
+
+  ValClass src_class = val_class(src_id);
+  switch ( val_class(dst_id) ) {
+  case kClassInt:
+    if ( dst_id == kBooleanType ) {
+      switch ( src_class ) {
+      case kClassInt:
+	builder.write_opcode(VSM_INT_TO_BOOL);
+	break;
+
+      case kClassFloat:
+	builder.write_opcode(VSM_FLOAT_TO_BOOL);
+	break;
+
+      case kClassObj:
+	builder.write_opcode(VSM_OBJ_TO_INT);
+	builder.write_opcode(VSM_INT_TO_BOOL);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+    }
+    else {
+      // boolean/enum から int への変換は何もしなくてよい．
+      switch ( src_class ) {
+      case kClassInt:
+	break;
+
+      case kClassFloat:
+	builder.write_opcode(VSM_FLOAT_TO_INT);
+	break;
+
+      case kClassObj:
+	builder.write_opcode(VSM_OBJ_TO_INT);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+    }
+    break;
+
+  case kClassFloat:
+    switch ( src_class ) {
+    case kClassInt:
+      builder.write_opcode(VSM_INT_TO_FLOAT);
+      break;
+
+    case kClassFloat:
+      break;
+
+    case kClassObj:
+      builder.write_opcode(VSM_OBJ_TO_FLOAT);
+      break;
+
+    default:
+      ASSERT_NOT_REACHED;
+      break;
+    }
+    break;
+
+  case kClassObj:
+    // プリミティブ型からオブジェクトへの変換はない．
+    ASSERT_COND( src_class == kClassObj );
+    break;
+
+  case kClassVoid:
+    break;
+  }
+}
+
+// @brief INT の定数を積むコード生成を行う．
+// @param[in] val 値
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_int_const(Ymsl_INT val,
+		      VsmCodeList::Builder& builder)
+{
+  if ( use_const_pool(val) ) {
+    builder.write_opcode(VSM_PUSH_CONST);
+    builder.write_int(mConstPool->add_int(val));
+  }
+  else {
+    builder.write_opcode(VSM_PUSH_INT_IMM);
+    builder.write_int(val);
+  }
+}
+
+// @brief switch 文のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_switch(IrNode* node,
+		   VsmCodeList::Builder& builder)
+{
+  IrNode* cond = node->branch_cond();
+  ymuint n = node->case_num();
+  if ( n == 0 ) {
+    // 選択値は副作用のためだけに評価する．
+    gen_expr(cond, kIntType, builder);
+    builder.write_opcode(VSM_POP);
+    gen_jump(VSM_JUMP, node->jump_addr()->id(), builder);
+    return;
+  }
+
+  if ( use_jump_table(node, 0, n) ) {
+    // 全体を一つの表で引く．
+    gen_expr(cond, kIntType, builder);
+    builder.write_opcode(VSM_JUMP_TABLE);
+    builder.write_int(node->case_val(0));
+    builder.write_int(new_jump_table(node, 0, n, builder));
+    mFixupList.push_back(make_pair(builder.size(), node->jump_addr()->id()));
+    builder.write_int(0);
+    return;
+  }
+
+  // 何度も比較するので選択値をローカル変数に置く．
+  Ymsl_INT var;
+  if ( need_switch_var(node) ) {
+    ASSERT_COND( mSwitchVar >= 0 );
+    var = mSwitchVar;
+    gen_expr(cond, kIntType, builder);
+    builder.write_opcode(VSM_STORE_LOCAL_INT);
+    builder.write_int(var);
+  }
+  else {
+    var = local_slot(cond->address());
+  }
+  gen_case_tree(node, 0, n, var, builder);
+}
+
+// @brief switch 文のケースの範囲に対する分岐のコード生成を行う．
+// @param[in] node switch 文のノード
+// @param[in] begin 範囲の先頭のケース番号
+// @param[in] end 範囲の末尾の次のケース番号
+// @param[in] var 選択値を格納しているローカル変数の番号
+// @param[in] builder CodeList ビルダー
+//
+// 範囲外の値の場合は default のラベルに飛ぶ．
+void
+VsmGen::gen_case_tree(IrNode* node,
+		      ymuint begin,
+		      ymuint end,
+		      Ymsl_INT var,
+		      VsmCodeList::Builder& builder)
+{
+  ymuint default_id = node->jump_addr()->id();
+  if ( use_jump_table(node, begin, end) ) {
+    builder.write_opcode(VSM_LOAD_LOCAL_INT);
+    builder.write_int(var);
+    builder.write_opcode(VSM_JUMP_TABLE);
+    builder.write_int(node->case_val(begin));
+    builder.write_int(new_jump_table(node, begin, end, builder));
+    mFixupList.push_back(make_pair(builder.size(), default_id));
+    builder.write_int(0);
+  }
+  else if ( end - begin <= kMaxLinearCase ) {
+    for (ymuint i = begin; i < end; ++ i) {
+      gen_int_const(node->case_val(i), builder);
+      builder.write_opcode(VSM_LOAD_LOCAL_INT);
+      builder.write_int(var);
+      builder.write_opcode(VSM_INT_EQ);
+      gen_jump(VSM_BRANCH_TRUE, node->case_label(i)->id(), builder);
+    }
+    gen_jump(VSM_JUMP, default_id, builder);
+  }
+  else {
+    // var < case_val(pos) でなければ後半に飛ぶ．
+    ymuint pos = split_pos(node, begin, end);
+    ymuint label = new_label();
+    gen_int_const(node->case_val(pos), builder);
+    builder.write_opcode(VSM_LOAD_LOCAL_INT);
+    builder.write_int(var);
+    builder.write_opcode(VSM_INT_LT);
+    gen_jump(VSM_BRANCH_FALSE, label, builder);
+    gen_case_tree(node, begin, pos, var, builder);
+    put_label(label, builder);
+    gen_case_tree(node, pos, end, var, builder);
+  }
+}
+
+// @brief ジャンプ命令のコード生成を行う．
+// @param[in] op 命令
+// @param[in] label_id ジャンプ先のラベル番号
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_jump(Ymsl_CODE op,
+		 ymuint label_id,
+		 VsmCodeList::Builder& builder)
+{
+  builder.write_opcode(op);
+  // アドレスはあとで埋める．
+  mFixupList.push_back(make_pair(builder.size(), label_id));
+  builder.write_int(0);
+}
+
+// @brief ジャンプテーブルを作る．
+// @param[in] node switch 文のノード
+// @param[in] begin 範囲の先頭のケース番号
+// @param[in] end 範囲の末尾の次のケース番号
+// @param[in] builder CodeList ビルダー
+// @return テーブル番号を返す．
+Ymsl_INT
+VsmGen::new_jump_table(IrNode* node,
+		       ymuint begin,
+		       ymuint end,
+		       VsmCodeList::Builder& builder)
+{
+  Ymsl_INT min = node->case_val(begin);
+  ymuint size = static_cast<ymuint32>(node->case_val(end - 1))
+    - static_cast<ymuint32>(min) + 1;
+  Ymsl_INT index = builder.add_jump_table(size);
+  // 値のない位置は default に飛ぶ．
+  for (ymuint i = 0; i < size; ++ i) {
+    builder.rewrite_jump_table(index, i, node->jump_addr()->id());
+  }
+  for (ymuint i = begin; i < end; ++ i) {
+    ymuint pos = static_cast<ymuint32>(node->case_val(i))
+      - static_cast<ymuint32>(min);
+    builder.rewrite_jump_table(index, pos, node->case_label(i)->id());
+  }
+  mTableList.push_back(index);
+  return index;
+}
+
+// @brief INT の定数を定数表に置くか調べる．
+// @param[in] val 値
+//
+// 16ビットに収まらないものは命令に埋め込むより短くなるので
+// 定数表に置く．
+bool
+VsmGen::use_const_pool(Ymsl_INT val)
+{
+  return val < -32768 || val > 32767;
+}
+
+// @brief 新しいラベル番号を得る．
+ymuint
+VsmGen::new_label()
+{
+  ymuint id = mLabelAddr.size();
+  mLabelAddr.push_back(-1);
+  return id;
+}
+
+// @brief ラベルの位置を確定する．
+// @param[in] label_id ラベル番号
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::put_label(ymuint label_id,
+		  VsmCodeList::Builder& builder)
+{
+  ASSERT_COND( label_id < mLabelAddr.size() );
+  mLabelAddr[label_id] = builder.size();
+}
+
+// @brief コードブロックに対するレジスタ型のコード生成を行う．
+// @param[in] code_block コードブロック
+// @param[in] arg_num 引数の数
+// @param[in] end_op 末尾に置く命令
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_block(const IrCodeBlock* code_block,
+		      ymuint arg_num,
+		      Ymsl_CODE end_op,
+		      VsmRegCodeList::Builder& builder)
+{
+  init_labels(code_block);
+  assign_slots(code_block, arg_num, false);
+  mCallList.clear();
+  mExtLoadList.clear();
+
+  mVarNum = mSlotType.size();
+  mTempTop = mVarNum;
+  mFrameSize = mVarNum;
+
+  // フレームのサイズはあとで埋める．
+  builder.write_opcode(VSM_REG_ENTER);
+  Ymsl_INT frame_pos = builder.size();
+  builder.write_int(0);
+  builder.write_int(arg_num);
+
+  const vector<IrNode*>& node_list = code_block->node_list();
+  for (vector<IrNode*>::const_iterator p = node_list.begin();
+       p != node_list.end(); ++ p) {
+    IrNode* node = *p;
+    gen_reg_stmt(node, builder);
+  }
+  builder.write_opcode(end_op);
+
+  ASSERT_COND( mTempTop == mVarNum );
+  builder.rewrite_int(frame_pos, mFrameSize);
+
+  fix_labels(builder);
+
+  gen_reg_stack_map(builder);
+}
+
+// @brief レジスタ型のコードのごみ集め用のスタックマップを作る．
+// @param[in] builder CodeList ビルダー
+//
+// スロットごとの格納クラスを前向きに求める．VSM_REG_ENTER で
+// フレームを NULL で埋めるので変数のスロットは最初から変数の型の
+// 格納クラスとしてよい．合流する位置で食い違うスロットは kClassVoid
+// にして辿らない．
+// 関数呼び出しの引数の位置から後ろは呼ばれた関数のフレームになるので，
+// 戻った後は返り値の位置以外を kClassVoid にする．
+void
+VsmGen::gen_reg_stack_map(VsmRegCodeList::Builder& builder)
+{
+  Ymsl_INT size = builder.size();
+
+  // 関数呼び出し命令の位置をキーにした情報
+  vector<const CallInfo*> call_info(size, NULL);
+  for (vector<CallInfo>::iterator p = mCallList.begin();
+       p != mCallList.end(); ++ p) {
+    call_info[p->mPos] = &(*p);
+  }
+
+  // 他のモジュールのグローバル変数を読む命令の位置をキーにした型
+  vector<TypeId> ext_load_type(size, kVoidType);
+  for (vector<pair<Ymsl_INT, TypeId> >::iterator p = mExtLoadList.begin();
+       p != mExtLoadList.end(); ++ p) {
+    ext_load_type[p->first] = p->second;
+  }
+
+  // 各命令位置でのスロットの格納クラスを表す配列
+  vector<vector<ValClass> > state_array(size);
+  // 到達済みの時 true
+  vector<bool> reached(size, false);
+  vector<Ymsl_INT> queue;
+  state_array[0].resize(mFrameSize, kClassVoid);
+  for (Ymsl_INT i = 0; i < mVarNum; ++ i) {
+    state_array[0][i] = val_class(mSlotType[i]);
+  }
+  reached[0] = true;
+  queue.push_back(0);
+  while ( !queue.empty() ) {
+    Ymsl_INT pc = queue.back();
+    queue.pop_back();
+
+    vector<ValClass> state1(state_array[pc]);
+    Ymsl_CODE op = builder.read_opcode(pc);
+    // 値を書き込むスロットとその格納クラス
+    Ymsl_INT dst = -1;
+    ValClass dst_class = kClassVoid;
+    Ymsl_INT target = -1;
+    Ymsl_INT table = -1;
+    bool fall_through = true;
+    switch ( op ) {
+    case VSM_REG_INT_IMM:
+    case VSM_REG_INT_MINUS:
+    case VSM_REG_INT_INC:
+    case VSM_REG_INT_DEC:
+    case VSM_REG_INT_NOT:
+    case VSM_REG_INT_LNOT:
+    case VSM_REG_INT_TO_BOOL:
+    case VSM_REG_FLOAT_TO_BOOL:
+    case VSM_REG_FLOAT_TO_INT:
+    case VSM_REG_OBJ_TO_INT:
+    case VSM_REG_INT_ADD:
+    case VSM_REG_INT_SUB:
+    case VSM_REG_INT_MUL:
+    case VSM_REG_INT_DIV:
+    case VSM_REG_INT_MOD:
+    case VSM_REG_INT_LSHIFT:
+    case VSM_REG_INT_RSHIFT:
+    case VSM_REG_INT_EQ:
+    case VSM_REG_INT_NE:
+    case VSM_REG_INT_LT:
+    case VSM_REG_INT_LE:
+    case VSM_REG_INT_AND:
+    case VSM_REG_INT_OR:
+    case VSM_REG_INT_XOR:
+    case VSM_REG_FLOAT_EQ:
+    case VSM_REG_FLOAT_NE:
+    case VSM_REG_FLOAT_LT:
+    case VSM_REG_FLOAT_LE:
+    case VSM_REG_OBJ_EQ:
+    case VSM_REG_OBJ_NE:
+    case VSM_REG_OBJ_LT:
+    case VSM_REG_OBJ_LE:
+      dst = builder.read_int(pc + 1);
+      dst_class = kClassInt;
+      break;
+
+    case VSM_REG_FLOAT_IMM:
+    case VSM_REG_INT_TO_FLOAT:
+    case VSM_REG_FLOAT_MINUS:
+    case VSM_REG_OBJ_TO_FLOAT:
+    case VSM_REG_FLOAT_ADD:
+    case VSM_REG_FLOAT_SUB:
+    case VSM_REG_FLOAT_MUL:
+    case VSM_REG_FLOAT_DIV:
+      dst = builder.read_int(pc + 1);
+      dst_class = kClassFloat;
+      break;
+
+    case VSM_REG_OBJ_NULL:
+    case VSM_REG_OBJ_MINUS:
+    case VSM_REG_OBJ_INC:
+    case VSM_REG_OBJ_DEC:
+    case VSM_REG_OBJ_NOT:
+    case VSM_REG_OBJ_ADD:
+    case VSM_REG_OBJ_SUB:
+    case VSM_REG_OBJ_MUL:
+    case VSM_REG_OBJ_DIV:
+    case VSM_REG_OBJ_MOD:
+    case VSM_REG_OBJ_LSHIFT:
+    case VSM_REG_OBJ_RSHIFT:
+    case VSM_REG_OBJ_AND:
+    case VSM_REG_OBJ_OR:
+    case VSM_REG_OBJ_XOR:
+      dst = builder.read_int(pc + 1);
+      dst_class = kClassObj;
+      break;
+
+    case VSM_REG_MOVE:
+      dst = builder.read_int(pc + 1);
+      dst_class = state1[builder.read_int(pc + 2)];
+      break;
+
+    case VSM_REG_CONST:
+      dst = builder.read_int(pc + 1);
+      dst_class = val_class(mConstPool->type(builder.read_int(pc + 2)));
+      break;
+
+    case VSM_REG_LOAD_GLOBAL:
+      dst = builder.read_int(pc + 1);
+      dst_class = val_class(mGlobalType[builder.read_int(pc + 2)]);
+      break;
+
+    case VSM_REG_LOAD_EXT_GLOBAL:
+      dst = builder.read_int(pc + 1);
+      dst_class = val_class(ext_load_type[pc]);
+      break;
+
+    case VSM_REG_ITE:
+      {
+	dst = builder.read_int(pc + 1);
+	ValClass class1 = state1[builder.read_int(pc + 3)];
+	ValClass class2 = state1[builder.read_int(pc + 4)];
+	dst_class = (class1 == class2) ? class1 : kClassVoid;
+      }
+      break;
+
+    case VSM_REG_JUMP:
+      target = builder.read_int(pc + 1);
+      fall_through = false;
+      break;
+
+    case VSM_REG_BRANCH_TRUE:
+    case VSM_REG_BRANCH_FALSE:
+      target = builder.read_int(pc + 2);
+      break;
+
+    case VSM_REG_JUMP_TABLE:
+      table = builder.read_int(pc + 3);
+      target = builder.read_int(pc + 4);
+      fall_through = false;
+      break;
+
+    case VSM_REG_CALL:
+    case VSM_REG_CALL_EXT:
+      {
+	const CallInfo* info = call_info[pc];
+	ASSERT_COND( info != NULL );
+	Ymsl_INT arg_base = builder.read_int(pc + ((op == VSM_REG_CALL) ? 2 : 3));
+	for (Ymsl_INT i = arg_base; i < mFrameSize; ++ i) {
+	  state1[i] = kClassVoid;
+	}
+	dst = arg_base;
+	dst_class = val_class(info->mOutputType);
+      }
+      break;
+
+    case VSM_REG_TAIL_CALL:
+    case VSM_REG_RETURN:
+    case VSM_REG_RETURN_VOID:
+    case VSM_REG_HALT:
+      fall_through = false;
+      break;
+
+    default:
+      break;
+    }
+    if ( dst >= 0 ) {
+      ASSERT_COND( dst < mFrameSize );
+      state1[dst] = dst_class;
+    }
+
+    vector<Ymsl_INT> next_list;
+    if ( target >= 0 ) {
+      next_list.push_back(target);
+    }
+    if ( table >= 0 ) {
+      const vector<Ymsl_INT>& target_list = builder.jump_table(table);
+      next_list.insert(next_list.end(), target_list.begin(), target_list.end());
+    }
+    if ( fall_through ) {
+      next_list.push_back(pc + Vsm::reg_operand_size(op) + 1);
+    }
+    for (vector<Ymsl_INT>::iterator p = next_list.begin();
+	 p != next_list.end(); ++ p) {
+      Ymsl_INT next = *p;
+      ASSERT_COND( next >= 0 && next < size );
+      if ( !reached[next] ) {
+	reached[next] = true;
+	state_array[next] = state1;
+	queue.push_back(next);
+	continue;
+      }
+      // 合流する位置で食い違うスロットは辿らないことにして調べ直す．
+      vector<ValClass>& state2 = state_array[next];
+      bool changed = false;
+      for (Ymsl_INT i = 0; i < mFrameSize; ++ i) {
+	if ( state2[i] != state1[i] && state2[i] != kClassVoid ) {
+	  state2[i] = kClassVoid;
+	  changed = true;
+	}
+      }
+      if ( changed ) {
+	queue.push_back(next);
+      }
+    }
+  }
+
+  // 安全点の命令の直後のアドレスの順に記録する．
+  // 引数も呼ばれた関数が組み込み関数の場合に備えて含めておく．
+  for (Ymsl_INT pc = 0; pc < size; ) {
+    Ymsl_CODE op = builder.read_opcode(pc);
+    Ymsl_INT next = pc + Vsm::reg_operand_size(op) + 1;
+    bool back_jump = (op == VSM_REG_JUMP && builder.read_int(pc + 1) < next);
+    if ( reached[pc] && (is_reg_safepoint(op) || back_jump) ) {
+      const vector<ValClass>& state = state_array[pc];
+      vector<Ymsl_INT> slot_list;
+      for (ymuint i = 0; i < state.size(); ++ i) {
+	if ( state[i] == kClassObj ) {
+	  slot_list.push_back(i);
+	}
+      }
+      builder.add_stack_map(next, slot_list);
+    }
+    pc = next;
+  }
+}
+
+// @brief 文に対するレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_stmt(IrNode* node,
+		     VsmRegCodeList::Builder& builder)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+  case IrNode::kBinOp:
+  case IrNode::kTriOp:
+  case IrNode::kLoad:
+  case IrNode::kFuncCall:
+    // 式文の値は捨てる．
+    free_temp(gen_reg_expr(node, -1, builder));
+    break;
+
+  case IrNode::kStore:
+    {
+      IrHandle* addr = node->address();
+      TypeId type_id = addr->value_type()->type_id();
+      if ( addr->handle_type() == IrHandle::kLocalVar ) {
+	// ローカル変数には直接書き込む．
+	gen_reg_expr(node->store_val(), type_id, local_slot(addr), builder);
+      }
+      else {
+	Ymsl_INT src = gen_reg_expr(node->store_val(), type_id, -1, builder);
+	gen_reg_store(addr, src, builder);
+	free_temp(src);
+      }
+    }
+    break;
+
+  case IrNode::kInplaceUniOp:
+    {
+      IrHandle* addr = node->address();
+      bool inc = (node->opcode() == kOpInc);
+      Ymsl_INT slot = gen_reg_load(addr, -1, builder);
+      switch ( val_class(addr->value_type()->type_id()) ) {
+      case kClassInt:
+	builder.write_opcode(inc ? VSM_REG_INT_INC : VSM_REG_INT_DEC);
+	builder.write_int(slot);
+	builder.write_int(slot);
+	break;
+
+      case kClassFloat:
+	{
+	  Ymsl_INT one = new_temp();
+	  builder.write_opcode(VSM_REG_CONST);
+	  builder.write_int(one);
+	  builder.write_int(mConstPool->add_float(1.0));
+	  builder.write_opcode(inc ? VSM_REG_FLOAT_ADD : VSM_REG_FLOAT_SUB);
+	  builder.write_int(slot);
+	  builder.write_int(slot);
+	  builder.write_int(one);
+	  free_temp(one);
+	}
+	break;
+
+      case kClassObj:
+	builder.write_opcode(inc ? VSM_REG_OBJ_INC : VSM_REG_OBJ_DEC);
+	builder.write_int(slot);
+	builder.write_int(slot);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+      gen_reg_store(addr, slot, builder);
+      free_temp(slot);
+    }
+    break;
+
+  case IrNode::kInplaceBinOp:
+    {
+      IrHandle* addr = node->address();
+      OpCode opcode = node->opcode();
+      TypeId type_id = addr->value_type()->type_id();
+      Ymsl_CODE op = reg_binop_code(opcode, type_id);
+      ASSERT_COND( op != VSM_REG_NOP );
+      TypeId rtype_id = type_id;
+      if ( opcode == kOpLshift || opcode == kOpRshift ) {
+	rtype_id = kIntType;
+      }
+      Ymsl_INT src = gen_reg_expr(node->operand(0), rtype_id, -1, builder);
+      Ymsl_INT slot = gen_reg_load(addr, -1, builder);
+      builder.write_opcode(op);
+      builder.write_int(slot);
+      builder.write_int(slot);
+      builder.write_int(src);
+      gen_reg_store(addr, slot, builder);
+      free_temp(slot);
+      free_temp(src);
+    }
+    break;
+
+  case IrNode::kReturn:
+    if ( node->return_val() != NULL ) {
+      IrNode* ret_val = node->return_val();
+      if ( ret_val->node_type() == IrNode::kFuncCall ) {
+	// 末尾呼び出しはフレームを再利用する．
+	Ymsl_INT slot = gen_reg_funccall(ret_val, -1, builder, VSM_REG_TAIL_CALL);
+	free_temp(slot);
+	break;
+      }
+      Ymsl_INT src = gen_reg_expr(ret_val, -1, builder);
+      builder.write_opcode(VSM_REG_RETURN);
+      builder.write_int(src);
+      free_temp(src);
+    }
+    else {
+      builder.write_opcode(VSM_REG_RETURN_VOID);
+    }
+    break;
+
+  case IrNode::kJump:
+    gen_reg_jump(VSM_REG_JUMP, -1, node->jump_addr()->id(), builder);
+    break;
+
+  case IrNode::kBranchTrue:
+  case IrNode::kBranchFalse:
+    {
+      Ymsl_INT cond = gen_reg_expr(node->branch_cond(), kBooleanType, -1, builder);
+      free_temp(cond);
+      Ymsl_CODE op = (node->node_type() == IrNode::kBranchTrue) ? VSM_REG_BRANCH_TRUE : VSM_REG_BRANCH_FALSE;
+      gen_reg_jump(op, cond, node->jump_addr()->id(), builder);
+    }
+    break;
+
+  case IrNode::kSwitch:
+    gen_reg_switch(node, builder);
+    break;
+
+  case IrNode::kLabel:
+    put_label(node->id(), builder);
+    break;
+
+  case IrNode::kHalt:
+    builder.write_opcode(VSM_REG_HALT);
+    break;
+  }
+}
+
+// @brief 式に対するレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @return 結果を格納したスロット番号を返す．
+//
+// dst が -1 の場合には結果の位置はこちらで決める．
+Ymsl_INT
+VsmGen::gen_reg_expr(IrNode* node,
+		     Ymsl_INT dst,
+		     VsmRegCodeList::Builder& builder)
+{
+  switch ( node->node_type() ) {
+  case IrNode::kUniOp:
+    {
+      IrNode* opr = node->operand(0);
+      TypeId type_id = node->value_type()->type_id();
+      Ymsl_CODE op = VSM_REG_NOP;
+      Ymsl_INT src;
+      switch ( node->opcode() ) {
+      case kOpCastBoolean:
+      case kOpCastInt:
+      case kOpCastFloat:
+	return gen_reg_expr(opr, type_id, dst, builder);
+
+      case kOpBitNeg:
+	src = gen_reg_expr(opr, -1, builder);
+	op = select_op(type_id, VSM_REG_INT_NOT, VSM_REG_NOP, VSM_REG_OBJ_NOT);
+	break;
+
+      case kOpLogNot:
+	src = gen_reg_expr(opr, kBooleanType, -1, builder);
+	op = VSM_REG_INT_LNOT;
+	break;
+
+      case kOpUniMinus:
+	src = gen_reg_expr(opr, -1, builder);
+	op = select_op(type_id, VSM_REG_INT_MINUS, VSM_REG_FLOAT_MINUS, VSM_REG_OBJ_MINUS);
+	break;
+
+      default:
+	ASSERT_NOT_REACHED;
+	break;
+      }
+      ASSERT_COND( op != VSM_REG_NOP );
+      free_temp(src);
+      Ymsl_INT slot = target_slot(dst);
+      builder.write_opcode(op);
+      builder.write_int(slot);
+      builder.write_int(src);
+      return slot;
+    }
+
+  case IrNode::kBinOp:
+    {
+      OpCode opcode = node->opcode();
+      if ( opcode == kOpLogAnd || opcode == kOpLogOr ) {
+	return gen_reg_logop(node, dst, builder);
+      }
+
+      TypeId type_id;
+      switch ( opcode ) {
+      case kOpEqual:
+      case kOpNotEq:
+      case kOpLt:
+      case kOpLe:
+	type_id = cmp_type_id(node);
+	break;
+
+      default:
+	type_id = node->value_type()->type_id();
+	break;
+      }
+      Ymsl_CODE op = reg_binop_code(opcode, type_id);
+      ASSERT_COND( op != VSM_REG_NOP );
+
+      TypeId type_id2 = type_id;
+      if ( opcode == kOpLshift || opcode == kOpRshift ) {
+	type_id2 = kIntType;
+      }
+      Ymsl_INT src1 = gen_reg_expr(node->operand(0), type_id, -1, builder);
+      Ymsl_INT src2 = gen_reg_expr(node->operand(1), type_id2, -1, builder);
+      free_temp(src2);
+      free_temp(src1);
+      Ymsl_INT slot = target_slot(dst);
+      builder.write_opcode(op);
+      builder.write_int(slot);
+      builder.write_int(src1);
+      builder.write_int(src2);
+      return slot;
+    }
+
+  case IrNode::kTriOp:
+    {
+      ASSERT_COND( node->opcode() == kOpIte );
+      TypeId type_id = node->value_type()->type_id();
+      if ( !is_safe_expr(node->operand(1)) || !is_safe_expr(node->operand(2)) ) {
+	return gen_reg_ite(node, dst, builder);
+      }
+      Ymsl_INT cond = gen_reg_expr(node->operand(0), kBooleanType, -1, builder);
+      Ymsl_INT src1 = gen_reg_expr(node->operand(1), type_id, -1, builder);
+      Ymsl_INT src2 = gen_reg_expr(node->operand(2), type_id, -1, builder);
+      free_temp(src2);
+      free_temp(src1);
+      free_temp(cond);
+      Ymsl_INT slot = target_slot(dst);
+      builder.write_opcode(VSM_REG_ITE);
+      builder.write_int(slot);
+      builder.write_int(cond);
+      builder.write_int(src1);
+      builder.write_int(src2);
+      return slot;
+    }
+
+  case IrNode::kLoad:
+    return gen_reg_load(node->address(), dst, builder);
+
+  case IrNode::kFuncCall:
+    return gen_reg_funccall(node, dst, builder, VSM_REG_CALL);
+
+  default:
+    break;
+  }
+  ASSERT_NOT_REACHED;
+  return -1;
+}
+
+// @brief 式に対するレジスタ型のコード生成を行い，指定された型に変換する．
+// @param[in] node 対象のノード
+// @param[in] type_id 要求される型
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @return 結果を格納したスロット番号を返す．
+Ymsl_INT
+VsmGen::gen_reg_expr(IrNode* node,
+		     TypeId type_id,
+		     Ymsl_INT dst,
+		     VsmRegCodeList::Builder& builder)
+{
+  Ymsl_CODE op1;
+  Ymsl_CODE op2;
+  reg_cast_code(expr_type_id(node), type_id, op1, op2);
+  if ( op1 == VSM_REG_NOP ) {
+    return gen_reg_expr(node, dst, builder);
+  }
+
+  Ymsl_INT src = gen_reg_expr(node, -1, builder);
+  free_temp(src);
+  Ymsl_INT slot = target_slot(dst);
+  builder.write_opcode(op1);
+  builder.write_int(slot);
+  builder.write_int(src);
+  if ( op2 != VSM_REG_NOP ) {
+    builder.write_opcode(op2);
+    builder.write_int(slot);
+    builder.write_int(slot);
+  }
+  return slot;
+}
+
+// @brief 論理演算(AND/OR)のレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @return 結果を格納したスロット番号を返す．
+//
+// 短絡評価を行う．
+Ymsl_INT
+VsmGen::gen_reg_logop(IrNode* node,
+		      Ymsl_INT dst,
+		      VsmRegCodeList::Builder& builder)
+{
+  // 途中で結果の位置に書き込むので変数を直接使うことはできない．
+  Ymsl_INT slot = (dst >= mVarNum) ? dst : new_temp();
+  bool is_and = (node->opcode() == kOpLogAnd);
+  ymuint label = new_label();
+
+  gen_reg_expr(node->operand(0), kBooleanType, slot, builder);
+  gen_reg_jump(is_and ? VSM_REG_BRANCH_FALSE : VSM_REG_BRANCH_TRUE, slot, label, builder);
+  gen_reg_expr(node->operand(1), kBooleanType, slot, builder);
+  put_label(label, builder);
+
+  if ( dst >= 0 && dst != slot ) {
+    builder.write_opcode(VSM_REG_MOVE);
+    builder.write_int(dst);
+    builder.write_int(slot);
+    free_temp(slot);
+    return dst;
+  }
+  return slot;
+}
+
+// @brief ITE 演算のレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @return 結果を格納したスロット番号を返す．
+//
+// 選ばれなかった方は評価しないように分岐を用いる．
+Ymsl_INT
+VsmGen::gen_reg_ite(IrNode* node,
+		    Ymsl_INT dst,
+		    VsmRegCodeList::Builder& builder)
+{
+  TypeId type_id = node->value_type()->type_id();
+  Ymsl_INT slot = target_slot(dst);
+  ymuint label1 = new_label();
+  ymuint label2 = new_label();
+
+  Ymsl_INT cond = gen_reg_expr(node->operand(0), kBooleanType, -1, builder);
+  free_temp(cond);
+  gen_reg_jump(VSM_REG_BRANCH_FALSE, cond, label1, builder);
+  gen_reg_expr(node->operand(1), type_id, slot, builder);
+  gen_reg_jump(VSM_REG_JUMP, -1, label2, builder);
+  put_label(label1, builder);
+  gen_reg_expr(node->operand(2), type_id, slot, builder);
+  put_label(label2, builder);
+  return slot;
+}
+
+// @brief 関数呼び出しのレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @param[in] call_op 呼び出し命令(VSM_REG_CALL か VSM_REG_TAIL_CALL)
+// @return 結果を格納したスロット番号を返す．
+Ymsl_INT
+VsmGen::gen_reg_funccall(IrNode* node,
+			 Ymsl_INT dst,
+			 VsmRegCodeList::Builder& builder,
+			 Ymsl_CODE call_op)
+{
+  IrHandle* func_handle = node->function_address();
+  ASSERT_COND( func_handle != NULL );
+  ASSERT_COND( func_handle->handle_type() == IrHandle::kFunction );
+
+  const Type* ftype = func_handle->value_type();
+  ymuint n = node->arglist_num();
+  ASSERT_COND( n <= ftype->function_input_num() );
+
+  // 引数と返り値の領域を確保する．
+  ymuint m = (n > 0) ? n : 1;
+  Ymsl_INT arg_base = new_temp();
+  for (ymuint i = 1; i < m; ++ i) {
+    new_temp();
+  }
+  for (ymuint i = 0; i < n; ++ i) {
+    TypeId type_id = ftype->function_input_type(i)->type_id();
+    gen_reg_expr(node->arglist_elem(i), type_id, arg_base + i, builder);
+  }
+
+  // スタックマップを作る時に返り値の型を用いる．
+  CallInfo info;
+  info.mPos = builder.size();
+  info.mArgNum = n;
+  for (ymuint i = 0; i < n; ++ i) {
+    info.mInputType.push_back(ftype->function_input_type(i)->type_id());
+  }
+  info.mOutputType = ftype->function_output_type()->type_id();
+  mCallList.push_back(info);
+
+  if ( func_handle->module_index() != 0 ) {
+    // 他のモジュールの関数は末尾呼び出しでも普通に呼び出してから戻る．
+    builder.write_opcode(VSM_REG_CALL_EXT);
+    builder.write_int(func_handle->module_index());
+    builder.write_int(func_handle->local_index());
+    builder.write_int(arg_base);
+    if ( call_op == VSM_REG_TAIL_CALL ) {
+      if ( ftype->function_output_type()->type_id() != kVoidType ) {
+	builder.write_opcode(VSM_REG_RETURN);
+	builder.write_int(arg_base);
+      }
+      else {
+	builder.write_opcode(VSM_REG_RETURN_VOID);
+      }
+    }
+  }
+  else {
+    builder.write_opcode(call_op);
+    builder.write_int(func_handle->local_index());
+    builder.write_int(arg_base);
+  }
+
+  // 返り値は arg_base に置かれる．
+  for (ymuint i = m - 1; i > 0; -- i) {
+    free_temp(arg_base + i);
+  }
+  if ( dst >= 0 && dst != arg_base ) {
+    builder.write_opcode(VSM_REG_MOVE);
+    builder.write_int(dst);
+    builder.write_int(arg_base);
+    free_temp(arg_base);
+    return dst;
+  }
+  return arg_base;
+}
+
+// @brief ロードのレジスタ型のコード生成を行う．
+// @param[in] addr アドレス
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+// @return 結果を格納したスロット番号を返す．
+Ymsl_INT
+VsmGen::gen_reg_load(IrHandle* addr,
+		     Ymsl_INT dst,
+		     VsmRegCodeList::Builder& builder)
+{
+  if ( addr->handle_type() == IrHandle::kLocalVar ) {
+    Ymsl_INT slot = local_slot(addr);
+    if ( dst >= 0 && dst != slot ) {
+      builder.write_opcode(VSM_REG_MOVE);
+      builder.write_int(dst);
+      builder.write_int(slot);
+      return dst;
+    }
+    return slot;
+  }
+
+  Ymsl_INT slot = target_slot(dst);
+  switch ( addr->handle_type() ) {
+  case IrHandle::kBooleanConst:
+    builder.write_opcode(VSM_REG_INT_IMM);
+    builder.write_int(slot);
+    builder.write_int(addr->boolean_val() ? 1 : 0);
+    break;
+
+  case IrHandle::kIntConst:
+    gen_reg_int_const(addr->int_val(), slot, builder);
+    break;
+
+  case IrHandle::kFloatConst:
+    builder.write_opcode(VSM_REG_CONST);
+    builder.write_int(slot);
+    builder.write_int(mConstPool->add_float(addr->float_val()));
+    break;
+
+  case IrHandle::kStringConst:
+    builder.write_opcode(VSM_REG_CONST);
+    builder.write_int(slot);
+    builder.write_int(mConstPool->add_string(intern_ShString(addr->string_val())));
+    break;
+
+  case IrHandle::kGlobalVar:
+    if ( addr->module_index() != 0 ) {
+      // スタックマップを作る時に変数の型を用いる．
+      mExtLoadList.push_back(make_pair(builder.size(), addr->value_type()->type_id()));
+      builder.write_opcode(VSM_REG_LOAD_EXT_GLOBAL);
+      builder.write_int(slot);
+      builder.write_int(addr->module_index());
+    }
+    else {
+      builder.write_opcode(VSM_REG_LOAD_GLOBAL);
+      builder.write_int(slot);
+    }
+    builder.write_int(addr->local_index());
+    break;
+
+  case IrHandle::kFunction:
+    builder.write_opcode(VSM_REG_INT_IMM);
+    builder.write_int(slot);
+    builder.write_int(addr->local_index());
+    break;
+
+  default:
+    // 配列やメンバの参照はまだ実装されていない．
+    ASSERT_NOT_REACHED;
+    break;
+  }
+  return slot;
+}
+
+// @brief ストアのレジスタ型のコード生成を行う．
+// @param[in] addr アドレス
+// @param[in] src 値を格納しているスロット番号
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_store(IrHandle* addr,
+		      Ymsl_INT src,
+		      VsmRegCodeList::Builder& builder)
+{
+  switch ( addr->handle_type() ) {
+  case IrHandle::kLocalVar:
+    if ( local_slot(addr) != src ) {
+      builder.write_opcode(VSM_REG_MOVE);
+      builder.write_int(local_slot(addr));
+      builder.write_int(src);
+    }
+    break;
+
+  case IrHandle::kGlobalVar:
+    if ( addr->module_index() != 0 ) {
+      builder.write_opcode(VSM_REG_STORE_EXT_GLOBAL);
+      builder.write_int(addr->module_index());
+    }
+    else {
+      builder.write_opcode(VSM_REG_STORE_GLOBAL);
+    }
+    builder.write_int(addr->local_index());
+    builder.write_int(src);
+    break;
+
+  default:
+    // 配列やメンバの参照はまだ実装されていない．
+    ASSERT_NOT_REACHED;
+    break;
+  }
+}
+
+// @brief INT の定数を読み込むレジスタ型のコード生成を行う．
+// @param[in] val 値
+// @param[in] dst 結果を格納するスロット番号
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_int_const(Ymsl_INT val,
+			  Ymsl_INT dst,
+			  VsmRegCodeList::Builder& builder)
+{
+  if ( use_const_pool(val) ) {
+    builder.write_opcode(VSM_REG_CONST);
+    builder.write_int(dst);
+    builder.write_int(mConstPool->add_int(val));
+  }
+  else {
+    builder.write_opcode(VSM_REG_INT_IMM);
+    builder.write_int(dst);
+    builder.write_int(val);
+  }
+}
+
+// @brief switch 文のレジスタ型のコード生成を行う．
+// @param[in] node 対象のノード
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_switch(IrNode* node,
+		       VsmRegCodeList::Builder& builder)
+{
+  Ymsl_INT src = gen_reg_expr(node->branch_cond(), kIntType, -1, builder);
+  ymuint n = node->case_num();
+  if ( n == 0 ) {
+    free_temp(src);
+    gen_reg_jump(VSM_REG_JUMP, -1, node->jump_addr()->id(), builder);
+    return;
+  }
+  gen_reg_case_tree(node, 0, n, src, builder);
+  free_temp(src);
+}
+
+// @brief switch 文のケースの範囲に対する分岐のレジスタ型のコード生成を行う．
+// @param[in] node switch 文のノード
+// @param[in] begin 範囲の先頭のケース番号
+// @param[in] end 範囲の末尾の次のケース番号
+// @param[in] src 選択値を格納しているスロット番号
+// @param[in] builder CodeList ビルダー
+//
+// 範囲外の値の場合は default のラベルに飛ぶ．
+void
+VsmGen::gen_reg_case_tree(IrNode* node,
+			  ymuint begin,
+			  ymuint end,
+			  Ymsl_INT src,
+			  VsmRegCodeList::Builder& builder)
+{
+  ymuint default_id = node->jump_addr()->id();
+  if ( use_jump_table(node, begin, end) ) {
+    builder.write_opcode(VSM_REG_JUMP_TABLE);
+    builder.write_int(src);
+    builder.write_int(node->case_val(begin));
+    builder.write_int(new_jump_table(node, begin, end, builder));
+    mFixupList.push_back(make_pair(builder.size(), default_id));
+    builder.write_int(0);
+  }
+  else if ( end - begin <= kMaxLinearCase ) {
+    Ymsl_INT val = new_temp();
+    Ymsl_INT cond = new_temp();
+    for (ymuint i = begin; i < end; ++ i) {
+      gen_reg_int_const(node->case_val(i), val, builder);
+      builder.write_opcode(VSM_REG_INT_EQ);
+      builder.write_int(cond);
+      builder.write_int(src);
+      builder.write_int(val);
+      gen_reg_jump(VSM_REG_BRANCH_TRUE, cond, node->case_label(i)->id(), builder);
+    }
+    free_temp(cond);
+    free_temp(val);
+    gen_reg_jump(VSM_REG_JUMP, -1, default_id, builder);
+  }
+  else {
+    // src < case_val(pos) でなければ後半に飛ぶ．
+    ymuint pos = split_pos(node, begin, end);
+    ymuint label = new_label();
+    Ymsl_INT val = new_temp();
+    Ymsl_INT cond = new_temp();
+    gen_reg_int_const(node->case_val(pos), val, builder);
+    builder.write_opcode(VSM_REG_INT_LT);
+    builder.write_int(cond);
+    builder.write_int(src);
+    builder.write_int(val);
+    free_temp(cond);
+    free_temp(val);
+    gen_reg_jump(VSM_REG_BRANCH_FALSE, cond, label, builder);
+    gen_reg_case_tree(node, begin, pos, src, builder);
+    put_label(label, builder);
+    gen_reg_case_tree(node, pos, end, src, builder);
+  }
+}
+
+// @brief レジスタ型の分岐命令のコード生成を行う．
+// @param[in] op 命令
+// @param[in] cond 条件を格納しているスロット番号
+// @param[in] label_id ジャンプ先のラベル番号
+// @param[in] builder CodeList ビルダー
+void
+VsmGen::gen_reg_jump(Ymsl_CODE op,
+		     Ymsl_INT cond,
+		     ymuint label_id,
+		     VsmRegCodeList::Builder& builder)
+{
+  builder.write_opcode(op);
+  if ( op != VSM_REG_JUMP ) {
+    builder.write_int(cond);
+  }
+  // アドレスはあとで埋める．
+  mFixupList.push_back(make_pair(builder.size(), label_id));
+  builder.write_int(0);
+}
+
+// @brief 一時変数を確保する．
+// @return スロット番号を返す．
+Ymsl_INT
+VsmGen::new_temp()
+{
+  Ymsl_INT slot = mTempTop;
+  ++ mTempTop;
+  if ( mFrameSize < mTempTop ) {
+    mFrameSize = mTempTop;
+  }
+  return slot;
+}
+
+// @brief 一時変数を解放する．
+// @param[in] slot スロット番号
+void
+VsmGen::free_temp(Ymsl_INT slot)
+{
+  if ( slot >= mVarNum ) {
+    // 一時変数は確保した順と逆順に解放される．
+    ASSERT_COND( slot == mTempTop - 1 );
+    -- mTempTop;
+  }
+}
+
+// @brief 結果を格納するスロット番号を決める．
+// @param[in] dst 指定されたスロット番号
+Ymsl_INT
+VsmGen::target_slot(Ymsl_INT dst)
+{
+  if ( dst >= 0 ) {
+    return dst;
   }
+  return new_temp();
 }
 
 END_NAMESPACE_YM_YMSL
@@ -0,0 +1,671 @@
+
+/// @file VsmHeap.cc
+/// @brief VsmHeap の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmHeap.h"
+#include "YmslObj.h"
+
+#include <cstring>
+#include <time.h>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// ごみ集めのしきい値の下限の既定値
+const ymuint kMinThreshold = 1024;
+
+// ナーサリの大きさの既定値
+const ymuint kNurserySize = 256 * 1024;
+
+// ナーサリに置くオブジェクトの大きさの上限
+const ymuint64 kMaxYoungSize = 4 * 1024;
+
+// 連結を表すノードにする文字列の長さの下限
+// これより短い連結は中身を写した方が安い．
+const ymuint kRopeMinLen = 128;
+
+// 連結を表すノードがまとめた中身のバイト数に対する
+// ごみ集めのしきい値の下限
+const ymuint64 kMinFlatThreshold = 1024 * 1024;
+
+// ナーサリに置くオブジェクトの境界
+const ymuint64 kAlign = 8;
+
+// 古い世代のごみ集めの途中で次の停止までに空ける時間の既定値(ナノ秒)
+const ymuint64 kSliceInterval = 1000 * 1000;
+
+// 時間の上限を調べる間隔(オブジェクトの数)
+const ymuint kCheckInterval = 256;
+
+// 経過時間をナノ秒単位で得る．
+ymuint64
+get_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<ymuint64>(ts.tv_sec) * 1000000000U + ts.tv_nsec;
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmHeap
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+VsmHeap::VsmHeap() :
+  mNurseryStart(NULL),
+  mYoungNum(0),
+  mState(kIdle),
+  mSweepEnd(0),
+  mSweepPos(0),
+  mSweepWPos(0),
+  mTimeSlice(0),
+  mSliceInterval(kSliceInterval),
+  mPauseStart(0),
+  mNextSlice(0),
+  mMinThreshold(kMinThreshold),
+  mThreshold(kMinThreshold),
+  mFlatSize(0),
+  mFlatThreshold(kMinFlatThreshold),
+  mCollectNum(0),
+  mMinorCollectNum(0)
+{
+  set_nursery_size(kNurserySize);
+  clear_pause_histogram();
+}
+
+// @brief デストラクタ
+//
+// ナーサリには集合や連想配列を置かないので丸ごと解放すればよい．
+VsmHeap::~VsmHeap()
+{
+  if ( mState == kSweeping ) {
+    // 解放の途中なら mObjList に解放済みのものが残っているので
+    // 先に最後まで解放する．
+    mTimeSlice = 0;
+    sweep_step();
+  }
+  for (vector<YmslObj*>::iterator p = mObjList.begin();
+       p != mObjList.end(); ++ p) {
+    YmslObj::destroy(*p);
+  }
+  delete [] mNurseryStart;
+}
+
+// @brief 文字列を作る．
+// @param[in] str 文字列
+// @param[in] len 文字数
+YmslString*
+VsmHeap::new_string(const char* str,
+		    ymuint len)
+{
+  void* p = alloc_young(YmslString::alloc_size(len));
+  if ( p != NULL ) {
+    return YmslString::new_obj(p, str, len);
+  }
+
+  YmslString* obj = YmslString::new_obj(str, len);
+  reg_obj(obj);
+  return obj;
+}
+
+// @brief 二つの文字列をつないだ文字列を作る．
+// @param[in] str1, str2 文字列
+//
+// 長い文字列は中身を写さずに連結を表すノードを作る．
+// ノードは子供を指すので古い世代に置いて覚えておく．
+YmslString*
+VsmHeap::new_string(const YmslString* str1,
+		    const YmslString* str2)
+{
+  if ( str1->size() + str2->size() >= kRopeMinLen ) {
+    YmslString* obj = YmslString::new_rope(this, str1, str2);
+    reg_obj(obj);
+    return obj;
+  }
+
+  void* p = alloc_young(YmslString::alloc_size(str1->size() + str2->size()));
+  if ( p != NULL ) {
+    return YmslString::new_obj(p, str1, str2);
+  }
+
+  YmslString* obj = YmslString::new_obj(str1, str2);
+  reg_obj(obj);
+  return obj;
+}
+
+// @brief 配列を作る．
+// @param[in] type 配列の型
+// @param[in] size 要素数
+YmslArray*
+VsmHeap::new_array(const Type* type,
+		   ymuint size)
+{
+  void* p = alloc_young(YmslArray::alloc_size(type, size));
+  if ( p != NULL ) {
+    return YmslArray::new_obj(p, type, size);
+  }
+
+  YmslArray* obj = YmslArray::new_obj(type, size);
+  reg_obj(obj);
+  return obj;
+}
+
+// @brief 二つの配列をつないだ配列を作る．
+// @param[in] array1, array2 配列
+YmslArray*
+VsmHeap::new_array(const YmslArray* array1,
+		   const YmslArray* array2)
+{
+  void* p = alloc_young(YmslArray::alloc_size(array1->type(),
+					       array1->size() + array2->size()));
+  if ( p != NULL ) {
+    return YmslArray::new_obj(p, array1, array2);
+  }
+
+  YmslArray* obj = YmslArray::new_obj(array1, array2);
+  reg_obj(obj);
+  return obj;
+}
+
+// @brief 空の集合か連想配列を作る．
+// @param[in] type 集合か連想配列の型
+//
+// 表を別に確保するのでナーサリには置かない．
+YmslSet*
+VsmHeap::new_set(const Type* type)
+{
+  YmslSet* obj = YmslSet::new_obj(type);
+  reg_obj(obj);
+  return obj;
+}
+
+// @brief 管理しているオブジェクトの数を返す．
+ymuint
+VsmHeap::obj_num() const
+{
+  return mObjList.size() + mYoungNum;
+}
+
+// @brief ごみ集めのしきい値の下限を設定する．
+// @param[in] num オブジェクトの数
+void
+VsmHeap::set_collect_threshold(ymuint num)
+{
+  mMinThreshold = num;
+  if ( mThreshold < num ) {
+    mThreshold = num;
+  }
+}
+
+// @brief ナーサリの大きさを設定する．
+// @param[in] size バイト数
+//
+// 残りが 1/4 を切ったらごみ集めを行う．
+void
+VsmHeap::set_nursery_size(ymuint size)
+{
+  ASSERT_COND( mYoungNum == 0 );
+
+  delete [] mNurseryStart;
+  mNurseryStart = new ymuint8[size];
+  mNurseryTop = mNurseryStart;
+  mNurseryEnd = mNurseryStart + size;
+  mNurseryLimit = mNurseryEnd - size / 4;
+}
+
+// @brief 一回の停止でごみ集めを行う時間の上限を設定する．
+// @param[in] usec マイクロ秒
+void
+VsmHeap::set_time_slice(ymuint usec)
+{
+  mTimeSlice = static_cast<ymuint64>(usec) * 1000;
+}
+
+// @brief 古い世代のごみ集めの途中で次の停止までに空ける時間を設定する．
+// @param[in] usec マイクロ秒
+void
+VsmHeap::set_slice_interval(ymuint usec)
+{
+  mSliceInterval = static_cast<ymuint64>(usec) * 1000;
+}
+
+// @brief 古い世代のごみ集めの途中で次の停止を行う時 true を返す．
+//
+// 作る速さに解放が追いつかない場合は間を空けない．
+bool
+VsmHeap::slice_due() const
+{
+  if ( mObjList.size() >= mThreshold * 2 ||
+       mFlatSize >= mFlatThreshold * 2 ) {
+    return true;
+  }
+  return get_time() >= mNextSlice;
+}
+
+// @brief 古い世代のごみ集めを最後まで行った回数を返す．
+ymuint
+VsmHeap::collect_num() const
+{
+  return mCollectNum;
+}
+
+// @brief 若い世代のごみ集めを行った回数を返す．
+ymuint
+VsmHeap::minor_collect_num() const
+{
+  return mMinorCollectNum;
+}
+
+// @brief 根のスロットが指す若いオブジェクトを古い世代に写す．
+// @param[in] obj 根のスロット
+//
+// 写したオブジェクトに抜け殻の印と写した先を書いておく．
+// ナーサリにはオブジェクトを指しうるものが配列しかないので，
+// 要素を辿る必要があるのは kObjArray だけ．
+void
+VsmHeap::forward(Ymsl_OBJPTR& obj)
+{
+  if ( !is_young(obj) ) {
+    return;
+  }
+  if ( obj->is_forwarded() ) {
+    obj = obj->forward_addr();
+    return;
+  }
+
+  ymuint64 size = obj->alloc_size();
+  void* p = YmslObj::alloc(static_cast<ymuint>(size), 0);
+  memcpy(p, obj, size);
+  YmslObj* new_obj = static_cast<YmslObj*>(p);
+  obj->set_forward(new_obj);
+  mObjList.push_back(new_obj);
+  if ( new_obj->kind() == YmslObj::kObjArray ) {
+    mPromoteList.push_back(new_obj);
+  }
+  if ( mState == kMarking ) {
+    // 印つけの途中で古い世代に加わったものは灰色にする．
+    mark(new_obj);
+  }
+  obj = new_obj;
+}
+
+// @brief 若い世代のごみ集めを終える．
+//
+// 写したオブジェクトの要素もまた写すので mPromoteList は
+// 処理中にも伸びる．
+void
+VsmHeap::minor_collect()
+{
+  for (vector<YmslObj*>::iterator p = mRememberList.begin();
+       p != mRememberList.end(); ++ p) {
+    forward_children(*p);
+  }
+  mRememberList.clear();
+
+  for (ymuint i = 0; i < mPromoteList.size(); ++ i) {
+    forward_children(mPromoteList[i]);
+  }
+  mPromoteList.clear();
+
+  mNurseryTop = mNurseryStart;
+  mYoungNum = 0;
+  ++ mMinorCollectNum;
+}
+
+// @brief オブジェクトに印をつけて灰色にする．
+// @param[in] obj オブジェクト
+void
+VsmHeap::mark(Ymsl_OBJPTR obj)
+{
+  if ( obj == NULL || obj->is_static() || is_young(obj) || obj->is_marked() ) {
+    return;
+  }
+  obj->set_mark();
+  mMarkStack.push_back(obj);
+}
+
+// @brief 印つけを始める．
+void
+VsmHeap::start_mark()
+{
+  ASSERT_COND( mState == kIdle );
+  ASSERT_COND( mYoungNum == 0 );
+
+  mState = kMarking;
+}
+
+// @brief 灰色のオブジェクトの要素に印をつける．
+// @return 灰色のオブジェクトがなくなったら true を返す．
+//
+// 再帰呼び出しの代わりに mMarkStack を用いる．
+bool
+VsmHeap::mark_step()
+{
+  ASSERT_COND( mState == kMarking );
+
+  for (ymuint n = 1; !mMarkStack.empty(); ++ n) {
+    YmslObj* obj = mMarkStack.back();
+    mMarkStack.pop_back();
+    mark_children(obj);
+    if ( n % kCheckInterval == 0 && time_over() ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @brief 印つけを終える．
+//
+// 解放するのは今ある古い世代のオブジェクトだけ．
+void
+VsmHeap::finish_mark()
+{
+  ASSERT_COND( mState == kMarking );
+  ASSERT_COND( mYoungNum == 0 );
+
+  while ( !mMarkStack.empty() ) {
+    YmslObj* obj = mMarkStack.back();
+    mMarkStack.pop_back();
+    mark_children(obj);
+  }
+
+  mState = kSweeping;
+  mSweepEnd = mObjList.size();
+  mSweepPos = 0;
+  mSweepWPos = 0;
+}
+
+// @brief 印のないオブジェクトを解放する．
+// @return 最後まで解放したら true を返す．
+//
+// 生き残ったものは mObjList の前に詰める．途中で加わったものは
+// 最後に生き残ったものの後ろに移す．
+// しきい値は生き残った数の2倍にする．連結を表すノードがまとめた
+// 中身のバイト数のしきい値も同じく残ったバイト数の2倍にする．
+bool
+VsmHeap::sweep_step()
+{
+  ASSERT_COND( mState == kSweeping );
+
+  for (ymuint n = 1; mSweepPos < mSweepEnd; ++ n) {
+    YmslObj* obj = mObjList[mSweepPos];
+    ++ mSweepPos;
+    if ( obj->is_marked() ) {
+      obj->clear_mark();
+      mObjList[mSweepWPos] = obj;
+      ++ mSweepWPos;
+    }
+    else {
+      if ( obj->kind() == YmslObj::kString &&
+	   static_cast<YmslString*>(obj)->is_rope() ) {
+	YmslRope* rope = static_cast<YmslRope*>(obj);
+	if ( rope->mFlat != NULL ) {
+	  mFlatSize -= static_cast<ymuint64>(rope->size()) + 1;
+	}
+      }
+      YmslObj::destroy(obj);
+    }
+    if ( n % kCheckInterval == 0 && time_over() ) {
+      return false;
+    }
+  }
+
+  ymuint nlive = mSweepWPos;
+  for (ymuint i = mSweepEnd; i < mObjList.size(); ++ i) {
+    mObjList[mSweepWPos] = mObjList[i];
+    ++ mSweepWPos;
+  }
+  mObjList.erase(mObjList.begin() + mSweepWPos, mObjList.end());
+
+  mThreshold = nlive * 2;
+  if ( mThreshold < mMinThreshold ) {
+    mThreshold = mMinThreshold;
+  }
+  mFlatThreshold = mFlatSize * 2;
+  if ( mFlatThreshold < kMinFlatThreshold ) {
+    mFlatThreshold = kMinFlatThreshold;
+  }
+  mState = kIdle;
+  ++ mCollectNum;
+  return true;
+}
+
+// @brief ごみ集めの停止の始まりを記録する．
+void
+VsmHeap::begin_pause()
+{
+  mPauseStart = get_time();
+}
+
+// @brief ごみ集めの停止の終わりを記録する．
+void
+VsmHeap::end_pause()
+{
+  ymuint64 now = get_time();
+  ymuint64 pause = now - mPauseStart;
+  mNextSlice = now + mSliceInterval;
+
+  ymuint bucket = 0;
+  for (ymuint64 usec = pause / 1000; usec > 0; usec >>= 1) {
+    ++ bucket;
+  }
+  if ( bucket >= kPauseBucketNum ) {
+    bucket = kPauseBucketNum - 1;
+  }
+  ++ mPauseCount[bucket];
+  if ( mMaxPause < pause ) {
+    mMaxPause = pause;
+  }
+  mTotalPause += pause;
+}
+
+// @brief 停止時間のヒストグラムの区間の停止の回数を返す．
+// @param[in] bucket 区間 ( 0 <= bucket < kPauseBucketNum )
+ymuint
+VsmHeap::pause_count(ymuint bucket) const
+{
+  ASSERT_COND( bucket < kPauseBucketNum );
+  return mPauseCount[bucket];
+}
+
+// @brief 最も長い停止時間(ナノ秒)を返す．
+ymuint64
+VsmHeap::max_pause() const
+{
+  return mMaxPause;
+}
+
+// @brief 停止時間の合計(ナノ秒)を返す．
+ymuint64
+VsmHeap::total_pause() const
+{
+  return mTotalPause;
+}
+
+// @brief 停止時間の記録を消す．
+void
+VsmHeap::clear_pause_histogram()
+{
+  for (ymuint i = 0; i < kPauseBucketNum; ++ i) {
+    mPauseCount[i] = 0;
+  }
+  mMaxPause = 0;
+  mTotalPause = 0;
+}
+
+// @brief ナーサリから領域を確保する．
+// @param[in] size バイト数
+// @return 確保した領域を返す．
+void*
+VsmHeap::alloc_young(ymuint64 size)
+{
+  if ( size > kMaxYoungSize ) {
+    return NULL;
+  }
+  size = (size + kAlign - 1) & ~(kAlign - 1);
+  if ( size > static_cast<ymuint64>(mNurseryEnd - mNurseryTop) ) {
+    return NULL;
+  }
+  void* p = mNurseryTop;
+  mNurseryTop += size;
+  ++ mYoungNum;
+  return p;
+}
+
+// @brief オブジェクトを古い世代に登録する．
+// @param[in] obj オブジェクト
+//
+// 他のオブジェクトを指しうるものは次の minor_collect() で
+// 要素を辿るために覚えておく．
+void
+VsmHeap::reg_obj(YmslObj* obj)
+{
+  mObjList.push_back(obj);
+  switch ( obj->kind() ) {
+  case YmslObj::kString:
+    if ( static_cast<YmslString*>(obj)->is_rope() ) {
+      mRememberList.push_back(obj);
+    }
+    break;
+
+  case YmslObj::kObjArray:
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    mRememberList.push_back(obj);
+    break;
+
+  default:
+    break;
+  }
+  if ( mState == kMarking ) {
+    // 要素はこれから入れるので黒ではなく灰色にする．
+    mark(obj);
+  }
+}
+
+// @brief オブジェクトの要素を forward() する．
+// @param[in] obj オブジェクト
+//
+// 集合のキーのハッシュ値は内容から求めるので，
+// キーが動いても表は作り直さなくてよい．
+void
+VsmHeap::forward_children(YmslObj* obj)
+{
+  switch ( obj->kind() ) {
+  case YmslObj::kString:
+    if ( static_cast<YmslString*>(obj)->is_rope() ) {
+      YmslRope* rope = static_cast<YmslRope*>(obj);
+      forward(rope->mLeft);
+      forward(rope->mRight);
+    }
+    break;
+
+  case YmslObj::kObjArray:
+    {
+      YmslArray* array = static_cast<YmslArray*>(obj);
+      Ymsl_OBJPTR* body = array->obj_body();
+      for (ymuint i = 0; i < array->size(); ++ i) {
+	forward(body[i]);
+      }
+    }
+    break;
+
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    {
+      YmslSet* set = static_cast<YmslSet*>(obj);
+      bool obj_key = (set->key_class() == YmslObj::kClassObj);
+      bool obj_value = (obj->kind() == YmslObj::kMap &&
+			set->value_class() == YmslObj::kClassObj);
+      for (ymuint i = 0; i < set->table_size(); ++ i) {
+	if ( !set->is_used(i) ) {
+	  continue;
+	}
+	if ( obj_key ) {
+	  forward(set->mKeyTable[i].obj_value);
+	}
+	if ( obj_value ) {
+	  forward(set->mValueTable[i].obj_value);
+	}
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+// @brief 灰色のオブジェクトの要素に印をつける．
+// @param[in] obj オブジェクト
+void
+VsmHeap::mark_children(YmslObj* obj)
+{
+  switch ( obj->kind() ) {
+  case YmslObj::kString:
+    if ( static_cast<YmslString*>(obj)->is_rope() ) {
+      // 中身をまとめた後は NULL になっている．
+      YmslRope* rope = static_cast<YmslRope*>(obj);
+      mark(rope->mLeft);
+      mark(rope->mRight);
+    }
+    break;
+
+  case YmslObj::kObjArray:
+    {
+      YmslArray* array = static_cast<YmslArray*>(obj);
+      Ymsl_OBJPTR* body = array->obj_body();
+      for (ymuint i = 0; i < array->size(); ++ i) {
+	mark(body[i]);
+      }
+    }
+    break;
+
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    {
+      YmslSet* set = static_cast<YmslSet*>(obj);
+      bool obj_key = (set->key_class() == YmslObj::kClassObj);
+      bool obj_value = (obj->kind() == YmslObj::kMap &&
+			set->value_class() == YmslObj::kClassObj);
+      if ( !obj_key && !obj_value ) {
+	break;
+      }
+      for (ymuint i = 0; i < set->table_size(); ++ i) {
+	if ( !set->is_used(i) ) {
+	  continue;
+	}
+	if ( obj_key ) {
+	  mark(set->key(i).obj_value);
+	}
+	if ( obj_value ) {
+	  mark(set->value(i).obj_value);
+	}
+      }
+    }
+    break;
+
+  default:
+    // INT，FLOAT の配列は他のオブジェクトを指さない．
+    break;
+  }
+}
+
+// @brief 時間の上限を超えた時 true を返す．
+bool
+VsmHeap::time_over() const
+{
+  return mTimeSlice > 0 && get_time() - mPauseStart >= mTimeSlice;
+}
+
+END_NAMESPACE_YM_YMSL
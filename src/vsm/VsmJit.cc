@@ -0,0 +1,1470 @@
+
+/// @file VsmJit.cc
+/// @brief VsmJit の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmJit.h"
+#include "VsmNativeFunc.h"
+#include "VsmCodeList.h"
+#include "Vsm.h"
+#include "YmslObj.h"
+#include "Type.h"
+#include <cstddef>
+#include <cstring>
+
+#if defined(YMSL_USE_JIT)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// x86-64 の汎用レジスタ
+enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// 条件コード
+enum {
+  CC_B  = 0x2,
+  CC_AE = 0x3,
+  CC_E  = 0x4,
+  CC_NE = 0x5,
+  CC_A  = 0x7,
+  CC_P  = 0xA,
+  CC_NP = 0xB,
+  CC_L  = 0xC,
+  CC_GE = 0xD,
+  CC_LE = 0xE,
+  CC_G  = 0xF
+};
+
+// 仮想マシンを保持するレジスタ
+const int kVsmReg = R12;
+
+// フレームの先頭を保持するレジスタ
+const int kFrameReg = R13;
+
+// グローバル変数領域を保持するレジスタ
+const int kGlobalReg = R14;
+
+// スタックの値を置くレジスタ
+const int kStackRegList[] = { R8, R9, R10, R11, RBX, R15 };
+
+// kStackRegList の要素数
+const Ymsl_INT kStackRegNum = sizeof(kStackRegList) / sizeof(int);
+
+// VsmValue のバイト数
+const Ymsl_INT kValueSize = sizeof(VsmValue);
+
+// 関数の引数か返り値に OBJ の値がある時 true を返す．
+//
+// JIT コンパイルしたコードのフレームはスタックマップで辿れないので
+// OBJ の値を持つ関数やそれを呼び出す関数はコンパイルしない．
+bool
+has_obj_value(const Type* ftype)
+{
+  ymuint n = ftype->function_input_num();
+  for (ymuint i = 0; i < n; ++ i) {
+    if ( YmslObj::val_class(ftype->function_input_type(i)) == YmslObj::kClassObj ) {
+      return true;
+    }
+  }
+  const Type* otype = ftype->function_output_type();
+  if ( otype->type_id() != kVoidType &&
+       YmslObj::val_class(otype) == YmslObj::kClassObj ) {
+    return true;
+  }
+  return false;
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmJitCode
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] mem 確保した領域
+// @param[in] size 領域のサイズ
+VsmJitCode::VsmJitCode(void* mem,
+		       ymuint size) :
+  mMem(mem),
+  mSize(size)
+{
+}
+
+// @brief デストラクタ
+VsmJitCode::~VsmJitCode()
+{
+#if defined(YMSL_USE_JIT)
+  munmap(mMem, mSize);
+#endif
+}
+
+// @brief 関数の入口を返す．
+VsmJitCode::Entry
+VsmJitCode::entry() const
+{
+  return reinterpret_cast<Entry>(mMem);
+}
+
+// @brief 関数の入口を保持しているメンバのオフセットを返す．
+ymuint
+VsmJitCode::entry_offset()
+{
+  return offsetof(VsmJitCode, mMem);
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmJit
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] vsm 仮想マシン
+VsmJit::VsmJit(Vsm& vsm) :
+  mVsm(vsm)
+{
+}
+
+// @brief デストラクタ
+VsmJit::~VsmJit()
+{
+}
+
+// @brief 関数をコンパイルする．
+// @param[in] func 対象の関数
+// @param[in] code_list func のコード
+// @return コンパイルしたコードを返す．
+VsmJitCode*
+VsmJit::compile(const VsmNativeFunc* func,
+		const VsmCodeList& code_list)
+{
+#if defined(YMSL_USE_JIT)
+  if ( has_obj_value(func->type()) ) {
+    return NULL;
+  }
+
+  if ( !calc_depth(code_list, func->arg_num()) ) {
+    return NULL;
+  }
+
+  gen_code(func, code_list);
+
+  return install();
+#else
+  return NULL;
+#endif
+}
+
+// @brief コンパイルしたコードを実行する．
+// @param[in] code コード
+// @param[in] vsm 仮想マシン
+// @param[in] base ベースレジスタ
+void
+VsmJit::execute(const VsmJitCode& code,
+		Vsm& vsm,
+		Ymsl_INT base)
+{
+  VsmJitCode::Entry entry = code.entry();
+  (*entry)(&vsm, vsm.mLocalStack + base, vsm.mGlobalHeap);
+}
+
+// @brief 各命令位置でのスタックの深さを求める．
+// @param[in] code_list コード
+// @param[in] arg_num 引数の数
+// @return 対応していない命令を含む場合や深さが矛盾する場合は false を返す．
+bool
+VsmJit::calc_depth(const VsmCodeList& code_list,
+		   ymuint arg_num)
+{
+  Ymsl_INT size = code_list.size();
+  mDepth.clear();
+  mDepth.resize(size + 1, -1);
+  mVarNum = arg_num;
+
+  vector<Ymsl_INT> queue;
+  mDepth[0] = arg_num;
+  queue.push_back(0);
+  while ( !queue.empty() ) {
+    Ymsl_INT pc0 = queue.back();
+    queue.pop_back();
+
+    Ymsl_INT depth = mDepth[pc0];
+    Ymsl_INT pc = pc0;
+    Ymsl_CODE op = code_list.read_opcode(pc);
+    Ymsl_INT n_pop = 0;
+    Ymsl_INT n_push = 0;
+    Ymsl_INT target = -1;
+    bool fall_through = true;
+    // 参照しているローカル変数の最大の番号
+    Ymsl_INT max_var = -1;
+    switch ( op ) {
+    case VSM_NOP:
+      break;
+
+    case VSM_PUSH_INT_IMM:
+      code_list.read_int(pc);
+      n_push = 1;
+      break;
+
+    case VSM_PUSH_FLOAT_IMM:
+      code_list.read_float(pc);
+      n_push = 1;
+      break;
+
+    case VSM_PUSH_CONST:
+      code_list.read_int(pc);
+      n_push = 1;
+      break;
+
+    case VSM_PUSH_FLOAT_ZERO:
+    case VSM_PUSH_FLOAT_ONE:
+      n_push = 1;
+      break;
+
+    case VSM_POP:
+      n_pop = 1;
+      break;
+
+    case VSM_LOAD_GLOBAL_INT:
+    case VSM_LOAD_GLOBAL_FLOAT:
+      code_list.read_int(pc);
+      n_push = 1;
+      break;
+
+    case VSM_LOAD_LOCAL_INT:
+    case VSM_LOAD_LOCAL_FLOAT:
+      max_var = code_list.read_int(pc);
+      n_push = 1;
+      break;
+
+    case VSM_STORE_GLOBAL_INT:
+    case VSM_STORE_GLOBAL_FLOAT:
+      code_list.read_int(pc);
+      n_pop = 1;
+      break;
+
+    case VSM_STORE_LOCAL_INT:
+    case VSM_STORE_LOCAL_FLOAT:
+      max_var = code_list.read_int(pc);
+      n_pop = 1;
+      break;
+
+    case VSM_INT_MINUS:
+    case VSM_INT_INC:
+    case VSM_INT_DEC:
+    case VSM_INT_NOT:
+    case VSM_INT_TO_BOOL:
+    case VSM_INT_TO_FLOAT:
+    case VSM_FLOAT_MINUS:
+    case VSM_FLOAT_TO_BOOL:
+    case VSM_FLOAT_TO_INT:
+      n_pop = 1;
+      n_push = 1;
+      break;
+
+    case VSM_INT_ADD:
+    case VSM_INT_SUB:
+    case VSM_INT_MUL:
+    case VSM_INT_DIV:
+    case VSM_INT_MOD:
+    case VSM_INT_LSHIFT:
+    case VSM_INT_RSHIFT:
+    case VSM_INT_EQ:
+    case VSM_INT_NE:
+    case VSM_INT_LT:
+    case VSM_INT_LE:
+    case VSM_INT_AND:
+    case VSM_INT_OR:
+    case VSM_INT_XOR:
+    case VSM_FLOAT_ADD:
+    case VSM_FLOAT_SUB:
+    case VSM_FLOAT_MUL:
+    case VSM_FLOAT_DIV:
+    case VSM_FLOAT_EQ:
+    case VSM_FLOAT_NE:
+    case VSM_FLOAT_LT:
+    case VSM_FLOAT_LE:
+      n_pop = 2;
+      n_push = 1;
+      break;
+
+    case VSM_INT_ITE:
+    case VSM_FLOAT_ITE:
+      n_pop = 3;
+      n_push = 1;
+      break;
+
+    case VSM_JUMP:
+      target = code_list.read_int(pc);
+      fall_through = false;
+      break;
+
+    case VSM_BRANCH_TRUE:
+    case VSM_BRANCH_FALSE:
+      target = code_list.read_int(pc);
+      n_pop = 1;
+      break;
+
+    case VSM_CALL:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	if ( index < 0 || index >= mVsm.mFuncTableSize ) {
+	  return false;
+	}
+	const VsmFunction* callee = mVsm.mFuncTable[index];
+	if ( has_obj_value(callee->type()) ) {
+	  return false;
+	}
+	n_pop = callee->arg_num();
+	n_push = callee->has_return_value() ? 1 : 0;
+      }
+      break;
+
+    case VSM_TAIL_CALL:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	if ( index < 0 || index >= mVsm.mFuncTableSize ) {
+	  return false;
+	}
+	const VsmFunction* callee = mVsm.mFuncTable[index];
+	if ( has_obj_value(callee->type()) ) {
+	  return false;
+	}
+	n_pop = callee->arg_num();
+	fall_through = false;
+      }
+      break;
+
+    case VSM_RETURN:
+      n_pop = 1;
+      fall_through = false;
+      break;
+
+    case VSM_RETURN_VOID:
+      fall_through = false;
+      break;
+
+    case VSM_LOCAL_INT_INC:
+    case VSM_LOCAL_INT_DEC:
+      max_var = code_list.read_int(pc);
+      break;
+
+    case VSM_LOCAL_INT_ADD_IMM:
+      max_var = code_list.read_int(pc);
+      code_list.read_int(pc);
+      break;
+
+    case VSM_PUSH_INT_IMM_LOAD_LOCAL_INT:
+      code_list.read_int(pc);
+      max_var = code_list.read_int(pc);
+      n_push = 2;
+      break;
+
+    case VSM_INT_EQ_BRANCH_FALSE:
+    case VSM_INT_NE_BRANCH_FALSE:
+    case VSM_INT_LT_BRANCH_FALSE:
+    case VSM_INT_LE_BRANCH_FALSE:
+      target = code_list.read_int(pc);
+      n_pop = 2;
+      break;
+
+    case VSM_LOCAL_INT_LT_BRANCH_FALSE:
+      {
+	Ymsl_INT index1 = code_list.read_int(pc);
+	Ymsl_INT index2 = code_list.read_int(pc);
+	max_var = (index1 > index2) ? index1 : index2;
+	target = code_list.read_int(pc);
+      }
+      break;
+
+    case VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE:
+      max_var = code_list.read_int(pc);
+      code_list.read_int(pc);
+      target = code_list.read_int(pc);
+      break;
+
+    default:
+      // 対応していない命令
+      return false;
+    }
+
+    if ( depth < n_pop ) {
+      return false;
+    }
+    if ( max_var >= mVarNum ) {
+      mVarNum = max_var + 1;
+    }
+
+    Ymsl_INT depth1 = depth - n_pop + n_push;
+    if ( target >= 0 ) {
+      if ( target >= size ) {
+	return false;
+      }
+      if ( mDepth[target] == -1 ) {
+	mDepth[target] = depth1;
+	queue.push_back(target);
+      }
+      else if ( mDepth[target] != depth1 ) {
+	return false;
+      }
+    }
+    if ( fall_through ) {
+      if ( pc >= size ) {
+	return false;
+      }
+      if ( mDepth[pc] == -1 ) {
+	mDepth[pc] = depth1;
+	queue.push_back(pc);
+      }
+      else if ( mDepth[pc] != depth1 ) {
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// @brief 機械語を生成する．
+// @param[in] func 対象の関数
+// @param[in] code_list コード
+void
+VsmJit::gen_code(const VsmNativeFunc* func,
+		 const VsmCodeList& code_list)
+{
+  Ymsl_INT size = code_list.size();
+  mBuff.clear();
+  mOffset.clear();
+  mOffset.resize(size + 1, 0);
+  mFixupList.clear();
+
+  // プロローグ
+  // 6 個のレジスタを退避した後で 16 バイト境界に合わせる．
+  emit8(0x55);              // push rbp
+  emit8(0x53);              // push rbx
+  emit8(0x41); emit8(0x54); // push r12
+  emit8(0x41); emit8(0x55); // push r13
+  emit8(0x41); emit8(0x56); // push r14
+  emit8(0x41); emit8(0x57); // push r15
+  emit_rr(true, 0x83, 5, RSP); emit8(8); // sub rsp, 8
+  emit_rr(true, 0x89, RDI, kVsmReg);
+  emit_rr(true, 0x89, RSI, kFrameReg);
+  emit_rr(true, 0x89, RDX, kGlobalReg);
+
+  // フレームがローカルスタックに収まるか調べる．
+  // R12 はベースに使えないので仮想マシンのアドレスを RAX に移す．
+  const char* vsm_addr = reinterpret_cast<const char*>(&mVsm);
+  Ymsl_INT stack_off = reinterpret_cast<const char*>(&mVsm.mLocalStack) - vsm_addr;
+  Ymsl_INT size_off = reinterpret_cast<const char*>(&mVsm.mLocalStackSize) - vsm_addr;
+  Ymsl_INT limit_off = reinterpret_cast<const char*>(&mVsm.mNativeStackLimit) - vsm_addr;
+  emit_rr(true, 0x89, kVsmReg, RAX);
+  emit_rm(true, 0x63, RCX, RAX, size_off);  // movsxd rcx, [rax + size_off]
+  emit_rr(true, 0xC1, 4, RCX); emit8(3);    // shl rcx, 3
+  emit_rm(true, 0x03, RCX, RAX, stack_off); // add rcx, [rax + stack_off]
+  emit_rm(true, 0x8D, RDX, kFrameReg, func->frame_size() * kValueSize); // lea
+  emit_rr(true, 0x39, RCX, RDX);            // cmp rdx, rcx
+  emit8(0x0F); emit8(0x80 | CC_A);          // ja rel32
+  ymuint grow_pos = mBuff.size();
+  emit32(0);
+  ymuint grow_ret = mBuff.size();
+
+  // C++ のスタックが残り少なければこの呼び出しはインタプリタで行う．
+  emit_rm(true, 0x3B, RSP, RAX, limit_off); // cmp rsp, [rax + limit_off]
+  emit8(0x0F); emit8(0x80 | CC_B);          // jb rel32
+  ymuint interp_pos = mBuff.size();
+  emit32(0);
+
+  for (Ymsl_INT pc = 0; pc < size; ) {
+    mOffset[pc] = mBuff.size();
+    Ymsl_INT d = mDepth[pc];
+    Ymsl_CODE op = code_list.read_opcode(pc);
+    if ( d < 0 ) {
+      // 到達しないのでコードは生成しない．
+      code_list.skip_operands(op, pc);
+      continue;
+    }
+
+    switch ( op ) {
+    case VSM_NOP:
+      break;
+
+    case VSM_PUSH_INT_IMM:
+      {
+	Ymsl_INT val = code_list.read_int(pc);
+	int r = stack_reg(d);
+	if ( r >= 0 ) {
+	  emit_mov_imm(r, val);
+	}
+	else {
+	  emit_rm(false, 0xC7, 0, kFrameReg, d * kValueSize);
+	  emit32(val);
+	}
+      }
+      break;
+
+    case VSM_PUSH_FLOAT_IMM:
+    case VSM_PUSH_FLOAT_ZERO:
+    case VSM_PUSH_FLOAT_ONE:
+      {
+	union {
+	  Ymsl_FLOAT fval;
+	  ymuint64 bits;
+	} buf;
+	if ( op == VSM_PUSH_FLOAT_IMM ) {
+	  buf.fval = code_list.read_float(pc);
+	}
+	else if ( op == VSM_PUSH_FLOAT_ZERO ) {
+	  buf.fval = 0.0;
+	}
+	else {
+	  buf.fval = 1.0;
+	}
+	emit_mov_imm64(RAX, buf.bits);
+	store_raw(d, RAX);
+      }
+      break;
+
+    case VSM_PUSH_CONST:
+      {
+	// 定数表はモジュールの実行中は変わらないので値を埋め込む．
+	Ymsl_INT index = code_list.read_int(pc);
+	ymuint64 bits;
+	memcpy(&bits, &mVsm.mConstTable[index], sizeof(ymuint64));
+	emit_mov_imm64(RAX, bits);
+	store_raw(d, RAX);
+      }
+      break;
+
+    case VSM_POP:
+      break;
+
+    case VSM_LOAD_GLOBAL_INT:
+    case VSM_LOAD_GLOBAL_FLOAT:
+    case VSM_LOAD_LOCAL_INT:
+    case VSM_LOAD_LOCAL_FLOAT:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	bool is_float = (op == VSM_LOAD_GLOBAL_FLOAT || op == VSM_LOAD_LOCAL_FLOAT);
+	bool is_global = (op == VSM_LOAD_GLOBAL_INT || op == VSM_LOAD_GLOBAL_FLOAT);
+	int base = is_global ? kGlobalReg : kFrameReg;
+	int r = stack_reg(d);
+	int dst = (r >= 0) ? r : RAX;
+	emit_rm(is_float, 0x8B, dst, base, index * kValueSize);
+	if ( r < 0 ) {
+	  store_raw(d, RAX);
+	}
+      }
+      break;
+
+    case VSM_STORE_GLOBAL_INT:
+    case VSM_STORE_GLOBAL_FLOAT:
+    case VSM_STORE_LOCAL_INT:
+    case VSM_STORE_LOCAL_FLOAT:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	bool is_float = (op == VSM_STORE_GLOBAL_FLOAT || op == VSM_STORE_LOCAL_FLOAT);
+	bool is_global = (op == VSM_STORE_GLOBAL_INT || op == VSM_STORE_GLOBAL_FLOAT);
+	int base = is_global ? kGlobalReg : kFrameReg;
+	int r = stack_reg(d - 1);
+	if ( r < 0 ) {
+	  load_raw(RAX, d - 1);
+	  r = RAX;
+	}
+	emit_rm(is_float, 0x89, r, base, index * kValueSize);
+      }
+      break;
+
+    case VSM_INT_MINUS:
+    case VSM_INT_INC:
+    case VSM_INT_DEC:
+    case VSM_INT_NOT:
+      load_int(RAX, d - 1);
+      switch ( op ) {
+      case VSM_INT_MINUS: emit_rr(false, 0xF7, 3, RAX); break;
+      case VSM_INT_INC:   emit_rr(false, 0x83, 0, RAX); emit8(1); break;
+      case VSM_INT_DEC:   emit_rr(false, 0x83, 5, RAX); emit8(1); break;
+      case VSM_INT_NOT:   emit_rr(false, 0xF7, 2, RAX); break;
+      }
+      store_int(d - 1, RAX);
+      break;
+
+    case VSM_INT_TO_BOOL:
+      load_int(RAX, d - 1);
+      emit_rr(false, 0x85, RAX, RAX); // test eax, eax
+      emit_setcc(CC_NE, RAX);
+      store_int(d - 1, RAX);
+      break;
+
+    case VSM_INT_TO_FLOAT:
+      load_int(RAX, d - 1);
+      emit_0f_rr(0xF2, false, 0x2A, 0, RAX); // cvtsi2sd xmm0, eax
+      store_float(d - 1, 0);
+      break;
+
+    case VSM_INT_ADD:
+    case VSM_INT_SUB:
+    case VSM_INT_MUL:
+    case VSM_INT_DIV:
+    case VSM_INT_MOD:
+    case VSM_INT_LSHIFT:
+    case VSM_INT_RSHIFT:
+    case VSM_INT_EQ:
+    case VSM_INT_NE:
+    case VSM_INT_LT:
+    case VSM_INT_LE:
+    case VSM_INT_AND:
+    case VSM_INT_OR:
+    case VSM_INT_XOR:
+      {
+	// 第1オペランドがスタックトップ
+	load_int(RAX, d - 1);
+	load_int(RCX, d - 2);
+	int dst = RAX;
+	switch ( op ) {
+	case VSM_INT_ADD: emit_rr(false, 0x01, RCX, RAX); break;
+	case VSM_INT_SUB: emit_rr(false, 0x29, RCX, RAX); break;
+	case VSM_INT_AND: emit_rr(false, 0x21, RCX, RAX); break;
+	case VSM_INT_OR:  emit_rr(false, 0x09, RCX, RAX); break;
+	case VSM_INT_XOR: emit_rr(false, 0x31, RCX, RAX); break;
+	case VSM_INT_MUL: emit_0f_rr(0, false, 0xAF, RAX, RCX); break;
+	case VSM_INT_DIV:
+	case VSM_INT_MOD:
+	  emit8(0x99); // cdq
+	  emit_rr(false, 0xF7, 7, RCX); // idiv ecx
+	  if ( op == VSM_INT_MOD ) {
+	    dst = RDX;
+	  }
+	  break;
+	case VSM_INT_LSHIFT: emit_rr(false, 0xD3, 4, RAX); break;
+	case VSM_INT_RSHIFT: emit_rr(false, 0xD3, 7, RAX); break;
+	default:
+	  emit_rr(false, 0x39, RCX, RAX); // cmp eax, ecx
+	  switch ( op ) {
+	  case VSM_INT_EQ: emit_setcc(CC_E, RAX); break;
+	  case VSM_INT_NE: emit_setcc(CC_NE, RAX); break;
+	  case VSM_INT_LT: emit_setcc(CC_L, RAX); break;
+	  case VSM_INT_LE: emit_setcc(CC_LE, RAX); break;
+	  }
+	  break;
+	}
+	store_int(d - 2, dst);
+      }
+      break;
+
+    case VSM_INT_ITE:
+    case VSM_FLOAT_ITE:
+      {
+	bool w = (op == VSM_FLOAT_ITE);
+	load_raw(RAX, d - 3);
+	load_raw(RCX, d - 2);
+	load_int(RDX, d - 1);
+	emit_rr(false, 0x85, RDX, RDX); // test edx, edx
+	emit_0f_rr(0, w, 0x45, RAX, RCX); // cmovne rax, rcx
+	store_raw(d - 3, RAX);
+      }
+      break;
+
+    case VSM_FLOAT_MINUS:
+      load_raw(RAX, d - 1);
+      emit_0f_rr(0, true, 0xBA, 7, RAX); emit8(63); // btc rax, 63
+      store_raw(d - 1, RAX);
+      break;
+
+    case VSM_FLOAT_TO_BOOL:
+      load_float(0, d - 1);
+      emit_0f_rr(0x66, false, 0x57, 1, 1); // xorpd xmm1, xmm1
+      emit_0f_rr(0x66, false, 0x2E, 0, 1); // ucomisd xmm0, xmm1
+      emit_setcc(CC_NE, RAX);
+      emit_setcc(CC_P, RCX);
+      emit_rr(false, 0x09, RCX, RAX);
+      store_int(d - 1, RAX);
+      break;
+
+    case VSM_FLOAT_TO_INT:
+      load_float(0, d - 1);
+      emit_0f_rr(0xF2, false, 0x2C, RAX, 0); // cvttsd2si eax, xmm0
+      store_int(d - 1, RAX);
+      break;
+
+    case VSM_FLOAT_ADD:
+    case VSM_FLOAT_SUB:
+    case VSM_FLOAT_MUL:
+    case VSM_FLOAT_DIV:
+      {
+	load_float(0, d - 1);
+	load_float(1, d - 2);
+	ymuint8 code = 0;
+	switch ( op ) {
+	case VSM_FLOAT_ADD: code = 0x58; break;
+	case VSM_FLOAT_SUB: code = 0x5C; break;
+	case VSM_FLOAT_MUL: code = 0x59; break;
+	case VSM_FLOAT_DIV: code = 0x5E; break;
+	}
+	emit_0f_rr(0xF2, false, code, 0, 1);
+	store_float(d - 2, 0);
+      }
+      break;
+
+    case VSM_FLOAT_EQ:
+    case VSM_FLOAT_NE:
+      load_float(0, d - 1);
+      load_float(1, d - 2);
+      emit_0f_rr(0x66, false, 0x2E, 0, 1); // ucomisd xmm0, xmm1
+      if ( op == VSM_FLOAT_EQ ) {
+	// 比較不能(NaN)の時は PF が立つ．
+	emit_setcc(CC_E, RAX);
+	emit_setcc(CC_NP, RCX);
+	emit_rr(false, 0x21, RCX, RAX);
+      }
+      else {
+	emit_setcc(CC_NE, RAX);
+	emit_setcc(CC_P, RCX);
+	emit_rr(false, 0x09, RCX, RAX);
+      }
+      store_int(d - 2, RAX);
+      break;
+
+    case VSM_FLOAT_LT:
+    case VSM_FLOAT_LE:
+      // val1 < val2 を val2 > val1 として調べる．
+      // こうすると比較不能の時に偽となる．
+      load_float(0, d - 1);
+      load_float(1, d - 2);
+      emit_0f_rr(0x66, false, 0x2E, 1, 0); // ucomisd xmm1, xmm0
+      emit_setcc(op == VSM_FLOAT_LT ? CC_A : CC_AE, RAX);
+      store_int(d - 2, RAX);
+      break;
+
+    case VSM_JUMP:
+      emit_jump(-1, code_list.read_int(pc));
+      break;
+
+    case VSM_BRANCH_TRUE:
+    case VSM_BRANCH_FALSE:
+      {
+	Ymsl_INT target = code_list.read_int(pc);
+	int r = stack_reg(d - 1);
+	if ( r < 0 ) {
+	  load_int(RAX, d - 1);
+	  r = RAX;
+	}
+	emit_rr(false, 0x85, r, r); // test r, r
+	emit_jump(op == VSM_BRANCH_TRUE ? CC_NE : CC_E, target);
+      }
+      break;
+
+    case VSM_CALL:
+      gen_call(func, code_list.read_int(pc), d);
+      break;
+
+    case VSM_TAIL_CALL:
+      gen_tail_call(func, code_list.read_int(pc), d, size);
+      break;
+
+    case VSM_RETURN:
+      // 返り値はフレームの先頭に置く．
+      load_raw(RAX, d - 1);
+      emit_rm(true, 0x89, RAX, kFrameReg, 0);
+      emit_jump(-1, size);
+      break;
+
+    case VSM_RETURN_VOID:
+      emit_jump(-1, size);
+      break;
+
+    case VSM_LOCAL_INT_INC:
+    case VSM_LOCAL_INT_DEC:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	int ext = (op == VSM_LOCAL_INT_INC) ? 0 : 5;
+	emit_rm(false, 0x83, ext, kFrameReg, index * kValueSize);
+	emit8(1);
+      }
+      break;
+
+    case VSM_LOCAL_INT_ADD_IMM:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT imm = code_list.read_int(pc);
+	emit_rm(false, 0x81, 0, kFrameReg, index * kValueSize);
+	emit32(imm);
+      }
+      break;
+
+    case VSM_PUSH_INT_IMM_LOAD_LOCAL_INT:
+      {
+	Ymsl_INT imm = code_list.read_int(pc);
+	Ymsl_INT index = code_list.read_int(pc);
+	emit_mov_imm(RAX, imm);
+	store_int(d, RAX);
+	emit_rm(false, 0x8B, RAX, kFrameReg, index * kValueSize);
+	store_int(d + 1, RAX);
+      }
+      break;
+
+    case VSM_INT_EQ_BRANCH_FALSE:
+    case VSM_INT_NE_BRANCH_FALSE:
+    case VSM_INT_LT_BRANCH_FALSE:
+    case VSM_INT_LE_BRANCH_FALSE:
+      {
+	Ymsl_INT target = code_list.read_int(pc);
+	int r1 = stack_reg(d - 1);
+	if ( r1 < 0 ) {
+	  load_int(RAX, d - 1);
+	  r1 = RAX;
+	}
+	int r2 = stack_reg(d - 2);
+	if ( r2 < 0 ) {
+	  load_int(RCX, d - 2);
+	  r2 = RCX;
+	}
+	Ymsl_CODE cmp_op = VSM_INT_EQ;
+	switch ( op ) {
+	case VSM_INT_EQ_BRANCH_FALSE: cmp_op = VSM_INT_EQ; break;
+	case VSM_INT_NE_BRANCH_FALSE: cmp_op = VSM_INT_NE; break;
+	case VSM_INT_LT_BRANCH_FALSE: cmp_op = VSM_INT_LT; break;
+	case VSM_INT_LE_BRANCH_FALSE: cmp_op = VSM_INT_LE; break;
+	}
+	emit_cmp_branch_false(cmp_op, r1, r2, target);
+      }
+      break;
+
+    case VSM_LOCAL_INT_LT_BRANCH_FALSE:
+      {
+	Ymsl_INT index1 = code_list.read_int(pc);
+	Ymsl_INT index2 = code_list.read_int(pc);
+	Ymsl_INT target = code_list.read_int(pc);
+	emit_rm(false, 0x8B, RAX, kFrameReg, index1 * kValueSize);
+	emit_rm(false, 0x3B, RAX, kFrameReg, index2 * kValueSize); // cmp eax, [m]
+	emit_jump(CC_GE, target);
+      }
+      break;
+
+    case VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE:
+      {
+	Ymsl_INT index = code_list.read_int(pc);
+	Ymsl_INT imm = code_list.read_int(pc);
+	Ymsl_INT target = code_list.read_int(pc);
+	emit_rm(false, 0x81, 7, kFrameReg, index * kValueSize); // cmp [m], imm32
+	emit32(imm);
+	emit_jump(CC_GE, target);
+      }
+      break;
+
+    default:
+      ASSERT_NOT_REACHED;
+      break;
+    }
+  }
+
+  // エピローグ
+  mOffset[size] = mBuff.size();
+  emit_restore_regs();
+  emit8(0xC3);              // ret
+
+  // フレームが収まらない時はスタックを伸長してから戻る．
+  // 伸長できない場合は reserve_frame() から戻ってこない．
+  set_rel32(grow_pos, mBuff.size());
+  emit_rr(true, 0x89, kVsmReg, RDI);
+  emit_rr(true, 0x89, kFrameReg, RSI);
+  emit_mov_imm(RDX, func->frame_size());
+  emit_mov_imm64(RAX, reinterpret_cast<ymuint64>(&VsmJit::reserve_frame));
+  emit_rr(false, 0xFF, 2, RAX); // call rax
+  emit_rr(true, 0x89, kVsmReg, RAX);
+  emit8(0xE9);                  // jmp rel32
+  emit32(0);
+  set_rel32(mBuff.size() - 4, grow_ret);
+
+  // インタプリタで実行してからエピローグに飛ぶ．
+  set_rel32(interp_pos, mBuff.size());
+  emit_rr(true, 0x89, kVsmReg, RDI);
+  emit_mov_imm64(RSI, reinterpret_cast<ymuint64>(func));
+  emit_rr(true, 0x89, kFrameReg, RDX);
+  emit_mov_imm64(RAX, reinterpret_cast<ymuint64>(&VsmJit::call_interp));
+  emit_rr(false, 0xFF, 2, RAX); // call rax
+  emit8(0xE9);                  // jmp rel32
+  emit32(0);
+  set_rel32(mBuff.size() - 4, mOffset[size]);
+
+  // 分岐先を書き込む．
+  for (vector<pair<ymuint, Ymsl_INT> >::iterator p = mFixupList.begin();
+       p != mFixupList.end(); ++ p) {
+    set_rel32(p->first, mOffset[p->second]);
+  }
+}
+
+// @brief 関数呼び出しのコードを生成する．
+// @param[in] func 呼び出し元の関数
+// @param[in] index 関数番号
+// @param[in] depth 呼び出し前のスタックの深さ
+void
+VsmJit::gen_call(const VsmNativeFunc* func,
+		 Ymsl_INT index,
+		 Ymsl_INT depth)
+{
+  const VsmFunction* callee = mVsm.mFuncTable[index];
+  Ymsl_INT new_base = depth - callee->arg_num();
+
+  // 引数を含めてレジスタの内容は全てメモリに書き出す．
+  spill(depth);
+
+  const VsmNativeFunc* native_callee = NULL;
+  if ( !callee->is_builtin() ) {
+    native_callee = dynamic_cast<const VsmNativeFunc*>(callee);
+  }
+  // 他のスレッドが同時にコンパイルしていることもあるので一度だけ読む．
+  const VsmJitCode* callee_code = NULL;
+  if ( native_callee != NULL ) {
+    callee_code = native_callee->jit_code();
+  }
+  if ( native_callee == func ) {
+    // 自分自身は直接呼び出す．
+    emit_rr(true, 0x89, kVsmReg, RDI);
+    emit_rm(true, 0x8D, RSI, kFrameReg, new_base * kValueSize); // lea
+    emit_rr(true, 0x89, kGlobalReg, RDX);
+    emit8(0xE8); // call rel32
+    ymint32 rel = 0 - static_cast<ymint32>(mBuff.size() + 4);
+    emit32(rel);
+  }
+  else if ( callee_code != NULL ) {
+    // コンパイル済みの関数も直接呼び出す．
+    VsmJitCode::Entry entry = callee_code->entry();
+    emit_rr(true, 0x89, kVsmReg, RDI);
+    emit_rm(true, 0x8D, RSI, kFrameReg, new_base * kValueSize); // lea
+    emit_rr(true, 0x89, kGlobalReg, RDX);
+    emit_mov_imm64(RAX, reinterpret_cast<ymuint64>(entry));
+    emit_rr(false, 0xFF, 2, RAX); // call rax
+  }
+  else {
+    // それ以外は関数テーブル経由で呼び出す．
+    emit_rr(true, 0x89, kVsmReg, RDI);
+    emit_mov_imm(RSI, index);
+    emit_rm(true, 0x8D, RDX, kFrameReg, depth * kValueSize); // lea
+    emit_mov_imm64(RAX, reinterpret_cast<ymuint64>(&VsmJit::call_func));
+    emit_rr(false, 0xFF, 2, RAX); // call rax
+  }
+
+  // 返り値は new_base に置かれている．
+  Ymsl_INT new_depth = new_base;
+  if ( callee->has_return_value() ) {
+    ++ new_depth;
+  }
+  reload(new_depth);
+}
+
+// @brief 末尾呼び出しのコードを生成する．
+// @param[in] func 呼び出し元の関数
+// @param[in] index 関数番号
+// @param[in] depth 呼び出し前のスタックの深さ
+// @param[in] size コードのサイズ
+void
+VsmJit::gen_tail_call(const VsmNativeFunc* func,
+		      Ymsl_INT index,
+		      Ymsl_INT depth,
+		      Ymsl_INT size)
+{
+  const VsmFunction* callee = mVsm.mFuncTable[index];
+  Ymsl_INT new_base = depth - callee->arg_num();
+  if ( callee == func ) {
+    // 自分自身の場合は引数をフレームの先頭に移して先頭に飛ぶ．
+    // 引数の位置は mVarNum より下なので常にメモリに置かれる．
+    for (ymuint i = 0; i < callee->arg_num(); ++ i) {
+      load_raw(RAX, new_base + i);
+      store_raw(i, RAX);
+    }
+    emit_jump(-1, 0);
+    return;
+  }
+
+  const VsmNativeFunc* native_callee = NULL;
+  if ( !callee->is_builtin() ) {
+    native_callee = dynamic_cast<const VsmNativeFunc*>(callee);
+  }
+  ymuint skip_pos = 0;
+  if ( native_callee != NULL ) {
+    // 実行時に相手がコンパイル済みなら引数をフレームの先頭に移して
+    // 自分のフレームを片付けてから飛ぶ．
+    spill(depth);
+    emit_mov_imm64(RAX, reinterpret_cast<ymuint64>(native_callee->jit_code_addr()));
+    emit_rm(true, 0x8B, RAX, RAX, 0); // mov rax, [rax]
+    emit_rr(true, 0x85, RAX, RAX);    // test rax, rax
+    emit8(0x0F); emit8(0x84);         // jz rel32
+    skip_pos = mBuff.size();
+    emit32(0);
+    emit_rm(true, 0x8B, RAX, RAX, VsmJitCode::entry_offset()); // mov rax, [rax + off]
+    for (ymuint i = 0; i < callee->arg_num(); ++ i) {
+      emit_rm(true, 0x8B, RCX, kFrameReg, (new_base + i) * kValueSize);
+      emit_rm(true, 0x89, RCX, kFrameReg, i * kValueSize);
+    }
+    emit_rr(true, 0x89, kVsmReg, RDI);
+    emit_rr(true, 0x89, kFrameReg, RSI);
+    emit_rr(true, 0x89, kGlobalReg, RDX);
+    emit_restore_regs();
+    emit_rr(false, 0xFF, 4, RAX); // jmp rax
+    set_rel32(skip_pos, mBuff.size());
+  }
+
+  // それ以外は普通に呼び出してから戻る．
+  gen_call(func, index, depth);
+  if ( callee->has_return_value() ) {
+    load_raw(RAX, new_base);
+    emit_rm(true, 0x89, RAX, kFrameReg, 0);
+  }
+  emit_jump(-1, size);
+}
+
+// @brief 退避したレジスタを元に戻す．
+void
+VsmJit::emit_restore_regs()
+{
+  emit_rr(true, 0x83, 0, RSP); emit8(8); // add rsp, 8
+  emit8(0x41); emit8(0x5F); // pop r15
+  emit8(0x41); emit8(0x5E); // pop r14
+  emit8(0x41); emit8(0x5D); // pop r13
+  emit8(0x41); emit8(0x5C); // pop r12
+  emit8(0x5B);              // pop rbx
+  emit8(0x5D);              // pop rbp
+}
+
+// @brief 書き込み済みの rel32 を設定する．
+// @param[in] pos rel32 の位置
+// @param[in] target 飛び先の機械語の位置
+void
+VsmJit::set_rel32(ymuint pos,
+		  ymuint target)
+{
+  ymint32 rel = target - (pos + 4);
+  for (ymuint i = 0; i < 4; ++ i) {
+    mBuff[pos + i] = (rel >> (i * 8)) & 0xFF;
+  }
+}
+
+// @brief スタックの位置に対応するレジスタを返す．
+// @param[in] pos 位置(フレームの先頭からの深さ)
+int
+VsmJit::stack_reg(Ymsl_INT pos) const
+{
+  Ymsl_INT k = pos - mVarNum;
+  if ( k >= 0 && k < kStackRegNum ) {
+    return kStackRegList[k];
+  }
+  return -1;
+}
+
+// @brief レジスタに置かれたスタックの内容をメモリに書き出す．
+// @param[in] depth スタックの深さ
+void
+VsmJit::spill(Ymsl_INT depth)
+{
+  for (Ymsl_INT pos = mVarNum; pos < depth; ++ pos) {
+    int r = stack_reg(pos);
+    if ( r < 0 ) {
+      break;
+    }
+    emit_rm(true, 0x89, r, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief レジスタに置かれるスタックの内容をメモリから読み込む．
+// @param[in] depth スタックの深さ
+void
+VsmJit::reload(Ymsl_INT depth)
+{
+  for (Ymsl_INT pos = mVarNum; pos < depth; ++ pos) {
+    int r = stack_reg(pos);
+    if ( r < 0 ) {
+      break;
+    }
+    emit_rm(true, 0x8B, r, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief スタックの INT の値をレジスタに読み込む．
+// @param[in] reg レジスタ
+// @param[in] pos スタックの位置
+void
+VsmJit::load_int(int reg,
+		 Ymsl_INT pos)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_rr(false, 0x89, r, reg);
+  }
+  else {
+    emit_rm(false, 0x8B, reg, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief レジスタの INT の値をスタックに書き込む．
+// @param[in] pos スタックの位置
+// @param[in] reg レジスタ
+void
+VsmJit::store_int(Ymsl_INT pos,
+		  int reg)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_rr(false, 0x89, reg, r);
+  }
+  else {
+    emit_rm(false, 0x89, reg, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief スタックの値を 64 ビットのまま汎用レジスタに読み込む．
+// @param[in] reg レジスタ
+// @param[in] pos スタックの位置
+void
+VsmJit::load_raw(int reg,
+		 Ymsl_INT pos)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_rr(true, 0x89, r, reg);
+  }
+  else {
+    emit_rm(true, 0x8B, reg, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief 汎用レジスタの値を 64 ビットのままスタックに書き込む．
+// @param[in] pos スタックの位置
+// @param[in] reg レジスタ
+void
+VsmJit::store_raw(Ymsl_INT pos,
+		  int reg)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_rr(true, 0x89, reg, r);
+  }
+  else {
+    emit_rm(true, 0x89, reg, kFrameReg, pos * kValueSize);
+  }
+}
+
+// @brief スタックの FLOAT の値を XMM レジスタに読み込む．
+// @param[in] xreg XMM レジスタ
+// @param[in] pos スタックの位置
+void
+VsmJit::load_float(int xreg,
+		   Ymsl_INT pos)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_0f_rr(0x66, true, 0x6E, xreg, r); // movq xmm, r64
+  }
+  else {
+    emit_0f_rm(0xF2, false, 0x10, xreg, kFrameReg, pos * kValueSize); // movsd
+  }
+}
+
+// @brief XMM レジスタの FLOAT の値をスタックに書き込む．
+// @param[in] pos スタックの位置
+// @param[in] xreg XMM レジスタ
+void
+VsmJit::store_float(Ymsl_INT pos,
+		    int xreg)
+{
+  int r = stack_reg(pos);
+  if ( r >= 0 ) {
+    emit_0f_rr(0x66, true, 0x7E, xreg, r); // movq r64, xmm
+  }
+  else {
+    emit_0f_rm(0xF2, false, 0x11, xreg, kFrameReg, pos * kValueSize); // movsd
+  }
+}
+
+// @brief 分岐命令を生成する．
+// @param[in] cc 条件コード(-1 の時は無条件)
+// @param[in] target 飛び先の命令位置
+void
+VsmJit::emit_jump(int cc,
+		  Ymsl_INT target)
+{
+  if ( cc < 0 ) {
+    emit8(0xE9);
+  }
+  else {
+    emit8(0x0F);
+    emit8(0x80 + cc);
+  }
+  mFixupList.push_back(make_pair(static_cast<ymuint>(mBuff.size()), target));
+  emit32(0);
+}
+
+// @brief 1バイト書き込む．
+void
+VsmJit::emit8(ymuint8 val)
+{
+  mBuff.push_back(val);
+}
+
+// @brief 4バイト書き込む．
+void
+VsmJit::emit32(ymuint32 val)
+{
+  for (ymuint i = 0; i < 4; ++ i) {
+    mBuff.push_back((val >> (i * 8)) & 0xFF);
+  }
+}
+
+// @brief 8バイト書き込む．
+void
+VsmJit::emit64(ymuint64 val)
+{
+  for (ymuint i = 0; i < 8; ++ i) {
+    mBuff.push_back((val >> (i * 8)) & 0xFF);
+  }
+}
+
+// @brief REX プレフィックスを書き込む．
+// @param[in] w 64ビットオペランドの時 true
+// @param[in] reg ModRM の reg フィールドのレジスタ
+// @param[in] rm ModRM の r/m フィールドのレジスタ
+// @param[in] force 必要がなくても書き込む時 true
+void
+VsmJit::emit_rex(bool w,
+		 int reg,
+		 int rm,
+		 bool force)
+{
+  ymuint8 rex = 0x40;
+  if ( w ) {
+    rex |= 0x08;
+  }
+  if ( reg & 8 ) {
+    rex |= 0x04;
+  }
+  if ( rm & 8 ) {
+    rex |= 0x01;
+  }
+  if ( rex != 0x40 || force ) {
+    emit8(rex);
+  }
+}
+
+// @brief レジスタ間の ModRM を書き込む．
+void
+VsmJit::emit_modrm_reg(int reg,
+		       int rm)
+{
+  emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// @brief [base + disp32] の ModRM を書き込む．
+void
+VsmJit::emit_modrm_mem(int reg,
+		       int base,
+		       Ymsl_INT disp)
+{
+  // RSP と R12 は SIB が必要になるのでベースには用いない．
+  ASSERT_COND( (base & 7) != RSP );
+  emit8(0x80 | ((reg & 7) << 3) | (base & 7));
+  emit32(disp);
+}
+
+// @brief レジスタ間の演算命令を書き込む．
+void
+VsmJit::emit_rr(bool w,
+		ymuint8 op,
+		int reg,
+		int rm)
+{
+  emit_rex(w, reg, rm);
+  emit8(op);
+  emit_modrm_reg(reg, rm);
+}
+
+// @brief レジスタとメモリ間の演算命令を書き込む．
+void
+VsmJit::emit_rm(bool w,
+		ymuint8 op,
+		int reg,
+		int base,
+		Ymsl_INT disp)
+{
+  emit_rex(w, reg, base);
+  emit8(op);
+  emit_modrm_mem(reg, base, disp);
+}
+
+// @brief 0F で始まる2バイトの命令を書き込む．
+void
+VsmJit::emit_0f_rr(ymuint8 prefix,
+		   bool w,
+		   ymuint8 op,
+		   int reg,
+		   int rm)
+{
+  if ( prefix ) {
+    emit8(prefix);
+  }
+  emit_rex(w, reg, rm);
+  emit8(0x0F);
+  emit8(op);
+  emit_modrm_reg(reg, rm);
+}
+
+// @brief 0F で始まる2バイトのメモリオペランドの命令を書き込む．
+void
+VsmJit::emit_0f_rm(ymuint8 prefix,
+		   bool w,
+		   ymuint8 op,
+		   int reg,
+		   int base,
+		   Ymsl_INT disp)
+{
+  if ( prefix ) {
+    emit8(prefix);
+  }
+  emit_rex(w, reg, base);
+  emit8(0x0F);
+  emit8(op);
+  emit_modrm_mem(reg, base, disp);
+}
+
+// @brief レジスタに即値を書き込む．
+void
+VsmJit::emit_mov_imm(int reg,
+		     Ymsl_INT val)
+{
+  emit_rex(false, 0, reg);
+  emit8(0xB8 + (reg & 7));
+  emit32(val);
+}
+
+// @brief レジスタに 64 ビットの即値を書き込む．
+void
+VsmJit::emit_mov_imm64(int reg,
+		       ymuint64 val)
+{
+  emit_rex(true, 0, reg);
+  emit8(0xB8 + (reg & 7));
+  emit64(val);
+}
+
+// @brief 条件が成り立つ時 reg を 1 に，そうでなければ 0 にする．
+// @param[in] cc 条件コード
+// @param[in] reg レジスタ
+void
+VsmJit::emit_setcc(int cc,
+		   int reg)
+{
+  // SPL, BPL, SIL, DIL を指定するには REX が必要
+  bool force = (reg >= 4);
+  emit_rex(false, 0, reg, force);
+  emit8(0x0F);
+  emit8(0x90 + cc);
+  emit_modrm_reg(0, reg);
+  // movzx reg32, reg8
+  emit_rex(false, reg, reg, force);
+  emit8(0x0F);
+  emit8(0xB6);
+  emit_modrm_reg(reg, reg);
+}
+
+// @brief 比較結果から条件分岐する．
+// @param[in] op 比較演算(VSM_INT_EQ など)
+// @param[in] reg1 第1オペランドのレジスタ
+// @param[in] reg2 第2オペランドのレジスタ
+// @param[in] target 条件が成り立たない時の飛び先
+void
+VsmJit::emit_cmp_branch_false(Ymsl_CODE op,
+			      int reg1,
+			      int reg2,
+			      Ymsl_INT target)
+{
+  emit_rr(false, 0x39, reg2, reg1); // cmp reg1, reg2
+  int cc = 0;
+  switch ( op ) {
+  case VSM_INT_EQ: cc = CC_NE; break;
+  case VSM_INT_NE: cc = CC_E; break;
+  case VSM_INT_LT: cc = CC_GE; break;
+  case VSM_INT_LE: cc = CC_G; break;
+  default: ASSERT_NOT_REACHED; break;
+  }
+  emit_jump(cc, target);
+}
+
+// @brief 実行可能な領域に機械語を複写する．
+// @return コードを返す．
+VsmJitCode*
+VsmJit::install()
+{
+#if defined(YMSL_USE_JIT)
+  ymuint page_size = sysconf(_SC_PAGESIZE);
+  ymuint size = (mBuff.size() + page_size - 1) / page_size * page_size;
+  void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ( mem == MAP_FAILED ) {
+    return NULL;
+  }
+  memcpy(mem, &mBuff[0], mBuff.size());
+  // 書き込みと実行は同時には許可しない．
+  if ( mprotect(mem, size, PROT_READ | PROT_EXEC) != 0 ) {
+    munmap(mem, size);
+    return NULL;
+  }
+  return new VsmJitCode(mem, size);
+#else
+  return NULL;
+#endif
+}
+
+// @brief 関数テーブル経由で関数を呼び出す．
+// @param[in] vsm 仮想マシン
+// @param[in] index 関数番号
+// @param[in] sp スタックポインタ
+void
+VsmJit::call_func(Vsm* vsm,
+		  Ymsl_INT index,
+		  VsmValue* sp)
+{
+  vsm->mSP = sp - vsm->mLocalStack;
+  vsm->call_func(index);
+}
+
+// @brief フレームの領域を確保する．
+// @param[in] vsm 仮想マシン
+// @param[in] frame フレームの先頭
+// @param[in] size フレームの大きさ
+void
+VsmJit::reserve_frame(Vsm* vsm,
+		      VsmValue* frame,
+		      Ymsl_INT size)
+{
+  vsm->reserve_frame(frame - vsm->mLocalStack, size);
+}
+
+// @brief 関数をインタプリタで実行する．
+// @param[in] vsm 仮想マシン
+// @param[in] func 関数
+// @param[in] frame フレームの先頭
+//
+// C++ のスタックが残り少ない時に生成したコードから呼ばれる．
+// Vsm::native_stack_low() が true の間は入れ子の呼び出しも
+// 機械語ではなく Vsm の呼び出しフレームで行われる．
+void
+VsmJit::call_interp(Vsm* vsm,
+		    const VsmNativeFunc* func,
+		    VsmValue* frame)
+{
+  Ymsl_INT base = frame - vsm->mLocalStack;
+  vsm->mSP = base + func->arg_num();
+  func->execute(*vsm, base);
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,445 @@
+#ifndef VSMJIT_H
+#define VSMJIT_H
+
+/// @file VsmJit.h
+/// @brief VsmJit のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "VsmValue.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+class VsmNativeFunc;
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmJitCode VsmJit.h "VsmJit.h"
+/// @brief JIT コンパイルされたコードを表すクラス
+///
+/// コードは mmap() で確保した実行可能なページに置かれる．
+//////////////////////////////////////////////////////////////////////
+class VsmJitCode
+{
+public:
+
+  /// @brief 関数の入口の型
+  ///
+  /// 引数は仮想マシン，フレームの先頭，グローバル変数領域
+  typedef void (*Entry)(Vsm*, VsmValue*, VsmValue*);
+
+  /// @brief コンストラクタ
+  /// @param[in] mem 確保した領域
+  /// @param[in] size 領域のサイズ
+  VsmJitCode(void* mem,
+	     ymuint size);
+
+  /// @brief デストラクタ
+  ///
+  /// 領域を解放する．
+  ~VsmJitCode();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 関数の入口を返す．
+  Entry
+  entry() const;
+
+  /// @brief 関数の入口を保持しているメンバのオフセットを返す．
+  ///
+  /// 生成したコードから入口を読み出すために用いる．
+  static
+  ymuint
+  entry_offset();
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 確保した領域
+  void* mMem;
+
+  // 領域のサイズ
+  ymuint mSize;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmJit VsmJit.h "VsmJit.h"
+/// @brief VsmNativeFunc のコードを x86-64 の機械語に変換するクラス
+///
+/// 命令ごとに決まった機械語の断片を並べる単純な JIT である．
+/// - 各命令位置でのスタックの深さは静的に決まるので，深さごとに
+///   スタックの位置を固定の場所に割り当てる．ローカル変数より上の
+///   先頭の数段はレジスタに，それ以外はフレーム上のメモリに置く．
+/// - VSM_CALL は自分自身か既にコンパイル済みの関数なら直接呼び出す．
+///   それ以外は Vsm の関数テーブル経由で呼び出す．
+/// - 自分自身への VSM_TAIL_CALL はループになる．コンパイル済みの
+///   関数への VSM_TAIL_CALL は C++ のスタックを消費しない．
+/// - 関数の入口でフレームがローカルスタックに収まるかを調べ，
+///   足りなければ Vsm::reserve_frame() で伸長する．
+/// - 機械語どうしの呼び出しは C++ のスタックを消費するので，
+///   Vsm::native_stack_low() が成り立つ深さに達したらその関数は
+///   インタプリタで実行する．そこから先の呼び出しは Vsm の
+///   呼び出しフレームで行うので C++ のスタックは増えない．
+/// - 対応していない命令を含む場合にはコンパイルを行わない．
+///   その場合は Vsm::execute() で実行し続ける．
+/// - 機械語のフレームはスタックマップで辿れないので，引数や返り値に
+///   OBJ の値を持つ関数と，そういう関数を呼び出す関数もコンパイル
+///   しない．
+///
+/// YMSL_USE_JIT が定義されていない場合には常にコンパイルに失敗する．
+//////////////////////////////////////////////////////////////////////
+class VsmJit
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] vsm 仮想マシン
+  VsmJit(Vsm& vsm);
+
+  /// @brief デストラクタ
+  ~VsmJit();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 関数をコンパイルする．
+  /// @param[in] func 対象の関数
+  /// @param[in] code_list func のコード
+  /// @return コンパイルしたコードを返す．
+  ///
+  /// コンパイルできなかった場合には NULL を返す．
+  VsmJitCode*
+  compile(const VsmNativeFunc* func,
+	  const VsmCodeList& code_list);
+
+  /// @brief コンパイルしたコードを実行する．
+  /// @param[in] code コード
+  /// @param[in] vsm 仮想マシン
+  /// @param[in] base ベースレジスタ
+  static
+  void
+  execute(const VsmJitCode& code,
+	  Vsm& vsm,
+	  Ymsl_INT base);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 各命令位置でのスタックの深さを求める．
+  /// @param[in] code_list コード
+  /// @param[in] arg_num 引数の数
+  /// @return 対応していない命令を含む場合や深さが矛盾する場合は false を返す．
+  bool
+  calc_depth(const VsmCodeList& code_list,
+	     ymuint arg_num);
+
+  /// @brief 機械語を生成する．
+  /// @param[in] func 対象の関数
+  /// @param[in] code_list コード
+  void
+  gen_code(const VsmNativeFunc* func,
+	   const VsmCodeList& code_list);
+
+  /// @brief 関数呼び出しのコードを生成する．
+  /// @param[in] func 呼び出し元の関数
+  /// @param[in] index 関数番号
+  /// @param[in] depth 呼び出し前のスタックの深さ
+  void
+  gen_call(const VsmNativeFunc* func,
+	   Ymsl_INT index,
+	   Ymsl_INT depth);
+
+  /// @brief 末尾呼び出しのコードを生成する．
+  /// @param[in] func 呼び出し元の関数
+  /// @param[in] index 関数番号
+  /// @param[in] depth 呼び出し前のスタックの深さ
+  /// @param[in] size コードのサイズ
+  ///
+  /// 自分自身の呼び出しは関数の先頭へのジャンプにする．
+  /// 他の関数の場合は実行時にコンパイル済みならフレームを片付けて
+  /// その入口へ飛ぶ．
+  void
+  gen_tail_call(const VsmNativeFunc* func,
+		Ymsl_INT index,
+		Ymsl_INT depth,
+		Ymsl_INT size);
+
+  /// @brief スタックの位置に対応するレジスタを返す．
+  /// @param[in] pos 位置(フレームの先頭からの深さ)
+  ///
+  /// メモリに置かれる場合は -1 を返す．
+  int
+  stack_reg(Ymsl_INT pos) const;
+
+  /// @brief レジスタに置かれたスタックの内容をメモリに書き出す．
+  /// @param[in] depth スタックの深さ
+  void
+  spill(Ymsl_INT depth);
+
+  /// @brief レジスタに置かれるスタックの内容をメモリから読み込む．
+  /// @param[in] depth スタックの深さ
+  void
+  reload(Ymsl_INT depth);
+
+  /// @brief スタックの INT の値をレジスタに読み込む．
+  /// @param[in] reg レジスタ
+  /// @param[in] pos スタックの位置
+  void
+  load_int(int reg,
+	   Ymsl_INT pos);
+
+  /// @brief レジスタの INT の値をスタックに書き込む．
+  /// @param[in] pos スタックの位置
+  /// @param[in] reg レジスタ
+  void
+  store_int(Ymsl_INT pos,
+	    int reg);
+
+  /// @brief スタックの値を 64 ビットのまま汎用レジスタに読み込む．
+  /// @param[in] reg レジスタ
+  /// @param[in] pos スタックの位置
+  void
+  load_raw(int reg,
+	   Ymsl_INT pos);
+
+  /// @brief 汎用レジスタの値を 64 ビットのままスタックに書き込む．
+  /// @param[in] pos スタックの位置
+  /// @param[in] reg レジスタ
+  void
+  store_raw(Ymsl_INT pos,
+	    int reg);
+
+  /// @brief スタックの FLOAT の値を XMM レジスタに読み込む．
+  /// @param[in] xreg XMM レジスタ
+  /// @param[in] pos スタックの位置
+  void
+  load_float(int xreg,
+	     Ymsl_INT pos);
+
+  /// @brief XMM レジスタの FLOAT の値をスタックに書き込む．
+  /// @param[in] pos スタックの位置
+  /// @param[in] xreg XMM レジスタ
+  void
+  store_float(Ymsl_INT pos,
+	      int xreg);
+
+  /// @brief 分岐命令を生成する．
+  /// @param[in] cc 条件コード(-1 の時は無条件)
+  /// @param[in] target 飛び先の命令位置
+  void
+  emit_jump(int cc,
+	    Ymsl_INT target);
+
+  /// @brief 退避したレジスタを元に戻す．
+  ///
+  /// rsp もプロローグの前の値に戻る．
+  void
+  emit_restore_regs();
+
+  /// @brief 書き込み済みの rel32 を設定する．
+  /// @param[in] pos rel32 の位置
+  /// @param[in] target 飛び先の機械語の位置
+  void
+  set_rel32(ymuint pos,
+	    ymuint target);
+
+  /// @brief 1バイト書き込む．
+  void
+  emit8(ymuint8 val);
+
+  /// @brief 4バイト書き込む．
+  void
+  emit32(ymuint32 val);
+
+  /// @brief 8バイト書き込む．
+  void
+  emit64(ymuint64 val);
+
+  /// @brief REX プレフィックスを書き込む．
+  /// @param[in] w 64ビットオペランドの時 true
+  /// @param[in] reg ModRM の reg フィールドのレジスタ
+  /// @param[in] rm ModRM の r/m フィールドのレジスタ
+  /// @param[in] force 必要がなくても書き込む時 true
+  void
+  emit_rex(bool w,
+	   int reg,
+	   int rm,
+	   bool force = false);
+
+  /// @brief レジスタ間の ModRM を書き込む．
+  void
+  emit_modrm_reg(int reg,
+		 int rm);
+
+  /// @brief [base + disp32] の ModRM を書き込む．
+  void
+  emit_modrm_mem(int reg,
+		 int base,
+		 Ymsl_INT disp);
+
+  /// @brief レジスタ間の演算命令を書き込む．
+  /// @param[in] w 64ビットオペランドの時 true
+  /// @param[in] op 命令コード
+  /// @param[in] reg ModRM の reg フィールドのレジスタ
+  /// @param[in] rm ModRM の r/m フィールドのレジスタ
+  void
+  emit_rr(bool w,
+	  ymuint8 op,
+	  int reg,
+	  int rm);
+
+  /// @brief レジスタとメモリ間の演算命令を書き込む．
+  /// @param[in] w 64ビットオペランドの時 true
+  /// @param[in] op 命令コード
+  /// @param[in] reg ModRM の reg フィールドのレジスタ
+  /// @param[in] base ベースレジスタ
+  /// @param[in] disp 変位
+  void
+  emit_rm(bool w,
+	  ymuint8 op,
+	  int reg,
+	  int base,
+	  Ymsl_INT disp);
+
+  /// @brief 0F で始まる2バイトの命令を書き込む．
+  /// @param[in] prefix 先頭のプレフィックス(0 の時はなし)
+  /// @param[in] w 64ビットオペランドの時 true
+  /// @param[in] op 2バイト目の命令コード
+  /// @param[in] reg ModRM の reg フィールドのレジスタ
+  /// @param[in] rm ModRM の r/m フィールドのレジスタ
+  void
+  emit_0f_rr(ymuint8 prefix,
+	     bool w,
+	     ymuint8 op,
+	     int reg,
+	     int rm);
+
+  /// @brief 0F で始まる2バイトのメモリオペランドの命令を書き込む．
+  void
+  emit_0f_rm(ymuint8 prefix,
+	     bool w,
+	     ymuint8 op,
+	     int reg,
+	     int base,
+	     Ymsl_INT disp);
+
+  /// @brief レジスタに即値を書き込む．
+  void
+  emit_mov_imm(int reg,
+	       Ymsl_INT val);
+
+  /// @brief レジスタに 64 ビットの即値を書き込む．
+  void
+  emit_mov_imm64(int reg,
+		 ymuint64 val);
+
+  /// @brief 条件が成り立つ時 reg を 1 に，そうでなければ 0 にする．
+  /// @param[in] cc 条件コード
+  /// @param[in] reg レジスタ
+  void
+  emit_setcc(int cc,
+	     int reg);
+
+  /// @brief 比較結果から条件分岐する．
+  /// @param[in] op 比較演算(VSM_INT_EQ など)
+  /// @param[in] reg1 第1オペランドのレジスタ
+  /// @param[in] reg2 第2オペランドのレジスタ
+  /// @param[in] target 条件が成り立たない時の飛び先
+  void
+  emit_cmp_branch_false(Ymsl_CODE op,
+			int reg1,
+			int reg2,
+			Ymsl_INT target);
+
+  /// @brief 実行可能な領域に機械語を複写する．
+  /// @return コードを返す．
+  VsmJitCode*
+  install();
+
+  /// @brief 関数テーブル経由で関数を呼び出す．
+  /// @param[in] vsm 仮想マシン
+  /// @param[in] index 関数番号
+  /// @param[in] sp スタックポインタ
+  ///
+  /// 生成したコードから呼ばれる．
+  static
+  void
+  call_func(Vsm* vsm,
+	    Ymsl_INT index,
+	    VsmValue* sp);
+
+  /// @brief フレームの領域を確保する．
+  /// @param[in] vsm 仮想マシン
+  /// @param[in] frame フレームの先頭
+  /// @param[in] size フレームの大きさ
+  ///
+  /// フレームがローカルスタックに収まらない時に生成したコードから呼ばれる．
+  static
+  void
+  reserve_frame(Vsm* vsm,
+		VsmValue* frame,
+		Ymsl_INT size);
+
+  /// @brief 関数をインタプリタで実行する．
+  /// @param[in] vsm 仮想マシン
+  /// @param[in] func 関数
+  /// @param[in] frame フレームの先頭
+  ///
+  /// C++ のスタックが残り少ない時に生成したコードから呼ばれる．
+  static
+  void
+  call_interp(Vsm* vsm,
+	      const VsmNativeFunc* func,
+	      VsmValue* frame);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 仮想マシン
+  Vsm& mVsm;
+
+  // 各命令位置でのスタックの深さ
+  // 到達しない位置は -1
+  vector<Ymsl_INT> mDepth;
+
+  // ローカル変数の数
+  // これより上のスタックの位置がレジスタの候補となる．
+  Ymsl_INT mVarNum;
+
+  // 生成した機械語
+  vector<ymuint8> mBuff;
+
+  // 各命令位置に対応する機械語の位置
+  vector<ymuint> mOffset;
+
+  // 分岐先の書き換え用のリスト
+  // (rel32 の位置, 飛び先の命令位置) のペア
+  vector<pair<ymuint, Ymsl_INT> > mFixupList;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMJIT_H
@@ -63,6 +63,15 @@ VsmModule::Builder::add_exported_var(VsmVar* var)
   return id;
 }
 
+// @brief 定数表のビルダーを返す．
+//
+// コード生成中に定数を追加するために用いる．
+VsmConstPool::Builder&
+VsmModule::Builder::const_pool()
+{
+  return mConstPool;
+}
+
 // @brief 名前を返す．
 ShString
 VsmModule::Builder::name() const
@@ -91,6 +100,13 @@ VsmModule::Builder::exported_var_list() const
   return mVarList;
 }
 
+// @brief 定数表のビルダーを返す．
+const VsmConstPool::Builder&
+VsmModule::Builder::const_pool() const
+{
+  return mConstPool;
+}
+
 
 //////////////////////////////////////////////////////////////////////
 // クラス VsmModule
@@ -99,7 +115,8 @@ VsmModule::Builder::exported_var_list() const
 // @brief コンストラクタ
 // @param[in] builder ビルダー
 VsmModule::VsmModule(Builder& builder) :
-  mName(builder.name())
+  mName(builder.name()),
+  mConstPool(builder.const_pool())
 {
   const vector<VsmModule*>& module_list = builder.imported_module_list();
   mImportedModuleNum = module_list.size();
@@ -127,7 +144,7 @@ VsmModule::VsmModule(Builder& builder) :
 VsmModule::~VsmModule()
 {
   for (ymuint i = 0; i < mExportedFuncNum; ++ i) {
-    delete mFuncTable;
+    delete mFuncTable[i];
   }
   for (ymuint i = 0; i < mExportedVarNum; ++ i) {
     delete mExportedVarList[i];
@@ -192,4 +209,20 @@ VsmModule::exported_variable(ymuint pos) const
   return mExportedVarList[pos];
 }
 
+// @brief 定数表を返す．
+const VsmConstPool&
+VsmModule::const_pool() const
+{
+  return mConstPool;
+}
+
+// @brief トップレベルのコードをバイナリ形式で書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+// @return 書き出せなかった場合は false を返す．
+bool
+VsmModule::dump_toplevel(VsmBinWriter& writer) const
+{
+  return false;
+}
+
 END_NAMESPACE_YM_YMSL
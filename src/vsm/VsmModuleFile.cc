@@ -0,0 +1,701 @@
+
+/// @file VsmModuleFile.cc
+/// @brief VsmModuleFile の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmModuleFile.h"
+#include "VsmBinIO.h"
+#include "VsmModule.h"
+#include "VsmNativeModule.h"
+#include "VsmNativeFunc.h"
+#include "VsmVar.h"
+#include "YmslObj.h"
+#include "YmslCompiler.h"
+#include "Type.h"
+#include "TypeMgr.h"
+
+#include <cstdio>
+#include <sstream>
+#include <ctime>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(YMSL_USE_MMAP)
+#include <sys/mman.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// ファイルの先頭のマジックナンバー
+const char kMagic[4] = { 'Y', 'M', 'S', 'C' };
+
+// 形式の版数
+// 形式を変えたら増やすこと．
+const ymuint32 kVersion = 3;
+
+// バイト順の印
+const ymuint32 kByteOrder = 0x01020304U;
+
+// 値の大きさの印
+const ymuint32 kValueSize = sizeof(Ymsl_INT) | (sizeof(Ymsl_FLOAT) << 8);
+
+// ヘッダの構造
+struct Header
+{
+  char mMagic[4];
+  ymuint32 mVersion;
+  ymuint32 mByteOrder;
+  ymuint32 mValueSize;
+  ymuint64 mSrcSize;
+  ymint64 mSrcMtime;
+  ymuint64 mSrcHash;
+  ymuint64 mBodySize;
+  ymuint64 mBodyHash;
+};
+
+// 更新時刻が書き出し時刻からこの秒数以内なら信用しない．
+// 同じ秒のうちに同じ大きさで書き換えられても見逃さないように
+// 読み込み時に必ずハッシュ値で照合させる．
+const ymint64 kRacyMtime = 2;
+
+// 更新時刻を信用しないことを表す値
+const ymint64 kNoMtime = -1;
+
+// FNV-1a の初期値
+const ymuint64 kFnvBasis = 0xcbf29ce484222325ULL;
+
+// FNV-1a で hash にバイト列を加える．
+ymuint64
+fnv_hash(ymuint64 hash,
+	 const ymuint8* data,
+	 ymuint64 size)
+{
+  for (ymuint64 i = 0; i < size; ++ i) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// ファイルの内容を保持するクラス
+// YMSL_USE_MMAP が定義されている時は mmap() で割り当てる．
+class FileImage
+{
+public:
+
+  // コンストラクタ
+  FileImage() :
+    mData(NULL),
+    mSize(0)
+  {
+  }
+
+  // デストラクタ
+  ~FileImage()
+  {
+#if defined(YMSL_USE_MMAP)
+    if ( mData != NULL ) {
+      munmap(const_cast<ymuint8*>(mData), mSize);
+    }
+#endif
+  }
+
+  // ファイルを読み込む．
+  bool
+  open(const string& path)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+      return false;
+    }
+    struct stat st;
+    if ( fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)) ) {
+      close(fd);
+      return false;
+    }
+    ymuint64 size = st.st_size;
+#if defined(YMSL_USE_MMAP)
+    void* mem = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( mem == MAP_FAILED ) {
+      return false;
+    }
+    mData = static_cast<const ymuint8*>(mem);
+#else
+    mBuf.resize(size);
+    ymuint64 pos = 0;
+    while ( pos < size ) {
+      ssize_t n = ::read(fd, &mBuf[pos], size - pos);
+      if ( n <= 0 ) {
+	break;
+      }
+      pos += n;
+    }
+    close(fd);
+    if ( pos < size ) {
+      return false;
+    }
+    mData = &mBuf[0];
+#endif
+    mSize = size;
+    return true;
+  }
+
+  // 先頭のアドレス
+  const ymuint8* mData;
+
+  // バイト数
+  ymuint64 mSize;
+
+#if !defined(YMSL_USE_MMAP)
+  // 読み込んだ内容
+  vector<ymuint8> mBuf;
+#endif
+
+};
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmModuleFile
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] compiler import に用いるコンパイラ
+// @param[in] type_mgr 型を管理するオブジェクト
+VsmModuleFile::VsmModuleFile(YmslCompiler& compiler,
+			     TypeMgr& type_mgr) :
+  mCompiler(compiler),
+  mTypeMgr(type_mgr)
+{
+}
+
+// @brief デストラクタ
+VsmModuleFile::~VsmModuleFile()
+{
+}
+
+// @brief ソースファイルの大きさと更新時刻を得る．
+// @param[in] path ソースファイルのパス
+// @param[out] info 結果を格納する変数
+// @return ファイルが存在しない場合は false を返す．
+bool
+VsmModuleFile::stat_source(const string& path,
+			   SourceInfo& info)
+{
+  struct stat st;
+  if ( stat(path.c_str(), &st) != 0 ) {
+    return false;
+  }
+  info.mSize = st.st_size;
+  info.mMtime = st.st_mtime;
+  info.mHash = 0;
+  info.mCheckTime = time(NULL);
+  return true;
+}
+
+// @brief ソースファイルが変更されたか調べる．
+// @param[in] path ソースファイルのパス
+// @param[in] info 前回調べた時の情報
+// @return 変更されているか，ファイルが読めない場合は true を返す．
+bool
+VsmModuleFile::source_changed(const string& path,
+			      const SourceInfo& info)
+{
+  SourceInfo new_info;
+  if ( !stat_source(path, new_info) ) {
+    return true;
+  }
+  if ( new_info.mSize != info.mSize ) {
+    return true;
+  }
+  if ( new_info.mMtime == info.mMtime &&
+       info.mMtime + kRacyMtime < info.mCheckTime ) {
+    return false;
+  }
+  ymuint64 hash;
+  if ( !hash_source(path, hash) ) {
+    return true;
+  }
+  return hash != info.mHash;
+}
+
+// @brief ソースファイルの内容のハッシュ値を得る．
+// @param[in] path ソースファイルのパス
+// @param[out] hash 結果を格納する変数
+// @return ファイルが読めない場合は false を返す．
+bool
+VsmModuleFile::hash_source(const string& path,
+			   ymuint64& hash)
+{
+  FILE* fp = fopen(path.c_str(), "rb");
+  if ( fp == NULL ) {
+    return false;
+  }
+  hash = kFnvBasis;
+  ymuint8 buf[4096];
+  for ( ; ; ) {
+    size_t n = fread(buf, 1, sizeof(buf), fp);
+    if ( n == 0 ) {
+      break;
+    }
+    hash = fnv_hash(hash, buf, n);
+  }
+  bool stat = !ferror(fp);
+  fclose(fp);
+  return stat;
+}
+
+// @brief モジュールをファイルに書き出す．
+// @param[in] path ファイルのパス
+// @param[in] module 対象のモジュール
+// @param[in] src_info 元のソースファイルの情報
+// @return 書き出せなかった場合は false を返す．
+bool
+VsmModuleFile::write(const string& path,
+		     const VsmModule& module,
+		     const SourceInfo& src_info)
+{
+  VsmBinWriter writer;
+
+  writer.write_str(module.name());
+
+  ymuint nm = module.imported_module_num();
+  writer.write_32(nm);
+  for (ymuint i = 0; i < nm; ++ i) {
+    const VsmModule* sub_module = module.imported_module(i);
+    writer.write_str(sub_module->name());
+    writer.write_64(interface_hash(*sub_module));
+  }
+
+  const VsmConstPool& const_pool = module.const_pool();
+  ymuint nc = const_pool.size();
+  writer.write_32(nc);
+  for (ymuint i = 0; i < nc; ++ i) {
+    TypeId type_id = const_pool.type(i);
+    VsmValue val = const_pool.value(i);
+    writer.write_8(type_id);
+    switch ( type_id ) {
+    case kIntType:
+      writer.write_32(static_cast<ymuint32>(val.int_value));
+      break;
+
+    case kFloatType:
+      writer.write_float(val.float_value);
+      break;
+
+    case kStringType:
+      writer.write_str(static_cast<const YmslString*>(val.obj_value)->str());
+      break;
+
+    default:
+      return false;
+    }
+  }
+
+  ymuint nv = module.exported_variable_num();
+  writer.write_32(nv);
+  for (ymuint i = 0; i < nv; ++ i) {
+    const VsmVar* var = module.exported_variable(i);
+    writer.write_str(var->name());
+    if ( !write_type(writer, var->type()) ) {
+      return false;
+    }
+  }
+
+  ymuint nf = module.exported_function_num();
+  writer.write_32(nf);
+  for (ymuint i = 0; i < nf; ++ i) {
+    const VsmFunction* func = module.exported_function(i);
+    writer.write_str(func->name());
+    if ( !write_type(writer, func->type()) ) {
+      return false;
+    }
+    if ( !func->dump(writer) ) {
+      return false;
+    }
+  }
+
+  if ( !module.dump_toplevel(writer) ) {
+    return false;
+  }
+
+  const vector<ymuint8>& body = writer.data();
+
+  Header header;
+  memcpy(header.mMagic, kMagic, sizeof(kMagic));
+  header.mVersion = kVersion;
+  header.mByteOrder = kByteOrder;
+  header.mValueSize = kValueSize;
+  header.mSrcSize = src_info.mSize;
+  header.mSrcMtime = src_info.mMtime;
+  if ( src_info.mMtime + kRacyMtime >= static_cast<ymint64>(time(NULL)) ) {
+    header.mSrcMtime = kNoMtime;
+  }
+  header.mSrcHash = src_info.mHash;
+  header.mBodySize = body.size();
+  header.mBodyHash = fnv_hash(kFnvBasis, &body[0], body.size());
+
+  // 書きかけのファイルを読まれないように一時ファイルに書いてから
+  // 名前を付け替える．
+  ostringstream buf;
+  buf << path << "." << getpid() << ".tmp";
+  string tmp_path = buf.str();
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if ( fp == NULL ) {
+    return false;
+  }
+  bool stat = true;
+  if ( fwrite(&header, sizeof(Header), 1, fp) != 1 ) {
+    stat = false;
+  }
+  if ( stat && fwrite(&body[0], 1, body.size(), fp) != body.size() ) {
+    stat = false;
+  }
+  if ( fclose(fp) != 0 ) {
+    stat = false;
+  }
+  if ( stat && rename(tmp_path.c_str(), path.c_str()) != 0 ) {
+    stat = false;
+  }
+  if ( !stat ) {
+    unlink(tmp_path.c_str());
+  }
+  return stat;
+}
+
+// @brief ファイルからモジュールを読み込む．
+// @param[in] path ファイルのパス
+// @param[in] src_path 元のソースファイルのパス
+// @return 読み込んだモジュールを返す．
+VsmModule*
+VsmModuleFile::read(const string& path,
+		    const string& src_path)
+{
+  FileImage image;
+  if ( !image.open(path) ) {
+    return NULL;
+  }
+
+  Header header;
+  memcpy(&header, image.mData, sizeof(Header));
+  if ( memcmp(header.mMagic, kMagic, sizeof(kMagic)) != 0 ||
+       header.mVersion != kVersion ||
+       header.mByteOrder != kByteOrder ||
+       header.mValueSize != kValueSize ) {
+    return NULL;
+  }
+
+  if ( src_path != string() ) {
+    SourceInfo src_info;
+    if ( !stat_source(src_path, src_info) ) {
+      return NULL;
+    }
+    if ( src_info.mSize != header.mSrcSize ) {
+      return NULL;
+    }
+    if ( src_info.mMtime != header.mSrcMtime ) {
+      // 更新時刻が違っても中身が同じなら使える．
+      ymuint64 hash;
+      if ( !hash_source(src_path, hash) || hash != header.mSrcHash ) {
+	return NULL;
+      }
+    }
+  }
+
+  const ymuint8* body = image.mData + sizeof(Header);
+  if ( header.mBodySize != image.mSize - sizeof(Header) ||
+       header.mBodyHash != fnv_hash(kFnvBasis, body, header.mBodySize) ) {
+    return NULL;
+  }
+
+  VsmBinReader reader(body, header.mBodySize);
+  return read_body(reader);
+}
+
+// @brief 本体を読み込む．
+// @param[in] reader 読み込み用のオブジェクト
+// @return 読み込んだモジュールを返す．
+VsmModule*
+VsmModuleFile::read_body(VsmBinReader& reader)
+{
+  ShString name = reader.read_str();
+  VsmModule::Builder module_builder(name);
+
+  ymuint nm = reader.read_32();
+  for (ymuint i = 0; i < nm && !reader.error(); ++ i) {
+    ShString sub_name = reader.read_str();
+    ymuint64 hash = reader.read_64();
+    if ( reader.error() ) {
+      return NULL;
+    }
+    VsmModule* sub_module = mCompiler.import(sub_name);
+    if ( sub_module == NULL ) {
+      return NULL;
+    }
+    if ( interface_hash(*sub_module) != hash ) {
+      // import しているモジュールが変わったので作り直す必要がある．
+      return NULL;
+    }
+    module_builder.add_module(sub_module);
+  }
+
+  VsmConstPool::Builder& const_pool = module_builder.const_pool();
+  ymuint nc = reader.read_32();
+  for (ymuint i = 0; i < nc && !reader.error(); ++ i) {
+    TypeId type_id = static_cast<TypeId>(reader.read_8());
+    Ymsl_INT index;
+    switch ( type_id ) {
+    case kIntType:
+      index = const_pool.add_int(static_cast<ymint32>(reader.read_32()));
+      break;
+
+    case kFloatType:
+      index = const_pool.add_float(reader.read_float());
+      break;
+
+    case kStringType:
+      index = const_pool.add_string(reader.read_str());
+      break;
+
+    default:
+      reader.set_error();
+      index = -1;
+      break;
+    }
+    // 書き出した時の定数表は重複がないので番号も一致するはず．
+    if ( index != static_cast<Ymsl_INT>(i) ) {
+      reader.set_error();
+    }
+  }
+
+  bool ok = !reader.error();
+  ymuint nv = ok ? reader.read_32() : 0;
+  for (ymuint i = 0; i < nv && ok; ++ i) {
+    ShString var_name = reader.read_str();
+    const Type* type = read_type(reader);
+    if ( type == NULL || reader.error() ) {
+      ok = false;
+      break;
+    }
+    module_builder.add_exported_var(new VsmVar(var_name, type));
+  }
+
+  ymuint nf = ok ? reader.read_32() : 0;
+  for (ymuint i = 0; i < nf && ok; ++ i) {
+    ShString func_name = reader.read_str();
+    const Type* type = read_type(reader);
+    if ( type == NULL || type->type_id() != kFuncType || reader.error() ) {
+      ok = false;
+      break;
+    }
+    VsmFunction* func = new VsmNativeFunc(func_name, type, reader);
+    module_builder.add_function(func);
+    if ( reader.error() ) {
+      ok = false;
+    }
+  }
+
+  if ( !ok ) {
+    const vector<VsmVar*>& var_list = module_builder.exported_var_list();
+    for (ymuint i = 0; i < var_list.size(); ++ i) {
+      delete var_list[i];
+    }
+    const vector<VsmFunction*>& func_list = module_builder.exported_function_list();
+    for (ymuint i = 0; i < func_list.size(); ++ i) {
+      delete func_list[i];
+    }
+    return NULL;
+  }
+
+  VsmModule* module = new VsmNativeModule(module_builder, reader);
+  if ( reader.error() || reader.remain() > 0 ) {
+    delete module;
+    return NULL;
+  }
+  return module;
+}
+
+// @brief 型を書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+// @param[in] type 型
+// @return 書き出せない型の場合は false を返す．
+bool
+VsmModuleFile::write_type(VsmBinWriter& writer,
+			  const Type* type)
+{
+  TypeId type_id = type->type_id();
+  writer.write_8(type_id);
+  switch ( type_id ) {
+  case kVoidType:
+  case kBooleanType:
+  case kIntType:
+  case kFloatType:
+  case kStringType:
+    return true;
+
+  case kArrayType:
+  case kSetType:
+    return write_type(writer, type->elem_type());
+
+  case kMapType:
+    return write_type(writer, type->elem_type()) &&
+      write_type(writer, type->key_type());
+
+  case kFuncType:
+    {
+      if ( !write_type(writer, type->function_output_type()) ) {
+	return false;
+      }
+      ymuint n = type->function_input_num();
+      writer.write_32(n);
+      for (ymuint i = 0; i < n; ++ i) {
+	if ( !write_type(writer, type->function_input_type(i)) ) {
+	  return false;
+	}
+      }
+    }
+    return true;
+
+  case kEnumType:
+    {
+      writer.write_str(type->type_name());
+      ymuint n = type->enum_num();
+      writer.write_32(n);
+      for (ymuint i = 0; i < n; ++ i) {
+	writer.write_str(type->enum_elem_name(i));
+	writer.write_32(static_cast<ymuint32>(type->enum_elem_val(i)));
+      }
+    }
+    return true;
+
+  default:
+    // 名前つきの型やクラスは名前の解決が必要なので書き出さない．
+    break;
+  }
+  return false;
+}
+
+// @brief 型を読み込む．
+// @param[in] reader 読み込み用のオブジェクト
+// @return 読み込んだ型を返す．
+const Type*
+VsmModuleFile::read_type(VsmBinReader& reader)
+{
+  TypeId type_id = static_cast<TypeId>(reader.read_8());
+  if ( reader.error() ) {
+    return NULL;
+  }
+  switch ( type_id ) {
+  case kVoidType:    return mTypeMgr.void_type();
+  case kBooleanType: return mTypeMgr.boolean_type();
+  case kIntType:     return mTypeMgr.int_type();
+  case kFloatType:   return mTypeMgr.float_type();
+  case kStringType:  return mTypeMgr.string_type();
+
+  case kArrayType:
+  case kSetType:
+    {
+      const Type* elem_type = read_type(reader);
+      if ( elem_type == NULL ) {
+	return NULL;
+      }
+      if ( type_id == kArrayType ) {
+	return mTypeMgr.array_type(elem_type);
+      }
+      return mTypeMgr.set_type(elem_type);
+    }
+
+  case kMapType:
+    {
+      const Type* elem_type = read_type(reader);
+      if ( elem_type == NULL ) {
+	return NULL;
+      }
+      const Type* key_type = read_type(reader);
+      if ( key_type == NULL ) {
+	return NULL;
+      }
+      return mTypeMgr.map_type(key_type, elem_type);
+    }
+
+  case kFuncType:
+    {
+      const Type* output_type = read_type(reader);
+      if ( output_type == NULL ) {
+	return NULL;
+      }
+      ymuint n = reader.read_32();
+      if ( n > reader.remain() ) {
+	return NULL;
+      }
+      vector<const Type*> input_type_list(n);
+      for (ymuint i = 0; i < n; ++ i) {
+	input_type_list[i] = read_type(reader);
+	if ( input_type_list[i] == NULL ) {
+	  return NULL;
+	}
+      }
+      return mTypeMgr.function_type(output_type, input_type_list);
+    }
+
+  case kEnumType:
+    {
+      ShString name = reader.read_str();
+      ymuint n = reader.read_32();
+      if ( n > reader.remain() ) {
+	return NULL;
+      }
+      vector<pair<ShString, Ymsl_INT> > elem_list(n);
+      for (ymuint i = 0; i < n; ++ i) {
+	elem_list[i].first = reader.read_str();
+	elem_list[i].second = static_cast<ymint32>(reader.read_32());
+      }
+      if ( reader.error() ) {
+	return NULL;
+      }
+      return mTypeMgr.enum_type(name, elem_list);
+    }
+
+  default:
+    break;
+  }
+  return NULL;
+}
+
+// @brief モジュールのインターフェイスのハッシュ値を求める．
+// @param[in] module 対象のモジュール
+ymuint64
+VsmModuleFile::interface_hash(const VsmModule& module)
+{
+  // 書き出す時と同じ形式に並べてハッシュ値をとる．
+  // 書き出せない型は型番号だけで区別する．
+  VsmBinWriter writer;
+  ymuint nf = module.exported_function_num();
+  writer.write_32(nf);
+  for (ymuint i = 0; i < nf; ++ i) {
+    const VsmFunction* func = module.exported_function(i);
+    writer.write_str(func->name());
+    write_type(writer, func->type());
+  }
+  ymuint nv = module.exported_variable_num();
+  writer.write_32(nv);
+  for (ymuint i = 0; i < nv; ++ i) {
+    const VsmVar* var = module.exported_variable(i);
+    writer.write_str(var->name());
+    write_type(writer, var->type());
+  }
+  const vector<ymuint8>& data = writer.data();
+  return fnv_hash(kFnvBasis, &data[0], data.size());
+}
+
+END_NAMESPACE_YM_YMSL
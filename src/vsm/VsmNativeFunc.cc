@@ -9,6 +9,7 @@
 
 #include "VsmNativeFunc.h"
 #include "Vsm.h"
+#include "VsmBinIO.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -21,17 +22,44 @@ BEGIN_NAMESPACE_YM_YMSL
 // @param[in] name 関数名
 // @param[in] type 型
 // @param[in] code_list_builder コードリストの初期化用オブジェクト
+// @param[in] num_locals 引数を含むローカル変数の数
+// @param[in] max_stack ローカル変数の上に積まれる値の数の最大値
 VsmNativeFunc::VsmNativeFunc(ShString name,
 			     const Type* type,
-			     const VsmCodeList::Builder& code_list_builder) :
+			     const VsmCodeList::Builder& code_list_builder,
+			     ymuint num_locals,
+			     ymuint max_stack) :
   VsmFunction(name, type),
-  mCodeList(code_list_builder)
+  mCodeList(code_list_builder),
+  mNumLocals(num_locals),
+  mMaxStack(max_stack)
 {
+  mCallCount = 0;
+  mJitCode = NULL;
+  mJitFailed = false;
+}
+
+// @brief dump() で書き出した内容を読み込むコンストラクタ
+// @param[in] name 関数名
+// @param[in] type 型
+// @param[in] reader 読み込み用のオブジェクト
+VsmNativeFunc::VsmNativeFunc(ShString name,
+			     const Type* type,
+			     VsmBinReader& reader) :
+  VsmFunction(name, type),
+  mCodeList(reader)
+{
+  mNumLocals = reader.read_32();
+  mMaxStack = reader.read_32();
+  mCallCount = 0;
+  mJitCode = NULL;
+  mJitFailed = false;
 }
 
 // @brief デストラクタ
 VsmNativeFunc::~VsmNativeFunc()
 {
+  delete mJitCode;
 }
 
 // @brief 組み込み関数の時 true を返す．
@@ -48,7 +76,105 @@ void
 VsmNativeFunc::execute(Vsm& vsm,
 		       Ymsl_INT base) const
 {
-  vsm.execute(mCodeList, base);
+  count_call(vsm);
+
+  const VsmJitCode* jit_code = this->jit_code();
+  if ( jit_code != NULL && !vsm.native_stack_low() ) {
+    VsmJit::execute(*jit_code, vsm, base);
+  }
+  else {
+    vsm.execute(mCodeList, base);
+  }
+}
+
+// @brief Vsm の命令ループの中で実行するコードを返す．
+// @param[in] vsm 仮想マシン
+const VsmCodeList*
+VsmNativeFunc::frame_code(Vsm& vsm) const
+{
+  count_call(vsm);
+
+  if ( jit_code() != NULL && !vsm.native_stack_low() ) {
+    return NULL;
+  }
+  return &mCodeList;
+}
+
+// @brief 呼び出し時に必要なフレームの大きさを返す．
+Ymsl_INT
+VsmNativeFunc::frame_size() const
+{
+  return mNumLocals + mMaxStack;
+}
+
+// @brief 実行用の情報をバイナリ形式で書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+// @return 常に true を返す．
+bool
+VsmNativeFunc::dump(VsmBinWriter& writer) const
+{
+  mCodeList.dump(writer);
+  writer.write_32(mNumLocals);
+  writer.write_32(mMaxStack);
+  return true;
+}
+
+// @brief 引数を含むローカル変数の数を返す．
+ymuint
+VsmNativeFunc::num_locals() const
+{
+  return mNumLocals;
+}
+
+// @brief ローカル変数の上に積まれる値の数の最大値を返す．
+ymuint
+VsmNativeFunc::max_stack() const
+{
+  return mMaxStack;
+}
+
+// @brief JIT コンパイルしたコードを返す．
+const VsmJitCode*
+VsmNativeFunc::jit_code() const
+{
+  return __atomic_load_n(&mJitCode, __ATOMIC_ACQUIRE);
+}
+
+// @brief JIT コンパイルしたコードを保持する変数のアドレスを返す．
+VsmJitCode* const*
+VsmNativeFunc::jit_code_addr() const
+{
+  return &mJitCode;
+}
+
+// @brief 呼び出し回数を数えて必要なら JIT コンパイルを行う．
+// @param[in] vsm 仮想マシン
+void
+VsmNativeFunc::count_call(Vsm& vsm) const
+{
+  if ( jit_code() != NULL || __atomic_load_n(&mJitFailed, __ATOMIC_ACQUIRE) ) {
+    return;
+  }
+
+  ymuint count = __atomic_add_fetch(&mCallCount, 1, __ATOMIC_RELAXED);
+  ymuint threshold = vsm.jit_threshold();
+  if ( threshold == 0 || count < threshold ) {
+    return;
+  }
+
+  // 同時に閾値を越えた他のスレッドはコンパイルが終わるのを待つ．
+  YmslLock lock(mJitMutex);
+  if ( mJitCode != NULL || mJitFailed ) {
+    return;
+  }
+  VsmJit jit(vsm);
+  VsmJitCode* code = jit.compile(this, mCodeList);
+  if ( code == NULL ) {
+    __atomic_store_n(&mJitFailed, true, __ATOMIC_RELEASE);
+  }
+  else {
+    __atomic_store_n(&mJitCode, code, __ATOMIC_RELEASE);
+  }
 }
 
 END_NAMESPACE_YM_YMSL
@@ -11,6 +11,8 @@
 
 #include "VsmFunction.h"
 #include "VsmCodeList.h"
+#include "VsmJit.h"
+#include "YmslMutex.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -18,6 +20,16 @@ BEGIN_NAMESPACE_YM_YMSL
 //////////////////////////////////////////////////////////////////////
 /// @class VsmNativeFunc VsmNativeFunc.h "VsmNativeFunc.h"
 /// @brief YMSL で記述された関数を表すクラス
+///
+/// 呼び出し回数が Vsm::jit_threshold() に達したら VsmJit で
+/// 機械語にコンパイルする．コンパイルできなかった場合には
+/// 以降も Vsm の命令ループの中で実行する．
+///
+/// モジュールは複数のスレッドの Vsm から同時に実行されるので，
+/// 呼び出し回数はアトミックに数え，コンパイルは mJitMutex の中で
+/// 一度だけ行う．コンパイルしたコードは release で mJitCode に書き，
+/// 読む側は acquire で読むので，コードを指すポインタが見えれば
+/// コードの中身も見える．
 //////////////////////////////////////////////////////////////////////
 class VsmNativeFunc :
   public VsmFunction
@@ -28,9 +40,23 @@ public:
   /// @param[in] name 関数名
   /// @param[in] type 型
   /// @param[in] code_list_builder コードリストの初期化用オブジェクト
+  /// @param[in] num_locals 引数を含むローカル変数の数
+  /// @param[in] max_stack ローカル変数の上に積まれる値の数の最大値
+  VsmNativeFunc(ShString name,
+		const Type* type,
+		const VsmCodeList::Builder& code_list_builder,
+		ymuint num_locals,
+		ymuint max_stack);
+
+  /// @brief dump() で書き出した内容を読み込むコンストラクタ
+  /// @param[in] name 関数名
+  /// @param[in] type 型
+  /// @param[in] reader 読み込み用のオブジェクト
+  ///
+  /// 読み込みに失敗した場合は reader.error() が true になる．
   VsmNativeFunc(ShString name,
 		const Type* type,
-		const VsmCodeList::Builder& code_list_builder);
+		VsmBinReader& reader);
 
   /// @brief デストラクタ
   ~VsmNativeFunc();
@@ -54,12 +80,64 @@ public:
   execute(Vsm& vsm,
 	  Ymsl_INT base) const;
 
+  /// @brief Vsm の命令ループの中で実行するコードを返す．
+  /// @param[in] vsm 仮想マシン
+  ///
+  /// JIT コンパイルしたコードがある場合は NULL を返す．
+  /// ただし Vsm::native_stack_low() が true の時はコードを返す．
+  virtual
+  const VsmCodeList*
+  frame_code(Vsm& vsm) const;
+
+  /// @brief 呼び出し時に必要なフレームの大きさを返す．
+  ///
+  /// num_locals() + max_stack() となる．
+  virtual
+  Ymsl_INT
+  frame_size() const;
+
+  /// @brief 実行用の情報をバイナリ形式で書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  /// @return 常に true を返す．
+  virtual
+  bool
+  dump(VsmBinWriter& writer) const;
+
+  /// @brief 引数を含むローカル変数の数を返す．
+  ymuint
+  num_locals() const;
+
+  /// @brief ローカル変数の上に積まれる値の数の最大値を返す．
+  ymuint
+  max_stack() const;
+
+  /// @brief JIT コンパイルしたコードを返す．
+  ///
+  /// まだコンパイルしていない場合は NULL を返す．
+  /// 他のスレッドがコンパイルしたコードも acquire で読むので
+  /// そのまま実行してよい．
+  const VsmJitCode*
+  jit_code() const;
+
+  /// @brief JIT コンパイルしたコードを保持する変数のアドレスを返す．
+  ///
+  /// 生成したコードから実行時に参照するために用いる．
+  /// x86-64 では通常のロードが acquire になるので，生成したコードは
+  /// ここを普通に読めばよい．
+  VsmJitCode* const*
+  jit_code_addr() const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
   // 内部で用いられる関数
   //////////////////////////////////////////////////////////////////////
 
+  /// @brief 呼び出し回数を数えて必要なら JIT コンパイルを行う．
+  /// @param[in] vsm 仮想マシン
+  void
+  count_call(Vsm& vsm) const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -69,6 +147,27 @@ private:
   // コードリスト
   VsmCodeList mCodeList;
 
+  // 引数を含むローカル変数の数
+  ymuint mNumLocals;
+
+  // ローカル変数の上に積まれる値の数の最大値
+  ymuint mMaxStack;
+
+  // 呼び出し回数
+  // アトミックに増やす．
+  mutable ymuint mCallCount;
+
+  // JIT コンパイルしたコード
+  // mJitMutex の中で release で書き，外からは acquire で読む．
+  mutable VsmJitCode* mJitCode;
+
+  // JIT コンパイルに失敗した時 true にするフラグ
+  // mJitCode と同様に読み書きする．
+  mutable bool mJitFailed;
+
+  // JIT コンパイルを一度だけ行うための排他制御
+  mutable YmslMutex mJitMutex;
+
 };
 
 END_NAMESPACE_YM_YMSL
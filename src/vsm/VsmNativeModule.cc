@@ -9,6 +9,7 @@
 
 #include "VsmNativeModule.h"
 #include "Vsm.h"
+#include "VsmBinIO.h"
 
 
 BEGIN_NAMESPACE_YM_YMSL
@@ -20,13 +21,27 @@ BEGIN_NAMESPACE_YM_YMSL
 // @brief コンストラクタ
 // @param[in] module_builder モジュール用のビルダー
 // @param[in] toplevel_builder トップレベルのコードビルダー
+// @param[in] frame_size トップレベルのフレームの大きさ
 VsmNativeModule::VsmNativeModule(VsmModule::Builder& module_builder,
-				 VsmCodeList::Builder& toplevel_builder) :
+				 VsmCodeList::Builder& toplevel_builder,
+				 ymuint frame_size) :
   VsmModule(module_builder),
-  mToplevelCode(toplevel_builder)
+  mToplevelCode(toplevel_builder),
+  mFrameSize(frame_size)
 {
 }
 
+// @brief dump_toplevel() で書き出した内容を読み込むコンストラクタ
+// @param[in] module_builder モジュール用のビルダー
+// @param[in] reader 読み込み用のオブジェクト
+VsmNativeModule::VsmNativeModule(VsmModule::Builder& module_builder,
+				 VsmBinReader& reader) :
+  VsmModule(module_builder),
+  mToplevelCode(reader)
+{
+  mFrameSize = reader.read_32();
+}
+
 // @brief デストラクタ
 VsmNativeModule::~VsmNativeModule()
 {
@@ -37,7 +52,19 @@ VsmNativeModule::~VsmNativeModule()
 void
 VsmNativeModule::execute_toplevel(Vsm& vsm) const
 {
+  vsm.reserve_frame(0, mFrameSize);
   vsm.execute(mToplevelCode, 0);
 }
 
+// @brief トップレベルのコードをバイナリ形式で書き出す．
+// @param[in] writer 書き出し用のオブジェクト
+// @return 常に true を返す．
+bool
+VsmNativeModule::dump_toplevel(VsmBinWriter& writer) const
+{
+  mToplevelCode.dump(writer);
+  writer.write_32(mFrameSize);
+  return true;
+}
+
 END_NAMESPACE_YM_YMSL
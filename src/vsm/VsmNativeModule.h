@@ -27,8 +27,18 @@ public:
   /// @brief コンストラクタ
   /// @param[in] module_builder モジュール用のビルダー
   /// @param[in] toplevel_builder トップレベルのコードビルダー
+  /// @param[in] frame_size トップレベルのフレームの大きさ
   VsmNativeModule(VsmModule::Builder& module_builder,
-		  VsmCodeList::Builder& toplevel_builder);
+		  VsmCodeList::Builder& toplevel_builder,
+		  ymuint frame_size);
+
+  /// @brief dump_toplevel() で書き出した内容を読み込むコンストラクタ
+  /// @param[in] module_builder モジュール用のビルダー
+  /// @param[in] reader 読み込み用のオブジェクト
+  ///
+  /// 読み込みに失敗した場合は reader.error() が true になる．
+  VsmNativeModule(VsmModule::Builder& module_builder,
+		  VsmBinReader& reader);
 
   /// @brief デストラクタ
   ~VsmNativeModule();
@@ -45,6 +55,13 @@ public:
   void
   execute_toplevel(Vsm& vsm) const;
 
+  /// @brief トップレベルのコードをバイナリ形式で書き出す．
+  /// @param[in] writer 書き出し用のオブジェクト
+  /// @return 常に true を返す．
+  virtual
+  bool
+  dump_toplevel(VsmBinWriter& writer) const;
+
 
 private:
   //////////////////////////////////////////////////////////////////////
@@ -60,7 +77,9 @@ private:
   // トップレベルのコード
   VsmCodeList mToplevelCode;
 
-  //
+  // トップレベルのフレームの大きさ
+  ymuint mFrameSize;
+
 };
 
 END_NAMESPACE_YM_YMSL
@@ -0,0 +1,330 @@
+
+/// @file VsmPeephole.cc
+/// @brief VsmPeephole の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmPeephole.h"
+#include "Vsm.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// ジャンプ先のアドレスをオペランドに持つ命令の時 true を返す．
+inline
+bool
+is_jump(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_JUMP:
+  case VSM_BRANCH_TRUE:
+  case VSM_BRANCH_FALSE:
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+// 比較命令と BRANCH_FALSE を融合した命令を返す．
+// 該当しない場合は VSM_NOP を返す．
+inline
+Ymsl_CODE
+cmp_branch_code(Ymsl_CODE op)
+{
+  switch ( op ) {
+  case VSM_INT_EQ: return VSM_INT_EQ_BRANCH_FALSE;
+  case VSM_INT_NE: return VSM_INT_NE_BRANCH_FALSE;
+  case VSM_INT_LT: return VSM_INT_LT_BRANCH_FALSE;
+  case VSM_INT_LE: return VSM_INT_LE_BRANCH_FALSE;
+  default: break;
+  }
+  return VSM_NOP;
+}
+
+// 融合する命令列
+const Ymsl_CODE lt_imm_branch_pat[] = {
+  VSM_PUSH_INT_IMM, VSM_LOAD_LOCAL_INT, VSM_INT_LT, VSM_BRANCH_FALSE
+};
+
+const Ymsl_CODE lt_branch_pat[] = {
+  VSM_LOAD_LOCAL_INT, VSM_LOAD_LOCAL_INT, VSM_INT_LT, VSM_BRANCH_FALSE
+};
+
+const Ymsl_CODE add_imm_pat[] = {
+  VSM_PUSH_INT_IMM, VSM_LOAD_LOCAL_INT, VSM_INT_ADD, VSM_STORE_LOCAL_INT
+};
+
+const Ymsl_CODE inc_pat[] = {
+  VSM_LOAD_LOCAL_INT, VSM_INT_INC, VSM_STORE_LOCAL_INT
+};
+
+const Ymsl_CODE dec_pat[] = {
+  VSM_LOAD_LOCAL_INT, VSM_INT_DEC, VSM_STORE_LOCAL_INT
+};
+
+const Ymsl_CODE imm_load_pat[] = {
+  VSM_PUSH_INT_IMM, VSM_LOAD_LOCAL_INT
+};
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmPeephole
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+VsmPeephole::VsmPeephole()
+{
+}
+
+// @brief デストラクタ
+VsmPeephole::~VsmPeephole()
+{
+}
+
+// @brief 最適化を行う．
+// @param[inout] builder 対象のコード
+void
+VsmPeephole::optimize(VsmCodeList::Builder& builder)
+{
+  scan(builder);
+
+  Ymsl_INT size = builder.size();
+  mAddrMap.clear();
+  mAddrMap.resize(size + 1, -1);
+  mFixupList.clear();
+
+  VsmCodeList::Builder dst;
+  ymuint nt = builder.jump_table_num();
+  for (ymuint i = 0; i < nt; ++ i) {
+    dst.add_jump_table(builder.jump_table(i).size());
+  }
+  ymuint n = mAddrList.size() - 1;
+  for (ymuint pos = 0; pos < n; ) {
+    mAddrMap[mAddrList[pos]] = dst.size();
+    ymuint num = fuse(builder, pos, dst);
+    if ( num == 0 ) {
+      copy(builder, pos, dst);
+      num = 1;
+    }
+    pos += num;
+  }
+  mAddrMap[size] = dst.size();
+
+  // ジャンプ先のアドレスを書き込む．
+  for (vector<pair<Ymsl_INT, Ymsl_INT> >::iterator p = mFixupList.begin();
+       p != mFixupList.end(); ++ p) {
+    Ymsl_INT new_addr = mAddrMap[p->second];
+    ASSERT_COND( new_addr != -1 );
+    dst.rewrite_int(p->first, new_addr);
+  }
+  for (ymuint i = 0; i < nt; ++ i) {
+    const vector<Ymsl_INT>& table = builder.jump_table(i);
+    for (ymuint j = 0; j < table.size(); ++ j) {
+      Ymsl_INT new_addr = mAddrMap[table[j]];
+      ASSERT_COND( new_addr != -1 );
+      dst.rewrite_jump_table(i, j, new_addr);
+    }
+  }
+
+  // スタックマップのアドレスも置き換える．
+  // 安全点の命令はどの命令列にも含まれないので，
+  // その直後は必ず新しいコードの命令の先頭になる．
+  ymuint nm = builder.stack_map_num();
+  for (ymuint i = 0; i < nm; ++ i) {
+    Ymsl_INT new_addr = mAddrMap[builder.stack_map_addr(i)];
+    ASSERT_COND( new_addr != -1 );
+    dst.add_stack_map(new_addr, builder.stack_map_slot_list(i));
+  }
+
+  builder = dst;
+}
+
+// @brief 命令の先頭アドレスとジャンプ先を調べる．
+// @param[in] src 元のコード
+void
+VsmPeephole::scan(const VsmCodeList::Builder& src)
+{
+  Ymsl_INT size = src.size();
+  mAddrList.clear();
+  mTargetMark.clear();
+  mTargetMark.resize(size + 1, false);
+  for (Ymsl_INT pc = 0; pc < size; ) {
+    mAddrList.push_back(pc);
+    Ymsl_CODE op = src.read_opcode(pc);
+    if ( is_jump(op) ) {
+      Ymsl_INT addr = src.read_int(pc + 1);
+      ASSERT_COND( 0 <= addr && addr <= size );
+      mTargetMark[addr] = true;
+    }
+    else if ( op == VSM_JUMP_TABLE ) {
+      Ymsl_INT addr = src.read_int(pc + 3);
+      ASSERT_COND( 0 <= addr && addr <= size );
+      mTargetMark[addr] = true;
+      const vector<Ymsl_INT>& table = src.jump_table(src.read_int(pc + 2));
+      for (vector<Ymsl_INT>::const_iterator p = table.begin();
+	   p != table.end(); ++ p) {
+	ASSERT_COND( 0 <= *p && *p <= size );
+	mTargetMark[*p] = true;
+      }
+    }
+    pc += Vsm::operand_size(op) + 1;
+  }
+  mAddrList.push_back(size);
+}
+
+// @brief 命令列を融合する．
+// @param[in] src 元のコード
+// @param[in] pos 先頭の命令番号
+// @param[in] dst 出力先のコード
+// @return 置き換えた命令数を返す．
+ymuint
+VsmPeephole::fuse(const VsmCodeList::Builder& src,
+		  ymuint pos,
+		  VsmCodeList::Builder& dst)
+{
+  // 長いものから順に調べる．
+  if ( match(src, pos, lt_imm_branch_pat, 4) ) {
+    dst.write_opcode(VSM_LOCAL_INT_LT_IMM_BRANCH_FALSE);
+    dst.write_int(operand(src, pos + 1, 0));
+    dst.write_int(operand(src, pos, 0));
+    write_addr(operand(src, pos + 3, 0), dst);
+    return 4;
+  }
+
+  if ( match(src, pos, lt_branch_pat, 4) ) {
+    dst.write_opcode(VSM_LOCAL_INT_LT_BRANCH_FALSE);
+    dst.write_int(operand(src, pos + 1, 0));
+    dst.write_int(operand(src, pos, 0));
+    write_addr(operand(src, pos + 3, 0), dst);
+    return 4;
+  }
+
+  if ( match(src, pos, add_imm_pat, 4) &&
+       operand(src, pos + 1, 0) == operand(src, pos + 3, 0) ) {
+    dst.write_opcode(VSM_LOCAL_INT_ADD_IMM);
+    dst.write_int(operand(src, pos + 1, 0));
+    dst.write_int(operand(src, pos, 0));
+    return 4;
+  }
+
+  if ( match(src, pos, inc_pat, 3) &&
+       operand(src, pos, 0) == operand(src, pos + 2, 0) ) {
+    dst.write_opcode(VSM_LOCAL_INT_INC);
+    dst.write_int(operand(src, pos, 0));
+    return 3;
+  }
+
+  if ( match(src, pos, dec_pat, 3) &&
+       operand(src, pos, 0) == operand(src, pos + 2, 0) ) {
+    dst.write_opcode(VSM_LOCAL_INT_DEC);
+    dst.write_int(operand(src, pos, 0));
+    return 3;
+  }
+
+  Ymsl_CODE op = src.read_opcode(mAddrList[pos]);
+  Ymsl_CODE cmp_op = cmp_branch_code(op);
+  if ( cmp_op != VSM_NOP ) {
+    const Ymsl_CODE pat[] = { op, VSM_BRANCH_FALSE };
+    if ( match(src, pos, pat, 2) ) {
+      dst.write_opcode(cmp_op);
+      write_addr(operand(src, pos + 1, 0), dst);
+      return 2;
+    }
+  }
+
+  if ( match(src, pos, imm_load_pat, 2) ) {
+    dst.write_opcode(VSM_PUSH_INT_IMM_LOAD_LOCAL_INT);
+    dst.write_int(operand(src, pos, 0));
+    dst.write_int(operand(src, pos + 1, 0));
+    return 2;
+  }
+
+  return 0;
+}
+
+// @brief 命令をそのまま複写する．
+// @param[in] src 元のコード
+// @param[in] pos 命令番号
+// @param[in] dst 出力先のコード
+void
+VsmPeephole::copy(const VsmCodeList::Builder& src,
+		  ymuint pos,
+		  VsmCodeList::Builder& dst)
+{
+  Ymsl_CODE op = src.read_opcode(mAddrList[pos]);
+  dst.write_opcode(op);
+  if ( is_jump(op) ) {
+    write_addr(operand(src, pos, 0), dst);
+    return;
+  }
+  if ( op == VSM_JUMP_TABLE ) {
+    dst.write_int(operand(src, pos, 0));
+    dst.write_int(operand(src, pos, 1));
+    write_addr(operand(src, pos, 2), dst);
+    return;
+  }
+  ymuint n = Vsm::operand_size(op);
+  for (ymuint i = 0; i < n; ++ i) {
+    dst.write_int(operand(src, pos, i));
+  }
+}
+
+// @brief 命令列が一致するか調べる．
+// @param[in] src 元のコード
+// @param[in] pos 先頭の命令番号
+// @param[in] pat_list 命令のパタン
+// @param[in] pat_num pat_list の要素数
+bool
+VsmPeephole::match(const VsmCodeList::Builder& src,
+		   ymuint pos,
+		   const Ymsl_CODE* pat_list,
+		   ymuint pat_num)
+{
+  if ( pos + pat_num >= mAddrList.size() ) {
+    return false;
+  }
+  for (ymuint i = 0; i < pat_num; ++ i) {
+    Ymsl_INT addr = mAddrList[pos + i];
+    if ( i > 0 && mTargetMark[addr] ) {
+      return false;
+    }
+    if ( src.read_opcode(addr) != pat_list[i] ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// @brief 命令のオペランドを読み出す．
+// @param[in] src 元のコード
+// @param[in] pos 命令番号
+// @param[in] idx オペランド番号
+Ymsl_INT
+VsmPeephole::operand(const VsmCodeList::Builder& src,
+		     ymuint pos,
+		     ymuint idx)
+{
+  return src.read_int(mAddrList[pos] + idx + 1);
+}
+
+// @brief ジャンプ先のアドレスを出力する．
+// @param[in] old_addr 元のコードでのアドレス
+// @param[in] dst 出力先のコード
+void
+VsmPeephole::write_addr(Ymsl_INT old_addr,
+			VsmCodeList::Builder& dst)
+{
+  mFixupList.push_back(make_pair(dst.size(), old_addr));
+  dst.write_int(-1);
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,138 @@
+#ifndef VSMPEEPHOLE_H
+#define VSMPEEPHOLE_H
+
+/// @file VsmPeephole.h
+/// @brief VsmPeephole のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "VsmCodeList.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmPeephole VsmPeephole.h "VsmPeephole.h"
+/// @brief VSM のコードに対する覗き穴最適化を行うクラス
+///
+/// よく現れる命令列を融合した命令(superinstruction)に置き換える．
+/// 途中の命令がジャンプ先になっている場合には置き換えない．
+/// ジャンプ先のアドレスは置き換え後のものに書き換える．
+/// ジャンプテーブルは同じ番号のまま中身を書き換える．
+/// スタックマップのアドレスも置き換え後のものに書き換える．
+//////////////////////////////////////////////////////////////////////
+class VsmPeephole
+{
+public:
+
+  /// @brief コンストラクタ
+  VsmPeephole();
+
+  /// @brief デストラクタ
+  ~VsmPeephole();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 最適化を行う．
+  /// @param[inout] builder 対象のコード
+  ///
+  /// ジャンプ先のアドレスは確定している必要がある．
+  void
+  optimize(VsmCodeList::Builder& builder);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 命令の先頭アドレスとジャンプ先を調べる．
+  /// @param[in] src 元のコード
+  void
+  scan(const VsmCodeList::Builder& src);
+
+  /// @brief 命令列を融合する．
+  /// @param[in] src 元のコード
+  /// @param[in] pos 先頭の命令番号
+  /// @param[in] dst 出力先のコード
+  /// @return 置き換えた命令数を返す．
+  ///
+  /// 置き換えなかった場合は 0 を返す．
+  ymuint
+  fuse(const VsmCodeList::Builder& src,
+       ymuint pos,
+       VsmCodeList::Builder& dst);
+
+  /// @brief 命令をそのまま複写する．
+  /// @param[in] src 元のコード
+  /// @param[in] pos 命令番号
+  /// @param[in] dst 出力先のコード
+  void
+  copy(const VsmCodeList::Builder& src,
+       ymuint pos,
+       VsmCodeList::Builder& dst);
+
+  /// @brief 命令列が一致するか調べる．
+  /// @param[in] src 元のコード
+  /// @param[in] pos 先頭の命令番号
+  /// @param[in] pat_list 命令のパタン
+  /// @param[in] pat_num pat_list の要素数
+  ///
+  /// 2番目以降の命令がジャンプ先になっている場合には一致しない．
+  bool
+  match(const VsmCodeList::Builder& src,
+	ymuint pos,
+	const Ymsl_CODE* pat_list,
+	ymuint pat_num);
+
+  /// @brief 命令のオペランドを読み出す．
+  /// @param[in] src 元のコード
+  /// @param[in] pos 命令番号
+  /// @param[in] idx オペランド番号
+  Ymsl_INT
+  operand(const VsmCodeList::Builder& src,
+	  ymuint pos,
+	  ymuint idx);
+
+  /// @brief ジャンプ先のアドレスを出力する．
+  /// @param[in] old_addr 元のコードでのアドレス
+  /// @param[in] dst 出力先のコード
+  ///
+  /// 実際の値は全ての命令を出力した後で書き込む．
+  void
+  write_addr(Ymsl_INT old_addr,
+	     VsmCodeList::Builder& dst);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 命令の先頭アドレスのリスト
+  // 末尾には番兵としてコードのサイズを置く．
+  vector<Ymsl_INT> mAddrList;
+
+  // 元のアドレスをキーにしてジャンプ先の時 true を持つ配列
+  vector<bool> mTargetMark;
+
+  // 元のアドレスをキーにして新しいアドレスを持つ配列
+  vector<Ymsl_INT> mAddrMap;
+
+  // バックパッチ用のリスト
+  // (書き換える位置, 元のアドレス) のペア
+  vector<pair<Ymsl_INT, Ymsl_INT> > mFixupList;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMPEEPHOLE_H
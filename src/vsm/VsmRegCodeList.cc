@@ -0,0 +1,47 @@
+
+/// @file VsmRegCodeList.cc
+/// @brief VsmRegCodeList の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmRegCodeList.h"
+#include "Vsm.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmRegCodeList::Builder
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+VsmRegCodeList::Builder::Builder()
+{
+}
+
+// @brief デストラクタ
+VsmRegCodeList::Builder::~Builder()
+{
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmRegCodeList
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] builder 初期化用オブジェクト
+VsmRegCodeList::VsmRegCodeList(const Builder& builder) :
+  VsmCodeList(builder, Vsm::reg_operand_format)
+{
+}
+
+// @brief デストラクタ
+VsmRegCodeList::~VsmRegCodeList()
+{
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,61 @@
+
+/// @file VsmRegFunc.cc
+/// @brief VsmRegFunc の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmRegFunc.h"
+#include "Vsm.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmRegFunc
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] name 関数名
+// @param[in] type 型
+// @param[in] code_list_builder コードリストの初期化用オブジェクト
+VsmRegFunc::VsmRegFunc(ShString name,
+		       const Type* type,
+		       const VsmRegCodeList::Builder& code_list_builder) :
+  VsmFunction(name, type),
+  mCodeList(code_list_builder)
+{
+}
+
+// @brief デストラクタ
+VsmRegFunc::~VsmRegFunc()
+{
+}
+
+// @brief 組み込み関数の時 true を返す．
+bool
+VsmRegFunc::is_builtin() const
+{
+  return false;
+}
+
+// @brief 組み込み関数の時の実行関数
+// @param[in] vsm 仮想マシン
+// @param[in] base ベースレジスタ
+void
+VsmRegFunc::execute(Vsm& vsm,
+		    Ymsl_INT base) const
+{
+  vsm.execute_reg(mCodeList, base);
+}
+
+// @brief レジスタ型のコードを返す．
+const VsmRegCodeList*
+VsmRegFunc::reg_code() const
+{
+  return &mCodeList;
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,81 @@
+#ifndef VSMREGFUNC_H
+#define VSMREGFUNC_H
+
+/// @file VsmRegFunc.h
+/// @brief VsmRegFunc のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmFunction.h"
+#include "VsmRegCodeList.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmRegFunc VsmRegFunc.h "VsmRegFunc.h"
+/// @brief YMSL で記述された関数を表すクラス(レジスタ型)
+//////////////////////////////////////////////////////////////////////
+class VsmRegFunc :
+  public VsmFunction
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] name 関数名
+  /// @param[in] type 型
+  /// @param[in] code_list_builder コードリストの初期化用オブジェクト
+  VsmRegFunc(ShString name,
+	     const Type* type,
+	     const VsmRegCodeList::Builder& code_list_builder);
+
+  /// @brief デストラクタ
+  ~VsmRegFunc();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 組み込み関数の時 true を返す．
+  virtual
+  bool
+  is_builtin() const;
+
+  /// @brief 組み込み関数の時の実行関数
+  /// @param[in] vsm 仮想マシン
+  /// @param[in] base ベースレジスタ
+  virtual
+  void
+  execute(Vsm& vsm,
+	  Ymsl_INT base) const;
+
+  /// @brief レジスタ型のコードを返す．
+  virtual
+  const VsmRegCodeList*
+  reg_code() const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // コードリスト
+  VsmRegCodeList mCodeList;
+
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMREGFUNC_H
@@ -0,0 +1,43 @@
+
+/// @file VsmRegModule.cc
+/// @brief VsmRegModule の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmRegModule.h"
+#include "Vsm.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmRegModule
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] module_builder モジュール用のビルダー
+// @param[in] toplevel_builder トップレベルのコードビルダー
+VsmRegModule::VsmRegModule(VsmModule::Builder& module_builder,
+			   VsmRegCodeList::Builder& toplevel_builder) :
+  VsmModule(module_builder),
+  mToplevelCode(toplevel_builder)
+{
+}
+
+// @brief デストラクタ
+VsmRegModule::~VsmRegModule()
+{
+}
+
+// @brief トップレベルの実行を行う．
+// @param[in] vsm 仮想マシン
+void
+VsmRegModule::execute_toplevel(Vsm& vsm) const
+{
+  vsm.execute_reg(mToplevelCode, 0);
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,68 @@
+#ifndef VSMREGMODULE_H
+#define VSMREGMODULE_H
+
+/// @file VsmRegModule.h
+/// @brief VsmRegModule のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmModule.h"
+#include "VsmRegCodeList.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmRegModule VsmRegModule.h "VsmRegModule.h"
+/// @brief YMSLネイティブの VsmModule(レジスタ型)
+//////////////////////////////////////////////////////////////////////
+class VsmRegModule :
+  public VsmModule
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] module_builder モジュール用のビルダー
+  /// @param[in] toplevel_builder トップレベルのコードビルダー
+  VsmRegModule(VsmModule::Builder& module_builder,
+	       VsmRegCodeList::Builder& toplevel_builder);
+
+  /// @brief デストラクタ
+  ~VsmRegModule();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief トップレベルの実行を行う．
+  /// @param[in] vsm 仮想マシン
+  virtual
+  void
+  execute_toplevel(Vsm& vsm) const;
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // 内部で用いられる関数
+  //////////////////////////////////////////////////////////////////////
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // トップレベルのコード
+  VsmRegCodeList mToplevelCode;
+
+  //
+};
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMREGMODULE_H
@@ -0,0 +1,341 @@
+
+/// @file VsmStack.cc
+/// @brief VsmStack の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmStack.h"
+
+#include <setjmp.h>
+
+#if defined(YMSL_USE_GUARD_PAGE)
+#include <sys/mman.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// run() の戻り先
+// シグナルハンドラから戻る場合はシグナルマスクも戻す．
+#if defined(YMSL_USE_GUARD_PAGE)
+typedef sigjmp_buf RecoverBuf;
+#define RECOVER_SET(buf)  sigsetjmp(buf, 1)
+#define RECOVER_JUMP(buf) siglongjmp(buf, 1)
+#else
+typedef jmp_buf RecoverBuf;
+#define RECOVER_SET(buf)  setjmp(buf)
+#define RECOVER_JUMP(buf) longjmp(buf, 1)
+#endif
+
+#if defined(YMSL_USE_GUARD_PAGE)
+
+// ガードページのバイト数
+// 1回の命令でこれを飛び越えてアクセスすることはないものとする．
+const ymuint64 kGuardSize = 64 * 1024;
+
+// このスレッドで run() を実行している VsmStack
+__thread VsmStack* tCurStack = NULL;
+
+// 元の SIGSEGV のハンドラ
+// install_handler() の中でのみ書き換える．
+struct sigaction old_action;
+
+// install_handler() を一度だけ実行するための制御変数
+pthread_once_t handler_once = PTHREAD_ONCE_INIT;
+
+// シグナルハンドラ用の代替スタックを破棄するためのキー
+pthread_key_t altstack_key;
+
+// シグナルハンドラ用の代替スタックのバイト数
+const ymuint64 kAltStackSize = 64 * 1024;
+
+// ページサイズの倍数に切り上げる．
+ymuint64
+round_up(ymuint64 size)
+{
+  ymuint64 page_size = sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+// SIGSEGV のハンドラ
+void
+fault_handler(int sig,
+	      siginfo_t* info,
+	      void* context)
+{
+  if ( VsmStack::handle_fault(info->si_addr) ) {
+    // 領域を広げたのでもう一度実行する．
+    return;
+  }
+
+  // 自分の領域ではないので元のハンドラに任せる．
+  if ( old_action.sa_flags & SA_SIGINFO ) {
+    (*old_action.sa_sigaction)(sig, info, context);
+  }
+  else if ( old_action.sa_handler != SIG_DFL &&
+	    old_action.sa_handler != SIG_IGN ) {
+    (*old_action.sa_handler)(sig);
+  }
+  else {
+    // 本来のアクセス違反なのでこの場でプロセスを終了させる．
+    // 元のハンドラに戻して命令を再実行させるのではなく，既定の動作に
+    // 戻した直後に SIGSEGV を起こす．他のスレッドの VsmStack から
+    // ハンドラが外れたまま実行が続くことはない．
+    struct sigaction action;
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    sigaction(SIGSEGV, &action, NULL);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGSEGV);
+    pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+    raise(SIGSEGV);
+    _exit(128 + SIGSEGV);
+  }
+}
+
+// スレッドの終了時に代替スタックを破棄する．
+void
+free_altstack(void* mem)
+{
+  stack_t ss;
+  ss.ss_sp = NULL;
+  ss.ss_flags = SS_DISABLE;
+  ss.ss_size = 0;
+  sigaltstack(&ss, NULL);
+  munmap(mem, kAltStackSize);
+}
+
+// SIGSEGV のハンドラを登録する．
+// pthread_once() から一度だけ呼ばれる．
+void
+install_handler()
+{
+  pthread_key_create(&altstack_key, free_altstack);
+
+  struct sigaction action;
+  action.sa_sigaction = fault_handler;
+  sigemptyset(&action.sa_mask);
+  // ネイティブスタックが溢れた場合でもハンドラを実行できるように
+  // 代替スタックの上で実行する．
+  action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigaction(SIGSEGV, &action, &old_action);
+}
+
+// このスレッドにシグナルハンドラ用の代替スタックを設定する．
+// 既に設定されている場合はそれを使う．
+void
+install_altstack()
+{
+  stack_t old_ss;
+  if ( sigaltstack(NULL, &old_ss) != 0 ) {
+    return;
+  }
+  if ( (old_ss.ss_flags & SS_DISABLE) == 0 ) {
+    return;
+  }
+
+  void* mem = mmap(NULL, kAltStackSize, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ( mem == MAP_FAILED ) {
+    // 代替スタックなしでもガードページの検出はできる．
+    return;
+  }
+  stack_t ss;
+  ss.ss_sp = mem;
+  ss.ss_flags = 0;
+  ss.ss_size = kAltStackSize;
+  if ( sigaltstack(&ss, NULL) != 0 ) {
+    munmap(mem, kAltStackSize);
+    return;
+  }
+  pthread_setspecific(altstack_key, mem);
+}
+
+#endif
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス VsmStack
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] size 最初に確保する要素数
+// @param[in] max_size 伸長する場合の最大の要素数
+//
+// max_size が size 以下の場合は伸長しない．
+VsmStack::VsmStack(Ymsl_INT size,
+		   Ymsl_INT max_size)
+{
+  if ( max_size < size ) {
+    max_size = size;
+  }
+  mSize = size;
+  mMaxSize = max_size;
+  mSegSize = size;
+  mRecover = NULL;
+  mPrev = NULL;
+
+#if defined(YMSL_USE_GUARD_PAGE)
+  pthread_once(&handler_once, install_handler);
+
+  // max_size 分の領域とガードページをまとめて予約しておき，
+  // 先頭の size 分だけを読み書きできるようにする．
+  ymuint64 body_size = round_up(mMaxSize * sizeof(VsmValue));
+  mMapSize = body_size + kGuardSize;
+  void* mem = mmap(NULL, mMapSize, PROT_NONE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if ( mem != MAP_FAILED ) {
+    if ( mprotect(mem, round_up(mSize * sizeof(VsmValue)),
+		  PROT_READ | PROT_WRITE) == 0 ) {
+      mBody = reinterpret_cast<VsmValue*>(mem);
+      return;
+    }
+    munmap(mem, mMapSize);
+  }
+  // 確保できなかったのでガードページなしの領域を使う．
+  // オーバーフローは ensure() による検査でのみ検出する．
+#endif
+  mMaxSize = size;
+  mMapSize = 0;
+  mBody = new VsmValue[mSize];
+}
+
+// @brief デストラクタ
+VsmStack::~VsmStack()
+{
+#if defined(YMSL_USE_GUARD_PAGE)
+  if ( mMapSize > 0 ) {
+    munmap(mBody, mMapSize);
+    return;
+  }
+#endif
+  delete [] mBody;
+}
+
+// @brief オーバーフローを検出しながら関数を実行する．
+// @param[in] func 実行する関数
+// @param[in] arg func に渡す引数
+// @return オーバーフローが起きたら false を返す．
+bool
+VsmStack::run(void (*func)(void*),
+	      void* arg)
+{
+  RecoverBuf recover;
+  void* old_recover = mRecover;
+#if defined(YMSL_USE_GUARD_PAGE)
+  VsmStack* old_prev = mPrev;
+  VsmStack* old_stack = tCurStack;
+#endif
+  if ( RECOVER_SET(recover) != 0 ) {
+    // overflow() から戻ってきた．
+    mRecover = old_recover;
+#if defined(YMSL_USE_GUARD_PAGE)
+    mPrev = old_prev;
+    tCurStack = old_stack;
+#endif
+    return false;
+  }
+
+  mRecover = &recover;
+#if defined(YMSL_USE_GUARD_PAGE)
+  if ( old_stack == NULL ) {
+    // このスレッドで最初の run() なので代替スタックを用意する．
+    install_altstack();
+  }
+  if ( old_stack != this ) {
+    // 同じスタックで入れ子になった場合はつながない．
+    mPrev = old_stack;
+  }
+  tCurStack = this;
+#endif
+
+  (*func)(arg);
+
+  mRecover = old_recover;
+#if defined(YMSL_USE_GUARD_PAGE)
+  mPrev = old_prev;
+  tCurStack = old_stack;
+#endif
+  return true;
+}
+
+// @brief 要素数が足りているか調べる．
+// @param[in] size 必要な要素数
+// @return 足りない場合に伸長もできなければ false を返す．
+bool
+VsmStack::ensure(Ymsl_INT size)
+{
+  if ( size <= mSize ) {
+    return true;
+  }
+  if ( size > mMaxSize ) {
+    return false;
+  }
+
+#if defined(YMSL_USE_GUARD_PAGE)
+  Ymsl_INT new_size = mSize;
+  while ( new_size < size ) {
+    new_size += mSegSize;
+  }
+  if ( new_size > mMaxSize ) {
+    new_size = mMaxSize;
+  }
+  if ( mprotect(mBody, round_up(new_size * sizeof(VsmValue)),
+		PROT_READ | PROT_WRITE) != 0 ) {
+    return false;
+  }
+  mSize = new_size;
+#endif
+  return true;
+}
+
+// @brief スタックオーバーフローとして run() の呼び出し元に戻る．
+void
+VsmStack::overflow()
+{
+  ASSERT_COND( mRecover != NULL );
+  RECOVER_JUMP(*reinterpret_cast<RecoverBuf*>(mRecover));
+}
+
+// @brief アクセス違反の起きたアドレスを調べる．
+// @param[in] addr アドレス
+// @return 実行中のスタックの伸長で処理できた場合には true を返す．
+bool
+VsmStack::handle_fault(void* addr)
+{
+#if defined(YMSL_USE_GUARD_PAGE)
+  // 入れ子になった run() の外側のスタックも調べる．
+  for (VsmStack* stack = tCurStack; stack != NULL; stack = stack->mPrev) {
+    char* top = reinterpret_cast<char*>(stack->mBody);
+    char* end = top + stack->mMapSize;
+    char* p = reinterpret_cast<char*>(addr);
+    if ( p < top + stack->mSize * sizeof(VsmValue) || p >= end ) {
+      continue;
+    }
+
+    // 末尾を越えたので伸長する．
+    Ymsl_INT need = (p - top) / sizeof(VsmValue) + 1;
+    if ( stack->ensure(need) ) {
+      return true;
+    }
+
+    // 伸長できないので run() の呼び出し元に戻る．
+    stack->overflow();
+  }
+#endif
+  return false;
+}
+
+END_NAMESPACE_YM_YMSL
@@ -0,0 +1,172 @@
+#ifndef VSMSTACK_H
+#define VSMSTACK_H
+
+/// @file VsmStack.h
+/// @brief VsmStack のヘッダファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ymsl_int.h"
+#include "VsmValue.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+//////////////////////////////////////////////////////////////////////
+/// @class VsmStack VsmStack.h "VsmStack.h"
+/// @brief Vsm のローカルスタックの領域を表すクラス
+///
+/// YMSL_USE_GUARD_PAGE が定義されている場合には mmap() で確保し，
+/// 末尾に PROT_NONE のガードページを置く．push のたびに容量を
+/// 調べる代わりに，ガードページへのアクセスで起きる SIGSEGV を
+/// 捕まえてスタックオーバーフローとする．
+///
+/// max_size が size より大きい場合は max_size 分の仮想アドレスを
+/// 予約しておき，末尾を越えたら size ずつ使える領域を広げる．
+/// 先頭のアドレスは変わらないので VsmValue* はそのまま使える．
+///
+/// SIGSEGV のハンドラは最初のコンストラクタで一度だけ登録し，
+/// 各スレッドで最初に run() を呼んだ時に代替スタックを設定する．
+/// mmap() に失敗した場合は new で確保した伸長しない領域を使う．
+///
+/// YMSL_USE_GUARD_PAGE が定義されていない場合には new で確保し，
+/// 伸長もしない．この場合は呼び出し時の ensure() による検査でのみ
+/// オーバーフローを検出する．
+//////////////////////////////////////////////////////////////////////
+class VsmStack
+{
+public:
+
+  /// @brief コンストラクタ
+  /// @param[in] size 最初に確保する要素数
+  /// @param[in] max_size 伸長する場合の最大の要素数
+  ///
+  /// max_size が size 以下の場合は伸長しない．
+  VsmStack(Ymsl_INT size,
+	   Ymsl_INT max_size);
+
+  /// @brief デストラクタ
+  ~VsmStack();
+
+
+public:
+  //////////////////////////////////////////////////////////////////////
+  // 外部インターフェイス
+  //////////////////////////////////////////////////////////////////////
+
+  /// @brief 領域の先頭を返す．
+  VsmValue*
+  body() const;
+
+  /// @brief 現在使える要素数を返す．
+  Ymsl_INT
+  size() const;
+
+  /// @brief 伸長する場合の最大の要素数を返す．
+  ///
+  /// 伸長しない場合は size() と等しい．
+  Ymsl_INT
+  max_size() const;
+
+  /// @brief 要素数が足りているか調べる．
+  /// @param[in] size 必要な要素数
+  /// @return 足りない場合に伸長もできなければ false を返す．
+  bool
+  ensure(Ymsl_INT size);
+
+  /// @brief スタックオーバーフローとして run() の呼び出し元に戻る．
+  ///
+  /// run() の実行中に呼ばなければならない．
+  void
+  overflow();
+
+  /// @brief オーバーフローを検出しながら関数を実行する．
+  /// @param[in] func 実行する関数
+  /// @param[in] arg func に渡す引数
+  /// @return オーバーフローが起きたら false を返す．
+  ///
+  /// ガードページへのアクセスか overflow() の呼び出しがあった時点で
+  /// func の実行は打ち切られる．
+  /// 入れ子になっていてもよい．
+  bool
+  run(void (*func)(void*),
+      void* arg);
+
+  /// @brief アクセス違反の起きたアドレスを調べる．
+  /// @param[in] addr アドレス
+  /// @return 実行中のスタックの伸長で処理できた場合には true を返す．
+  ///
+  /// SIGSEGV のハンドラから呼ばれる．
+  /// 実行中のスタックの末尾を越えたアドレスの場合，伸長できるなら
+  /// 領域を広げて戻る．伸長できないなら run() の呼び出し元に戻る．
+  /// それ以外のアドレスの場合は false を返す．
+  static
+  bool
+  handle_fault(void* addr);
+
+
+private:
+  //////////////////////////////////////////////////////////////////////
+  // データメンバ
+  //////////////////////////////////////////////////////////////////////
+
+  // 領域の先頭
+  VsmValue* mBody;
+
+  // 現在使える要素数
+  Ymsl_INT mSize;
+
+  // 最大の要素数
+  Ymsl_INT mMaxSize;
+
+  // 伸長する時の要素数の単位
+  Ymsl_INT mSegSize;
+
+  // 予約した領域全体のバイト数
+  // new で確保した場合は 0
+  ymuint64 mMapSize;
+
+  // オーバーフロー時の戻り先
+  // run() の実行中以外は NULL
+  void* mRecover;
+
+  // 一つ外側で run() を実行している VsmStack
+  VsmStack* mPrev;
+
+};
+
+
+//////////////////////////////////////////////////////////////////////
+// インライン関数の定義
+//////////////////////////////////////////////////////////////////////
+
+// @brief 領域の先頭を返す．
+inline
+VsmValue*
+VsmStack::body() const
+{
+  return mBody;
+}
+
+// @brief 現在使える要素数を返す．
+inline
+Ymsl_INT
+VsmStack::size() const
+{
+  return mSize;
+}
+
+// @brief 伸長する場合の最大の要素数を返す．
+inline
+Ymsl_INT
+VsmStack::max_size() const
+{
+  return mMaxSize;
+}
+
+END_NAMESPACE_YM_YMSL
+
+#endif // VSMSTACK_H
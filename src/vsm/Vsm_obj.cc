@@ -0,0 +1,386 @@
+
+/// @file Vsm_obj.cc
+/// @brief Vsm のオブジェクトの演算の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "Vsm.h"
+#include "VsmHeap.h"
+#include "YmslObj.h"
+
+#include <cstdlib>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 二項演算のオペランドが同じ種類のオブジェクトの時 true を返す．
+// NULL の場合は演算できないので false を返す．
+inline
+bool
+same_kind(Ymsl_OBJPTR val1,
+	  Ymsl_OBJPTR val2)
+{
+  return val1 != NULL && val2 != NULL && val1->kind() == val2->kind();
+}
+
+// 集合(連想配列)の要素を全て dst に加える．
+// 連想配列の場合は値も写す．同じキーがあれば src の値で置き換える．
+void
+insert_all(YmslSet* dst,
+	   const YmslSet* src)
+{
+  bool is_map = (src->kind() == YmslObj::kMap);
+  for (ymuint i = 0; i < src->table_size(); ++ i) {
+    if ( !src->is_used(i) ) {
+      continue;
+    }
+    if ( is_map ) {
+      dst->insert(src->key(i), src->value(i));
+    }
+    else {
+      dst->insert(src->key(i));
+    }
+  }
+}
+
+// src の要素のうち ref に含まれる(include が true の時)か
+// 含まれない(include が false の時)ものを dst に加える．
+void
+insert_filtered(YmslSet* dst,
+		const YmslSet* src,
+		const YmslSet* ref,
+		bool include)
+{
+  bool is_map = (src->kind() == YmslObj::kMap);
+  for (ymuint i = 0; i < src->table_size(); ++ i) {
+    if ( !src->is_used(i) ) {
+      continue;
+    }
+    if ( (ref->find(src->key(i)) >= 0) != include ) {
+      continue;
+    }
+    if ( is_map ) {
+      dst->insert(src->key(i), src->value(i));
+    }
+    else {
+      dst->insert(src->key(i));
+    }
+  }
+}
+
+// set1 が set2 の部分集合の時 true を返す．
+bool
+is_subset(const YmslSet* set1,
+	  const YmslSet* set2)
+{
+  if ( set1->size() > set2->size() ) {
+    return false;
+  }
+  for (ymuint i = 0; i < set1->table_size(); ++ i) {
+    if ( set1->is_used(i) && set2->find(set1->key(i)) < 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 数値の配列を辞書順で比較する．
+template <typename T>
+int
+compare_array(const T* body1,
+	      ymuint n1,
+	      const T* body2,
+	      ymuint n2)
+{
+  ymuint n = (n1 < n2) ? n1 : n2;
+  for (ymuint i = 0; i < n; ++ i) {
+    if ( body1[i] < body2[i] ) {
+      return -1;
+    }
+    if ( body2[i] < body1[i] ) {
+      return 1;
+    }
+  }
+  if ( n1 < n2 ) {
+    return -1;
+  }
+  if ( n1 > n2 ) {
+    return 1;
+  }
+  return 0;
+}
+
+// 文字列か数値の配列を辞書順で比較する．
+// 比較できない場合は false を返す．
+bool
+compare_seq(Ymsl_OBJPTR val1,
+	    Ymsl_OBJPTR val2,
+	    int& result)
+{
+  switch ( val1->kind() ) {
+  case YmslObj::kString:
+    result = YmslString::compare(static_cast<const YmslString*>(val1),
+				 static_cast<const YmslString*>(val2));
+    return true;
+
+  case YmslObj::kIntArray:
+    {
+      const YmslArray* array1 = static_cast<const YmslArray*>(val1);
+      const YmslArray* array2 = static_cast<const YmslArray*>(val2);
+      result = compare_array(array1->int_body(), array1->size(),
+			     array2->int_body(), array2->size());
+    }
+    return true;
+
+  case YmslObj::kFloatArray:
+    {
+      const YmslArray* array1 = static_cast<const YmslArray*>(val1);
+      const YmslArray* array2 = static_cast<const YmslArray*>(val2);
+      result = compare_array(array1->float_body(), array1->size(),
+			     array2->float_body(), array2->size());
+    }
+    return true;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス Vsm
+//////////////////////////////////////////////////////////////////////
+
+// @brief オブジェクトの加算を行う．
+// @param[in] val1, val2 オペランド
+//
+// 文字列と配列は連結，集合は和集合，連想配列は併合する．
+Ymsl_OBJPTR
+Vsm::obj_add(Ymsl_OBJPTR val1,
+	     Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return NULL;
+  }
+
+  switch ( val1->kind() ) {
+  case YmslObj::kString:
+    return mHeap->new_string(static_cast<const YmslString*>(val1),
+			     static_cast<const YmslString*>(val2));
+
+  case YmslObj::kIntArray:
+  case YmslObj::kFloatArray:
+  case YmslObj::kObjArray:
+    return mHeap->new_array(static_cast<const YmslArray*>(val1),
+			    static_cast<const YmslArray*>(val2));
+
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    return obj_or(val1, val2);
+  }
+  return NULL;
+}
+
+// @brief オブジェクトの減算を行う．
+// @param[in] val1, val2 オペランド
+//
+// 集合は差集合，連想配列は val2 のキーを取り除いたものを作る．
+Ymsl_OBJPTR
+Vsm::obj_sub(Ymsl_OBJPTR val1,
+	     Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return NULL;
+  }
+
+  switch ( val1->kind() ) {
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    {
+      const YmslSet* set1 = static_cast<const YmslSet*>(val1);
+      const YmslSet* set2 = static_cast<const YmslSet*>(val2);
+      YmslSet* ans = mHeap->new_set(set1->type());
+      insert_filtered(ans, set1, set2, false);
+      return ans;
+    }
+
+  default:
+    break;
+  }
+  return NULL;
+}
+
+// @brief オブジェクトの論理積を行う．
+// @param[in] val1, val2 オペランド
+//
+// 集合は共通部分，連想配列は val2 にもあるキーを残したものを作る．
+Ymsl_OBJPTR
+Vsm::obj_and(Ymsl_OBJPTR val1,
+	     Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return NULL;
+  }
+
+  switch ( val1->kind() ) {
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    {
+      const YmslSet* set1 = static_cast<const YmslSet*>(val1);
+      const YmslSet* set2 = static_cast<const YmslSet*>(val2);
+      YmslSet* ans = mHeap->new_set(set1->type());
+      insert_filtered(ans, set1, set2, true);
+      return ans;
+    }
+
+  default:
+    break;
+  }
+  return NULL;
+}
+
+// @brief オブジェクトの論理和を行う．
+// @param[in] val1, val2 オペランド
+//
+// 集合は和集合，連想配列は併合したものを作る．
+// 連想配列で同じキーがある場合は val2 の値を用いる．
+Ymsl_OBJPTR
+Vsm::obj_or(Ymsl_OBJPTR val1,
+	    Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return NULL;
+  }
+
+  switch ( val1->kind() ) {
+  case YmslObj::kSet:
+  case YmslObj::kMap:
+    {
+      const YmslSet* set1 = static_cast<const YmslSet*>(val1);
+      const YmslSet* set2 = static_cast<const YmslSet*>(val2);
+      YmslSet* ans = mHeap->new_set(set1->type());
+      insert_all(ans, set1);
+      insert_all(ans, set2);
+      return ans;
+    }
+
+  default:
+    break;
+  }
+  return NULL;
+}
+
+// @brief オブジェクトの排他的論理和を行う．
+// @param[in] val1, val2 オペランド
+//
+// 集合の対称差を作る．
+Ymsl_OBJPTR
+Vsm::obj_xor(Ymsl_OBJPTR val1,
+	     Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) || val1->kind() != YmslObj::kSet ) {
+    return NULL;
+  }
+
+  const YmslSet* set1 = static_cast<const YmslSet*>(val1);
+  const YmslSet* set2 = static_cast<const YmslSet*>(val2);
+  YmslSet* ans = mHeap->new_set(set1->type());
+  insert_filtered(ans, set1, set2, false);
+  insert_filtered(ans, set2, set1, false);
+  return ans;
+}
+
+// @brief オブジェクトの小なり比較を行う．
+// @param[in] val1, val2 オペランド
+//
+// 文字列と数値の配列は辞書順，集合は真部分集合かどうかで比べる．
+Ymsl_INT
+Vsm::obj_lt(Ymsl_OBJPTR val1,
+	    Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return 0;
+  }
+
+  if ( val1->kind() == YmslObj::kSet ) {
+    return val1->size() < val2->size() &&
+      is_subset(static_cast<const YmslSet*>(val1),
+		static_cast<const YmslSet*>(val2));
+  }
+
+  int result;
+  if ( compare_seq(val1, val2, result) ) {
+    return result < 0;
+  }
+  return 0;
+}
+
+// @brief オブジェクトの小なりイコール比較を行う．
+// @param[in] val1, val2 オペランド
+//
+// 集合は部分集合かどうかで比べる．
+Ymsl_INT
+Vsm::obj_le(Ymsl_OBJPTR val1,
+	    Ymsl_OBJPTR val2)
+{
+  if ( !same_kind(val1, val2) ) {
+    return val1 == val2;
+  }
+
+  if ( val1->kind() == YmslObj::kSet ) {
+    return is_subset(static_cast<const YmslSet*>(val1),
+		     static_cast<const YmslSet*>(val2));
+  }
+
+  int result;
+  if ( compare_seq(val1, val2, result) ) {
+    return result <= 0;
+  }
+  return YmslObj::equal(val1, val2);
+}
+
+// @brief オブジェクトを INT に変換する．
+// @param[in] val オペランド
+//
+// 文字列は数値として読んだ値，それ以外は要素数を返す．
+// NULL は 0 になる．
+Ymsl_INT
+Vsm::obj_to_int(Ymsl_OBJPTR val)
+{
+  if ( val == NULL ) {
+    return 0;
+  }
+  if ( val->kind() == YmslObj::kString ) {
+    const YmslString* str = static_cast<const YmslString*>(val);
+    return strtol(str->str(), NULL, 0);
+  }
+  return val->size();
+}
+
+// @brief オブジェクトを FLOAT に変換する．
+// @param[in] val オペランド
+//
+// 文字列は数値として読んだ値，それ以外は要素数を返す．
+// NULL は 0.0 になる．
+Ymsl_FLOAT
+Vsm::obj_to_float(Ymsl_OBJPTR val)
+{
+  if ( val == NULL ) {
+    return 0.0;
+  }
+  if ( val->kind() == YmslObj::kString ) {
+    const YmslString* str = static_cast<const YmslString*>(val);
+    return strtod(str->str(), NULL);
+  }
+  return val->size();
+}
+
+END_NAMESPACE_YM_YMSL
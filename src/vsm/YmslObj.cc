@@ -0,0 +1,802 @@
+
+/// @file YmslObj.cc
+/// @brief YmslObj とその派生クラスの実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "YmslObj.h"
+#include "Type.h"
+#include "VsmHeap.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 集合と連想配列の表の初期サイズ
+const ymuint kInitTableSize = 8;
+
+// 配列の種類から要素一つのバイト数を求める．
+ymuint
+elem_size_of(YmslObj::Kind kind)
+{
+  switch ( kind ) {
+  case YmslObj::kIntArray:   return sizeof(Ymsl_INT);
+  case YmslObj::kFloatArray: return sizeof(Ymsl_FLOAT);
+  default: break;
+  }
+  return sizeof(Ymsl_OBJPTR);
+}
+
+// 配列の型から種類を求める．
+YmslObj::Kind
+kind_of(const Type* type)
+{
+  switch ( YmslObj::val_class(type->elem_type()) ) {
+  case YmslObj::kClassInt:   return YmslObj::kIntArray;
+  case YmslObj::kClassFloat: return YmslObj::kFloatArray;
+  case YmslObj::kClassObj:   break;
+  }
+  return YmslObj::kObjArray;
+}
+
+END_NONAMESPACE
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslObj
+//////////////////////////////////////////////////////////////////////
+
+// @brief ヘッダを含めたオブジェクトの大きさ(バイト数)を返す．
+ymuint64
+YmslObj::alloc_size() const
+{
+  switch ( kind() ) {
+  case kString:
+    if ( static_cast<const YmslString*>(this)->is_rope() ) {
+      return sizeof(YmslRope);
+    }
+    return YmslString::alloc_size(size());
+
+  case kIntArray:
+  case kFloatArray:
+  case kObjArray:
+    return sizeof(YmslArray) +
+      static_cast<ymuint64>(size()) * elem_size_of(kind());
+
+  default:
+    break;
+  }
+  return sizeof(YmslSet);
+}
+
+// @brief オブジェクトを解放する．
+// @param[in] obj 対象のオブジェクト
+void
+YmslObj::destroy(YmslObj* obj)
+{
+  if ( obj == NULL ) {
+    return;
+  }
+
+  switch ( obj->kind() ) {
+  case kSet:
+  case kMap:
+    static_cast<YmslSet*>(obj)->free_table();
+    break;
+
+  case kString:
+    // 連結を表すノードのまとめた中身だけは別に確保している．
+    if ( static_cast<YmslString*>(obj)->is_rope() ) {
+      delete [] static_cast<YmslRope*>(obj)->mFlat;
+    }
+    break;
+
+  default:
+    // 配列の中身はヘッダと一緒に確保している．
+    break;
+  }
+
+  // どのクラスもデストラクタではなにもしないので
+  // 領域を解放するだけでよい．
+  free(obj);
+}
+
+// @brief 型から値の格納クラスを求める．
+// @param[in] type 型
+YmslObj::ValClass
+YmslObj::val_class(const Type* type)
+{
+  if ( type != NULL ) {
+    switch ( type->type_id() ) {
+    case kBooleanType:
+    case kIntType:
+    case kEnumType:
+      return kClassInt;
+
+    case kFloatType:
+      return kClassFloat;
+
+    default:
+      break;
+    }
+  }
+  return kClassObj;
+}
+
+// @brief 値のハッシュ値を求める．
+// @param[in] val_class 格納クラス
+// @param[in] val 値
+ymuint
+YmslObj::hash(ValClass val_class,
+	      VsmValue val)
+{
+  switch ( val_class ) {
+  case kClassInt:
+    return static_cast<ymuint>(val.int_value);
+
+  case kClassFloat:
+    {
+      // 0.0 と -0.0 は等しいので同じハッシュ値にする．
+      Ymsl_FLOAT f = val.float_value;
+      if ( f == 0.0 ) {
+	f = 0.0;
+      }
+      ymuint64 bits;
+      memcpy(&bits, &f, sizeof(Ymsl_FLOAT));
+      return static_cast<ymuint>(bits ^ (bits >> 32));
+    }
+
+  case kClassObj:
+    return hash(val.obj_value);
+  }
+  return 0;
+}
+
+// @brief 二つの値が等しい時 true を返す．
+// @param[in] val_class 格納クラス
+// @param[in] val1, val2 値
+bool
+YmslObj::equal(ValClass val_class,
+	       VsmValue val1,
+	       VsmValue val2)
+{
+  switch ( val_class ) {
+  case kClassInt:
+    return val1.int_value == val2.int_value;
+
+  case kClassFloat:
+    return val1.float_value == val2.float_value;
+
+  case kClassObj:
+    // スクリプトの == と同じく中身で比べる．
+    // 命令がオブジェクトの中身を書き換えることはないので，
+    // キーにした後でハッシュ値が変わることはない．
+    return equal(val1.obj_value, val2.obj_value);
+  }
+  return false;
+}
+
+// @brief 二つのオブジェクトが等しい時 true を返す．
+// @param[in] obj1, obj2 オブジェクト
+bool
+YmslObj::equal(const YmslObj* obj1,
+	       const YmslObj* obj2)
+{
+  if ( obj1 == obj2 ) {
+    return true;
+  }
+  if ( obj1 == NULL || obj2 == NULL ) {
+    return false;
+  }
+  if ( obj1->kind() != obj2->kind() || obj1->size() != obj2->size() ) {
+    return false;
+  }
+
+  ymuint n = obj1->size();
+  switch ( obj1->kind() ) {
+  case kString:
+    return YmslString::is_equal(static_cast<const YmslString*>(obj1),
+				static_cast<const YmslString*>(obj2));
+
+  case kIntArray:
+  case kFloatArray:
+    {
+      const YmslArray* array1 = static_cast<const YmslArray*>(obj1);
+      const YmslArray* array2 = static_cast<const YmslArray*>(obj2);
+      return memcmp(array1->body(), array2->body(), n * array1->elem_size()) == 0;
+    }
+
+  case kObjArray:
+    {
+      const Ymsl_OBJPTR* body1 = static_cast<const YmslArray*>(obj1)->obj_body();
+      const Ymsl_OBJPTR* body2 = static_cast<const YmslArray*>(obj2)->obj_body();
+      for (ymuint i = 0; i < n; ++ i) {
+	if ( !equal(body1[i], body2[i]) ) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+  case kSet:
+  case kMap:
+    {
+      const YmslSet* set1 = static_cast<const YmslSet*>(obj1);
+      const YmslSet* set2 = static_cast<const YmslSet*>(obj2);
+      bool is_map = (obj1->kind() == kMap);
+      for (ymuint i = 0; i < set1->table_size(); ++ i) {
+	if ( !set1->is_used(i) ) {
+	  continue;
+	}
+	int pos = set2->find(set1->key(i));
+	if ( pos < 0 ) {
+	  return false;
+	}
+	if ( is_map &&
+	     !equal(set1->value_class(), set1->value(i), set2->value(pos)) ) {
+	  return false;
+	}
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// @brief オブジェクトのハッシュ値を内容から求める．
+// @param[in] obj オブジェクト
+//
+// 配列は equal() と同じく INT と FLOAT の要素をバイト列で扱う．
+// 集合と連想配列は要素のハッシュ値の和にする．
+ymuint
+YmslObj::hash(const YmslObj* obj)
+{
+  if ( obj == NULL ) {
+    return 0;
+  }
+
+  ymuint n = obj->size();
+  ymuint h = obj->kind() * 0x9e3779b9U + n;
+  switch ( obj->kind() ) {
+  case kString:
+    return static_cast<const YmslString*>(obj)->hash();
+
+  case kIntArray:
+  case kFloatArray:
+    {
+      const YmslArray* array = static_cast<const YmslArray*>(obj);
+      const ymuint8* p = static_cast<const ymuint8*>(array->body());
+      ymuint64 nbytes = static_cast<ymuint64>(n) * array->elem_size();
+      for (ymuint64 i = 0; i < nbytes; ++ i) {
+	h = h * 37 + p[i];
+      }
+    }
+    break;
+
+  case kObjArray:
+    {
+      const Ymsl_OBJPTR* body = static_cast<const YmslArray*>(obj)->obj_body();
+      for (ymuint i = 0; i < n; ++ i) {
+	h = h * 37 + hash(body[i]);
+      }
+    }
+    break;
+
+  case kSet:
+  case kMap:
+    {
+      const YmslSet* set = static_cast<const YmslSet*>(obj);
+      bool is_map = (obj->kind() == kMap);
+      for (ymuint i = 0; i < set->table_size(); ++ i) {
+	if ( !set->is_used(i) ) {
+	  continue;
+	}
+	ymuint h1 = hash(set->key_class(), set->key(i));
+	if ( is_map ) {
+	  h1 = h1 * 37 + hash(set->value_class(), set->value(i));
+	}
+	h += h1;
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+  return h;
+}
+
+// @brief ヘッダの直後に size バイトを置いたオブジェクトの領域を確保する．
+// @param[in] obj_size オブジェクトの大きさ
+// @param[in] size 直後に置くバイト数
+void*
+YmslObj::alloc(ymuint obj_size,
+	       ymuint64 size)
+{
+  void* p = malloc(obj_size + size);
+  if ( p == NULL ) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslString
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] len 文字数
+YmslString::YmslString(ymuint len) :
+  YmslObj(kString, NULL, len),
+  mHash(0)
+{
+}
+
+// @brief 文字列を作る．
+// @param[in] str 文字列
+// @param[in] len 文字数
+YmslString*
+YmslString::new_obj(const char* str,
+		    ymuint len)
+{
+  return new_obj(alloc(sizeof(YmslString), len + 1), str, len);
+}
+
+// @brief 二つの文字列をつないだ文字列を作る．
+// @param[in] str1, str2 文字列
+YmslString*
+YmslString::new_obj(const YmslString* str1,
+		    const YmslString* str2)
+{
+  void* p = alloc(sizeof(YmslString), str1->size() + str2->size() + 1);
+  return new_obj(p, str1, str2);
+}
+
+// @brief 確保した領域の上に文字列を作る．
+// @param[in] p 領域の先頭
+// @param[in] str 文字列
+// @param[in] len 文字数
+YmslString*
+YmslString::new_obj(void* p,
+		    const char* str,
+		    ymuint len)
+{
+  YmslString* obj = new (p) YmslString(len);
+  char* body = obj->buf();
+  memcpy(body, str, len);
+  body[len] = '\0';
+  return obj;
+}
+
+// @brief 確保した領域の上に二つの文字列をつないだ文字列を作る．
+// @param[in] p 領域の先頭
+// @param[in] str1, str2 文字列
+YmslString*
+YmslString::new_obj(void* p,
+		    const YmslString* str1,
+		    const YmslString* str2)
+{
+  ymuint len1 = str1->size();
+  ymuint len2 = str2->size();
+  YmslString* obj = new (p) YmslString(len1 + len2);
+  char* body = obj->buf();
+  memcpy(body, str1->str(), len1);
+  memcpy(body + len1, str2->str(), len2);
+  body[len1 + len2] = '\0';
+  return obj;
+}
+
+// @brief 文字列に必要な領域の大きさ(バイト数)を返す．
+// @param[in] len 文字数
+ymuint64
+YmslString::alloc_size(ymuint len)
+{
+  return sizeof(YmslString) + static_cast<ymuint64>(len) + 1;
+}
+
+// @brief 二つの文字列の連結を表すノードを作る．
+// @param[in] heap ノードを管理するオブジェクト
+// @param[in] str1, str2 文字列
+YmslString*
+YmslString::new_rope(VsmHeap* heap,
+		     const YmslString* str1,
+		     const YmslString* str2)
+{
+  void* p = alloc(sizeof(YmslRope), 0);
+  return new (p) YmslRope(heap, str1, str2);
+}
+
+// @brief ハッシュ値を返す．
+ymuint
+YmslString::hash() const
+{
+  if ( bits() & kHashBit ) {
+    return mHash;
+  }
+
+  const char* s = str();
+  ymuint h = 0;
+  for (ymuint i = 0; i < size(); ++ i) {
+    h = h * 37 + static_cast<ymuint8>(s[i]);
+  }
+
+  // static な文字列は複数の Vsm から共有されているので書き換えない．
+  // 定数表の文字列は作る時に求めてあるのでここには来ない．
+  if ( is_static() ) {
+    return h;
+  }
+
+  // 中身は変わらないので一度求めたら覚えておく．
+  YmslString* self = const_cast<YmslString*>(this);
+  self->mHash = h;
+  self->set_bits(kHashBit);
+  return h;
+}
+
+// @brief 連結を表すノードの中身をまとめた文字列を返す．
+//
+// 連結の木は深くなりうるので再帰を使わずにたどる．
+// まとめた後は元の文字列を指さなくなるのでごみ集めで回収される．
+const char*
+YmslString::flat_str() const
+{
+  YmslRope* rope = static_cast<YmslRope*>(const_cast<YmslString*>(this));
+  if ( rope->mFlat != NULL ) {
+    return rope->mFlat;
+  }
+
+  char* flat = new char[size() + 1];
+  ymuint pos = 0;
+  vector<const YmslString*> stack;
+  stack.push_back(this);
+  while ( !stack.empty() ) {
+    const YmslString* str = stack.back();
+    stack.pop_back();
+    const char* src;
+    if ( str->is_rope() ) {
+      const YmslRope* node = static_cast<const YmslRope*>(str);
+      if ( node->mFlat == NULL ) {
+	// 前半を先に写すので後半から積む．
+	stack.push_back(static_cast<const YmslString*>(node->mRight));
+	stack.push_back(static_cast<const YmslString*>(node->mLeft));
+	continue;
+      }
+      src = node->mFlat;
+    }
+    else {
+      src = str->buf();
+    }
+    memcpy(flat + pos, src, str->size());
+    pos += str->size();
+  }
+  ASSERT_COND( pos == size() );
+  flat[pos] = '\0';
+
+  rope->mFlat = flat;
+  rope->mLeft = NULL;
+  rope->mRight = NULL;
+  rope->mHeap->add_flat_size(static_cast<ymuint64>(size()) + 1);
+  return flat;
+}
+
+// @brief 二つの文字列の中身が等しい時 true を返す．
+// @param[in] str1, str2 文字列
+//
+// 両方のハッシュ値が求めてあれば先にそれで比べる．
+bool
+YmslString::is_equal(const YmslString* str1,
+		     const YmslString* str2)
+{
+  if ( str1->size() != str2->size() ) {
+    return false;
+  }
+  if ( (str1->bits() & kHashBit) && (str2->bits() & kHashBit) &&
+       str1->mHash != str2->mHash ) {
+    return false;
+  }
+  return memcmp(str1->str(), str2->str(), str1->size()) == 0;
+}
+
+// @brief 辞書順で比較する．
+// @param[in] str1, str2 文字列
+// @return str1 < str2 なら負，str1 == str2 なら 0，str1 > str2 なら正の数を返す．
+int
+YmslString::compare(const YmslString* str1,
+		    const YmslString* str2)
+{
+  ymuint len1 = str1->size();
+  ymuint len2 = str2->size();
+  ymuint n = (len1 < len2) ? len1 : len2;
+  int c = memcmp(str1->str(), str2->str(), n);
+  if ( c != 0 ) {
+    return c;
+  }
+  if ( len1 < len2 ) {
+    return -1;
+  }
+  if ( len1 > len2 ) {
+    return 1;
+  }
+  return 0;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslRope
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] heap ノードを管理するオブジェクト
+// @param[in] str1, str2 文字列
+YmslRope::YmslRope(VsmHeap* heap,
+		   const YmslString* str1,
+		   const YmslString* str2) :
+  YmslString(str1->size() + str2->size()),
+  mLeft(const_cast<YmslString*>(str1)),
+  mRight(const_cast<YmslString*>(str2)),
+  mFlat(NULL),
+  mHeap(heap)
+{
+  set_bits(kRopeBit);
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslArray
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] kind 種類
+// @param[in] type 型
+// @param[in] size 要素数
+YmslArray::YmslArray(Kind kind,
+		     const Type* type,
+		     ymuint size) :
+  YmslObj(kind, type, size)
+{
+}
+
+// @brief 配列を作る．
+// @param[in] type 配列の型
+// @param[in] size 要素数
+YmslArray*
+YmslArray::new_obj(const Type* type,
+		   ymuint size)
+{
+  ymuint64 nbytes = static_cast<ymuint64>(size) * elem_size_of(kind_of(type));
+  void* p = alloc(sizeof(YmslArray), nbytes);
+  return new_obj(p, type, size);
+}
+
+// @brief 二つの配列をつないだ配列を作る．
+// @param[in] array1, array2 配列
+YmslArray*
+YmslArray::new_obj(const YmslArray* array1,
+		   const YmslArray* array2)
+{
+  ymuint64 nbytes = static_cast<ymuint64>(array1->size() + array2->size()) *
+    array1->elem_size();
+  void* p = alloc(sizeof(YmslArray), nbytes);
+  return new_obj(p, array1, array2);
+}
+
+// @brief 確保した領域の上に配列を作る．
+// @param[in] p 領域の先頭
+// @param[in] type 配列の型
+// @param[in] size 要素数
+YmslArray*
+YmslArray::new_obj(void* p,
+		   const Type* type,
+		   ymuint size)
+{
+  Kind kind = kind_of(type);
+
+  // 0, 0.0, NULL はいずれも全ビットが 0 になる．
+  ymuint64 nbytes = static_cast<ymuint64>(size) * elem_size_of(kind);
+  YmslArray* obj = new (p) YmslArray(kind, type, size);
+  memset(obj->body(), 0, nbytes);
+  return obj;
+}
+
+// @brief 確保した領域の上に二つの配列をつないだ配列を作る．
+// @param[in] p 領域の先頭
+// @param[in] array1, array2 配列
+YmslArray*
+YmslArray::new_obj(void* p,
+		   const YmslArray* array1,
+		   const YmslArray* array2)
+{
+  ASSERT_COND( array1->kind() == array2->kind() );
+
+  ymuint esize = array1->elem_size();
+  ymuint64 nbytes1 = static_cast<ymuint64>(array1->size()) * esize;
+  ymuint64 nbytes2 = static_cast<ymuint64>(array2->size()) * esize;
+  YmslArray* obj = new (p) YmslArray(array1->kind(), array1->type(),
+				     array1->size() + array2->size());
+  ymuint8* body = static_cast<ymuint8*>(obj->body());
+  memcpy(body, array1->body(), nbytes1);
+  memcpy(body + nbytes1, array2->body(), nbytes2);
+  return obj;
+}
+
+// @brief 配列に必要な領域の大きさ(バイト数)を返す．
+// @param[in] type 配列の型
+// @param[in] size 要素数
+ymuint64
+YmslArray::alloc_size(const Type* type,
+		      ymuint size)
+{
+  return sizeof(YmslArray) +
+    static_cast<ymuint64>(size) * elem_size_of(kind_of(type));
+}
+
+// @brief 要素一つのバイト数を返す．
+ymuint
+YmslArray::elem_size() const
+{
+  return elem_size_of(kind());
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// クラス YmslSet
+//////////////////////////////////////////////////////////////////////
+
+// @brief コンストラクタ
+// @param[in] kind 種類 ( kSet か kMap )
+// @param[in] type 型
+YmslSet::YmslSet(Kind kind,
+		 const Type* type) :
+  YmslObj(kind, type, 0),
+  mTableSize(0),
+  mUsedTable(NULL),
+  mKeyTable(NULL),
+  mValueTable(NULL)
+{
+}
+
+// @brief 空の集合か連想配列を作る．
+// @param[in] type 型
+YmslSet*
+YmslSet::new_obj(const Type* type)
+{
+  void* p = alloc(sizeof(YmslSet), 0);
+  YmslSet* obj;
+  if ( type->type_id() == kMapType ) {
+    obj = new (p) YmslSet(kMap, type);
+    obj->set_bits((val_class(type->key_type()) << kKeyClassShift) |
+		  (val_class(type->elem_type()) << kValueClassShift));
+  }
+  else {
+    obj = new (p) YmslSet(kSet, type);
+    obj->set_bits(val_class(type->elem_type()) << kKeyClassShift);
+  }
+  obj->alloc_table(kInitTableSize);
+  return obj;
+}
+
+// @brief 領域を解放する．
+void
+YmslSet::free_table()
+{
+  delete [] mUsedTable;
+  delete [] mKeyTable;
+  delete [] mValueTable;
+  mUsedTable = NULL;
+  mKeyTable = NULL;
+  mValueTable = NULL;
+  mTableSize = 0;
+}
+
+// @brief キーを探す．
+// @param[in] key キー
+// @return 見つかったら表の位置を，見つからなければ -1 を返す．
+int
+YmslSet::find(VsmValue key) const
+{
+  ValClass kc = key_class();
+  ymuint mask = mTableSize - 1;
+  for (ymuint pos = hash(kc, key) & mask; mUsedTable[pos]; pos = (pos + 1) & mask) {
+    if ( equal(kc, mKeyTable[pos], key) ) {
+      return pos;
+    }
+  }
+  return -1;
+}
+
+// @brief キーを加える．
+// @param[in] key キー
+// @return 表の位置を返す．
+ymuint
+YmslSet::insert(VsmValue key)
+{
+  int pos0 = find(key);
+  if ( pos0 >= 0 ) {
+    return pos0;
+  }
+
+  if ( (size() + 1) * 2 > mTableSize ) {
+    // 表を大きくして入れ直す．
+    resize_table(mTableSize * 2);
+  }
+
+  ymuint mask = mTableSize - 1;
+  ymuint pos = hash(key_class(), key) & mask;
+  while ( mUsedTable[pos] ) {
+    pos = (pos + 1) & mask;
+  }
+  mUsedTable[pos] = 1;
+  mKeyTable[pos] = key;
+  if ( mValueTable != NULL ) {
+    mValueTable[pos].obj_value = NULL;
+  }
+  set_size(size() + 1);
+  return pos;
+}
+
+// @brief キーと値を加える．
+// @param[in] key キー
+// @param[in] value 値
+void
+YmslSet::insert(VsmValue key,
+		VsmValue value)
+{
+  ASSERT_COND( mValueTable != NULL );
+
+  ymuint pos = insert(key);
+  mValueTable[pos] = value;
+}
+
+// @brief 表を確保する．
+// @param[in] size 表の大きさ
+void
+YmslSet::alloc_table(ymuint size)
+{
+  mTableSize = size;
+  mUsedTable = new ymuint8[size];
+  memset(mUsedTable, 0, size);
+  mKeyTable = new VsmValue[size];
+  mValueTable = (kind() == kMap) ? new VsmValue[size] : NULL;
+}
+
+// @brief 表を確保し直して要素を入れ直す．
+// @param[in] size 新しい表の大きさ
+void
+YmslSet::resize_table(ymuint size)
+{
+  ymuint old_size = mTableSize;
+  ymuint8* old_used = mUsedTable;
+  VsmValue* old_key = mKeyTable;
+  VsmValue* old_value = mValueTable;
+  alloc_table(size);
+  ValClass kc = key_class();
+  ymuint mask = mTableSize - 1;
+  for (ymuint i = 0; i < old_size; ++ i) {
+    if ( !old_used[i] ) {
+      continue;
+    }
+    ymuint pos = hash(kc, old_key[i]) & mask;
+    while ( mUsedTable[pos] ) {
+      pos = (pos + 1) & mask;
+    }
+    mUsedTable[pos] = 1;
+    mKeyTable[pos] = old_key[i];
+    if ( mValueTable != NULL ) {
+      mValueTable[pos] = old_value[i];
+    }
+  }
+  delete [] old_used;
+  delete [] old_key;
+  delete [] old_value;
+}
+
+END_NAMESPACE_YM_YMSL
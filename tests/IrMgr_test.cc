@@ -52,6 +52,12 @@ ir_test1(IDO& ido)
   IrPrinter ir_printer(cout);
   ir_printer.print_code(*ir_toplevel);
 
+  ir_mgr.optimize(ir_toplevel);
+
+  cout << endl
+       << "After optimization" << endl;
+  ir_printer.print_code(*ir_toplevel);
+
   return 0;
 }
 
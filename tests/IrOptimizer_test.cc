@@ -0,0 +1,1069 @@
+
+/// @file IrOptimizer_test.cc
+/// @brief IrOptimizer_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "AstMgr.h"
+#include "AstStatement.h"
+#include "IrMgr.h"
+#include "IrToplevel.h"
+#include "VsmGen.h"
+#include "VsmModule.h"
+#include "Vsm.h"
+#include "YmslCompiler.h"
+#include "YmslObj.h"
+
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/StreamIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// スクリプトを実行して先頭から n 個の大域変数の値を得る．
+// opt が true の時は中間表現の最適化を行う．
+// reg_mode が true の時はレジスタ型のコードを作る．
+// jit_threshold は Vsm::set_jit_threshold() に渡す．
+bool
+run_script(const char* str,
+	   bool opt,
+	   bool reg_mode,
+	   ymuint jit_threshold,
+	   ymuint n,
+	   vector<Ymsl_INT>& val_list)
+{
+  StringIDO ido(str);
+  AstMgr ast_mgr;
+  if ( !ast_mgr.read_source(ido) ) {
+    return false;
+  }
+
+  YmslCompiler compiler;
+  IrMgr ir_mgr;
+  IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					  ShString("__main__"), compiler);
+  if ( toplevel == NULL ) {
+    return false;
+  }
+  if ( opt ) {
+    ir_mgr.optimize(toplevel);
+  }
+
+  VsmGen gen(reg_mode);
+  VsmModule* module = gen.code_gen(toplevel, ShString("__main__"));
+  if ( module == NULL ) {
+    return false;
+  }
+
+  Vsm vsm;
+  vsm.set_jit_threshold(jit_threshold);
+  bool stat = vsm.execute_module(*module);
+  val_list.clear();
+  for (ymuint i = 0; i < n; ++ i) {
+    val_list.push_back(vsm.read_global(i).int_value);
+  }
+  delete module;
+
+  return stat;
+}
+
+// 最適化の有無，コードの形式，JIT の有無の全ての組み合わせで
+// 大域変数の値が expected と等しくなるか調べる．
+bool
+check_script(const char* name,
+	     const char* str,
+	     const vector<Ymsl_INT>& expected)
+{
+  static const struct {
+    bool mOpt;
+    bool mRegMode;
+    ymuint mJitThreshold;
+  } mode_list[] = {
+    { false, false, 0 },
+    { true,  false, 0 },
+    { true,  true,  0 },
+    { true,  false, 1 },
+  };
+
+  bool ok = true;
+  for (ymuint m = 0; m < sizeof(mode_list) / sizeof(mode_list[0]); ++ m) {
+    vector<Ymsl_INT> val_list;
+    if ( !run_script(str, mode_list[m].mOpt, mode_list[m].mRegMode,
+		     mode_list[m].mJitThreshold, expected.size(), val_list) ) {
+      cerr << " " << name << "[" << m << "]: failed to run" << endl;
+      ok = false;
+      continue;
+    }
+    for (ymuint i = 0; i < expected.size(); ++ i) {
+      if ( val_list[i] != expected[i] ) {
+	cerr << " " << name << "[" << m << "]: global #" << i
+	     << " = " << val_list[i]
+	     << ", expected " << expected[i] << endl;
+	ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+END_NONAMESPACE
+
+// 関数呼び出しをまたいだ大域変数の式をまとめないことを調べる．
+bool
+cse_call_test()
+{
+  const char* str =
+    "var g:int = 1;"
+    "var x:int = 0;"
+    "var t:int = 0;"
+    "var y:int = 0;"
+    "var r:int = 0;"
+    "function bump():int {"
+    "  g = g + 10;"
+    "  return 0;"
+    "}"
+    "function twice():int {"
+    "  var a:int = g * 3;"
+    "  var c:int = bump();"
+    "  var b:int = g * 3;"
+    "  return b - a;"
+    "}"
+    "x = g + 1;"
+    "t = bump();"
+    "y = g + 1;"
+    "r = twice();";
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(21);
+  expected.push_back(2);
+  expected.push_back(0);
+  expected.push_back(12);
+  expected.push_back(30);
+  return check_script("cse_call_test", str, expected);
+}
+
+// 分岐で書き換えられる局所変数のコピー伝搬を調べる．
+bool
+copy_prop_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "var r3:int = 0;"
+    "function cp(c:int):int {"
+    "  var a:int = 1;"
+    "  var b:int = a;"
+    "  if c > 0 {"
+    "    a = 7;"
+    "  }"
+    "  return a + b;"
+    "}"
+    "function loop(n:int):int {"
+    "  var s:int = 5;"
+    "  var t:int = s;"
+    "  var i:int;"
+    "  for (i = 0; i < n; i ++) {"
+    "    s = s + i;"
+    "    t = s;"
+    "  }"
+    "  return t;"
+    "}"
+    "r1 = cp(1);"
+    "r2 = cp(0);"
+    "r3 = loop(10);";
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(8);
+  expected.push_back(2);
+  expected.push_back(50);
+  return check_script("copy_prop_test", str, expected);
+}
+
+// 定数でない値での除算をループの外に出さないことを調べる．
+//
+// 0 や -1 で割る場合は条件を満たす時だけ割っているので，
+// ループの前で割ると例外が起きる．
+bool
+licm_div_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "var r3:int = 0;"
+    "var r4:int = 0;"
+    "function safe_div(a:int, d:int, n:int):int {"
+    "  var s:int = 0;"
+    "  var i:int;"
+    "  for (i = 0; i < n; i ++) {"
+    "    if d != 0 {"
+    "      s = s + a / d;"
+    "    }"
+    "    else {"
+    "      s = s + 1;"
+    "    }"
+    "  }"
+    "  return s;"
+    "}"
+    "function safe_mod(a:int, d:int, n:int):int {"
+    "  var s:int = 0;"
+    "  var i:int;"
+    "  for (i = 0; i < n; i ++) {"
+    "    s = s + a % d;"
+    "  }"
+    "  return s;"
+    "}"
+    "r1 = safe_div(10, 0, 5);"
+    "r2 = safe_div(10, 3, 5);"
+    "r3 = safe_div(-2147483647 - 1, -1, 0);"
+    "r4 = safe_mod(7, 0, 0);";
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(5);
+  expected.push_back(15);
+  expected.push_back(0);
+  expected.push_back(0);
+  return check_script("licm_div_test", str, expected);
+}
+
+// 強さの削減をした i * s が元の式と同じ値になることを調べる．
+//
+// 期待値は桁あふれも含めて C++ で同じ計算をして求める．
+bool
+strength_reduction_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "var r3:int = 0;"
+    "var r4:int = 0;"
+    "function sr_up(n:int, s:int):int {"
+    "  var sum:int = 0;"
+    "  var i:int;"
+    "  for (i = 0; i < n; i ++) {"
+    "    sum = sum + i * s;"
+    "  }"
+    "  return sum;"
+    "}"
+    "function sr_down(n:int, s:int):int {"
+    "  var sum:int = 0;"
+    "  var i:int;"
+    "  for (i = n; i > 0; i -= 3) {"
+    "    sum = sum ^ (i * s);"
+    "  }"
+    "  return sum;"
+    "}"
+    "function sr_step(n:int, step:int, s:int):int {"
+    "  var sum:int = 0;"
+    "  var i:int;"
+    "  for (i = -n; i < n; i = i + step) {"
+    "    sum = sum + s * i;"
+    "  }"
+    "  return sum;"
+    "}"
+    "r1 = sr_up(1000, 123456789);"
+    "r2 = sr_down(1000, -987654321);"
+    "r3 = sr_step(500, 7, 65537);"
+    "r4 = sr_up(0, 5);";
+
+  // 符号なし整数で計算して桁あふれを2の補数の折り返しにする．
+  ymuint32 sum1 = 0;
+  for (ymint32 i = 0; i < 1000; ++ i) {
+    sum1 += static_cast<ymuint32>(i) * 123456789U;
+  }
+  ymuint32 sum2 = 0;
+  for (ymint32 i = 1000; i > 0; i -= 3) {
+    sum2 ^= static_cast<ymuint32>(i) * static_cast<ymuint32>(-987654321);
+  }
+  ymuint32 sum3 = 0;
+  for (ymint32 i = -500; i < 500; i += 7) {
+    sum3 += 65537U * static_cast<ymuint32>(i);
+  }
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(static_cast<Ymsl_INT>(sum1));
+  expected.push_back(static_cast<Ymsl_INT>(sum2));
+  expected.push_back(static_cast<Ymsl_INT>(sum3));
+  expected.push_back(0);
+  return check_script("strength_reduction_test", str, expected);
+}
+
+// 引数を書き換える関数を展開しても呼び出し側の変数が
+// 変わらないことを調べる．
+//
+// 大域変数を引数に渡す呼び出しは展開されないので，
+// keep() と run() の中の呼び出しが展開の対象になる．
+bool
+inline_param_test()
+{
+  const char* str =
+    "var x:int = 5;"
+    "var y:int = 0;"
+    "var z:int = 0;"
+    "var w:int = 0;"
+    "var u:int = 0;"
+    "var k:int = 0;"
+    "function incr(a:int):int {"
+    "  a = a + 1;"
+    "  return a * 2;"
+    "}"
+    "function keep():int {"
+    "  var p:int = 5;"
+    "  var q:int = incr(p);"
+    "  return p * 100 + q;"
+    "}"
+    "function swap_sub(a:int, b:int):int {"
+    "  var t:int;"
+    "  t = a;"
+    "  a = b;"
+    "  b = t;"
+    "  return a - b;"
+    "}"
+    "function acc(n:int):int {"
+    "  var k:int;"
+    "  k = k + n;"
+    "  return k;"
+    "}"
+    "function sgn(a:int):int {"
+    "  if a < 0 {"
+    "    return -1;"
+    "  }"
+    "  if a == 0 {"
+    "    return 0;"
+    "  }"
+    "  return 1;"
+    "}"
+    "function run():int {"
+    "  var i:int;"
+    "  var v:int;"
+    "  var s:int = 0;"
+    "  for (i = 0; i < 4; i ++) {"
+    "    v = acc(i);"
+    "    s = s + v;"
+    "  }"
+    "  v = sgn(x - 9);"
+    "  s = s * 10 + v;"
+    "  return s;"
+    "}"
+    "y = incr(x);"
+    "z = swap_sub(x, y);"
+    "w = run();"
+    "u = incr(x);"
+    "k = keep();";
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(5);
+  expected.push_back(12);
+  expected.push_back(7);
+  expected.push_back(59);
+  expected.push_back(12);
+  expected.push_back(512);
+  return check_script("inline_param_test", str, expected);
+}
+
+// 相互再帰の末尾呼び出しがフレームを積まずに実行されることを調べる．
+//
+// ev() と od() はどちらも小さいので，最適化すると互いに展開の
+// 候補になる．return の位置の呼び出しを展開すると展開した本体の中の
+// 末尾呼び出しが普通の呼び出しになり，深さ 1000000 ではスタックが
+// あふれる．
+bool
+tail_call_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "function ev(n:int):int {"
+    "  if n == 0 {"
+    "    return 1;"
+    "  }"
+    "  return od(n - 1);"
+    "}"
+    "function od(n:int):int {"
+    "  if n == 0 {"
+    "    return 0;"
+    "  }"
+    "  return ev(n - 1);"
+    "}"
+    "r1 = ev(1000000);"
+    "r2 = od(1000001);";
+
+  static const struct {
+    bool mOpt;
+    bool mRegMode;
+  } mode_list[] = {
+    { false, false },
+    { true,  false },
+    { false, true  },
+    { true,  true  },
+  };
+
+  bool ok = true;
+  for (ymuint m = 0; m < sizeof(mode_list) / sizeof(mode_list[0]); ++ m) {
+    vector<Ymsl_INT> val_list;
+    if ( !run_script(str, mode_list[m].mOpt, mode_list[m].mRegMode, 0,
+		     2, val_list) ) {
+      cerr << " tail_call_test[" << m << "]: failed to run" << endl;
+      ok = false;
+      continue;
+    }
+    if ( val_list[0] != 1 || val_list[1] != 1 ) {
+      cerr << " tail_call_test[" << m << "]: r1 = " << val_list[0]
+	   << ", r2 = " << val_list[1] << ", expected 1, 1" << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// レジスタ型のコードの再帰呼び出しを調べる．
+//
+// 関数呼び出しは C++ の再帰にならないので，スタックに収まる深さなら
+// 最後まで実行でき，収まらない深さならスタックオーバーフローとして
+// execute_module() が false を返す．
+bool
+reg_recursion_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "function sum(n:int):int {"
+    "  if n == 0 {"
+    "    return 0;"
+    "  }"
+    "  var r:int = sum(n - 1);"
+    "  return n + r;"
+    "}"
+    "r1 = sum(%d);";
+
+  bool ok = true;
+  char buf[512];
+  vector<Ymsl_INT> val_list;
+  snprintf(buf, sizeof(buf), str, 10000);
+  if ( !run_script(buf, false, true, 0, 1, val_list) ) {
+    cerr << " reg_recursion_test: failed to run" << endl;
+    ok = false;
+  }
+  else if ( val_list[0] != 50005000 ) {
+    cerr << " reg_recursion_test: r1 = " << val_list[0]
+	 << ", expected 50005000" << endl;
+    ok = false;
+  }
+
+  snprintf(buf, sizeof(buf), str, 10000000);
+  if ( run_script(buf, false, true, 0, 1, val_list) ) {
+    cerr << " reg_recursion_test: no stack overflow" << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// switch 文の振り分けを調べる．
+//
+// 負の値の密な case (ジャンプテーブル)，INT_MIN から INT_MAX までに
+// 散らばった case，疎な case (二分探索) のそれぞれについて，
+// case の値とその前後の値，範囲の両端の値で振り分けを確かめる．
+bool
+switch_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "var r3:int = 0;"
+    "function dense(v:int):int {"
+    "  var r:int = 0;"
+    "  switch v {"
+    "  case -3: { r = 1; }"
+    "  case -2: { r = 2; }"
+    "  case -1: { r = 3; }"
+    "  case 0: { r = 4; }"
+    "  case 1: { r = 5; }"
+    "  default: { r = 9; }"
+    "  }"
+    "  return r;"
+    "}"
+    "function wide(v:int):int {"
+    "  var r:int = 0;"
+    "  switch v {"
+    "  case -2147483647 - 1: { r = 1; }"
+    "  case -2147483647: { r = 2; }"
+    "  case -1: { r = 3; }"
+    "  case 0: { r = 4; }"
+    "  case 2147483646: { r = 5; }"
+    "  case 2147483647: { r = 6; }"
+    "  default: { r = 9; }"
+    "  }"
+    "  return r;"
+    "}"
+    "function sparse(v:int):int {"
+    "  var r:int = 0;"
+    "  switch v {"
+    "  case -1000000: { r = 1; }"
+    "  case -7: { r = 2; }"
+    "  case 3: { r = 3; }"
+    "  case 4: { r = 4; }"
+    "  case 5: { r = 5; }"
+    "  case 6: { r = 6; }"
+    "  case 100: { r = 7; }"
+    "  case 65536: { r = 8; }"
+    "  }"
+    "  return r;"
+    "}"
+    "function all(n:int):int {"
+    "  var h:int = 0;"
+    "  var i:int;"
+    "  var v:int;"
+    "  var r:int;"
+    "  for (i = 0; i < n; i ++) {"
+    "    v = sel(i);"
+    "    r = dense(v);"
+    "    h = h * 11 + r;"
+    "    r = wide(v);"
+    "    h = h * 11 + r;"
+    "    r = sparse(v);"
+    "    h = h * 11 + r;"
+    "  }"
+    "  return h;"
+    "}"
+    "function sel(i:int):int {"
+    "  var v:int = 0;"
+    "  switch i {"
+    "  case 0: { v = -2147483647 - 1; }"
+    "  case 1: { v = -2147483647; }"
+    "  case 2: { v = -2147483646; }"
+    "  case 3: { v = -1000001; }"
+    "  case 4: { v = -1000000; }"
+    "  case 5: { v = -999999; }"
+    "  case 6: { v = -8; }"
+    "  case 7: { v = -7; }"
+    "  case 8: { v = -4; }"
+    "  case 9: { v = -3; }"
+    "  case 10: { v = -2; }"
+    "  case 11: { v = -1; }"
+    "  case 12: { v = 0; }"
+    "  case 13: { v = 1; }"
+    "  case 14: { v = 2; }"
+    "  case 15: { v = 3; }"
+    "  case 16: { v = 6; }"
+    "  case 17: { v = 7; }"
+    "  case 18: { v = 100; }"
+    "  case 19: { v = 65536; }"
+    "  case 20: { v = 2147483645; }"
+    "  case 21: { v = 2147483646; }"
+    "  case 22: { v = 2147483647; }"
+    "  }"
+    "  return v;"
+    "}"
+    "r1 = all(23);"
+    "r2 = wide(-2147483647 - 1);"
+    "r3 = dense(-2147483647 - 1);";
+
+  // sel() の値ごとの期待値を C++ で計算する．
+  static const Ymsl_INT sel_list[] = {
+    -2147483647 - 1, -2147483647, -2147483646, -1000001, -1000000,
+    -999999, -8, -7, -4, -3, -2, -1, 0, 1, 2, 3, 6, 7, 100, 65536,
+    2147483645, 2147483646, 2147483647
+  };
+  ymuint32 h = 0;
+  for (ymuint i = 0; i < sizeof(sel_list) / sizeof(sel_list[0]); ++ i) {
+    Ymsl_INT v = sel_list[i];
+    Ymsl_INT r_dense = 9;
+    if ( -3 <= v && v <= 1 ) {
+      r_dense = v + 4;
+    }
+    Ymsl_INT r_wide = 9;
+    switch ( v ) {
+    case -2147483647 - 1: r_wide = 1; break;
+    case -2147483647:     r_wide = 2; break;
+    case -1:              r_wide = 3; break;
+    case 0:               r_wide = 4; break;
+    case 2147483646:      r_wide = 5; break;
+    case 2147483647:      r_wide = 6; break;
+    }
+    Ymsl_INT r_sparse = 0;
+    switch ( v ) {
+    case -1000000: r_sparse = 1; break;
+    case -7:       r_sparse = 2; break;
+    case 3:        r_sparse = 3; break;
+    case 4:        r_sparse = 4; break;
+    case 5:        r_sparse = 5; break;
+    case 6:        r_sparse = 6; break;
+    case 100:      r_sparse = 7; break;
+    case 65536:    r_sparse = 8; break;
+    }
+    h = h * 11 + r_dense;
+    h = h * 11 + r_wide;
+    h = h * 11 + r_sparse;
+  }
+
+  vector<Ymsl_INT> expected;
+  expected.push_back(static_cast<Ymsl_INT>(h));
+  expected.push_back(1);
+  expected.push_back(9);
+  return check_script("switch_test", str, expected);
+}
+
+// 同じ値の定数が定数表で一つにまとめられ，それを参照するコードが
+// 正しい値を得ることを調べる．
+//
+// 定数は複数の関数とトップレベルから参照する．0.0 と -0.0 は
+// 別の定数として扱う．関数呼び出しの結果の型は elaborate の最後に
+// 決まるので，二項演算の前に変数に代入する．
+bool
+const_pool_test()
+{
+  const char* str =
+    "var i1:int = 0;"
+    "var i2:int = 0;"
+    "var f1:float = 0.0;"
+    "var f2:float = 0.0;"
+    "var f3:float = 0.0;"
+    "var s1:string = \"\";"
+    "var s2:string = \"\";"
+    "function ia():int {"
+    "  return 1234567;"
+    "}"
+    "function ib():int {"
+    "  var x:int = 1234567;"
+    "  return x;"
+    "}"
+    "function fa():float {"
+    "  return 3.25;"
+    "}"
+    "function fb():float {"
+    "  var x:float = 3.25;"
+    "  return x;"
+    "}"
+    "function nz():float {"
+    "  return -0.0;"
+    "}"
+    "function sa():string {"
+    "  return \"hello\";"
+    "}"
+    "function sb():string {"
+    "  var x:string = \"hello\";"
+    "  return x;"
+    "}"
+    "i1 = ia();"
+    "i2 = ib();"
+    "i2 = i2 + 1234567;"
+    "f1 = fa();"
+    "f2 = fb();"
+    "f2 = f2 + 3.25;"
+    "f3 = nz();"
+    "s1 = sa();"
+    "s2 = sb();"
+    "s2 = s2 + \"hello\";";
+
+  static const struct {
+    bool mOpt;
+    bool mRegMode;
+  } mode_list[] = {
+    { false, false },
+    { true,  false },
+    { true,  true  },
+  };
+
+  bool ok = true;
+  for (ymuint m = 0; m < sizeof(mode_list) / sizeof(mode_list[0]); ++ m) {
+    StringIDO ido(str);
+    AstMgr ast_mgr;
+    if ( !ast_mgr.read_source(ido) ) {
+      cerr << " const_pool_test[" << m << "]: failed to parse" << endl;
+      return false;
+    }
+    YmslCompiler compiler;
+    IrMgr ir_mgr;
+    IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					    ShString("__main__"), compiler);
+    if ( toplevel == NULL ) {
+      cerr << " const_pool_test[" << m << "]: failed to elaborate" << endl;
+      return false;
+    }
+    if ( mode_list[m].mOpt ) {
+      ir_mgr.optimize(toplevel);
+    }
+    VsmGen gen(mode_list[m].mRegMode);
+    VsmModule* module = gen.code_gen(toplevel, ShString("__main__"));
+    if ( module == NULL ) {
+      cerr << " const_pool_test[" << m << "]: failed to compile" << endl;
+      return false;
+    }
+
+    // 定数表の中の同じ値の数を数える．
+    const VsmConstPool& pool = module->const_pool();
+    ymuint int_num = 0;
+    ymuint float_num = 0;
+    ymuint neg_zero_num = 0;
+    ymuint string_num = 0;
+    for (Ymsl_INT i = 0; i < pool.size(); ++ i) {
+      VsmValue val = pool.value(i);
+      switch ( pool.type(i) ) {
+      case kIntType:
+	if ( val.int_value == 1234567 ) {
+	  ++ int_num;
+	}
+	break;
+
+      case kFloatType:
+	if ( val.float_value == 3.25 ) {
+	  ++ float_num;
+	}
+	else if ( val.float_value == 0.0 && std::signbit(val.float_value) ) {
+	  ++ neg_zero_num;
+	}
+	break;
+
+      case kStringType:
+	{
+	  const YmslString* s = static_cast<const YmslString*>(val.obj_value);
+	  if ( strcmp(s->str(), "hello") == 0 ) {
+	    ++ string_num;
+	  }
+	}
+	break;
+
+      default:
+	cerr << " const_pool_test[" << m << "]: unexpected constant type" << endl;
+	ok = false;
+	break;
+      }
+    }
+    if ( int_num != 1 || float_num != 1 || neg_zero_num != 1 || string_num != 1 ) {
+      cerr << " const_pool_test[" << m << "]: 1234567 x " << int_num
+	   << ", 3.25 x " << float_num
+	   << ", -0.0 x " << neg_zero_num
+	   << ", \"hello\" x " << string_num << ", expected 1 each" << endl;
+      ok = false;
+    }
+
+    Vsm vsm;
+    if ( !vsm.execute_module(*module) ) {
+      cerr << " const_pool_test[" << m << "]: failed to run" << endl;
+      delete module;
+      ok = false;
+      continue;
+    }
+    if ( vsm.read_global(0).int_value != 1234567 ||
+	 vsm.read_global(1).int_value != 2469134 ) {
+      cerr << " const_pool_test[" << m << "]: i1 = " << vsm.read_global(0).int_value
+	   << ", i2 = " << vsm.read_global(1).int_value
+	   << ", expected 1234567, 2469134" << endl;
+      ok = false;
+    }
+    Ymsl_FLOAT f3 = vsm.read_global(4).float_value;
+    if ( vsm.read_global(2).float_value != 3.25 ||
+	 vsm.read_global(3).float_value != 6.5 ||
+	 f3 != 0.0 || !std::signbit(f3) ) {
+      cerr << " const_pool_test[" << m << "]: f1 = " << vsm.read_global(2).float_value
+	   << ", f2 = " << vsm.read_global(3).float_value
+	   << ", f3 = " << f3 << ", expected 3.25, 6.5, -0" << endl;
+      ok = false;
+    }
+    const YmslString* s1 = static_cast<const YmslString*>(vsm.read_global(5).obj_value);
+    const YmslString* s2 = static_cast<const YmslString*>(vsm.read_global(6).obj_value);
+    if ( s1 == NULL || strcmp(s1->str(), "hello") != 0 ||
+	 s2 == NULL || strcmp(s2->str(), "hellohello") != 0 ) {
+      cerr << " const_pool_test[" << m << "]: s1 and s2 are not "
+	   << "\"hello\" and \"hellohello\"" << endl;
+      ok = false;
+    }
+    delete module;
+  }
+  return ok;
+}
+
+// 畳み込んだ定数式の値が，同じ計算を実行時に行った値と等しいことを
+// 調べる．
+//
+// r? と f? は elaborate で畳み込まれ，q? と g? は関数の中で計算される．
+// INT の桁あふれは 2 の補数で折り返し，FLOAT は -0.0 の符号を保つ．
+// 0 による除算などの畳み込まない式は実行されない分岐に置き，
+// コンパイルが止まらないことだけを調べる．
+bool
+const_fold_test()
+{
+  const char* str =
+    "var r1:int = 0;"
+    "var r2:int = 0;"
+    "var r3:int = 0;"
+    "var r4:int = 0;"
+    "var r5:int = 0;"
+    "var b1:int = 0;"
+    "var q1:int = 0;"
+    "var q2:int = 0;"
+    "var q3:int = 0;"
+    "var q4:int = 0;"
+    "var q5:int = 0;"
+    "var c1:int = 0;"
+    "var f1:float = 1.0;"
+    "var f2:float = 1.0;"
+    "var f3:float = 1.0;"
+    "var f4:float = 1.0;"
+    "var g1:float = 1.0;"
+    "var g2:float = 1.0;"
+    "var g3:float = 1.0;"
+    "var g4:float = 1.0;"
+    "var z:int = 0;"
+    "var u:int = 0;"
+    "function iadd(a:int, b:int):int {"
+    "  return a + b;"
+    "}"
+    "function isub(a:int, b:int):int {"
+    "  return a - b;"
+    "}"
+    "function imul(a:int, b:int):int {"
+    "  return a * b;"
+    "}"
+    "function ineg(a:int):int {"
+    "  return -a;"
+    "}"
+    "function ishl(a:int, b:int):int {"
+    "  return a << b;"
+    "}"
+    "function feq(a:float, b:float):int {"
+    "  var r:int = 0;"
+    "  if a == b {"
+    "    r = 1;"
+    "  }"
+    "  return r;"
+    "}"
+    "function fmul(a:float, b:float):float {"
+    "  return a * b;"
+    "}"
+    "function fadd(a:float, b:float):float {"
+    "  return a + b;"
+    "}"
+    "function fneg(a:float):float {"
+    "  return -a;"
+    "}"
+    "function fdiv(a:float, b:float):float {"
+    "  return a / b;"
+    "}"
+    "r1 = 2147483647 + 1;"
+    "r2 = -2147483647 - 2;"
+    "r3 = 65537 * 65537;"
+    "r4 = -(-2147483647 - 1);"
+    "r5 = 3 << 31;"
+    "if 0.0 == -0.0 {"
+    "  b1 = 1;"
+    "}"
+    "q1 = iadd(2147483647, 1);"
+    "q2 = isub(-2147483647, 2);"
+    "q3 = imul(65537, 65537);"
+    "q4 = ineg(-2147483647 - 1);"
+    "q5 = ishl(3, 31);"
+    "c1 = feq(0.0, -0.0);"
+    "f1 = 0.0 * -1.0;"
+    "f2 = -0.0 + 0.0;"
+    "f3 = -(0.0);"
+    "f4 = 1.0 / (0.0 * -1.0);"
+    "g1 = fmul(0.0, -1.0);"
+    "g2 = fadd(-0.0, 0.0);"
+    "g3 = fneg(0.0);"
+    "g4 = fdiv(1.0, g1);"
+    "if z != 0 {"
+    "  u = 7 / 0;"
+    "  u = 7 % 0;"
+    "  u = (-2147483647 - 1) / -1;"
+    "  u = 1 << 40;"
+    "  u = 1 >> -1;"
+    "}";
+
+  // 符号なし整数で計算して桁あふれを2の補数の折り返しにする．
+  static const Ymsl_INT int_expected[] = {
+    static_cast<Ymsl_INT>(2147483647U + 1U),
+    static_cast<Ymsl_INT>(0U - 2147483647U - 2U),
+    static_cast<Ymsl_INT>(65537U * 65537U),
+    static_cast<Ymsl_INT>(0U - 2147483648U),
+    static_cast<Ymsl_INT>(3U << 31),
+    1,
+  };
+  const ymuint int_num = sizeof(int_expected) / sizeof(int_expected[0]);
+  const ymuint float_base = int_num * 2;
+  const ymuint float_num = 4;
+
+  static const struct {
+    bool mOpt;
+    bool mRegMode;
+    ymuint mJitThreshold;
+  } mode_list[] = {
+    { false, false, 0 },
+    { true,  false, 0 },
+    { true,  true,  0 },
+    { true,  false, 1 },
+  };
+
+  bool ok = true;
+  for (ymuint m = 0; m < sizeof(mode_list) / sizeof(mode_list[0]); ++ m) {
+    StringIDO ido(str);
+    AstMgr ast_mgr;
+    if ( !ast_mgr.read_source(ido) ) {
+      cerr << " const_fold_test[" << m << "]: failed to parse" << endl;
+      return false;
+    }
+    YmslCompiler compiler;
+    IrMgr ir_mgr;
+    IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					    ShString("__main__"), compiler);
+    if ( toplevel == NULL ) {
+      cerr << " const_fold_test[" << m << "]: failed to elaborate" << endl;
+      return false;
+    }
+    if ( mode_list[m].mOpt ) {
+      ir_mgr.optimize(toplevel);
+    }
+    VsmGen gen(mode_list[m].mRegMode);
+    VsmModule* module = gen.code_gen(toplevel, ShString("__main__"));
+    if ( module == NULL ) {
+      cerr << " const_fold_test[" << m << "]: failed to compile" << endl;
+      return false;
+    }
+
+    // INT_MIN と -inf はどの定数からも直接は書けないので，
+    // 定数表にあれば畳み込まれている．
+    const VsmConstPool& pool = module->const_pool();
+    bool has_int_min = false;
+    bool has_neg_inf = false;
+    for (Ymsl_INT i = 0; i < pool.size(); ++ i) {
+      VsmValue val = pool.value(i);
+      if ( pool.type(i) == kIntType && val.int_value == -2147483647 - 1 ) {
+	has_int_min = true;
+      }
+      if ( pool.type(i) == kFloatType &&
+	   std::isinf(val.float_value) && val.float_value < 0.0 ) {
+	has_neg_inf = true;
+      }
+    }
+    if ( !has_int_min || !has_neg_inf ) {
+      cerr << " const_fold_test[" << m << "]: constants are not folded" << endl;
+      ok = false;
+    }
+
+    Vsm vsm;
+    vsm.set_jit_threshold(mode_list[m].mJitThreshold);
+    if ( !vsm.execute_module(*module) ) {
+      cerr << " const_fold_test[" << m << "]: failed to run" << endl;
+      delete module;
+      ok = false;
+      continue;
+    }
+    for (ymuint i = 0; i < int_num; ++ i) {
+      Ymsl_INT folded = vsm.read_global(i).int_value;
+      Ymsl_INT computed = vsm.read_global(i + int_num).int_value;
+      if ( folded != int_expected[i] || computed != int_expected[i] ) {
+	cerr << " const_fold_test[" << m << "]: INT #" << i
+	     << " folded = " << folded << ", computed = " << computed
+	     << ", expected " << int_expected[i] << endl;
+	ok = false;
+      }
+    }
+    for (ymuint i = 0; i < float_num; ++ i) {
+      Ymsl_FLOAT folded = vsm.read_global(float_base + i).float_value;
+      Ymsl_FLOAT computed = vsm.read_global(float_base + float_num + i).float_value;
+      // 0.0 と -0.0 を区別するためにビット列で比べる．
+      if ( memcmp(&folded, &computed, sizeof(Ymsl_FLOAT)) != 0 ) {
+	cerr << " const_fold_test[" << m << "]: FLOAT #" << i
+	     << " folded = " << folded << ", computed = " << computed << endl;
+	ok = false;
+      }
+    }
+    // -0.0, +0.0, -0.0, -inf
+    Ymsl_FLOAT f1 = vsm.read_global(float_base + 0).float_value;
+    Ymsl_FLOAT f2 = vsm.read_global(float_base + 1).float_value;
+    Ymsl_FLOAT f3 = vsm.read_global(float_base + 2).float_value;
+    Ymsl_FLOAT f4 = vsm.read_global(float_base + 3).float_value;
+    if ( f1 != 0.0 || !std::signbit(f1) ||
+	 f2 != 0.0 || std::signbit(f2) ||
+	 f3 != 0.0 || !std::signbit(f3) ||
+	 !std::isinf(f4) || f4 > 0.0 ) {
+      cerr << " const_fold_test[" << m << "]: f1 .. f4 = " << f1 << ", "
+	   << f2 << ", " << f3 << ", " << f4
+	   << ", expected -0, 0, -0, -inf" << endl;
+      ok = false;
+    }
+    delete module;
+  }
+  return ok;
+}
+
+int
+IrOptimizer_test(int argc,
+		 char** argv)
+{
+  StreamMsgHandler handler(&cerr);
+  MsgMgr::reg_handler(&handler);
+
+  int nerr = 0;
+
+  if ( !cse_call_test() ) {
+    cerr << "cse_call_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !copy_prop_test() ) {
+    cerr << "copy_prop_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !licm_div_test() ) {
+    cerr << "licm_div_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !strength_reduction_test() ) {
+    cerr << "strength_reduction_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !inline_param_test() ) {
+    cerr << "inline_param_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !switch_test() ) {
+    cerr << "switch_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !tail_call_test() ) {
+    cerr << "tail_call_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !reg_recursion_test() ) {
+    cerr << "reg_recursion_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !const_pool_test() ) {
+    cerr << "const_pool_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !const_fold_test() ) {
+    cerr << "const_fold_test failed" << endl;
+    ++ nerr;
+  }
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::IrOptimizer_test(argc, argv);
+}
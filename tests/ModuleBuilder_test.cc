@@ -0,0 +1,454 @@
+
+/// @file ModuleBuilder_test.cc
+/// @brief ModuleBuilder_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+///
+/// YMSL_USE_THREADS を定義した場合と定義しない場合の両方で
+/// コンパイルされ，同じ結果になることを調べる．
+
+
+#include "YmslCompiler.h"
+#include "ModuleRegistry.h"
+#include "VsmModule.h"
+#include "Vsm.h"
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// ソースファイル
+struct SrcFile
+{
+  // モジュール名
+  const char* mName;
+
+  // 内容
+  const char* mSrc;
+};
+
+// import の関係が DAG になるモジュール
+//
+// A を B と C が import し，B と C を D が import する．
+// F は D と E を import する．
+const SrcFile kDagSrc[] = {
+  { "A",
+    "var a:int = 1;"
+    "function get():int {"
+    "  return a;"
+    "}" },
+  { "B",
+    "import A;"
+    "function get():int {"
+    "  var x:int = A.get();"
+    "  return x * 2;"
+    "}" },
+  { "C",
+    "import A;"
+    "function get():int {"
+    "  var x:int = A.get();"
+    "  return x + 10;"
+    "}" },
+  { "D",
+    "import B;"
+    "import C;"
+    "function get():int {"
+    "  var x:int = B.get();"
+    "  var y:int = C.get();"
+    "  return x + y;"
+    "}" },
+  { "E",
+    "function get():int {"
+    "  return 100;"
+    "}" },
+  { "F",
+    "import D;"
+    "import E;"
+    "function get():int {"
+    "  var x:int = D.get();"
+    "  var y:int = E.get();"
+    "  return x * y;"
+    "}" },
+};
+
+// kDagSrc を import するモジュール
+const char* kDagMain =
+  "import F;"
+  "import D;"
+  "var r1:int = 0;"
+  "var r2:int = 0;"
+  "r1 = F.get();"
+  "r2 = D.get();";
+
+// import が循環しているモジュール
+//
+// S は循環に関係しない．
+const SrcFile kCycleSrc[] = {
+  { "P",
+    "import Q;"
+    "var p:int = 0;" },
+  { "Q",
+    "import P;"
+    "var q:int = 0;" },
+  { "R",
+    "import R;"
+    "var r:int = 0;" },
+  { "S",
+    "var s:int = 0;" },
+};
+
+// コンパイルに失敗するモジュール
+//
+// Bad はワーカーでの elaborate (ラベルの解決) に失敗し，
+// Syn は構文解析に失敗する．G と K はそれぞれを import する．
+// Ok は失敗しない．
+const SrcFile kErrorSrc[] = {
+  { "Bad",
+    "var x:int = 0;"
+    "goto undefined_label;" },
+  { "Syn",
+    "var x:int = ;" },
+  { "G",
+    "import Bad;"
+    "var g:int = 0;" },
+  { "K",
+    "import Syn;"
+    "var k:int = 0;" },
+  { "Ok",
+    "function get():int {"
+    "  return 5;"
+    "}" },
+};
+
+// 試すスレッド数
+// YMSL_USE_THREADS が定義されていない場合はどれも逐次的になる．
+const ymuint kThreadNum[] = { 1, 4 };
+
+// パスを作る．
+string
+make_path(const string& dir,
+	  const char* name,
+	  const char* suffix)
+{
+  return dir + "/" + name + suffix;
+}
+
+// ソースファイルを一時ディレクトリに書き出す．
+// 書き出したディレクトリを dir に入れる．
+bool
+write_sources(const char* test_name,
+	      const SrcFile* src_list,
+	      ymuint src_num,
+	      string& dir)
+{
+  char dir_buf[] = "/tmp/ModuleBuilder_testXXXXXX";
+  if ( mkdtemp(dir_buf) == NULL ) {
+    cerr << " " << test_name << ": mkdtemp failed" << endl;
+    return false;
+  }
+  dir = dir_buf;
+  for (ymuint i = 0; i < src_num; ++ i) {
+    string path = make_path(dir, src_list[i].mName, ".ym");
+    FILE* fp = fopen(path.c_str(), "wb");
+    if ( fp == NULL ) {
+      cerr << " " << test_name << ": failed to write " << path << endl;
+      return false;
+    }
+    ymuint size = strlen(src_list[i].mSrc);
+    bool stat = fwrite(src_list[i].mSrc, 1, size, fp) == size;
+    if ( fclose(fp) != 0 || !stat ) {
+      cerr << " " << test_name << ": failed to write " << path << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// 書き出したソースファイルと .ymc を消す．
+void
+remove_sources(const SrcFile* src_list,
+	       ymuint src_num,
+	       const string& dir)
+{
+  for (ymuint i = 0; i < src_num; ++ i) {
+    unlink(make_path(dir, src_list[i].mName, ".ym").c_str());
+    unlink(make_path(dir, src_list[i].mName, ".ymc").c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+// kDagMain をコンパイルして実行し，r1, r2 の値を得る．
+//
+// 毎回別のディレクトリに書き出すので，ModuleRegistry や .ymc の
+// モジュールは使われずに全てコンパイルされる．
+bool
+run_dag(ymuint thread_num,
+	vector<Ymsl_INT>& val_list)
+{
+  const char* name = "dag_test";
+  const ymuint src_num = sizeof(kDagSrc) / sizeof(kDagSrc[0]);
+
+  string dir;
+  if ( !write_sources(name, kDagSrc, src_num, dir) ) {
+    return false;
+  }
+
+  ModuleRegistry& registry = ModuleRegistry::the_registry();
+  ymuint base_num = registry.module_num();
+
+  bool ok = true;
+  {
+    YmslCompiler compiler;
+    compiler.set_thread_num(thread_num);
+    compiler.add_searchpath_top(dir);
+
+    StringIDO ido(kDagMain);
+    VsmModule* module = compiler.compile(ido, ShString("__main__"));
+    if ( module == NULL ) {
+      cerr << " " << name << ": failed to compile with "
+	   << thread_num << " threads" << endl;
+      ok = false;
+    }
+    else {
+      Vsm vsm;
+      if ( vsm.execute_module(*module) ) {
+	val_list.clear();
+	val_list.push_back(vsm.read_global(0).int_value);
+	val_list.push_back(vsm.read_global(1).int_value);
+      }
+      else {
+	cerr << " " << name << ": failed to run with "
+	     << thread_num << " threads" << endl;
+	ok = false;
+      }
+      delete module;
+    }
+
+    // 各モジュールは import しているモジュールが出来上がってから
+    // 作られるので，同じモジュールが二度作られることはなく，
+    // import しているモジュールはコンパイラに登録されたものと一致する．
+    for (ymuint i = 0; i < src_num && ok; ++ i) {
+      VsmModule* module1 = compiler.import(ShString(kDagSrc[i].mName));
+      if ( module1 == NULL ) {
+	cerr << " " << name << ": " << kDagSrc[i].mName
+	     << " is not registered" << endl;
+	ok = false;
+	break;
+      }
+      for (ymuint j = 0; j < module1->imported_module_num(); ++ j) {
+	VsmModule* sub_module = module1->imported_module(j);
+	if ( compiler.import(sub_module->name()) != sub_module ) {
+	  cerr << " " << name << ": " << kDagSrc[i].mName << " imports another "
+	       << sub_module->name() << endl;
+	  ok = false;
+	}
+      }
+    }
+    if ( registry.module_num() != base_num + src_num ) {
+      cerr << " " << name << ": " << registry.module_num() - base_num
+	   << " modules are registered, expected " << src_num << endl;
+      ok = false;
+    }
+  }
+
+  for (ymuint i = 0; i < src_num; ++ i) {
+    registry.invalidate(make_path(dir, kDagSrc[i].mName, ".ym"));
+  }
+  remove_sources(kDagSrc, src_num, dir);
+
+  return ok;
+}
+
+// DAG になっているモジュールをスレッド数を変えてコンパイルし，
+// 結果が同じになることを調べる．
+bool
+dag_test()
+{
+  // D = 1 * 2 + (1 + 10), F = D * 100
+  static const Ymsl_INT expected[] = { 1300, 13 };
+
+  bool ok = true;
+  const ymuint n = sizeof(kThreadNum) / sizeof(kThreadNum[0]);
+  vector<Ymsl_INT> val_list0;
+  for (ymuint i = 0; i < n; ++ i) {
+    vector<Ymsl_INT> val_list;
+    if ( !run_dag(kThreadNum[i], val_list) ) {
+      ok = false;
+      continue;
+    }
+    for (ymuint j = 0; j < 2; ++ j) {
+      if ( val_list[j] != expected[j] ) {
+	cerr << " dag_test: r" << (j + 1) << " = " << val_list[j]
+	     << " with " << kThreadNum[i] << " threads, expected "
+	     << expected[j] << endl;
+	ok = false;
+      }
+    }
+    if ( i == 0 ) {
+      val_list0 = val_list;
+    }
+    else if ( val_list != val_list0 ) {
+      cerr << " dag_test: results differ between " << kThreadNum[0]
+	   << " and " << kThreadNum[i] << " threads" << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// 循環した import がエラーになり，他のモジュールは用意できることを調べる．
+bool
+cycle_test()
+{
+  const char* name = "cycle_test";
+  const ymuint src_num = sizeof(kCycleSrc) / sizeof(kCycleSrc[0]);
+
+  bool ok = true;
+  const ymuint n = sizeof(kThreadNum) / sizeof(kThreadNum[0]);
+  for (ymuint i = 0; i < n; ++ i) {
+    string dir;
+    if ( !write_sources(name, kCycleSrc, src_num, dir) ) {
+      ok = false;
+      continue;
+    }
+
+    {
+      YmslCompiler compiler;
+      compiler.set_thread_num(kThreadNum[i]);
+      compiler.add_searchpath_top(dir);
+
+      if ( compiler.import(ShString("P")) != NULL ||
+	   compiler.import(ShString("Q")) != NULL ) {
+	cerr << " " << name << ": mutual import was accepted with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+      if ( compiler.import(ShString("R")) != NULL ) {
+	cerr << " " << name << ": self import was accepted with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+
+      StringIDO ido("import S; import P;");
+      VsmModule* module = compiler.compile(ido, ShString("__main__"));
+      if ( module != NULL ) {
+	cerr << " " << name << ": compiled a module importing a cycle with "
+	     << kThreadNum[i] << " threads" << endl;
+	delete module;
+	ok = false;
+      }
+      if ( compiler.import(ShString("S")) == NULL ) {
+	cerr << " " << name << ": failed to import S with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+    }
+
+    ModuleRegistry::the_registry().invalidate(make_path(dir, "S", ".ym"));
+    remove_sources(kCycleSrc, src_num, dir);
+  }
+  return ok;
+}
+
+// 失敗したモジュールを import しているモジュールが失敗し，
+// 関係のないモジュールは用意できることを調べる．
+bool
+error_test()
+{
+  const char* name = "error_test";
+  const ymuint src_num = sizeof(kErrorSrc) / sizeof(kErrorSrc[0]);
+
+  bool ok = true;
+  const ymuint n = sizeof(kThreadNum) / sizeof(kThreadNum[0]);
+  for (ymuint i = 0; i < n; ++ i) {
+    string dir;
+    if ( !write_sources(name, kErrorSrc, src_num, dir) ) {
+      ok = false;
+      continue;
+    }
+
+    {
+      YmslCompiler compiler;
+      compiler.set_thread_num(kThreadNum[i]);
+      compiler.add_searchpath_top(dir);
+
+      StringIDO ido("import Ok; import G;");
+      VsmModule* module = compiler.compile(ido, ShString("__main__"));
+      if ( module != NULL ) {
+	cerr << " " << name << ": compiled a module importing Bad with "
+	     << kThreadNum[i] << " threads" << endl;
+	delete module;
+	ok = false;
+      }
+      if ( compiler.import(ShString("Ok")) == NULL ) {
+	cerr << " " << name << ": failed to import Ok with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+      if ( compiler.import(ShString("G")) != NULL ) {
+	cerr << " " << name << ": G was built with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+      if ( compiler.import(ShString("K")) != NULL ) {
+	cerr << " " << name << ": K was built with "
+	     << kThreadNum[i] << " threads" << endl;
+	ok = false;
+      }
+    }
+
+    ModuleRegistry::the_registry().invalidate(make_path(dir, "Ok", ".ym"));
+    remove_sources(kErrorSrc, src_num, dir);
+  }
+  return ok;
+}
+
+END_NONAMESPACE
+
+int
+ModuleBuilder_test(int argc,
+		   char** argv)
+{
+  StreamMsgHandler handler(&cerr);
+  MsgMgr::reg_handler(&handler);
+
+  int nerr = 0;
+
+  if ( !dag_test() ) {
+    cerr << "dag_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !cycle_test() ) {
+    cerr << "cycle_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !error_test() ) {
+    cerr << "error_test failed" << endl;
+    ++ nerr;
+  }
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::ModuleBuilder_test(argc, argv);
+}
@@ -0,0 +1,224 @@
+
+/// @file ModuleRegistry_test.cc
+/// @brief ModuleRegistry_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "ModuleRegistry.h"
+#include "VsmModule.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 削除されていないテスト用のモジュールの数
+int live_num = 0;
+
+// 何もしないテスト用のモジュール
+// 削除されたかどうかを live_num で調べる．
+class TestModule :
+  public VsmModule
+{
+public:
+
+  // コンストラクタ
+  TestModule(VsmModule::Builder& builder) :
+    VsmModule(builder)
+  {
+    ++ live_num;
+  }
+
+  // デストラクタ
+  ~TestModule()
+  {
+    -- live_num;
+  }
+
+  // トップレベルの実行を行う．
+  virtual
+  void
+  execute_toplevel(Vsm& vsm) const
+  {
+  }
+
+};
+
+// モジュールを作る．
+// sub_module が NULL でなければそれを import する．
+VsmModule*
+new_module(const char* name,
+	   VsmModule* sub_module = NULL)
+{
+  VsmModule::Builder builder((ShString(name)));
+  if ( sub_module != NULL ) {
+    builder.add_module(sub_module);
+  }
+  return new TestModule(builder);
+}
+
+// 生きているモジュールの数を調べる．
+bool
+check_num(const char* name,
+	  ModuleRegistry& registry,
+	  int expected)
+{
+  bool ok = true;
+  if ( live_num != expected ) {
+    cerr << " " << name << ": " << live_num << " modules alive, expected "
+	 << expected << endl;
+    ok = false;
+  }
+  if ( static_cast<int>(registry.module_num()) != expected ) {
+    cerr << " " << name << ": registry has " << registry.module_num()
+	 << " modules, expected " << expected << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// 同じパスに登録し直した時に古いモジュールとそれを import している
+// モジュールが引けなくなり，参照がなくなった時点で削除されるか調べる．
+bool
+reregister_test()
+{
+  const char* name = "reregister_test";
+  ModuleRegistry registry;
+  bool ok = true;
+
+  VsmModule* a1 = registry.reg("/nonexistent/a.ym", 1, new_module("a"));
+  VsmModule* b1 = registry.reg("/nonexistent/b.ym", 1, new_module("b", a1));
+  ok &= check_num(name, registry, 2);
+
+  // 同じ内容を同時にコンパイルした場合は先に登録された方が返る．
+  VsmModule* a1_dup = registry.reg("/nonexistent/a.ym", 1, new_module("a"));
+  if ( a1_dup != a1 ) {
+    cerr << " " << name << ": duplicate was not merged" << endl;
+    ok = false;
+  }
+  registry.release(a1_dup);
+  ok &= check_num(name, registry, 2);
+
+  // import しているモジュールが違う場合は登録されない．
+  VsmModule* b1_other = registry.reg("/nonexistent/b.ym", 1,
+				     new_module("b", NULL));
+  if ( b1_other == b1 || registry.find("/nonexistent/b.ym", 1) != b1 ) {
+    cerr << " " << name << ": module with other imports was registered" << endl;
+    ok = false;
+  }
+  registry.release(b1);
+  ok &= check_num(name, registry, 3);
+  registry.release(b1_other);
+  ok &= check_num(name, registry, 2);
+
+  // a を登録し直すと a を import している b も引けなくなるが，
+  // 参照が残っている間は削除されない．
+  VsmModule* a2 = registry.reg("/nonexistent/a.ym", 2, new_module("a"));
+  if ( registry.find("/nonexistent/a.ym", 1) != NULL ||
+       registry.find("/nonexistent/b.ym", 1) != NULL ) {
+    cerr << " " << name << ": stale modules are still registered" << endl;
+    ok = false;
+  }
+  ok &= check_num(name, registry, 3);
+
+  // a1 は b1 が import しているので b1 を手放すまで残る．
+  registry.release(a1);
+  ok &= check_num(name, registry, 3);
+  registry.release(b1);
+  ok &= check_num(name, registry, 1);
+
+  VsmModule* a2_found = registry.find("/nonexistent/a.ym", 2);
+  if ( a2_found != a2 ) {
+    cerr << " " << name << ": new module is not registered" << endl;
+    ok = false;
+  }
+  registry.release(a2_found);
+  registry.release(a2);
+  ok &= check_num(name, registry, 1);
+
+  // 登録されていないモジュールは何もしない．
+  VsmModule* other = new_module("other");
+  registry.release(other);
+  delete other;
+
+  return ok;
+}
+
+// 無効にしたモジュールが参照がなくなった時点で削除されるか調べる．
+bool
+remove_test()
+{
+  const char* name = "remove_test";
+  ModuleRegistry registry;
+  bool ok = true;
+
+  VsmModule* a = registry.reg("/nonexistent/a.ym", 1, new_module("a"));
+  VsmModule* b = registry.reg("/nonexistent/b.ym", 1, new_module("b", a));
+  VsmModule* c = registry.reg("/nonexistent/c.ym", 1, new_module("c"));
+  registry.release(b);
+  registry.release(c);
+  ok &= check_num(name, registry, 3);
+
+  if ( registry.invalidate("/nonexistent/d.ym") ) {
+    cerr << " " << name << ": invalidated an unknown path" << endl;
+    ok = false;
+  }
+
+  // b は誰も参照していないのですぐに削除される．
+  // a はまだ参照しているので残る．
+  if ( !registry.invalidate("/nonexistent/a.ym") ) {
+    cerr << " " << name << ": failed to invalidate a" << endl;
+    ok = false;
+  }
+  if ( registry.find("/nonexistent/b.ym", 1) != NULL ) {
+    cerr << " " << name << ": b is still registered" << endl;
+    ok = false;
+  }
+  ok &= check_num(name, registry, 2);
+  registry.release(a);
+  ok &= check_num(name, registry, 1);
+
+  // 全て無効にすると参照のない c も削除される．
+  registry.invalidate_all();
+  if ( registry.find("/nonexistent/c.ym", 1) != NULL ) {
+    cerr << " " << name << ": c is still registered" << endl;
+    ok = false;
+  }
+  ok &= check_num(name, registry, 0);
+
+  return ok;
+}
+
+END_NONAMESPACE
+
+int
+ModuleRegistry_test(int argc,
+		    char** argv)
+{
+  int nerr = 0;
+
+  if ( !reregister_test() ) {
+    cerr << "reregister_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !remove_test() ) {
+    cerr << "remove_test failed" << endl;
+    ++ nerr;
+  }
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::ModuleRegistry_test(argc, argv);
+}
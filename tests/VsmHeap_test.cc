@@ -0,0 +1,1147 @@
+
+/// @file VsmHeap_test.cc
+/// @brief VsmHeap_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmHeap.h"
+#include "VsmGen.h"
+#include "VsmModule.h"
+#include "Vsm.h"
+#include "YmslCompiler.h"
+#include "AstMgr.h"
+#include "IrMgr.h"
+#include "IrToplevel.h"
+#include "YmslObj.h"
+#include "Type.h"
+#include "TypeMgr.h"
+
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <sstream>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 根のスロットの若いオブジェクトを写して若い世代のごみ集めを行う．
+// Vsm::minor_collect() と同じ手順で行う．
+void
+minor_gc(VsmHeap& heap,
+	 vector<Ymsl_OBJPTR>& root_list)
+{
+  for (ymuint i = 0; i < root_list.size(); ++ i) {
+    heap.forward(root_list[i]);
+  }
+  heap.minor_collect();
+}
+
+// 根のスロットから古い世代のごみ集めを最後まで行う．
+// Vsm::collect() と同じく，印つけの前後で若い世代のごみ集めを行い
+// 根に印をつける．
+void
+full_gc(VsmHeap& heap,
+	vector<Ymsl_OBJPTR>& root_list)
+{
+  heap.begin_pause();
+  minor_gc(heap, root_list);
+  for (ymuint i = 0; i < root_list.size(); ++ i) {
+    heap.mark(root_list[i]);
+  }
+  heap.start_mark();
+  while ( !heap.mark_step() ) ;
+  minor_gc(heap, root_list);
+  for (ymuint i = 0; i < root_list.size(); ++ i) {
+    heap.mark(root_list[i]);
+  }
+  heap.finish_mark();
+  while ( !heap.sweep_step() ) ;
+  heap.end_pause();
+}
+
+// i 番目に作る文字列の中身
+string
+elem_str(ymuint i)
+{
+  ostringstream buf;
+  buf << "s" << i;
+  return buf.str();
+}
+
+// i 番目に作る整数の配列の j 番目の要素
+Ymsl_INT
+elem_int(ymuint i,
+	 ymuint j)
+{
+  return static_cast<Ymsl_INT>(i * 7 + j);
+}
+
+// 文字列の中身を調べる．
+bool
+check_str(const char* name,
+	  Ymsl_OBJPTR obj,
+	  const string& expected)
+{
+  if ( obj == NULL || obj->kind() != YmslObj::kString ) {
+    cerr << " " << name << ": not a string" << endl;
+    return false;
+  }
+  string str(static_cast<const YmslString*>(obj)->str());
+  if ( str != expected ) {
+    cerr << " " << name << ": \"" << str << "\", expected \""
+	 << expected << "\"" << endl;
+    return false;
+  }
+  return true;
+}
+
+// スクリプトを実行する．
+// 実行に失敗したら NULL を返す．
+//
+// 結果の文字列は定数を指すことがあるので，
+// 返したモジュールは結果を調べ終えてから削除する．
+VsmModule*
+run_script(const char* name,
+	   const char* script,
+	   Vsm& vsm)
+{
+  YmslCompiler compiler;
+  StringIDO ido(script);
+  VsmModule* module = compiler.compile(ido, ShString("M"));
+  if ( module == NULL ) {
+    cerr << " " << name << ": failed to compile" << endl;
+    return NULL;
+  }
+  if ( !vsm.execute_module(*module) ) {
+    cerr << " " << name << ": failed to run" << endl;
+    delete module;
+    return NULL;
+  }
+  return module;
+}
+
+// スクリプトをレジスタ型のコードにして実行する．
+// 実行に失敗したら NULL を返す．
+VsmModule*
+run_reg_script(const char* name,
+	       const char* script,
+	       Vsm& vsm)
+{
+  StringIDO ido(script);
+  AstMgr ast_mgr;
+  if ( !ast_mgr.read_source(ido) ) {
+    cerr << " " << name << ": failed to parse" << endl;
+    return NULL;
+  }
+  YmslCompiler compiler;
+  IrMgr ir_mgr;
+  IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					  ShString("M"), compiler);
+  if ( toplevel == NULL ) {
+    cerr << " " << name << ": failed to elaborate" << endl;
+    return NULL;
+  }
+  ir_mgr.optimize(toplevel);
+
+  VsmGen gen(true);
+  VsmModule* module = gen.code_gen(toplevel, ShString("M"));
+  if ( module == NULL ) {
+    cerr << " " << name << ": failed to generate code" << endl;
+    return NULL;
+  }
+  if ( !vsm.execute_module(*module) ) {
+    cerr << " " << name << ": failed to run" << endl;
+    delete module;
+    return NULL;
+  }
+  return module;
+}
+
+// 文字列と配列を作り続けて一部だけを根に残し，
+// 若い世代と古い世代のごみ集めを何度も起こしても中身が変わらないか調べる．
+//
+// 根に残すのは要素数 2 の文字列の配列で，i 番目の文字列と
+// 整数の配列を入れた配列を入れておく．
+bool
+alloc_loop_test()
+{
+  const ymuint kLoopNum = 20000;
+  const ymuint kKeepInterval = 10;
+  const ymuint kMinorInterval = 50;
+  const ymuint kFullInterval = 1000;
+
+  TypeMgr type_mgr;
+  const Type* int_array_type = type_mgr.array_type(type_mgr.int_type());
+  const Type* str_array_type = type_mgr.array_type(type_mgr.string_type());
+
+  VsmHeap heap;
+  heap.set_nursery_size(4096);
+
+  vector<Ymsl_OBJPTR> root_list;
+  vector<ymuint> id_list;
+  for (ymuint i = 0; i < kLoopNum; ++ i) {
+    string str = elem_str(i);
+    YmslString* str_obj = heap.new_string(str.c_str(), str.size());
+    ymuint n = i % 5 + 1;
+    YmslArray* int_array = heap.new_array(int_array_type, n);
+    for (ymuint j = 0; j < n; ++ j) {
+      int_array->int_body()[j] = elem_int(i, j);
+    }
+    if ( i % kKeepInterval == 0 ) {
+      YmslArray* holder = heap.new_array(str_array_type, 2);
+      holder->obj_body()[0] = str_obj;
+      holder->obj_body()[1] = int_array;
+      root_list.push_back(holder);
+      id_list.push_back(i);
+    }
+
+    if ( i % kMinorInterval == kMinorInterval - 1 ) {
+      minor_gc(heap, root_list);
+    }
+    if ( i % kFullInterval == kFullInterval - 1 ) {
+      // 根の半分を捨ててごみにする．
+      ymuint wpos = 0;
+      for (ymuint rpos = 0; rpos < root_list.size(); ++ rpos) {
+	if ( (id_list[rpos] / kKeepInterval) % 2 == 0 ||
+	     id_list[rpos] + kFullInterval > i ) {
+	  root_list[wpos] = root_list[rpos];
+	  id_list[wpos] = id_list[rpos];
+	  ++ wpos;
+	}
+      }
+      root_list.resize(wpos);
+      id_list.resize(wpos);
+      full_gc(heap, root_list);
+    }
+  }
+  full_gc(heap, root_list);
+
+  bool ok = true;
+  if ( heap.minor_collect_num() < kLoopNum / kMinorInterval ) {
+    cerr << " alloc_loop_test: only " << heap.minor_collect_num()
+	 << " minor collections" << endl;
+    ok = false;
+  }
+  if ( heap.collect_num() != kLoopNum / kFullInterval + 1 ) {
+    cerr << " alloc_loop_test: " << heap.collect_num()
+	 << " full collections" << endl;
+    ok = false;
+  }
+  // 根から辿れるものしか残っていないはず．
+  if ( heap.obj_num() != root_list.size() * 3 ) {
+    cerr << " alloc_loop_test: " << heap.obj_num() << " objects for "
+	 << root_list.size() << " roots" << endl;
+    ok = false;
+  }
+
+  for (ymuint k = 0; k < root_list.size(); ++ k) {
+    ymuint i = id_list[k];
+    const YmslArray* holder = static_cast<const YmslArray*>(root_list[k]);
+    if ( holder->kind() != YmslObj::kObjArray || holder->size() != 2 ) {
+      cerr << " alloc_loop_test: root #" << i << " is broken" << endl;
+      ok = false;
+      continue;
+    }
+    if ( !check_str("alloc_loop_test", holder->obj_body()[0], elem_str(i)) ) {
+      ok = false;
+    }
+    const YmslArray* int_array = static_cast<const YmslArray*>(holder->obj_body()[1]);
+    ymuint n = i % 5 + 1;
+    if ( int_array == NULL || int_array->kind() != YmslObj::kIntArray ||
+	 int_array->size() != n ) {
+      cerr << " alloc_loop_test: array #" << i << " is broken" << endl;
+      ok = false;
+      continue;
+    }
+    for (ymuint j = 0; j < n; ++ j) {
+      if ( int_array->int_body()[j] != elem_int(i, j) ) {
+	cerr << " alloc_loop_test: array #" << i << "[" << j << "] = "
+	     << int_array->int_body()[j] << endl;
+	ok = false;
+	break;
+      }
+    }
+  }
+
+  return ok;
+}
+
+// 配列をキーにした集合を作り，キーが古い世代に写された後も
+// 全てのキーが見つかるか調べる．
+//
+// 配列のハッシュ値は内容から求めるので，キーが動いても
+// 表を作り直さずに見つかる．
+bool
+promoted_set_test()
+{
+  const ymuint kKeyNum = 300;
+
+  TypeMgr type_mgr;
+  const Type* int_array_type = type_mgr.array_type(type_mgr.int_type());
+  const Type* set_type = type_mgr.set_type(int_array_type);
+
+  VsmHeap heap;
+  heap.set_nursery_size(64 * 1024);
+
+  // 集合は古い世代に作られ，キーはナーサリに作られる．
+  YmslSet* set = heap.new_set(set_type);
+  for (ymuint i = 0; i < kKeyNum; ++ i) {
+    YmslArray* key = heap.new_array(int_array_type, 1);
+    key->int_body()[0] = i;
+    VsmValue val;
+    val.obj_value = key;
+    set->insert(val);
+  }
+
+  // 根は集合だけにして，キーは集合から辿らせる．
+  vector<Ymsl_OBJPTR> root_list(1, set);
+  minor_gc(heap, root_list);
+  if ( root_list[0] != set ) {
+    cerr << " promoted_set_test: set is moved" << endl;
+    return false;
+  }
+
+  bool ok = true;
+
+  // 全てのキーが写された場所で見つかり，中身が一通り揃っているか調べる．
+  vector<bool> found(kKeyNum, false);
+  ymuint num = 0;
+  for (ymuint pos = 0; pos < set->table_size(); ++ pos) {
+    if ( !set->is_used(pos) ) {
+      continue;
+    }
+    ++ num;
+    VsmValue key = set->key(pos);
+    if ( set->find(key) != static_cast<int>(pos) ) {
+      cerr << " promoted_set_test: key at " << pos << " is not found" << endl;
+      ok = false;
+    }
+    const YmslArray* array = static_cast<const YmslArray*>(key.obj_value);
+    Ymsl_INT i = array->int_body()[0];
+    if ( i < 0 || i >= static_cast<Ymsl_INT>(kKeyNum) || found[i] ) {
+      cerr << " promoted_set_test: key #" << i << " is broken" << endl;
+      ok = false;
+      continue;
+    }
+    found[i] = true;
+  }
+  if ( num != kKeyNum ) {
+    cerr << " promoted_set_test: " << num << " keys, expected "
+	 << kKeyNum << endl;
+    ok = false;
+  }
+
+  // キーを別の根からも辿って，写した先が同じものを指すか調べる．
+  YmslSet* set2 = heap.new_set(set_type);
+  for (ymuint i = 0; i < kKeyNum; i += 3) {
+    YmslArray* key = heap.new_array(int_array_type, 1);
+    key->int_body()[0] = i;
+    VsmValue val;
+    val.obj_value = key;
+    set2->insert(val);
+    root_list.push_back(key);
+  }
+  root_list.push_back(set2);
+  full_gc(heap, root_list);
+  for (ymuint k = 1; k + 1 < root_list.size(); ++ k) {
+    VsmValue val;
+    val.obj_value = root_list[k];
+    if ( set2->find(val) < 0 ) {
+      cerr << " promoted_set_test: key #"
+	   << static_cast<const YmslArray*>(root_list[k])->int_body()[0]
+	   << " is not found after the full collection" << endl;
+      ok = false;
+    }
+    // 中身が同じ別の配列も == と同じく同じキーになる．
+    if ( set->find(val) < 0 ) {
+      cerr << " promoted_set_test: array with the same contents "
+	   << "is not found" << endl;
+      ok = false;
+    }
+  }
+  if ( heap.obj_num() != kKeyNum + 2 + kKeyNum / 3 ) {
+    cerr << " promoted_set_test: " << heap.obj_num() << " objects" << endl;
+    ok = false;
+  }
+
+  return ok;
+}
+
+// 中身が同じで別に作ったオブジェクトが，集合のキーとしても
+// YmslObj::equal() と同じく等しく扱われることを調べる．
+//
+// 集合と連想配列は要素を入れる順序を変えて作る．
+bool
+obj_key_test()
+{
+  TypeMgr type_mgr;
+  const Type* int_array_type = type_mgr.array_type(type_mgr.int_type());
+  const Type* float_array_type = type_mgr.array_type(type_mgr.float_type());
+  const Type* str_array_type = type_mgr.array_type(type_mgr.string_type());
+  const Type* int_set_type = type_mgr.set_type(type_mgr.int_type());
+  const Type* str_map_type = type_mgr.map_type(int_array_type,
+					       type_mgr.string_type());
+
+  VsmHeap heap;
+
+  // 同じ中身のオブジェクトを二つずつ作る．
+  // str_list[0] は中身を写した文字列，str_list[1] は連結のノード
+  string half(100, 'k');
+  vector<Ymsl_OBJPTR> obj_list[2];
+  for (ymuint k = 0; k < 2; ++ k) {
+    YmslArray* int_array = heap.new_array(int_array_type, 3);
+    for (ymuint i = 0; i < 3; ++ i) {
+      int_array->int_body()[i] = i * 10;
+    }
+    obj_list[k].push_back(int_array);
+
+    YmslArray* float_array = heap.new_array(float_array_type, 2);
+    float_array->float_body()[0] = 0.5;
+    float_array->float_body()[1] = -2.0;
+    obj_list[k].push_back(float_array);
+
+    YmslString* half_str = heap.new_string(half.c_str(), half.size());
+    YmslString* str;
+    if ( k == 0 ) {
+      string whole = half + half;
+      str = heap.new_string(whole.c_str(), whole.size());
+    }
+    else {
+      str = heap.new_string(half_str, half_str);
+    }
+    YmslArray* str_array = heap.new_array(str_array_type, 2);
+    str_array->obj_body()[0] = str;
+    str_array->obj_body()[1] = NULL;
+    obj_list[k].push_back(str_array);
+
+    YmslSet* int_set = heap.new_set(int_set_type);
+    for (ymuint i = 0; i < 20; ++ i) {
+      VsmValue key;
+      key.int_value = (k == 0) ? i : 19 - i;
+      int_set->insert(key);
+    }
+    obj_list[k].push_back(int_set);
+
+    YmslSet* str_map = heap.new_set(str_map_type);
+    for (ymuint i = 0; i < 2; ++ i) {
+      ymuint j = (k == 0) ? i : 1 - i;
+      string name = elem_str(j);
+      VsmValue key;
+      key.obj_value = heap.new_string(name.c_str(), name.size());
+      YmslArray* array = heap.new_array(int_array_type, 1);
+      array->int_body()[0] = j;
+      VsmValue value;
+      value.obj_value = array;
+      str_map->insert(key, value);
+    }
+    obj_list[k].push_back(str_map);
+  }
+
+  bool ok = true;
+  const ymuint n = obj_list[0].size();
+  for (ymuint i = 0; i < n; ++ i) {
+    const YmslObj* obj1 = obj_list[0][i];
+    const YmslObj* obj2 = obj_list[1][i];
+    if ( !YmslObj::equal(obj1, obj2) ) {
+      cerr << " obj_key_test: object #" << i << " differs" << endl;
+      ok = false;
+    }
+    if ( YmslObj::hash(obj1) != YmslObj::hash(obj2) ) {
+      cerr << " obj_key_test: hash of object #" << i << " differs" << endl;
+      ok = false;
+    }
+
+    // 一方をキーにした集合でもう一方が見つかり，同じキーとして加わる．
+    YmslSet* set = heap.new_set(type_mgr.set_type(obj1->type()));
+    VsmValue val1;
+    val1.obj_value = obj_list[0][i];
+    VsmValue val2;
+    val2.obj_value = obj_list[1][i];
+    set->insert(val1);
+    if ( set->find(val2) < 0 ) {
+      cerr << " obj_key_test: object #" << i << " is not found" << endl;
+      ok = false;
+    }
+    set->insert(val2);
+    if ( set->size() != 1 ) {
+      cerr << " obj_key_test: object #" << i << " is inserted twice" << endl;
+      ok = false;
+    }
+  }
+
+  // 中身の違う配列は見つからない．
+  YmslSet* set = heap.new_set(type_mgr.set_type(int_array_type));
+  VsmValue val;
+  val.obj_value = obj_list[0][0];
+  set->insert(val);
+  YmslArray* other = heap.new_array(int_array_type, 3);
+  for (ymuint i = 0; i < 3; ++ i) {
+    other->int_body()[i] = i * 10 + 1;
+  }
+  val.obj_value = other;
+  if ( set->find(val) >= 0 ) {
+    cerr << " obj_key_test: array with other contents is found" << endl;
+    ok = false;
+  }
+
+  return ok;
+}
+
+// スクリプトの中で文字列を作り続けて，
+// スタックマップを使ったごみ集めを何度も起こしても結果が変わらないか調べる．
+const char* kAllocScript =
+  "var s:string = \"\";"
+  "var t:string = \"\";"
+  "var n:int = 0;"
+  "function wrap(x:string, y:string):string {"
+  "  var u:string = x + y;"
+  "  var w:string = u + x;"
+  "  return w;"
+  "}"
+  "var i:int = 0;"
+  "var v:int = 0;"
+  "while ( i < 5000 ) {"
+  "  t = wrap(\"<\", \"ab\");"
+  "  s = wrap(t, \"-\");"
+  "  n = n + 1;"
+  "  i = i + 1;"
+  "}";
+
+bool
+alloc_script_test()
+{
+  Vsm vsm;
+  vsm.heap().set_collect_threshold(16);
+  vsm.heap().set_nursery_size(1024);
+  VsmModule* module = run_script("alloc_script_test", kAllocScript, vsm);
+  if ( module == NULL ) {
+    return false;
+  }
+
+  bool ok = true;
+  if ( !check_str("alloc_script_test", vsm.read_global(0).obj_value,
+		  "<ab<-<ab<") ) {
+    ok = false;
+  }
+  if ( !check_str("alloc_script_test", vsm.read_global(1).obj_value,
+		  "<ab<") ) {
+    ok = false;
+  }
+  if ( vsm.read_global(2).int_value != 5000 ) {
+    cerr << " alloc_script_test: n = " << vsm.read_global(2).int_value
+	 << ", expected 5000" << endl;
+    ok = false;
+  }
+  if ( vsm.heap().minor_collect_num() == 0 ||
+       vsm.heap().collect_num() == 0 ) {
+    cerr << " alloc_script_test: no collection ("
+	 << vsm.heap().minor_collect_num() << " minor, "
+	 << vsm.heap().collect_num() << " full)" << endl;
+    ok = false;
+  }
+
+  delete module;
+  return ok;
+}
+
+// 時間を区切って古い世代のごみ集めを行い，印つけと解放の途中で
+// 作ったオブジェクトや根を付け替えたオブジェクトが解放されないか調べる．
+//
+// 大域変数に当たる根と局所変数に当たる根を分けておき，
+// 印つけの途中でそれぞれにしか持たれないオブジェクトを作る．
+bool
+incremental_mark_test()
+{
+  const ymuint kChainNum = 50000;
+  const ymuint kMinorInterval = 50;
+
+  TypeMgr type_mgr;
+  const Type* str_array_type = type_mgr.array_type(type_mgr.string_type());
+
+  VsmHeap heap;
+  heap.set_nursery_size(4096);
+  heap.set_time_slice(1);
+
+  // 要素数 2 の配列で鎖を作る．
+  // [0] が i 番目の文字列で [1] が一つ前の配列を指す．
+  vector<Ymsl_OBJPTR> global_list(2, static_cast<Ymsl_OBJPTR>(NULL));
+  for (ymuint i = 0; i < kChainNum; ++ i) {
+    string str = elem_str(i);
+    YmslArray* node = heap.new_array(str_array_type, 2);
+    node->obj_body()[0] = heap.new_string(str.c_str(), str.size());
+    node->obj_body()[1] = global_list[0];
+    global_list[0] = node;
+    if ( i % kMinorInterval == kMinorInterval - 1 ) {
+      minor_gc(heap, global_list);
+    }
+  }
+
+  vector<Ymsl_OBJPTR> local_list;
+  vector<string> local_str_list;
+  ymuint slice_num = 0;
+
+  heap.begin_pause();
+  minor_gc(heap, global_list);
+  for (ymuint i = 0; i < global_list.size(); ++ i) {
+    heap.mark(global_list[i]);
+  }
+  heap.start_mark();
+  bool done = heap.mark_step();
+  heap.end_pause();
+  ++ slice_num;
+
+  // 鎖の半ばの配列を局所変数だけに持たせ，大域変数は付け替える．
+  Ymsl_OBJPTR mid = global_list[0];
+  for (ymuint i = 0; i < kChainNum / 2; ++ i) {
+    mid = static_cast<const YmslArray*>(mid)->obj_body()[1];
+  }
+  local_list.push_back(mid);
+  local_str_list.push_back(elem_str(kChainNum / 2 - 1));
+  global_list[0] = NULL;
+
+  while ( !done ) {
+    // 停止の合間に若いオブジェクトと古い世代に直接作るオブジェクトを作り，
+    // 大域変数だけか局所変数だけに持たせる．
+    string gstr = "g" + elem_str(slice_num);
+    global_list[1] = heap.new_string(gstr.c_str(), gstr.size());
+    string lstr = "l" + elem_str(slice_num);
+    YmslArray* holder = heap.new_array(str_array_type, 1);
+    holder->obj_body()[0] = heap.new_string(lstr.c_str(), lstr.size());
+    YmslSet* set = heap.new_set(type_mgr.set_type(str_array_type));
+    VsmValue val;
+    val.obj_value = holder;
+    set->insert(val);
+    local_list.push_back(set);
+    local_str_list.push_back(lstr);
+
+    // Vsm::collect() と同じく若い世代のごみ集めは必要な時だけ行う．
+    // 要素が若いうちに集合の印つけが済むことがある．
+    heap.begin_pause();
+    if ( heap.need_minor_collect() ) {
+      minor_gc(heap, global_list);
+      minor_gc(heap, local_list);
+    }
+    done = heap.mark_step();
+    heap.end_pause();
+    ++ slice_num;
+  }
+  string last_gstr = "g" + elem_str(slice_num - 1);
+
+  heap.begin_pause();
+  minor_gc(heap, global_list);
+  minor_gc(heap, local_list);
+  for (ymuint i = 0; i < global_list.size(); ++ i) {
+    heap.mark(global_list[i]);
+  }
+  for (ymuint i = 0; i < local_list.size(); ++ i) {
+    heap.mark(local_list[i]);
+  }
+  heap.finish_mark();
+  heap.end_pause();
+
+  // 解放の途中で作ったものも残らなければならない．
+  ymuint sweep_slice_num = 0;
+  for (done = false; !done; ++ sweep_slice_num) {
+    string lstr = "s" + elem_str(sweep_slice_num);
+    local_list.push_back(heap.new_string(lstr.c_str(), lstr.size()));
+    local_str_list.push_back(lstr);
+    heap.begin_pause();
+    minor_gc(heap, local_list);
+    done = heap.sweep_step();
+    heap.end_pause();
+  }
+
+  bool ok = true;
+  if ( slice_num < 2 ) {
+    cerr << " incremental_mark_test: marking is done at once" << endl;
+    ok = false;
+  }
+
+  for (ymuint round = 0; round < 2; ++ round) {
+    const char* name = (round == 0) ? "incremental_mark_test" :
+      "incremental_mark_test(2nd)";
+    if ( !check_str(name, global_list[1], last_gstr) ) {
+      ok = false;
+    }
+
+    // 局所変数だけが持っていた鎖の後半
+    ymuint n = 0;
+    for (Ymsl_OBJPTR node = local_list[0]; node != NULL;
+	 node = static_cast<const YmslArray*>(node)->obj_body()[1]) {
+      const YmslArray* array = static_cast<const YmslArray*>(node);
+      ymuint i = kChainNum / 2 - 1 - n;
+      if ( array->kind() != YmslObj::kObjArray ||
+	   !check_str(name, array->obj_body()[0], elem_str(i)) ) {
+	ok = false;
+	break;
+      }
+      ++ n;
+    }
+    if ( n != kChainNum / 2 ) {
+      cerr << " " << name << ": chain has " << n << " nodes" << endl;
+      ok = false;
+    }
+
+    for (ymuint k = 1; k < local_list.size(); ++ k) {
+      Ymsl_OBJPTR obj = local_list[k];
+      if ( obj->kind() == YmslObj::kSet ) {
+	const YmslSet* set = static_cast<const YmslSet*>(obj);
+	if ( set->size() != 1 ) {
+	  cerr << " " << name << ": set #" << k << " is broken" << endl;
+	  ok = false;
+	  continue;
+	}
+	for (ymuint pos = 0; pos < set->table_size(); ++ pos) {
+	  if ( set->is_used(pos) ) {
+	    obj = static_cast<const YmslArray*>(set->key(pos).obj_value)->obj_body()[0];
+	  }
+	}
+      }
+      if ( !check_str(name, obj, local_str_list[k]) ) {
+	ok = false;
+      }
+    }
+
+    // もう一度最後まで行っても同じものが残る．
+    vector<Ymsl_OBJPTR> root_list(global_list);
+    root_list.insert(root_list.end(), local_list.begin(), local_list.end());
+    full_gc(heap, root_list);
+    global_list.assign(root_list.begin(), root_list.begin() + 2);
+    local_list.assign(root_list.begin() + 2, root_list.end());
+  }
+
+  return ok;
+}
+
+// 大域変数だけか局所変数だけが持つ長い文字列を作ってから
+// ごみを作り続け，時間を区切った印つけの途中でも解放されないか調べる．
+//
+// 長い文字列を一文字ずつつなぐと連結のノードが長い鎖になるので，
+// 印つけが一回の停止では終わらない．
+const char* kIncrementalScript =
+  "var g:string = \"\";"
+  "var r:string = \"\";"
+  "var t:string = \"\";"
+  "function hold(n:int):string {"
+  "  var x:string = \"l\";"
+  "  var y:string = \"\";"
+  "  var j:int = 0;"
+  "  while ( j < n ) {"
+  "    x = x + \"l\";"
+  "    j = j + 1;"
+  "  }"
+  "  j = 0;"
+  "  while ( j < 20000 ) {"
+  "    y = x + \"?\";"
+  "    j = j + 1;"
+  "  }"
+  "  return x;"
+  "}"
+  "var i:int = 0;"
+  "g = \"g\";"
+  "while ( i < 3000 ) {"
+  "  g = g + \"g\";"
+  "  i = i + 1;"
+  "}"
+  "i = 0;"
+  "while ( i < 20000 ) {"
+  "  t = g + \"!\";"
+  "  i = i + 1;"
+  "}"
+  "r = hold(3000);";
+
+bool
+incremental_script_test()
+{
+  Vsm vsm;
+  vsm.heap().set_collect_threshold(16);
+  vsm.heap().set_nursery_size(1024);
+  vsm.heap().set_time_slice(1);
+  vsm.heap().set_slice_interval(0);
+  VsmModule* module = run_script("incremental_script_test",
+				 kIncrementalScript, vsm);
+  if ( module == NULL ) {
+    return false;
+  }
+
+  bool ok = true;
+  if ( !check_str("incremental_script_test", vsm.read_global(0).obj_value,
+		  string(3001, 'g')) ) {
+    ok = false;
+  }
+  if ( !check_str("incremental_script_test", vsm.read_global(1).obj_value,
+		  string(3001, 'l')) ) {
+    ok = false;
+  }
+  if ( vsm.heap().collect_num() < 2 ) {
+    cerr << " incremental_script_test: only "
+	 << vsm.heap().collect_num() << " full collections" << endl;
+    ok = false;
+  }
+
+  delete module;
+  return ok;
+}
+
+// alloc_script_test と incremental_script_test のスクリプトを
+// レジスタ型のコードで実行し，ごみ集めが起きても結果が変わらないか調べる．
+bool
+reg_script_test()
+{
+  bool ok = true;
+  {
+    Vsm vsm;
+    vsm.heap().set_collect_threshold(16);
+    vsm.heap().set_nursery_size(1024);
+    VsmModule* module = run_reg_script("reg_script_test", kAllocScript, vsm);
+    if ( module == NULL ) {
+      return false;
+    }
+    if ( !check_str("reg_script_test", vsm.read_global(0).obj_value,
+		    "<ab<-<ab<") ) {
+      ok = false;
+    }
+    if ( !check_str("reg_script_test", vsm.read_global(1).obj_value,
+		    "<ab<") ) {
+      ok = false;
+    }
+    if ( vsm.read_global(2).int_value != 5000 ) {
+      cerr << " reg_script_test: n = " << vsm.read_global(2).int_value
+	   << ", expected 5000" << endl;
+      ok = false;
+    }
+    if ( vsm.heap().minor_collect_num() == 0 ||
+	 vsm.heap().collect_num() == 0 ) {
+      cerr << " reg_script_test: no collection ("
+	   << vsm.heap().minor_collect_num() << " minor, "
+	   << vsm.heap().collect_num() << " full)" << endl;
+      ok = false;
+    }
+    delete module;
+  }
+  {
+    Vsm vsm;
+    vsm.heap().set_collect_threshold(16);
+    vsm.heap().set_nursery_size(1024);
+    vsm.heap().set_time_slice(1);
+    vsm.heap().set_slice_interval(0);
+    VsmModule* module = run_reg_script("reg_script_test",
+				       kIncrementalScript, vsm);
+    if ( module == NULL ) {
+      return false;
+    }
+    if ( !check_str("reg_script_test", vsm.read_global(0).obj_value,
+		    string(3001, 'g')) ) {
+      ok = false;
+    }
+    if ( !check_str("reg_script_test", vsm.read_global(1).obj_value,
+		    string(3001, 'l')) ) {
+      ok = false;
+    }
+    if ( vsm.heap().collect_num() < 2 ) {
+      cerr << " reg_script_test: only "
+	   << vsm.heap().collect_num() << " full collections" << endl;
+      ok = false;
+    }
+    delete module;
+  }
+  return ok;
+}
+
+// 若い文字列をつないだ連結のノードを作り，若い世代のごみ集めの
+// 前後で中身をまとめても同じ文字列になるか調べる．
+bool
+rope_test()
+{
+  TypeMgr type_mgr;
+  const Type* set_type = type_mgr.set_type(type_mgr.string_type());
+
+  VsmHeap heap;
+  heap.set_nursery_size(64 * 1024);
+
+  // 連結のノードになる長さの文字列を作る．
+  string str1(100, 'a');
+  string str2(100, 'b');
+  string str3(30, 'c');
+  YmslString* leaf1 = heap.new_string(str1.c_str(), str1.size());
+  YmslString* leaf2 = heap.new_string(str2.c_str(), str2.size());
+  YmslString* leaf3 = heap.new_string(str3.c_str(), str3.size());
+
+  // rope1 は若い世代のごみ集めの後にまとめる．
+  // rope2 は若い世代のごみ集めの前にまとめる．
+  // rope3 は rope1 を前半に持つ．
+  YmslString* rope1 = heap.new_string(leaf1, leaf2);
+  YmslString* rope2 = heap.new_string(leaf2, leaf3);
+  YmslString* rope3 = heap.new_string(rope1, leaf3);
+
+  bool ok = true;
+  if ( !rope1->is_rope() || !rope2->is_rope() || !rope3->is_rope() ) {
+    cerr << " rope_test: not a rope" << endl;
+    return false;
+  }
+
+  if ( !check_str("rope_test", rope2, str2 + str3) ) {
+    ok = false;
+  }
+
+  // 根は連結のノードだけにして，元の文字列はノードから辿らせる．
+  vector<Ymsl_OBJPTR> root_list;
+  root_list.push_back(rope1);
+  root_list.push_back(rope2);
+  root_list.push_back(rope3);
+  minor_gc(heap, root_list);
+  if ( root_list[0] != rope1 || root_list[1] != rope2 ||
+       root_list[2] != rope3 ) {
+    cerr << " rope_test: rope is moved" << endl;
+    ok = false;
+  }
+  // ノードが 3 つとノードが指していた leaf1, leaf2, leaf3 が残る．
+  if ( heap.obj_num() != 6 ) {
+    cerr << " rope_test: " << heap.obj_num()
+	 << " objects after the minor collection" << endl;
+    ok = false;
+  }
+
+  // 写した後に rope3 から先にまとめ，中のノードはまとめずに辿らせる．
+  if ( !check_str("rope_test", rope3, str1 + str2 + str3) ) {
+    ok = false;
+  }
+  if ( !check_str("rope_test", rope1, str1 + str2) ) {
+    ok = false;
+  }
+  if ( !check_str("rope_test", rope2, str2 + str3) ) {
+    ok = false;
+  }
+
+  // 連結のノードのハッシュ値と比較は中身で行う．
+  string str4 = str1 + str2;
+  YmslString* flat = heap.new_string(str4.c_str(), str4.size());
+  if ( rope1->hash() != flat->hash() ||
+       !YmslString::is_equal(rope1, flat) ) {
+    cerr << " rope_test: rope and flat string differ" << endl;
+    ok = false;
+  }
+  YmslSet* set = heap.new_set(set_type);
+  VsmValue val;
+  val.obj_value = rope1;
+  set->insert(val);
+  root_list.push_back(set);
+
+  // まとめた後はノードが元の文字列を指さないので解放される．
+  full_gc(heap, root_list);
+  if ( heap.obj_num() != 4 ) {
+    cerr << " rope_test: " << heap.obj_num()
+	 << " objects after the full collection" << endl;
+    ok = false;
+  }
+  flat = heap.new_string(str4.c_str(), str4.size());
+  val.obj_value = flat;
+  if ( set->find(val) < 0 ) {
+    cerr << " rope_test: rope key is not found" << endl;
+    ok = false;
+  }
+  if ( !check_str("rope_test(2nd)", rope3, str1 + str2 + str3) ) {
+    ok = false;
+  }
+
+  return ok;
+}
+
+// 連結を表すノードがまとめた中身のバイト数を数え，オブジェクトの
+// 数が少なくてもそれがしきい値を超えたら古い世代のごみ集めを
+// 行うべきになることを調べる．
+bool
+rope_flat_size_test()
+{
+  VsmHeap heap;
+  heap.set_collect_threshold(1000000);
+
+  // 64K 文字の連結を一つずつまとめる．しきい値の下限は 1MB なので
+  // 16 個目で超える．
+  string str(32 * 1024, 'a');
+  YmslString* leaf = heap.new_string(str.c_str(), str.size());
+  const ymuint64 rope_size = str.size() * 2 + 1;
+
+  bool ok = true;
+  vector<Ymsl_OBJPTR> root_list;
+  root_list.push_back(leaf);
+  YmslString* kept = NULL;
+  ymuint n = 0;
+  for ( ; n < 100 && !heap.need_full_collect(); ++ n) {
+    YmslString* rope = heap.new_string(leaf, leaf);
+    if ( !rope->is_rope() ) {
+      cerr << " rope_flat_size_test: not a rope" << endl;
+      return false;
+    }
+    if ( heap.flat_size() != rope_size * n ) {
+      cerr << " rope_flat_size_test: flat_size() = " << heap.flat_size()
+	   << " before flattening rope #" << n << endl;
+      ok = false;
+    }
+    rope->str();
+    // 二度目は数えない．
+    rope->str();
+    if ( kept == NULL ) {
+      kept = rope;
+    }
+  }
+  if ( n != 16 ) {
+    cerr << " rope_flat_size_test: need_full_collect() after "
+	 << n << " ropes, expected 16" << endl;
+    ok = false;
+  }
+
+  // 根から辿れる最初のノードの分だけが残る．
+  root_list.push_back(kept);
+  full_gc(heap, root_list);
+  if ( heap.flat_size() != rope_size ) {
+    cerr << " rope_flat_size_test: flat_size() = " << heap.flat_size()
+	 << " after the full collection, expected " << rope_size << endl;
+    ok = false;
+  }
+  if ( heap.need_full_collect() ) {
+    cerr << " rope_flat_size_test: need_full_collect() after "
+	 << "the full collection" << endl;
+    ok = false;
+  }
+  if ( !check_str("rope_flat_size_test", kept, str + str) ) {
+    ok = false;
+  }
+
+  return ok;
+}
+
+// スクリプトの中で文字列を一つずつ伸ばし，
+// ごみ集めの途中で連結のノードをまとめても中身が変わらないか調べる．
+const char* kRopeScript =
+  "var s:string = \"\";"
+  "var t:string = \"\";"
+  "var c:int = 0;"
+  "var i:int = 0;"
+  "while ( i < 400 ) {"
+  "  t = s + \"xyz\";"
+  "  s = t + \"-\";"
+  "  if ( s == t ) {"
+  "    c = c + 1;"
+  "  }"
+  "  i = i + 1;"
+  "}";
+
+bool
+rope_script_test()
+{
+  Vsm vsm;
+  vsm.heap().set_collect_threshold(16);
+  vsm.heap().set_nursery_size(1024);
+  VsmModule* module = run_script("rope_script_test", kRopeScript, vsm);
+  if ( module == NULL ) {
+    return false;
+  }
+
+  string expected;
+  for (ymuint i = 0; i < 400; ++ i) {
+    expected += "xyz-";
+  }
+
+  bool ok = true;
+  if ( !check_str("rope_script_test", vsm.read_global(0).obj_value,
+		  expected) ) {
+    ok = false;
+  }
+  if ( !check_str("rope_script_test", vsm.read_global(1).obj_value,
+		  expected.substr(0, expected.size() - 1)) ) {
+    ok = false;
+  }
+  if ( vsm.read_global(2).int_value != 0 ) {
+    cerr << " rope_script_test: c = " << vsm.read_global(2).int_value
+	 << ", expected 0" << endl;
+    ok = false;
+  }
+  if ( vsm.heap().minor_collect_num() == 0 ) {
+    cerr << " rope_script_test: no minor collection" << endl;
+    ok = false;
+  }
+
+  delete module;
+  return ok;
+}
+
+END_NONAMESPACE
+
+int
+VsmHeap_test(int argc,
+	     char** argv)
+{
+  StreamMsgHandler handler(&cerr);
+  MsgMgr::reg_handler(&handler);
+
+  int nerr = 0;
+
+  if ( !alloc_loop_test() ) {
+    cerr << "alloc_loop_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !alloc_script_test() ) {
+    cerr << "alloc_script_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !promoted_set_test() ) {
+    cerr << "promoted_set_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !obj_key_test() ) {
+    cerr << "obj_key_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !incremental_mark_test() ) {
+    cerr << "incremental_mark_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !incremental_script_test() ) {
+    cerr << "incremental_script_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !reg_script_test() ) {
+    cerr << "reg_script_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !rope_test() ) {
+    cerr << "rope_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !rope_script_test() ) {
+    cerr << "rope_script_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !rope_flat_size_test() ) {
+    cerr << "rope_flat_size_test failed" << endl;
+    ++ nerr;
+  }
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::VsmHeap_test(argc, argv);
+}
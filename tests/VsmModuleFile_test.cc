@@ -0,0 +1,843 @@
+
+/// @file VsmModuleFile_test.cc
+/// @brief VsmModuleFile_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "VsmModuleFile.h"
+#include "VsmBinIO.h"
+#include "VsmCodeList.h"
+#include "VsmModule.h"
+#include "VsmFunction.h"
+#include "VsmVar.h"
+#include "Vsm.h"
+#include "VsmHeap.h"
+#include "YmslCompiler.h"
+#include "ModuleRegistry.h"
+#include "YmslObj.h"
+#include "Type.h"
+#include "TypeMgr.h"
+#include "AstMgr.h"
+#include "AstStatement.h"
+#include "IrMgr.h"
+#include "IrToplevel.h"
+#include "VsmGen.h"
+
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <unistd.h>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 書き出して読み込むスクリプト
+//
+// 配列，集合，連想配列，関数の型を持つ変数と関数，
+// ジャンプテーブルになる switch 文，スタックマップを持つ
+// 文字列の連結と関数呼び出しを含む．
+const char* kScript =
+  "var n:int = 0;"
+  "var s:string = \"\";"
+  "var f:float = 1.5;"
+  "var a:array(int);"
+  "var m:map(string, array(float));"
+  "var st:set(int);"
+  "function pick(v:int):int {"
+  "  var r:int = 0;"
+  "  switch v {"
+  "  case 0: { r = 10; }"
+  "  case 1: { r = 11; }"
+  "  case 2: { r = 12; }"
+  "  case 3: { r = 13; }"
+  "  default: { r = -1; }"
+  "  }"
+  "  return r;"
+  "}"
+  "function cat3(x:string, y:string):string {"
+  "  var t:string = x + y;"
+  "  return t + x;"
+  "}"
+  "function keep(p:array(int), q:map(string, array(float)), w:set(int)):array(int) {"
+  "  return p;"
+  "}"
+  "var i:int = 0;"
+  "var v:int = 0;"
+  "while ( i < 100 ) {"
+  "  v = pick(i % 5);"
+  "  n = n + v;"
+  "  s = cat3(\"a\", \"b\");"
+  "  i = i + 1;"
+  "}"
+  "f = f * 2.25 + 100000.5;"
+  "a = keep(a, m, st);";
+
+// ファイルの内容を読む．
+bool
+read_file(const string& path,
+	  vector<ymuint8>& data)
+{
+  data.clear();
+  FILE* fp = fopen(path.c_str(), "rb");
+  if ( fp == NULL ) {
+    return false;
+  }
+  ymuint8 buf[4096];
+  for ( ; ; ) {
+    size_t n = fread(buf, 1, sizeof(buf), fp);
+    if ( n == 0 ) {
+      break;
+    }
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(fp);
+  return true;
+}
+
+// ファイルに書き出す．
+bool
+write_file(const string& path,
+	   const ymuint8* data,
+	   ymuint64 size)
+{
+  FILE* fp = fopen(path.c_str(), "wb");
+  if ( fp == NULL ) {
+    return false;
+  }
+  bool stat = (size == 0 || fwrite(data, 1, size, fp) == size);
+  if ( fclose(fp) != 0 ) {
+    stat = false;
+  }
+  return stat;
+}
+
+// 型を文字列にする．
+string
+type_str(const Type* type)
+{
+  ostringstream buf;
+  type->print(buf);
+  return buf.str();
+}
+
+// モジュールの関数と変数の名前と型が等しいか調べる．
+bool
+same_interface(const VsmModule& module1,
+	       const VsmModule& module2)
+{
+  if ( module1.exported_function_num() != module2.exported_function_num() ||
+       module1.exported_variable_num() != module2.exported_variable_num() ) {
+    return false;
+  }
+  for (ymuint i = 0; i < module1.exported_function_num(); ++ i) {
+    const VsmFunction* func1 = module1.exported_function(i);
+    const VsmFunction* func2 = module2.exported_function(i);
+    if ( func1->name() != func2->name() ||
+	 type_str(func1->type()) != type_str(func2->type()) ) {
+      return false;
+    }
+  }
+  for (ymuint i = 0; i < module1.exported_variable_num(); ++ i) {
+    const VsmVar* var1 = module1.exported_variable(i);
+    const VsmVar* var2 = module2.exported_variable(i);
+    if ( var1->name() != var2->name() ||
+	 type_str(var1->type()) != type_str(var2->type()) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// モジュールを実行して結果を調べる．
+bool
+check_result(const char* name,
+	     VsmModule& module)
+{
+  Vsm vsm;
+  // ごみ集めを頻繁に起こしてスタックマップを使わせる．
+  vsm.heap().set_collect_threshold(16);
+  if ( !vsm.execute_module(module) ) {
+    cerr << " " << name << ": failed to run" << endl;
+    return false;
+  }
+
+  bool ok = true;
+  Ymsl_INT n = vsm.read_global(0).int_value;
+  if ( n != 900 ) {
+    cerr << " " << name << ": n = " << n << ", expected 900" << endl;
+    ok = false;
+  }
+  const YmslString* s = static_cast<const YmslString*>(vsm.read_global(1).obj_value);
+  if ( s == NULL || string(s->str()) != "aba" ) {
+    cerr << " " << name << ": s is not \"aba\"" << endl;
+    ok = false;
+  }
+  Ymsl_FLOAT f = vsm.read_global(2).float_value;
+  if ( f != 100003.875 ) {
+    cerr << " " << name << ": f = " << f << ", expected 100003.875" << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+// 一時ディレクトリのパスを作る．
+string
+make_path(const string& dir,
+	  const char* name)
+{
+  return dir + "/" + name;
+}
+
+// import されるモジュール
+//
+// トップレベルは一度だけ実行されなければ count が 100 にならない．
+const char* kImportB =
+  "var count:int = 0;"
+  "var scale:float = 1.5;"
+  "var name:string = \"b\";"
+  "function add(x:int):int {"
+  "  count = count + x;"
+  "  return count;"
+  "}"
+  "function twice(x:int):int {"
+  "  var r:int = add(x);"
+  "  return add(x);"
+  "}"
+  "count = count + 100;";
+
+// B を import して B の関数を呼ぶモジュール
+const char* kImportC =
+  "import B;"
+  "function addc(x:int):int {"
+  "  var r:int = B.add(x);"
+  "  return r;"
+  "}"
+  "function tailc(x:int):int {"
+  "  return B.add(x);"
+  "}";
+
+// B と C を import するモジュール
+//
+// レジスタ型のコードは別の IrMgr で作るので，B の変数の型は
+// こちらの型と比較できない．二項演算の前に局所変数に代入する．
+const char* kImportMain =
+  "import B;"
+  "import C;"
+  "var r1:int = 0;"
+  "var r2:int = 0;"
+  "var r3:int = 0;"
+  "var r4:int = 0;"
+  "var r5:int = 0;"
+  "var f:float = 0.0;"
+  "var s:string = \"\";"
+  "r1 = B.add(5);"
+  "var t:int = B.count;"
+  "B.count = t + 10;"
+  "r2 = C.addc(1);"
+  "r3 = B.twice(2);"
+  "r4 = C.tailc(3);"
+  "r5 = B.count;"
+  "var g:float = B.scale;"
+  "B.scale = g * 2.0;"
+  "f = B.scale;"
+  "var u:string = B.name;"
+  "B.name = u + \"x\";"
+  "s = B.name;";
+
+// kImportMain を実行して結果を調べる．
+// reg_mode が true の時は kImportMain をレジスタ型のコードにする．
+// import されるモジュールは compiler が作る．
+bool
+check_import(const char* name,
+	     YmslCompiler& compiler,
+	     bool reg_mode,
+	     ymuint jit_threshold)
+{
+  StringIDO ido(kImportMain);
+  AstMgr ast_mgr;
+  if ( !ast_mgr.read_source(ido) ) {
+    cerr << " " << name << ": failed to parse" << endl;
+    return false;
+  }
+  IrMgr ir_mgr;
+  IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					  ShString("__main__"), compiler);
+  if ( toplevel == NULL ) {
+    cerr << " " << name << ": failed to elaborate" << endl;
+    return false;
+  }
+  ir_mgr.optimize(toplevel);
+  VsmGen gen(reg_mode);
+  VsmModule* module = gen.code_gen(toplevel, ShString("__main__"));
+  if ( module == NULL ) {
+    cerr << " " << name << ": failed to compile" << endl;
+    return false;
+  }
+
+  bool ok = true;
+  Vsm vsm;
+  vsm.set_jit_threshold(jit_threshold);
+  vsm.heap().set_collect_threshold(16);
+  if ( !vsm.execute_module(*module) ) {
+    cerr << " " << name << ": failed to run" << endl;
+    delete module;
+    return false;
+  }
+
+  // 100 + 5, +10, +1, +2 +2, +3
+  static const Ymsl_INT expected[] = { 105, 116, 120, 123, 123 };
+  for (ymuint i = 0; i < 5; ++ i) {
+    Ymsl_INT val = vsm.read_global(i).int_value;
+    if ( val != expected[i] ) {
+      cerr << " " << name << ": r" << (i + 1) << " = " << val
+	   << ", expected " << expected[i] << endl;
+      ok = false;
+    }
+  }
+  Ymsl_FLOAT f = vsm.read_global(5).float_value;
+  if ( f != 3.0 ) {
+    cerr << " " << name << ": f = " << f << ", expected 3.0" << endl;
+    ok = false;
+  }
+  const YmslString* s = static_cast<const YmslString*>(vsm.read_global(6).obj_value);
+  if ( s == NULL || string(s->str()) != "bx" ) {
+    cerr << " " << name << ": s is not \"bx\"" << endl;
+    ok = false;
+  }
+  delete module;
+  return ok;
+}
+
+// update() で作り直すモジュール
+//
+// 作り直すたびにファイルの大きさが変わるように値の桁数を変える．
+const Ymsl_INT kUpdateVal[] = { 7, 42, 1234, 98765 };
+
+// U を import するモジュール
+const char* kUpdateV =
+  "import U;"
+  "function get():int {"
+  "  return U.k + 1;"
+  "}";
+
+// V を import して結果を r に入れるモジュール
+const char* kUpdateMain =
+  "import V;"
+  "var r:int = 0;"
+  "r = V.get();";
+
+// kUpdateMain をコンパイルして実行し，r の値を得る．
+bool
+run_update_main(const char* name,
+		YmslCompiler& compiler,
+		Ymsl_INT& val)
+{
+  StringIDO ido(kUpdateMain);
+  VsmModule* module = compiler.compile(ido, ShString("__main__"));
+  if ( module == NULL ) {
+    cerr << " " << name << ": failed to compile" << endl;
+    return false;
+  }
+  Vsm vsm;
+  bool ok = vsm.execute_module(*module);
+  if ( ok ) {
+    val = vsm.read_global(0).int_value;
+  }
+  else {
+    cerr << " " << name << ": failed to run" << endl;
+  }
+  delete module;
+  return ok;
+}
+
+END_NONAMESPACE
+
+// VsmCodeList を書き出して読み込めることと，
+// 途中で切れた内容や範囲外の飛び先を読み込まないことを調べる．
+bool
+code_list_test()
+{
+  // 前向きと後ろ向きのジャンプ，ジャンプテーブル，FLOAT の定数，
+  // 長さの異なる INT のオペランド，スタックマップを含むコードを作る．
+  VsmCodeList::Builder builder;
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(2);
+  Ymsl_INT loop_addr = builder.size();
+  builder.write_opcode(VSM_JUMP_TABLE);
+  builder.write_int(0);
+  Ymsl_INT table = builder.add_jump_table(3);
+  builder.write_int(table);
+  Ymsl_INT default_pos = builder.size();
+  builder.write_int(0);
+  Ymsl_INT case0_addr = builder.size();
+  builder.write_opcode(VSM_PUSH_FLOAT_IMM);
+  builder.write_float(3.25);
+  builder.write_opcode(VSM_POP);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(1000);
+  builder.write_opcode(VSM_JUMP);
+  builder.write_int(loop_addr);
+  Ymsl_INT case1_addr = builder.size();
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(-100000);
+  builder.write_opcode(VSM_POP);
+  builder.write_opcode(VSM_PUSH_OBJ_NULL);
+  builder.write_opcode(VSM_PUSH_OBJ_NULL);
+  builder.write_opcode(VSM_OBJ_ADD);
+  Ymsl_INT map_addr = builder.size();
+  builder.write_opcode(VSM_POP);
+  Ymsl_INT end_addr = builder.size();
+  builder.write_opcode(VSM_HALT);
+  builder.rewrite_int(default_pos, end_addr);
+  builder.rewrite_jump_table(table, 0, case0_addr);
+  builder.rewrite_jump_table(table, 1, case1_addr);
+  builder.rewrite_jump_table(table, 2, end_addr);
+  vector<Ymsl_INT> slot_list;
+  slot_list.push_back(0);
+  slot_list.push_back(1);
+  builder.add_stack_map(map_addr, slot_list);
+
+  VsmCodeList code_list(builder);
+  VsmBinWriter writer;
+  code_list.dump(writer);
+  const vector<ymuint8>& data = writer.data();
+
+  bool ok = true;
+
+  VsmBinReader reader(&data[0], data.size());
+  VsmCodeList code_list2(reader);
+  if ( reader.error() || reader.remain() > 0 ) {
+    cerr << " code_list_test: failed to read" << endl;
+    return false;
+  }
+
+  // 実行用の形が一致することを調べる．
+  if ( code_list2.size() != code_list.size() ||
+       code_list2.byte_size() != code_list.byte_size() ||
+       code_list2.float_num() != code_list.float_num() ) {
+    cerr << " code_list_test: size mismatch" << endl;
+    return false;
+  }
+  for (Ymsl_INT addr = 0; addr < code_list.size(); ) {
+    Ymsl_INT addr2 = addr;
+    Ymsl_CODE op = code_list.read_opcode(addr);
+    if ( code_list2.read_opcode(addr2) != op ) {
+      cerr << " code_list_test: opcode mismatch at " << addr << endl;
+      return false;
+    }
+    for (const char* p = Vsm::operand_format(op); *p; ++ p) {
+      bool same;
+      if ( *p == 'f' ) {
+	same = (code_list.read_float(addr) == code_list2.read_float(addr2));
+      }
+      else {
+	same = (code_list.read_int(addr) == code_list2.read_int(addr2));
+      }
+      if ( !same ) {
+	cerr << " code_list_test: operand mismatch at " << addr << endl;
+	ok = false;
+      }
+    }
+  }
+  if ( code_list2.jump_table_size(0) != 3 ) {
+    cerr << " code_list_test: jump table size mismatch" << endl;
+    ok = false;
+  }
+  else {
+    for (ymuint i = 0; i < 3; ++ i) {
+      if ( code_list2.jump_table(0)[i] != code_list.jump_table(0)[i] ) {
+	cerr << " code_list_test: jump table mismatch" << endl;
+	ok = false;
+      }
+    }
+  }
+  Ymsl_INT map_index = -1;
+  for (Ymsl_INT addr = 0; addr <= code_list.size(); ++ addr) {
+    Ymsl_INT index1 = code_list.find_stack_map(addr);
+    Ymsl_INT index2 = code_list2.find_stack_map(addr);
+    if ( (index1 < 0) != (index2 < 0) ) {
+      cerr << " code_list_test: stack map address mismatch at " << addr << endl;
+      ok = false;
+      continue;
+    }
+    if ( index1 < 0 ) {
+      continue;
+    }
+    map_index = index1;
+    Ymsl_INT n = code_list.stack_map_size(index1);
+    if ( code_list2.stack_map_size(index2) != n ) {
+      cerr << " code_list_test: stack map size mismatch" << endl;
+      ok = false;
+      continue;
+    }
+    for (Ymsl_INT i = 0; i < n; ++ i) {
+      if ( code_list2.stack_map(index2)[i] != code_list.stack_map(index1)[i] ) {
+	cerr << " code_list_test: stack map mismatch" << endl;
+	ok = false;
+      }
+    }
+  }
+  if ( map_index < 0 ) {
+    cerr << " code_list_test: stack map not found" << endl;
+    ok = false;
+  }
+
+  // もう一度書き出すと同じ内容になる．
+  VsmBinWriter writer2;
+  code_list2.dump(writer2);
+  if ( writer2.data() != data ) {
+    cerr << " code_list_test: dump mismatch" << endl;
+    ok = false;
+  }
+
+  // 途中で切れている場合は全て読み込みエラーになる．
+  for (ymuint size = 0; size < data.size(); ++ size) {
+    VsmBinReader reader1(&data[0], size);
+    VsmCodeList code_list1(reader1);
+    if ( !reader1.error() ) {
+      cerr << " code_list_test: truncated at " << size << " but accepted" << endl;
+      ok = false;
+    }
+  }
+
+  // 飛び先が命令の先頭でない場合も読み込みエラーになる．
+  // ジャンプテーブルの最初の要素を先頭の PUSH_INT_IMM のオペランドの
+  // 位置に書き換える．
+  // dump() は本体のバイト数と本体，FLOAT の数と値，ジャンプテーブルの数と
+  // 要素数，要素の順に書く．
+  {
+    ymuint pos = sizeof(ymuint32) + code_list.byte_size() +
+      sizeof(ymuint32) + sizeof(Ymsl_FLOAT) * code_list.float_num() +
+      sizeof(ymuint32) + sizeof(ymuint32);
+    vector<ymuint8> data1(data);
+    ymint32 bad_addr = 1;
+    memcpy(&data1[pos], &bad_addr, sizeof(ymint32));
+    VsmBinReader reader1(&data1[0], data1.size());
+    VsmCodeList code_list1(reader1);
+    if ( !reader1.error() ) {
+      cerr << " code_list_test: bad jump target accepted" << endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+// VsmModuleFile で書き出して読み込めることと，
+// 途中で切れたファイルや内容が変わったファイルを読み込まないことを調べる．
+bool
+module_file_test()
+{
+  char dir_buf[] = "/tmp/VsmModuleFile_testXXXXXX";
+  if ( mkdtemp(dir_buf) == NULL ) {
+    cerr << " module_file_test: mkdtemp failed" << endl;
+    return false;
+  }
+  string dir(dir_buf);
+  string src_path = make_path(dir, "M.ym");
+  string ymc_path = make_path(dir, "M.ymc");
+  string ymc_path2 = make_path(dir, "M2.ymc");
+  string bad_path = make_path(dir, "bad.ymc");
+
+  bool ok = true;
+
+  YmslCompiler compiler;
+  StringIDO ido(kScript);
+  VsmModule* module = compiler.compile(ido, ShString("M"));
+  if ( module == NULL ) {
+    cerr << " module_file_test: failed to compile" << endl;
+    rmdir(dir.c_str());
+    return false;
+  }
+
+  TypeMgr type_mgr;
+  VsmModuleFile module_file(compiler, type_mgr);
+
+  // 元のソースファイルの情報と一緒に書き出す．
+  VsmModuleFile::SourceInfo src_info;
+  if ( !write_file(src_path, reinterpret_cast<const ymuint8*>(kScript), strlen(kScript)) ||
+       !VsmModuleFile::stat_source(src_path, src_info) ||
+       !VsmModuleFile::hash_source(src_path, src_info.mHash) ) {
+    cerr << " module_file_test: failed to write the source" << endl;
+    ok = false;
+  }
+  else if ( !module_file.write(ymc_path, *module, src_info) ) {
+    cerr << " module_file_test: failed to write" << endl;
+    ok = false;
+  }
+
+  VsmModule* module2 = ok ? module_file.read(ymc_path, src_path) : NULL;
+  if ( ok && module2 == NULL ) {
+    cerr << " module_file_test: failed to read" << endl;
+    ok = false;
+  }
+
+  if ( module2 != NULL ) {
+    if ( !same_interface(*module, *module2) ) {
+      cerr << " module_file_test: interface mismatch" << endl;
+      ok = false;
+    }
+
+    // 読み込んだモジュールを書き出すと同じ内容になる．
+    vector<ymuint8> data;
+    vector<ymuint8> data2;
+    if ( !module_file.write(ymc_path2, *module2, src_info) ||
+	 !read_file(ymc_path, data) || !read_file(ymc_path2, data2) ||
+	 data != data2 ) {
+      cerr << " module_file_test: rewritten file mismatch" << endl;
+      ok = false;
+    }
+
+    if ( !check_result("module_file_test(compiled)", *module) ) {
+      ok = false;
+    }
+    if ( !check_result("module_file_test(loaded)", *module2) ) {
+      ok = false;
+    }
+    delete module2;
+
+    // 途中で切れたファイルは読み込まない．
+    for (ymuint size = 0; size < data.size(); ++ size) {
+      if ( !write_file(bad_path, &data[0], size) ) {
+	ok = false;
+	break;
+      }
+      VsmModule* module3 = module_file.read(bad_path, string());
+      if ( module3 != NULL ) {
+	cerr << " module_file_test: truncated at " << size
+	     << " but accepted" << endl;
+	delete module3;
+	ok = false;
+	break;
+      }
+    }
+
+    // 本体のハッシュ値が合わないファイルは読み込まない．
+    if ( !data.empty() ) {
+      vector<ymuint8> data3(data);
+      data3[data3.size() - 1] ^= 0x01;
+      if ( write_file(bad_path, &data3[0], data3.size()) ) {
+	VsmModule* module3 = module_file.read(bad_path, string());
+	if ( module3 != NULL ) {
+	  cerr << " module_file_test: body hash mismatch but accepted" << endl;
+	  delete module3;
+	  ok = false;
+	}
+      }
+    }
+
+    // ソースファイルの大きさが同じでも内容のハッシュ値が違えば読み込まない．
+    string src(kScript);
+    src[src.size() - 2] = 'm';
+    if ( write_file(src_path, reinterpret_cast<const ymuint8*>(src.c_str()), src.size()) ) {
+      VsmModule* module3 = module_file.read(ymc_path, src_path);
+      if ( module3 != NULL ) {
+	cerr << " module_file_test: source hash mismatch but accepted" << endl;
+	delete module3;
+	ok = false;
+      }
+    }
+  }
+
+  delete module;
+
+  unlink(src_path.c_str());
+  unlink(ymc_path.c_str());
+  unlink(ymc_path2.c_str());
+  unlink(bad_path.c_str());
+  rmdir(dir.c_str());
+
+  return ok;
+}
+
+// 他のモジュールの大域変数と関数を参照できることと，
+// import されたモジュールのトップレベルが一度だけ実行されることを調べる．
+bool
+import_test()
+{
+  char dir_buf[] = "/tmp/VsmModuleFile_testXXXXXX";
+  if ( mkdtemp(dir_buf) == NULL ) {
+    cerr << " import_test: mkdtemp failed" << endl;
+    return false;
+  }
+  string dir(dir_buf);
+  string b_path = make_path(dir, "B.ym");
+  string c_path = make_path(dir, "C.ym");
+
+  bool ok = true;
+  if ( !write_file(b_path, reinterpret_cast<const ymuint8*>(kImportB), strlen(kImportB)) ||
+       !write_file(c_path, reinterpret_cast<const ymuint8*>(kImportC), strlen(kImportC)) ) {
+    cerr << " import_test: failed to write the sources" << endl;
+    ok = false;
+  }
+
+  if ( ok ) {
+    // 一回目はソースからコンパイルし，二回目は .ymc を読み込む．
+    for (ymuint i = 0; i < 2; ++ i) {
+      YmslCompiler compiler;
+      compiler.add_searchpath_top(dir);
+      if ( !check_import("import_test(stack)", compiler, false, 0) ) {
+	ok = false;
+      }
+      if ( !check_import("import_test(reg)", compiler, true, 0) ) {
+	ok = false;
+      }
+      if ( !check_import("import_test(jit)", compiler, false, 1) ) {
+	ok = false;
+      }
+    }
+  }
+
+  unlink(b_path.c_str());
+  unlink(c_path.c_str());
+  unlink((b_path + "c").c_str());
+  unlink((c_path + "c").c_str());
+  rmdir(dir.c_str());
+
+  return ok;
+}
+
+// update() を繰り返しても結果が新しいソースのものになり，
+// 作り直す前のモジュールが削除されることを調べる．
+bool
+update_test()
+{
+  char dir_buf[] = "/tmp/VsmModuleFile_testXXXXXX";
+  if ( mkdtemp(dir_buf) == NULL ) {
+    cerr << " update_test: mkdtemp failed" << endl;
+    return false;
+  }
+  string dir(dir_buf);
+  string u_path = make_path(dir, "U.ym");
+  string v_path = make_path(dir, "V.ym");
+
+  ModuleRegistry& registry = ModuleRegistry::the_registry();
+  ymuint base_num = registry.module_num();
+
+  bool ok = true;
+  {
+    YmslCompiler compiler;
+    compiler.add_searchpath_top(dir);
+    const ymuint n = sizeof(kUpdateVal) / sizeof(kUpdateVal[0]);
+    for (ymuint i = 0; i < n && ok; ++ i) {
+      ostringstream buf;
+      buf << "var k:int = 0;"
+	  << "k = " << kUpdateVal[i] << ";";
+      string u_src = buf.str();
+      if ( !write_file(u_path, reinterpret_cast<const ymuint8*>(u_src.c_str()), u_src.size()) ||
+	   (i == 0 &&
+	    !write_file(v_path, reinterpret_cast<const ymuint8*>(kUpdateV), strlen(kUpdateV))) ) {
+	cerr << " update_test: failed to write the sources" << endl;
+	ok = false;
+	break;
+      }
+
+      if ( i > 0 ) {
+	vector<ShString> name_list;
+	if ( !compiler.update(name_list) ) {
+	  cerr << " update_test: update() failed at " << i << endl;
+	  ok = false;
+	  break;
+	}
+	if ( name_list.size() != 2 ) {
+	  cerr << " update_test: " << name_list.size()
+	       << " modules updated at " << i << ", expected 2" << endl;
+	  ok = false;
+	}
+      }
+
+      Ymsl_INT val = 0;
+      if ( !run_update_main("update_test", compiler, val) ) {
+	ok = false;
+	break;
+      }
+      if ( val != kUpdateVal[i] + 1 ) {
+	cerr << " update_test: r = " << val << " at " << i
+	     << ", expected " << (kUpdateVal[i] + 1) << endl;
+	ok = false;
+      }
+
+      // 作り直す前の U と V は削除されている．
+      if ( registry.module_num() != base_num + 2 ) {
+	cerr << " update_test: " << registry.module_num() - base_num
+	     << " modules alive at " << i << ", expected 2" << endl;
+	ok = false;
+      }
+    }
+
+    // 変更がなければ何も作り直さない．
+    vector<ShString> name_list;
+    if ( ok && (!compiler.update(name_list) || !name_list.empty()) ) {
+      cerr << " update_test: unchanged modules were updated" << endl;
+      ok = false;
+    }
+  }
+
+  // U を無効にすると U と V の両方が削除される．
+  registry.invalidate(u_path);
+  if ( registry.module_num() != base_num ) {
+    cerr << " update_test: " << registry.module_num() - base_num
+	 << " modules alive after invalidate, expected 0" << endl;
+    ok = false;
+  }
+
+  unlink(u_path.c_str());
+  unlink(v_path.c_str());
+  unlink((u_path + "c").c_str());
+  unlink((v_path + "c").c_str());
+  rmdir(dir.c_str());
+
+  return ok;
+}
+
+int
+VsmModuleFile_test(int argc,
+		   char** argv)
+{
+  StreamMsgHandler handler(&cerr);
+  MsgMgr::reg_handler(&handler);
+
+  int nerr = 0;
+
+  if ( !code_list_test() ) {
+    cerr << "code_list_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !module_file_test() ) {
+    cerr << "module_file_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !import_test() ) {
+    cerr << "import_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !update_test() ) {
+    cerr << "update_test failed" << endl;
+    ++ nerr;
+  }
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::VsmModuleFile_test(argc, argv);
+}
@@ -0,0 +1,395 @@
+
+/// @file Vsm_bench.cc
+/// @brief Vsm の命令ディスパッチとコードの読み出しのベンチマーク
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "Vsm.h"
+#include "VsmCodeList.h"
+#include "VsmRegCodeList.h"
+#include <time.h>
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 経過時間をナノ秒単位で得る．
+double
+get_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1.0e+9 + ts.tv_nsec;
+}
+
+// for (i = 0; i < n; ++ i) { x = x ^ i; } のコードを作る．
+//
+// ローカル変数 #0 が i，#1 が x
+// ループ1回あたりの命令数は 11
+void
+make_xor_loop(Ymsl_INT n,
+	      VsmCodeList::Builder& builder)
+{
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(0);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(0);
+
+  Ymsl_INT loop_top = builder.size();
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(1);
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_XOR);
+  builder.write_opcode(VSM_STORE_LOCAL_INT);
+  builder.write_int(1);
+
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_INC);
+  builder.write_opcode(VSM_STORE_LOCAL_INT);
+  builder.write_int(0);
+
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(n);
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_LT);
+  builder.write_opcode(VSM_BRANCH_TRUE);
+  builder.write_int(loop_top);
+
+  builder.write_opcode(VSM_HALT);
+}
+
+// xor ループの本体を m 回展開したコードを作る．
+//
+// ローカル変数 #0 が i，#1 が x
+// コードが L1 キャッシュに収まらない場合の比較用
+// ループ1回あたりの命令数は 7 * m + 4
+void
+make_big_xor_loop(Ymsl_INT n,
+		  ymuint m,
+		  VsmCodeList::Builder& builder)
+{
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(0);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(0);
+
+  Ymsl_INT loop_top = builder.size();
+  for (ymuint i = 0; i < m; ++ i) {
+    builder.write_opcode(VSM_LOAD_LOCAL_INT);
+    builder.write_int(1);
+    builder.write_opcode(VSM_LOAD_LOCAL_INT);
+    builder.write_int(0);
+    builder.write_opcode(VSM_INT_XOR);
+    builder.write_opcode(VSM_STORE_LOCAL_INT);
+    builder.write_int(1);
+
+    builder.write_opcode(VSM_LOAD_LOCAL_INT);
+    builder.write_int(0);
+    builder.write_opcode(VSM_INT_INC);
+    builder.write_opcode(VSM_STORE_LOCAL_INT);
+    builder.write_int(0);
+  }
+
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(n);
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_LT);
+  builder.write_opcode(VSM_BRANCH_TRUE);
+  builder.write_int(loop_top);
+
+  builder.write_opcode(VSM_HALT);
+}
+
+// for (i = n; i != 0; -- i) { x = (x * 75 + 74) % 65537; }
+// のコードを作る．
+//
+// ローカル変数 #0 が i，#1 が x
+// ループ1回あたりの命令数は 17
+void
+make_lcg_loop(Ymsl_INT n,
+	      VsmCodeList::Builder& builder)
+{
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(n);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(1);
+
+  Ymsl_INT loop_top = builder.size();
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(65537);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(74);
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(75);
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(1);
+  builder.write_opcode(VSM_INT_MUL);
+  builder.write_opcode(VSM_INT_ADD);
+  builder.write_opcode(VSM_INT_MOD);
+  builder.write_opcode(VSM_STORE_LOCAL_INT);
+  builder.write_int(1);
+
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_DEC);
+  builder.write_opcode(VSM_STORE_LOCAL_INT);
+  builder.write_int(0);
+
+  builder.write_opcode(VSM_PUSH_INT_IMM);
+  builder.write_int(0);
+  builder.write_opcode(VSM_LOAD_LOCAL_INT);
+  builder.write_int(0);
+  builder.write_opcode(VSM_INT_NE);
+  builder.write_opcode(VSM_BRANCH_TRUE);
+  builder.write_int(loop_top);
+
+  builder.write_opcode(VSM_HALT);
+}
+
+// xor ループのレジスタ型のコードを作る．
+//
+// スロット #0 が i，#1 が x，#2 が n
+// ループ1回あたりの命令数は 4
+void
+make_reg_xor_loop(Ymsl_INT n,
+		  VsmRegCodeList::Builder& builder)
+{
+  builder.write_opcode(VSM_REG_ENTER);
+  builder.write_int(4);
+  builder.write_int(0);
+  builder.write_opcode(VSM_REG_INT_IMM);
+  builder.write_int(2);
+  builder.write_int(n);
+
+  Ymsl_INT loop_top = builder.size();
+  builder.write_opcode(VSM_REG_INT_XOR);
+  builder.write_int(1);
+  builder.write_int(1);
+  builder.write_int(0);
+  builder.write_opcode(VSM_REG_INT_INC);
+  builder.write_int(0);
+  builder.write_int(0);
+  builder.write_opcode(VSM_REG_INT_LT);
+  builder.write_int(3);
+  builder.write_int(0);
+  builder.write_int(2);
+  builder.write_opcode(VSM_REG_BRANCH_TRUE);
+  builder.write_int(3);
+  builder.write_int(loop_top);
+
+  builder.write_opcode(VSM_REG_HALT);
+}
+
+// lcg ループのレジスタ型のコードを作る．
+//
+// スロット #0 が i，#1 が x，#2 〜 #5 が定数
+// ループ1回あたりの命令数は 6
+void
+make_reg_lcg_loop(Ymsl_INT n,
+		  VsmRegCodeList::Builder& builder)
+{
+  builder.write_opcode(VSM_REG_ENTER);
+  builder.write_int(7);
+  builder.write_int(0);
+  Ymsl_INT init_list[] = { n, 1, 75, 74, 65537, 0 };
+  for (ymuint i = 0; i < 6; ++ i) {
+    builder.write_opcode(VSM_REG_INT_IMM);
+    builder.write_int(i);
+    builder.write_int(init_list[i]);
+  }
+
+  Ymsl_INT loop_top = builder.size();
+  builder.write_opcode(VSM_REG_INT_MUL);
+  builder.write_int(6);
+  builder.write_int(1);
+  builder.write_int(2);
+  builder.write_opcode(VSM_REG_INT_ADD);
+  builder.write_int(6);
+  builder.write_int(6);
+  builder.write_int(3);
+  builder.write_opcode(VSM_REG_INT_MOD);
+  builder.write_int(1);
+  builder.write_int(6);
+  builder.write_int(4);
+  builder.write_opcode(VSM_REG_INT_DEC);
+  builder.write_int(0);
+  builder.write_int(0);
+  builder.write_opcode(VSM_REG_INT_NE);
+  builder.write_int(6);
+  builder.write_int(0);
+  builder.write_int(5);
+  builder.write_opcode(VSM_REG_BRANCH_TRUE);
+  builder.write_int(6);
+  builder.write_int(loop_top);
+
+  builder.write_opcode(VSM_REG_HALT);
+}
+
+// 結果を表示する．
+void
+print_result(const char* name,
+	     double time,
+	     Ymsl_INT n,
+	     ymuint op_num,
+	     Ymsl_INT result)
+{
+  cout << name << ": "
+       << time / (static_cast<double>(n) * op_num) << " ns/op, "
+       << time / n << " ns/iter"
+       << " (result = " << result << ")" << endl;
+}
+
+// コードのサイズとオペランドの読み出しの時間を表示する．
+//
+// Builder 上のサイズ(1語4バイト)と保存用の形のバイト数を比べる．
+void
+print_code(const char* name,
+	   const VsmCodeList::Builder& builder,
+	   const VsmCodeList& code_list,
+	   const char* (*format_func)(Ymsl_CODE))
+{
+  // 形式を返す関数の呼び出しを計らないように表にしておく．
+  const char* format_table[256];
+  for (ymuint op = 0; op < 256; ++ op) {
+    format_table[op] = format_func(op);
+  }
+
+  // コードの大きさによらずほぼ同じ時間になるように繰り返す．
+  const ymuint rep = 30000000 / code_list.size() + 1;
+  ymuint64 n = 0;
+  Ymsl_INT sum = 0;
+  double t0 = get_time();
+  for (ymuint r = 0; r < rep; ++ r) {
+    for (Ymsl_INT pc = 0; pc < code_list.size(); ) {
+      Ymsl_CODE op = code_list.read_opcode(pc);
+      for (const char* p = format_table[op]; *p; ++ p, ++ n) {
+	if ( *p == 'f' ) {
+	  sum += static_cast<Ymsl_INT>(code_list.read_float(pc));
+	}
+	else {
+	  sum += code_list.read_int(pc);
+	}
+      }
+    }
+  }
+  double t1 = get_time();
+
+  cout << name << ": "
+       << builder.size() * sizeof(Ymsl_CODE) << " -> "
+       << code_list.byte_size() << " bytes, "
+       << (t1 - t0) / n << " ns/operand"
+       << " (sum = " << sum << ")" << endl;
+}
+
+// コードを実行して1命令あたりの時間を表示する．
+void
+run_bench(const char* name,
+	  const VsmCodeList::Builder& builder,
+	  Ymsl_INT n,
+	  ymuint op_num)
+{
+  VsmCodeList code_list(builder);
+  print_code(name, builder, code_list, Vsm::operand_format);
+
+  // 1回目はキャッシュに載せるためのものなので捨てる．
+  {
+    Vsm vsm;
+    vsm.execute(code_list, 0);
+  }
+
+  Vsm vsm;
+  double t0 = get_time();
+  vsm.execute(code_list, 0);
+  double t1 = get_time();
+
+  print_result(name, t1 - t0, n, op_num, vsm.read_stack(1).int_value);
+}
+
+// レジスタ型のコードを実行して1命令あたりの時間を表示する．
+void
+run_reg_bench(const char* name,
+	      const VsmRegCodeList::Builder& builder,
+	      Ymsl_INT n,
+	      ymuint op_num)
+{
+  VsmRegCodeList code_list(builder);
+  print_code(name, builder, code_list, Vsm::reg_operand_format);
+
+  // 1回目はキャッシュに載せるためのものなので捨てる．
+  {
+    Vsm vsm;
+    vsm.execute_reg(code_list, 0);
+  }
+
+  Vsm vsm;
+  double t0 = get_time();
+  vsm.execute_reg(code_list, 0);
+  double t1 = get_time();
+
+  print_result(name, t1 - t0, n, op_num, vsm.read_stack(1).int_value);
+}
+
+END_NONAMESPACE
+
+int
+Vsm_bench(int argc,
+	  char** argv)
+{
+  Ymsl_INT n = 10000000;
+  if ( argc > 1 ) {
+    n = atoi(argv[1]);
+  }
+
+#if defined(YMSL_USE_COMPUTED_GOTO)
+  cout << "dispatch: computed goto" << endl;
+#else
+  cout << "dispatch: switch" << endl;
+#endif
+
+  {
+    VsmCodeList::Builder builder;
+    make_xor_loop(n, builder);
+    run_bench("xor(stack)", builder, n, 11);
+  }
+  {
+    VsmRegCodeList::Builder builder;
+    make_reg_xor_loop(n, builder);
+    run_reg_bench("xor(reg)  ", builder, n, 4);
+  }
+  {
+    const ymuint m = 4000;
+    VsmCodeList::Builder builder;
+    make_big_xor_loop(n, m, builder);
+    run_bench("xor*4000(stack)", builder, n / m, 7 * m + 4);
+  }
+  {
+    VsmCodeList::Builder builder;
+    make_lcg_loop(n, builder);
+    run_bench("lcg(stack)", builder, n, 17);
+  }
+  {
+    VsmRegCodeList::Builder builder;
+    make_reg_lcg_loop(n, builder);
+    run_reg_bench("lcg(reg)  ", builder, n, 6);
+  }
+
+  return 0;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::Vsm_bench(argc, argv);
+}
@@ -0,0 +1,212 @@
+
+/// @file Vsm_profile.cc
+/// @brief Vsm の命令の組の実行回数を数えるプログラム
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+///
+/// YMSL_VSM_PROFILE を定義してコンパイルした Vsm.cc とリンクする．
+/// 引数がない場合には組み込みのスクリプトを用いる．
+
+
+#include "Vsm.h"
+#include "VsmModule.h"
+#include "YmslCompiler.h"
+
+#include "YmUtils/FileIDO.h"
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 組み込みのスクリプト
+const char* script_list[] = {
+  // 単純なループ
+  "var s:int = 0;"
+  "var i:int;"
+  "for (i = 0; i < 1000000; i ++) {"
+  "  s += i;"
+  "}",
+
+  // 二重ループ
+  "var r:int = nested(1000);"
+  "function nested(n:int):int {"
+  "  var s:int = 0;"
+  "  var i:int;"
+  "  var j:int;"
+  "  for (i = 0; i < n; i ++) {"
+  "    for (j = 0; j < n; j ++) {"
+  "      s = s ^ (i * j);"
+  "    }"
+  "  }"
+  "  return s;"
+  "}",
+
+  // 素数の数え上げ
+  "var r:int = primes(20000);"
+  "function primes(m:int):int {"
+  "  var n:int = 0;"
+  "  var i:int;"
+  "  for (i = 2; i < m; i ++) {"
+  "    var p:int = 1;"
+  "    var j:int;"
+  "    for (j = 2; j * j <= i; j ++) {"
+  "      if i % j == 0 {"
+  "        p = 0;"
+  "        break;"
+  "      }"
+  "    }"
+  "    n += p;"
+  "  }"
+  "  return n;"
+  "}",
+
+  // Collatz 数列の長さ
+  "var r:int = collatz(30000);"
+  "function collatz(n:int):int {"
+  "  var m:int = 0;"
+  "  var i:int;"
+  "  for (i = 1; i < n; i ++) {"
+  "    var x:int = i;"
+  "    var c:int = 0;"
+  "    while (x != 1) {"
+  "      if x % 2 == 0 {"
+  "        x = x / 2;"
+  "      }"
+  "      else {"
+  "        x = x * 3 + 1;"
+  "      }"
+  "      c ++;"
+  "    }"
+  "    if c > m {"
+  "      m = c;"
+  "    }"
+  "  }"
+  "  return m;"
+  "}",
+
+  // 最大公約数
+  "var s:int = 0;"
+  "var i:int;"
+  "for (i = 1; i < 100000; i ++) {"
+  "  var g:int = gcd(i, 360360);"
+  "  s += g;"
+  "}"
+  "function gcd(a:int, b:int):int {"
+  "  while (b != 0) {"
+  "    var t:int = a % b;"
+  "    a = b;"
+  "    b = t;"
+  "  }"
+  "  return a;"
+  "}",
+
+  // 再帰呼び出し
+  "var f:int = fib(25);"
+  "function fib(n:int):int {"
+  "  if n < 2 {"
+  "    return n;"
+  "  }"
+  "  var a:int = fib(n - 1);"
+  "  var b:int = fib(n - 2);"
+  "  return a + b;"
+  "}",
+
+  // switch 文による分岐
+  "var r:int = dispatch(300000);"
+  "function dispatch(n:int):int {"
+  "  var s:int = 0;"
+  "  var i:int;"
+  "  for (i = 0; i < n; i ++) {"
+  "    switch i % 8 {"
+  "    case 0: { s += 1; }"
+  "    case 1: { s += 3; }"
+  "    case 2: { s ^= i; }"
+  "    case 3: { s -= 2; }"
+  "    case 5: { s += i % 7; }"
+  "    case 6: { s = s * 3; }"
+  "    default: { s ++; }"
+  "    }"
+  "  }"
+  "  return s;"
+  "}",
+
+  // 浮動小数点演算
+  "var x:float = series(300000);"
+  "function series(n:int):float {"
+  "  var x:float = 0.0;"
+  "  var i:int;"
+  "  for (i = 0; i < n; i ++) {"
+  "    x = x * 0.5 + 1.0;"
+  "  }"
+  "  return x;"
+  "}",
+
+  NULL
+};
+
+// スクリプトを実行する．
+bool
+run_script(IDO& ido)
+{
+  YmslCompiler compiler;
+  VsmModule* module = compiler.compile(ido, ShString("__main__"));
+  if ( module == NULL ) {
+    return false;
+  }
+
+  // JIT コンパイルしたコードは数えられないので用いない．
+  Vsm vsm;
+  vsm.set_jit_threshold(0);
+  return vsm.execute_module(*module);
+}
+
+END_NONAMESPACE
+
+int
+Vsm_profile(int argc,
+	    char** argv)
+{
+  StreamMsgHandler handler(&cout);
+  MsgMgr::reg_handler(&handler);
+
+  if ( argc == 1 ) {
+    for (ymuint i = 0; script_list[i] != NULL; ++ i) {
+      StringIDO ido(script_list[i]);
+      if ( !run_script(ido) ) {
+	return 1;
+      }
+    }
+  }
+  else {
+    for (int i = 1; i < argc; ++ i) {
+      FileIDO ido;
+      if ( !ido.open(argv[i]) ) {
+	cerr << argv[i] << ": no such file" << endl;
+	return -1;
+      }
+      if ( !run_script(ido) ) {
+	return 1;
+      }
+    }
+  }
+
+  Vsm::print_profile(cout, 40);
+
+  return 0;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::Vsm_profile(argc, argv);
+}
@@ -0,0 +1,497 @@
+
+/// @file Vsm_test.cc
+/// @brief Vsm_test の実装ファイル
+/// @author Yusuke Matsunaga (松永 裕介)
+///
+/// Copyright (C) 2015 Yusuke Matsunaga
+/// All rights reserved.
+
+
+#include "AstMgr.h"
+#include "AstStatement.h"
+#include "IrMgr.h"
+#include "IrToplevel.h"
+#include "VsmGen.h"
+#include "VsmModule.h"
+#include "VsmFunction.h"
+#include "VsmCodeList.h"
+#include "Vsm.h"
+#include "YmslCompiler.h"
+
+#include "YmUtils/StringIDO.h"
+#include "YmUtils/MsgHandler.h"
+#include "YmUtils/MsgMgr.h"
+
+#include <cstdio>
+
+#if defined(YMSL_USE_JIT) && defined(YMSL_HAVE_PTHREAD_GETATTR_NP)
+#include <pthread.h>
+#endif
+
+
+BEGIN_NAMESPACE_YM_YMSL
+
+BEGIN_NONAMESPACE
+
+// 再帰呼び出しで 1 から n までの和を求める．
+// 末尾呼び出しではないので深さ n のフレームを積む．
+const char* kSumScript =
+  "var r1:int = 0;"
+  "function sum(n:int):int {"
+  "  if n == 0 {"
+  "    return 0;"
+  "  }"
+  "  var r:int = sum(n - 1);"
+  "  return n + r;"
+  "}"
+  "r1 = sum(%d);";
+
+// 末尾呼び出しを n 回繰り返して回数を数える．
+const char* kLoopScript =
+  "var r1:int = 0;"
+  "function loop(n:int, acc:int):int {"
+  "  if n == 0 {"
+  "    return acc;"
+  "  }"
+  "  return loop(n - 1, acc + 1);"
+  "}"
+  "r1 = loop(%d, 0);";
+
+// スクリプトをコンパイルする．
+// opt が true の時は中間表現の最適化を行う．
+// reg_mode が true の時はレジスタ型のコードを作る．
+// モジュールの型は ir_mgr が持つので，ir_mgr はモジュールより
+// 後に削除すること．
+VsmModule*
+compile_script(IrMgr& ir_mgr,
+	       const char* str,
+	       bool opt,
+	       bool reg_mode)
+{
+  StringIDO ido(str);
+  AstMgr ast_mgr;
+  if ( !ast_mgr.read_source(ido) ) {
+    return NULL;
+  }
+
+  YmslCompiler compiler;
+  IrToplevel* toplevel = ir_mgr.elaborate(ast_mgr.toplevel(),
+					  ShString("__main__"), compiler);
+  if ( toplevel == NULL ) {
+    return NULL;
+  }
+  if ( opt ) {
+    ir_mgr.optimize(toplevel);
+  }
+
+  VsmGen gen(reg_mode);
+  return gen.code_gen(toplevel, ShString("__main__"));
+}
+
+// 引数を一つ埋め込んだスクリプトを vsm で実行して最初の大域変数の値を得る．
+// 実行できなかったら false を返す．
+// コンパイルできなかった場合は val に -1 を入れる．
+bool
+run_script(Vsm& vsm,
+	   const char* format,
+	   int arg,
+	   bool opt,
+	   bool reg_mode,
+	   Ymsl_INT& val)
+{
+  char buf[1024];
+  snprintf(buf, sizeof(buf), format, arg);
+  IrMgr ir_mgr;
+  VsmModule* module = compile_script(ir_mgr, buf, opt, reg_mode);
+  if ( module == NULL ) {
+    val = -1;
+    return false;
+  }
+  bool stat = vsm.execute_module(*module);
+  val = vsm.read_global(0).int_value;
+  delete module;
+  return stat;
+}
+
+// 関数のコードに命令が含まれているか調べる．
+bool
+has_opcode(Vsm& vsm,
+	   const VsmFunction* func,
+	   Ymsl_CODE target)
+{
+  const VsmCodeList* code = func->frame_code(vsm);
+  if ( code == NULL ) {
+    return false;
+  }
+  for (Ymsl_INT addr = 0; addr < code->size(); ) {
+    Ymsl_CODE op = code->read_opcode(addr);
+    if ( op == target ) {
+      return true;
+    }
+    code->skip_operands(op, addr);
+  }
+  return false;
+}
+
+// 名前で関数を探す．
+const VsmFunction*
+find_function(const VsmModule* module,
+	      const char* name)
+{
+  for (ymuint i = 0; i < module->exported_function_num(); ++ i) {
+    const VsmFunction* func = module->exported_function(i);
+    if ( func->name() == ShString(name) ) {
+      return func;
+    }
+  }
+  return NULL;
+}
+
+// 試す最適化の有無と JIT のしきい値の組み合わせ
+const struct {
+  bool mOpt;
+  ymuint mJitThreshold;
+} kModeList[] = {
+  { false, 0 },
+  { true,  0 },
+  { false, 1 },
+  { true,  1 },
+};
+
+const ymuint kModeNum = sizeof(kModeList) / sizeof(kModeList[0]);
+
+END_NONAMESPACE
+
+// 末尾でない再帰呼び出しが深すぎる場合にスタックオーバーフローとして
+// execute_module() が false を返し，同じ Vsm で続けて実行できることを
+// 調べる．
+bool
+overflow_test()
+{
+  bool ok = true;
+  for (ymuint m = 0; m < kModeNum; ++ m) {
+    Vsm vsm;
+    vsm.set_jit_threshold(kModeList[m].mJitThreshold);
+    bool opt = kModeList[m].mOpt;
+
+    Ymsl_INT val;
+    if ( !run_script(vsm, kSumScript, 10000, opt, false, val) ) {
+      cerr << " overflow_test[" << m << "]: failed to run sum(10000)" << endl;
+      ok = false;
+    }
+    else if ( val != 50005000 ) {
+      cerr << " overflow_test[" << m << "]: sum(10000) = " << val
+	   << ", expected 50005000" << endl;
+      ok = false;
+    }
+
+    if ( run_script(vsm, kSumScript, 10000000, opt, false, val) ) {
+      cerr << " overflow_test[" << m << "]: no stack overflow" << endl;
+      ok = false;
+    }
+    else if ( val == -1 ) {
+      cerr << " overflow_test[" << m << "]: failed to compile" << endl;
+      ok = false;
+    }
+
+    // あふれた後もフレームは残っていない．
+    if ( !run_script(vsm, kSumScript, 100, opt, false, val) || val != 5050 ) {
+      cerr << " overflow_test[" << m << "]: sum(100) failed after overflow" << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// 深い末尾呼び出しがフレームを積まずに最後まで実行され，
+// 最適化した場合も VSM_TAIL_CALL が使われることを調べる．
+bool
+deep_tail_call_test()
+{
+  bool ok = true;
+  for (ymuint m = 0; m < kModeNum; ++ m) {
+    Vsm vsm;
+    vsm.set_jit_threshold(kModeList[m].mJitThreshold);
+    bool opt = kModeList[m].mOpt;
+
+    // 深さはローカルスタック (64K 語) を大きく超える．
+    Ymsl_INT val;
+    if ( !run_script(vsm, kLoopScript, 10000000, opt, false, val) ) {
+      cerr << " deep_tail_call_test[" << m << "]: failed to run" << endl;
+      ok = false;
+    }
+    else if ( val != 10000000 ) {
+      cerr << " deep_tail_call_test[" << m << "]: r1 = " << val
+	   << ", expected 10000000" << endl;
+      ok = false;
+    }
+  }
+
+  for (ymuint i = 0; i < 2; ++ i) {
+    bool opt = (i == 1);
+    char buf[1024];
+    snprintf(buf, sizeof(buf), kLoopScript, 10);
+    IrMgr ir_mgr;
+    VsmModule* module = compile_script(ir_mgr, buf, opt, false);
+    if ( module == NULL ) {
+      cerr << " deep_tail_call_test: failed to compile" << endl;
+      ok = false;
+      continue;
+    }
+    Vsm vsm;
+    vsm.set_jit_threshold(0);
+    const VsmFunction* func = find_function(module, "loop");
+    if ( func == NULL || !has_opcode(vsm, func, VSM_TAIL_CALL) ) {
+      cerr << " deep_tail_call_test: no VSM_TAIL_CALL in loop() with opt = "
+	   << opt << endl;
+      ok = false;
+    }
+    delete module;
+  }
+  return ok;
+}
+
+// スタックを伸長するモードで，最初の大きさを超える深さの再帰呼び出しが
+// 最大の大きさまでは実行でき，それを超えるとスタックオーバーフローに
+// なることを調べる．
+//
+// 伸長はガードページを使う場合のみ行うので，YMSL_USE_GUARD_PAGE が
+// 定義されていない場合は最初の大きさを超えるとあふれる．
+bool
+growth_test()
+{
+#if defined(YMSL_USE_GUARD_PAGE)
+  const bool can_grow = true;
+#else
+  const bool can_grow = false;
+#endif
+
+  bool ok = true;
+  for (ymuint i = 0; i < 2; ++ i) {
+    bool reg_mode = (i == 1);
+    const char* mode = reg_mode ? "reg" : "stack";
+
+    // 伸長しない場合は 20000 段の再帰は 4K 語に収まらない．
+    {
+      Vsm vsm(4 * 1024);
+      vsm.set_jit_threshold(0);
+      Ymsl_INT val;
+      if ( run_script(vsm, kSumScript, 20000, false, reg_mode, val) ) {
+	cerr << " growth_test(" << mode << "): no stack overflow "
+	     << "without growth" << endl;
+	ok = false;
+      }
+    }
+
+    Vsm vsm(4 * 1024, 4 * 1024 * 1024);
+    vsm.set_jit_threshold(0);
+    Ymsl_INT val;
+    bool stat = run_script(vsm, kSumScript, 20000, false, reg_mode, val);
+    if ( can_grow ) {
+      if ( !stat ) {
+	cerr << " growth_test(" << mode << "): failed to grow" << endl;
+	ok = false;
+      }
+      else if ( val != 200010000 ) {
+	cerr << " growth_test(" << mode << "): sum(20000) = " << val
+	     << ", expected 200010000" << endl;
+	ok = false;
+      }
+    }
+    else if ( stat ) {
+      cerr << " growth_test(" << mode << "): grew without guard page" << endl;
+      ok = false;
+    }
+
+    // 最大の大きさ (4M 語) を超えるとあふれる．
+    if ( run_script(vsm, kSumScript, 10000000, false, reg_mode, val) ) {
+      cerr << " growth_test(" << mode << "): no stack overflow" << endl;
+      ok = false;
+    }
+
+    // 伸長した後も続けて実行できる．
+    if ( !run_script(vsm, kSumScript, 100, false, reg_mode, val) || val != 5050 ) {
+      cerr << " growth_test(" << mode << "): sum(100) failed after overflow" << endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+#if defined(YMSL_USE_JIT) && defined(YMSL_HAVE_PTHREAD_GETATTR_NP)
+
+BEGIN_NONAMESPACE
+
+// small_stack_test() のスレッドで実行する．
+// arg は結果を入れる Ymsl_INT へのポインタ
+void*
+small_stack_main(void* arg)
+{
+  Ymsl_INT& val = *static_cast<Ymsl_INT*>(arg);
+  // 60000 段の再帰はローカルスタック (1M 語) には収まるが，
+  // 機械語のフレームはスレッドのスタック (1MB) に収まらない．
+  Vsm vsm(1024 * 1024);
+  vsm.set_jit_threshold(1);
+  if ( !run_script(vsm, kSumScript, 60000, false, false, val) ) {
+    val = -1;
+  }
+  return NULL;
+}
+
+END_NONAMESPACE
+
+// JIT コンパイルしたコードが使う C++ のスタックの上限を，
+// 実行しているスレッドのスタックの大きさから求めていることを調べる．
+// 決まった大きさを使っていると小さなスタックのスレッドでは
+// スタックを使い切ってしまう．
+bool
+small_stack_test()
+{
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 1024 * 1024);
+  Ymsl_INT val = 0;
+  pthread_t thread;
+  bool ok = true;
+  if ( pthread_create(&thread, &attr, small_stack_main, &val) != 0 ) {
+    cerr << " small_stack_test: failed to create a thread" << endl;
+    ok = false;
+  }
+  else {
+    pthread_join(thread, NULL);
+    if ( val != 1800030000 ) {
+      cerr << " small_stack_test: sum(60000) = " << val
+	   << ", expected 1800030000" << endl;
+      ok = false;
+    }
+  }
+  pthread_attr_destroy(&attr);
+  return ok;
+}
+
+#endif
+
+// VsmGen が求めたフレームの大きさを調べる．
+//
+// 最適化しないスタック型のコードで，フレームの大きさは引数を含む
+// ローカル変数の数と，その上に積まれる値の数の最大値の和になる．
+bool
+frame_size_test()
+{
+  const char* str =
+    "function f1(a:int):int {"
+    "  return a;"
+    "}"
+    "function locals(a:int):int {"
+    "  var x:int = a;"
+    "  var y:int = x;"
+    "  var z:int = y;"
+    "  return z;"
+    "}"
+    "function balanced(a:int, b:int, c:int, d:int):int {"
+    "  return (a + b) + (c + d);"
+    "}"
+    "function callee5(p:int, q:int, r:int, s:int, t:int):int {"
+    "  return p;"
+    "}"
+    "function call5(x:int):int {"
+    "  var r:int = callee5(x, x, x, x, x);"
+    "  return r;"
+    "}"
+    "function fl(a:float):float {"
+    "  var x:float = a * 2.0;"
+    "  return x;"
+    "}";
+
+  static const struct {
+    const char* mName;
+    Ymsl_INT mFrameSize;
+  } expected[] = {
+    // 1 + 1
+    { "f1",       2 },
+    // 4 + 1 (代入の右辺)
+    { "locals",   5 },
+    // 4 + 3 (どちらの項を先に計算しても 3 段になる)
+    { "balanced", 7 },
+    // 5 + 1
+    { "callee5",  6 },
+    // 2 + 5 (引数)
+    { "call5",    7 },
+    // 2 + 2
+    { "fl",       4 },
+  };
+
+  IrMgr ir_mgr;
+  VsmModule* module = compile_script(ir_mgr, str, false, false);
+  if ( module == NULL ) {
+    cerr << " frame_size_test: failed to compile" << endl;
+    return false;
+  }
+
+  bool ok = true;
+  for (ymuint i = 0; i < sizeof(expected) / sizeof(expected[0]); ++ i) {
+    const VsmFunction* func = find_function(module, expected[i].mName);
+    if ( func == NULL ) {
+      cerr << " frame_size_test: " << expected[i].mName << " not found" << endl;
+      ok = false;
+      continue;
+    }
+    if ( func->frame_size() != expected[i].mFrameSize ) {
+      cerr << " frame_size_test: frame_size(" << expected[i].mName << ") = "
+	   << func->frame_size() << ", expected "
+	   << expected[i].mFrameSize << endl;
+      ok = false;
+    }
+  }
+  delete module;
+  return ok;
+}
+
+int
+Vsm_test(int argc,
+	 char** argv)
+{
+  StreamMsgHandler handler(&cerr);
+  MsgMgr::reg_handler(&handler);
+
+  int nerr = 0;
+
+  if ( !overflow_test() ) {
+    cerr << "overflow_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !deep_tail_call_test() ) {
+    cerr << "deep_tail_call_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !growth_test() ) {
+    cerr << "growth_test failed" << endl;
+    ++ nerr;
+  }
+
+  if ( !frame_size_test() ) {
+    cerr << "frame_size_test failed" << endl;
+    ++ nerr;
+  }
+
+#if defined(YMSL_USE_JIT) && defined(YMSL_HAVE_PTHREAD_GETATTR_NP)
+  if ( !small_stack_test() ) {
+    cerr << "small_stack_test failed" << endl;
+    ++ nerr;
+  }
+#endif
+
+  return nerr;
+}
+
+END_NAMESPACE_YM_YMSL
+
+
+int
+main(int argc,
+     char** argv)
+{
+  return nsYm::nsYmsl::Vsm_test(argc, argv);
+}